@@ -0,0 +1,40 @@
+from __future__ import annotations
+
+import argparse
+import subprocess
+import tempfile
+import time
+from pathlib import Path
+
+
+root = Path(__file__).parent.parent
+parser = argparse.ArgumentParser(description="Measure the throughput of the cat command")
+parser.add_argument("--shell", type=Path, default=root / "build" / "shell.exe", help="the shell executable to benchmark")
+parser.add_argument("--size", type=int, default=256, help="the size of the generated file in MB")
+parser.add_argument("--flags", nargs="*", default=["", "--mmap"], help="the cat flags to compare, an empty string means no flag")
+namespace = parser.parse_args()
+
+with tempfile.TemporaryDirectory() as directory:
+    path = Path(directory) / "benchmark.txt"
+    line = b"".join(bytes([48 + index % 10]) for index in range(127)) + b"\n"
+    with path.open("wb") as file:
+        for _ in range(namespace.size * 1024 * 1024 // len(line)):
+            file.write(line)
+
+    size = path.stat().st_size
+    for flags in namespace.flags:
+        # Drain a pipe instead of discarding the output, writes to the null device may never touch the data
+        start = time.perf_counter()
+        process = subprocess.Popen([namespace.shell], stdin=subprocess.PIPE, stdout=subprocess.PIPE)
+        assert process.stdin is not None and process.stdout is not None
+        process.stdin.write(f"cat \"{path}\" {flags}\nexit\n".encode("utf-8"))
+        process.stdin.close()
+        while process.stdout.read(1 << 20):
+            pass
+
+        if process.wait() != 0:
+            raise subprocess.CalledProcessError(process.returncode, process.args)
+
+        elapsed = time.perf_counter() - start
+
+        print(f"cat {flags or '(default)'}: {size / elapsed / 1024 / 1024:.1f} MB/s ({elapsed:.3f}s, including process startup)")
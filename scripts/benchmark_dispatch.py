@@ -0,0 +1,32 @@
+from __future__ import annotations
+
+import argparse
+import subprocess
+import tempfile
+import time
+from pathlib import Path
+
+
+root = Path(__file__).parent.parent
+parser = argparse.ArgumentParser(description="Measure the cost of dispatching command lines to built-in commands")
+parser.add_argument("--shell", type=Path, default=root / "build" / "shell.exe", help="the shell executable to benchmark")
+parser.add_argument("--lines", type=int, default=100000, help="the number of command lines in the generated script")
+namespace = parser.parse_args()
+
+
+def run(lines: list[str]) -> float:
+    with tempfile.TemporaryDirectory() as directory:
+        script = Path(directory) / "benchmark.ff"
+        # x is defined first, so that the lines referencing it are valid
+        script.write_text("\n".join(["@OFF", "eval -s x 1", *lines]), encoding="utf-8")
+
+        start = time.perf_counter()
+        subprocess.run([namespace.shell], input=f"{script.with_suffix('')}\nexit\n".encode("utf-8"), stdout=subprocess.DEVNULL, check=True)
+        return time.perf_counter() - start
+
+
+# Lines referencing a variable are bound to their command at runtime, the others at compile time
+baseline = run([])
+for name, line in (("compile-time binding", "EvAl -s x 1"), ("runtime binding", "EvAl -s x $x")):
+    elapsed = run([line] * namespace.lines) - baseline
+    print(f"{name}: {elapsed / namespace.lines * 1e6:.2f}us per command line ({namespace.lines / elapsed:.1f} lines/s)")
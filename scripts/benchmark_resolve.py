@@ -0,0 +1,32 @@
+from __future__ import annotations
+
+import argparse
+import subprocess
+import tempfile
+import time
+from pathlib import Path
+
+
+root = Path(__file__).parent.parent
+parser = argparse.ArgumentParser(description="Measure how many lines with environment variables the shell resolves per second")
+parser.add_argument("--shell", type=Path, default=root / "build" / "shell.exe", help="the shell executable to benchmark")
+parser.add_argument("--lines", type=int, default=5000, help="the number of lines in the generated script")
+parser.add_argument("--variables", type=int, default=50, help="the number of variables referenced by each line")
+namespace = parser.parse_args()
+
+lines = ["@OFF", "eval -s i 0"]
+lines.extend(f"eval -s var_{index} value_{index}" for index in range(namespace.variables))
+reference = " ".join(f"$var_{index} ${{var_{index}}} ${{var_${{i}}}}" for index in range(namespace.variables))
+header = len(lines)
+lines.extend(f"eval -s output \"{reference}\"" for _ in range(namespace.lines))
+
+with tempfile.TemporaryDirectory() as directory:
+    script = Path(directory) / "benchmark.ff"
+    script.write_text("\n".join(lines), encoding="utf-8")
+
+    start = time.perf_counter()
+    subprocess.run([namespace.shell], input=f"{script.with_suffix('')}\nexit\n".encode("utf-8"), stdout=subprocess.DEVNULL, check=True)
+    elapsed = time.perf_counter() - start
+
+print(f"Resolved {namespace.lines} lines ({3 * namespace.variables} substitutions each) in {elapsed:.3f}s")
+print(f"{namespace.lines / elapsed:.1f} lines/s (including {header} setup lines and process startup)")
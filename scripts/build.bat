@@ -8,7 +8,7 @@ echo Got root of repository: %root%
 
 if not exist %root%\build mkdir %root%\build
 set before=-O3 -Wall -I %root%\extern\regex\include -I %root%\src\include -std=c++17
-set after=-l pathcch -l wininet
+set after=-l advapi32 -l pathcch -l psapi -l wininet
 
 if "%1"=="debug" (
     set before=-D DEBUG -g %before%
@@ -36,6 +36,10 @@ echo Building %root%\src\shell.cpp to %root%\build\shell.%extension%
 g++ %before% %root%\src\shell.cpp %after% -o %root%\build\shell.%extension%
 if %errorlevel% neq 0 exit /b %errorlevel%
 
+echo Building %root%\src\benchmark.cpp to %root%\build\benchmark.%extension%
+g++ %before% %root%\src\benchmark.cpp %after% -o %root%\build\benchmark.%extension%
+if %errorlevel% neq 0 exit /b %errorlevel%
+
 for %%f in (%root%\src\external\*) do (
     if "%%~xf" == ".cpp" (
         echo Building %%f to %root%\build\%%~nf.%extension%
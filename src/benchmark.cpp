@@ -0,0 +1,462 @@
+#define LITE_SHELL_COUNT_ALLOCATIONS
+#include "initialize.hpp"
+
+/**
+ * Count the allocations of the current thread, see `utils::allocations`. Only the benchmark defines
+ * `LITE_SHELL_COUNT_ALLOCATIONS`, the other executables keep the allocator of the C++ library.
+ *
+ * The replacements are backed by `malloc` and `free`, `operator new[]` is counted through `operator new`. The
+ * `std::align_val_t` forms are not replaced: over-aligned allocations are not counted.
+ *
+ * The replacements are never inlined: GCC pairs each call to `operator new` with a call to `operator delete`,
+ * and would otherwise report inlined `malloc` calls as mismatched with the library `operator delete`.
+ */
+[[gnu::noinline]] void *operator new(std::size_t size)
+{
+    utils::_allocations++;
+    while (true)
+    {
+        // malloc(0) may return a null pointer
+        auto pointer = std::malloc(size == 0 ? 1 : size);
+        if (pointer != nullptr)
+        {
+            return pointer;
+        }
+
+        auto handler = std::get_new_handler();
+        if (handler == nullptr)
+        {
+            throw std::bad_alloc();
+        }
+
+        handler();
+    }
+}
+
+[[gnu::noinline]] void *operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+
+[[gnu::noinline]] void operator delete(void *pointer) noexcept
+{
+    std::free(pointer);
+}
+
+[[gnu::noinline]] void operator delete(void *pointer, std::size_t) noexcept
+{
+    std::free(pointer);
+}
+
+[[gnu::noinline]] void operator delete[](void *pointer) noexcept
+{
+    std::free(pointer);
+}
+
+[[gnu::noinline]] void operator delete[](void *pointer, std::size_t) noexcept
+{
+    std::free(pointer);
+}
+
+// Micro-benchmarks of the interpreter core, plus the throughput of whole scripts.
+//
+// Usage: benchmark [--json] [--filter <substring>] [--repeat <count>]
+//
+// Each benchmark is calibrated to run for at least 100ms per repetition, the median, minimum and maximum time per
+// operation over all repetitions are reported, along with the heap allocations per operation. With --json, each result is printed as a JSON object on its own line
+// so the output can be stored and compared between builds.
+
+struct Benchmark
+{
+    const char *name;
+
+    /** @brief Execute one operation, the returned value is accumulated so that the work cannot be optimized out */
+    std::function<std::size_t()> run;
+};
+
+struct Result
+{
+    std::string name;
+    std::size_t iterations;
+    std::vector<double> samples;
+    double allocations;
+
+    double median() const
+    {
+        auto sorted = samples;
+        std::sort(sorted.begin(), sorted.end());
+        return sorted[sorted.size() / 2];
+    }
+};
+
+volatile std::size_t sink = 0;
+
+Result measure(const Benchmark &benchmark, const std::size_t repeat)
+{
+    typedef std::chrono::steady_clock clock;
+    const auto minimum = std::chrono::milliseconds(100);
+
+    auto time = [&benchmark](const std::size_t iterations)
+    {
+        std::size_t total = 0;
+        auto start = clock::now();
+        for (std::size_t i = 0; i < iterations; i++)
+        {
+            total += benchmark.run();
+        }
+
+        auto elapsed = clock::now() - start;
+        sink = sink + total;
+        return elapsed;
+    };
+
+    std::size_t iterations = 1;
+    while (time(iterations) < minimum && iterations < (1u << 30))
+    {
+        iterations *= 2;
+    }
+
+    Result result = {benchmark.name, iterations, {}, 0.0};
+    auto allocations = utils::allocations();
+    for (std::size_t i = 0; i < repeat; i++)
+    {
+        auto elapsed = std::chrono::duration<double, std::nano>(time(iterations)).count();
+        result.samples.push_back(elapsed / static_cast<double>(iterations));
+    }
+
+    result.allocations = static_cast<double>(utils::allocations() - allocations) / static_cast<double>(iterations * repeat);
+
+    return result;
+}
+
+/** @brief Execute a script to completion with the commands of the shell, returning its output */
+std::string execute(liteshell::Client *client, const std::shared_ptr<const liteshell::Script> &script)
+{
+    std::stringbuf output;
+    utils::StandardStreams streams(nullptr, &output, &output);
+
+    auto stream = client->get_stream();
+    stream->clear();
+    stream->write(script, true);
+    while (!stream->finished())
+    {
+        client->process_instruction(
+            *stream->next(
+                []() {}, 0));
+    }
+
+    return output.str();
+}
+
+/** @brief Compile the lines of a batch script, ending with the label `:EOF` like the files read by the shell */
+std::shared_ptr<const liteshell::Script> compile(liteshell::Client *client, const std::vector<std::string> &lines)
+{
+    auto copy = lines;
+    copy.push_back(liteshell::InputStream::STREAM_EOF);
+    return client->compile(copy.begin(), copy.end());
+}
+
+/** @brief An insertion sort in the style of tests/sort.ff, with the input stored in the script */
+std::vector<std::string> sort_script(const std::size_t size)
+{
+    std::mt19937 random(42);
+    std::string array;
+    for (std::size_t i = 0; i < size; i++)
+    {
+        array += std::to_string(static_cast<int>(random() % 1000) - 500) + " ";
+    }
+
+    return {
+        "@OFF",
+        "eval -s arr \"" + array + "\"",
+        "eval -s i 0",
+        "for e \"$arr\" -t split",
+        "    eval $e -ms arr_$i",
+        "    eval -ms i \"$i + 1\"",
+        "endfor",
+        "eval -s n $i",
+        "for --type range index 1 $n",
+        "    for --type range i $index 0",
+        "        eval -ms j \"$i - 1\"",
+        "        if -m ${arr_$j} > ${arr_$i}",
+        "            eval -s temp ${arr_$j}",
+        "            eval -s arr_$j ${arr_$i}",
+        "            eval -s arr_$i $temp",
+        "        else",
+        "            jump :break",
+        "        endif",
+        "    endfor",
+        "    :break",
+        "endfor",
+        "echoln \"sorted\"",
+    };
+}
+
+/** @brief The same insertion sort, with a native array instead of one variable per element */
+std::vector<std::string> sort_array_script(const std::size_t size)
+{
+    std::mt19937 random(42);
+    std::string array;
+    for (std::size_t i = 0; i < size; i++)
+    {
+        array += std::to_string(static_cast<int>(random() % 1000) - 500) + " ";
+    }
+
+    return {
+        "@OFF",
+        "array arr " + array,
+        "eval -s n ${#arr}",
+        "for --type range index 1 $n",
+        "    for --type range i $index 0",
+        "        eval -ms j \"$i - 1\"",
+        "        if -m ${arr[$j]} > ${arr[$i]}",
+        "            eval -s temp ${arr[$j]}",
+        "            eval -s arr[$j] ${arr[$i]}",
+        "            eval -s arr[$i] $temp",
+        "        else",
+        "            jump :break",
+        "        endif",
+        "    endfor",
+        "    :break",
+        "endfor",
+        "echoln \"sorted\"",
+    };
+}
+
+/** @brief A trial division in the style of tests/prime.ff, with the input stored in the script */
+std::vector<std::string> prime_script(const long long value)
+{
+    return {
+        "@OFF",
+        "eval -s n " + std::to_string(value),
+        "eval -s div 2",
+        ":loop",
+        "if -m \"$div * $div\" > $n",
+        "    jump :is_prime",
+        "endif",
+        "if -m \"$n % $div\" == 0",
+        "    echoln \"$n is not a prime\"",
+        "    jump :EOF",
+        "endif",
+        "eval -ms div \"$div + 1\"",
+        "jump :loop",
+        ":is_prime",
+        "echoln \"$n is a prime\"",
+        "jump :EOF",
+    };
+}
+
+std::vector<Benchmark> get_benchmarks(const std::shared_ptr<liteshell::Client> &client_ptr)
+{
+    auto client = client_ptr.get();
+    auto environment = client->get_environment();
+    std::string reference;
+    for (int i = 0; i < 50; i++)
+    {
+        environment->set_value(utils::format("var_%d", i), utils::format("value_%d", i));
+        reference += utils::format("$var_%d ${var_%d} ", i, i);
+    }
+
+    std::string line = "cat \"C:\\Program Files\\some file.txt\" --option \"quoted value\" -x 1 -y 2 plain tokens here";
+    std::string command = "eval -ms result \"(12345 + 3) * 678 - 7 % 4\"";
+
+    auto names = std::make_shared<std::vector<std::string>>();
+    std::mt19937 random(42);
+    for (int i = 0; i < 1000; i++)
+    {
+        std::string name;
+        for (auto length = 4 + random() % 8; length > 0; length--)
+        {
+            name += static_cast<char>('a' + random() % 26);
+        }
+
+        names->push_back(name);
+    }
+
+    auto table = std::make_shared<utils::Table>("Name", "Type", "Size");
+    for (int i = 0; i < 1000; i++)
+    {
+        table->add_row(utils::format("file_%d.txt", i), i % 7 == 0 ? "DIR" : "FILE", utils::memory_size(i * 1234.5L));
+    }
+
+    std::vector<std::string> stream_lines = {"@OFF", ":start"};
+    for (int i = 0; i < 100; i++)
+    {
+        stream_lines.push_back(utils::format("eval -s x_%d %d", i, i));
+    }
+
+    auto stream_script = client->compile(stream_lines.begin(), stream_lines.end());
+    auto sort = compile(client, sort_script(200));
+    auto sort_array = compile(client, sort_array_script(200));
+    auto prime = compile(client, prime_script(1000003));
+
+    return {
+        {"environment.resolve",
+         [environment, reference]()
+         {
+             return environment->resolve(reference).size();
+         }},
+        {"environment.eval_ll",
+         [environment]()
+         {
+             return static_cast<std::size_t>(environment->eval_ll("(12345 + 3) * 678 - 7 % 4"));
+         }},
+        {"environment.snapshot_scope",
+         [environment]()
+         {
+             // An isolated scope on top of the 50 variables above, which only copies the variables it assigns
+             liteshell::Environment scope(environment->snapshot());
+             scope.set_value("var_0", "changed");
+             scope.set_value("local", "value");
+             return scope.resolve("$var_0 $var_1 $local").size();
+         }},
+        {"utils.split",
+         [line]()
+         {
+             return utils::split(line).size();
+         }},
+        {"utils.utf_convert",
+         [line]()
+         {
+             thread_local std::wstring wide;
+             thread_local std::string narrow;
+             utils::utf_convert(line, wide);
+             utils::utf_convert(wide, narrow);
+             return narrow.size();
+         }},
+        {"context.get_context",
+         [client_ptr, command]()
+         {
+             return liteshell::Context::get_context(client_ptr, command).tokens.size();
+         }},
+        {"input_stream.write_getline_jump",
+         [stream_script]()
+         {
+             liteshell::InputStream stream;
+             stream.write(stream_script, false);
+
+             std::size_t total = 0;
+             for (int pass = 0; pass < 2; pass++)
+             {
+                 for (std::size_t i = 1; i < stream_script->size(); i++)
+                 {
+                     total += stream.getline([]() {}, liteshell::InputStream::FORCE_STREAM).size();
+                 }
+
+                 stream.jump(":start");
+             }
+
+             return total;
+         }},
+        {"utils.fuzzy_search",
+         [names]()
+         {
+             return utils::fuzzy_search(names->begin(), names->end(), std::string("qwertyui"))->size();
+         }},
+        {"table.display",
+         [table]()
+         {
+             return table->display().size();
+         }},
+        {"script.sort_200",
+         [client, sort]()
+         {
+             auto output = execute(client, sort);
+             if (output.find("sorted") == std::string::npos)
+             {
+                 throw std::runtime_error("The sort script did not complete: " + output);
+             }
+
+             return output.size();
+         }},
+        {"script.sort_array_200",
+         [client, sort_array]()
+         {
+             auto output = execute(client, sort_array);
+             if (output.find("sorted") == std::string::npos)
+             {
+                 throw std::runtime_error("The sort script did not complete: " + output);
+             }
+
+             return output.size();
+         }},
+        {"script.prime_1000003",
+         [client, prime]()
+         {
+             auto output = execute(client, prime);
+             if (output.find("is a prime") == std::string::npos)
+             {
+                 throw std::runtime_error("The prime script did not complete: " + output);
+             }
+
+             return output.size();
+         }},
+    };
+}
+
+int main(int argc, const char *argv[])
+{
+    bool json = false;
+    std::string filter;
+    std::size_t repeat = 5;
+    for (int i = 1; i < argc; i++)
+    {
+        std::string argument = argv[i];
+        if (argument == "--json")
+        {
+            json = true;
+        }
+        else if (argument == "--filter" && i + 1 < argc)
+        {
+            filter = argv[++i];
+        }
+        else if (argument == "--repeat" && i + 1 < argc)
+        {
+            repeat = std::max<std::size_t>(1, std::stoul(argv[++i]));
+        }
+        else
+        {
+            std::cerr << "Usage: " << argv[0] << " [--json] [--filter <substring>] [--repeat <count>]" << std::endl;
+            return 1;
+        }
+    }
+
+    auto client_ptr = liteshell::Client::get_instance();
+    initialize(client_ptr.get());
+
+    utils::Table displayer("Benchmark", "Iterations", "Median (ns/op)", "Min (ns/op)", "Max (ns/op)", "Allocations/op");
+    for (auto &benchmark : get_benchmarks(client_ptr))
+    {
+        if (std::string(benchmark.name).find(filter) == std::string::npos)
+        {
+            continue;
+        }
+
+        auto result = measure(benchmark, repeat);
+        auto [min, max] = std::minmax_element(result.samples.begin(), result.samples.end());
+        if (json)
+        {
+            std::cout << utils::format(
+                             "{\"name\":\"%s\",\"iterations\":%zu,\"repeat\":%zu,\"median_ns\":%.1f,\"min_ns\":%.1f,\"max_ns\":%.1f,\"allocations\":%.2f}",
+                             result.name.c_str(), result.iterations, repeat, result.median(), *min, *max, result.allocations)
+                      << std::endl;
+        }
+        else
+        {
+            displayer.add_row(
+                result.name,
+                std::to_string(result.iterations),
+                utils::format("%.1f", result.median()),
+                utils::format("%.1f", *min),
+                utils::format("%.1f", *max),
+                utils::format("%.2f", result.allocations));
+        }
+    }
+
+    if (!json)
+    {
+        std::cout << displayer.display();
+    }
+
+    return 0;
+}
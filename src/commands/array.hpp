@@ -0,0 +1,54 @@
+#pragma once
+
+#include <all.hpp>
+
+class ArrayCommand : public liteshell::BaseCommand
+{
+public:
+    static inline const liteshell::BaseCommand::Metadata metadata = {"array", {}};
+
+    ArrayCommand()
+        : liteshell::BaseCommand(
+              metadata,
+              "Assign an array to an environment variable",
+              "Examples: \"array arr 3 1 2\", \"array arr $input\", \"array arr -a 4 5\".\n"
+              "Elements are read with \"${arr[0]}\" (negative indices count from the end), the length with \"${#arr}\",\n"
+              "all elements with \"${arr[@]}\", a slice with \"${arr[1:3]}\" and the indices with \"${!arr[@]}\".\n"
+              "An element is assigned with \"eval -s arr[0] value\", assigning the index \"${#arr}\" appends it.",
+              liteshell::CommandConstraint(
+                  "name", "The name of the array", true,
+                  "values", "The elements of the array", false,
+                  true)
+                  .add_option("-a", "--append", "Append the elements to the array instead of replacing it", {}, false))
+    {
+    }
+
+    DWORD run(const liteshell::Context &context)
+    {
+        auto name = context.get("name");
+        if (!utils::is_valid_variable(name))
+        {
+            throw std::invalid_argument(utils::format("Invalid variable name \"%s\"", name.c_str()));
+        }
+
+        std::vector<std::string> values;
+        auto iter = context.values.find("values");
+        if (iter != context.values.end())
+        {
+            values = iter->second;
+        }
+
+        auto environment = context.client->get_environment();
+        auto handle = environment->intern(name);
+        if (context.present.count("-a"))
+        {
+            environment->append(handle, values);
+        }
+        else
+        {
+            environment->set_array(handle, std::move(values));
+        }
+
+        return 0;
+    }
+};
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <all.hpp>
+
+class CallCommand : public liteshell::BaseCommand
+{
+public:
+    static inline const liteshell::BaseCommand::Metadata metadata = {"call", {}};
+
+    CallCommand()
+        : liteshell::BaseCommand(
+              metadata,
+              "Call a subroutine of the current batch script",
+              "Examples: \"call :add 1 2\", \"call add 1 2\".\n"
+              "The subroutine starts after the label, the arguments are available as $1, $2, ... with their count in\n"
+              "$argc and the label in $0. These variables are restored when the subroutine returns, either with\n"
+              "\"return\" or at the end of the script. Execution then continues after the \"call\" line.",
+              liteshell::CommandConstraint(
+                  "label", "The label of the subroutine", true,
+                  "args", "The arguments of the subroutine", false,
+                  true))
+    {
+    }
+
+    DWORD run(const liteshell::Context &context)
+    {
+        auto label = context.get("label");
+        if (label[0] != ':')
+        {
+            label = ':' + label;
+        }
+
+        std::vector<std::string> arguments;
+        auto iter = context.values.find("args");
+        if (iter != context.values.end())
+        {
+            arguments = iter->second;
+        }
+
+        auto environment = context.client->get_environment();
+        auto scope = std::make_shared<liteshell::Environment::Scope>(environment);
+        scope->set_value(environment->intern("0"), label);
+        scope->set_value(environment->intern("argc"), std::to_string(arguments.size()));
+        for (std::size_t i = 0; i < arguments.size(); i++)
+        {
+            scope->set_value(environment->intern(std::to_string(i + 1)), arguments[i]);
+        }
+
+        // Hide the remaining arguments of the caller
+        for (auto i = arguments.size() + 1; !environment->get_view(std::to_string(i)).empty(); i++)
+        {
+            scope->unset(environment->intern(std::to_string(i)));
+        }
+
+        context.client->get_stream()->call(
+            label,
+            [scope]()
+            {
+                scope->exit();
+            });
+
+        return 0;
+    }
+};
@@ -4,26 +4,19 @@
 
 class CatCommand : public liteshell::BaseCommand
 {
-public:
-    CatCommand()
-        : liteshell::BaseCommand(
-              "cat",
-              "Read a file",
-              "Displays the content of a text file.",
-              {"type"},
-              liteshell::CommandConstraint("file", "The file to read", true))
-    {
-    }
+private:
+    /** @brief The size of each of the 2 read buffers when the file size is unknown or large */
+    static const DWORD MAX_BUFFER_SIZE = 1 << 20;
 
-    DWORD run(const liteshell::Context &context)
+    static HANDLE _open(const std::string &path, const DWORD flags)
     {
         auto file = CreateFileW(
-            utils::utf_convert(context.get("file")).c_str(),
+            utils::utf_convert(path).c_str(),
             GENERIC_READ,
             FILE_SHARE_READ,
             NULL,
             OPEN_EXISTING,
-            FILE_ATTRIBUTE_NORMAL,
+            flags,
             NULL);
 
         if (file == INVALID_HANDLE_VALUE)
@@ -36,26 +29,168 @@ public:
             throw std::runtime_error(utils::last_error("Error when opening file"));
         }
 
+        return file;
+    }
+
+    /** @brief Write to `output`, or to `std::cout` if `output` is `NULL` */
+    static void _write(const HANDLE output, const char *data, std::size_t size)
+    {
+        if (output == NULL)
+        {
+            std::cout.write(data, size);
+            return;
+        }
+
+        while (size > 0)
+        {
+            DWORD written;
+            if (!WriteFile(output, data, std::min<std::size_t>(size, MAX_BUFFER_SIZE), &written, NULL))
+            {
+                throw std::runtime_error(utils::last_error("Error when writing to stdout"));
+            }
+
+            data += written;
+            size -= written;
+        }
+    }
+
+    /** @brief Copy a file to `output`, reading the next chunk while the current one is being written */
+    static void _copy(const HANDLE file, const HANDLE output)
+    {
+        // Small files only need a buffer as large as themselves
+        DWORD buffer_size = MAX_BUFFER_SIZE;
+        LARGE_INTEGER file_size;
+        if (GetFileSizeEx(file, &file_size) && file_size.QuadPart < static_cast<LONGLONG>(MAX_BUFFER_SIZE))
+        {
+            buffer_size = std::max<DWORD>(file_size.QuadPart, LITE_SHELL_BUFFER_SIZE);
+        }
+
+        std::vector<char> buffers[2] = {std::vector<char>(buffer_size), std::vector<char>(buffer_size)};
+        OVERLAPPED overlapped[2];
+        HANDLE events[2] = {CreateEventW(NULL, TRUE, FALSE, NULL), CreateEventW(NULL, TRUE, FALSE, NULL)};
+
+        // The index of the buffer being filled by a pending read, if any
+        std::optional<int> pending;
         auto _finalize = utils::Finalize(
-            [&file]()
+            [&file, &overlapped, &events, &pending]()
             {
-                CloseHandle(file);
+                if (pending.has_value())
+                {
+                    DWORD read;
+                    CancelIo(file);
+                    GetOverlappedResult(file, &overlapped[*pending], &read, TRUE);
+                }
+
+                for (auto event : events)
+                {
+                    if (event != NULL)
+                    {
+                        CloseHandle(event);
+                    }
+                }
             });
 
-        char buffer[LITE_SHELL_BUFFER_SIZE];
-        ZeroMemory(buffer, LITE_SHELL_BUFFER_SIZE);
-        DWORD read = LITE_SHELL_BUFFER_SIZE;
-        while (read == LITE_SHELL_BUFFER_SIZE)
+        if (events[0] == NULL || events[1] == NULL)
+        {
+            throw std::runtime_error(utils::last_error("Error when creating event"));
+        }
+
+        ULONGLONG offset = 0;
+        auto start_read = [&](const int index)
+        {
+            ZeroMemory(&overlapped[index], sizeof(OVERLAPPED));
+            overlapped[index].Offset = offset & 0xFFFFFFFF;
+            overlapped[index].OffsetHigh = offset >> 32;
+            overlapped[index].hEvent = events[index];
+
+            if (!ReadFile(file, buffers[index].data(), buffer_size, NULL, &overlapped[index]))
+            {
+                auto error = GetLastError();
+                if (error == ERROR_HANDLE_EOF)
+                {
+                    return;
+                }
+
+                if (error != ERROR_IO_PENDING)
+                {
+                    throw std::runtime_error(utils::last_error("Error when reading file"));
+                }
+            }
+
+            pending = index;
+        };
+
+        start_read(0);
+        while (pending.has_value())
         {
-            if (!ReadFile(file, buffer, LITE_SHELL_BUFFER_SIZE, &read, NULL))
+            auto current = *pending;
+
+            DWORD read = 0;
+            auto success = GetOverlappedResult(file, &overlapped[current], &read, TRUE);
+            pending = std::nullopt;
+            if (!success)
             {
+                if (GetLastError() == ERROR_HANDLE_EOF)
+                {
+                    break;
+                }
+
                 throw std::runtime_error(utils::last_error("Error when reading file"));
             }
 
-            std::cout << std::string(buffer, buffer + read) << std::flush;
+            if (read == 0)
+            {
+                break;
+            }
+
+            offset += read;
+            start_read(1 - current);
+            _write(output, buffers[current].data(), read);
+        }
+    }
+
+public:
+    static inline const liteshell::BaseCommand::Metadata metadata = {"cat", {"type"}};
+
+    CatCommand()
+        : liteshell::BaseCommand(
+              metadata,
+              "Read a file",
+              "Displays the content of a text file.\n"
+              "The file is read in large chunks, reading the next chunk while the current one is written to stdout.",
+              liteshell::CommandConstraint("file", "The file to read", true)
+                  .add_option("--mmap", "Map the file into memory and write it to stdout at once instead of reading it", false))
+    {
+    }
+
+    DWORD run(const liteshell::Context &context)
+    {
+        auto path = context.get("file");
+
+        // Direct writes to the stdout handle bypass std::cout, flush what it has buffered first. Inside a pipeline,
+        // the output of this thread goes through std::cout instead.
+        std::cout << std::flush;
+        auto output = utils::StandardStreams::is_output_redirected() ? NULL : GetStdHandle(STD_OUTPUT_HANDLE);
+
+        if (context.present.count("--mmap"))
+        {
+            utils::MappedFile file(_open(path, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN));
+            auto view = file.view();
+            _write(output, view.data(), view.size());
+        }
+        else
+        {
+            auto file = _open(path, FILE_FLAG_OVERLAPPED | FILE_FLAG_SEQUENTIAL_SCAN);
+            auto _finalize = utils::Finalize(
+                [&file]()
+                {
+                    CloseHandle(file);
+                });
+
+            _copy(file, output);
         }
 
-        std::cout << std::endl;
+        std::cout << '\n';
 
         return 0;
     }
@@ -5,9 +5,11 @@
 class CdCommand : public liteshell::BaseCommand
 {
 public:
+    static inline const liteshell::BaseCommand::Metadata metadata = {"cd", {}};
+
     CdCommand()
         : liteshell::BaseCommand(
-              "cd",
+              metadata,
               "Get or set the working directory",
               "Display the name of or change the current directory.\n\n"
               "Call this command with no argument to get the working directory (similar to Unix shell's \"pwd\").\n"
@@ -19,17 +21,18 @@ public:
 
     DWORD run(const liteshell::Context &context)
     {
-        try
+        auto target = context.try_get("path");
+        if (!target.has_value())
+        {
+            std::cout << utils::get_working_directory() << '\n';
+        }
+        else if (SetCurrentDirectoryW(utils::utf_convert(*target).c_str()))
         {
-            auto target = context.get("path");
-            if (!SetCurrentDirectoryW(utils::utf_convert(target).c_str()))
-            {
-                throw std::runtime_error(utils::last_error(utils::format("Error when changing directory to \"%s\"", target.c_str())));
-            }
+            context.client->update_working_directory();
         }
-        catch (liteshell::ArgumentMissingError &)
+        else
         {
-            std::cout << utils::get_working_directory() << std::endl;
+            throw std::runtime_error(utils::last_error(utils::format("Error when changing directory to \"%s\"", target->c_str())));
         }
 
         return 0;
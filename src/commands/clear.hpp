@@ -5,17 +5,19 @@
 class ClearCommand : public liteshell::BaseCommand
 {
 public:
+    static inline const liteshell::BaseCommand::Metadata metadata = {"clear", {"cls"}};
+
     ClearCommand()
         : liteshell::BaseCommand(
-              "clear",
+              metadata,
               "Clear the console screen",
               "",
-              {"cls"},
               liteshell::CommandConstraint()) {}
 
     DWORD run(const liteshell::Context &context)
     {
         // Example 2 in https://learn.microsoft.com/en-us/windows/console/clearing-the-screen
+        std::cout << std::flush;
 
         auto hConsole = GetStdHandle(STD_OUTPUT_HANDLE);
         CONSOLE_SCREEN_BUFFER_INFO csbi;
@@ -5,9 +5,11 @@
 class ColorCommand : public liteshell::BaseCommand
 {
 public:
+    static inline const liteshell::BaseCommand::Metadata metadata = {"color", {}};
+
     ColorCommand()
         : liteshell::BaseCommand(
-              "color",
+              metadata,
               "Change the text color in the shell",
               "Specify a color in hex format to change the text color",
               liteshell::CommandConstraint("color", "The color to set", true, false)) {}
@@ -17,7 +19,7 @@ public:
         std::string color = context.get("color");
         utils::setColor(color);
 
-        std::cout << "Color changed to " << color << std::endl;
+        std::cout << "Color changed to " << color << '\n';
         return 0;
     }
 };
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <all.hpp>
+
+class CompleteCommand : public liteshell::BaseCommand
+{
+public:
+    static inline const liteshell::BaseCommand::Metadata metadata = {"complete", {}};
+
+    CompleteCommand()
+        : liteshell::BaseCommand(
+              metadata,
+              "Display the completions of the last word of a partial command line",
+              "These are the candidates of the Tab key in the console: the names of variables for a word starting with $,\n"
+              "built-in commands and executables in PATH for the first word of a command, and file paths.\n"
+              "Use $$ for a literal $ in the line.",
+              liteshell::CommandConstraint("line", "The partial command line", true)
+                  .add_option(
+                      "-t", "--timeout",
+                      "The maximum time to wait for the listing of each directory, in milliseconds (default: 100)",
+                      liteshell::PositionalArgument("milliseconds", "The timeout in milliseconds", false, true))) {}
+
+    DWORD run(const liteshell::Context &context)
+    {
+        auto timeout = std::chrono::milliseconds(100);
+        if (context.present.count("-t"))
+        {
+            timeout = std::chrono::milliseconds(std::stoull(context.get("-t milliseconds")));
+        }
+
+        auto completion = context.client->complete(context.get("line"), timeout);
+        for (auto &candidate : completion.candidates)
+        {
+            std::cout << candidate << '\n';
+        }
+
+        return 0;
+    }
+};
@@ -0,0 +1,144 @@
+#pragma once
+
+#include <all.hpp>
+
+class CpCommand : public liteshell::BaseCommand
+{
+private:
+    /** @brief The cluster size of the volume of a path if it supports block cloning, otherwise 0 */
+    static DWORD _clone_cluster(const std::wstring &path)
+    {
+        wchar_t root[MAX_PATH];
+        DWORD flags = 0, sectors = 0, bytes = 0, free_clusters, total_clusters;
+        if (!GetVolumePathNameW(path.c_str(), root, MAX_PATH) ||
+            !GetVolumeInformationW(root, NULL, 0, NULL, NULL, &flags, NULL, 0) ||
+            !(flags & FILE_SUPPORTS_BLOCK_REFCOUNTING) ||
+            !GetDiskFreeSpaceW(root, &sectors, &bytes, &free_clusters, &total_clusters))
+        {
+            return 0;
+        }
+
+        return sectors * bytes;
+    }
+
+    /** @brief Whether `path` is `directory` or inside it, both being absolute */
+    static bool _is_inside(const std::string &path, const std::string &directory)
+    {
+        if (path.size() < directory.size() || (path.size() > directory.size() && !utils::is_path_separator(path[directory.size()])))
+        {
+            return false;
+        }
+
+        return std::equal(
+            directory.begin(), directory.end(), path.begin(),
+            [](char first, char second)
+            {
+                return std::tolower(static_cast<unsigned char>(first)) == std::tolower(static_cast<unsigned char>(second));
+            });
+    }
+
+public:
+    static inline const liteshell::BaseCommand::Metadata metadata = {"cp", {"copy"}};
+
+    CpCommand()
+        : liteshell::BaseCommand(
+              metadata,
+              "Copy one or many files/directories",
+              "If the source is a directory, copy it recursively. The source may contain wildcards, in which case the\n"
+              "destination must be an existing directory. Directory trees are copied by a pool of worker threads and\n"
+              "files of 64MB or more bypass the file cache. With --clone, files on a volume supporting block cloning\n"
+              "(ReFS) share their clusters with the copies instead of being copied. The progress is displayed every\n"
+              "second, followed by the number of copied items. The errorlevel is set to the number of items which\n"
+              "could not be copied.",
+              liteshell::CommandConstraint(
+                  "source", "The file or directory to copy", true,
+                  "destination", "The path of the copy, or an existing directory to copy into", true)
+                  .add_option("-f", "--force", "Replace existing files", {}, false)
+                  .add_option("-q", "--quiet", "Only display the number of copied items", {}, false)
+                  .add_option("--clone", "Clone the files instead of copying them where the file system supports it", {}, false)
+                  .add_option(
+                      "-j", "--jobs",
+                      "The number of worker threads (default: the number of processors)",
+                      liteshell::PositionalArgument("workers", "The number of workers", false, true))) {}
+
+    DWORD run(const liteshell::Context &context)
+    {
+        auto source = context.get("source"), destination = context.get("destination");
+        auto quiet = context.present.count("-q") == 1;
+
+        std::size_t workers = std::max(1u, std::thread::hardware_concurrency());
+        if (context.present.count("-j"))
+        {
+            workers = std::stoul(context.get("-j workers"));
+            if (workers == 0)
+            {
+                throw std::invalid_argument("The number of workers must be positive");
+            }
+        }
+
+        utils::FindFiles matches(source);
+        if (matches.empty())
+        {
+            throw std::invalid_argument("The specified source does not exist");
+        }
+
+        // The matches are names, relative to the directory of the pattern
+        auto separator = source.find_last_of("\\/");
+        auto parent = separator == std::string::npos ? std::string() : source.substr(0, separator + 1);
+
+        auto attributes = GetFileAttributesW(utils::utf_convert(destination).c_str());
+        auto into = attributes != INVALID_FILE_ATTRIBUTES && (attributes & FILE_ATTRIBUTE_DIRECTORY);
+        if (!into && source.find_first_of("*?") != std::string::npos)
+        {
+            throw std::invalid_argument("The destination must be an existing directory when the source contains wildcards");
+        }
+
+        auto absolute = utils::get_absolute_path(destination);
+        utils::ParallelCopier copier(
+            context.present.count("-f"),
+            context.present.count("--clone") ? _clone_cluster(utils::utf_convert(absolute)) : 0,
+            workers);
+
+        for (auto &data : matches)
+        {
+            if (wcscmp(data.cFileName, L".") == 0 || wcscmp(data.cFileName, L"..") == 0)
+            {
+                continue;
+            }
+
+            auto name = utils::utf_convert(data.cFileName);
+            auto path = parent + name;
+            auto target = into ? utils::join(destination, name) : destination;
+            if ((data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) && _is_inside(utils::get_absolute_path(target), utils::get_absolute_path(path)))
+            {
+                std::cerr << utils::format("Warning: Cannot copy \"%s\" into itself", path.c_str()) << std::endl;
+                continue;
+            }
+
+            copier.add(
+                utils::utf_convert(path),
+                utils::utf_convert(target),
+                data.dwFileAttributes,
+                (static_cast<unsigned long long>(data.nFileSizeHigh) << 32) | data.nFileSizeLow);
+        }
+
+        auto statistics = copier.wait(
+            [&quiet](const utils::ParallelCopier::Statistics &statistics)
+            {
+                if (!quiet)
+                {
+                    std::cout << utils::format("Copied %zu file(s) and %zu folder(s), %s...", statistics.files, statistics.directories, utils::memory_size(statistics.bytes).c_str()) << std::endl;
+                }
+            },
+            std::chrono::seconds(1));
+
+        auto errors = copier.errors();
+        for (auto &error : errors)
+        {
+            std::cerr << error << '\n';
+        }
+
+        std::cout << utils::format("Copied %zu file(s) and %zu folder(s), %s", statistics.files, statistics.directories, utils::memory_size(statistics.bytes).c_str()) << '\n';
+        return errors.size();
+    }
+};
@@ -7,9 +7,11 @@ const char *__week_days[] = {"Sunday", "Monday", "Tuesday", "Wednesday", "Thursd
 class DateCommand : public liteshell::BaseCommand
 {
 public:
+    static inline const liteshell::BaseCommand::Metadata metadata = {"date", {}};
+
     DateCommand()
         : liteshell::BaseCommand(
-              "date",
+              metadata,
               "Retrieves the current system date and time",
               "",
               liteshell::CommandConstraint()) {}
@@ -21,12 +23,12 @@ public:
         GetSystemTime(&time);
         std::cout << "System time (UTC): "
                   << __week_days[time.wDayOfWeek] << " " << time.wDay << "/" << time.wMonth << "/" << time.wYear << " "
-                  << time.wHour << ":" << time.wMinute << ":" << time.wSecond << std::endl;
+                  << time.wHour << ":" << time.wMinute << ":" << time.wSecond << '\n';
 
         GetLocalTime(&time);
         std::cout << "Local time: "
                   << __week_days[time.wDayOfWeek] << " " << time.wDay << "/" << time.wMonth << "/" << time.wYear << " "
-                  << time.wHour << ":" << time.wMinute << ":" << time.wSecond << std::endl;
+                  << time.wHour << ":" << time.wMinute << ":" << time.wSecond << '\n';
 
         return 0;
     }
@@ -5,9 +5,11 @@
 class EchoCommand : public liteshell::BaseCommand
 {
 public:
+    static inline const liteshell::BaseCommand::Metadata metadata = {"echo", {}};
+
     EchoCommand()
         : liteshell::BaseCommand(
-              "echo",
+              metadata,
               "Print to stdout but do not add a newline like \"echoln\"",
               "",
               liteshell::CommandConstraint("text", "The text to print to stdout", true, true)) {}
@@ -15,7 +17,7 @@ public:
     DWORD run(const liteshell::Context &context)
     {
         auto argument = context.values.at("text");
-        std::cout << utils::join(argument.begin(), argument.end(), " ") << std::flush;
+        std::cout << utils::join(argument.begin(), argument.end(), " ");
         return 0;
     }
 };
@@ -5,9 +5,11 @@
 class EcholnCommand : public liteshell::BaseCommand
 {
 public:
+    static inline const liteshell::BaseCommand::Metadata metadata = {"echoln", {}};
+
     EcholnCommand()
         : liteshell::BaseCommand(
-              "echoln",
+              metadata,
               "Print to stdout and add a newline at the end",
               "",
               liteshell::CommandConstraint("text", "The text to print to stdout", true, true)) {}
@@ -15,7 +17,7 @@ public:
     DWORD run(const liteshell::Context &context)
     {
         auto argument = context.values.at("text");
-        std::cout << utils::join(argument.begin(), argument.end(), " ") << std::endl;
+        std::cout << utils::join(argument.begin(), argument.end(), " ") << '\n';
         return 0;
     }
 };
@@ -5,9 +5,11 @@
 class EnvCommand : public liteshell::BaseCommand
 {
 public:
+    static inline const liteshell::BaseCommand::Metadata metadata = {"env", {}};
+
     EnvCommand()
         : liteshell::BaseCommand(
-              "env",
+              metadata,
               "Display all environment variables",
               "",
               liteshell::CommandConstraint()) {}
@@ -26,12 +28,32 @@ public:
             // pass
         }
 
-        for (auto &[name, value] : context.client->get_environment()->get_values())
+        auto environment = context.client->get_environment();
+        std::vector<std::pair<std::string_view, std::string_view>> variables;
+        for (auto variable : environment->get_values())
+        {
+            variables.push_back(variable);
+        }
+
+        std::sort(variables.begin(), variables.end());
+        for (auto &[name, value] : variables)
         {
-            displayer.add_row(name, value);
+            auto type = environment->get_type(name);
+            if (type == liteshell::Environment::ARRAY)
+            {
+                displayer.add_row(std::string(name), utils::format("[array of %zu element(s)]", environment->length(name)));
+            }
+            else if (type == liteshell::Environment::MAP)
+            {
+                displayer.add_row(std::string(name), utils::format("[map of %zu entry(s)]", environment->length(name)));
+            }
+            else
+            {
+                displayer.add_row(std::string(name), std::string(value));
+            }
         }
 
-        std::cout << displayer.display() << std::endl;
+        std::cout << displayer.display() << '\n';
         return 0;
     }
 };
@@ -5,9 +5,11 @@
 class EvalCommand : public liteshell::BaseCommand
 {
 public:
+    static inline const liteshell::BaseCommand::Metadata metadata = {"eval", {}};
+
     EvalCommand()
         : liteshell::BaseCommand(
-              "eval",
+              metadata,
               "Evaluate an expression",
               "The default behavior of this command is to treat the argument as a string and print it to stdout (which is\n"
               "similar to the \"echoln\" command. Different behavior can be achieved by using the parameters listed here.",
@@ -17,7 +19,7 @@ public:
                   .add_option(
                       "-s",
                       "Save the input to an environment variable instead of printing to stdout",
-                      liteshell::PositionalArgument("var", "The variable name", false, true)))
+                      liteshell::PositionalArgument("var", "The variable name, or an element e.g. arr[0] or map[key]", false, true)))
     {
     }
 
@@ -36,16 +38,27 @@ public:
         if (context.present.count("-s"))
         {
             auto name = context.get("-s var");
-            if (!utils::is_valid_variable(name))
+            auto environment = context.client->get_environment();
+
+            // "name[subscript]" assigns an element of an array or an entry of a map
+            auto bracket = name.find('[');
+            if (bracket != std::string::npos && name.back() == ']' && utils::is_valid_variable(name.substr(0, bracket)))
+            {
+                auto subscript = std::string_view(name).substr(bracket + 1, name.size() - bracket - 2);
+                environment->set_element(environment->intern(name.substr(0, bracket)), subscript, result);
+            }
+            else if (utils::is_valid_variable(name))
+            {
+                environment->set_value(name, result);
+            }
+            else
             {
                 throw std::invalid_argument(utils::format("Invalid variable name \"%s\"", name.c_str()));
             }
-
-            context.client->get_environment()->set_value(name, result);
         }
         else
         {
-            std::cout << result << std::endl;
+            std::cout << result << '\n';
         }
 
         return 0;
@@ -5,25 +5,31 @@
 class ExitCommand : public liteshell::BaseCommand
 {
 public:
+    static inline const liteshell::BaseCommand::Metadata metadata = {"exit", {}};
+
     ExitCommand()
         : liteshell::BaseCommand(
-              "exit",
+              metadata,
               "Exit the shell with the specified exit code",
-              "If no exit code is specified, the shell will exit with the current errorlevel.",
+              "If no exit code is specified, the shell will exit with the current errorlevel. When the shell runs as a\n"
+              "server or in a background task, only the current request or task ends, with the exit code as its errorlevel.",
               liteshell::CommandConstraint("exitcode", "The code to exit with", false)) {}
 
     DWORD run(const liteshell::Context &context)
     {
-        try
-        {
-            auto code = std::stoi(context.get("exitcode"));
-            exit(code);
-        }
-        catch (liteshell::ArgumentMissingError &)
+        // Do not leave any buffered output behind
+        std::cout << std::flush;
+        auto code = context.try_get("exitcode");
+        auto exit_code = code.has_value() ? std::stoi(*code) : static_cast<int>(context.client->get_errorlevel());
+        if (context.client->is_serving() || liteshell::TaskContext::current() != nullptr)
         {
-            exit(context.client->get_errorlevel());
+            // Drop the rest of the request or of the task instead of stopping the shell
+            context.client->get_stream()->clear();
+            return static_cast<DWORD>(exit_code);
         }
 
+        exit(exit_code);
+
         return 0;
     }
 };
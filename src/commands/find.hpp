@@ -0,0 +1,359 @@
+#pragma once
+
+#include <all.hpp>
+
+class FindCommand : public liteshell::BaseCommand
+{
+private:
+    /** @brief A directory to enumerate */
+    struct _Task
+    {
+        std::wstring path;
+        std::size_t depth;
+    };
+
+    /** @brief The matches found by the workers and not written yet, drained by the calling thread */
+    struct _Output
+    {
+        std::mutex mutex;
+        std::condition_variable available;
+        std::string buffer;
+        bool done = false;
+
+        void append(std::string &lines)
+        {
+            if (lines.empty())
+            {
+                return;
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                buffer += lines;
+            }
+
+            available.notify_one();
+            lines.clear();
+        }
+    };
+
+    /** @brief The number of bytes of matches a worker buffers before handing them over */
+    static const std::size_t FLUSH_SIZE = 1 << 14;
+
+    /** @brief Parse a size such as `100`, `4K` or `2MB` into a number of bytes */
+    static unsigned long long _parse_size(const std::string &value)
+    {
+        std::size_t end = 0;
+        unsigned long long result = 0;
+        try
+        {
+            result = std::stoull(value, &end);
+        }
+        catch (std::exception &)
+        {
+            throw std::invalid_argument(utils::format("Invalid size \"%s\"", value.c_str()));
+        }
+
+        auto suffix = value.substr(end);
+        if (suffix.size() == 2 && std::toupper(suffix[1]) == 'B')
+        {
+            suffix.pop_back();
+        }
+
+        if (!suffix.empty())
+        {
+            static const std::string units = "KMGT";
+            auto unit = suffix.size() == 1 ? units.find(static_cast<char>(std::toupper(suffix[0]))) : std::string::npos;
+            if (unit == std::string::npos)
+            {
+                throw std::invalid_argument(utils::format("Invalid size \"%s\"", value.c_str()));
+            }
+
+            result <<= 10 * (unit + 1);
+        }
+
+        return result;
+    }
+
+    /** @brief Parse a non-negative number of days into a duration in `FILETIME` units (100 nanoseconds) */
+    static unsigned long long _parse_days(const std::string &value)
+    {
+        long double days = -1;
+        try
+        {
+            days = std::stold(value);
+        }
+        catch (std::exception &)
+        {
+        }
+
+        if (!(days >= 0))
+        {
+            throw std::invalid_argument(utils::format("Invalid number of days \"%s\"", value.c_str()));
+        }
+
+        return static_cast<unsigned long long>(days * 864000000000.0L);
+    }
+
+    static unsigned long long _combine(const DWORD high, const DWORD low)
+    {
+        return (static_cast<unsigned long long>(high) << 32) | low;
+    }
+
+public:
+    static inline const liteshell::BaseCommand::Metadata metadata = {"find", {}};
+
+    FindCommand()
+        : liteshell::BaseCommand(
+              metadata,
+              "Search a directory tree for files and directories",
+              "The tree is enumerated by a pool of worker threads which steal subdirectories from each other, and each\n"
+              "match is written as soon as its directory has been enumerated: the order of the results is not specified.\n"
+              "Junctions and symbolic links to directories are listed but not followed. Name patterns ignore case and the\n"
+              "size filters only match files. Network drives, where enumerating is bound by latency rather than by the\n"
+              "processors, benefit from more workers with -j.",
+              liteshell::CommandConstraint("dir", "The directory to search (default: the working directory)", false)
+                  .add_option(
+                      "-n", "--name",
+                      "Only match names matching a wildcard pattern, e.g. \"*.txt\"",
+                      liteshell::PositionalArgument("pattern", "The pattern, with * and ? wildcards", false, true))
+                  .add_option(
+                      "-r", "--regex",
+                      "Only match names containing a match of a Perl regular expression, ignoring case",
+                      liteshell::PositionalArgument("pattern", "The regular expression", false, true))
+                  .add_option(
+                      "-t", "--type",
+                      "Only match files (f) or directories (d)",
+                      liteshell::PositionalArgument("type", "Either f or d", false, true))
+                  .add_option(
+                      "--min-size",
+                      "Only match files of at least this size, in bytes or with a K, M, G or T suffix",
+                      liteshell::PositionalArgument("size", "The minimum size", false, true))
+                  .add_option(
+                      "--max-size",
+                      "Only match files of at most this size, in bytes or with a K, M, G or T suffix",
+                      liteshell::PositionalArgument("size", "The maximum size", false, true))
+                  .add_option(
+                      "--newer",
+                      "Only match entries modified less than this number of days ago, e.g. 0.5",
+                      liteshell::PositionalArgument("days", "The maximum age", false, true))
+                  .add_option(
+                      "--older",
+                      "Only match entries modified more than this number of days ago",
+                      liteshell::PositionalArgument("days", "The minimum age", false, true))
+                  .add_option(
+                      "-d", "--depth",
+                      "Do not descend more than this number of levels below the directory (default: unlimited)",
+                      liteshell::PositionalArgument("levels", "The maximum depth, 0 only searches the directory itself", false, true))
+                  .add_option(
+                      "-j", "--jobs",
+                      "The number of worker threads (default: the number of processors, at least 4)",
+                      liteshell::PositionalArgument("workers", "The number of workers", false, true))) {}
+
+    DWORD run(const liteshell::Context &context)
+    {
+        auto directory = utils::utf_convert(context.try_get("dir").value_or("."));
+        auto attributes = GetFileAttributesW(directory.c_str());
+        if (attributes == INVALID_FILE_ATTRIBUTES || !(attributes & FILE_ATTRIBUTE_DIRECTORY))
+        {
+            throw std::invalid_argument("The specified directory does not exist");
+        }
+
+        std::optional<std::wstring> name;
+        if (context.present.count("-n"))
+        {
+            name = utils::utf_convert(context.get("-n pattern"));
+        }
+
+        std::optional<boost::regex> regex;
+        if (context.present.count("-r"))
+        {
+            try
+            {
+                regex.emplace(context.get("-r pattern"), boost::regex::perl | boost::regex::icase);
+            }
+            catch (boost::regex_error &e)
+            {
+                throw std::invalid_argument(utils::format("Invalid regular expression: %s", e.what()));
+            }
+        }
+
+        bool files = true, directories = true;
+        if (context.present.count("-t"))
+        {
+            auto type = context.get("-t type");
+            if (type != "f" && type != "d")
+            {
+                throw std::invalid_argument("The type must be either f or d");
+            }
+
+            files = type == "f";
+            directories = type == "d";
+        }
+
+        auto sized = context.present.count("--min-size") || context.present.count("--max-size");
+        auto min_size = context.present.count("--min-size") ? _parse_size(context.get("--min-size size")) : 0;
+        auto max_size = context.present.count("--max-size") ? _parse_size(context.get("--max-size size")) : std::numeric_limits<unsigned long long>::max();
+
+        // Both bounds are converted once to absolute times, e.g. newer than 2 days means written after now - 2 days
+        FILETIME now;
+        GetSystemTimeAsFileTime(&now);
+        auto current = _combine(now.dwHighDateTime, now.dwLowDateTime);
+
+        unsigned long long newer = 0, older = std::numeric_limits<unsigned long long>::max();
+        if (context.present.count("--newer"))
+        {
+            auto age = _parse_days(context.get("--newer days"));
+            newer = current > age ? current - age : 0;
+        }
+
+        if (context.present.count("--older"))
+        {
+            auto age = _parse_days(context.get("--older days"));
+            older = current > age ? current - age : 0;
+        }
+
+        auto depth = std::numeric_limits<std::size_t>::max();
+        if (context.present.count("-d"))
+        {
+            depth = std::stoul(context.get("-d levels"));
+        }
+
+        std::size_t workers = std::max(4u, std::thread::hardware_concurrency());
+        if (context.present.count("-j"))
+        {
+            workers = std::stoul(context.get("-j workers"));
+            if (workers == 0)
+            {
+                throw std::invalid_argument("The number of workers must be positive");
+            }
+        }
+
+        auto matches = [&](const WIN32_FIND_DATAW &data, std::string &utf8)
+        {
+            bool is_directory = data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY;
+            if (is_directory ? !directories : !files)
+            {
+                return false;
+            }
+
+            if (sized)
+            {
+                auto size = _combine(data.nFileSizeHigh, data.nFileSizeLow);
+                if (is_directory || size < min_size || size > max_size)
+                {
+                    return false;
+                }
+            }
+
+            auto modified = _combine(data.ftLastWriteTime.dwHighDateTime, data.ftLastWriteTime.dwLowDateTime);
+            if (modified < newer || modified > older)
+            {
+                return false;
+            }
+
+            if (name.has_value() && !utils::wildcard_match(name->c_str(), data.cFileName))
+            {
+                return false;
+            }
+
+            if (regex.has_value())
+            {
+                utils::utf_convert(data.cFileName, utf8);
+                if (!boost::regex_search(utf8, *regex))
+                {
+                    return false;
+                }
+            }
+
+            return true;
+        };
+
+        _Output output;
+        utils::WorkStealingPool<_Task> pool(
+            workers,
+            [&](std::size_t worker, _Task &task)
+            {
+                // Each worker converts into its own buffers, so a match costs no allocation once they have grown
+                thread_local std::string utf8, lines;
+
+                auto separated = task.path.back() == L'\\' || task.path.back() == L'/';
+                utils::enumerate_directory(
+                    task.path,
+                    [&](const WIN32_FIND_DATAW &data)
+                    {
+                        // Do not follow junctions and symbolic links, which may form cycles
+                        auto descend = (data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) &&
+                                       !(data.dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT) &&
+                                       task.depth < depth;
+                        if (matches(data, utf8))
+                        {
+                            utils::utf_convert(task.path, utf8);
+                            lines += utf8;
+                            if (!separated)
+                            {
+                                lines += '\\';
+                            }
+
+                            utils::utf_convert(data.cFileName, utf8);
+                            lines += utf8;
+                            lines += '\n';
+
+                            if (lines.size() >= FLUSH_SIZE)
+                            {
+                                output.append(lines);
+                            }
+                        }
+
+                        if (descend)
+                        {
+                            pool.push(worker, {separated ? task.path + data.cFileName : task.path + L"\\" + data.cFileName, task.depth + 1});
+                        }
+                    });
+
+                output.append(lines);
+            });
+
+        pool.push(0, {directory, 0});
+
+        // The workers never write to the standard streams, the matches are written by this thread while they run
+        std::thread walker(
+            [&pool, &output]()
+            {
+                pool.run();
+                {
+                    std::lock_guard<std::mutex> lock(output.mutex);
+                    output.done = true;
+                }
+
+                output.available.notify_one();
+            });
+
+        std::string chunk;
+        while (true)
+        {
+            {
+                std::unique_lock<std::mutex> lock(output.mutex);
+                output.available.wait(
+                    lock,
+                    [&output]()
+                    {
+                        return output.done || !output.buffer.empty();
+                    });
+
+                if (output.buffer.empty())
+                {
+                    break;
+                }
+
+                chunk.swap(output.buffer);
+            }
+
+            std::cout << chunk << std::flush;
+            chunk.clear();
+        }
+
+        walker.join();
+        return 0;
+    }
+};
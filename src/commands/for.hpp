@@ -5,33 +5,35 @@
 class ForCommand : public liteshell::BaseCommand
 {
 public:
+    static inline const liteshell::BaseCommand::Metadata metadata = {"for", {}};
+
     ForCommand()
         : liteshell::BaseCommand(
-              "for",
+              metadata,
               "Iterate the loop variable over a specified integer range or string tokens.",
               "To end the loop section, type \"endfor\"",
               liteshell::CommandConstraint(
                   "var", "The name of the loop variable", true,
-                  "x", "The start of the loop range, or the string to split", true,
+                  "x", "The start of the loop range, the string to split or the name of the array", true,
                   "y", "The end of the loop range if iterating over an integer range", false)
                   .add_option(
                       "-t", "--type",
                       "The type of loop",
                       liteshell::PositionalArgument(
                           "type",
-                          "Must be \"range\" or \"split\" \n"
+                          "Must be \"range\", \"split\" or \"each\" \n"
                           "If \"range\" is specified, loop the variable in range [x, y) or [y, x) (from x to y)\n"
-                          "If \"split\" is specified, split the string by spaces and loop the variable over the tokens",
+                          "If \"split\" is specified, split the string by spaces and loop the variable over the tokens\n"
+                          "If \"each\" is specified, loop the variable over the elements of the array named x",
                           false, true),
                       true))
     {
     }
 
-    std::vector<std::string> get_lines(const liteshell::Context &context)
+    std::vector<std::string> get_lines(const liteshell::Context &context, const bool force_stream)
     {
         std::vector<std::string> lines;
         unsigned counter = 1;
-        bool force_stream = !context.client->get_stream()->exhaust();
         while (true)
         {
             auto input = utils::strip(context.client->get_stream()->getline(
@@ -57,64 +59,116 @@ public:
         return lines;
     }
 
-    void insert_commands(
-        const liteshell::Context &context,
-        const std::string &loop_var,
-        const std::vector<std::string> &loop_values,
-        const std::vector<std::string> &lines)
+    DWORD run(const liteshell::Context &context)
     {
-        if (!loop_values.empty())
+        auto type = context.get("-t type");
+        auto environment = context.client->get_environment();
+        auto loop_var = environment->intern(context.get("var"));
+
+        // Produce the loop values lazily, so a loop never materializes its range
+        std::function<std::optional<std::string>()> next_value;
+        if (type == "range")
         {
-            if (lines.empty()) // No-op loops, reduce to a single assignment
-            {
-                context.client->get_stream()->write(utils::format("eval \"%s\" -s %s", loop_values.back().c_str(), loop_var.c_str()), true);
-            }
-            else
+            auto start = environment->eval_ll(context.get("x")),
+                 end = environment->eval_ll(context.get("y"));
+            auto step = start < end ? 1 : -1;
+
+            next_value = [value = start, end, step]() mutable -> std::optional<std::string>
             {
-                std::vector<std::string> _loop_values(loop_values);
-                std::reverse(_loop_values.begin(), _loop_values.end());
-                for (const auto &value : _loop_values)
+                if (value == end)
                 {
-                    context.client->get_stream()->write(lines.begin(), lines.end(), true);
-                    context.client->get_stream()->write(utils::format("eval \"%s\" -s %s", value.c_str(), loop_var.c_str()), true);
+                    return std::nullopt;
                 }
-            }
-        }
-    }
 
-    DWORD run(const liteshell::Context &context)
-    {
-        auto type = context.get("-t type");
-        auto loop_var = context.get("var");
-        if (type == "range")
+                auto result = std::to_string(value);
+                value += step;
+                return result;
+            };
+        }
+        else if (type == "split")
         {
-            auto start = context.client->get_environment()->eval_ll(context.get("x")),
-                 end = context.client->get_environment()->eval_ll(context.get("y"));
-
-            std::vector<std::string> loop_values;
-            if (start < end)
+            next_value = [values = utils::split(context.get("x"), ' '), index = std::size_t(0)]() mutable -> std::optional<std::string>
             {
-                for (long long value = start; value < end; value++)
+                if (index == values.size())
                 {
-                    loop_values.push_back(std::to_string(value));
+                    return std::nullopt;
                 }
-            }
-            else if (start > end)
+
+                return values[index++];
+            };
+        }
+        else if (type == "each")
+        {
+            // Elements are read by index, so the array is not copied and may grow during the loop
+            next_value = [environment, array = environment->intern(context.get("x")), index = std::size_t(0)]() mutable -> std::optional<std::string>
             {
-                for (long long value = start; value > end; value--)
+                auto element = environment->get_element(array, index++);
+                if (!element.has_value())
                 {
-                    loop_values.push_back(std::to_string(value));
+                    return std::nullopt;
                 }
+
+                return std::string(*element);
+            };
+        }
+        else
+        {
+            return 0;
+        }
+
+        auto stream = context.client->get_stream();
+        bool force_stream = !stream->exhaust();
+        auto start = stream->tell();
+        auto lines = get_lines(context, force_stream);
+
+        auto first = next_value();
+        if (!first.has_value())
+        {
+            return 0;
+        }
+
+        if (lines.empty()) // No-op loops, reduce to a single assignment
+        {
+            auto last = *first;
+            for (auto value = next_value(); value.has_value(); value = next_value())
+            {
+                last = *value;
             }
 
-            insert_commands(context, loop_var, loop_values, get_lines(context));
+            environment->set_value(loop_var, last);
+            return 0;
         }
-        else if (type == "split")
+
+        // Execute the loop body in place when it was read from the stream, the body ends right before "endfor"
+        std::shared_ptr<const liteshell::Script> script;
+        std::size_t begin = 0, end;
+        if (force_stream)
+        {
+            script = start->first;
+            begin = start->second;
+            end = stream->tell()->second - 1;
+        }
+        else
         {
-            auto values = utils::split(context.get("x"), ' ');
-            insert_commands(context, loop_var, values, get_lines(context));
+            script = context.client->compile(lines.begin(), lines.end());
+            end = script->size();
         }
 
+        environment->set_value(loop_var, *first);
+        stream->loop(
+            script, begin, end,
+            [environment, loop_var, next_value]() mutable
+            {
+                auto value = next_value();
+                if (value.has_value())
+                {
+                    environment->set_value(loop_var, *value);
+                    return true;
+                }
+
+                return false;
+            });
+
         return 0;
     }
 };
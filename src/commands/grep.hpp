@@ -0,0 +1,360 @@
+#pragma once
+
+#include <all.hpp>
+
+class GrepCommand : public liteshell::BaseCommand
+{
+private:
+    /** @brief The maximum size of the chunks read from a redirected input, and the size of the output handed over by a worker */
+    static const std::size_t BUFFER_SIZE = 1 << 20;
+
+    /** @brief How the matches of an input are reported */
+    struct _Format
+    {
+        /** @brief Only count the matching lines (-c) */
+        bool count;
+
+        /** @brief Only display the name of an input which has a matching line (-l) */
+        bool names;
+
+        /** @brief Prefix each line with its number (-n) */
+        bool numbers;
+
+        /** @brief Prefix each line or count with the name of the input */
+        bool prefix;
+    };
+
+    /** @brief The state of the search of an input, carried from one chunk to the next */
+    struct _Progress
+    {
+        std::size_t matches = 0;
+
+        /** @brief The number of lines before the current chunk, only maintained with -n */
+        std::size_t lines = 0;
+    };
+
+    /** @brief The output of each input, filled by the workers and written in order by the calling thread */
+    struct _Results
+    {
+        std::mutex mutex;
+        std::condition_variable available;
+        std::vector<std::string> buffers, errors;
+        std::vector<bool> done;
+
+        explicit _Results(const std::size_t size) : buffers(size), errors(size), done(size) {}
+
+        void append(const std::size_t index, std::string &output)
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                buffers[index] += output;
+            }
+
+            available.notify_one();
+            output.clear();
+        }
+
+        void finish(const std::size_t index, std::string &output, const std::string &error)
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                buffers[index] += output;
+                errors[index] = error;
+                done[index] = true;
+            }
+
+            available.notify_one();
+            output.clear();
+        }
+    };
+
+    /**
+     * @brief Search a chunk of an input, appending the lines to display to `output`
+     *
+     * @param chunk The chunk, which starts at the beginning of a line
+     * @return Whether the rest of the input must be searched, i.e. false once the input is known to match with -l
+     */
+    static bool _search(
+        const utils::LineSearcher &searcher,
+        const _Format &format,
+        const std::string &name,
+        const std::string_view &chunk,
+        _Progress &progress,
+        std::string &output)
+    {
+        utils::LineSearcher::Scanner scanner(searcher, chunk);
+
+        // Lines are counted lazily, only up to the matches
+        auto counted = chunk.data();
+        char number[24];
+
+        std::string_view line;
+        while (scanner.next(line))
+        {
+            progress.matches++;
+            if (format.names)
+            {
+                return false;
+            }
+
+            if (format.count)
+            {
+                continue;
+            }
+
+            if (format.prefix)
+            {
+                output += name;
+                output += ':';
+            }
+
+            if (format.numbers)
+            {
+                progress.lines += std::count(counted, line.data(), '\n');
+                counted = line.data();
+
+                auto end = std::to_chars(number, number + sizeof(number), progress.lines + 1).ptr;
+                output.append(number, end);
+                output += ':';
+            }
+
+            output += line;
+            output += '\n';
+        }
+
+        if (format.numbers)
+        {
+            progress.lines += std::count(counted, chunk.data() + chunk.size(), '\n');
+        }
+
+        return true;
+    }
+
+    /** @brief Append the summary of an input to `output`, once it has been searched */
+    static void _summarize(const _Format &format, const std::string &name, const _Progress &progress, std::string &output)
+    {
+        if (format.names)
+        {
+            if (progress.matches > 0)
+            {
+                output += name;
+                output += '\n';
+            }
+        }
+        else if (format.count)
+        {
+            if (format.prefix)
+            {
+                output += name;
+                output += ':';
+            }
+
+            output += std::to_string(progress.matches);
+            output += '\n';
+        }
+    }
+
+    /** @brief Search a redirected input, the matches are written as the lines arrive */
+    static std::size_t _search_input(const utils::LineSearcher &searcher, const _Format &format)
+    {
+        std::string output;
+        _Progress progress;
+
+        // The rest of the input is still read with -l, so that the writer of a pipeline does not block
+        auto searching = true;
+        utils::read_lines(
+            *utils::StandardStreams::input().rdbuf(),
+            [&](const std::string_view &chunk)
+            {
+                if (searching)
+                {
+                    searching = _search(searcher, format, "(standard input)", chunk, progress, output);
+                    if (!output.empty())
+                    {
+                        std::cout << output << std::flush;
+                        output.clear();
+                    }
+                }
+            },
+            BUFFER_SIZE);
+
+        _summarize(format, "(standard input)", progress, output);
+        std::cout << output << std::flush;
+        return progress.matches;
+    }
+
+public:
+    static inline const liteshell::BaseCommand::Metadata metadata = {"grep", {}};
+
+    GrepCommand()
+        : liteshell::BaseCommand(
+              metadata,
+              "Display the lines of files matching a pattern",
+              "The pattern is a Perl regular expression unless -F is given. Each file is mapped into memory and\n"
+              "searched for a literal which every matching line must contain, so that the regular expression only runs\n"
+              "on the candidate lines. Files, which may contain wildcards, are searched in parallel and displayed in\n"
+              "order. Without any file, the redirected input (e.g. of a pipeline) is searched. The errorlevel is 0 if\n"
+              "a line matched, 1 if none did and 2 if a file could not be read.",
+              liteshell::CommandConstraint(
+                  "pattern", "The pattern to search", true,
+                  "files", "The files to search (default: the redirected input)", false,
+                  true)
+                  .add_option("-c", "--count", "Only display the number of matching lines of each file", {}, false)
+                  .add_option("-l", "--files-with-matches", "Only display the names of the files with a matching line", {}, false)
+                  .add_option("-n", "--line-number", "Prefix each line with its line number", {}, false)
+                  .add_option("-i", "--ignore-case", "Ignore case when matching", {}, false)
+                  .add_option("-F", "--fixed-strings", "Treat the pattern as a fixed string instead of a regular expression", {}, false)
+                  .add_option(
+                      "-j", "--jobs",
+                      "The number of files searched at once (default: the number of processors)",
+                      liteshell::PositionalArgument("workers", "The number of workers", false, true))) {}
+
+    DWORD run(const liteshell::Context &context)
+    {
+        utils::LineSearcher searcher(context.get("pattern"), context.present.count("-F"), context.present.count("-i"));
+
+        _Format format;
+        format.count = context.present.count("-c");
+        format.names = context.present.count("-l");
+        format.numbers = context.present.count("-n");
+        format.prefix = false;
+
+        std::size_t workers = std::max(1u, std::thread::hardware_concurrency());
+        if (context.present.count("-j"))
+        {
+            workers = std::stoul(context.get("-j workers"));
+            if (workers == 0)
+            {
+                throw std::invalid_argument("The number of workers must be positive");
+            }
+        }
+
+        if (!context.present.count("files"))
+        {
+            if (!utils::StandardStreams::is_input_redirected())
+            {
+                throw std::invalid_argument("No file was specified and the input is not redirected");
+            }
+
+            return _search_input(searcher, format) > 0 ? 0 : 1;
+        }
+
+        // Expand the wildcards, the matches are names relative to the directory of the pattern
+        std::vector<std::string> paths;
+        for (auto &target : context.values.at("files"))
+        {
+            if (target.find_first_of("*?") == std::string::npos)
+            {
+                paths.push_back(target);
+                continue;
+            }
+
+            auto separator = target.find_last_of("\\/");
+            auto parent = separator == std::string::npos ? std::string() : target.substr(0, separator + 1);
+            for (auto &data : utils::FindFiles(target))
+            {
+                if (!(data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY))
+                {
+                    paths.push_back(parent + utils::utf_convert(data.cFileName));
+                }
+            }
+
+            format.prefix = true;
+        }
+
+        format.prefix = format.prefix || paths.size() > 1;
+
+        _Results results(paths.size());
+        std::atomic<std::size_t> next{0}, matched{0};
+        auto work = [&]()
+        {
+            // Each worker reuses its output buffer, so that displaying a line does not allocate once it has grown
+            std::string output;
+            std::size_t index;
+            while ((index = next++) < paths.size())
+            {
+                std::string error;
+                _Progress progress;
+                try
+                {
+                    utils::MappedFile file(paths[index]);
+                    auto data = file.view();
+
+                    // Search in slices, so that the first lines are displayed before the whole file is searched
+                    std::size_t offset = 0;
+                    while (offset < data.size())
+                    {
+                        auto end = data.find('\n', std::min(offset + BUFFER_SIZE, data.size()) - 1);
+                        end = end == std::string_view::npos ? data.size() : end + 1;
+
+                        if (!_search(searcher, format, paths[index], data.substr(offset, end - offset), progress, output))
+                        {
+                            break;
+                        }
+
+                        offset = end;
+                        if (output.size() >= BUFFER_SIZE)
+                        {
+                            results.append(index, output);
+                        }
+                    }
+                }
+                catch (std::exception &e)
+                {
+                    error = utils::format("%s: %s", paths[index].c_str(), e.what());
+                }
+
+                matched += progress.matches > 0;
+                _summarize(format, paths[index], progress, output);
+                results.finish(index, output, error);
+            }
+        };
+
+        std::vector<std::future<void>> jobs;
+        for (std::size_t i = 0; i < std::min(workers, paths.size()); i++)
+        {
+            jobs.push_back(utils::ThreadPool::shared().submit(work));
+        }
+
+        // The workers never write to the standard streams, the outputs are written by this thread in order
+        auto errors = false;
+        std::string chunk;
+        for (std::size_t index = 0; index < paths.size(); index++)
+        {
+            auto done = false;
+            while (!done)
+            {
+                {
+                    std::unique_lock<std::mutex> lock(results.mutex);
+                    results.available.wait(
+                        lock,
+                        [&results, &index]()
+                        {
+                            return results.done[index] || !results.buffers[index].empty();
+                        });
+
+                    done = results.done[index];
+                    chunk.swap(results.buffers[index]);
+                }
+
+                std::cout << chunk << std::flush;
+                chunk.clear();
+            }
+
+            // The error is final once the input is done, and no worker accesses it anymore
+            auto &error = results.errors[index];
+            if (!error.empty())
+            {
+                std::cerr << error << '\n';
+                errors = true;
+            }
+        }
+
+        for (auto &job : jobs)
+        {
+            job.get();
+        }
+
+        return errors ? 2 : (matched > 0 ? 0 : 1);
+    }
+};
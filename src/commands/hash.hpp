@@ -0,0 +1,49 @@
+#pragma once
+
+#include <all.hpp>
+
+class HashCommand : public liteshell::BaseCommand
+{
+public:
+    static inline const liteshell::BaseCommand::Metadata metadata = {"hash", {}};
+
+    HashCommand()
+        : liteshell::BaseCommand(
+              metadata,
+              "Display or clear the cache of executables found in PATH",
+              "Executables found in the directories of PATH are remembered until PATH changes or one of its directories\n"
+              "changes. Use -r after creating a directory of PATH which did not exist when it was first searched.",
+              liteshell::CommandConstraint()
+                  .add_option("-r", "Forget all remembered executables")) {}
+
+    DWORD run(const liteshell::Context &context)
+    {
+        auto &cache = context.client->get_executable_cache();
+        if (context.present.count("-r"))
+        {
+            cache.clear();
+            return 0;
+        }
+
+        utils::Table displayer("Command", "Path");
+        try
+        {
+            // This will throw std::runtime_error when running without a console (testing with pytest for example)
+            std::size_t columns = utils::get_console_size().first;
+            displayer.limits = {20, columns - 25};
+        }
+        catch (std::runtime_error &)
+        {
+            // pass
+        }
+
+        for (auto &[token, executable] : cache.entries())
+        {
+            displayer.add_row(token, executable.value_or("(not found)"));
+        }
+
+        std::cout << displayer.display() << '\n';
+        std::cout << cache.hits() << " hit(s), " << cache.misses() << " miss(es)\n";
+        return 0;
+    }
+};
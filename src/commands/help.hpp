@@ -5,9 +5,11 @@
 class HelpCommand : public liteshell::BaseCommand
 {
 public:
+    static inline const liteshell::BaseCommand::Metadata metadata = {"help", {}};
+
     HelpCommand()
         : liteshell::BaseCommand(
-              "help",
+              metadata,
               "Get all commands or get help for a specific command",
               "Provides help information about shell commands.\n"
               "To get help for a specific command, specify its name as the first argument (e.g. \"help help\").",
@@ -17,37 +19,37 @@ public:
 
     DWORD run(const liteshell::Context &context)
     {
-        try
+        auto name = context.try_get("command");
+        if (name.has_value())
         {
-            auto name = context.get("command");
-            auto wrapper = context.client->get_optional_command(name);
+            auto wrapper = context.client->get_optional_command(*name);
             if (wrapper.has_value())
             {
-                std::cout << wrapper->command->help();
+                std::cout << wrapper->command()->help();
             }
             else
             {
-                auto error = liteshell::CommandNotFound(name, context.client->fuzzy_command_search(name).c_str());
-                throw std::invalid_argument(error.message);
+                auto error = liteshell::CommandNotFound(*name, context.client->fuzzy_command_search(*name));
+                throw std::invalid_argument(error.what());
             }
         }
-        catch (liteshell::ArgumentMissingError &)
+        else
         {
             auto commands = context.client->walk_commands();
             std::size_t max_width = 0;
             for (auto &wrapper : commands)
             {
-                max_width = std::max(max_width, 3 + wrapper.command->name.size());
+                max_width = std::max(max_width, 3 + wrapper.name.size());
             }
 
             for (auto &wrapper : commands)
             {
-                std::cout << wrapper.command->name;
-                for (auto i = wrapper.command->name.size(); i < max_width; i++)
+                std::cout << wrapper.name;
+                for (auto i = wrapper.name.size(); i < max_width; i++)
                 {
                     std::cout << " ";
                 }
-                std::cout << wrapper.command->description << std::endl;
+                std::cout << wrapper.command()->description << '\n';
             }
         }
 
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <all.hpp>
+
+class HistoryCommand : public liteshell::BaseCommand
+{
+public:
+    static inline const liteshell::BaseCommand::Metadata metadata = {"history", {}};
+
+    HistoryCommand()
+        : liteshell::BaseCommand(
+              metadata,
+              "Display or search the history of the command lines typed in the shell",
+              "The history is saved to the file in the LITESHELL_HISTORY environment variable, or to .liteshell_history\n"
+              "in the profile directory of the user. In the console, Up and Down recall the entries starting with the\n"
+              "text typed so far and Ctrl-R searches for an entry containing the text typed after it.\n"
+              "Searches ignore case, the matching entries are displayed from the oldest to the most recent.",
+              liteshell::CommandConstraint("query", "Display only the entries containing this text", false)
+                  .add_option(
+                      "-n", "--count",
+                      "The maximum number of entries to display (default: 20)",
+                      liteshell::PositionalArgument("count", "The maximum number of entries", false, true),
+                      false)
+                  .add_option("-p", "--prefix", "Display only the entries starting with the query", {}, false)
+                  .add_option("-c", "--clear", "Remove all entries from the history", {}, false))
+    {
+    }
+
+    DWORD run(const liteshell::Context &context)
+    {
+        auto history = context.client->get_stream()->get_history();
+        if (history == nullptr)
+        {
+            throw std::runtime_error("The history is only available in an interactive shell");
+        }
+
+        if (context.present.count("-c"))
+        {
+            history->clear();
+            return 0;
+        }
+
+        std::size_t count = 20;
+        if (context.present.count("-n"))
+        {
+            count = std::stoul(context.get("-n count"));
+        }
+
+        auto query = context.try_get("query").value_or("");
+        bool prefix = context.present.count("-p");
+
+        std::vector<std::size_t> entries;
+        for (auto from = history->end(); entries.size() < count;)
+        {
+            auto found = history->search(query, from, true, prefix);
+            if (!found.has_value())
+            {
+                break;
+            }
+
+            entries.push_back(*found);
+            from = *found;
+        }
+
+        for (auto iter = entries.rbegin(); iter != entries.rend(); iter++)
+        {
+            std::cout << utils::format("%6zu  ", *iter + 1) << history->get(*iter) << '\n';
+        }
+
+        return 0;
+    }
+};
@@ -4,26 +4,82 @@
 
 class IfCommand : public liteshell::BaseCommand
 {
-public:
-    IfCommand()
-        : liteshell::BaseCommand(
-              "if",
-              "Compare strings or math expressions",
-              "<operator> must be one of the values: \"==\", \"!=\", \"<\", \">\", \"<=\", \">=\".\n\n"
-              "The strings are compared using the lexicography order.\n"
-              "If the flag -m is set, perform mathematical evaluation before making algebra comparisons.\n"
-              "To end each condition section, use \"else\"/\"endif\".",
-              liteshell::CommandConstraint(
-                  "x", "The first value to compare", true,
-                  "operator", "The operator to use for comparison", true,
-                  "y", "The second value to compare", true)
-                  .add_option("-m", "Perform mathematical comparison instead of string comparison", false))
+private:
+    static bool evaluate(const liteshell::Context &context)
     {
+        auto first = context.get("x"), op = context.get("operator"), second = context.get("y");
+        bool result;
+        if (context.present.count("-m"))
+        {
+            auto f = context.client->get_environment()->eval_ll(first),
+                 s = context.client->get_environment()->eval_ll(second);
+            if (op == "==")
+            {
+                result = f == s;
+            }
+            else if (op == "!=")
+            {
+                result = f != s;
+            }
+            else if (op == "<")
+            {
+                result = f < s;
+            }
+            else if (op == ">")
+            {
+                result = f > s;
+            }
+            else if (op == "<=")
+            {
+                result = f <= s;
+            }
+            else if (op == ">=")
+            {
+                result = f >= s;
+            }
+            else
+            {
+                throw std::invalid_argument("Invalid operator");
+            }
+        }
+        else
+        {
+            if (op == "==")
+            {
+                result = first == second;
+            }
+            else if (op == "!=")
+            {
+                result = first != second;
+            }
+            else if (op == "<")
+            {
+                result = first < second;
+            }
+            else if (op == ">")
+            {
+                result = first > second;
+            }
+            else if (op == "<=")
+            {
+                result = first <= second;
+            }
+            else if (op == ">=")
+            {
+                result = first >= second;
+            }
+            else
+            {
+                throw std::invalid_argument("Invalid operator");
+            }
+        }
+
+        return result;
     }
 
-    DWORD run(const liteshell::Context &context)
+    /** @brief Read both branches line by line, when the block cannot be located in a script */
+    static DWORD run_lines(const liteshell::Context &context)
     {
-        auto first = context.get("x"), op = context.get("operator"), second = context.get("y");
         bool force_stream = !context.client->get_stream()->exhaust();
 
         unsigned counter = 1;
@@ -95,75 +151,64 @@ public:
             }
         }
 
-        bool result;
-        if (context.present.count("-m"))
-        {
-            auto f = context.client->get_environment()->eval_ll(first),
-                 s = context.client->get_environment()->eval_ll(second);
-            if (op == "==")
-            {
-                result = f == s;
-            }
-            else if (op == "!=")
-            {
-                result = f != s;
-            }
-            else if (op == "<")
-            {
-                result = f < s;
-            }
-            else if (op == ">")
-            {
-                result = f > s;
-            }
-            else if (op == "<=")
-            {
-                result = f <= s;
-            }
-            else if (op == ">=")
-            {
-                result = f >= s;
-            }
-            else
-            {
-                throw std::invalid_argument("Invalid operator");
-            }
-        }
-        else
+        const auto &lines = evaluate(context) ? if_true : if_false;
+        context.client->get_stream()->write(context.client->compile(lines.begin(), lines.end()), false);
+
+        return 0;
+    }
+
+public:
+    static inline const liteshell::BaseCommand::Metadata metadata = {"if", {}};
+
+    IfCommand()
+        : liteshell::BaseCommand(
+              metadata,
+              "Compare strings or math expressions",
+              "<operator> must be one of the values: \"==\", \"!=\", \"<\", \">\", \"<=\", \">=\".\n\n"
+              "The strings are compared using the lexicography order.\n"
+              "If the flag -m is set, perform mathematical evaluation before making algebra comparisons.\n"
+              "To end each condition section, use \"else\"/\"endif\".",
+              liteshell::CommandConstraint(
+                  "x", "The first value to compare", true,
+                  "operator", "The operator to use for comparison", true,
+                  "y", "The second value to compare", true)
+                  .add_option("-m", "Perform mathematical comparison instead of string comparison", false))
+    {
+    }
+
+    DWORD run(const liteshell::Context &context)
+    {
+        auto stream = context.client->get_stream();
+        if (!stream->exhaust())
         {
-            if (op == "==")
-            {
-                result = first == second;
-            }
-            else if (op == "!=")
-            {
-                result = first != second;
-            }
-            else if (op == "<")
-            {
-                result = first < second;
-            }
-            else if (op == ">")
-            {
-                result = first > second;
-            }
-            else if (op == "<=")
-            {
-                result = first <= second;
-            }
-            else if (op == ">=")
-            {
-                result = first >= second;
-            }
-            else
-            {
-                throw std::invalid_argument("Invalid operator");
+            // The block is executed in place, using the branches matched when the script was compiled
+            auto [script, next] = *stream->tell();
+            auto block = next - 1;
+            auto middle = next > 0 && utils::startswith(script->instructions[block].source, "if ")
+                              ? script->find_branch(block)
+                              : std::nullopt;
+            if (middle.has_value())
+            {
+                auto has_else = script->instructions[*middle].source == "else";
+                auto end = has_else ? script->find_branch(*middle) : middle;
+
+                // Skip the whole block first, the branch to execute is pushed on top of it
+                if (end.has_value() && stream->seek(*end + 1))
+                {
+                    if (evaluate(context))
+                    {
+                        stream->write(script, next, *middle);
+                    }
+                    else if (has_else)
+                    {
+                        stream->write(script, *middle + 1, *end);
+                    }
+
+                    return 0;
+                }
             }
         }
 
-        std::vector<std::string> lines = result ? if_true : if_false;
-        context.client->get_stream()->write(lines.begin(), lines.end(), true);
-
-        return 0;
+        return run_lines(context);
     }
 };
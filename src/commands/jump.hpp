@@ -5,9 +5,11 @@
 class JumpCommand : public liteshell::BaseCommand
 {
 public:
+    static inline const liteshell::BaseCommand::Metadata metadata = {"jump", {}};
+
     JumpCommand()
         : liteshell::BaseCommand(
-              "jump",
+              metadata,
               "Skip the input stream to the specified label",
               "Examples: \"jump end\", \"jump :end\".\n"
               "When reading from batch scripts, a label :EOF will automatically be added to the end.",
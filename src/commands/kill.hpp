@@ -5,35 +5,39 @@
 class KillCommand : public liteshell::BaseCommand
 {
 public:
+    static inline const liteshell::BaseCommand::Metadata metadata = {"kill", {}};
+
     KillCommand()
         : liteshell::BaseCommand(
-              "kill",
+              metadata,
               "Kill a subprocess with the given PID and exit code ",
-              "",
+              "A background task started with \"%\" is named e.g. \"%1\", see \"ps\". It stops before its next\n"
+              "instruction, once its running command returns.",
               liteshell::CommandConstraint(
-                  "pid", "The PID of the subprocess to kill", true,
+                  "pid", "The PID of the subprocess or the name of the background task to kill", true,
                   "exit_code", "The exit code to use when killing the subprocess (default: 1)", false)) {}
 
     DWORD run(const liteshell::Context &context)
     {
-        DWORD pid = std::stoul(context.get("pid"));
-        UINT exit_code = 1;
+        auto exit_code_argument = context.try_get("exit_code");
+        UINT exit_code = exit_code_argument.has_value() ? std::stoul(*exit_code_argument) : 1;
 
-        try
-        {
-            exit_code = std::stoul(context.get("exit_code"));
-        }
-        catch (liteshell::ArgumentMissingError &)
+        auto target = context.get("pid");
+        if (liteshell::BackgroundTask::is_name(target))
         {
-            // pass
+            context.client->get_task(target)->kill(exit_code);
+            std::cout << "Terminated task " << target << " with exit code " << exit_code << '\n';
+            return 0;
         }
 
+        DWORD pid = std::stoul(target);
+
         for (auto wrapper_ptr : context.client->get_subprocesses())
         {
             if (wrapper_ptr->pid() == pid)
             {
                 wrapper_ptr->kill(exit_code);
-                std::cout << "Terminated process " << pid << " with exit code " << exit_code << std::endl;
+                std::cout << "Terminated process " << pid << " with exit code " << exit_code << '\n';
                 return 0;
             }
         }
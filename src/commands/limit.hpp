@@ -0,0 +1,71 @@
+#pragma once
+
+#include <all.hpp>
+
+class LimitCommand : public liteshell::BaseCommand
+{
+public:
+    static inline const liteshell::BaseCommand::Metadata metadata = {"limit", {}};
+
+    LimitCommand()
+        : liteshell::BaseCommand(
+              metadata,
+              "Display or set the caps on the memory and CPU usage of new subprocesses",
+              "Each subprocess runs in its own job object, the caps apply to the subprocess and its descendants together.\n"
+              "A subprocess exceeding the memory cap fails to allocate memory, the CPU cap is enforced by the scheduler.\n"
+              "Running subprocesses are not affected. The caps are displayed when no option is given.",
+              liteshell::CommandConstraint()
+                  .add_option(
+                      "-m", "--memory",
+                      "The maximum committed memory of a subprocess, in megabytes",
+                      liteshell::PositionalArgument("megabytes", "The memory cap", false, true))
+                  .add_option(
+                      "-c", "--cpu",
+                      "The maximum CPU usage of a subprocess, in percent of all processors",
+                      liteshell::PositionalArgument("percent", "The CPU cap, from 1 to 100", false, true))
+                  .add_option("-r", "--reset", "Remove all caps", {}, false)) {}
+
+    DWORD run(const liteshell::Context &context)
+    {
+        auto limits = context.client->get_job_limits();
+        bool display = true;
+        if (context.present.count("-r"))
+        {
+            limits = liteshell::JobLimits();
+            display = false;
+        }
+
+        if (context.present.count("-m"))
+        {
+            auto megabytes = std::stoull(context.get("-m megabytes"));
+            if (megabytes == 0 || megabytes > std::numeric_limits<std::size_t>::max() / (1 << 20))
+            {
+                throw std::invalid_argument("The memory cap must be a positive number of megabytes");
+            }
+
+            limits.memory = static_cast<std::size_t>(megabytes) << 20;
+            display = false;
+        }
+
+        if (context.present.count("-c"))
+        {
+            auto percent = std::stoul(context.get("-c percent"));
+            if (percent == 0 || percent > 100)
+            {
+                throw std::invalid_argument("The CPU cap must be between 1 and 100");
+            }
+
+            limits.cpu = static_cast<unsigned>(percent);
+            display = false;
+        }
+
+        context.client->set_job_limits(limits);
+        if (display)
+        {
+            std::cout << "Memory: " << (limits.memory > 0 ? utils::memory_size(limits.memory) : "unlimited") << '\n';
+            std::cout << "CPU: " << (limits.cpu > 0 ? std::to_string(limits.cpu) + "%" : "unlimited") << '\n';
+        }
+
+        return 0;
+    }
+};
@@ -4,42 +4,471 @@
 
 class LsCommand : public liteshell::BaseCommand
 {
+private:
+    /** @brief An entry to display, its name is relative to the explored directory */
+    struct _Entry
+    {
+        std::string name;
+        DWORD attributes;
+        unsigned long long size, modified;
+    };
+
+    /** @brief A bounded queue of batches of entries, from the enumerating thread to the displaying one */
+    class _Channel
+    {
+    private:
+        std::mutex _mutex;
+        std::condition_variable _readable, _writable;
+        std::deque<std::vector<_Entry>> _batches;
+        bool _closed = false;
+
+    public:
+        /** @brief Append a batch, blocking while the queue is full. Batches pushed after `close` are discarded. */
+        void push(std::vector<_Entry> &&batch)
+        {
+            {
+                std::unique_lock<std::mutex> lock(_mutex);
+                _writable.wait(
+                    lock,
+                    [this]()
+                    {
+                        return _closed || _batches.size() < CAPACITY;
+                    });
+
+                if (_closed)
+                {
+                    return;
+                }
+
+                _batches.push_back(std::move(batch));
+            }
+
+            _readable.notify_one();
+        }
+
+        /** @brief Take the oldest batch, blocking while the queue is empty. Return `false` once it is closed and empty. */
+        bool pop(std::vector<_Entry> &batch)
+        {
+            {
+                std::unique_lock<std::mutex> lock(_mutex);
+                _readable.wait(
+                    lock,
+                    [this]()
+                    {
+                        return _closed || !_batches.empty();
+                    });
+
+                if (_batches.empty())
+                {
+                    return false;
+                }
+
+                batch = std::move(_batches.front());
+                _batches.pop_front();
+            }
+
+            _writable.notify_one();
+            return true;
+        }
+
+        void close()
+        {
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                _closed = true;
+            }
+
+            _readable.notify_all();
+            _writable.notify_all();
+        }
+    };
+
+    /** @brief A sort key of an entry, so that sorting moves 16 bytes per entry instead of whole entries */
+    struct _Key
+    {
+        unsigned long long key;
+        std::size_t index;
+    };
+
+    /** @brief A directory whose size is added to the total of an entry */
+    struct _Task
+    {
+        std::wstring path;
+        std::size_t entry;
+    };
+
+    /** @brief The number of entries handed over at once by the enumerating thread */
+    static const std::size_t BATCH_SIZE = 256;
+
+    /** @brief The number of batches waiting to be displayed before the enumeration pauses */
+    static const std::size_t CAPACITY = 16;
+
+    static unsigned long long _combine(const LARGE_INTEGER &value)
+    {
+        return static_cast<unsigned long long>(value.QuadPart);
+    }
+
+    static std::wstring _child(const std::wstring &directory, const std::wstring_view &name)
+    {
+        auto result = directory;
+        if (!result.empty() && result.back() != L'\\' && result.back() != L'/')
+        {
+            result += L'\\';
+        }
+
+        result += name;
+        return result;
+    }
+
+    /** @brief Whether a directory entry can be entered without following a link, which may create a cycle */
+    static bool _is_traversable(const DWORD attributes)
+    {
+        return (attributes & FILE_ATTRIBUTE_DIRECTORY) && !(attributes & FILE_ATTRIBUTE_REPARSE_POINT);
+    }
+
+    /** @brief Format a UTC time as a local date and time */
+    static std::string _local_time(const unsigned long long time)
+    {
+        FILETIME file_time;
+        file_time.dwLowDateTime = static_cast<DWORD>(time);
+        file_time.dwHighDateTime = static_cast<DWORD>(time >> 32);
+
+        SYSTEMTIME utc, local;
+        if (!FileTimeToSystemTime(&file_time, &utc) || !SystemTimeToTzSpecificLocalTime(NULL, &utc, &local))
+        {
+            return "?";
+        }
+
+        return utils::format("%04d-%02d-%02d %02d:%02d", local.wYear, local.wMonth, local.wDay, local.wHour, local.wMinute);
+    }
+
+    /** @brief The first 8 bytes of a name in lowercase, ordered like the names */
+    static unsigned long long _name_prefix(const std::string &name)
+    {
+        unsigned long long result = 0;
+        for (std::size_t i = 0; i < sizeof(result); i++)
+        {
+            result <<= 8;
+            if (i < name.size())
+            {
+                result |= static_cast<unsigned char>(std::tolower(static_cast<unsigned char>(name[i])));
+            }
+        }
+
+        return result;
+    }
+
+    static bool _name_before(const std::string &first, const std::string &second)
+    {
+        return std::lexicographical_compare(
+            first.begin(), first.end(), second.begin(), second.end(),
+            [](char a, char b)
+            {
+                return std::tolower(static_cast<unsigned char>(a)) < std::tolower(static_cast<unsigned char>(b));
+            });
+    }
+
+    /**
+     * @brief Enumerate a directory, then its subdirectories if `recursive`, and hand the entries over in batches
+     *
+     * @param directory The directory to enumerate
+     * @param prefix The path of the directory relative to the explored one, followed by a separator
+     */
+    static void _walk(
+        const std::wstring &directory,
+        const std::string &prefix,
+        const bool recursive,
+        _Channel &channel,
+        std::vector<_Entry> &batch)
+    {
+        std::vector<std::pair<std::wstring, std::string>> subdirectories;
+        std::string name;
+        utils::query_directory(
+            directory,
+            [&](const FILE_FULL_DIR_INFO &info, const std::wstring_view &wide)
+            {
+                utils::utf_convert(wide, name);
+                batch.push_back({prefix + name, info.FileAttributes, _combine(info.EndOfFile), _combine(info.LastWriteTime)});
+                if (recursive && _is_traversable(info.FileAttributes))
+                {
+                    subdirectories.emplace_back(_child(directory, wide), batch.back().name + '\\');
+                }
+
+                if (batch.size() == BATCH_SIZE)
+                {
+                    channel.push(std::move(batch));
+                    batch.clear();
+                    batch.reserve(BATCH_SIZE);
+                }
+            });
+
+        for (auto &subdirectory : subdirectories)
+        {
+            _walk(subdirectory.first, subdirectory.second, recursive, channel, batch);
+        }
+    }
+
+    /** @brief Replace the size of the directories among `entries` with the total size of their files, in parallel */
+    static void _compute_totals(const std::wstring &directory, std::vector<_Entry> &entries, const std::size_t workers)
+    {
+        std::vector<std::atomic<unsigned long long>> totals(entries.size());
+        utils::WorkStealingPool<_Task> pool(
+            workers,
+            [&](std::size_t worker, _Task &task)
+            {
+                // The sizes are added up locally, so that workers only share one update per directory
+                unsigned long long size = 0;
+                utils::query_directory(
+                    task.path,
+                    [&](const FILE_FULL_DIR_INFO &info, const std::wstring_view &name)
+                    {
+                        if (_is_traversable(info.FileAttributes))
+                        {
+                            pool.push(worker, {_child(task.path, name), task.entry});
+                        }
+                        else if (!(info.FileAttributes & FILE_ATTRIBUTE_DIRECTORY))
+                        {
+                            size += _combine(info.EndOfFile);
+                        }
+                    });
+
+                totals[task.entry] += size;
+            });
+
+        for (std::size_t i = 0; i < entries.size(); i++)
+        {
+            if (_is_traversable(entries[i].attributes))
+            {
+                pool.push(i % pool.size(), {_child(directory, utils::utf_convert(entries[i].name)), i});
+            }
+        }
+
+        pool.run();
+        for (std::size_t i = 0; i < entries.size(); i++)
+        {
+            if (entries[i].attributes & FILE_ATTRIBUTE_DIRECTORY)
+            {
+                entries[i].size = totals[i];
+            }
+        }
+    }
+
+    /** @brief The display order of `entries` for a sort mode */
+    static std::vector<std::size_t> _sort(const std::vector<_Entry> &entries, const std::string &mode)
+    {
+        std::vector<_Key> keys(entries.size());
+        for (std::size_t i = 0; i < entries.size(); i++)
+        {
+            auto &entry = entries[i];
+            keys[i] = {mode == "name" ? _name_prefix(entry.name) : mode == "size" ? entry.size : entry.modified, i};
+        }
+
+        if (mode == "name")
+        {
+            std::sort(
+                keys.begin(), keys.end(),
+                [&entries](const _Key &first, const _Key &second)
+                {
+                    if (first.key != second.key)
+                    {
+                        return first.key < second.key;
+                    }
+
+                    return _name_before(entries[first.index].name, entries[second.index].name) ||
+                           (!_name_before(entries[second.index].name, entries[first.index].name) && first.index < second.index);
+                });
+        }
+        else
+        {
+            // The largest and most recent entries come first, equal ones keep their enumeration order
+            std::sort(
+                keys.begin(), keys.end(),
+                [](const _Key &first, const _Key &second)
+                {
+                    return first.key != second.key ? first.key > second.key : first.index < second.index;
+                });
+        }
+
+        std::vector<std::size_t> order(keys.size());
+        for (std::size_t i = 0; i < keys.size(); i++)
+        {
+            order[i] = keys[i].index;
+        }
+
+        return order;
+    }
+
 public:
+    static inline const liteshell::BaseCommand::Metadata metadata = {"ls", {"dir"}};
+
     LsCommand()
         : liteshell::BaseCommand(
-              "ls",
+              metadata,
               "Display the content of a directory",
-              "",
-              {"dir"},
-              liteshell::CommandConstraint("dir", "The directory to explore (default: the working directory)", false)) {}
+              "Entries are listed in enumeration order as they are read, with their size and last write time. With -R,\n"
+              "the subdirectories are listed as well, after the entries of their parent. With --sort, entries are sorted\n"
+              "by name, by size (largest first) or by last write time (most recent first) before being displayed. With\n"
+              "--summary, the size of each subdirectory is the total size of its files, computed by several threads, and\n"
+              "the number of entries and their total size are displayed after the table.",
+              liteshell::CommandConstraint("dir", "The directory to explore (default: the working directory)", false)
+                  .add_option("-R", "--recursive", "List the subdirectories recursively", {}, false)
+                  .add_option(
+                      "--sort",
+                      "Sort the entries",
+                      liteshell::PositionalArgument("mode", "The sort order: name, size or mtime", false, true))
+                  .add_option("--summary", "Display the total size of subdirectories and a summary", {}, false)
+                  .add_option(
+                      "-j", "--jobs",
+                      "The number of threads computing the sizes of subdirectories (default: the number of processors)",
+                      liteshell::PositionalArgument("workers", "The number of workers", false, true))) {}
 
     DWORD run(const liteshell::Context &context)
     {
-        auto directory = utils::get_working_directory();
-        try
+        auto directory = context.try_get("dir").value_or(utils::get_working_directory());
+        auto recursive = context.present.count("-R") == 1, summary = context.present.count("--summary") == 1;
+
+        auto mode = context.try_get("--sort mode");
+        if (mode.has_value() && *mode != "name" && *mode != "size" && *mode != "mtime")
         {
-            directory = context.get("dir");
+            throw std::invalid_argument("The sort order must be one of name, size or mtime");
         }
-        catch (liteshell::ArgumentMissingError &)
+
+        std::size_t workers = std::max(1u, std::thread::hardware_concurrency());
+        if (context.present.count("-j"))
+        {
+            workers = std::stoul(context.get("-j workers"));
+            if (workers == 0)
+            {
+                throw std::invalid_argument("The number of workers must be positive");
+            }
+        }
+
+        auto wide = utils::utf_convert(directory);
+        while (wide.size() > 1 && (wide.back() == L'\\' || wide.back() == L'/') && wide[wide.size() - 2] != L':')
         {
-            // pass
+            wide.pop_back();
         }
 
-        std::cout << "Exploring " << directory << std::endl;
+        auto attributes = GetFileAttributesW(wide.c_str());
+        if (attributes == INVALID_FILE_ATTRIBUTES || !(attributes & FILE_ATTRIBUTE_DIRECTORY))
+        {
+            throw std::invalid_argument("The specified directory does not exist");
+        }
 
-        utils::Table displayer("Name", "Type", "Size");
+        std::cout << "Exploring " << directory << '\n';
 
-        for (const auto &data : utils::list_files(utils::join(directory, "*")))
+        utils::Table displayer("Name", "Type", "Size", "Modified");
+        std::size_t files = 0, directories = 0;
+        unsigned long long total = 0;
+        auto display = [&](const _Entry &entry)
         {
-            long double size = ((long double)data.nFileSizeHigh * ((long double)MAXDWORD + 1.0L)) + (long double)data.nFileSizeLow;
-            bool is_directory = data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY;
+            bool is_directory = entry.attributes & FILE_ATTRIBUTE_DIRECTORY;
             displayer.add_row(
-                utils::utf_convert(std::wstring(data.cFileName)),
+                entry.name,
                 is_directory ? "DIR" : "FILE",
-                is_directory ? "-" : utils::memory_size(size));
+                is_directory && !(summary && !recursive) ? "-" : utils::memory_size(entry.size),
+                _local_time(entry.modified));
+
+            (is_directory ? directories : files)++;
+            if (!is_directory || !recursive)
+            {
+                total += entry.size;
+            }
+        };
+
+        // The directory is enumerated on another thread, at most CAPACITY batches ahead of the display
+        _Channel channel;
+        std::exception_ptr error;
+        std::thread walker(
+            [&]()
+            {
+                try
+                {
+                    std::vector<_Entry> batch;
+                    batch.reserve(BATCH_SIZE);
+                    _walk(wide, "", recursive, channel, batch);
+                    if (!batch.empty())
+                    {
+                        channel.push(std::move(batch));
+                    }
+                }
+                catch (...)
+                {
+                    error = std::current_exception();
+                }
+
+                channel.close();
+            });
+
+        // Sorting and directory totals need all entries, otherwise they are displayed as they are enumerated
+        auto collect = mode.has_value() || (summary && !recursive);
+        std::vector<_Entry> entries, batch;
+        try
+        {
+            if (!collect)
+            {
+                displayer.stream(std::cout);
+            }
+
+            while (channel.pop(batch))
+            {
+                for (auto &entry : batch)
+                {
+                    if (collect)
+                    {
+                        entries.push_back(std::move(entry));
+                    }
+                    else
+                    {
+                        display(entry);
+                    }
+                }
+            }
+        }
+        catch (...)
+        {
+            channel.close();
+            walker.join();
+            throw;
+        }
+
+        walker.join();
+        if (error)
+        {
+            std::rethrow_exception(error);
         }
 
-        std::cout << displayer.display() << std::endl;
+        if (collect)
+        {
+            if (summary && !recursive)
+            {
+                _compute_totals(wide, entries, workers);
+            }
+
+            displayer.stream(std::cout);
+            if (mode.has_value())
+            {
+                for (auto index : _sort(entries, *mode))
+                {
+                    display(entries[index]);
+                }
+            }
+            else
+            {
+                for (auto &entry : entries)
+                {
+                    display(entry);
+                }
+            }
+        }
+
+        displayer.finish();
+        std::cout << '\n';
+
+        if (summary)
+        {
+            std::cout << utils::format("%zu file(s) and %zu folder(s), %s in total", files, directories, utils::memory_size(total).c_str()) << '\n';
+        }
 
         return 0;
     }
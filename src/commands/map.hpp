@@ -0,0 +1,60 @@
+#pragma once
+
+#include <all.hpp>
+
+class MapCommand : public liteshell::BaseCommand
+{
+public:
+    static inline const liteshell::BaseCommand::Metadata metadata = {"map", {}};
+
+    MapCommand()
+        : liteshell::BaseCommand(
+              metadata,
+              "Assign an associative map to an environment variable",
+              "Examples: \"map ages alice 30 bob 25\", \"map ages -u carol 41\".\n"
+              "Entries are read with \"${ages[alice]}\", the number of entries with \"${#ages}\", all values with\n"
+              "\"${ages[@]}\" and all keys with \"${!ages[@]}\" (sorted by key).\n"
+              "An entry is assigned with \"eval -s ages[alice] 31\".",
+              liteshell::CommandConstraint(
+                  "name", "The name of the map", true,
+                  "entries", "The keys and values of the entries, alternately", false,
+                  true)
+                  .add_option("-u", "--update", "Add the entries to the map instead of replacing it", {}, false))
+    {
+    }
+
+    DWORD run(const liteshell::Context &context)
+    {
+        auto name = context.get("name");
+        if (!utils::is_valid_variable(name))
+        {
+            throw std::invalid_argument(utils::format("Invalid variable name \"%s\"", name.c_str()));
+        }
+
+        std::vector<std::string> entries;
+        auto iter = context.values.find("entries");
+        if (iter != context.values.end())
+        {
+            entries = iter->second;
+        }
+
+        if (entries.size() % 2 != 0)
+        {
+            throw std::invalid_argument(utils::format("Missing the value of key \"%s\"", entries.back().c_str()));
+        }
+
+        auto environment = context.client->get_environment();
+        auto handle = environment->intern(name);
+        if (!context.present.count("-u") || environment->get_type(name) != liteshell::Environment::MAP)
+        {
+            environment->set_map(handle);
+        }
+
+        for (std::size_t i = 0; i < entries.size(); i += 2)
+        {
+            environment->set_element(handle, entries[i], entries[i + 1]);
+        }
+
+        return 0;
+    }
+};
@@ -5,11 +5,13 @@
 class MemoryCommand : public liteshell::BaseCommand
 {
 public:
+    static inline const liteshell::BaseCommand::Metadata metadata = {"memory", {}};
+
     MemoryCommand()
         : liteshell::BaseCommand(
-              "memory",
+              metadata,
               "Display global memory status",
-              "",
+              "Also display the memory used by the scripts buffered in the input stream",
               liteshell::CommandConstraint()) {}
 
     DWORD run(const liteshell::Context &context)
@@ -20,7 +22,12 @@ public:
         display.add_row("Total physical memory", utils::memory_size(status.ullTotalPhys));
         display.add_row("Available physical memory", utils::memory_size(status.ullAvailPhys));
 
-        std::cout << display.display() << std::endl;
+        auto statistics = context.client->get_stream()->statistics();
+        display.add_row("Input stream frames", utils::format("%zu (%zu loop(s), %zu call(s))", statistics.frames, statistics.loops, statistics.calls));
+        display.add_row("Buffered instructions", std::to_string(statistics.instructions));
+        display.add_row("Buffered scripts", utils::format("%zu (%s)", statistics.scripts, utils::memory_size(statistics.bytes).c_str()));
+
+        std::cout << display.display() << '\n';
 
         return 0;
     }
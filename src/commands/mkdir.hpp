@@ -5,12 +5,13 @@
 class MkdirCommand : public liteshell::BaseCommand
 {
 public:
+    static inline const liteshell::BaseCommand::Metadata metadata = {"mkdir", {"md"}};
+
     MkdirCommand()
         : liteshell::BaseCommand(
-              "mkdir",
+              metadata,
               "Make a new directory",
               "",
-              {"md"},
               liteshell::CommandConstraint("dir", "The name of the new directory", true)) {}
 
     DWORD run(const liteshell::Context &context)
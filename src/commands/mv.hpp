@@ -5,9 +5,11 @@
 class MvCommand : public liteshell::BaseCommand
 {
 public:
+    static inline const liteshell::BaseCommand::Metadata metadata = {"mv", {}};
+
     MvCommand()
         : liteshell::BaseCommand(
-              "mv",
+              metadata,
               "Moves files and renames files and directories",
               "",
               liteshell::CommandConstraint(
@@ -0,0 +1,150 @@
+#pragma once
+
+#include <all.hpp>
+
+class ParallelCommand : public liteshell::BaseCommand
+{
+private:
+    std::vector<std::string> get_lines(const liteshell::Context &context, const bool force_stream)
+    {
+        std::vector<std::string> lines;
+        while (true)
+        {
+            auto input = utils::strip(context.client->get_stream()->getline(
+                []()
+                { std::cout << "parallel>" << std::flush; },
+                force_stream ? liteshell::InputStream::FORCE_STREAM : 0));
+            if (utils::startswith(input, "endparallel"))
+            {
+                break;
+            }
+
+            if (!input.empty() && input[0] != ':')
+            {
+                lines.push_back(input);
+            }
+        }
+
+        return lines;
+    }
+
+public:
+    static inline const liteshell::BaseCommand::Metadata metadata = {"parallel", {}};
+
+    ParallelCommand()
+        : liteshell::BaseCommand(
+              metadata,
+              "Run executables concurrently",
+              "Each line until \"endparallel\" is an executable invocation, with at most <jobs> of them running at the same\n"
+              "time. Once all lines have finished, the exit code of line i (counting from 0) is stored in the variable\n"
+              "<prefix>_i and the errorlevel is set to the number of lines with a non-zero exit code.",
+              liteshell::CommandConstraint()
+                  .add_option(
+                      "-j", "--jobs",
+                      "The maximum number of concurrent jobs (default: the number of processors, at most 64)",
+                      liteshell::PositionalArgument("jobs", "The maximum number of concurrent jobs", false, true),
+                      false)
+                  .add_option(
+                      "-s", "--save",
+                      "The prefix of the variables holding the exit codes (default: \"parallel\")",
+                      liteshell::PositionalArgument("prefix", "The variable prefix", false, true),
+                      false))
+    {
+    }
+
+    DWORD run(const liteshell::Context &context)
+    {
+        std::size_t jobs = std::max(1u, std::thread::hardware_concurrency());
+        if (context.present.count("-j"))
+        {
+            jobs = std::stoul(context.get("-j jobs"));
+            if (jobs == 0)
+            {
+                throw std::invalid_argument("The number of jobs must be positive");
+            }
+        }
+
+        // WaitForMultipleObjects accepts at most MAXIMUM_WAIT_OBJECTS handles
+        jobs = std::min<std::size_t>(jobs, MAXIMUM_WAIT_OBJECTS);
+
+        auto prefix = context.present.count("-s") ? context.get("-s prefix") : "parallel";
+        if (!utils::is_valid_variable(prefix))
+        {
+            throw std::invalid_argument(utils::format("Invalid variable name \"%s\"", prefix.c_str()));
+        }
+
+        auto client = context.client;
+        auto environment = client->get_environment();
+        auto lines = get_lines(context, !client->get_stream()->exhaust());
+
+        // Resolve every line before starting any job, so that an invalid line does not leave jobs behind
+        std::vector<liteshell::Context> commands;
+        commands.reserve(lines.size());
+        for (auto &line : lines)
+        {
+            commands.push_back(client->resolve_executable(utils::strip(environment->resolve(line))));
+        }
+
+        std::vector<DWORD> exit_codes(commands.size());
+        std::vector<std::pair<liteshell::ProcessInfoWrapper *, std::size_t>> running;
+        std::exception_ptr error;
+
+        std::size_t next = 0;
+        while (next < commands.size() || !running.empty())
+        {
+            while (!error && next < commands.size() && running.size() < jobs)
+            {
+                try
+                {
+                    running.emplace_back(client->spawn_subprocess(commands[next]), next);
+                    next++;
+                }
+                catch (...)
+                {
+                    // Stop scheduling new jobs, but still wait for the running ones
+                    error = std::current_exception();
+                    next = commands.size();
+                }
+            }
+
+            if (running.empty())
+            {
+                break;
+            }
+
+            std::vector<HANDLE> handles;
+            for (auto &job : running)
+            {
+                handles.push_back(job.first->handle());
+            }
+
+            auto result = WaitForMultipleObjects(handles.size(), handles.data(), FALSE, INFINITE);
+            if (result >= WAIT_OBJECT_0 + handles.size())
+            {
+                throw std::runtime_error(utils::last_error("WaitForMultipleObjects ERROR"));
+            }
+
+            auto job = running.begin() + (result - WAIT_OBJECT_0);
+            job->first->wait(0);
+            exit_codes[job->second] = job->first->exit_code();
+            running.erase(job);
+        }
+
+        if (error)
+        {
+            std::rethrow_exception(error);
+        }
+
+        DWORD failed = 0;
+        for (std::size_t i = 0; i < exit_codes.size(); i++)
+        {
+            environment->set_value(utils::format("%s_%zu", prefix.c_str(), i), std::to_string(exit_codes[i]));
+            if (exit_codes[i] != 0)
+            {
+                failed++;
+            }
+        }
+
+        return failed;
+    }
+};
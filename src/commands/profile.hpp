@@ -0,0 +1,95 @@
+#pragma once
+
+#include <all.hpp>
+
+class ProfileCommand : public liteshell::BaseCommand
+{
+private:
+    static std::size_t get_top(const liteshell::Context &context)
+    {
+        auto top = context.try_get("-n count");
+        return top.has_value() ? std::stoul(*top) : 10;
+    }
+
+    static void start(const liteshell::Context &context)
+    {
+        if (context.client->get_profiler() != nullptr)
+        {
+            throw std::invalid_argument("The shell is already being profiled");
+        }
+
+        context.client->set_profiler(std::make_shared<liteshell::Profiler>(context.try_get("-t path").value_or("")));
+    }
+
+public:
+    static inline const liteshell::BaseCommand::Metadata metadata = {"profile", {}};
+
+    ProfileCommand()
+        : liteshell::BaseCommand(
+              metadata,
+              "Measure the time spent by each line and each built-in command",
+              "\"profile start\" starts recording and \"profile stop\" displays the lines and the built-in commands which\n"
+              "took the most time, split into resolving, argument parsing, executing and waiting for subprocesses (in\n"
+              "milliseconds). \"profile run <script>\" profiles a batch script until it ends.\n"
+              "With -t, every measurement is also written to a trace file, which can be opened in chrome://tracing or\n"
+              "https://ui.perfetto.dev.",
+              liteshell::CommandConstraint(
+                  "action", "One of \"start\", \"stop\" or \"run\"", true,
+                  "script", "The batch script to run with \"run\"", false)
+                  .add_option(
+                      "-n", "--top",
+                      "The number of lines and commands to display (default: 10)",
+                      liteshell::PositionalArgument("count", "The number of rows", false, true),
+                      false)
+                  .add_option(
+                      "-t", "--trace",
+                      "Write a Chrome trace of the profile to a file",
+                      liteshell::PositionalArgument("path", "The path to the trace file", false, true),
+                      false))
+    {
+    }
+
+    DWORD run(const liteshell::Context &context)
+    {
+        auto action = context.get("action");
+        if (action == "start")
+        {
+            start(context);
+        }
+        else if (action == "stop")
+        {
+            auto profiler = context.client->get_profiler();
+            if (profiler == nullptr)
+            {
+                throw std::invalid_argument("The shell is not being profiled");
+            }
+
+            context.client->set_profiler(nullptr);
+            profiler->display(get_top(context));
+            profiler->write_trace();
+        }
+        else if (action == "run")
+        {
+            auto script = context.try_get("script");
+            if (!script.has_value())
+            {
+                throw std::invalid_argument("No batch script to profile");
+            }
+
+            auto compiled = context.client->get_batch_file(*script);
+            start(context);
+
+            // The report is read right after the script ends, without being echoed
+            std::vector<std::string> report = {"@OFF", utils::format("profile stop -n %zu", get_top(context))};
+            auto stream = context.client->get_stream();
+            stream->write(context.client->compile(report.begin(), report.end()), true);
+            stream->write(compiled, true);
+        }
+        else
+        {
+            throw std::invalid_argument(utils::format("Unknown action \"%s\"", action.c_str()));
+        }
+
+        return 0;
+    }
+};
@@ -4,22 +4,56 @@
 
 class PsCommand : public liteshell::BaseCommand
 {
+private:
+    /** @brief Format a UTC time as the local time of day */
+    static std::string _local_time(const FILETIME &time)
+    {
+        SYSTEMTIME utc, local;
+        if (!FileTimeToSystemTime(&time, &utc) || !SystemTimeToTzSpecificLocalTime(NULL, &utc, &local))
+        {
+            return "?";
+        }
+
+        return utils::format("%02d:%02d:%02d", local.wHour, local.wMinute, local.wSecond);
+    }
+
+    static std::string _status(const DWORD status)
+    {
+        switch (status)
+        {
+        case STILL_ACTIVE:
+            return "STILL_ACTIVE";
+        case STATUS_CONTROL_C_EXIT:
+            return "CONTROL_C_EXIT";
+        case STATUS_STACK_BUFFER_OVERRUN:
+            return "STACK_BUFFER_OVERRUN";
+        default:
+            return std::to_string(status);
+        }
+    }
+
 public:
+    static inline const liteshell::BaseCommand::Metadata metadata = {"ps", {}};
+
     PsCommand()
         : liteshell::BaseCommand(
-              "ps",
+              metadata,
               "Get all subprocesses of the current shell, regardless of their states",
-              "",
-              liteshell::CommandConstraint()) {}
+              "Each subprocess runs in its own job object, its CPU time, peak committed memory and I/O include those of\n"
+              "its descendants. They are sampled when the command runs for the running subprocesses, and when they exit\n"
+              "for the others. See also \"limit\" to cap the memory and CPU usage of new subprocesses.\n"
+              "Built-in commands and batch scripts started in the background are listed as tasks, e.g. \"%1\".",
+              liteshell::CommandConstraint()
+                  .add_option("-s", "Also display the time spent creating subprocesses")) {}
 
     DWORD run(const liteshell::Context &context)
     {
-        utils::Table displayer("PID", "Command line", "Exit code", "Suspended");
+        utils::Table displayer("PID", "Command line", "Exit code", "Suspended", "CPU time", "Peak memory", "Read", "Written", "Started", "Ended");
         try
         {
             // This will throw std::runtime_error when running as a subprocess (testing with pytest for example)
             std::size_t columns = utils::get_console_size().first;
-            displayer.limits = {7, columns - 40, 20, 10};
+            displayer.limits = {7, std::max<std::size_t>(20, columns - std::min<std::size_t>(columns, 130)), 20, 10, 12, 12, 12, 12, 10, 10};
         }
         catch (std::runtime_error &)
         {
@@ -28,29 +62,53 @@ public:
 
         for (auto wrapper_ptr : context.client->get_subprocesses())
         {
-            std::string status_display;
-            auto status = wrapper_ptr->exit_code();
-            switch (status)
-            {
-            case STILL_ACTIVE:
-                status_display = "STILL_ACTIVE";
-                break;
-            case STATUS_CONTROL_C_EXIT:
-                status_display = "CONTROL_C_EXIT";
-                break;
-            case STATUS_STACK_BUFFER_OVERRUN:
-                status_display = "STACK_BUFFER_OVERRUN";
-                break;
-            default:
-                status_display = std::to_string(status);
-                break;
-            }
-
             std::string suspend_display = wrapper_ptr->is_suspended() ? "Yes" : "No";
-            displayer.add_row(std::to_string(wrapper_ptr->pid()), wrapper_ptr->command, status_display, suspend_display);
+
+            auto usage = wrapper_ptr->usage();
+            auto end_time = wrapper_ptr->end_time();
+            displayer.add_row(
+                std::to_string(wrapper_ptr->pid()),
+                wrapper_ptr->command,
+                _status(wrapper_ptr->exit_code()),
+                suspend_display,
+                utils::format("%.3fs", std::chrono::duration<double>(usage.cpu_time()).count()),
+                usage.peak_memory.has_value() ? utils::memory_size(*usage.peak_memory) : "-",
+                utils::memory_size(usage.read_bytes),
+                utils::memory_size(usage.write_bytes),
+                _local_time(wrapper_ptr->start_time()),
+                end_time.has_value() ? _local_time(*end_time) : "-");
+        }
+
+        // Background tasks run inside the shell, their resources are accounted to it
+        for (auto &task : context.client->get_tasks())
+        {
+            auto end_time = task->end_time();
+            displayer.add_row(
+                task->name(),
+                task->command,
+                _status(task->exit_code()),
+                task->is_suspended() ? "Yes" : "No",
+                "-", "-", "-", "-",
+                _local_time(task->start_time()),
+                end_time.has_value() ? _local_time(*end_time) : "-");
         }
 
-        std::cout << displayer.display() << std::endl;
+        std::cout << displayer.display() << '\n';
+
+        if (context.present.count("-s"))
+        {
+            auto statistics = context.client->get_spawn_statistics();
+            auto microseconds = [](const std::chrono::nanoseconds &duration)
+            {
+                return std::chrono::duration_cast<std::chrono::microseconds>(duration).count();
+            };
+
+            std::cout << utils::format(
+                "Spawned %zu subprocess(es): %lld us on average, %lld us at most\n",
+                statistics.count,
+                static_cast<long long>(microseconds(statistics.mean())),
+                static_cast<long long>(microseconds(statistics.max)));
+        }
 
         return 0;
     }
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <all.hpp>
+
+class ReturnCommand : public liteshell::BaseCommand
+{
+public:
+    static inline const liteshell::BaseCommand::Metadata metadata = {"return", {}};
+
+    ReturnCommand()
+        : liteshell::BaseCommand(
+              metadata,
+              "Return from the current subroutine",
+              "Execution continues after the \"call\" line of the subroutine.\n"
+              "If no errorlevel is specified, the current errorlevel is kept.",
+              liteshell::CommandConstraint("errorlevel", "The errorlevel to return with", false))
+    {
+    }
+
+    DWORD run(const liteshell::Context &context)
+    {
+        context.client->get_stream()->leave_call();
+
+        auto errorlevel = context.try_get("errorlevel");
+        return errorlevel.has_value() ? std::stoul(*errorlevel) : context.client->get_errorlevel();
+    }
+};
@@ -5,43 +5,64 @@
 class RmCommand : public liteshell::BaseCommand
 {
 public:
+    static inline const liteshell::BaseCommand::Metadata metadata = {"rm", {}};
+
     RmCommand()
         : liteshell::BaseCommand(
-              "rm",
+              metadata,
               "Remove one or many files/directories",
-              "If any of the targets is a directory, remove it recursively",
-              liteshell::CommandConstraint("targets", "The targets to remove", true, true)) {}
+              "If any of the targets is a directory, remove it recursively. The progress is displayed every second,\n"
+              "followed by the number of removed items. The errorlevel is set to the number of items which could not\n"
+              "be removed.",
+              liteshell::CommandConstraint("targets", "The targets to remove", true, true)
+                  .add_option("-q", "--quiet", "Only display the number of removed items", std::vector<liteshell::PositionalArgument>())) {}
 
     DWORD run(const liteshell::Context &context)
     {
+        auto quiet = context.present.count("-q") == 1;
+
+        utils::ParallelRemover remover;
         for (auto &target : context.values.at("targets"))
         {
-            auto targets = utils::list_files(target);
-            if (targets.empty())
+            utils::FindFiles matches(target);
+            if (matches.empty())
             {
                 auto message = utils::format("Warning: Target \"%s\" does not exist", target.c_str());
                 std::cerr << message << std::endl;
                 continue;
             }
 
-            for (auto &target : targets)
+            // The matches are names, relative to the directory of the pattern
+            auto wide = utils::utf_convert(target);
+            auto separator = wide.find_last_of(L"\\/");
+            auto parent = separator == std::wstring::npos ? std::wstring() : wide.substr(0, separator + 1);
+
+            for (auto &data : matches)
             {
-                if (target.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+                if (wcscmp(data.cFileName, L".") != 0 && wcscmp(data.cFileName, L"..") != 0)
                 {
-                    utils::remove_directory(utils::utf_convert(target.cFileName), true);
+                    remover.remove(parent + data.cFileName, data.dwFileAttributes);
                 }
-                else if (DeleteFileW(target.cFileName))
-                {
-                    std::cout << "Deleted " << target.cFileName << std::endl;
-                }
-                else
+            }
+        }
+
+        auto statistics = remover.wait(
+            [&quiet](const utils::ParallelRemover::Statistics &statistics)
+            {
+                if (!quiet)
                 {
-                    auto message = utils::last_error(utils::format("Error deleting file \"%s\"", utils::utf_convert(target.cFileName).c_str()));
-                    std::cerr << message << std::endl;
+                    std::cout << utils::format("Deleted %zu file(s) and %zu folder(s)...", statistics.files, statistics.directories) << std::endl;
                 }
-            }
+            },
+            std::chrono::seconds(1));
+
+        auto errors = remover.errors();
+        for (auto &error : errors)
+        {
+            std::cerr << error << '\n';
         }
 
-        return 0;
+        std::cout << utils::format("Deleted %zu file(s) and %zu folder(s)", statistics.files, statistics.directories) << '\n';
+        return errors.size();
     }
 };
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <all.hpp>
+
+class SortCommand : public liteshell::BaseCommand
+{
+public:
+    static inline const liteshell::BaseCommand::Metadata metadata = {"sort", {}};
+
+    SortCommand()
+        : liteshell::BaseCommand(
+              metadata,
+              "Sort the lines of files or of the redirected input",
+              "The sort is stable: lines comparing equal keep their input order. With -n, the numbers at the beginning\n"
+              "of the lines are compared, a line without a number counting as 0. Lines are sorted in memory by several\n"
+              "threads while they fit in the memory budget. Larger inputs are split into sorted runs, written to\n"
+              "temporary files and merged at the end.",
+              liteshell::CommandConstraint("files", "The files to sort (default: the redirected input)", false, true)
+                  .add_option("-n", "--numeric", "Compare the numbers at the beginning of the lines", {}, false)
+                  .add_option("-r", "--reverse", "Sort in descending order", {}, false)
+                  .add_option(
+                      "-m", "--memory",
+                      "The memory budget before spilling to disk, in megabytes (default: 256)",
+                      liteshell::PositionalArgument("megabytes", "The memory budget", false, true))
+                  .add_option(
+                      "-j", "--jobs",
+                      "The number of threads sorting in memory (default: the number of processors)",
+                      liteshell::PositionalArgument("workers", "The number of workers", false, true))) {}
+
+    DWORD run(const liteshell::Context &context)
+    {
+        std::size_t megabytes = 256;
+        if (context.present.count("-m"))
+        {
+            megabytes = std::stoull(context.get("-m megabytes"));
+            if (megabytes == 0 || megabytes > std::numeric_limits<std::size_t>::max() / (1 << 20))
+            {
+                throw std::invalid_argument("The memory budget must be a positive number of megabytes");
+            }
+        }
+
+        std::size_t workers = std::max(1u, std::thread::hardware_concurrency());
+        if (context.present.count("-j"))
+        {
+            workers = std::stoul(context.get("-j workers"));
+            if (workers == 0)
+            {
+                throw std::invalid_argument("The number of workers must be positive");
+            }
+        }
+
+        utils::LineSorter sorter(context.present.count("-n"), context.present.count("-r"), megabytes << 20, workers);
+        if (context.present.count("files"))
+        {
+            for (auto &path : context.values.at("files"))
+            {
+                // Only the lines are copied, the mapping is released before the next file
+                utils::MappedFile file(path);
+                sorter.add_lines(file.view());
+            }
+        }
+        else
+        {
+            if (!utils::StandardStreams::is_input_redirected())
+            {
+                throw std::invalid_argument("No file was specified and the input is not redirected");
+            }
+
+            utils::read_lines(
+                *utils::StandardStreams::input().rdbuf(),
+                [&sorter](const std::string_view &chunk)
+                {
+                    sorter.add_lines(chunk);
+                });
+        }
+
+        sorter.finish(std::cout);
+        return 0;
+    }
+};
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <all.hpp>
+
+class StatsCommand : public liteshell::BaseCommand
+{
+public:
+    static inline const liteshell::BaseCommand::Metadata metadata = {"stats", {}};
+
+    StatsCommand()
+        : liteshell::BaseCommand(
+              metadata,
+              "Display the counters of the shell since it started",
+              "The counters are always on: commands dispatched, messages whose variables were resolved and the time\n"
+              "spent resolving them, the time spent parsing arguments, subprocesses spawned, bytes of instructions read\n"
+              "from the input stream and the peak working set of the shell. They are also stored in the map \"stats\",\n"
+              "e.g. \"${stats[commands]}\", times are in nanoseconds and sizes in bytes.",
+              liteshell::CommandConstraint()
+                  .add_option("-q", "--quiet", "Only update the \"stats\" variable", {}, false)
+                  .add_option("-r", "--reset", "Reset the counters after reading them", {}, false)) {}
+
+    DWORD run(const liteshell::Context &context)
+    {
+        auto &counters = liteshell::Counters::global();
+
+        std::uint64_t values[liteshell::Counters::COUNTERS];
+        for (std::size_t i = 0; i < liteshell::Counters::COUNTERS; i++)
+        {
+            values[i] = counters.get(static_cast<liteshell::Counters::Counter>(i));
+        }
+
+        if (context.present.count("-r"))
+        {
+            counters.reset();
+        }
+
+        PROCESS_MEMORY_COUNTERS memory;
+        if (!GetProcessMemoryInfo(GetCurrentProcess(), &memory, sizeof(memory)))
+        {
+            throw std::runtime_error(utils::last_error("Unable to query the memory usage"));
+        }
+
+        auto environment = context.client->get_environment();
+        auto handle = environment->intern("stats");
+        environment->set_map(handle);
+        for (std::size_t i = 0; i < liteshell::Counters::COUNTERS; i++)
+        {
+            environment->set_element(handle, liteshell::Counters::name(static_cast<liteshell::Counters::Counter>(i)), std::to_string(values[i]));
+        }
+
+        environment->set_element(handle, "peak_memory", std::to_string(memory.PeakWorkingSetSize));
+
+        if (!context.present.count("-q"))
+        {
+            auto milliseconds = [](const std::uint64_t nanoseconds)
+            {
+                return utils::format("%.3lf ms", nanoseconds / 1e6);
+            };
+
+            auto display = utils::Table("Counter", "Value");
+            display.add_row("Commands dispatched", std::to_string(values[liteshell::Counters::COMMANDS]));
+            display.add_row("Lines resolved", std::to_string(values[liteshell::Counters::LINES_RESOLVED]));
+            display.add_row("Resolve time", milliseconds(values[liteshell::Counters::RESOLVE_TIME]));
+            display.add_row("Parse time", milliseconds(values[liteshell::Counters::PARSE_TIME]));
+            display.add_row("Subprocesses spawned", std::to_string(values[liteshell::Counters::SUBPROCESSES]));
+            display.add_row("Bytes read from the stream", utils::memory_size(values[liteshell::Counters::STREAM_BYTES]));
+            display.add_row("Peak memory", utils::memory_size(memory.PeakWorkingSetSize));
+
+            std::cout << display.display() << '\n';
+        }
+
+        return 0;
+    }
+};
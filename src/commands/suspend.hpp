@@ -5,22 +5,33 @@
 class SuspendCommand : public liteshell::BaseCommand
 {
 public:
+    static inline const liteshell::BaseCommand::Metadata metadata = {"suspend", {}};
+
     SuspendCommand()
         : liteshell::BaseCommand(
-              "suspend",
+              metadata,
               "Suspend a subprocess with the given PID",
-              "",
-              liteshell::CommandConstraint("pid", "The PID of the target process", true)) {}
+              "A background task started with \"%\" is named e.g. \"%1\", see \"ps\". It pauses before its next\n"
+              "instruction, once its running command returns.",
+              liteshell::CommandConstraint("pid", "The PID of the target process or the name of the target task", true)) {}
 
     DWORD run(const liteshell::Context &context)
     {
-        DWORD pid = std::stoul(context.get("pid"));
+        auto target = context.get("pid");
+        if (liteshell::BackgroundTask::is_name(target))
+        {
+            context.client->get_task(target)->suspend();
+            std::cout << "Suspended task " << target << '\n';
+            return 0;
+        }
+
+        DWORD pid = std::stoul(target);
         for (auto wrapper_ptr : context.client->get_subprocesses())
         {
             if (wrapper_ptr->pid() == pid)
             {
                 wrapper_ptr->suspend();
-                std::cout << "Suspended process ID " << wrapper_ptr->pid() << ", thread ID " << wrapper_ptr->tid() << std::endl;
+                std::cout << "Suspended process ID " << wrapper_ptr->pid() << ", thread ID " << wrapper_ptr->tid() << '\n';
                 return 0;
             }
         }
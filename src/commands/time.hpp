@@ -0,0 +1,190 @@
+#pragma once
+
+#include <all.hpp>
+
+class TimeCommand : public liteshell::BaseCommand
+{
+private:
+    typedef std::chrono::nanoseconds duration;
+
+    /** @brief The measurements of a single run */
+    struct _Sample
+    {
+        duration wall, user, kernel;
+    };
+
+    /** @brief The state of the runs of a command, shared with the loop frame executing it */
+    struct _Runs
+    {
+        std::shared_ptr<liteshell::Client> client;
+        std::size_t count;
+        std::vector<_Sample> samples;
+
+        /** @brief The start of the current run: the time, the CPU time of the shell and the number of subprocesses */
+        std::chrono::steady_clock::time_point start;
+        duration user, kernel;
+        std::size_t subprocesses;
+    };
+
+    static duration _ticks(const FILETIME &time)
+    {
+        // FILETIME counts 100-nanosecond intervals
+        return duration(static_cast<duration::rep>(static_cast<ULONGLONG>(time.dwHighDateTime) << 32 | time.dwLowDateTime) * 100);
+    }
+
+    /** @brief The CPU time spent by the shell, in user mode and in kernel mode */
+    static std::pair<duration, duration> _shell_time()
+    {
+        FILETIME creation, exit, kernel, user;
+        if (!GetProcessTimes(GetCurrentProcess(), &creation, &exit, &kernel, &user))
+        {
+            return {duration(0), duration(0)};
+        }
+
+        return {_ticks(user), _ticks(kernel)};
+    }
+
+    static void _start(_Runs &runs)
+    {
+        std::tie(runs.user, runs.kernel) = _shell_time();
+        runs.subprocesses = runs.client->get_subprocesses().size();
+        runs.start = std::chrono::steady_clock::now();
+    }
+
+    /** @brief Measure the current run, including the subprocesses it created and their descendants */
+    static _Sample _stop(_Runs &runs)
+    {
+        _Sample sample;
+        sample.wall = std::chrono::steady_clock::now() - runs.start;
+
+        auto [user, kernel] = _shell_time();
+        sample.user = user - runs.user;
+        sample.kernel = kernel - runs.kernel;
+
+        auto subprocesses = runs.client->get_subprocesses();
+        for (auto i = runs.subprocesses; i < subprocesses.size(); i++)
+        {
+            auto usage = subprocesses[i]->usage();
+            sample.user += usage.user_time;
+            sample.kernel += usage.kernel_time;
+        }
+
+        return sample;
+    }
+
+    static std::string _milliseconds(const duration &time)
+    {
+        return utils::format("%.3fms", std::chrono::duration<double, std::milli>(time).count());
+    }
+
+    static void _report(const std::vector<_Sample> &samples)
+    {
+        const std::pair<const char *, duration _Sample::*> fields[] = {
+            {"Wall", &_Sample::wall},
+            {"User", &_Sample::user},
+            {"Kernel", &_Sample::kernel},
+        };
+
+        if (samples.size() == 1)
+        {
+            for (auto &[name, field] : fields)
+            {
+                std::cout << utils::format("%-8s", name) << _milliseconds(samples[0].*field) << '\n';
+            }
+
+            return;
+        }
+
+        utils::Table displayer("Time", "Min", "Median", "P95", "Max");
+        for (auto &[name, field] : fields)
+        {
+            std::vector<duration> values;
+            for (auto &sample : samples)
+            {
+                values.push_back(sample.*field);
+            }
+
+            // Nearest-rank percentiles
+            std::sort(values.begin(), values.end());
+            auto percentile = [&values](const std::size_t percent)
+            {
+                return values[std::max<std::size_t>(1, (values.size() * percent + 99) / 100) - 1];
+            };
+
+            displayer.add_row(name, _milliseconds(values.front()), _milliseconds(percentile(50)), _milliseconds(percentile(95)), _milliseconds(values.back()));
+        }
+
+        std::cout << samples.size() << " runs\n";
+        std::cout << displayer.display() << '\n';
+    }
+
+public:
+    static inline const liteshell::BaseCommand::Metadata metadata = {"time", {}};
+
+    TimeCommand()
+        : liteshell::BaseCommand(
+              metadata,
+              "Measure the wall, user and kernel time of a command",
+              "The command may be a built-in command, an executable or a batch script. The user and kernel times include\n"
+              "the shell and the subprocesses created by the command, with their descendants. With --repeat, the command\n"
+              "is run several times and the minimum, median, 95th percentile and maximum of each time are displayed.\n"
+              "The command runs after \"time\" returns, without echo: redirections of the \"time\" line do not apply to it.\n"
+              "Use -- before a command with options, e.g. \"time -r 10 -- ls -a\".",
+              liteshell::CommandConstraint("command", "The command to measure and its arguments", true, true)
+                  .add_option(
+                      "-r", "--repeat",
+                      "The number of runs (default: 1)",
+                      liteshell::PositionalArgument("count", "The number of runs", false, true),
+                      false)) {}
+
+    DWORD run(const liteshell::Context &context)
+    {
+        std::size_t count = 1;
+        if (context.present.count("-r"))
+        {
+            count = std::stoul(context.get("-r count"));
+            if (count == 0)
+            {
+                throw std::invalid_argument("The number of runs must be positive");
+            }
+        }
+
+        // The arguments were already resolved, their "$" are escaped so that they are not resolved again
+        auto &tokens = context.values.at("command");
+        auto escaped = utils::join_command(tokens.begin(), tokens.end());
+
+        auto client = context.client;
+        auto stream = client->get_stream();
+
+        // The bottom frame restores the echo state once the runs are over
+        std::vector<std::string> restore = {liteshell::InputStream::ECHO_OFF};
+        stream->write(client->compile(restore.begin(), restore.end()), true);
+
+        std::vector<std::string> body = {liteshell::InputStream::ECHO_OFF, escaped};
+        auto script = client->compile(body.begin(), body.end());
+
+        auto runs = std::make_shared<_Runs>();
+        runs->client = client;
+        runs->count = count;
+        runs->samples.reserve(count);
+        _start(*runs);
+
+        // A batch script pushes its own frame above the loop, so each run ends once the script is exhausted
+        stream->loop(
+            script, 0, script->size(),
+            [runs]()
+            {
+                runs->samples.push_back(_stop(*runs));
+                if (runs->samples.size() < runs->count)
+                {
+                    _start(*runs);
+                    return true;
+                }
+
+                _report(runs->samples);
+                return false;
+            });
+
+        return 0;
+    }
+};
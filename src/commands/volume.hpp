@@ -5,9 +5,11 @@
 class VolumeCommand : public liteshell::BaseCommand
 {
 public:
+    static inline const liteshell::BaseCommand::Metadata metadata = {"volume", {}};
+
     VolumeCommand()
         : liteshell::BaseCommand(
-              "volume",
+              metadata,
               "Display volume information",
               "",
               liteshell::CommandConstraint(
@@ -42,7 +44,7 @@ public:
         };
 
         auto display = utils::Table("Attribute", "Value");
-        display.add_row("Volume name", utils::utf_convert(std::wstring(volume_name)));
+        display.add_row("Volume name", utils::utf_convert(volume_name));
         display.add_row("Serial number", utils::to_hex_string(volume_serial_number));
         display.add_row("Max component length", std::to_string(volume_max_component_length));
         display.add_row("Case-sensitive file names", display_bool(volume_fs_flags & FILE_CASE_SENSITIVE_SEARCH));
@@ -61,7 +63,7 @@ public:
         display.add_row("Read-only", display_bool(volume_fs_flags & FILE_READ_ONLY_VOLUME));
         display.add_row("Filesystem", utils::utf_convert(volume_fs_name));
 
-        std::cout << display.display() << std::endl;
+        std::cout << display.display() << '\n';
 
         return 0;
     }
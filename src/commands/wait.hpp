@@ -0,0 +1,355 @@
+#pragma once
+
+#include <all.hpp>
+
+class WaitCommand : public liteshell::BaseCommand
+{
+private:
+    /** @brief A process being waited for */
+    struct _Target
+    {
+        DWORD pid;
+        HANDLE handle;
+
+        /** @brief The subprocess of the shell, or `nullptr` if the process was opened by PID */
+        liteshell::ProcessInfoWrapper *wrapper;
+
+        /** @brief The background task being waited for instead of a process, if any */
+        std::shared_ptr<liteshell::BackgroundTask> task;
+
+        std::string name() const
+        {
+            return task != nullptr ? task->name() : std::to_string(pid);
+        }
+    };
+
+    /** @brief The process handles opened by PID, closed when this object is destroyed */
+    class _OpenedHandles
+    {
+    private:
+        std::vector<HANDLE> _handles;
+
+    public:
+        ~_OpenedHandles()
+        {
+            for (auto handle : _handles)
+            {
+                CloseHandle(handle);
+            }
+        }
+
+        HANDLE open(const DWORD pid)
+        {
+            auto handle = OpenProcess(SYNCHRONIZE | PROCESS_QUERY_LIMITED_INFORMATION, FALSE, pid);
+            if (handle == NULL)
+            {
+                throw std::runtime_error(utils::last_error(utils::format("Unable to get process %d", pid)));
+            }
+
+            _handles.push_back(handle);
+            return handle;
+        }
+    };
+
+    /** @brief The state shared with the thread pool callbacks of `_wait_any` */
+    struct _AnyState
+    {
+        HANDLE event;
+        std::atomic<std::size_t> first{SIZE_MAX};
+    };
+
+    static void CALLBACK _signaled(PVOID parameter, BOOLEAN)
+    {
+        auto pair = static_cast<std::pair<_AnyState *, std::size_t> *>(parameter);
+        auto expected = SIZE_MAX;
+        if (pair->first->first.compare_exchange_strong(expected, pair->second))
+        {
+            SetEvent(pair->first->event);
+        }
+    }
+
+    static DWORD _exit_code(const _Target &target)
+    {
+        if (target.task != nullptr)
+        {
+            return target.task->exit_code();
+        }
+
+        if (target.wrapper != nullptr)
+        {
+            target.wrapper->wait(0);
+            return target.wrapper->exit_code();
+        }
+
+        DWORD exit_code = STILL_ACTIVE;
+        GetExitCodeProcess(target.handle, &exit_code);
+        return exit_code;
+    }
+
+    static DWORD _remaining(const std::optional<ULONGLONG> &deadline)
+    {
+        if (!deadline.has_value())
+        {
+            return INFINITE;
+        }
+
+        auto now = GetTickCount64();
+        return now >= *deadline ? 0 : static_cast<DWORD>(std::min<ULONGLONG>(*deadline - now, INFINITE - 1));
+    }
+
+    /**
+     * @brief Wait until all targets have exited, in batches of `MAXIMUM_WAIT_OBJECTS` handles
+     *
+     * @return `false` if the timeout elapsed
+     */
+    static bool _wait_all(const std::vector<_Target> &targets, const std::optional<ULONGLONG> &deadline)
+    {
+        std::vector<HANDLE> handles;
+        handles.reserve(targets.size());
+        for (auto &target : targets)
+        {
+            handles.push_back(target.handle);
+        }
+
+        for (std::size_t offset = 0; offset < handles.size(); offset += MAXIMUM_WAIT_OBJECTS)
+        {
+            auto count = std::min<std::size_t>(handles.size() - offset, MAXIMUM_WAIT_OBJECTS);
+            auto result = WaitForMultipleObjects(count, handles.data() + offset, TRUE, _remaining(deadline));
+            if (result == WAIT_TIMEOUT)
+            {
+                return false;
+            }
+
+            if (result >= WAIT_OBJECT_0 + count)
+            {
+                throw std::runtime_error(utils::last_error("WaitForMultipleObjects ERROR"));
+            }
+        }
+
+        return true;
+    }
+
+    /**
+     * @brief Wait until any target has exited
+     *
+     * At most `MAXIMUM_WAIT_OBJECTS` handles are waited for directly. Beyond that, the waits are registered on the
+     * thread pool, whose callbacks signal a single event.
+     *
+     * @return The index of the first target which exited, or `std::nullopt` if the timeout elapsed
+     */
+    static std::optional<std::size_t> _wait_any(const std::vector<_Target> &targets, const std::optional<ULONGLONG> &deadline)
+    {
+        if (targets.size() <= MAXIMUM_WAIT_OBJECTS)
+        {
+            std::vector<HANDLE> handles;
+            for (auto &target : targets)
+            {
+                handles.push_back(target.handle);
+            }
+
+            auto result = WaitForMultipleObjects(handles.size(), handles.data(), FALSE, _remaining(deadline));
+            if (result == WAIT_TIMEOUT)
+            {
+                return std::nullopt;
+            }
+
+            if (result >= WAIT_OBJECT_0 + handles.size())
+            {
+                throw std::runtime_error(utils::last_error("WaitForMultipleObjects ERROR"));
+            }
+
+            return result - WAIT_OBJECT_0;
+        }
+
+        _AnyState state;
+        state.event = CreateEventW(NULL, TRUE, FALSE, NULL);
+        if (state.event == NULL)
+        {
+            throw std::runtime_error(utils::last_error("CreateEventW ERROR"));
+        }
+
+        std::vector<std::pair<_AnyState *, std::size_t>> parameters;
+        parameters.reserve(targets.size());
+        std::vector<HANDLE> waits;
+        waits.reserve(targets.size());
+
+        DWORD result = WAIT_FAILED;
+        for (std::size_t i = 0; i < targets.size(); i++)
+        {
+            parameters.emplace_back(&state, i);
+
+            HANDLE wait;
+            if (!RegisterWaitForSingleObject(&wait, targets[i].handle, _signaled, &parameters.back(), INFINITE, WT_EXECUTEONLYONCE))
+            {
+                break;
+            }
+
+            waits.push_back(wait);
+        }
+
+        if (waits.size() == targets.size())
+        {
+            result = WaitForSingleObject(state.event, _remaining(deadline));
+        }
+
+        // Wait for the running callbacks before `state` goes out of scope
+        for (auto wait : waits)
+        {
+            UnregisterWaitEx(wait, INVALID_HANDLE_VALUE);
+        }
+
+        CloseHandle(state.event);
+
+        if (result == WAIT_TIMEOUT)
+        {
+            return std::nullopt;
+        }
+
+        if (result != WAIT_OBJECT_0)
+        {
+            throw std::runtime_error(utils::last_error("Unable to wait for the processes"));
+        }
+
+        return state.first.load();
+    }
+
+public:
+    static inline const liteshell::BaseCommand::Metadata metadata = {"wait", {}};
+
+    WaitCommand()
+        : liteshell::BaseCommand(
+              metadata,
+              "Wait for processes to exit",
+              "Wait for the processes with the given PIDs, or all running subprocesses and background tasks of the shell\n"
+              "if none is given. Background tasks are named e.g. \"%1\", see \"ps\".\n"
+              "The errorlevel is set to the number of processes with a non-zero exit code or, with --any, to the exit\n"
+              "code of the first process which exited (whose PID or name is printed). If the timeout elapses, the\n"
+              "errorlevel is set to 258 (WAIT_TIMEOUT).",
+              liteshell::CommandConstraint("pid", "The PIDs of the processes or the names of the tasks to wait for", false, true)
+                  .add_option(
+                      "-t", "--timeout",
+                      "The maximum time to wait for, in milliseconds (default: no timeout)",
+                      liteshell::PositionalArgument("milliseconds", "The timeout in milliseconds", false, true))
+                  .add_option("--any", "Return as soon as any of the processes exits")) {}
+
+    DWORD run(const liteshell::Context &context)
+    {
+        std::optional<ULONGLONG> deadline;
+        if (context.present.count("-t"))
+        {
+            deadline = GetTickCount64() + std::stoull(context.get("-t milliseconds"));
+        }
+
+        auto any = context.present.count("--any") == 1;
+        auto subprocesses = context.client->get_subprocesses();
+
+        _OpenedHandles opened;
+        std::vector<_Target> targets;
+
+        // Processes which have already exited, they are reported without any wait
+        std::vector<_Target> exited;
+
+        auto iter = context.values.find("pid");
+        if (iter == context.values.end())
+        {
+            for (auto wrapper : subprocesses)
+            {
+                if (!wrapper->has_exited())
+                {
+                    targets.push_back({wrapper->pid(), wrapper->handle(), wrapper, nullptr});
+                }
+            }
+
+            for (auto &task : context.client->get_tasks())
+            {
+                if (!task->has_exited())
+                {
+                    targets.push_back({0, task->handle(), nullptr, task});
+                }
+            }
+        }
+        else
+        {
+            utils::FlatSet<DWORD> seen;
+            utils::FlatSet<std::size_t> seen_tasks;
+            for (auto &token : iter->second)
+            {
+                if (liteshell::BackgroundTask::is_name(token))
+                {
+                    auto task = context.client->get_task(token);
+                    if (seen_tasks.insert(task->id))
+                    {
+                        (task->has_exited() ? exited : targets).push_back({0, task->handle(), nullptr, task});
+                    }
+
+                    continue;
+                }
+
+                DWORD pid = std::stoul(token);
+                if (!seen.insert(pid))
+                {
+                    continue; // A handle must not be waited for twice at once
+                }
+
+                auto wrapper = std::find_if(
+                    subprocesses.begin(), subprocesses.end(),
+                    [&pid](liteshell::ProcessInfoWrapper *wrapper)
+                    { return wrapper->pid() == pid; });
+
+                if (wrapper == subprocesses.end())
+                {
+                    targets.push_back({pid, opened.open(pid), nullptr, nullptr});
+                }
+                else if ((*wrapper)->has_exited())
+                {
+                    exited.push_back({pid, NULL, *wrapper, nullptr});
+                }
+                else
+                {
+                    targets.push_back({pid, (*wrapper)->handle(), *wrapper, nullptr});
+                }
+            }
+        }
+
+        if (any)
+        {
+            if (!exited.empty())
+            {
+                std::cout << exited[0].name() << '\n';
+                return _exit_code(exited[0]);
+            }
+
+            if (targets.empty())
+            {
+                return 0;
+            }
+
+            auto index = _wait_any(targets, deadline);
+            if (!index.has_value())
+            {
+                return WAIT_TIMEOUT;
+            }
+
+            std::cout << targets[*index].name() << '\n';
+            return _exit_code(targets[*index]);
+        }
+
+        if (!_wait_all(targets, deadline))
+        {
+            return WAIT_TIMEOUT;
+        }
+
+        targets.insert(targets.end(), exited.begin(), exited.end());
+
+        DWORD failed = 0;
+        for (auto &target : targets)
+        {
+            if (_exit_code(target) != 0)
+            {
+                failed++;
+            }
+        }
+
+        return failed;
+    }
+};
@@ -0,0 +1,352 @@
+#pragma once
+
+#include <all.hpp>
+
+class WatchCommand : public liteshell::BaseCommand
+{
+private:
+    typedef std::chrono::steady_clock clock;
+
+    /** @brief The event signaled by Ctrl-C while a watch is active */
+    static HANDLE _interrupt()
+    {
+        static HANDLE event = CreateEventW(NULL, TRUE, FALSE, NULL);
+        return event;
+    }
+
+    static BOOL WINAPI _interrupted(DWORD ctrl_type)
+    {
+        if (ctrl_type == CTRL_C_EVENT || ctrl_type == CTRL_BREAK_EVENT)
+        {
+            SetEvent(_interrupt());
+            return TRUE;
+        }
+
+        return FALSE;
+    }
+
+    /**
+     * @brief The state of a watch, shared with the callback of its loop and released once the loop ends
+     *
+     * Between two runs, the shell blocks on a waitable timer or on the completion of a `ReadDirectoryChangesW`
+     * request, together with the Ctrl-C event, so an idle watch does not use any CPU time.
+     */
+    class _Watch
+    {
+    private:
+        /** @brief The size of the buffer receiving change notifications, which must be DWORD-aligned */
+        static const std::size_t NOTIFY_BUFFER_SIZE = 1 << 16;
+
+        HANDLE _timer = NULL, _directory = INVALID_HANDLE_VALUE, _event = NULL;
+        OVERLAPPED _overlapped;
+        std::vector<DWORD> _buffer;
+        bool _pending = false;
+
+        /** @brief The name of the watched file, or empty if a whole directory is watched */
+        std::wstring _filter;
+
+        _Watch(const _Watch &) = delete;
+        _Watch &operator=(const _Watch &) = delete;
+
+        void _arm()
+        {
+            ZeroMemory(&_overlapped, sizeof(_overlapped));
+            _overlapped.hEvent = _event;
+            if (!ReadDirectoryChangesW(
+                    _directory,
+                    _buffer.data(),
+                    _buffer.size() * sizeof(DWORD),
+                    _filter.empty(),
+                    FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_DIR_NAME | FILE_NOTIFY_CHANGE_SIZE | FILE_NOTIFY_CHANGE_LAST_WRITE,
+                    NULL,
+                    &_overlapped,
+                    NULL))
+            {
+                throw std::runtime_error(utils::last_error("Unable to watch for changes"));
+            }
+
+            _pending = true;
+        }
+
+        /** @brief Collect a completed notification and watch again, return whether it concerns the watched path */
+        bool _collect()
+        {
+            DWORD size;
+            _pending = false;
+            if (!GetOverlappedResult(_directory, &_overlapped, &size, FALSE))
+            {
+                throw std::runtime_error(utils::last_error("Unable to watch for changes"));
+            }
+
+            // An empty notification means that the buffer overflowed, so some changes are unknown
+            auto matched = size == 0 || _filter.empty();
+            auto offset = reinterpret_cast<const char *>(_buffer.data());
+            while (!matched)
+            {
+                auto &info = *reinterpret_cast<const FILE_NOTIFY_INFORMATION *>(offset);
+                matched = CompareStringOrdinal(info.FileName, info.FileNameLength / sizeof(wchar_t), _filter.c_str(), _filter.size(), TRUE) == CSTR_EQUAL;
+                if (info.NextEntryOffset == 0)
+                {
+                    break;
+                }
+
+                offset += info.NextEntryOffset;
+            }
+
+            _arm();
+            return matched;
+        }
+
+    public:
+        /** @brief The number of runs left, or 0 to run until Ctrl-C */
+        std::size_t remaining = 0;
+
+        /** @brief The time between the start of two consecutive runs */
+        clock::duration interval = clock::duration::zero();
+
+        /** @brief The time without any change after a change before running the command */
+        std::chrono::milliseconds debounce = std::chrono::milliseconds(200);
+
+        /** @brief The start of the next run on a timer */
+        clock::time_point next;
+
+        _Watch()
+        {
+            ResetEvent(_interrupt());
+            SetConsoleCtrlHandler(_interrupted, TRUE);
+        }
+
+        ~_Watch()
+        {
+            SetConsoleCtrlHandler(_interrupted, FALSE);
+
+            // The buffer must stay valid until the pending request is cancelled
+            if (_pending)
+            {
+                DWORD size;
+                CancelIoEx(_directory, &_overlapped);
+                GetOverlappedResult(_directory, &_overlapped, &size, TRUE);
+            }
+
+            if (_directory != INVALID_HANDLE_VALUE)
+            {
+                CloseHandle(_directory);
+            }
+
+            for (auto handle : {_timer, _event})
+            {
+                if (handle != NULL)
+                {
+                    CloseHandle(handle);
+                }
+            }
+        }
+
+        /** @brief Run on a timer, preferably a high-resolution one */
+        void start_timer()
+        {
+            _timer = CreateWaitableTimerExW(NULL, NULL, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+            if (_timer == NULL)
+            {
+                _timer = CreateWaitableTimerW(NULL, TRUE, NULL);
+            }
+
+            if (_timer == NULL)
+            {
+                throw std::runtime_error(utils::last_error("Unable to create a timer"));
+            }
+
+            next = clock::now();
+        }
+
+        /** @brief Run after the changes of a directory tree, or of a file */
+        void start_watching(const std::string &path)
+        {
+            auto wide = utils::utf_convert(path);
+            auto attributes = GetFileAttributesW(wide.c_str());
+            if (attributes == INVALID_FILE_ATTRIBUTES)
+            {
+                throw std::invalid_argument("The specified path does not exist");
+            }
+
+            // A file is watched through its directory, its name filters the notifications
+            if (!(attributes & FILE_ATTRIBUTE_DIRECTORY))
+            {
+                auto absolute = utils::utf_convert(utils::get_absolute_path(path));
+                auto separator = absolute.find_last_of(L"\\/");
+                _filter = absolute.substr(separator + 1);
+                wide = absolute.substr(0, separator + 1);
+            }
+
+            _directory = CreateFileW(
+                wide.c_str(),
+                FILE_LIST_DIRECTORY,
+                FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                NULL,
+                OPEN_EXISTING,
+                FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED,
+                NULL);
+
+            if (_directory == INVALID_HANDLE_VALUE)
+            {
+                throw std::runtime_error(utils::last_error(utils::format("Unable to open \"%s\"", path.c_str())));
+            }
+
+            _event = CreateEventW(NULL, TRUE, FALSE, NULL);
+            if (_event == NULL)
+            {
+                throw std::runtime_error(utils::last_error("Unable to create an event"));
+            }
+
+            _buffer.resize(NOTIFY_BUFFER_SIZE / sizeof(DWORD));
+            _arm();
+        }
+
+        /** @brief Wait for the next run, return `false` if the watch was interrupted */
+        bool wait()
+        {
+            if (_timer != NULL)
+            {
+                // Runs start at multiples of the interval, the ones missed by a long run are skipped
+                auto now = clock::now();
+                next += interval;
+                if (next < now)
+                {
+                    next += (now - next) / interval * interval + interval;
+                }
+
+                LARGE_INTEGER due;
+                due.QuadPart = -std::max<long long>(1, std::chrono::duration_cast<std::chrono::nanoseconds>(next - now).count() / 100);
+                if (!SetWaitableTimer(_timer, &due, 0, NULL, NULL, FALSE))
+                {
+                    throw std::runtime_error(utils::last_error("Unable to set a timer"));
+                }
+
+                HANDLE handles[] = {_timer, _interrupt()};
+                return WaitForMultipleObjects(2, handles, FALSE, INFINITE) == WAIT_OBJECT_0;
+            }
+
+            HANDLE handles[] = {_event, _interrupt()};
+            while (true)
+            {
+                if (WaitForMultipleObjects(2, handles, FALSE, INFINITE) != WAIT_OBJECT_0)
+                {
+                    return false;
+                }
+
+                if (_collect())
+                {
+                    break;
+                }
+            }
+
+            // Wait until the changes settle, e.g. all the files written by a build
+            while (true)
+            {
+                auto result = WaitForMultipleObjects(2, handles, FALSE, debounce.count());
+                if (result == WAIT_TIMEOUT)
+                {
+                    return true;
+                }
+
+                if (result != WAIT_OBJECT_0)
+                {
+                    return false;
+                }
+
+                _collect();
+            }
+        }
+    };
+
+public:
+    static inline const liteshell::BaseCommand::Metadata metadata = {"watch", {}};
+
+    WatchCommand()
+        : liteshell::BaseCommand(
+              metadata,
+              "Run a command repeatedly, on a timer or after changes of a path",
+              "\"watch <interval> <command>\" runs the command and then again every <interval> seconds, measured from the\n"
+              "start of each run without drifting. A run lasting longer than the interval skips the runs it overlaps.\n"
+              "\"watch --on-change <path> <command>\" runs the command and then again once changes of the directory tree\n"
+              "(or of the file) at <path> stop for the debounce time. Changes made while the command runs trigger the\n"
+              "next run. Between runs, the shell sleeps until the timer fires or a change is notified. Press Ctrl-C to\n"
+              "stop watching. Use -- before a command with options, e.g. \"watch 5 -- ls -R\".",
+              liteshell::CommandConstraint("command", "The interval in seconds (without --on-change), the command and its arguments", true, true)
+                  .add_option(
+                      "--on-change",
+                      "Run the command after changes of a path instead of on a timer",
+                      liteshell::PositionalArgument("path", "The file or directory to watch", false, true))
+                  .add_option(
+                      "--debounce",
+                      "The time without any change before running the command, in milliseconds (default: 200)",
+                      liteshell::PositionalArgument("milliseconds", "The debounce time", false, true))
+                  .add_option(
+                      "-n", "--count",
+                      "Stop after this number of runs (default: run until Ctrl-C)",
+                      liteshell::PositionalArgument("count", "The number of runs", false, true))) {}
+
+    DWORD run(const liteshell::Context &context)
+    {
+        auto watch = std::make_shared<_Watch>();
+        if (context.present.count("-n"))
+        {
+            watch->remaining = std::stoul(context.get("-n count"));
+            if (watch->remaining == 0)
+            {
+                throw std::invalid_argument("The number of runs must be positive");
+            }
+        }
+
+        auto &tokens = context.values.at("command");
+        auto begin = tokens.begin();
+        if (context.present.count("--on-change"))
+        {
+            if (context.present.count("--debounce"))
+            {
+                watch->debounce = std::chrono::milliseconds(std::stoul(context.get("--debounce milliseconds")));
+            }
+
+            watch->start_watching(context.get("--on-change path"));
+        }
+        else
+        {
+            auto seconds = std::stod(*begin++);
+            if (!(seconds > 0) || begin == tokens.end())
+            {
+                throw std::invalid_argument("Expected a positive interval in seconds followed by a command");
+            }
+
+            watch->interval = std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(seconds));
+            watch->start_timer();
+        }
+
+        // The arguments were already resolved, their "$" are escaped so that they are not resolved again
+        auto escaped = utils::join_command(begin, tokens.end());
+
+        auto client = context.client;
+        auto stream = client->get_stream();
+
+        // The bottom frame restores the echo state once the watch is over
+        std::vector<std::string> restore = {liteshell::InputStream::ECHO_OFF};
+        stream->write(client->compile(restore.begin(), restore.end()), true);
+
+        std::vector<std::string> body = {liteshell::InputStream::ECHO_OFF, escaped};
+        auto script = client->compile(body.begin(), body.end());
+
+        // A batch script pushes its own frame above the loop, so each run ends once the script is exhausted
+        stream->loop(
+            script, 0, script->size(),
+            [watch]()
+            {
+                if (watch->remaining > 0 && --watch->remaining == 0)
+                {
+                    return false;
+                }
+
+                return watch->wait();
+            });
+
+        return 0;
+    }
+};
@@ -1,76 +1,228 @@
 #include <all.hpp>
 
-int main(int argc, const char **argv)
+// Usage: download <url> <path> [-s <segments>]
+//        download -m <manifest> [-j <jobs>] [-s <segments>]
+//
+// When the server accepts range requests, the file is split into segments which are downloaded over concurrent
+// connections into "<path>.part". The progress of each segment is saved to "<path>.part.state", so an interrupted
+// download resumes where it stopped when the same command is run again. Otherwise, the file is received over a
+// single connection.
+//
+// A manifest lists one "<url> <path>" pair per line. Up to <jobs> files of the manifest are downloaded at the same
+// time, all of them sharing one session so that connections to the same server are reused.
+
+/** @brief The size of the buffer of each connection, data is written to the file once it is full */
+const std::size_t WRITE_BUFFER_SIZE = 1 << 20;
+
+/** @brief Files smaller than this size per segment are downloaded with fewer segments */
+const unsigned long long MINIMUM_SEGMENT_SIZE = 1 << 20;
+
+/** @brief The number of consecutive failed attempts after which a segment is given up */
+const int RETRIES = 3;
+
+/** @brief The interval between 2 progress updates, at which the state file is also saved */
+const auto PROGRESS_INTERVAL = std::chrono::milliseconds(250);
+
+/** @brief The end of a segment whose size is unknown */
+const auto UNKNOWN_END = std::numeric_limits<unsigned long long>::max();
+
+typedef std::unique_ptr<void, decltype(&InternetCloseHandle)> Handle;
+
+/** @brief A range [`begin`, `end`) of the file, downloaded over its own connection */
+struct Segment
+{
+    const unsigned long long begin, end;
+
+    /** @brief The offset up to which the segment was written to the file */
+    std::atomic<unsigned long long> position;
+
+    Segment(const unsigned long long begin, const unsigned long long position, const unsigned long long end)
+        : begin(begin), end(end), position(position) {}
+};
+
+std::optional<unsigned long long> query_number(HINTERNET request, const DWORD info)
 {
-    if (argc != 3)
+    unsigned long long value = 0;
+    DWORD size = sizeof(value);
+    if (!HttpQueryInfoW(request, info | HTTP_QUERY_FLAG_NUMBER64, &value, &size, NULL))
     {
-        throw std::invalid_argument("Expected a download URL and a local path");
+        return std::nullopt;
     }
 
-    const auto url = std::string(argv[1]);
-    const auto path = std::string(argv[2]);
-    const auto wurl = utils::utf_convert(url);
+    return value;
+}
 
-    const auto component = utils::URL::parse(url);
-    if (component.scheme != "http" && component.scheme != "https")
+/**
+ * @brief Send a GET request
+ *
+ * @param session The WinINet session
+ * @param url The URL to request
+ * @param range The value of the "Range" header, or an empty string to request the whole file
+ * @return The request handle and its HTTP status code
+ */
+std::pair<Handle, unsigned long long> open(HINTERNET session, const std::wstring &url, const std::string &range)
+{
+    auto headers = range.empty() ? std::wstring() : utils::utf_convert("Range: bytes=" + range + "\r\n");
+    auto request = InternetOpenUrlW(
+        session,
+        url.c_str(),
+        headers.empty() ? NULL : headers.c_str(),
+        headers.size(),
+        INTERNET_FLAG_RELOAD | INTERNET_FLAG_NO_CACHE_WRITE | INTERNET_FLAG_KEEP_CONNECTION,
+        0);
+    if (request == NULL)
     {
-        throw std::invalid_argument("Only HTTP and HTTPS are supported");
+        throw std::runtime_error(utils::last_error("wininet.h InternetOpenUrlW ERROR"));
     }
 
-    std::cout << "Scheme: " << component.scheme << std::endl;
-    std::cout << "Hostname: " << component.hostname << std::endl;
-    std::cout << "Username: " << component.username << std::endl;
-    std::cout << "Password: " << component.password << std::endl;
-    std::cout << "Port: " << component.port << std::endl;
-    std::cout << "Path: " << component.path << std::endl;
-    std::cout << "Extra info: " << component.extra_info << std::endl;
+    Handle handle(request, InternetCloseHandle);
+    auto status = query_number(request, HTTP_QUERY_STATUS_CODE);
+    if (!status.has_value())
+    {
+        throw std::runtime_error(utils::last_error("wininet.h HttpQueryInfoW ERROR"));
+    }
 
-    std::vector<std::unique_ptr<utils::Finalize>> finalizers;
+    return std::make_pair(std::move(handle), *status);
+}
 
-    auto session = InternetOpenW(
-        L"Serious-senpai/lite-shell",
-        INTERNET_OPEN_TYPE_DIRECT,
-        NULL,
-        NULL,
-        0);
-    if (session == NULL)
+/** @brief Write a buffer to the file at the specified offset, from any thread */
+void write_at(HANDLE file, unsigned long long offset, const char *data, std::size_t size)
+{
+    while (size > 0)
     {
-        throw std::runtime_error(utils::last_error("wininet.h InternetOpenW ERROR"));
+        OVERLAPPED overlapped;
+        ZeroMemory(&overlapped, sizeof(overlapped));
+        overlapped.Offset = static_cast<DWORD>(offset);
+        overlapped.OffsetHigh = static_cast<DWORD>(offset >> 32);
+
+        DWORD written = 0;
+        if (!WriteFile(file, data, static_cast<DWORD>(size), &written, &overlapped) || written == 0)
+        {
+            throw std::runtime_error(utils::last_error("WriteFile ERROR"));
+        }
+
+        data += written;
+        size -= written;
+        offset += written;
     }
-    finalizers.push_back(
-        std::make_unique<utils::Finalize>(
-            [&session]()
-            {
-                InternetCloseHandle(session);
-                std::cout << "Closed session" << std::endl;
-            }));
+}
 
-    auto request = InternetOpenUrlW(
-        session,      // hInternet
-        wurl.c_str(), // lpszUrl
-        NULL,         // lpszHeaders
-        0,            // dwHeadersLength
-        0,            // dwFlags
-        0             // dwContext
-    );
-    if (request == NULL)
+/**
+ * @brief Receive the body of a request into a segment of the file
+ *
+ * The position of the segment only advances once the data is written, so it can be saved as the resume point at
+ * any time.
+ */
+void receive(HINTERNET request, HANDLE file, Segment &segment, const std::atomic<bool> &aborted)
+{
+    std::vector<char> buffer(WRITE_BUFFER_SIZE);
+    std::size_t filled = 0;
+
+    auto flush = [&]()
     {
-        throw std::runtime_error(utils::last_error("wininet.h InternetOpenUrlW ERROR"));
+        write_at(file, segment.position, buffer.data(), filled);
+        segment.position += filled;
+        filled = 0;
+    };
+
+    while (!aborted && segment.position + filled < segment.end)
+    {
+        auto size = std::min<unsigned long long>(buffer.size() - filled, segment.end - segment.position - filled);
+
+        DWORD read = 0;
+        if (!InternetReadFile(request, buffer.data() + filled, static_cast<DWORD>(size), &read))
+        {
+            throw std::runtime_error(utils::last_error("wininet.h InternetReadFile ERROR"));
+        }
+
+        if (read == 0)
+        {
+            break;
+        }
+
+        filled += read;
+        if (filled == buffer.size())
+        {
+            flush();
+        }
+    }
+
+    flush();
+    if (!aborted && segment.end != UNKNOWN_END && segment.position < segment.end)
+    {
+        throw std::runtime_error("Connection closed before the end of the segment");
+    }
+}
+
+/** @brief Download a segment with range requests, reconnecting from its position after an error */
+void download_segment(HINTERNET session, const std::wstring &url, HANDLE file, Segment &segment, const std::atomic<bool> &aborted)
+{
+    int failures = 0;
+    while (!aborted && segment.position < segment.end)
+    {
+        auto before = segment.position.load();
+        try
+        {
+            auto [request, status] = open(session, url, utils::format("%llu-%llu", before, segment.end - 1));
+            if (status != 206)
+            {
+                throw std::runtime_error(utils::format("Unexpected HTTP status %llu for a range request", status));
+            }
+
+            receive(request.get(), file, segment, aborted);
+        }
+        catch (std::exception &)
+        {
+            failures = segment.position > before ? 1 : failures + 1;
+            if (failures >= RETRIES)
+            {
+                throw;
+            }
+        }
     }
-    finalizers.push_back(
-        std::make_unique<utils::Finalize>(
-            [&request]()
+}
+
+/** @brief Load the segments saved by an interrupted download of a file of `length` bytes */
+std::deque<Segment> load_state(const std::string &path, const unsigned long long length)
+{
+    std::deque<Segment> segments;
+
+    std::ifstream input(path);
+    unsigned long long saved_length = 0, begin = 0, position = 0, end = 0;
+    if (input >> saved_length && saved_length == length)
+    {
+        while (input >> begin >> position >> end)
+        {
+            if (begin > position || position > end || end > length)
             {
-                InternetCloseHandle(request);
-                std::cout << "Closed request" << std::endl;
-            }));
+                return {};
+            }
+
+            segments.emplace_back(begin, position, end);
+        }
+    }
+
+    return segments;
+}
+
+void save_state(const std::string &path, const unsigned long long length, const std::deque<Segment> &segments)
+{
+    std::ofstream output(path, std::ios::trunc);
+    output << length << '\n';
+    for (auto &segment : segments)
+    {
+        output << segment.begin << ' ' << segment.position << ' ' << segment.end << '\n';
+    }
+}
 
+HANDLE open_file(const std::string &path, const DWORD disposition)
+{
     auto file = CreateFileW(
         utils::utf_convert(path).c_str(),
-        GENERIC_WRITE,
-        0,
+        GENERIC_READ | GENERIC_WRITE,
+        FILE_SHARE_READ,
         NULL,
-        CREATE_NEW,
+        disposition,
         FILE_ATTRIBUTE_NORMAL,
         NULL);
     if (file == INVALID_HANDLE_VALUE)
@@ -78,37 +230,518 @@ int main(int argc, const char **argv)
         throw std::runtime_error(utils::last_error("CreateFileW ERROR"));
     }
 
-    char buffer[LITE_SHELL_BUFFER_SIZE];
-    DWORD write = 0, total = 0;
-    std::cout << "Downloading from \"" << url << "\" to \"" << path << "\"" << std::endl;
+    return file;
+}
+
+unsigned long long file_size(HANDLE file)
+{
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size))
+    {
+        throw std::runtime_error(utils::last_error("GetFileSizeEx ERROR"));
+    }
+
+    return size.QuadPart;
+}
+
+/** @brief Reserve the space of the whole file, so that the segments do not fragment it */
+void allocate(HANDLE file, const unsigned long long length)
+{
+    LARGE_INTEGER size;
+    size.QuadPart = length;
+    if (!SetFilePointerEx(file, size, NULL, FILE_BEGIN) || !SetEndOfFile(file))
+    {
+        throw std::runtime_error(utils::last_error("SetEndOfFile ERROR"));
+    }
+}
+
+/**
+ * @brief Download a file
+ *
+ * @param session The WinINet session, shared by all downloads
+ * @param url The URL to download
+ * @param path The local path to write to, which must not exist
+ * @param requested_segments The maximum number of concurrent connections for this file
+ * @param received Updated with the number of bytes received by this call, at each progress update
+ * @param verbose Whether to print information about the download and its progress
+ * @return The size of the file
+ */
+unsigned long long download(
+    HINTERNET session,
+    const std::string &url,
+    const std::string &path,
+    const unsigned long long requested_segments,
+    std::atomic<unsigned long long> &received,
+    const bool verbose)
+{
+    const auto wurl = utils::utf_convert(url);
+    const auto part = path + ".part";
+    const auto state = part + ".state";
+
+    const auto component = utils::URL::parse(url);
+    if (component.scheme != "http" && component.scheme != "https")
+    {
+        throw std::invalid_argument("Only HTTP and HTTPS are supported");
+    }
+
+    if (verbose)
+    {
+        std::cout << "Scheme: " << component.scheme << std::endl;
+        std::cout << "Hostname: " << component.hostname << std::endl;
+        std::cout << "Username: " << component.username << std::endl;
+        std::cout << "Password: " << component.password << std::endl;
+        std::cout << "Port: " << component.port << std::endl;
+        std::cout << "Path: " << component.path << std::endl;
+        std::cout << "Extra info: " << component.extra_info << std::endl;
+    }
+
+    if (GetFileAttributesW(utils::utf_convert(path).c_str()) != INVALID_FILE_ATTRIBUTES)
+    {
+        throw std::runtime_error(utils::format("\"%s\" already exists", path.c_str()));
+    }
 
-    auto start = std::chrono::high_resolution_clock::now();
-    do
+    // A server supporting range requests answers this one with 206 Partial Content
+    auto opened = open(session, wurl, "0-");
+    auto &probe = opened.first;
+    auto status = opened.second;
+    if (status != 200 && status != 206)
     {
-        if (!InternetReadFile(request, buffer, LITE_SHELL_BUFFER_SIZE, &write))
+        throw std::runtime_error(utils::format("Unexpected HTTP status %llu", status));
+    }
+
+    auto content_length = query_number(probe.get(), HTTP_QUERY_CONTENT_LENGTH);
+    auto ranged = status == 206 && content_length.has_value();
+    auto length = content_length.value_or(UNKNOWN_END);
+
+    std::deque<Segment> segments;
+    HANDLE file = INVALID_HANDLE_VALUE;
+    if (ranged)
+    {
+        probe.reset();
+        if (GetFileAttributesW(utils::utf_convert(part).c_str()) != INVALID_FILE_ATTRIBUTES)
         {
-            throw std::runtime_error(utils::last_error("wininet.h InternetReadFile ERROR"));
+            segments = load_state(state, length);
         }
 
-        if (write > 0)
+        if (!segments.empty())
         {
-            WriteFile(file, buffer, write, NULL, NULL);
-            total += write;
+            file = open_file(part, OPEN_EXISTING);
+            if (file_size(file) != length)
+            {
+                CloseHandle(file);
+                segments.clear();
+            }
         }
 
-        auto end = std::chrono::high_resolution_clock::now();
+        if (segments.empty())
+        {
+            auto count = std::clamp<unsigned long long>(length / MINIMUM_SEGMENT_SIZE, 1, requested_segments);
+            auto size = length / count;
+            for (unsigned long long i = 0; i < count; i++)
+            {
+                auto begin = i * size;
+                segments.emplace_back(begin, begin, i + 1 == count ? length : begin + size);
+            }
+
+            file = open_file(part, CREATE_ALWAYS);
+            allocate(file, length);
+        }
+    }
+    else
+    {
+        segments.emplace_back(0, 0, length);
+        file = open_file(part, CREATE_ALWAYS);
+        if (length != UNKNOWN_END)
+        {
+            allocate(file, length);
+        }
+    }
+
+    utils::Finalize close_file(
+        [&file]()
+        {
+            if (file != INVALID_HANDLE_VALUE)
+            {
+                CloseHandle(file);
+            }
+        });
+
+    auto downloaded = [&segments]()
+    {
+        unsigned long long total = 0;
+        for (auto &segment : segments)
+        {
+            total += segment.position - segment.begin;
+        }
+
+        return total;
+    };
+
+    const auto resumed = downloaded();
+    if (verbose)
+    {
+        std::cout << "Downloading from \"" << url << "\" to \"" << path << "\"";
+        if (ranged)
+        {
+            std::cout << " with " << segments.size() << " connection(s)";
+        }
+        if (resumed > 0)
+        {
+            std::cout << ", resuming after " << utils::memory_size(resumed);
+        }
+        std::cout << std::endl;
+    }
+
+    std::atomic<bool> aborted{false};
+    std::mutex mutex;
+    std::condition_variable finished;
+    std::size_t running = segments.size();
+    std::exception_ptr error;
+
+    std::vector<std::thread> threads;
+    for (auto &segment : segments)
+    {
+        threads.emplace_back(
+            [&, segment = &segment]()
+            {
+                try
+                {
+                    if (ranged)
+                    {
+                        download_segment(session, wurl, file, *segment, aborted);
+                    }
+                    else
+                    {
+                        receive(probe.get(), file, *segment, aborted);
+                    }
+                }
+                catch (...)
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    if (error == nullptr)
+                    {
+                        error = std::current_exception();
+                    }
+
+                    aborted = true;
+                }
+
+                std::lock_guard<std::mutex> lock(mutex);
+                running--;
+                finished.notify_all();
+            });
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    auto report = [&]()
+    {
+        auto total = downloaded();
+        received = total - resumed;
+        if (!verbose)
+        {
+            return;
+        }
 
         std::cout << "Downloaded: " << utils::memory_size(total);
+        if (length != UNKNOWN_END)
+        {
+            std::cout << " / " << utils::memory_size(length);
+            if (length > 0)
+            {
+                std::cout << utils::format(" (%.1f%%)", 100.0 * total / length);
+            }
+        }
 
-        auto duration = static_cast<long double>(std::chrono::duration_cast<std::chrono::seconds>(end - start).count());
+        auto duration = std::chrono::duration<long double>(std::chrono::steady_clock::now() - start).count();
         if (duration > 0)
         {
-            std::cout << " (" << utils::memory_size(static_cast<long double>(total) / duration) << "/s)";
+            std::cout << " (" << utils::memory_size((total - resumed) / duration) << "/s)";
         }
         std::cout << "          \r" << std::flush;
+    };
+
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (!finished.wait_for(lock, PROGRESS_INTERVAL, [&running]() { return running == 0; }))
+        {
+            lock.unlock();
+            report();
+            if (ranged)
+            {
+                save_state(state, length, segments);
+            }
+            lock.lock();
+        }
+    }
+
+    for (auto &thread : threads)
+    {
+        thread.join();
+    }
+
+    report();
+    if (verbose)
+    {
+        std::cout << std::endl;
+    }
+
+    if (error != nullptr)
+    {
+        if (ranged)
+        {
+            save_state(state, length, segments);
+            if (verbose)
+            {
+                std::cerr << "Run the same command again to resume the download" << std::endl;
+            }
+        }
+
+        std::rethrow_exception(error);
+    }
+
+    if (length == UNKNOWN_END)
+    {
+        // The file was not allocated in advance, keep exactly the received bytes
+        allocate(file, segments.front().position);
+    }
+
+    CloseHandle(file);
+    file = INVALID_HANDLE_VALUE;
+    if (!MoveFileW(utils::utf_convert(part).c_str(), utils::utf_convert(path).c_str()))
+    {
+        throw std::runtime_error(utils::last_error("MoveFileW ERROR"));
+    }
+
+    DeleteFileW(utils::utf_convert(state).c_str());
+    return downloaded();
+}
+
+/** @brief Read the "<url> <path>" lines of a manifest, empty lines and lines starting with "#" are ignored */
+std::vector<std::pair<std::string, std::string>> read_manifest(const std::string &path)
+{
+    std::ifstream input(path);
+    if (!input)
+    {
+        throw std::runtime_error(utils::format("Cannot open manifest \"%s\"", path.c_str()));
+    }
+
+    std::vector<std::pair<std::string, std::string>> entries;
+    std::string line;
+    for (std::size_t number = 1; std::getline(input, line); number++)
+    {
+        line = utils::strip(line);
+        if (line.empty() || line[0] == '#')
+        {
+            continue;
+        }
+
+        auto tokens = utils::split(line);
+        if (tokens.size() != 2)
+        {
+            throw std::invalid_argument(utils::format("Line %zu of the manifest: expected a download URL and a local path", number));
+        }
+
+        entries.emplace_back(tokens[0], tokens[1]);
+    }
+
+    return entries;
+}
+
+/**
+ * @brief Download the files of a manifest concurrently over a shared session, then print a summary
+ *
+ * @return The number of failed downloads
+ */
+std::size_t download_manifest(
+    HINTERNET session,
+    const std::vector<std::pair<std::string, std::string>> &entries,
+    const unsigned long long segments,
+    const unsigned long long jobs)
+{
+    struct Job
+    {
+        std::atomic<unsigned long long> received{0};
+        unsigned long long size = 0;
+        double seconds = 0;
+        std::string error;
+    };
+
+    std::deque<Job> results(entries.size());
+    std::atomic<std::size_t> next{0};
+    std::size_t completed = 0;
+    std::mutex mutex;
+    std::condition_variable finished;
+
+    std::vector<std::thread> threads;
+    for (unsigned long long i = 0; i < std::min<unsigned long long>(jobs, entries.size()); i++)
+    {
+        threads.emplace_back(
+            [&]()
+            {
+                for (auto index = next++; index < entries.size(); index = next++)
+                {
+                    auto &[url, path] = entries[index];
+                    auto &job = results[index];
+
+                    auto start = std::chrono::steady_clock::now();
+                    try
+                    {
+                        job.size = download(session, url, path, segments, job.received, false);
+                    }
+                    catch (std::exception &e)
+                    {
+                        job.error = e.what();
+                    }
 
-    } while (write > 0);
+                    job.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+                    std::lock_guard<std::mutex> lock(mutex);
+                    completed++;
+                    finished.notify_all();
+                }
+            });
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    auto received = [&results]()
+    {
+        unsigned long long total = 0;
+        for (auto &job : results)
+        {
+            total += job.received;
+        }
+
+        return total;
+    };
+
+    auto report = [&](const std::size_t completed)
+    {
+        auto duration = std::chrono::duration<long double>(std::chrono::steady_clock::now() - start).count();
+        auto total = received();
+        std::cout << "Completed: " << completed << "/" << entries.size() << " file(s), " << utils::memory_size(total);
+        if (duration > 0)
+        {
+            std::cout << " (" << utils::memory_size(total / duration) << "/s)";
+        }
+        std::cout << "          \r" << std::flush;
+    };
+
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (!finished.wait_for(lock, PROGRESS_INTERVAL, [&]() { return completed == entries.size(); }))
+        {
+            auto snapshot = completed;
+            lock.unlock();
+            report(snapshot);
+            lock.lock();
+        }
+    }
+
+    for (auto &thread : threads)
+    {
+        thread.join();
+    }
+
+    report(entries.size());
     std::cout << std::endl;
 
+    std::size_t failures = 0;
+    utils::Table table("URL", "Path", "Size", "Time (s)", "Status");
+    table.limits[4] = 60;
+    for (std::size_t i = 0; i < entries.size(); i++)
+    {
+        auto &job = results[i];
+        failures += !job.error.empty();
+        table.add_row(
+            entries[i].first,
+            entries[i].second,
+            job.error.empty() ? utils::memory_size(job.size) : "-",
+            utils::format("%.2f", job.seconds),
+            job.error.empty() ? "OK" : job.error);
+    }
+
+    auto duration = std::chrono::duration<long double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << table.display();
+    std::cout << utils::format("%zu file(s) downloaded, %zu failure(s), ", entries.size() - failures, failures)
+              << utils::memory_size(received()) << utils::format(" in %.2Lfs", duration);
+    if (duration > 0)
+    {
+        std::cout << " (" << utils::memory_size(received() / duration) << "/s)";
+    }
+    std::cout << std::endl;
+
+    return failures;
+}
+
+int main(int argc, const char **argv)
+{
+    std::vector<std::string> positionals;
+    std::optional<std::string> manifest;
+    unsigned long long segments = 4, jobs = 4;
+
+    auto count = [](const char *value, const char *name)
+    {
+        auto result = std::stoull(value);
+        if (result == 0 || result > 64)
+        {
+            throw std::invalid_argument(utils::format("The number of %s must be between 1 and 64", name));
+        }
+
+        return result;
+    };
+
+    for (int i = 1; i < argc; i++)
+    {
+        std::string argument = argv[i];
+        if ((argument == "-s" || argument == "--segments") && i + 1 < argc)
+        {
+            segments = count(argv[++i], "segments");
+        }
+        else if ((argument == "-j" || argument == "--jobs") && i + 1 < argc)
+        {
+            jobs = count(argv[++i], "jobs");
+        }
+        else if ((argument == "-m" || argument == "--manifest") && i + 1 < argc)
+        {
+            manifest = argv[++i];
+        }
+        else
+        {
+            positionals.push_back(argument);
+        }
+    }
+
+    if (manifest.has_value() ? !positionals.empty() : positionals.size() != 2)
+    {
+        throw std::invalid_argument("Expected a download URL and a local path, or a manifest");
+    }
+
+    auto entries = manifest.has_value() ? read_manifest(*manifest) : std::vector<std::pair<std::string, std::string>>{};
+
+    // WinINet allows few connections per server by default, each segment needs its own one
+    DWORD connections = static_cast<DWORD>(manifest.has_value() ? segments * jobs : segments);
+    InternetSetOptionW(NULL, INTERNET_OPTION_MAX_CONNS_PER_SERVER, &connections, sizeof(connections));
+    InternetSetOptionW(NULL, INTERNET_OPTION_MAX_CONNS_PER_1_0_SERVER, &connections, sizeof(connections));
+
+    // A single session keeps the connections alive between requests and downloads
+    auto session = InternetOpenW(
+        L"Serious-senpai/lite-shell",
+        INTERNET_OPEN_TYPE_DIRECT,
+        NULL,
+        NULL,
+        0);
+    if (session == NULL)
+    {
+        throw std::runtime_error(utils::last_error("wininet.h InternetOpenW ERROR"));
+    }
+    Handle session_handle(session, InternetCloseHandle);
+
+    if (manifest.has_value())
+    {
+        return download_manifest(session, entries, segments, jobs) > 0 ? 1 : 0;
+    }
+
+    std::atomic<unsigned long long> received{0};
+    download(session, positionals[0], positionals[1], segments, received, true);
     return 0;
 }
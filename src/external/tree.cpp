@@ -1,87 +1,209 @@
 #include <all.hpp>
 
-bool ignore(const WIN32_FIND_DATAW &data)
+/** @brief An entry of the tree, only the data needed for printing is kept */
+struct Node
 {
-    auto name = utils::utf_convert(data.cFileName);
-    if (name == "." || name == "..")
+    std::wstring name;
+    DWORD attributes;
+
+    /** @brief The entries of this directory, in enumeration order */
+    std::vector<Node> children;
+
+    /** @brief Whether `children` was filled, guarded by `ready_mutex` */
+    bool ready = false;
+
+    bool descend() const
     {
-        return true;
+        // Do not follow junctions and symbolic links, which may form cycles
+        return (attributes & FILE_ATTRIBUTE_DIRECTORY) && !(attributes & FILE_ATTRIBUTE_REPARSE_POINT);
     }
+};
 
-    return false;
-}
+/** @brief A directory to enumerate */
+struct Task
+{
+    std::wstring path;
 
-int main(int argc, const char **argv)
+    /** @brief The node to fill with the entries of the directory, or `nullptr` in summary modes */
+    Node *node;
+};
+
+std::mutex ready_mutex;
+std::condition_variable ready_condition;
+
+void print_tree(Node &root, const bool ascii)
 {
-    auto directory = utils::get_working_directory();
-    if (argc > 1)
+    auto wait = [](Node &node)
     {
-        directory = argv[1];
-    }
+        std::unique_lock<std::mutex> lock(ready_mutex);
+        ready_condition.wait(lock, [&node]()
+                             { return node.ready; });
+    };
 
-    bool ascii = argc > 2 && std::string(argv[2]) == "--ascii";
+#ifdef _WIN32
+    // The box drawing characters of the OEM code page of the console
+    const std::string vertical = ascii ? "|" : "\xb3", branch = ascii ? "+" : "\xc3", corner = ascii ? "+" : "\xc0";
+    const std::string horizontal = ascii ? "---" : "\xc4\xc4\xc4";
+#else
+    // Terminals are UTF-8
+    const std::string vertical = ascii ? "|" : "\u2502", branch = ascii ? "+" : "\u251c", corner = ascii ? "+" : "\u2514";
+    const std::string horizontal = ascii ? "---" : "\u2500\u2500\u2500";
+#endif
 
-    std::cout << "Content of " << directory << ":" << std::endl;
-
-    std::vector<std::pair<int, std::pair<std::string, WIN32_FIND_DATAW>>> stack;
-    for (const auto &child : utils::list_files(utils::join(directory, "*")))
+    std::string prefix, name;
+    // Each directory being printed, the index of its next child and the length of the prefix before it
+    std::vector<std::tuple<Node *, std::size_t, std::size_t>> stack = {{&root, 0, 0}};
+    wait(root);
+    while (!stack.empty())
     {
-        if (!ignore(child))
+        auto [node, index, length] = stack.back();
+        if (index == node->children.size())
         {
-            stack.push_back(std::make_pair(0, std::make_pair(directory, child)));
+            // The subtree was printed, release it
+            std::vector<Node>().swap(node->children);
+            stack.pop_back();
+            prefix.resize(length);
+            continue;
         }
-    }
 
-    unsigned long long bitmask = (unsigned long long)-1;
-    while (!stack.empty())
-    {
-        const auto [level, file] = stack.back();
-        const auto [path, data] = file;
+        std::get<1>(stack.back())++;
 
-        stack.pop_back();
-        if (level > 63)
+        auto &child = node->children[index];
+        auto last = index + 1 == node->children.size();
+        utils::utf_convert(child.name, name);
+        std::cout << prefix << (last ? corner : branch) << horizontal << name << '\n';
+
+        if (child.descend())
         {
-            throw std::runtime_error("Too many levels of nesting");
+            wait(child);
+            stack.emplace_back(&child, 0, prefix.size());
+            prefix += last ? " " : vertical;
+            prefix += "   ";
         }
+    }
+}
 
-        bitmask |= ~((1ull << level) - 1);
-        for (int i = 0; i < level; i++)
+int main(int argc, const char **argv)
+{
+    std::ios::sync_with_stdio(false);
+
+    auto directory = utils::get_working_directory();
+    bool ascii = false, count = false, size = false;
+    for (int i = 1; i < argc; i++)
+    {
+        std::string argument = argv[i];
+        if (argument == "--ascii")
         {
-            std::cout << ((bitmask & (1ull << i)) ? (ascii ? '|' : (char)179) : ' ') << "   "; // │
+            ascii = true;
         }
-
-        if (stack.empty() || stack.back().first < level)
+        else if (argument == "--count")
         {
-            std::cout << (ascii ? '+' : (char)192); // └
-            bitmask &= ~(1ull << level);
+            count = true;
         }
-        else
+        else if (argument == "--size")
         {
-            std::cout << (ascii ? '+' : (char)195); // ├
+            size = true;
         }
-
-        for (int i = 0; i < 3; i++)
+        else if (i == 1)
         {
-            std::cout << (ascii ? '-' : (char)196); // ─
+            directory = argument;
         }
+        else
+        {
+            throw std::invalid_argument(utils::format("Unrecognized argument \"%s\"", argument.c_str()));
+        }
+    }
+
+    auto summary = count || size;
+    if (!summary)
+    {
+        std::cout << "Content of " << directory << ":\n";
+    }
 
-        auto filename = utils::utf_convert(data.cFileName);
-        std::cout << filename << '\n';
+    std::atomic<unsigned long long> files{0}, directories{0}, bytes{0};
+    Node root{L"", FILE_ATTRIBUTE_DIRECTORY};
 
-        if (
-            (data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) &&
-            !ignore(data))
+    auto workers = std::max(1u, std::thread::hardware_concurrency());
+    utils::WorkStealingPool<Task> pool(
+        workers,
+        [&](std::size_t worker, Task &task)
         {
-            const auto new_path = utils::join(path, filename);
-            for (const auto &child : utils::list_files(utils::join(new_path, "*")))
+            if (task.node == nullptr)
+            {
+                unsigned long long local_files = 0, local_directories = 0, local_bytes = 0;
+                utils::enumerate_directory(
+                    task.path,
+                    [&](const WIN32_FIND_DATAW &data)
+                    {
+                        if (data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+                        {
+                            local_directories++;
+                            if (!(data.dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT))
+                            {
+                                pool.push(worker, {task.path + L"\\" + data.cFileName, nullptr});
+                            }
+                        }
+                        else
+                        {
+                            local_files++;
+                            local_bytes += (static_cast<unsigned long long>(data.nFileSizeHigh) << 32) | data.nFileSizeLow;
+                        }
+                    });
+
+                files += local_files;
+                directories += local_directories;
+                bytes += local_bytes;
+                return;
+            }
+
+            auto node = task.node;
+            utils::enumerate_directory(
+                task.path,
+                [&node](const WIN32_FIND_DATAW &data)
+                {
+                    node->children.push_back(Node{data.cFileName, data.dwFileAttributes});
+                });
+
+            // The children are complete at this point, so the pointers to them stay valid
+            for (auto &child : node->children)
             {
-                if (!ignore(child))
+                if (child.descend())
                 {
-                    stack.push_back(std::make_pair(level + 1, std::make_pair(new_path, child)));
+                    pool.push(worker, {task.path + L"\\" + child.name, &child});
                 }
             }
+
+            {
+                std::lock_guard<std::mutex> lock(ready_mutex);
+                node->ready = true;
+            }
+
+            ready_condition.notify_all();
+        });
+
+    pool.push(0, {utils::utf_convert(directory), summary ? nullptr : &root});
+
+    if (summary)
+    {
+        pool.run();
+        if (count)
+        {
+            std::cout << files << " file(s), " << directories << " folder(s)\n";
+        }
+
+        if (size)
+        {
+            std::cout << bytes << " byte(s) (" << utils::memory_size(bytes) << ")\n";
         }
+
+        return 0;
     }
 
+    // Entries are printed in order while the workers are still enumerating the rest of the tree
+    std::thread walker([&pool]()
+                       { pool.run(); });
+    print_tree(root, ascii);
+    walker.join();
+
     return 0;
 }
@@ -1,17 +1,38 @@
 #pragma once
 
+#include "arena.hpp"
 #include "base.hpp"
 #include "client.hpp"
+#include "console.hpp"
 #include "constraint.hpp"
 #include "context.hpp"
 #include "converter.hpp"
+#include "copy.hpp"
+#include "counters.hpp"
+#include "directory_cache.hpp"
 #include "environment.hpp"
+#include "executable_cache.hpp"
 #include "error.hpp"
+#include "expression.hpp"
 #include "finalize.hpp"
+#include "find_files.hpp"
 #include "format.hpp"
 #include "fuzzy_search.hpp"
+#include "history.hpp"
 #include "join.hpp"
+#include "line_editor.hpp"
+#include "mapped_file.hpp"
 #include "maps.hpp"
+#include "pipe.hpp"
+#include "platform.hpp"
+#include "profiler.hpp"
+#include "redirection.hpp"
+#include "remove.hpp"
+#include "script.hpp"
+#include "script_cache.hpp"
+#include "searcher.hpp"
+#include "server.hpp"
+#include "sorter.hpp"
 #include "split.hpp"
 #include "standard.hpp"
 #include "stream.hpp"
@@ -19,7 +40,10 @@
 #include "style.hpp"
 #include "subprocess.hpp"
 #include "tables.hpp"
+#include "task.hpp"
+#include "thread_pool.hpp"
 #include "units.hpp"
 #include "url.hpp"
 #include "utils.hpp"
+#include "work_stealing.hpp"
 #include "wrapper.hpp"
@@ -0,0 +1,93 @@
+#pragma once
+
+#include "standard.hpp"
+
+namespace utils
+{
+    /** @brief The number of calls to the global `operator new` made by the current thread */
+    thread_local std::size_t _allocations = 0;
+
+#ifdef LITE_SHELL_COUNT_ALLOCATIONS
+    /** @brief Whether `allocations` counts the heap allocations, see `LITE_SHELL_COUNT_ALLOCATIONS` */
+    constexpr bool ALLOCATIONS_COUNTED = true;
+#else
+    constexpr bool ALLOCATIONS_COUNTED = false;
+#endif
+
+    /**
+     * @brief Get the number of calls to the global `operator new` made by the current thread so far
+     *
+     * The difference between two calls is the number of heap allocations in between, the allocations served by an
+     * `Arena` are not counted.
+     *
+     * Only an executable defining `LITE_SHELL_COUNT_ALLOCATIONS` replaces `operator new` to count them (the
+     * benchmark), elsewhere this is always 0.
+     */
+    std::size_t allocations()
+    {
+        return _allocations;
+    }
+
+    /**
+     * @brief A per-thread monotonic arena for the short-lived temporaries of a command line
+     *
+     * Allocations are served from a fixed buffer first and from the heap once it is exhausted, deallocations do
+     * nothing. All memory is released when the outermost `Arena::Scope` of the thread ends, so that the buffer
+     * is reused by the next command line.
+     *
+     * Objects allocated from the arena must not outlive the scope they were allocated in: only use it for
+     * temporaries local to a function, and open a scope in that function so that the memory is also reclaimed when
+     * there is no enclosing scope.
+     */
+    class Arena
+    {
+    private:
+        static const std::size_t _BUFFER_SIZE = 16384;
+
+        alignas(std::max_align_t) std::byte _buffer[_BUFFER_SIZE];
+        std::pmr::monotonic_buffer_resource _resource;
+        std::size_t _depth = 0;
+
+        Arena() : _resource(_buffer, _BUFFER_SIZE, std::pmr::new_delete_resource()) {}
+
+        Arena(const Arena &) = delete;
+        Arena &operator=(const Arena &) = delete;
+
+        static Arena &_instance()
+        {
+            thread_local Arena arena;
+            return arena;
+        }
+
+    public:
+        /** @brief Keep the memory of the arena of the current thread allocated until the outermost scope ends */
+        class Scope
+        {
+        private:
+            Arena &_arena;
+
+            Scope(const Scope &) = delete;
+            Scope &operator=(const Scope &) = delete;
+
+        public:
+            Scope() : _arena(_instance())
+            {
+                _arena._depth++;
+            }
+
+            ~Scope()
+            {
+                if (--_arena._depth == 0)
+                {
+                    _arena._resource.release();
+                }
+            }
+        };
+
+        /** @brief The memory resource of the arena of the current thread */
+        static std::pmr::memory_resource *resource()
+        {
+            return &_instance()._resource;
+        }
+    };
+}
@@ -13,6 +13,21 @@ namespace liteshell
     class BaseCommand
     {
     public:
+        /**
+         * @brief The name and the aliases of a command, known before the command is constructed.
+         *
+         * Each command declares them once in a static member `metadata`, which its constructor passes to
+         * `BaseCommand` and `Client::add_lazy_command` registers.
+         */
+        struct Metadata
+        {
+            /** @brief The name of the command */
+            std::string name;
+
+            /** @brief A list of aliases the command can be invoked under */
+            std::vector<std::string> aliases;
+        };
+
         /** @brief The name of the command */
         const std::string name;
 
@@ -41,7 +56,7 @@ namespace liteshell
             const std::string &name,
             const std::string &description,
             const std::string &long_description,
-            const std::initializer_list<std::string> &aliases,
+            const std::vector<std::string> &aliases,
             const CommandConstraint &constraint)
             : name(name),
               description(description),
@@ -59,6 +74,23 @@ namespace liteshell
 #endif
         }
 
+        /**
+         * @brief Construct a new command from the metadata declared by its class
+         *
+         * @param metadata The name and the aliases of the command
+         * @param description A short description of the command
+         * @param long_description A long description of the command
+         * @param constraint The arguments constraint of the command
+         */
+        BaseCommand(
+            const Metadata &metadata,
+            const std::string &description,
+            const std::string &long_description,
+            const CommandConstraint &constraint)
+            : BaseCommand(metadata.name, description, long_description, metadata.aliases, constraint)
+        {
+        }
+
         /**
          * @brief Construct a new command without aliases
          *
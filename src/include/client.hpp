@@ -1,13 +1,24 @@
 #pragma once
 
 #include "base.hpp"
+#include "console.hpp"
+#include "counters.hpp"
+#include "directory_cache.hpp"
 #include "environment.hpp"
+#include "executable_cache.hpp"
 #include "finalize.hpp"
 #include "fuzzy_search.hpp"
+#include "mapped_file.hpp"
 #include "maps.hpp"
+#include "pipe.hpp"
+#include "profiler.hpp"
+#include "redirection.hpp"
+#include "script_cache.hpp"
 #include "stream.hpp"
 #include "style.hpp"
 #include "subprocess.hpp"
+#include "task.hpp"
+#include "thread_pool.hpp"
 #include "wrapper.hpp"
 
 #define LITE_SHELL_SCRIPT_EXTENSION ".ff"
@@ -22,45 +33,160 @@ namespace liteshell
      *
      * This class is responsible for managing commands, subprocesses and errorlevel. It also provides a method
      * to run the shell indefinitely.
+     *
+     * Built-in commands may run concurrently as tasks (see `TaskContext`), e.g. the stages of a pipeline. A task
+     * sees its own environment and input stream through `get_environment` and `get_stream`, so the environment and
+     * the stream of the shell are only ever used by the thread running the shell. The state shared by all tasks
+     * (subprocesses, executable and script caches, command table) is protected by a mutex each, the snapshots that
+     * task environments are layered on are immutable.
      */
     class Client
     {
     private:
         static std::shared_ptr<Client> _instance;
 
+        /** @brief Protects `_subprocesses` and `_spawn_statistics` */
+        mutable std::mutex _subprocesses_mutex;
         std::vector<ProcessInfoWrapper *> _subprocesses;
 
-        std::vector<CommandWrapper<BaseCommand>> _wrappers;
-        utils::CaseInsensitiveMap<std::size_t> _commands;
+        /** @brief The time spent in `spawn_subprocess` from its call to the return of `CreateProcessW` */
+        SpawnStatistics _spawn_statistics;
 
-        const std::unique_ptr<Environment> _environment;
-        const std::unique_ptr<InputStream> _stream;
+        /** @brief The caps enforced on the job object of each new subprocess */
+        JobLimits _job_limits;
+
+        /** @brief The built-in commands and batch scripts started in the background, protected by `_tasks_mutex` */
+        std::vector<std::shared_ptr<BackgroundTask>> _tasks;
+        mutable std::mutex _tasks_mutex;
 
-        CommandWrapper<BaseCommand> _get_command(const std::string &name) const
+        /**
+         * @brief Put a suspended subprocess into a new job object, which accounts for the resources used by the
+         * subprocess and its descendants and enforces `_job_limits`
+         *
+         * @param process The handle of the subprocess
+         * @return The job object, or `NULL` if the subprocess could not be put into one and no cap is set
+         */
+        HANDLE _create_job(const HANDLE process) const
         {
-            auto iter = _commands.find(name);
-            if (iter == _commands.end())
+            auto job = CreateJobObjectW(NULL, NULL);
+            bool success = job != NULL;
+            if (success && _job_limits.memory > 0)
+            {
+                JOBOBJECT_EXTENDED_LIMIT_INFORMATION information;
+                ZeroMemory(&information, sizeof(information));
+                information.BasicLimitInformation.LimitFlags = JOB_OBJECT_LIMIT_JOB_MEMORY;
+                information.JobMemoryLimit = _job_limits.memory;
+                success = SetInformationJobObject(job, JobObjectExtendedLimitInformation, &information, sizeof(information));
+            }
+
+            if (success && _job_limits.cpu > 0)
+            {
+                JOBOBJECT_CPU_RATE_CONTROL_INFORMATION information;
+                ZeroMemory(&information, sizeof(information));
+                information.ControlFlags = JOB_OBJECT_CPU_RATE_CONTROL_ENABLE | JOB_OBJECT_CPU_RATE_CONTROL_HARD_CAP;
+                information.CpuRate = _job_limits.cpu * 100; // in 1/100 of a percent
+                success = SetInformationJobObject(job, JobObjectCpuRateControlInformation, &information, sizeof(information));
+            }
+
+            if (success && AssignProcessToJobObject(job, process))
+            {
+                return job;
+            }
+
+            auto message = utils::last_error("Unable to put the subprocess into a job object");
+            if (job != NULL)
+            {
+                CloseHandle(job);
+            }
+
+            // Without caps, the subprocess only loses the accounting of its descendants
+            if (!_job_limits.empty())
             {
-                throw CommandNotFound(name, fuzzy_command_search(name).c_str());
+                throw SubprocessCreationError(message);
             }
 
-            return _wrappers[iter->second];
+            return NULL;
         }
 
-        CommandWrapper<BaseCommand> _get_command(const Context &context) const
+        /** @brief The subprocesses which exited since the last call to `_reap`, filled by the wait callbacks */
+        std::vector<ProcessInfoWrapper *> _exited;
+        std::mutex _exited_mutex;
+
+        /** @brief Release the handles of the subprocesses which exited in the meantime */
+        void _reap()
         {
-            if (context.tokens.empty())
+            std::vector<ProcessInfoWrapper *> exited;
             {
-                throw std::invalid_argument("No command provided");
+                std::lock_guard<std::mutex> lock(_exited_mutex);
+                exited.swap(_exited);
             }
 
-            return _get_command(context.tokens[0]);
+            for (auto subprocess : exited)
+            {
+                subprocess->release();
+            }
+        }
+
+        std::vector<CommandWrapper<BaseCommand>> _wrappers;
+        utils::CaseInsensitiveMap<std::size_t> _commands;
+
+        /** @brief A frozen copy of `_commands` used for lookups, rebuilt on the first lookup after a command is added */
+        mutable utils::FrozenCaseInsensitiveMap<std::size_t> _command_table;
+        mutable std::atomic<bool> _command_table_stale = false;
+        mutable std::mutex _command_table_mutex;
+
+        /** @brief The names and aliases of all commands, the candidates of `fuzzy_command_search` */
+        std::vector<std::string> _command_names;
+
+        const std::unique_ptr<Environment> _environment;
+        const std::unique_ptr<InputStream> _stream;
+
+        /** @brief Handles to the variables updated after each command */
+        const Environment::VariableHandle _cd, _errorlevel;
+
+        /** @brief A handle to `PATH`, whose directories are searched for executables */
+        const Environment::VariableHandle _path;
+
+        /** @brief The executables found in the directories of `PATH`, filled lazily by `resolve` */
+        mutable ExecutableCache _executables;
+        mutable std::mutex _executables_mutex;
+
+        /** @brief The listings of the directories searched by tab completion */
+        mutable DirectoryCache _listings;
+
+        /** @brief The profiler of the running `profile` command, or `nullptr` */
+        std::shared_ptr<Profiler> _profiler;
+
+        /** @brief The profiler to account the calling thread to, background tasks are never profiled */
+        const std::shared_ptr<Profiler> &_active_profiler() const
+        {
+            static const std::shared_ptr<Profiler> none;
+            return TaskContext::current() == nullptr ? _profiler : none;
+        }
+
+        /** @brief Whether the shell serves requests of other processes, see `Server` */
+        bool _serving = false;
+
+        /** @brief The error raised when neither a built-in command nor an executable named `name` exists */
+        CommandNotFound _command_not_found(const std::string &name) const
+        {
+            return CommandNotFound(
+                name,
+                [this, name]()
+                { return fuzzy_command_search(name); });
+        }
+
+        /** @brief Whether a resolved path is a batch script rather than an executable */
+        static bool _is_script(const std::string &path)
+        {
+            return utils::endswith(path, LITE_SHELL_SCRIPT_EXTENSION);
         }
 
         /**
          * @brief Find an executable that `token` points to.
          *
          * The function will first look in the current working directory, then in the directories specified in `resolve_order`.
+         * Lookups in the directories of `PATH` are cached, see `ExecutableCache`.
          *
          * @see https://stackoverflow.com/a/605139
          * @param token The token to resolve. This token may be a relative or absolute path.
@@ -72,30 +198,21 @@ namespace liteshell
             std::cout << "Resolving executable from \"" << token << "\"" << std::endl;
 #endif
 
-            // `directory` may be empty
-            std::function<std::optional<std::string>(const std::string &directory, const std::string &filepath)> search;
-            search = [&search](const std::string &directory, const std::string &filepath) -> std::optional<std::string>
+            // `directory` may be empty, a match must not be a directory
+            auto lookup = [](const std::string &directory, const std::string &filepath) -> std::optional<std::string>
             {
-                if (!utils::endswith(filepath, ".exe") && !utils::endswith(filepath, LITE_SHELL_SCRIPT_EXTENSION))
-                {
-                    auto result = search(directory, filepath + ".exe");
-                    if (result.has_value())
-                    {
-                        return result;
-                    }
-
-                    return search(directory, filepath + LITE_SHELL_SCRIPT_EXTENSION);
-                }
-
                 try
                 {
                     const auto fullpath = utils::join(directory, filepath);
 #ifdef DEBUG
                     std::cout << "Searching " << fullpath << std::endl;
 #endif
-                    if (!utils::list_files(fullpath).empty())
+                    for (const auto &data : utils::FindFiles(fullpath))
                     {
-                        return utils::get_absolute_path(fullpath);
+                        if (!(data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY))
+                        {
+                            return utils::get_absolute_path(fullpath);
+                        }
                     }
                 }
                 catch (std::exception &)
@@ -106,6 +223,24 @@ namespace liteshell
                 return std::nullopt;
             };
 
+            // Executables have no extension on POSIX, a name is then tried as is before the batch script
+            auto search = [&lookup](const std::string &directory, const std::string &filepath) -> std::optional<std::string>
+            {
+                const std::string extension = LITE_SHELL_EXECUTABLE_EXTENSION;
+                if (!_is_script(filepath) && (extension.empty() || !utils::endswith(filepath, extension)))
+                {
+                    auto result = lookup(directory, filepath + extension);
+                    if (result.has_value())
+                    {
+                        return result;
+                    }
+
+                    return lookup(directory, filepath + LITE_SHELL_SCRIPT_EXTENSION);
+                }
+
+                return lookup(directory, filepath);
+            };
+
             // Search as an absolute path or a relative path to the working directory
             auto result = search("", token);
             if (result.has_value())
@@ -116,375 +251,1277 @@ namespace liteshell
             if (token.find('\\') == std::string::npos && token.find('/') == std::string::npos)
             {
                 // token does not contain path separators
-                for (const auto &directory : get_resolve_order())
-                {
-                    auto result = search(directory, token);
-                    if (result.has_value())
-                    {
-                        return *result;
-                    }
-                }
+                std::lock_guard<std::mutex> lock(_executables_mutex);
+                return _executables.find(
+                    get_environment()->get_view(_path),
+                    token,
+                    [&search, &token](const std::string &directory)
+                    { return search(directory, token); });
             }
 
             return std::nullopt;
         }
 
-        void process_batch_file(const std::string &path) const
+        /**
+         * @brief A compiled script in the script cache, together with the file metadata it was compiled from.
+         */
+        struct _CachedScript
         {
-            // Warning: ifstream read in text mode may f*ck up in Windows: https://stackoverflow.com/a/8834004
-
-#ifdef DEBUG
-            std::cout << "Reading batch file: " << path << std::endl;
-#endif
+            FILETIME last_write;
+            ULONGLONG size;
+            std::shared_ptr<const Script> script;
+        };
 
-            auto file = CreateFileW(
-                utils::utf_convert(path).c_str(),
-                GENERIC_READ,
-                FILE_SHARE_READ,
-                NULL,
-                OPEN_EXISTING,
-                FILE_ATTRIBUTE_NORMAL,
-                NULL);
+        std::map<std::string, _CachedScript> _scripts;
+        std::mutex _scripts_mutex;
 
-            if (file == INVALID_HANDLE_VALUE)
-            {
-                throw std::runtime_error(utils::last_error("Error when opening file"));
-            }
-
-            auto _finalize = utils::Finalize(
-                [&file]()
-                {
-                    CloseHandle(file);
-                });
-
-            char buffer[LITE_SHELL_BUFFER_SIZE];
-            ZeroMemory(buffer, LITE_SHELL_BUFFER_SIZE);
-
-            std::stringstream stream;
+        /** @brief The compiled scripts on disk, shared with the other shell processes */
+        const ScriptCache _script_cache = ScriptCache(ScriptCache::default_directory());
 
-            DWORD read = LITE_SHELL_BUFFER_SIZE;
-            while (read == LITE_SHELL_BUFFER_SIZE)
+        const utils::FrozenCaseInsensitiveMap<std::size_t> &_get_command_table() const
+        {
+            if (_command_table_stale)
             {
-                if (!ReadFile(file, buffer, LITE_SHELL_BUFFER_SIZE, &read, NULL))
+                std::lock_guard<std::mutex> lock(_command_table_mutex);
+                if (_command_table_stale)
                 {
-                    throw std::runtime_error(utils::last_error("Error when reading file"));
+                    _command_table = utils::FrozenCaseInsensitiveMap<std::size_t>(_commands);
+                    _command_table_stale = false;
                 }
-
-                stream << std::string(buffer, buffer + read);
             }
 
-            _stream->append_footer(stream);
-            _stream->write(stream.str(), false);
+            return _command_table;
         }
 
-        /**
-         * @brief An error handler that process exceptions thrown during command execution.
-         *
-         * @param e The exception object that was thrown.
-         */
-        void on_error(std::exception &e) const
+        std::optional<std::size_t> _lookup_command(const std::string &name) const
         {
-            DWORD errorlevel = 1000;
-            bool casted = false;
-
-#define ERROR_CODE(exception_type, code)               \
-    {                                                  \
-        auto ptr = dynamic_cast<exception_type *>(&e); \
-        if (ptr != NULL)                               \
-        {                                              \
-            errorlevel = code;                         \
-            std::cerr << ptr->what() << std::endl;     \
-            casted = true;                             \
-        }                                              \
-    }
-
-            ERROR_CODE(std::runtime_error, 900);
-            ERROR_CODE(std::invalid_argument, 901);
-            ERROR_CODE(std::bad_alloc, 902);
-            ERROR_CODE(SubprocessCreationError, 903);
-            ERROR_CODE(EnvironmentResolveError, 904);
-            ERROR_CODE(CommandNotFound, 905);
-            ERROR_CODE(ArgumentMissingError, 906);
-            ERROR_CODE(UnrecognizedOption, 907);
-            ERROR_CODE(TooManyPositionalArguments, 908);
-
-#undef ERROR_CODE
-
-            if (!casted)
+            auto index = _get_command_table().find(name);
+            if (index == nullptr)
             {
-                std::cerr << "An unknown exception occurred: " << e.what() << std::endl;
+                return std::nullopt;
             }
 
-            _environment->set_value("errorlevel", std::to_string(errorlevel));
+            return *index;
         }
 
-    public:
         /**
-         * @brief Get the `Client` instance.
+         * @brief Get the compiled form of a batch script.
          *
-         * @return A shared pointer to the `Client` instance
-         */
-        static std::shared_ptr<Client> get_instance();
-
-        /**
-         * @brief Construct a new `Client` object. Use `Client::get_instance()` instead.
+         * Compiled scripts are cached by path and are recompiled only when the last write time or the size of the
+         * file changes. A script which is not in memory is loaded from its compiled file on disk if it is still
+         * valid, so that other shells do not compile the same script again, see `ScriptCache`.
          *
-         * @see `Client::get_instance()`
+         * @param path The absolute path to the script
+         * @return The compiled script
          */
-        Client() : _environment(std::make_unique<Environment>()), _stream(std::make_unique<InputStream>())
+        std::shared_ptr<const Script> load_batch_file(const std::string &path)
         {
-            if (_instance != nullptr)
+            WIN32_FILE_ATTRIBUTE_DATA attributes;
+            if (!GetFileAttributesExW(utils::utf_convert(path).c_str(), GetFileExInfoStandard, &attributes))
             {
-                throw std::runtime_error("An instance of Client already exists");
+                throw std::runtime_error(utils::last_error("Error when opening file"));
             }
 
-            auto path = utils::get_executable_path();
-            auto size = path.size();
-            while (size > 0 && path[size - 1] != '\\')
+            ULONGLONG size = (static_cast<ULONGLONG>(attributes.nFileSizeHigh) << 32) | attributes.nFileSizeLow;
             {
-                size--;
+                std::lock_guard<std::mutex> lock(_scripts_mutex);
+                auto iter = _scripts.find(path);
+                if (iter != _scripts.end() &&
+                    iter->second.size == size &&
+                    CompareFileTime(&iter->second.last_write, &attributes.ftLastWriteTime) == 0)
+                {
+#ifdef DEBUG
+                    std::cout << "Using cached compiled script: " << path << std::endl;
+#endif
+                    return iter->second.script;
+                }
             }
 
-            wchar_t buffer[32767];
-            if (GetEnvironmentVariableW(L"PATH", buffer, 32767) == 0)
+            auto lookup = [this](const std::string &name)
             {
-                throw std::runtime_error(utils::last_error("Unable to get PATH"));
-            }
-
-            std::string env_path = utils::utf_convert(buffer);
-
-            _environment->set_value("PATH", path.substr(0, size) + ";" + env_path);
-            _environment->set_value("errorlevel", "0");
-        }
+                return _lookup_command(name);
+            };
 
-        /** @brief Destructor for this object */
-        ~Client()
-        {
-            for (auto &subprocess : _subprocesses)
+            auto script = _script_cache.load(path, attributes, lookup);
+            if (script == nullptr)
             {
-                delete subprocess;
-            }
-        }
+#ifdef DEBUG
+                std::cout << "Reading batch file: " << path << std::endl;
+#endif
 
-        /**
-         * @brief Get a pointer to the shell environment containing the variables.
-         *
-         * @return A pointer to the shell environment
-         */
-        Environment *get_environment() const
-        {
-            return _environment.get();
-        }
+                // The instructions are compiled straight from the mapped file, and the mapping is released afterwards
+                // so that the script can still be edited while its compiled form is cached.
+                std::vector<Instruction> instructions;
+                std::uint64_t hash;
+                {
+                    utils::MappedFile file(path);
+                    instructions = Script::parse(file.view(), lookup);
+                    hash = ScriptCache::hash(file.view());
+                }
 
-        /**
-         * @brief Get a pointer to the input stream.
-         *
-         * @return A pointer to the input stream
-         */
-        InputStream *get_stream() const
-        {
-            return _stream.get();
-        }
+                instructions.emplace_back(InputStream::STREAM_EOF, nullptr);
 
-        /**
-         * @brief Get all commands of the current command shell.
-         *
-         * @return A set containing all commands
-         */
-        std::set<CommandWrapper<BaseCommand>> walk_commands() const
-        {
-            return std::set<CommandWrapper<BaseCommand>>(_wrappers.begin(), _wrappers.end());
-        }
+                script = std::make_shared<const Script>(std::move(instructions));
+                _script_cache.store(path, attributes, hash, *script);
+            }
 
-        /**
-         * @brief Get a command from the internal list of commands.
-         * This can also be used as a way to get aliases.
-         *
-         * @param name The name of the command to get.
-         * @return The command that was requested. If not found, returns an empty optional.
-         */
-        std::optional<CommandWrapper<BaseCommand>> get_optional_command(const std::string &name) const
-        {
-            auto iter = _commands.find(name);
-            if (iter == _commands.end())
             {
-                return std::nullopt;
+                std::lock_guard<std::mutex> lock(_scripts_mutex);
+                _scripts[path] = {attributes.ftLastWriteTime, size, script};
             }
-            return _wrappers[iter->second];
+
+            return script;
         }
 
-        /**
-         * @brief Get all subprocesses of the current shell.
-         *
-         * @return An array of pointers to `ProcessInfoWrapper` objects.
-         */
-        std::vector<ProcessInfoWrapper *> get_subprocesses()
+        void process_batch_file(const std::string &path)
         {
-            return _subprocesses;
+            get_stream()->write(load_batch_file(path), true);
         }
 
         /**
-         * @brief Add a command to the internal list of commands.
+         * @brief Resolve an instruction into the context it must be executed with.
          *
-         * @param ptr A shared pointer `std::shared_ptr<BaseCommand>` to the command to add.
-         * @return A pointer to the current client to allow fluent-style chaining
+         * @param instruction The instruction to resolve, which must not be a pipeline
+         * @param command Set to the index of the built-in command bound at compile time, if any
+         * @return The context of the instruction, or `std::nullopt` if it resolves to a no-op
          */
-        Client *add_command(const std::shared_ptr<BaseCommand> &ptr)
+        std::optional<Context> _prepare(const Instruction &instruction, std::optional<std::size_t> &command) const
         {
-            if (_commands.find(ptr->name) != _commands.end())
-            {
-                throw std::runtime_error(utils::format("Command %s already exists", ptr->name));
-            }
-
-            _wrappers.emplace_back(ptr);
-            _commands[ptr->name] = _wrappers.size() - 1;
-            for (auto &alias : ptr->aliases)
+            command = std::nullopt;
+            if (instruction.dynamic)
             {
-                if (_commands.find(alias) != _commands.end())
+                auto message = utils::strip(get_environment()->resolve(instruction.message));
+                if (message.empty() || message[0] == ':')
                 {
-                    throw std::runtime_error(utils::format("Command %s already exists", alias));
+                    return std::nullopt;
                 }
-                _commands[alias] = _wrappers.size() - 1;
+
+#ifdef DEBUG
+                std::cout << utils::format("Processing command \"%s\"", message.c_str()) << std::endl;
+#endif
+                return Context::get_context(_instance, message);
             }
 
-            return this;
+#ifdef DEBUG
+            std::cout << utils::format("Processing command \"%s\"", instruction.message.c_str()) << std::endl;
+#endif
+
+            command = instruction.command;
+            return Context::get_context(_instance, instruction.message, instruction.tokens);
         }
 
-        /**
-         * @brief Add a command to the internal list of commands.
-         *
-         * @tparam T A subclass of `BaseCommand`
-         * @return A pointer to the current client to allow fluent-style chaining
-         */
-        template <typename T>
-        Client *add_command()
+        /** @brief Open the redirection targets of an instruction, resolving them first if needed */
+        std::unique_ptr<RedirectedOutputs> _redirect(const Instruction &instruction) const
         {
-            static_assert(std::is_base_of_v<BaseCommand, T>, "Can only add a subclass of BaseCommand as a command");
-            return add_command(std::make_shared<T>());
+            return std::make_unique<RedirectedOutputs>(
+                instruction.redirections,
+                [this, &instruction](const std::string &target)
+                {
+                    return instruction.dynamic ? utils::strip(get_environment()->resolve(target)) : target;
+                });
         }
 
         /**
-         * @brief Search for a command that matches most closely to the given name.
-         * @see `utils::fuzzy_search`
+         * @brief Execute a pipeline, e.g. `ls | cat`.
          *
-         * @param name The name of the command to search for.
-         * @return The name of the command that was found.
+         * All stages run concurrently: built-in commands run on their own threads, executables run in their own
+         * processes. Adjacent built-in commands exchange data through a bounded in-memory `utils::RingBuffer`,
+         * an anonymous pipe is used whenever an executable is involved. The errorlevel is the exit code of the
+         * last stage, errors of the other stages are reported but do not stop the pipeline.
          */
-        std::string fuzzy_command_search(const std::string &name) const
+        void _process_pipeline(const Instruction &instruction)
         {
-            std::vector<std::string> all;
-            for (auto &wrapper : _wrappers)
+            const auto size = instruction.pipeline.size();
+
+            // Resolve all stages before starting any of them
+            Profiler::Span resolve_span(_active_profiler(), Profiler::RESOLVE);
+            std::vector<Context> contexts;
+            std::vector<std::optional<std::size_t>> commands;
+            contexts.reserve(size);
+            commands.reserve(size);
+            for (auto &stage : instruction.pipeline)
             {
-                all.push_back(wrapper.command->name);
-                for (auto &alias : wrapper.command->aliases)
+                std::optional<std::size_t> command;
+                auto context = _prepare(stage, command);
+                if (!context.has_value() || context->tokens.empty())
                 {
-                    all.push_back(alias);
+                    throw std::invalid_argument(utils::format("Empty command in pipeline \"%s\"", instruction.source.c_str()));
                 }
-            }
-
-            return *utils::fuzzy_search(all.begin(), all.end(), name);
-        }
 
-        /**
-         * @brief Run the shell indefinitely.
-         */
-        void run_forever()
-        {
-            utils::set_ignore_ctrl_c(true);
-            while (true)
-            {
-                process_command(
-                    _stream->getline(
-                        []()
+                if (&stage != &instruction.pipeline.back())
+                {
+                    for (auto &redirection : stage.redirections)
+                    {
+                        if (redirection.descriptor == Redirection::STDOUT)
                         {
-                            SYSTEMTIME time;
-                            GetLocalTime(&time);
-                            std::cout << utils::format("\n[%d:%d:%d]", time.wHour, time.wMinute, time.wSecond);
-                            utils::style_print("liteshell~", FOREGROUND_BLUE | FOREGROUND_INTENSITY);
-                            std::cout << utils::get_working_directory() << ">";
-                        },
-                        0));
-            }
-        }
+                            throw std::invalid_argument("Only the last command of a pipeline can redirect its output");
+                        }
+                    }
+                }
 
-        /**
-         * @brief Process a command message.
-         *
-         * @note The resolution order is as follows:
-         * @note - Built-in command
-         * @note - Executable/batch file
-         *
-         * @param message The command message to process.
-         */
-        void process_command(const std::string &message)
-        {
-            _environment->set_value("cd", utils::get_working_directory().c_str());
-            try
-            {
-                auto stripped_message = utils::strip(_environment->resolve(utils::strip(message)));
-#ifdef DEBUG
-                std::cout << utils::format("Processing command \"%s\"", stripped_message.c_str()) << std::endl;
-#endif
+                if (context->is_background_request())
+                {
+                    throw std::invalid_argument("Pipelines cannot run in the background");
+                }
 
-                if (stripped_message.empty() || stripped_message[0] == ':')
+                if (!command.has_value())
                 {
-                    // pass
+                    command = _lookup_command(context->tokens[0]);
+                }
+
+                if (command.has_value())
+                {
+                    contexts.push_back(context->parse(&_wrappers[*command].command()->constraint));
                 }
                 else
                 {
-                    auto context = Context::get_context(_instance, stripped_message);
-                    try
+                    auto executable = resolve(context->tokens[0]);
+                    if (!executable.has_value())
                     {
-                        auto wrapper = _get_command(context);
-
-#ifdef DEBUG
-                        std::cout << "Matched command \"" << wrapper.command->name << "\"" << std::endl;
-#endif
-
-                        auto constraint = wrapper.command->constraint;
-                        auto errorlevel = wrapper.run(context.parse(constraint));
-                        _environment->set_value("errorlevel", std::to_string(errorlevel));
+                        throw _command_not_found(context->tokens[0]);
                     }
-                    catch (CommandNotFound &)
+
+                    if (_is_script(*executable))
                     {
-#ifdef DEBUG
-                        std::cout << "No command found. Resolving as an executable/script." << std::endl;
-#endif
+                        throw std::invalid_argument(utils::format("Batch scripts cannot be used in a pipeline: %s", executable->c_str()));
+                    }
 
-                        auto executable = resolve(context.tokens[0]);
+                    contexts.push_back(context->replace_call(*executable));
+                }
+
+                commands.push_back(command);
+            }
+
+            resolve_span.stop();
+
+            std::vector<std::unique_ptr<RedirectedOutputs>> redirected;
+            for (auto &stage : instruction.pipeline)
+            {
+                redirected.push_back(_redirect(stage));
+            }
+
+            // Connect each stage to the next one
+            std::vector<std::shared_ptr<std::streambuf>> inputs(size), outputs(size);
+            std::vector<HANDLE> input_handles(size, NULL), output_handles(size, NULL);
+            std::vector<std::function<void()>> close_inputs(size), close_outputs(size);
+            try
+            {
+                for (std::size_t i = 0; i + 1 < size; i++)
+                {
+                    if (commands[i].has_value() && commands[i + 1].has_value())
+                    {
+                        auto ring = std::make_shared<utils::RingBuffer>();
+                        outputs[i] = std::make_shared<utils::WriterBuffer>(
+                            [ring](const char *data, std::size_t count)
+                            {
+                                ring->write(data, count);
+                            });
+                        inputs[i + 1] = std::make_shared<utils::ReaderBuffer>(
+                            [ring](char *data, std::size_t count)
+                            {
+                                return ring->read(data, count);
+                            });
+
+                        close_outputs[i] = [ring]()
+                        {
+                            ring->close_write();
+                        };
+                        close_inputs[i + 1] = [ring]()
+                        {
+                            ring->close_read();
+                        };
+                    }
+                    else
+                    {
+                        HANDLE read, write;
+                        if (!CreatePipe(&read, &write, NULL, 0))
+                        {
+                            throw std::runtime_error(utils::last_error("Error when creating pipe"));
+                        }
+
+                        output_handles[i] = write;
+                        input_handles[i + 1] = read;
+                        if (commands[i].has_value())
+                        {
+                            outputs[i] = utils::handle_writer(write);
+                        }
+
+                        if (commands[i + 1].has_value())
+                        {
+                            inputs[i + 1] = utils::handle_reader(read);
+                        }
+                    }
+                }
+            }
+            catch (...)
+            {
+                for (std::size_t i = 0; i < size; i++)
+                {
+                    if (input_handles[i] != NULL)
+                    {
+                        CloseHandle(input_handles[i]);
+                    }
+
+                    if (output_handles[i] != NULL)
+                    {
+                        CloseHandle(output_handles[i]);
+                    }
+                }
+
+                throw;
+            }
+
+            auto close_handle = [](HANDLE &handle)
+            {
+                if (handle != NULL)
+                {
+                    CloseHandle(handle);
+                    handle = NULL;
+                }
+            };
+
+            std::vector<DWORD> exit_codes(size);
+            std::vector<std::exception_ptr> errors(size);
+
+            // Start the executables first, the pipe ends are only inheritable while their process is being created
+            std::vector<ProcessInfoWrapper *> subprocesses(size, nullptr);
+            for (std::size_t i = 0; i < size; i++)
+            {
+                if (!commands[i].has_value())
+                {
+                    try
+                    {
+                        for (auto handle : {input_handles[i], output_handles[i]})
+                        {
+                            if (handle != NULL && !SetHandleInformation(handle, HANDLE_FLAG_INHERIT, HANDLE_FLAG_INHERIT))
+                            {
+                                throw std::runtime_error(utils::last_error("Error when configuring pipe"));
+                            }
+                        }
+
+                        auto output = output_handles[i] != NULL ? output_handles[i] : redirected[i]->output_handle();
+                        auto error = redirected[i]->error_handle(output != NULL ? output : GetStdHandle(STD_OUTPUT_HANDLE));
+
+                        redirected[i]->inherit(true);
+                        auto _finalize = utils::Finalize(
+                            [&redirected, i]()
+                            {
+                                redirected[i]->inherit(false);
+                            });
+
+                        subprocesses[i] = spawn_subprocess(contexts[i], input_handles[i], output, error);
+                    }
+                    catch (...)
+                    {
+                        errors[i] = std::current_exception();
+                    }
+
+                    // The child process owns its copies, closing ours lets the neighbours detect EOF
+                    close_handle(input_handles[i]);
+                    close_handle(output_handles[i]);
+                }
+            }
+
+            auto run_stage = [&](const std::size_t i)
+            {
+                try
+                {
+                    auto output = outputs[i] ? outputs[i].get() : redirected[i]->output();
+                    utils::StandardStreams streams(
+                        inputs[i].get(),
+                        output,
+                        redirected[i]->error(output != nullptr ? output : utils::StandardStreams::output()));
+                    exit_codes[i] = _wrappers[*commands[i]].run(contexts[i]);
+                }
+                catch (...)
+                {
+                    errors[i] = std::current_exception();
+                }
+
+                // Signal EOF to the next stage and stop the previous one from blocking on a full buffer
+                if (close_outputs[i])
+                {
+                    close_outputs[i]();
+                }
+
+                if (close_inputs[i])
+                {
+                    close_inputs[i]();
+                }
+
+                close_handle(output_handles[i]);
+                close_handle(input_handles[i]);
+            };
+
+            // The built-in commands before the last stage run as tasks, their assignments are discarded. The last
+            // stage runs on behalf of the shell, so that e.g. "hello | eval -p \"\" -s greeting" assigns a variable.
+            std::vector<std::future<void>> tasks;
+            Environment::Snapshot snapshot;
+            for (std::size_t i = 0; i + 1 < size; i++)
+            {
+                if (commands[i].has_value())
+                {
+                    if (snapshot == nullptr)
+                    {
+                        snapshot = get_environment()->snapshot();
+                    }
+
+                    tasks.push_back(
+                        utils::ThreadPool::shared().submit(
+                            [&run_stage, &snapshot, i]()
+                            {
+                                TaskContext task(snapshot);
+                                run_stage(i);
+                            }));
+                }
+            }
+
+            if (commands.back().has_value())
+            {
+                run_stage(size - 1);
+            }
+
+            {
+                Profiler::Span wait(_active_profiler(), Profiler::WAIT);
+                for (auto subprocess : subprocesses)
+                {
+                    if (subprocess != nullptr)
+                    {
+                        subprocess->wait(INFINITE);
+                    }
+                }
+
+                for (auto &task : tasks)
+                {
+                    task.wait();
+                }
+            }
+
+            // The environment is only updated once no built-in command is running anymore
+            for (std::size_t i = 0; i < size; i++)
+            {
+                if (subprocesses[i] != nullptr)
+                {
+                    exit_codes[i] = subprocesses[i]->exit_code();
+                    get_environment()->set_value("pid", std::to_string(subprocesses[i]->pid()));
+                }
+            }
+
+            for (auto &error : errors)
+            {
+                if (error)
+                {
+                    try
+                    {
+                        std::rethrow_exception(error);
+                    }
+                    catch (std::exception &e)
+                    {
+                        on_error(e);
+                    }
+                }
+            }
+
+            if (!errors.back())
+            {
+                get_environment()->set_value(_errorlevel, std::to_string(exit_codes.back()));
+            }
+        }
+
+        /**
+         * @brief An error handler that process exceptions thrown during command execution.
+         *
+         * @param e The exception object that was thrown.
+         */
+        void on_error(std::exception &e) const
+        {
+            DWORD errorlevel = 1000;
+            if (auto error = dynamic_cast<LiteShellException *>(&e))
+            {
+                errorlevel = error->errorlevel();
+            }
+            else if (dynamic_cast<std::invalid_argument *>(&e) != nullptr)
+            {
+                errorlevel = 901;
+            }
+            else if (dynamic_cast<std::runtime_error *>(&e) != nullptr)
+            {
+                errorlevel = 900;
+            }
+            else if (dynamic_cast<std::bad_alloc *>(&e) != nullptr)
+            {
+                errorlevel = 902;
+            }
+
+            if (errorlevel == 1000)
+            {
+                std::cerr << "An unknown exception occurred: ";
+            }
+
+            std::cerr << e.what() << std::endl;
+            get_environment()->set_value(_errorlevel, std::to_string(errorlevel));
+        }
+
+        Client *_add_command(const CommandWrapper<BaseCommand> &wrapper, const std::vector<std::string> &aliases)
+        {
+            std::vector<std::string> names = {wrapper.name};
+            names.insert(names.end(), aliases.begin(), aliases.end());
+            for (auto &name : names)
+            {
+                if (_commands.find(name) != _commands.end())
+                {
+                    throw std::runtime_error(utils::format("Command %s already exists", name.c_str()));
+                }
+            }
+
+            _wrappers.push_back(wrapper);
+            for (auto &name : names)
+            {
+                _commands[name] = _wrappers.size() - 1;
+            }
+
+            _command_table_stale = true;
+            _command_names.insert(_command_names.end(), names.begin(), names.end());
+
+            return this;
+        }
+
+    public:
+        /**
+         * @brief Get the `Client` instance.
+         *
+         * @return A shared pointer to the `Client` instance
+         */
+        static std::shared_ptr<Client> get_instance();
+
+        /**
+         * @brief Construct a new `Client` object. Use `Client::get_instance()` instead.
+         *
+         * @see `Client::get_instance()`
+         */
+        Client()
+            : _environment(std::make_unique<Environment>()),
+              _stream(std::make_unique<InputStream>()),
+              _cd(_environment->intern("cd")),
+              _errorlevel(_environment->intern("errorlevel")),
+              _path(_environment->intern("PATH"))
+        {
+            if (_instance != nullptr)
+            {
+                throw std::runtime_error("An instance of Client already exists");
+            }
+
+            // All output of the shell is batched, std::cin and std::cerr are tied to std::cout so that pending
+            // output is still flushed before reading input or reporting an error
+            std::cout.rdbuf(&utils::ConsoleBuffer::standard_output());
+            std::cerr.tie(&std::cout);
+
+            // Query the length first instead of copying into a buffer of the maximum size
+            std::wstring buffer(GetEnvironmentVariableW(L"PATH", NULL, 0), L'\0');
+            auto length = buffer.empty() ? 0 : GetEnvironmentVariableW(L"PATH", buffer.data(), static_cast<DWORD>(buffer.size()));
+            if (length == 0 || length >= buffer.size())
+            {
+                throw std::runtime_error(utils::last_error("Unable to get PATH"));
+            }
+
+            buffer.resize(length);
+            std::string env_path = utils::utf_convert(buffer);
+
+            _environment->set_value(_path, utils::get_executable_directory() + LITE_SHELL_PATH_SEPARATOR + env_path);
+            _environment->set_value(_errorlevel, "0");
+            update_working_directory();
+        }
+
+        /** @brief Destructor for this object */
+        ~Client()
+        {
+            for (auto &subprocess : _subprocesses)
+            {
+                delete subprocess;
+            }
+        }
+
+        /**
+         * @brief Get a pointer to the shell environment containing the variables.
+         *
+         * @return A pointer to the environment of the task running on the calling thread, or to the shell
+         * environment outside of a task
+         */
+        Environment *get_environment() const
+        {
+            auto task = TaskContext::current();
+            return task != nullptr ? task->get_environment() : _environment.get();
+        }
+
+        /** @brief Set the `cd` variable to the current working directory, after it was changed */
+        void update_working_directory()
+        {
+            get_environment()->set_value(_cd, utils::get_working_directory());
+        }
+
+        /**
+         * @brief Get a pointer to the input stream.
+         *
+         * @return A pointer to the input stream of the task running on the calling thread, or to the input stream of
+         * the shell outside of a task
+         */
+        InputStream *get_stream() const
+        {
+            auto task = TaskContext::current();
+            return task != nullptr ? task->get_stream() : _stream.get();
+        }
+
+        /**
+         * @brief Get all commands of the current command shell.
+         *
+         * @return A set containing all commands
+         */
+        std::set<CommandWrapper<BaseCommand>> walk_commands() const
+        {
+            return std::set<CommandWrapper<BaseCommand>>(_wrappers.begin(), _wrappers.end());
+        }
+
+        /**
+         * @brief Get a command from the internal list of commands.
+         * This can also be used as a way to get aliases.
+         *
+         * @param name The name of the command to get.
+         * @return The command that was requested. If not found, returns an empty optional.
+         */
+        std::optional<CommandWrapper<BaseCommand>> get_optional_command(const std::string &name) const
+        {
+            auto index = _get_command_table().find(name);
+            if (index == nullptr)
+            {
+                return std::nullopt;
+            }
+            return _wrappers[*index];
+        }
+
+        /**
+         * @brief Get all subprocesses of the current shell.
+         *
+         * @return An array of pointers to `ProcessInfoWrapper` objects.
+         */
+        std::vector<ProcessInfoWrapper *> get_subprocesses()
+        {
+            std::lock_guard<std::mutex> lock(_subprocesses_mutex);
+            return _subprocesses;
+        }
+
+        /**
+         * @brief Get all background tasks of the current shell, including the finished ones.
+         *
+         * @return The tasks, in the order they were started
+         */
+        std::vector<std::shared_ptr<BackgroundTask>> get_tasks() const
+        {
+            std::lock_guard<std::mutex> lock(_tasks_mutex);
+            return _tasks;
+        }
+
+        /**
+         * @brief Find a background task by name.
+         *
+         * @param name The name of the task, e.g. `%1`
+         * @return The task
+         */
+        std::shared_ptr<BackgroundTask> get_task(const std::string &name) const
+        {
+            if (BackgroundTask::is_name(name))
+            {
+                auto id = std::stoull(name.substr(1));
+                std::lock_guard<std::mutex> lock(_tasks_mutex);
+                if (id > 0 && id <= _tasks.size())
+                {
+                    return _tasks[id - 1];
+                }
+            }
+
+            throw std::invalid_argument(utils::format("Cannot find a background task named \"%s\"", name.c_str()));
+        }
+
+        /**
+         * @brief Get the profiler of the running `profile` command
+         *
+         * @return The current profiler, or `nullptr` if the shell is not being profiled
+         */
+        const std::shared_ptr<Profiler> &get_profiler() const
+        {
+            return _profiler;
+        }
+
+        /**
+         * @brief Start or stop profiling the shell
+         *
+         * @param profiler The profiler to record the following instructions with, or `nullptr` to stop profiling
+         */
+        void set_profiler(const std::shared_ptr<Profiler> &profiler)
+        {
+            _profiler = profiler;
+        }
+
+        /**
+         * @brief Get the compiled form of a batch script.
+         *
+         * @param token The path to the script, which is resolved the same way as a command
+         * @return The compiled script
+         */
+        std::shared_ptr<const Script> get_batch_file(const std::string &token)
+        {
+            auto path = resolve(token);
+            if (!path.has_value() || !utils::endswith(*path, LITE_SHELL_SCRIPT_EXTENSION))
+            {
+                throw std::invalid_argument(utils::format("Batch script not found: %s", token.c_str()));
+            }
+
+            return load_batch_file(*path);
+        }
+
+        /**
+         * @brief Get the latency statistics of the subprocesses created by this shell
+         *
+         * Subprocesses may be spawned concurrently (pipelines, `parallel`, background tasks), so a copy is returned.
+         *
+         * @return A snapshot of the statistics of all calls to `spawn_subprocess` so far
+         */
+        SpawnStatistics get_spawn_statistics() const
+        {
+            std::lock_guard<std::mutex> lock(_subprocesses_mutex);
+            return _spawn_statistics;
+        }
+
+        /** @brief Get the caps enforced on the job object of each new subprocess */
+        const JobLimits &get_job_limits() const
+        {
+            return _job_limits;
+        }
+
+        /**
+         * @brief Set the caps enforced on the job object of each new subprocess, running subprocesses are not affected
+         *
+         * @param limits The new caps
+         */
+        void set_job_limits(const JobLimits &limits)
+        {
+            _job_limits = limits;
+        }
+
+        /**
+         * @brief Add a command to the internal list of commands.
+         *
+         * @param ptr A shared pointer `std::shared_ptr<BaseCommand>` to the command to add.
+         * @return A pointer to the current client to allow fluent-style chaining
+         */
+        Client *add_command(const std::shared_ptr<BaseCommand> &ptr)
+        {
+            return _add_command(CommandWrapper<BaseCommand>(ptr), ptr->aliases);
+        }
+
+        /**
+         * @brief Add a command to the internal list of commands.
+         *
+         * @tparam T A subclass of `BaseCommand`
+         * @return A pointer to the current client to allow fluent-style chaining
+         */
+        template <typename T>
+        Client *add_command()
+        {
+            static_assert(std::is_base_of_v<BaseCommand, T>, "Can only add a subclass of BaseCommand as a command");
+            return add_command(std::make_shared<T>());
+        }
+
+        /**
+         * @brief Add a command which is only constructed when it is first used.
+         *
+         * Registering a command this way is cheaper at startup, since only its name and aliases are stored. They are
+         * read from `T::metadata`, the same `BaseCommand::Metadata` the constructor of `T` uses.
+         *
+         * @tparam T A subclass of `BaseCommand`
+         * @return A pointer to the current client to allow fluent-style chaining
+         */
+        template <typename T>
+        Client *add_lazy_command()
+        {
+            static_assert(std::is_base_of_v<BaseCommand, T>, "Can only add a subclass of BaseCommand as a command");
+            return _add_command(
+                CommandWrapper<BaseCommand>(
+                    T::metadata.name,
+                    []()
+                    {
+                        return std::static_pointer_cast<BaseCommand>(std::make_shared<T>());
+                    }),
+                T::metadata.aliases);
+        }
+
+        /**
+         * @brief Search for a command that matches most closely to the given name.
+         * @see `utils::fuzzy_search`
+         *
+         * @param name The name of the command to search for.
+         * @return The name of the command that was found.
+         */
+        std::string fuzzy_command_search(const std::string &name) const
+        {
+            return *utils::fuzzy_search(_command_names.begin(), _command_names.end(), name);
+        }
+
+        /**
+         * @brief Run the shell indefinitely.
+         *
+         * @param on_first_prompt A function invoked once the first prompt has been written, or `nullptr`
+         */
+        void run_forever(const std::function<void()> &on_first_prompt = nullptr)
+        {
+            utils::set_ignore_ctrl_c(true);
+
+            // Only the interactive shell loads the history, a broken log does not prevent it from starting
+            try
+            {
+                get_stream()->set_history(std::make_shared<History>(History::default_path()));
+            }
+            catch (std::exception &e)
+            {
+                std::cerr << e.what() << '\n';
+            }
+
+            get_stream()->set_completer(
+                [this](const std::string &line)
+                {
+                    return complete(line);
+                });
+
+            bool prompted = false;
+            while (true)
+            {
+                std::optional<InstructionHandle> instruction;
+                try
+                {
+                    instruction.emplace(
+                        get_stream()->next(
+                            [&on_first_prompt, &prompted]()
+                            {
+                                SYSTEMTIME time;
+                                GetLocalTime(&time);
+                                std::cout << utils::format("\n[%d:%d:%d]", time.wHour, time.wMinute, time.wSecond);
+                                utils::style_print("liteshell~", FOREGROUND_BLUE | FOREGROUND_INTENSITY);
+                                std::cout << utils::get_working_directory() << ">";
+
+                                if (!prompted)
+                                {
+                                    prompted = true;
+                                    if (on_first_prompt)
+                                    {
+                                        std::cout << std::flush;
+                                        on_first_prompt();
+                                    }
+                                }
+                            },
+                            0));
+                }
+                catch (std::exception &)
+                {
+                    if (!utils::StandardStreams::input().eof())
+                    {
+                        throw;
+                    }
+
+                    // Without a console to read again, the shell exits at the end of its input, like `exit`
+                    std::cout << std::endl;
+                    exit(static_cast<int>(get_errorlevel()));
+                }
+
+                process_instruction(**instruction);
+            }
+        }
+
+        /**
+         * @brief Run a script without any prompt, then exit the process with the final errorlevel.
+         *
+         * The script is executed as if it was read from the input stream, so it may still read from stdin (e.g.
+         * `eval -p`) and invoke other scripts.
+         *
+         * @param script The script to run
+         */
+        [[noreturn]] void run_script(const std::shared_ptr<const Script> &script)
+        {
+            // The last frame exits the shell silently once the script, and everything it pushed, is exhausted
+            std::vector<std::string> epilogue = {InputStream::ECHO_OFF, "exit"};
+            get_stream()->write(compile(epilogue.begin(), epilogue.end()), false);
+            get_stream()->write(script, true);
+            while (true)
+            {
+                process_instruction(*get_stream()->next([]() {}, 0));
+            }
+        }
+
+        /**
+         * @brief Run a script without any prompt until it, and everything it pushed, is exhausted.
+         *
+         * Unlike `run_script`, the shell keeps running afterwards. The stream must not contain any other frame.
+         *
+         * @param script The script to run
+         * @param task The background task running the script, which is checked before each instruction, or `nullptr`
+         * @return The final errorlevel
+         */
+        DWORD run_until_finished(const std::shared_ptr<const Script> &script, BackgroundTask *task = nullptr)
+        {
+            get_stream()->write(script, true);
+            return run_until_finished(task);
+        }
+
+        /**
+         * @brief Run the instructions of the stream without any prompt until it is exhausted, e.g. the frames pushed by
+         * a built-in command in a background task.
+         *
+         * @param task The background task running the instructions, which is checked before each one, or `nullptr`
+         * @return The final errorlevel
+         */
+        DWORD run_until_finished(BackgroundTask *task = nullptr)
+        {
+            while (!get_stream()->finished() && (task == nullptr || task->checkpoint()))
+            {
+                try
+                {
+                    process_instruction(*get_stream()->next([]() {}, 0));
+                }
+                catch (std::exception &e)
+                {
+                    on_error(e);
+                }
+            }
+
+            return get_errorlevel();
+        }
+
+        /** @brief Whether the shell serves requests of other processes, in which case `exit` only ends the request */
+        bool is_serving() const
+        {
+            return _serving;
+        }
+
+        /** @brief Set whether the shell serves requests of other processes, see `Server` */
+        void set_serving(const bool serving)
+        {
+            _serving = serving;
+        }
+
+        /**
+         * @brief Compile a range of lines into a script, binding each line to a built-in command if possible.
+         *
+         * @param __begin An iterator pointing to the first line
+         * @param __end An iterator pointing after the last line
+         * @return The compiled script
+         */
+        template <typename _ForwardIterator>
+        std::shared_ptr<const Script> compile(const _ForwardIterator &__begin, const _ForwardIterator &__end) const
+        {
+            return Script::compile(
+                __begin, __end,
+                [this](const std::string &name)
+                {
+                    return _lookup_command(name);
+                });
+        }
+
+        /**
+         * @brief Process a command message.
+         *
+         * @note The resolution order is as follows:
+         * @note - Built-in command
+         * @note - Executable/batch file
+         *
+         * @param message The command message to process.
+         */
+        void process_command(const std::string &message)
+        {
+            process_instruction(
+                Instruction(
+                    message,
+                    [this](const std::string &name)
+                    {
+                        return _lookup_command(name);
+                    }));
+        }
 
-                        if (executable.has_value()) // Is an executable or batch file
-                        {
-#ifdef DEBUG
-                            std::cout << "Matched executable/script " << *executable << std::endl;
-#endif
+        /**
+         * @brief Start a background request for a built-in command or a batch script as a `BackgroundTask`.
+         *
+         * The task has its own environment (layered on a snapshot of the current one) and input stream, see
+         * `TaskContext`. It never reads the console and writes to it directly, unless its outputs are redirected.
+         * A built-in command runs the frames it pushes onto the stream of the task, e.g. the subroutine of `call`.
+         * The variable `task` is set to the name of the new task.
+         *
+         * @param context The context of the command, ending with the background suffix
+         * @param command The index of the built-in command bound at compile time, if any
+         * @param redirected The redirections of the command, which are moved into the task if it starts
+         * @return `false` if the command is an executable, which runs in a background subprocess instead
+         */
+        bool _start_task(const Context &context, const std::optional<std::size_t> &command, std::unique_ptr<RedirectedOutputs> &redirected)
+        {
+            auto stripped = context.strip_background_request();
+            if (stripped.tokens.empty())
+            {
+                throw std::invalid_argument("No command provided");
+            }
 
-                            if (utils::endswith(*executable, ".exe"))
-                            {
-                                auto final_context = context.replace_call(*executable);
+            auto index = command.has_value() ? command : _lookup_command(stripped.tokens[0]);
+            std::function<DWORD(BackgroundTask *)> body;
+            if (index.has_value())
+            {
+                // The arguments are checked before starting the task, so that errors are reported immediately. The
+                // labels and the echo state of the calling script carry over to the task, e.g. for `call :label %`.
+                auto caller = get_stream()->tell();
+                body = [this,
+                        index = *index,
+                        parsed = stripped.parse(&_wrappers[*index].command()->constraint),
+                        labels = caller.has_value() ? caller->first : nullptr,
+                        echo = get_stream()->echo()](BackgroundTask *task)
+                {
+                    get_stream()->set_echo(echo);
+                    if (labels != nullptr)
+                    {
+                        get_stream()->write_labels(labels);
+                    }
 
-                                auto subprocess = spawn_subprocess(final_context);
-                                _environment->set_value("pid", std::to_string(subprocess->pid()));
-                                if (final_context.is_background_request())
-                                {
-                                    _environment->set_value("errorlevel", "0");
-                                }
-                                else
-                                {
-                                    subprocess->wait(INFINITE);
-                                    _environment->set_value("errorlevel", std::to_string(subprocess->exit_code()));
-                                }
-                            }
-                            else
-                            {
-                                process_batch_file(*executable);
-                            }
+                    // The frames pushed by the command (a subroutine, the loop of `watch` or `time`...) run in the task
+                    auto errorlevel = _wrappers[index].run(parsed);
+                    if (get_stream()->finished())
+                    {
+                        return errorlevel;
+                    }
+
+                    get_environment()->set_value(_errorlevel, std::to_string(errorlevel));
+                    return run_until_finished(task);
+                };
+            }
+            else
+            {
+                auto executable = resolve(stripped.tokens[0]);
+                if (!executable.has_value())
+                {
+                    throw _command_not_found(stripped.tokens[0]);
+                }
+
+                if (!_is_script(*executable))
+                {
+                    return false;
+                }
+
+                body = [this, script = load_batch_file(*executable)](BackgroundTask *task)
+                {
+                    return run_until_finished(script, task);
+                };
+            }
+
+            Counters::global().add(Counters::COMMANDS);
+
+            std::shared_ptr<BackgroundTask> task;
+            {
+                std::lock_guard<std::mutex> lock(_tasks_mutex);
+                task = std::make_shared<BackgroundTask>(_tasks.size() + 1, stripped.message);
+                _tasks.push_back(task);
+            }
+
+            // The task keeps the client alive, in case the shell exits before it finishes
+            utils::ThreadPool::shared().submit(
+                [client = _instance, task, body, outputs = std::shared_ptr<RedirectedOutputs>(std::move(redirected)), snapshot = get_environment()->snapshot()]()
+                {
+                    TaskContext task_context(snapshot);
+
+                    utils::ReaderBuffer input(
+                        [](char *, std::size_t)
+                        {
+                            return std::size_t(0);
+                        });
+                    auto console_output = utils::handle_writer(GetStdHandle(STD_OUTPUT_HANDLE));
+                    auto console_error = utils::handle_writer(GetStdHandle(STD_ERROR_HANDLE));
+
+                    DWORD exit_code;
+                    {
+                        auto output = outputs->output() != nullptr ? outputs->output() : console_output.get();
+                        auto error = outputs->error(output);
+                        utils::StandardStreams streams(&input, output, error != nullptr ? error : console_error.get());
+                        try
+                        {
+                            exit_code = task->checkpoint() ? body(task.get()) : 0;
                         }
-                        else
+                        catch (std::exception &e)
                         {
-                            throw;
+                            client->on_error(e);
+                            exit_code = client->get_errorlevel();
                         }
                     }
+
+                    task->finish(exit_code);
+                });
+
+            get_environment()->set_value("task", task->name());
+            get_environment()->set_value(_errorlevel, "0");
+            return true;
+        }
+
+        /**
+         * @brief Execute a resolved command, which is either a built-in command, an executable or a batch script.
+         *
+         * @param context The context of the command
+         * @param command The index of the built-in command bound at compile time, if any
+         * @param redirected The redirections of the command
+         */
+        void _execute(const Context &context, const std::optional<std::size_t> &command, const RedirectedOutputs &redirected)
+        {
+            if (context.tokens.empty())
+            {
+                throw std::invalid_argument("No command provided");
+            }
+
+            Counters::global().add(Counters::COMMANDS);
+
+            auto index = command.has_value() ? command : _lookup_command(context.tokens[0]);
+            if (index.has_value())
+            {
+                auto &wrapper = _wrappers[*index];
+
+#ifdef DEBUG
+                std::cout << "Matched command \"" << wrapper.name << "\"" << std::endl;
+#endif
+
+                Profiler::Scope scope(_active_profiler(), wrapper.name, true);
+
+                Profiler::Span parse(_active_profiler(), Profiler::PARSE);
+                Counters::Span parse_counter(Counters::global(), Counters::PARSE_TIME);
+                auto parsed = context.parse(&wrapper.command()->constraint);
+                parse_counter.stop();
+                parse.stop();
+
+                Profiler::Span execute(_active_profiler(), Profiler::EXECUTE);
+                auto errorlevel = wrapper.run(parsed);
+                execute.stop();
+
+                get_environment()->set_value(_errorlevel, std::to_string(errorlevel));
+                return;
+            }
+
+#ifdef DEBUG
+            std::cout << "No command found. Resolving as an executable/script." << std::endl;
+#endif
+
+            Profiler::Span resolve_span(_active_profiler(), Profiler::RESOLVE);
+            auto executable = resolve(context.tokens[0]);
+            resolve_span.stop();
+
+            if (!executable.has_value())
+            {
+                throw _command_not_found(context.tokens[0]);
+            }
+
+#ifdef DEBUG
+            std::cout << "Matched executable/script " << *executable << std::endl;
+#endif
+
+            if (!_is_script(*executable))
+            {
+                auto final_context = context.replace_call(*executable);
+
+                auto output = redirected.output_handle();
+                auto error = redirected.error_handle(output != NULL ? output : GetStdHandle(STD_OUTPUT_HANDLE));
+
+                redirected.inherit(true);
+                auto _finalize = utils::Finalize(
+                    [&redirected]()
+                    {
+                        redirected.inherit(false);
+                    });
+
+                Profiler::Span execute(_active_profiler(), Profiler::EXECUTE);
+                auto subprocess = spawn_subprocess(final_context, NULL, output, error);
+                execute.stop();
+
+                get_environment()->set_value("pid", std::to_string(subprocess->pid()));
+                if (final_context.is_background_request())
+                {
+                    get_environment()->set_value(_errorlevel, "0");
+                }
+                else
+                {
+                    Profiler::Span wait(_active_profiler(), Profiler::WAIT);
+                    subprocess->wait(INFINITE);
+                    wait.stop();
+
+                    get_environment()->set_value(_errorlevel, std::to_string(subprocess->exit_code()));
+                }
+            }
+            else if (redirected.output() != nullptr || redirected.error(nullptr) != nullptr)
+            {
+                throw std::invalid_argument("The output of a batch script cannot be redirected");
+            }
+            else
+            {
+                process_batch_file(*executable);
+            }
+        }
+
+        /**
+         * @brief Execute a compiled instruction.
+         *
+         * Instructions without variable references are executed with their pre-split tokens and pre-bound
+         * command. Other instructions are resolved, tokenized and bound before execution.
+         *
+         * @see `Client::process_command`
+         *
+         * @param instruction The instruction to execute.
+         */
+        void process_instruction(const Instruction &instruction)
+        {
+            if (instruction.is_label())
+            {
+                return;
+            }
+
+            // Only the thread running the shell releases the subprocesses, which may be in use by its commands
+            if (TaskContext::current() == nullptr)
+            {
+                _reap();
+            }
+
+            Profiler::Scope scope(_active_profiler(), instruction.source, false);
+            try
+            {
+                if (!instruction.pipeline.empty())
+                {
+                    _process_pipeline(instruction);
+                    return;
+                }
+
+                std::optional<std::size_t> command;
+                Profiler::Span resolve_span(_active_profiler(), Profiler::RESOLVE);
+                auto prepared = _prepare(instruction, command);
+                resolve_span.stop();
+
+                if (!prepared.has_value())
+                {
+                    return;
+                }
+
+                auto redirected = _redirect(instruction);
+                if (prepared->is_background_request() && _start_task(*prepared, command, redirected))
+                {
+                    return;
+                }
+
+                utils::StandardStreams streams(
+                    nullptr,
+                    redirected->output(),
+                    redirected->error(redirected->output() != nullptr ? redirected->output() : utils::StandardStreams::output()));
+
+                // Errors are reported while the redirections are still active, so that `2>` captures them
+                try
+                {
+                    _execute(*prepared, command, *redirected);
+                }
+                catch (std::exception &error)
+                {
+                    on_error(error);
                 }
             }
             catch (std::exception &error)
@@ -493,6 +1530,35 @@ namespace liteshell
             }
         }
 
+        /**
+         * @brief Resolve a command message to the executable it invokes.
+         *
+         * @param message The command message, whose environment variables are already resolved
+         * @return A context holding the command message with its first token replaced by the absolute path to the
+         * executable, ready to be passed to `Client::spawn_subprocess`
+         */
+        Context resolve_executable(const std::string &message) const
+        {
+            auto context = Context::get_context(_instance, message);
+            if (context.tokens.empty())
+            {
+                throw std::invalid_argument("No command provided");
+            }
+
+            auto executable = resolve(context.tokens[0]);
+            if (!executable.has_value())
+            {
+                throw _command_not_found(context.tokens[0]);
+            }
+
+            if (_is_script(*executable))
+            {
+                throw std::invalid_argument(utils::format("Not an executable: %s", executable->c_str()));
+            }
+
+            return context.replace_call(*executable);
+        }
+
         /**
          * @brief Split the PATH environment variable into a vector of paths.
          *
@@ -500,55 +1566,274 @@ namespace liteshell
          */
         std::vector<std::string> get_resolve_order() const
         {
-            return utils::split(_environment->get_value("PATH"), ';');
+            std::lock_guard<std::mutex> lock(_executables_mutex);
+            return _executables.directories(get_environment()->get_view(_path));
+        }
+
+        /**
+         * @brief Get the cache of the executables found in the directories of `PATH`
+         *
+         * @return A reference to the cache
+         */
+        ExecutableCache &get_executable_cache() const
+        {
+            return _executables;
+        }
+
+        /**
+         * @brief Complete the last word of a partial command line.
+         *
+         * A word starting with `$` is completed with the names of the variables. The first word of a command
+         * (also after a pipe) is completed with the names of the built-in commands, the executables (`.exe` and
+         * `LITE_SHELL_SCRIPT_EXTENSION`) in the directories of `PATH` without their extension, and file paths.
+         * Other words are completed with file paths, relative to the working directory unless they are absolute.
+         * Matching ignores case.
+         *
+         * Directory listings come from a cache refreshed by change notifications, a directory which cannot be
+         * listed within `timeout` (e.g. on a slow network share) is skipped until its listing is ready.
+         *
+         * @param line The command line up to the cursor
+         * @param timeout The maximum time to wait for each directory which is listed or has changed since its last
+         * listing
+         * @return The completions of the last word, sorted
+         */
+        Completion complete(const std::string &line, const std::chrono::milliseconds &timeout = std::chrono::milliseconds(100)) const
+        {
+            Completion completion;
+
+            bool quoted = false;
+            for (std::size_t i = 0; i < line.size(); i++)
+            {
+                if (line[i] == '"')
+                {
+                    quoted = !quoted;
+                }
+                else if (!quoted && (line[i] == ' ' || line[i] == Instruction::PIPE))
+                {
+                    completion.start = i + 1;
+                }
+            }
+
+            auto previous = completion.start == 0 ? std::string::npos : line.find_last_not_of(' ', completion.start - 1);
+            bool first = previous == std::string::npos || line[previous] == Instruction::PIPE;
+
+            std::string word;
+            std::copy_if(
+                line.begin() + completion.start, line.end(), std::back_inserter(word),
+                [](const char c)
+                { return c != '"'; });
+
+            auto matches = [](const std::string &candidate, const std::string_view &prefix)
+            {
+                return candidate.size() >= prefix.size() &&
+                       std::equal(
+                           prefix.begin(), prefix.end(), candidate.begin(),
+                           [](const char x, const char y)
+                           { return std::tolower(static_cast<unsigned char>(x)) == std::tolower(static_cast<unsigned char>(y)); });
+            };
+
+            auto &candidates = completion.candidates;
+            if (!word.empty() && word.front() == '$')
+            {
+                auto prefix = std::string_view(word).substr(1);
+                for (auto [name, _] : get_environment()->get_values())
+                {
+                    std::string candidate(name);
+                    if (matches(candidate, prefix))
+                    {
+                        candidates.push_back("$" + candidate);
+                    }
+                }
+            }
+            else
+            {
+                auto separator = word.find_last_of("\\/");
+                if (first && separator == std::string::npos)
+                {
+                    for (auto &name : _command_names)
+                    {
+                        if (matches(name, word))
+                        {
+                            candidates.push_back(name);
+                        }
+                    }
+
+                    for (auto &directory : get_resolve_order())
+                    {
+                        auto listing = directory.empty() ? nullptr : _listings.list(directory, timeout);
+                        if (listing == nullptr)
+                        {
+                            continue;
+                        }
+
+                        for (auto &entry : *listing)
+                        {
+                            auto lowercase = utils::to_lowercase(entry.name);
+                            if (!entry.directory && matches(entry.name, word))
+                            {
+                                if (utils::endswith(lowercase, LITE_SHELL_SCRIPT_EXTENSION))
+                                {
+                                    candidates.push_back(entry.name.substr(0, entry.name.size() - std::strlen(LITE_SHELL_SCRIPT_EXTENSION)));
+                                }
+                                else if (utils::endswith(lowercase, LITE_SHELL_EXECUTABLE_EXTENSION))
+                                {
+                                    candidates.push_back(entry.name.substr(0, entry.name.size() - std::strlen(LITE_SHELL_EXECUTABLE_EXTENSION)));
+                                }
+                            }
+                        }
+                    }
+                }
+
+                auto parent = separator == std::string::npos ? std::string() : word.substr(0, separator + 1);
+                auto name = std::string_view(word).substr(parent.size());
+
+                // Absolute paths are "C:\..." and "\\server\share\...", rooted paths "\..." are on the drive of the working
+                // directory, relative paths are listed from the working directory
+                auto absolute = (parent.size() >= 2 && parent[1] == ':') || utils::startswith(parent, "\\\\");
+                try
+                {
+                    auto directory = parent;
+                    if (!absolute)
+                    {
+                        auto working = utils::get_working_directory();
+                        if (!parent.empty() && utils::is_path_separator(parent.front()))
+                        {
+                            directory = (working.size() >= 2 && working[1] == ':' ? working.substr(0, 2) : "") + parent;
+                        }
+                        else
+                        {
+                            directory = utils::join(working, parent);
+                        }
+                    }
+
+                    auto listing = _listings.list(directory, timeout);
+                    if (listing != nullptr)
+                    {
+                        for (auto &entry : *listing)
+                        {
+                            if (matches(entry.name, name))
+                            {
+                                candidates.push_back(parent + entry.name + (entry.directory ? "\\" : ""));
+                            }
+                        }
+                    }
+                }
+                catch (std::exception &)
+                {
+                    // pass
+                }
+            }
+
+            auto less = [](const std::string &x, const std::string &y)
+            {
+                return utils::to_lowercase(x) < utils::to_lowercase(y);
+            };
+            std::sort(candidates.begin(), candidates.end(), less);
+
+            // A built-in command hides an executable of the same name
+            candidates.erase(
+                std::unique(
+                    candidates.begin(), candidates.end(),
+                    [&less](const std::string &x, const std::string &y)
+                    { return !less(x, y) && !less(y, x); }),
+                candidates.end());
+
+            return completion;
         }
 
         /**
          * @brief Spawn a subprocess and execute `command` in it.
          *
          * @param context A context holding the command to execute.
+         * @param input An inheritable handle to use as the standard input of the subprocess, or `NULL` to use
+         * the standard input of the shell.
+         * @param output An inheritable handle to use as the standard output of the subprocess, or `NULL` to use
+         * the standard output of the shell.
+         * @param error An inheritable handle to use as the standard error of the subprocess, or `NULL` to use
+         * the standard error of the shell.
          * @return A pointer to the wrapper object containing information about the subprocess.
          */
-        ProcessInfoWrapper *spawn_subprocess(const Context &context)
+        ProcessInfoWrapper *spawn_subprocess(
+            const Context &context,
+            const HANDLE input = NULL,
+            const HANDLE output = NULL,
+            const HANDLE error = NULL)
         {
+            Counters::global().add(Counters::SUBPROCESSES);
+
+            auto start = std::chrono::steady_clock::now();
             auto final_context = context.strip_background_request();
 
+            // The output of the shell must appear before the output of the subprocess
+            std::cout << std::flush;
+
             STARTUPINFOW startup_info;
             ZeroMemory(&startup_info, sizeof(startup_info));
             startup_info.cb = sizeof(startup_info);
+            if (input != NULL || output != NULL || error != NULL)
+            {
+                startup_info.dwFlags |= STARTF_USESTDHANDLES;
+                startup_info.hStdInput = input != NULL ? input : GetStdHandle(STD_INPUT_HANDLE);
+                startup_info.hStdOutput = output != NULL ? output : GetStdHandle(STD_OUTPUT_HANDLE);
+                startup_info.hStdError = error != NULL ? error : GetStdHandle(STD_ERROR_HANDLE);
+            }
+
+            // CreateProcessW may modify the command line, so it is converted again into the same buffer each time
+            static thread_local std::wstring command_line;
+            utils::utf_convert(final_context.message, command_line);
 
+            // The subprocess is created suspended, so that it cannot start any process outside its job object
             PROCESS_INFORMATION process_info;
             auto success = CreateProcessW(
-                NULL,                                                           // lpApplicationName
-                utils::utf_convert(final_context.message).data(),               // lpCommandLine
-                NULL,                                                           // lpProcessAttributes
-                NULL,                                                           // lpThreadAttributes
-                TRUE,                                                           // bInheritHandles
-                context.is_background_request() ? CREATE_NEW_PROCESS_GROUP : 0, // dwCreationFlags
-                NULL,                                                           // lpEnvironment
-                NULL,                                                           // lpCurrentDirectory
-                &startup_info,                                                  // lpStartupInfo
-                &process_info                                                   // lpProcessInformation
+                NULL,                                                                                // lpApplicationName
+                command_line.data(),                                                                 // lpCommandLine
+                NULL,                                                                                // lpProcessAttributes
+                NULL,                                                                                // lpThreadAttributes
+                TRUE,                                                                                // bInheritHandles
+                (context.is_background_request() ? CREATE_NEW_PROCESS_GROUP : 0) | CREATE_SUSPENDED, // dwCreationFlags
+                NULL,                                                                                // lpEnvironment
+                NULL,                                                                                // lpCurrentDirectory
+                &startup_info,                                                                       // lpStartupInfo
+                &process_info                                                                        // lpProcessInformation
             );
 
-            if (success)
             {
-                ProcessInfoWrapper *wrapper = new ProcessInfoWrapper(process_info, final_context.message);
-                _subprocesses.push_back(wrapper);
-
-                // Do not close the handles since we want to keep track of all subprocesses in our current shell (unless explicitly closed)
+                std::lock_guard<std::mutex> lock(_subprocesses_mutex);
+                _spawn_statistics.record(std::chrono::steady_clock::now() - start);
+            }
 
-                /*
-                SECURITY_ATTRIBUTES sec_attrs;
-                sec_attrs.nLength = sizeof(SECURITY_ATTRIBUTES);
-                sec_attrs.bInheritHandle = true;
-                sec_attrs.lpSecurityDescriptor = NULL;
+            if (success)
+            {
+                HANDLE job;
+                try
+                {
+                    job = _create_job(process_info.hProcess);
+                }
+                catch (std::exception &)
+                {
+                    TerminateProcess(process_info.hProcess, 1);
+                    CloseHandle(process_info.hProcess);
+                    CloseHandle(process_info.hThread);
+                    throw;
+                }
 
-                // Open the thread and close the handle immediately
-                // https://stackoverflow.com/a/11226526
-                CloseHandle(CreateThread(&sec_attrs, 0, waiter_thread, &process_info, 0, NULL));
-                */
+                // The exit of the subprocess is recorded by a wait callback, its handles are released by the next
+                // call to `_reap` while its exit code, end time and resource usage stay available
+                ProcessInfoWrapper *wrapper = new ProcessInfoWrapper(
+                    process_info,
+                    final_context.message,
+                    [this](ProcessInfoWrapper *subprocess)
+                    {
+                        std::lock_guard<std::mutex> lock(_exited_mutex);
+                        _exited.push_back(subprocess);
+                    },
+                    job);
+                {
+                    std::lock_guard<std::mutex> lock(_subprocesses_mutex);
+                    _subprocesses.push_back(wrapper);
+                }
 
+                ResumeThread(process_info.hThread);
                 return wrapper;
             }
             else
@@ -566,7 +1851,7 @@ namespace liteshell
          */
         DWORD get_errorlevel() const
         {
-            return std::stoul(_environment->get_value("errorlevel"));
+            return std::stoul(std::string(get_environment()->get_view(_errorlevel)));
         }
     };
 
@@ -0,0 +1,178 @@
+#pragma once
+
+#include "standard.hpp"
+
+namespace utils
+{
+    /**
+     * @brief A large, thread-safe output buffer for the standard output of the shell.
+     *
+     * UTF-8 output is accumulated and written in large batches: with `WriteConsoleW` when the standard output is a
+     * console, with `WriteFile` otherwise (e.g. when the shell itself is piped). The buffer is only flushed when it
+     * is full or on an explicit `std::flush`, which also happens before each read from `std::cin` since `std::cin`
+     * is tied to `std::cout`.
+     *
+     * Lines must therefore be terminated with `'\n'` instead of `std::endl` to benefit from the batching.
+     */
+    class ConsoleBuffer : public std::streambuf
+    {
+    private:
+        /** @brief The size of the buffer */
+        static const std::size_t CAPACITY = 1 << 16;
+
+        /** @brief The maximum number of characters per `WriteConsoleW` call */
+        static constexpr std::size_t CONSOLE_CHUNK = 1 << 14;
+
+        const HANDLE _handle;
+        const bool _console;
+
+        std::mutex _mutex;
+        std::string _buffer;
+        std::wstring _wide;
+
+        ConsoleBuffer(const ConsoleBuffer &) = delete;
+        ConsoleBuffer &operator=(const ConsoleBuffer &) = delete;
+
+        static bool _is_console(const HANDLE handle)
+        {
+            DWORD mode;
+            return GetConsoleMode(handle, &mode);
+        }
+
+        /** @brief The length of the longest prefix of `_buffer` which does not end with a partial UTF-8 sequence */
+        std::size_t _complete_prefix() const
+        {
+            auto size = _buffer.size();
+            for (std::size_t back = 1; back <= std::min<std::size_t>(4, size); back++)
+            {
+                auto c = static_cast<unsigned char>(_buffer[size - back]);
+                if ((c & 0xC0) != 0x80)
+                {
+                    std::size_t length = c < 0x80 ? 1 : (c >= 0xF0 ? 4 : (c >= 0xE0 ? 3 : 2));
+                    return length > back ? size - back : size;
+                }
+            }
+
+            return size;
+        }
+
+        /** @brief Write the content of the buffer, the mutex must be held */
+        void _flush()
+        {
+            if (!_console)
+            {
+                _write_file(_buffer.data(), _buffer.size());
+                _buffer.clear();
+                return;
+            }
+
+            // A partial UTF-8 sequence is kept until it is completed
+            auto size = _complete_prefix();
+            if (size > 0)
+            {
+                _wide.resize(size);
+                auto length = MultiByteToWideChar(CP_UTF8, 0, _buffer.data(), size, _wide.data(), size);
+                for (int offset = 0; offset < length;)
+                {
+                    DWORD written = 0;
+                    auto count = std::min<std::size_t>(length - offset, CONSOLE_CHUNK);
+                    if (!WriteConsoleW(_handle, _wide.data() + offset, count, &written, NULL) || written == 0)
+                    {
+                        break;
+                    }
+
+                    offset += written;
+                }
+
+                _buffer.erase(0, size);
+            }
+        }
+
+        void _write_file(const char *data, std::size_t size)
+        {
+            while (size > 0)
+            {
+                DWORD written = 0;
+                if (!WriteFile(_handle, data, size, &written, NULL))
+                {
+                    return; // The reader has exited, discard the remaining data
+                }
+
+                data += written;
+                size -= written;
+            }
+        }
+
+    protected:
+        int_type overflow(int_type c) override
+        {
+            if (!traits_type::eq_int_type(c, traits_type::eof()))
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                _buffer += traits_type::to_char_type(c);
+                if (_buffer.size() >= CAPACITY)
+                {
+                    _flush();
+                }
+            }
+
+            return traits_type::not_eof(c);
+        }
+
+        std::streamsize xsputn(const char *data, std::streamsize size) override
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            if (!_console && _buffer.size() + size >= CAPACITY)
+            {
+                // Large writes to a file or a pipe skip the buffer instead of being copied through it
+                _flush();
+                _write_file(data, size);
+                return size;
+            }
+
+            _buffer.append(data, size);
+            if (_buffer.size() >= CAPACITY)
+            {
+                _flush();
+            }
+
+            return size;
+        }
+
+        int sync() override
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _flush();
+            return 0;
+        }
+
+    public:
+        /**
+         * @brief Construct a new `ConsoleBuffer` object
+         *
+         * @param handle The handle to write to, e.g. the standard output
+         */
+        explicit ConsoleBuffer(const HANDLE handle) : _handle(handle), _console(_is_console(handle))
+        {
+            _buffer.reserve(CAPACITY);
+        }
+
+        /** @brief Destructor for this object, which flushes the remaining data */
+        ~ConsoleBuffer()
+        {
+            sync();
+        }
+
+        /**
+         * @brief The buffer of the standard output of the process.
+         *
+         * It is never destroyed, so that it outlives any stream forwarding to it and is still flushed when
+         * `std::cout` is flushed at exit.
+         */
+        static ConsoleBuffer &standard_output()
+        {
+            static auto buffer = new ConsoleBuffer(GetStdHandle(STD_OUTPUT_HANDLE));
+            return *buffer;
+        }
+    };
+}
@@ -175,6 +175,51 @@ namespace liteshell
         const std::string help;
         using _SupportsMultiplePositionalArguments::positional;
 
+    private:
+        const std::vector<std::string> _names;
+
+        static std::vector<std::string> _create_names(
+            const std::optional<std::string> &short_name,
+            const std::optional<std::string> &long_name)
+        {
+            std::vector<std::string> result;
+            if (short_name.has_value())
+            {
+                result.push_back(*short_name);
+            }
+
+            if (long_name.has_value())
+            {
+                result.push_back(*long_name);
+            }
+
+            return result;
+        }
+
+        static std::vector<std::vector<std::string>> _create_qualified_names(
+            const std::vector<std::string> &names,
+            const std::vector<PositionalArgument> &positional)
+        {
+            std::vector<std::vector<std::string>> result;
+            for (auto &name : names)
+            {
+                auto &qualified = result.emplace_back();
+                for (auto &argument : positional)
+                {
+                    qualified.push_back(name + " " + argument.name);
+                }
+            }
+
+            return result;
+        }
+
+    public:
+        /**
+         * @brief The qualified names of the inner positional arguments, `qualified_names[i][j]` is the name of
+         * the j-th positional argument when the option is specified with its i-th name e.g. `"-t type"`
+         */
+        const std::vector<std::vector<std::string>> qualified_names;
+
         /**
          * @brief Construct a new `Option`
          *
@@ -193,7 +238,9 @@ namespace liteshell
                                    _SupportsMultiplePositionalArguments(positional),
                                    short_name(short_name),
                                    long_name(long_name),
-                                   help(help)
+                                   help(help),
+                                   _names(_create_names(short_name, long_name)),
+                                   qualified_names(_create_qualified_names(_names, positional))
         {
             if (!short_name.has_value() && !long_name.has_value())
             {
@@ -230,20 +277,9 @@ namespace liteshell
          *
          * @return A vector containing all names of this option (length 1 or 2)
          */
-        std::vector<std::string> names() const
+        const std::vector<std::string> &names() const
         {
-            std::vector<std::string> result;
-            if (short_name.has_value())
-            {
-                result.push_back(*short_name);
-            }
-
-            if (long_name.has_value())
-            {
-                result.push_back(*long_name);
-            }
-
-            return result;
+            return _names;
         }
 
         /** @copydoc _BaseArgument::display */
@@ -272,7 +308,10 @@ namespace liteshell
     {
     private:
         std::vector<Option> options;
-        std::map<std::string, std::size_t> options_map;
+        std::map<std::string, std::size_t, std::less<>> options_map;
+
+        /** @brief Whether `-c` is an option name, for each character `c` */
+        std::array<bool, 256> short_options = {};
 
         void check_duplicate_option_name(const std::string &name) const
         {
@@ -351,11 +390,29 @@ namespace liteshell
                    PositionalArgument(name_3, help_3, many, required_3)}) {}
 
         /** @brief Whether there exists an `Option` with the given name */
-        bool has_option(const std::string &name) const
+        bool has_option(const std::string_view &name) const
         {
             return options_map.find(name) != options_map.end();
         }
 
+        /** @brief Whether there exists an `Option` whose short name is `-c` */
+        bool has_short_option(const char c) const
+        {
+            return short_options[static_cast<unsigned char>(c)];
+        }
+
+        /**
+         * @brief Find an `Option` by one of its names
+         *
+         * @param name The short or long name of the option
+         * @return A pointer to the option, or `nullptr` if it does not exist
+         */
+        const Option *find_option(const std::string_view &name) const
+        {
+            auto iter = options_map.find(name);
+            return iter == options_map.end() ? nullptr : &options[iter->second];
+        }
+
         /** @brief Get a mapping from option names to their corresponding options */
         std::map<std::string, Option> get_options_map() const
         {
@@ -372,7 +429,7 @@ namespace liteshell
         }
 
         /** @brief Get a vector of all options with no duplication */
-        std::vector<Option> get_options_vector() const
+        const std::vector<Option> &get_options_vector() const
         {
             return options;
         }
@@ -390,6 +447,10 @@ namespace liteshell
             {
                 check_duplicate_option_name(name);
                 options_map[name] = options.size() - 1;
+                if (name.size() == 2)
+                {
+                    short_options[static_cast<unsigned char>(name[1])] = true;
+                }
             }
 
             return *this;
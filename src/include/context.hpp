@@ -1,7 +1,9 @@
 #pragma once
 
+#include "arena.hpp"
 #include "constraint.hpp"
 #include "error.hpp"
+#include "maps.hpp"
 #include "split.hpp"
 
 namespace liteshell
@@ -18,16 +20,16 @@ namespace liteshell
     {
     private:
         Context(
-            const std::string &message,
-            const std::vector<std::string> &tokens,
-            const std::map<std::string, std::vector<std::string>> &values,
-            const std::set<std::string> &present,
+            std::string message,
+            std::vector<std::string> tokens,
+            utils::FlatMap<std::string, std::vector<std::string>> values,
+            utils::FlatSet<std::string> present,
             const std::shared_ptr<class Client> &client,
-            const std::optional<CommandConstraint> &constraint)
-            : message(message),
-              tokens(tokens),
-              values(values),
-              present(present),
+            const CommandConstraint *constraint)
+            : message(std::move(message)),
+              tokens(std::move(tokens)),
+              values(std::move(values)),
+              present(std::move(present)),
               client(client),
               constraint(constraint) {}
 
@@ -35,6 +37,9 @@ namespace liteshell
         /** @brief A suffix indicating that a command message should be run in a background */
         static const char BACKGROUND_SUFFIX = '%';
 
+        /** @brief A token after which all tokens are positional arguments, even if they look like options */
+        static constexpr std::string_view END_OF_OPTIONS = "--";
+
         /** @brief The message that triggered the command being executed. */
         const std::string message;
 
@@ -42,16 +47,16 @@ namespace liteshell
         const std::vector<std::string> tokens;
 
         /** @brief A mapping of argument names to their values. */
-        const std::map<std::string, std::vector<std::string>> values;
+        const utils::FlatMap<std::string, std::vector<std::string>> values;
 
         /** @brief The options presenting in the command. */
-        const std::set<std::string> present;
+        const utils::FlatSet<std::string> present;
 
         /** @brief A pointer to the client that contains the command being executed. */
         const std::shared_ptr<class Client> client;
 
-        /** @brief The arguments constraint of this context object */
-        const std::optional<CommandConstraint> constraint;
+        /** @brief The arguments constraint of this context object, or `nullptr` if it was not parsed with one */
+        const CommandConstraint *const constraint;
 
         /**
          * @brief Get the first value of an argument.
@@ -77,15 +82,34 @@ namespace liteshell
             return iter->second[0];
         }
 
+        /**
+         * @brief Get the first value of an optional argument.
+         *
+         * Unlike `get`, this does not throw if the argument is missing.
+         *
+         * @param name The name of the argument to get
+         * @return The first value of the argument, or an empty optional if it was not provided
+         */
+        std::optional<std::string> try_get(const std::string &name) const
+        {
+            auto iter = values.find(name);
+            if (iter == values.end() || iter->second.empty())
+            {
+                return std::nullopt;
+            }
+
+            return iter->second[0];
+        }
+
         /**
          * @brief Parse this context with another constraint.
          *
-         * @param constraint The new constraint to parse the context with
+         * @param constraint The new constraint to parse the context with, which must outlive the new context
          * @return A new context with the new constraint applied
          */
-        Context parse(const std::optional<CommandConstraint> &constraint) const
+        Context parse(const CommandConstraint *constraint) const
         {
-            return get_context(client, message, constraint);
+            return get_context(client, message, tokens, constraint);
         }
 
         /**
@@ -107,7 +131,7 @@ namespace liteshell
             std::vector<std::string> new_tokens(tokens);
             new_tokens[0] = token;
 
-            return Context(new_message, new_tokens, values, present, client, constraint);
+            return Context(std::move(new_message), std::move(new_tokens), values, present, client, constraint);
         }
 
         /**
@@ -127,7 +151,20 @@ namespace liteshell
                 }
 
                 auto new_message = message.substr(0, size - 1);
-                return get_context(client, new_message, constraint);
+                if (constraint != nullptr)
+                {
+                    // The suffix may have been parsed as an argument value
+                    return get_context(client, new_message, constraint);
+                }
+
+                // The suffix is a separate token, dropping it is enough without tokenizing the message again
+                while (!new_message.empty() && (new_message.back() == ' ' || new_message.back() == '\t'))
+                {
+                    new_message.pop_back();
+                }
+
+                std::vector<std::string> new_tokens(tokens.begin(), tokens.end() - 1);
+                return Context(std::move(new_message), std::move(new_tokens), values, present, client, constraint);
             }
 
             return *this;
@@ -149,102 +186,125 @@ namespace liteshell
          *
          * @param client A pointer to the Client object
          * @param message The message to construct the context from
-         * @param constraint The constraint to parse the context with (if `std::nullopt` is provided, the
+         * @param constraint The constraint to parse the context with (if `nullptr` is provided, the
          * resulting `Context` will have its `Context::values` and `Context::present` be empty containers)
          * @return A new context object
          */
-        static Context get_context(const std::shared_ptr<Client> &client, const std::string &message, const std::optional<CommandConstraint> &constraint = std::nullopt);
+        static Context get_context(const std::shared_ptr<Client> &client, const std::string &message, const CommandConstraint *constraint = nullptr);
+
+        /**
+         * @brief Construct a `Context` from a message that was already tokenized
+         *
+         * @param client A pointer to the Client object
+         * @param message The message to construct the context from
+         * @param tokens The tokens of `message`, as returned by `utils::split`
+         * @param constraint The constraint to parse the context with
+         * @return A new context object
+         */
+        static Context get_context(
+            const std::shared_ptr<Client> &client,
+            const std::string &message,
+            const std::vector<std::string> &tokens,
+            const CommandConstraint *constraint = nullptr);
     };
 
-    Context Context::get_context(const std::shared_ptr<Client> &client, const std::string &message, const std::optional<CommandConstraint> &constraint)
+    Context Context::get_context(const std::shared_ptr<Client> &client, const std::string &message, const CommandConstraint *constraint)
+    {
+        return get_context(client, message, utils::split(message), constraint);
+    }
+
+    Context Context::get_context(
+        const std::shared_ptr<Client> &client,
+        const std::string &message,
+        const std::vector<std::string> &tokens,
+        const CommandConstraint *constraint)
     {
-        const auto tokens = utils::split(message);
 #ifdef DEBUG
         std::cout << "Parsing context from tokens: " << tokens << std::endl;
 #endif
 
-        std::map<std::string, std::vector<std::string>> values;
-        std::set<std::string> present;
+        utils::FlatMap<std::string, std::vector<std::string>> values;
+        utils::FlatSet<std::string> present;
 
-        if (constraint.has_value())
+        if (constraint != nullptr)
         {
+            // The temporaries of the parser are allocated from the arena of the current command line
+            utils::Arena::Scope arena;
+
             // Preprocess the tokens: split "-abc" into "-a", "-b", "-c" if all are valid options, etc.
-            // Copy all tokens to a linked list for fast insertion/deletion.
-            std::list<std::string> new_tokens(tokens.begin(), tokens.end());
-            for (auto iter = new_tokens.begin(); iter != new_tokens.end(); iter++)
+            std::pmr::vector<std::pmr::string> new_tokens(utils::Arena::resource());
+            new_tokens.reserve(tokens.size());
+            bool options_ended = false;
+            for (auto &token : tokens)
             {
-                if (utils::startswith(*iter, "-"))
+                options_ended = options_ended || token == END_OF_OPTIONS;
+
+                // "--name=value" is the same as "--name value" if "--name" is a valid option taking a value
+                auto equal = !options_ended && utils::startswith(token, "--") ? token.find('=') : std::string::npos;
+                auto option = equal == std::string::npos ? nullptr : constraint->find_option(std::string_view(token).substr(0, equal));
+                if (option != nullptr)
                 {
-                    if (utils::is_valid_long_option(*iter))
+                    if (option->positional.empty())
                     {
-                        // pass
+                        throw std::invalid_argument(utils::format("Option \"%s\" does not take a value", token.substr(0, equal).c_str()));
                     }
-                    else if (iter->size() > 2)
-                    {
-                        // Split "-abc" into "-a", "-b", "-c" (no checking is done yet)
-                        std::vector<std::string> options;
-                        for (std::size_t i = 1; i < iter->size(); i++)
-                        {
-                            options.push_back(utils::format("-%c", iter->at(i)));
-                        }
 
-                        // Now we perform options checking
-                        bool split = true;
-                        for (auto &option : options)
-                        {
-                            if (!constraint->has_option(option))
-                            {
-                                split = false;
-                                break;
-                            }
-                        }
+                    new_tokens.emplace_back(std::string_view(token).substr(0, equal));
+                    new_tokens.emplace_back(std::string_view(token).substr(equal + 1));
+                    continue;
+                }
 
-                        if (split)
-                        {
-                            // All options are valid, insert the split options into the linked list
+                bool split = !options_ended && token.size() > 2 && token[0] == '-' && !utils::is_valid_long_option(token);
+                for (std::size_t i = 1; split && i < token.size(); i++)
+                {
+                    split = constraint->has_short_option(token[i]);
+                }
+
+                if (split)
+                {
 #ifdef DEBUG
-                            std::cout << "Split " << *iter << " to " << options << std::endl;
+                    std::cout << "Split " << token << std::endl;
 #endif
-
-                            // Delete the current token e.g. "-abc"
-                            iter = new_tokens.erase(iter);
-
-                            // Insert the split tokens e.g. "-a", "-b", "-c"
-                            iter = new_tokens.insert(iter, options.begin(), options.end());
-                        }
+                    for (std::size_t i = 1; i < token.size(); i++)
+                    {
+                        new_tokens.emplace_back(std::initializer_list<char>{'-', token[i]});
                     }
                 }
+                else
+                {
+                    new_tokens.emplace_back(token);
+                }
             }
 
 #ifdef DEBUG
             std::cout << "Splitted tokens: " << new_tokens << std::endl;
 #endif
 
-            // Vectorize the linked list for fast random access
-            const std::vector<std::string> new_tokens_v(new_tokens.begin(), new_tokens.end());
-            const auto options = constraint->get_options_map();
+            const auto &options = constraint->get_options_vector();
 
             auto positional_iter = constraint->positional.begin();
-            std::map<std::string, std::vector<PositionalArgument>::const_iterator> options_iter;
-            for (auto &[name, option] : options)
-            {
-                options_iter[name] = option.positional.cbegin();
-            }
 
-            for (std::size_t i = 1; i < new_tokens_v.size(); i++)
+            // The index of the next positional argument of each option
+            std::pmr::vector<std::size_t> options_positional(options.size(), utils::Arena::resource());
+            options_ended = false;
+            for (std::size_t i = 1; i < new_tokens.size(); i++)
             {
-                const auto token = new_tokens_v[i];
+                const auto &token = new_tokens[i];
 #ifdef DEBUG
                 std::cout << "Parsing at i = " << i << ", token = \"" << token << "\"" << std::endl;
 #endif
 
-                const auto option_iter = options.find(token);
-                if (option_iter != options.end())
+                const auto option = options_ended ? nullptr : constraint->find_option(token);
+                if (!options_ended && token == END_OF_OPTIONS)
+                {
+                    options_ended = true;
+                }
+                else if (option != nullptr)
                 {
                     bool inserted = true;
-                    for (auto &name : option_iter->second.names())
+                    for (auto &name : option->names())
                     {
-                        inserted = inserted && present.insert(name).second;
+                        inserted = present.insert(name) && inserted;
                     }
                     if (!inserted)
                     {
@@ -253,30 +313,32 @@ namespace liteshell
 
                     i++;
 
-                    while (i < new_tokens_v.size() && !constraint->has_option(new_tokens_v[i]) && options_iter[token] != option_iter->second.positional.cend())
+                    auto &position = options_positional[option - options.data()];
+                    while (i < new_tokens.size() && !constraint->has_option(new_tokens[i]) && position < option->positional.size())
                     {
-                        for (auto &name : option_iter->second.names())
+                        for (auto &qualified_names : option->qualified_names)
                         {
-                            auto qualified_name = name + " " + options_iter[name]->name;
-                            values[qualified_name].push_back(new_tokens_v[i]);
+                            const auto &qualified_name = qualified_names[position];
+                            values[qualified_name].emplace_back(new_tokens[i]);
                             present.insert(qualified_name);
-                            if (!options_iter[name]->many)
-                            {
-                                options_iter[name]++;
-                            }
+                        }
+
+                        if (!option->positional[position].many)
+                        {
+                            position++;
                         }
 
                         i++;
                     }
 
-                    if (i < new_tokens_v.size())
+                    if (i < new_tokens.size())
                     {
                         i--;
                     }
                 }
-                else if (utils::is_valid_short_option(token) || utils::is_valid_long_option(token))
+                else if (!options_ended && (utils::is_valid_short_option(token) || utils::is_valid_long_option(token)))
                 {
-                    throw UnrecognizedOption(token);
+                    throw UnrecognizedOption(std::string(token));
                 }
                 else if (positional_iter == constraint->positional.end())
                 {
@@ -284,7 +346,7 @@ namespace liteshell
                 }
                 else
                 {
-                    values[positional_iter->name].push_back(token);
+                    values[positional_iter->name].emplace_back(token);
                     present.insert(positional_iter->name);
                     if (!positional_iter->many)
                     {
@@ -307,27 +369,31 @@ namespace liteshell
                 }
             }
 
-            for (auto &[name, option] : options)
+            for (auto &option : options)
             {
-                if (option.required || present.count(name) == 1)
+                const auto &names = option.names();
+                for (std::size_t n = 0; n < names.size(); n++)
                 {
-                    if (present.count(name) == 0)
+                    if (option.required || present.count(names[n]) == 1)
                     {
-                        throw ArgumentMissingError(name);
-                    }
+                        if (present.count(names[n]) == 0)
+                        {
+                            throw ArgumentMissingError(names[n]);
+                        }
 
-                    for (auto &argument : option.positional)
-                    {
-                        auto qualified_name = name + " " + argument.name;
-                        if (argument.required && present.count(qualified_name) == 0)
+                        for (std::size_t j = 0; j < option.positional.size(); j++)
                         {
-                            throw ArgumentMissingError(qualified_name);
+                            const auto &qualified_name = option.qualified_names[n][j];
+                            if (option.positional[j].required && present.count(qualified_name) == 0)
+                            {
+                                throw ArgumentMissingError(qualified_name);
+                            }
                         }
                     }
                 }
             }
         }
 
-        return Context(message, tokens, values, present, client, constraint);
+        return Context(message, tokens, std::move(values), std::move(present), client, constraint);
     }
 }
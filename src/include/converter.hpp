@@ -2,29 +2,171 @@
 
 #include "standard.hpp"
 
+#if defined(__SSE2__) || defined(_M_X64)
+#include <immintrin.h>
+#endif
+
 namespace utils
 {
     /**
-     * @brief Convert `std::string` to `std::wstring`
-     * @see https://stackoverflow.com/a/18374698
-     * @param str An `std::string` to convert
+     * @brief Widen the leading ASCII characters of a UTF-8 string
+     *
+     * On x86, the bytes are checked and widened 16 (with SSE2) or 32 (with AVX2) at a time.
+     *
+     * @param data The UTF-8 string
+     * @param size The number of bytes of `data`
+     * @param output The buffer to write the UTF-16 code units to, with room for `size` code units
+     * @return The number of leading ASCII characters, which were written to `output`
+     */
+    std::size_t _widen_ascii(const char *data, const std::size_t size, wchar_t *output)
+    {
+        std::size_t i = 0;
+        if constexpr (sizeof(wchar_t) == 2)
+        {
+#if defined(__AVX2__)
+            for (; i + 32 <= size; i += 32)
+            {
+                auto chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + i));
+                if (_mm256_movemask_epi8(chunk) != 0)
+                {
+                    break;
+                }
+
+                _mm256_storeu_si256(reinterpret_cast<__m256i *>(output + i), _mm256_cvtepu8_epi16(_mm256_castsi256_si128(chunk)));
+                _mm256_storeu_si256(reinterpret_cast<__m256i *>(output + i + 16), _mm256_cvtepu8_epi16(_mm256_extracti128_si256(chunk, 1)));
+            }
+#endif
+#if defined(__SSE2__) || defined(_M_X64)
+            const auto zero = _mm_setzero_si128();
+            for (; i + 16 <= size; i += 16)
+            {
+                auto chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i));
+                if (_mm_movemask_epi8(chunk) != 0)
+                {
+                    break;
+                }
+
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(output + i), _mm_unpacklo_epi8(chunk, zero));
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(output + i + 8), _mm_unpackhi_epi8(chunk, zero));
+            }
+#endif
+        }
+
+        for (; i < size && static_cast<unsigned char>(data[i]) < 0x80; i++)
+        {
+            output[i] = data[i];
+        }
+
+        return i;
+    }
+
+    /**
+     * @brief Narrow the leading ASCII characters of a UTF-16 string
+     *
+     * On x86, the code units are checked and narrowed 16 at a time with SSE2.
+     *
+     * @param data The UTF-16 string
+     * @param size The number of code units of `data`
+     * @param output The buffer to write the UTF-8 bytes to, with room for `size` bytes
+     * @return The number of leading ASCII characters, which were written to `output`
+     */
+    std::size_t _narrow_ascii(const wchar_t *data, const std::size_t size, char *output)
+    {
+        std::size_t i = 0;
+        if constexpr (sizeof(wchar_t) == 2)
+        {
+#if defined(__SSE2__) || defined(_M_X64)
+            const auto high = _mm_set1_epi16(static_cast<short>(0xFF80));
+            const auto zero = _mm_setzero_si128();
+            for (; i + 16 <= size; i += 16)
+            {
+                auto first = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i)),
+                     second = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i + 8));
+                auto non_ascii = _mm_or_si128(_mm_and_si128(first, high), _mm_and_si128(second, high));
+                if (_mm_movemask_epi8(_mm_cmpeq_epi16(non_ascii, zero)) != 0xFFFF)
+                {
+                    break;
+                }
+
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(output + i), _mm_packus_epi16(first, second));
+            }
+#endif
+        }
+
+        for (; i < size && static_cast<std::make_unsigned_t<wchar_t>>(data[i]) < 0x80; i++)
+        {
+            output[i] = static_cast<char>(data[i]);
+        }
+
+        return i;
+    }
+
+    /**
+     * @brief Convert an UTF-8 string to UTF-16 into an existing buffer, reusing its capacity
+     *
+     * ASCII text is widened directly, the conversion only falls back to `MultiByteToWideChar` from the first non-ASCII
+     * character. Hot loops should keep a buffer (e.g. `thread_local`) and pass it here to avoid any allocation.
+     *
+     * @param str The UTF-8 string to convert, invalid sequences are replaced by U+FFFD
+     * @param result The buffer to store the converted string in
+     */
+    void utf_convert(const std::string_view &str, std::wstring &result)
+    {
+        // An UTF-8 string never has fewer bytes than its UTF-16 form has code units
+        result.resize(str.size());
+        auto ascii = _widen_ascii(str.data(), str.size(), result.data());
+        if (ascii < str.size())
+        {
+            auto length = MultiByteToWideChar(CP_UTF8, 0, str.data() + ascii, str.size() - ascii, result.data() + ascii, result.size() - ascii);
+            result.resize(ascii + length);
+        }
+    }
+
+    /**
+     * @brief Convert an UTF-16 string to UTF-8 into an existing buffer, reusing its capacity
+     *
+     * ASCII text is narrowed directly, the conversion only falls back to `WideCharToMultiByte` from the first non-ASCII
+     * character. Hot loops should keep a buffer (e.g. `thread_local`) and pass it here to avoid any allocation.
+     *
+     * @param wstr The UTF-16 string to convert
+     * @param result The buffer to store the converted string in
+     */
+    void utf_convert(const std::wstring_view &wstr, std::string &result)
+    {
+        result.resize(wstr.size());
+        auto ascii = _narrow_ascii(wstr.data(), wstr.size(), result.data());
+        if (ascii < wstr.size())
+        {
+            // Each UTF-16 code unit is encoded in at most 3 bytes, each UTF-32 code unit (POSIX) in at most 4
+            result.resize(ascii + (sizeof(wchar_t) == 2 ? 3 : 4) * (wstr.size() - ascii));
+            auto length = WideCharToMultiByte(CP_UTF8, 0, wstr.data() + ascii, wstr.size() - ascii, result.data() + ascii, result.size() - ascii, NULL, NULL);
+            result.resize(ascii + length);
+        }
+    }
+
+    /**
+     * @brief Convert an UTF-8 string to UTF-16
+     *
+     * @param str The UTF-8 string to convert
      * @return The converted `std::wstring`
      */
-    std::wstring utf_convert(const std::string &str)
+    std::wstring utf_convert(const std::string_view &str)
     {
-        std::wstring_convert<std::codecvt_utf8<wchar_t>, wchar_t> converter;
-        return converter.from_bytes(str);
+        std::wstring result;
+        utf_convert(str, result);
+        return result;
     }
 
     /**
-     * @brief Convert `std::wstring` to `std::wstring`
-     * @see https://stackoverflow.com/a/18374698
-     * @param wstr An `std::wstring` to convert
+     * @brief Convert an UTF-16 string to UTF-8
+     *
+     * @param wstr The UTF-16 string to convert
      * @return The converted `std::string`
      */
-    std::string utf_convert(const std::wstring &wstr)
+    std::string utf_convert(const std::wstring_view &wstr)
     {
-        std::wstring_convert<std::codecvt_utf8<wchar_t>, wchar_t> converter;
-        return converter.to_bytes(wstr);
+        std::string result;
+        utf_convert(wstr, result);
+        return result;
     }
 }
@@ -0,0 +1,361 @@
+#pragma once
+
+#include "find_files.hpp"
+#include "thread_pool.hpp"
+#include "utils.hpp"
+#include "work_stealing.hpp"
+
+namespace utils
+{
+    /**
+     * @brief Copy files and directory trees with a `WorkStealingPool`.
+     *
+     * The copies are queued by `add` and run by `wait`. A directory job creates the destination directory and queues
+     * a job for each of its entries on the deque of its worker, a file job copies one file. Trees full of small files
+     * therefore keep all the workers busy, since per-file overheads (opening, creating, closing) dominate their copy.
+     * Files of at least `UNBUFFERED_SIZE` bytes are copied by
+     * [`CopyFileExW`](https://learn.microsoft.com/en-us/windows/win32/api/winbase/nf-winbase-copyfileexw)
+     * with `COPY_FILE_NO_BUFFERING`, which streams them without polluting the file cache.
+     *
+     * When cloning is enabled, files are first copied with `FSCTL_DUPLICATE_EXTENTS_TO_FILE`, which makes the
+     * destination share the clusters of the source on volumes supporting block cloning (ReFS). Cloning is disabled
+     * for the remaining files as soon as it is rejected, e.g. because the source is on another volume.
+     *
+     * Symbolic links to files are copied as links, junctions and symbolic links to directories are skipped.
+     * Workers never write to the standard streams, errors are collected and returned by `errors`.
+     */
+    class ParallelCopier
+    {
+    public:
+        /** @brief The progress of a `ParallelCopier` */
+        struct Statistics
+        {
+            /** @brief The number of files copied */
+            std::size_t files;
+
+            /** @brief The number of directories created */
+            std::size_t directories;
+
+            /** @brief The number of bytes copied so far, including the files being copied */
+            unsigned long long bytes;
+        };
+
+        /** @brief The size from which files bypass the file cache */
+        static constexpr unsigned long long UNBUFFERED_SIZE = 1ull << 26;
+
+    private:
+        /** @brief The length of each cloned region, a multiple of any cluster size below 4GB per request */
+        static constexpr unsigned long long CLONE_SIZE = 1ull << 30;
+
+        struct _Job
+        {
+            std::wstring source, destination;
+            DWORD attributes;
+            unsigned long long size;
+        };
+
+        /** @brief The state of a `CopyFileExW` call, passed to its progress routine */
+        struct _Transfer
+        {
+            ParallelCopier *const copier;
+            unsigned long long reported;
+        };
+
+        const bool _overwrite;
+
+        /** @brief The cluster size of the destination volume, the alignment of cloned regions */
+        const DWORD _cluster;
+
+        std::mutex _mutex;
+
+        /** @brief The errors reported so far, guarded by `_mutex` */
+        std::vector<std::string> _errors;
+
+        WorkStealingPool<_Job> _pool;
+
+        /** @brief The worker whose deque receives the next job queued by `add` */
+        std::size_t _next = 0;
+
+        /** @brief The run of `_pool` on a thread of `ThreadPool::shared`, started by the first `wait` */
+        std::future<void> _running;
+
+        std::atomic<std::size_t> _files{0}, _directories{0};
+        std::atomic<unsigned long long> _bytes{0};
+
+        /** @brief Whether cloning is still tried, it is disabled once the file system rejects it */
+        std::atomic<bool> _clone;
+
+        ParallelCopier(const ParallelCopier &) = delete;
+        ParallelCopier &operator=(const ParallelCopier &) = delete;
+
+        static DWORD CALLBACK _progress(
+            LARGE_INTEGER, LARGE_INTEGER transferred, LARGE_INTEGER, LARGE_INTEGER,
+            DWORD, DWORD, HANDLE, HANDLE, LPVOID data)
+        {
+            // Only counts are updated here, the progress is displayed at the interval chosen by `wait`
+            auto transfer = static_cast<_Transfer *>(data);
+            auto bytes = static_cast<unsigned long long>(transferred.QuadPart);
+            transfer->copier->_bytes += bytes - transfer->reported;
+            transfer->reported = bytes;
+            return PROGRESS_CONTINUE;
+        }
+
+        void _error(const std::string &message)
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _errors.push_back(message);
+        }
+
+        void _push(const std::size_t worker, const std::wstring &source, const std::wstring &destination, const DWORD attributes, const unsigned long long size)
+        {
+            if ((attributes & FILE_ATTRIBUTE_DIRECTORY) && (attributes & FILE_ATTRIBUTE_REPARSE_POINT))
+            {
+                _error(format("Skipping the link to a directory \"%s\"", utf_convert(source).c_str()));
+                return;
+            }
+
+            _pool.push(worker, _Job{source, destination, attributes, size});
+        }
+
+        /** @brief Share the clusters of a file with a new destination file, which is deleted on failure */
+        bool _try_clone(const _Job &job)
+        {
+            auto source = CreateFileW(job.source.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, NULL, OPEN_EXISTING, 0, NULL);
+            if (source == INVALID_HANDLE_VALUE)
+            {
+                return false;
+            }
+
+            auto destination = CreateFileW(
+                job.destination.c_str(),
+                GENERIC_READ | GENERIC_WRITE | DELETE,
+                0,
+                NULL,
+                _overwrite ? CREATE_ALWAYS : CREATE_NEW,
+                0,
+                NULL);
+
+            if (destination == INVALID_HANDLE_VALUE)
+            {
+                CloseHandle(source);
+                return false;
+            }
+
+            DWORD returned;
+            FILE_BASIC_INFO basic;
+            auto success = GetFileInformationByHandleEx(source, FileBasicInfo, &basic, sizeof(basic));
+
+            // Both files must have the same sparseness and the destination must be large enough for the regions
+            if (success && (basic.FileAttributes & FILE_ATTRIBUTE_SPARSE_FILE))
+            {
+                success = DeviceIoControl(destination, FSCTL_SET_SPARSE, NULL, 0, NULL, 0, &returned, NULL);
+            }
+
+            FILE_END_OF_FILE_INFO end_of_file;
+            end_of_file.EndOfFile.QuadPart = job.size;
+            success = success && SetFileInformationByHandle(destination, FileEndOfFileInfo, &end_of_file, sizeof(end_of_file));
+
+            // The regions must be aligned to clusters, the last one may extend past the end of the file
+            auto end = (job.size + _cluster - 1) / _cluster * _cluster;
+            for (unsigned long long offset = 0; success && offset < end; offset += CLONE_SIZE)
+            {
+                DUPLICATE_EXTENTS_DATA extents;
+                extents.FileHandle = source;
+                extents.SourceFileOffset.QuadPart = offset;
+                extents.TargetFileOffset.QuadPart = offset;
+                extents.ByteCount.QuadPart = std::min(CLONE_SIZE, end - offset);
+                success = DeviceIoControl(destination, FSCTL_DUPLICATE_EXTENTS_TO_FILE, &extents, sizeof(extents), NULL, 0, &returned, NULL);
+            }
+
+            // The attributes and the last write time of the source, like CopyFileExW (0 keeps the other times)
+            basic.CreationTime.QuadPart = basic.LastAccessTime.QuadPart = basic.ChangeTime.QuadPart = 0;
+            success = success && SetFileInformationByHandle(destination, FileBasicInfo, &basic, sizeof(basic));
+
+            auto error = GetLastError();
+            if (!success)
+            {
+                FILE_DISPOSITION_INFO disposition;
+                disposition.DeleteFile = TRUE;
+                SetFileInformationByHandle(destination, FileDispositionInfo, &disposition, sizeof(disposition));
+            }
+
+            CloseHandle(destination);
+            CloseHandle(source);
+
+            if (!success && (error == ERROR_NOT_SUPPORTED || error == ERROR_INVALID_FUNCTION || error == ERROR_NOT_SAME_DEVICE || error == ERROR_INVALID_PARAMETER))
+            {
+                _clone = false;
+            }
+
+            return success;
+        }
+
+        void _copy_file(const _Job &job)
+        {
+            bool link = job.attributes & FILE_ATTRIBUTE_REPARSE_POINT;
+            if (!link && _clone.load(std::memory_order_relaxed) && _try_clone(job))
+            {
+                _bytes += job.size;
+                _files++;
+                return;
+            }
+
+            DWORD flags = _overwrite ? 0 : COPY_FILE_FAIL_IF_EXISTS;
+            if (link)
+            {
+                flags |= COPY_FILE_COPY_SYMLINK;
+            }
+            else if (job.size >= UNBUFFERED_SIZE)
+            {
+                flags |= COPY_FILE_NO_BUFFERING;
+            }
+
+            _Transfer transfer{this, 0};
+            if (CopyFileExW(job.source.c_str(), job.destination.c_str(), _progress, &transfer, NULL, flags))
+            {
+                _files++;
+            }
+            else
+            {
+                _error(last_error(format("Error copying \"%s\"", utf_convert(job.source).c_str())));
+            }
+        }
+
+        void _copy_directory(const std::size_t worker, const _Job &job)
+        {
+            if (!CreateDirectoryW(job.destination.c_str(), NULL))
+            {
+                auto attributes = GetFileAttributesW(job.destination.c_str());
+                if (attributes == INVALID_FILE_ATTRIBUTES || !(attributes & FILE_ATTRIBUTE_DIRECTORY))
+                {
+                    _error(last_error(format("Error creating directory \"%s\"", utf_convert(job.destination).c_str())));
+                    return;
+                }
+            }
+            else
+            {
+                _directories++;
+            }
+
+            enumerate_directory(
+                job.source,
+                [this, worker, &job](const WIN32_FIND_DATAW &data)
+                {
+                    _push(
+                        worker,
+                        job.source + L"\\" + data.cFileName,
+                        job.destination + L"\\" + data.cFileName,
+                        data.dwFileAttributes,
+                        (static_cast<unsigned long long>(data.nFileSizeHigh) << 32) | data.nFileSizeLow);
+                });
+        }
+
+        /** @brief Start the run of the pool, which returns once every job (including the ones it queues) is completed */
+        void _start()
+        {
+            if (!_running.valid())
+            {
+                _running = ThreadPool::shared().submit(
+                    [this]()
+                    {
+                        _pool.run();
+                    });
+            }
+        }
+
+        void _run(const std::size_t worker, const _Job &job)
+        {
+            if (job.attributes & FILE_ATTRIBUTE_DIRECTORY)
+            {
+                _copy_directory(worker, job);
+            }
+            else
+            {
+                _copy_file(job);
+            }
+        }
+
+    public:
+        /**
+         * @brief Construct a new `ParallelCopier` object
+         *
+         * @param overwrite Whether existing destination files are replaced, otherwise copying them fails
+         * @param cluster The cluster size of the destination volume to clone files, or 0 to always copy them
+         * @param workers The number of worker threads
+         */
+        ParallelCopier(
+            const bool overwrite,
+            const DWORD cluster,
+            const std::size_t workers = std::max(1u, std::thread::hardware_concurrency()))
+            : _overwrite(overwrite),
+              _cluster(cluster),
+              _pool(
+                  workers,
+                  [this](std::size_t worker, _Job &job)
+                  {
+                      _run(worker, job);
+                  }),
+              _clone(cluster > 0) {}
+
+        /** @brief Destructor for this object, which runs the queued copies if `wait` was not called */
+        ~ParallelCopier()
+        {
+            _start();
+            _running.wait();
+        }
+
+        /**
+         * @brief Queue the copy of a file or a directory tree, which must be called before `wait`
+         *
+         * @param source The path to copy
+         * @param destination The path of the copy, which must not be inside `source`
+         * @param attributes The attributes of `source`, as returned by `GetFileAttributesW`
+         * @param size The size of `source` in bytes, if it is a file
+         */
+        void add(const std::wstring &source, const std::wstring &destination, const DWORD attributes, const unsigned long long size)
+        {
+            // The sources are spread over the workers, which steal from each other once their own deque is empty
+            _push(_next++ % _pool.size(), source, destination, attributes, size);
+        }
+
+        /**
+         * @brief Run the queued copies and wait until they are completed
+         *
+         * @param progress A function invoked with the current progress after each `interval` elapses
+         * @param interval The interval between 2 progress reports
+         * @return The final progress
+         */
+        Statistics wait(const std::function<void(const Statistics &)> &progress, const std::chrono::milliseconds &interval)
+        {
+            _start();
+            while (_running.wait_for(interval) != std::future_status::ready)
+            {
+                progress(statistics());
+            }
+
+            return statistics();
+        }
+
+        /** @brief The current progress */
+        Statistics statistics() const
+        {
+            return {_files.load(), _directories.load(), _bytes.load()};
+        }
+
+        /**
+         * @brief Take the errors reported since the last call
+         *
+         * @return The error messages, in no particular order
+         */
+        std::vector<std::string> errors()
+        {
+            std::vector<std::string> result;
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                result.swap(_errors);
+            }
+
+            return result;
+        }
+    };
+}
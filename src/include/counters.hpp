@@ -0,0 +1,117 @@
+#pragma once
+
+namespace liteshell
+{
+    /**
+     * @brief Always-on counters of the hot paths of the shell, displayed by the `stats` command.
+     *
+     * Each counter is a relaxed atomic on its own cache line, so that the threads of a pipeline updating different
+     * counters never contend for the same line. An update is a single uncontended atomic addition, and timed spans
+     * only read the steady clock twice.
+     */
+    class Counters
+    {
+    public:
+        typedef std::chrono::steady_clock clock;
+
+        /** @brief The counted events */
+        enum Counter
+        {
+            /** @brief The commands dispatched to a built-in command, an executable or a batch script */
+            COMMANDS,
+
+            /** @brief The messages whose environment variables were resolved */
+            LINES_RESOLVED,
+
+            /** @brief The time spent resolving environment variables, in nanoseconds */
+            RESOLVE_TIME,
+
+            /** @brief The time spent parsing the arguments of built-in commands, in nanoseconds */
+            PARSE_TIME,
+
+            /** @brief The calls to `Client::spawn_subprocess` */
+            SUBPROCESSES,
+
+            /** @brief The bytes of the instructions read from the input stream */
+            STREAM_BYTES,
+
+            /** @brief The number of counters */
+            COUNTERS
+        };
+
+        /** @brief Measure the duration of a scope and add it to a counter */
+        class Span
+        {
+        private:
+            Counters *_counters;
+            const Counter _counter;
+            const clock::time_point _start;
+
+            Span(const Span &) = delete;
+            Span &operator=(const Span &) = delete;
+
+        public:
+            Span(Counters &counters, const Counter counter)
+                : _counters(&counters), _counter(counter), _start(clock::now()) {}
+
+            ~Span()
+            {
+                stop();
+            }
+
+            /** @brief End the measurement before the span goes out of scope, later calls do nothing */
+            void stop()
+            {
+                if (_counters != nullptr)
+                {
+                    _counters->add(_counter, std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - _start).count());
+                    _counters = nullptr;
+                }
+            }
+        };
+
+    private:
+        struct alignas(64) _Slot
+        {
+            std::atomic<std::uint64_t> value{0};
+        };
+
+        _Slot _slots[COUNTERS];
+
+    public:
+        /** @brief Add to a counter */
+        void add(const Counter counter, const std::uint64_t value = 1) noexcept
+        {
+            _slots[counter].value.fetch_add(value, std::memory_order_relaxed);
+        }
+
+        /** @brief Get the current value of a counter */
+        std::uint64_t get(const Counter counter) const noexcept
+        {
+            return _slots[counter].value.load(std::memory_order_relaxed);
+        }
+
+        /** @brief Set all counters to 0 */
+        void reset() noexcept
+        {
+            for (auto &slot : _slots)
+            {
+                slot.value.store(0, std::memory_order_relaxed);
+            }
+        }
+
+        /** @brief The name of a counter, which is also its key in the `stats` environment variable */
+        static const char *name(const Counter counter)
+        {
+            static const char *names[COUNTERS] = {"commands", "lines_resolved", "resolve_ns", "parse_ns", "subprocesses", "stream_bytes"};
+            return names[counter];
+        }
+
+        /** @brief The counters of this process */
+        static Counters &global()
+        {
+            static Counters counters;
+            return counters;
+        }
+    };
+}
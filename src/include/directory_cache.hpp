@@ -0,0 +1,279 @@
+#pragma once
+
+#include "find_files.hpp"
+#include "join.hpp"
+#include "maps.hpp"
+
+namespace liteshell
+{
+    /**
+     * @brief A cache of directory listings, filled by a background thread.
+     *
+     * Directories are listed by a worker thread, so that listing a large directory or a slow network share never
+     * blocks the caller for longer than the timeout it asks for. Each cached directory is watched with a change
+     * notification: after a change, the previous listing is still served while the directory is listed again.
+     * Directories which cannot be watched are listed again when their listing is older than `EXPIRY`.
+     *
+     * At most `CAPACITY` directories are cached, the least recently used listing is evicted first.
+     */
+    class DirectoryCache
+    {
+    public:
+        /** @brief An entry of a directory */
+        struct Entry
+        {
+            std::string name;
+            bool directory;
+        };
+
+        /** @brief The entries of a directory, excluding `.` and `..` */
+        typedef std::vector<Entry> Listing;
+
+        /** @brief The maximum number of cached directories */
+        static const std::size_t CAPACITY = 128;
+
+        /** @brief The age after which the listing of a directory which cannot be watched is refreshed */
+        static constexpr std::chrono::seconds EXPIRY = std::chrono::seconds(5);
+
+    private:
+        struct _Directory
+        {
+            std::shared_ptr<const Listing> listing;
+            HANDLE notification = INVALID_HANDLE_VALUE;
+            bool watched = false, pending = false;
+            std::chrono::steady_clock::time_point listed;
+            std::size_t used = 0;
+        };
+
+        /**
+         * @brief The state shared with the worker thread, which is detached on destruction so that exiting the shell
+         * does not wait for a listing in progress
+         */
+        struct _State
+        {
+            std::mutex mutex;
+            std::condition_variable requested, listed;
+            utils::CaseInsensitiveMap<_Directory> directories;
+            std::deque<std::string> queue;
+            std::size_t clock = 0;
+            bool stopped = false;
+
+            ~_State()
+            {
+                for (auto &[_, directory] : directories)
+                {
+                    if (directory.notification != INVALID_HANDLE_VALUE)
+                    {
+                        FindCloseChangeNotification(directory.notification);
+                    }
+                }
+            }
+        };
+
+        const std::shared_ptr<_State> _state;
+        std::thread _worker;
+
+        DirectoryCache(const DirectoryCache &) = delete;
+        DirectoryCache &operator=(const DirectoryCache &) = delete;
+
+        /** @brief List a directory, a directory which cannot be listed is empty */
+        static Listing _list(const std::string &directory)
+        {
+            Listing listing;
+            try
+            {
+                for (auto &data : utils::FindFiles(utils::join(directory, "*")))
+                {
+                    if (std::wcscmp(data.cFileName, L".") == 0 || std::wcscmp(data.cFileName, L"..") == 0)
+                    {
+                        continue;
+                    }
+
+                    listing.push_back({utils::utf_convert(std::wstring_view(data.cFileName)), (data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0});
+                }
+            }
+            catch (std::exception &)
+            {
+                // pass
+            }
+
+            return listing;
+        }
+
+        static void _work(const std::shared_ptr<_State> state)
+        {
+            std::unique_lock<std::mutex> lock(state->mutex);
+            while (true)
+            {
+                state->requested.wait(
+                    lock,
+                    [&state]()
+                    {
+                        return state->stopped || !state->queue.empty();
+                    });
+                if (state->stopped)
+                {
+                    return;
+                }
+
+                auto path = std::move(state->queue.front());
+                state->queue.pop_front();
+
+                // Pending directories are never evicted, the entry outlives the unlocked section below
+                auto &directory = state->directories[path];
+                bool watch = !directory.watched;
+                lock.unlock();
+
+                // The directory is watched before it is listed, so that no change is missed in between
+                HANDLE notification = INVALID_HANDLE_VALUE;
+                if (watch)
+                {
+                    notification = FindFirstChangeNotificationW(
+                        utils::utf_convert(path).c_str(),
+                        FALSE,
+                        FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_DIR_NAME);
+                }
+
+                auto listing = std::make_shared<const Listing>(_list(path));
+
+                lock.lock();
+                if (watch)
+                {
+                    directory.notification = notification;
+                    directory.watched = true;
+                }
+
+                directory.listing = std::move(listing);
+                directory.listed = std::chrono::steady_clock::now();
+                directory.pending = false;
+                state->listed.notify_all();
+            }
+        }
+
+        /** @brief Request a directory to be listed, the mutex must be held */
+        void _schedule(const std::string &path, _Directory &directory)
+        {
+            if (!directory.pending)
+            {
+                directory.pending = true;
+                _state->queue.push_back(path);
+                _state->requested.notify_one();
+            }
+        }
+
+        /** @brief Whether the cached listing of a directory is out of date, the mutex must be held */
+        static bool _stale(_Directory &directory)
+        {
+            if (directory.notification == INVALID_HANDLE_VALUE)
+            {
+                return std::chrono::steady_clock::now() - directory.listed > EXPIRY;
+            }
+
+            if (WaitForSingleObject(directory.notification, 0) != WAIT_OBJECT_0)
+            {
+                return false;
+            }
+
+            if (!FindNextChangeNotification(directory.notification))
+            {
+                // The directory is gone, it is watched again when it is listed again
+                FindCloseChangeNotification(directory.notification);
+                directory.notification = INVALID_HANDLE_VALUE;
+                directory.watched = false;
+            }
+
+            return true;
+        }
+
+        /** @brief Evict the least recently used listings beyond `CAPACITY`, the mutex must be held */
+        void _evict()
+        {
+            auto &directories = _state->directories;
+            while (directories.size() > CAPACITY)
+            {
+                auto victim = directories.end();
+                for (auto iter = directories.begin(); iter != directories.end(); iter++)
+                {
+                    if (!iter->second.pending && (victim == directories.end() || iter->second.used < victim->second.used))
+                    {
+                        victim = iter;
+                    }
+                }
+
+                if (victim == directories.end())
+                {
+                    return;
+                }
+
+                if (victim->second.notification != INVALID_HANDLE_VALUE)
+                {
+                    FindCloseChangeNotification(victim->second.notification);
+                }
+
+                directories.erase(victim);
+            }
+        }
+
+    public:
+        /** @brief Construct an empty `DirectoryCache`, the worker thread is started on the first listing */
+        DirectoryCache() : _state(std::make_shared<_State>()) {}
+
+        /** @brief Destructor for this object, which stops the worker thread */
+        ~DirectoryCache()
+        {
+            {
+                std::lock_guard<std::mutex> lock(_state->mutex);
+                _state->stopped = true;
+            }
+
+            _state->requested.notify_all();
+            if (_worker.joinable())
+            {
+                _worker.detach();
+            }
+        }
+
+        /**
+         * @brief Get the listing of a directory
+         *
+         * @param path The absolute path to the directory
+         * @param timeout The maximum time to wait for a directory which has never been listed, or which has
+         * changed since it was last listed
+         * @return The entries of the directory, or `nullptr` if it could not be listed within `timeout`. A listing
+         * may be returned even if it is out of date, if the new one is not ready in time.
+         */
+        std::shared_ptr<const Listing> list(const std::string &path, const std::chrono::milliseconds &timeout = std::chrono::milliseconds(100))
+        {
+            std::unique_lock<std::mutex> lock(_state->mutex);
+            if (!_worker.joinable())
+            {
+                _worker = std::thread(_work, _state);
+            }
+
+            auto &directory = _state->directories[path];
+            directory.used = ++_state->clock;
+            if (directory.listing == nullptr || _stale(directory))
+            {
+                _schedule(path, directory);
+                _state->listed.wait_for(
+                    lock,
+                    timeout,
+                    [&directory]()
+                    {
+                        return !directory.pending;
+                    });
+            }
+
+            auto listing = directory.listing;
+            _evict();
+            return listing;
+        }
+
+        /** @brief The number of cached directories */
+        std::size_t size()
+        {
+            std::lock_guard<std::mutex> lock(_state->mutex);
+            return _state->directories.size();
+        }
+    };
+}
@@ -1,5 +1,8 @@
 #pragma once
 
+#include "arena.hpp"
+#include "counters.hpp"
+#include "expression.hpp"
 #include "strip.hpp"
 
 namespace liteshell
@@ -8,23 +11,635 @@ namespace liteshell
      * @brief Represent the current environment of the shell.
      *
      * This class mostly contains data about active environment _variables.
+     *
+     * Variables are stored in open-addressing hash tables whose slots refer to entries that are never moved or
+     * removed, so each name is stored (interned) exactly once and can be referred to by a `VariableHandle`.
+     *
+     * The tables are organized in layers. `snapshot` freezes the current variables into an immutable layer in O(1),
+     * which may be shared by other environments e.g. the isolated environment of a request. A variable of a frozen
+     * layer is copied into the mutable top layer on its first mutation, lookups fall through the layers from the top.
      */
     class Environment
     {
+    public:
+        /**
+         * @brief A handle to an environment variable.
+         *
+         * A handle is obtained once via `Environment::intern` and stays valid for the lifetime of the environment,
+         * reading or writing a variable through its handle does not involve hashing the name.
+         */
+        class VariableHandle
+        {
+        private:
+            std::size_t _index;
+
+            explicit VariableHandle(const std::size_t index) : _index(index) {}
+
+            friend class Environment;
+        };
+
+        /** @brief The type of the value of a variable */
+        enum Type
+        {
+            /** @brief A string, which is the default */
+            SCALAR,
+
+            /** @brief An indexed array of strings, e.g. `${arr[0]}` */
+            ARRAY,
+
+            /** @brief An associative map of strings, e.g. `${map[key]}` */
+            MAP
+        };
+
     private:
-        const boost::regex _var_resolver = boost::regex(R"((?<!\$)\$(?:\{(\w+)\}|(\w+)))");
-        const boost::regex _escape_resolver = boost::regex(R"(\$\$)");
-        std::map<std::string, std::string> _variables;
+        struct _Variable
+        {
+            /** @brief The interned name of the variable */
+            const std::string name;
+
+            /** @brief The value of the variable, empty for arrays and maps */
+            std::string value;
+
+            /** @brief Whether a value was assigned to this variable, interning a name does not define it */
+            bool defined;
+
+            Type type = SCALAR;
+
+            /** @brief The elements of an array */
+            std::vector<std::string> elements;
+
+            /** @brief The entries of a map, sorted by key */
+            std::map<std::string, std::string, std::less<>> entries;
+
+            /** @brief Turn this variable into a defined value of another type, dropping its content */
+            void reset(const Type new_type)
+            {
+                if (type != SCALAR || new_type != SCALAR)
+                {
+                    value.clear();
+                    elements.clear();
+                    entries.clear();
+                }
+
+                type = new_type;
+                defined = true;
+            }
+        };
+
+        /** @brief A layer of variables, only the top layer of an environment is mutable */
+        struct _Layer
+        {
+            /** @brief The frozen layer below, or `nullptr` */
+            std::shared_ptr<const _Layer> parent;
+
+            /** @brief The number of layers in the chain ending with this one */
+            std::size_t depth = 1;
+
+            /** @brief The number of variables interned in the layers below, i.e. the first handle index of this layer */
+            std::size_t base = 0;
+
+            /** @brief The variables interned in this layer, a `std::deque` keeps the references to its elements valid on insertion */
+            std::deque<_Variable> interned;
+
+            /** @brief The hash table slots, each one holds an index in `interned` plus 1, or 0 if it is empty */
+            std::vector<std::size_t> slots = std::vector<std::size_t>(8);
+
+            /** @brief The copies of the variables of the layers below which were mutated in this layer, by handle index */
+            std::unordered_map<std::size_t, _Variable> shadowed;
+
+            /** @brief The number of variables interned in this layer and the layers below */
+            std::size_t size() const
+            {
+                return base + interned.size();
+            }
+
+            /** @brief Find the slot of a name, or the empty slot where it should be inserted */
+            std::size_t probe(const std::string_view &name) const
+            {
+                auto mask = slots.size() - 1;
+                auto slot = std::hash<std::string_view>()(name) & mask;
+                while (slots[slot] != 0 && interned[slots[slot] - 1].name != name)
+                {
+                    slot = (slot + 1) & mask;
+                }
+
+                return slot;
+            }
+
+            /** @brief Intern a variable which is not present in any layer, return its handle index */
+            std::size_t add(const _Variable &variable)
+            {
+                interned.push_back(variable);
+                slots[probe(variable.name)] = interned.size();
+
+                // Keep the load factor at most 1/2
+                if (2 * interned.size() > slots.size())
+                {
+                    slots.assign(2 * slots.size(), 0);
+                    for (std::size_t index = 0; index < interned.size(); index++)
+                    {
+                        slots[probe(interned[index].name)] = index + 1;
+                    }
+                }
+
+                return size() - 1;
+            }
+        };
+
+        /** @brief The maximum number of layers, `snapshot` merges deeper chains to keep lookups fast */
+        static const std::size_t MAX_DEPTH = 8;
+
+        std::shared_ptr<_Layer> _top = std::make_shared<_Layer>();
+
+        /** @brief The compiled expressions, mapped from their shapes */
+        mutable std::unordered_map<std::string, Expression> _expressions;
+
+        /** @brief Buffers reused by `eval_ll` */
+        mutable std::string _shape_buffer;
+        mutable std::vector<long long> _literals_buffer, _stack_buffer;
 
         Environment(const Environment &) = delete;
         Environment &operator=(const Environment &) = delete;
 
+        static bool _is_name_character(const char c)
+        {
+            return std::isalnum(static_cast<unsigned char>(c)) || c == '_';
+        }
+
+        /** @brief Find the handle index of a name, in the layer which interned it */
+        std::optional<std::size_t> _lookup(const std::string_view &name) const
+        {
+            for (const _Layer *layer = _top.get(); layer != nullptr; layer = layer->parent.get())
+            {
+                auto index = layer->slots[layer->probe(name)];
+                if (index != 0)
+                {
+                    return layer->base + index - 1;
+                }
+            }
+
+            return std::nullopt;
+        }
+
+        /** @brief The current state of a variable, held by the topmost layer which interned or mutated it */
+        const _Variable &_get(const std::size_t index) const
+        {
+            const _Layer *layer = _top.get();
+            while (index < layer->base)
+            {
+                auto iter = layer->shadowed.find(index);
+                if (iter != layer->shadowed.end())
+                {
+                    return iter->second;
+                }
+
+                layer = layer->parent.get();
+            }
+
+            return layer->interned[index - layer->base];
+        }
+
+        /** @brief The state of a variable in the top layer, copied from a frozen layer on the first mutation */
+        _Variable &_mutable(const std::size_t index)
+        {
+            if (index >= _top->base)
+            {
+                return _top->interned[index - _top->base];
+            }
+
+            auto iter = _top->shadowed.find(index);
+            if (iter == _top->shadowed.end())
+            {
+                iter = _top->shadowed.emplace(index, _get(index)).first;
+            }
+
+            return iter->second;
+        }
+
+        const _Variable *_find(const std::string_view &name) const
+        {
+            auto index = _lookup(name);
+            return index.has_value() ? &_get(*index) : nullptr;
+        }
+
+        /** @brief Start a new empty top layer above a frozen one */
+        void _stack(const std::shared_ptr<const _Layer> &parent)
+        {
+            _top = std::make_shared<_Layer>();
+            _top->parent = parent;
+            _top->depth = parent->depth + 1;
+            _top->base = parent->size();
+        }
+
+        static bool _is_name(const std::string_view &name)
+        {
+            return !name.empty() && std::all_of(name.begin(), name.end(), _is_name_character);
+        }
+
+        /**
+         * @brief Parse an index of a sequence, negative indices count from the end
+         *
+         * @return The index in range [0, `size`), or `std::nullopt` if it is invalid or out of range
+         */
+        static std::optional<std::size_t> _parse_index(const std::string_view &text, const std::size_t size)
+        {
+            long long index = 0;
+            auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), index);
+            if (text.empty() || error != std::errc() || end != text.data() + text.size())
+            {
+                return std::nullopt;
+            }
+
+            if (index < 0)
+            {
+                index += static_cast<long long>(size);
+            }
+
+            if (index < 0 || index >= static_cast<long long>(size))
+            {
+                return std::nullopt;
+            }
+
+            return static_cast<std::size_t>(index);
+        }
+
+        /** @brief Clamp a bound of a slice, an empty bound defaults to `fallback` */
+        static std::optional<std::size_t> _parse_bound(const std::string_view &text, const std::size_t size, const std::size_t fallback)
+        {
+            if (text.empty())
+            {
+                return fallback;
+            }
+
+            long long bound = 0;
+            auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), bound);
+            if (error != std::errc() || end != text.data() + text.size())
+            {
+                return std::nullopt;
+            }
+
+            if (bound < 0)
+            {
+                bound += static_cast<long long>(size);
+            }
+
+            return static_cast<std::size_t>(std::clamp<long long>(bound, 0, static_cast<long long>(size)));
+        }
+
+        /**
+         * @brief Expand the content of a `${...}` sequence which is not a plain name
+         *
+         * - `${#name}`: the length of an array, a map or a string
+         * - `${name[index]}`: an element of an array (negative indices count from the end)
+         * - `${name[begin:end]}`: the elements of a slice of an array, separated by spaces
+         * - `${name[key]}`: an entry of a map
+         * - `${name[@]}`: all elements of an array or values of a map, separated by spaces
+         * - `${!name[@]}`: all indices of an array or keys of a map, separated by spaces
+         *
+         * @return The expanded value, or `std::nullopt` if the content is not one of the forms above
+         */
+        std::optional<std::string> _expand(const std::string_view &content) const
+        {
+            if (content.size() > 1 && content[0] == '#' && _is_name(content.substr(1)))
+            {
+                return std::to_string(length(content.substr(1)));
+            }
+
+            auto keys = !content.empty() && content[0] == '!';
+            auto name_begin = keys ? 1 : 0;
+            auto bracket = content.find('[');
+            if (bracket == std::string_view::npos ||
+                content.back() != ']' ||
+                !_is_name(content.substr(name_begin, bracket - name_begin)))
+            {
+                return std::nullopt;
+            }
+
+            auto subscript = content.substr(bracket + 1, content.size() - bracket - 2);
+            if (keys && subscript != "@")
+            {
+                return std::nullopt;
+            }
+
+            std::string result;
+            auto variable = _find(content.substr(name_begin, bracket - name_begin));
+            if (variable == nullptr || !variable->defined)
+            {
+                return result;
+            }
+
+            auto add = [&result](const std::string_view &value)
+            {
+                if (!result.empty())
+                {
+                    result += ' ';
+                }
+
+                result += value;
+            };
+
+            if (variable->type == MAP)
+            {
+                if (subscript == "@")
+                {
+                    for (auto &[key, value] : variable->entries)
+                    {
+                        add(keys ? key : value);
+                    }
+                }
+                else
+                {
+                    auto iter = variable->entries.find(subscript);
+                    if (iter != variable->entries.end())
+                    {
+                        result = iter->second;
+                    }
+                }
+            }
+            else if (variable->type == ARRAY)
+            {
+                const auto &elements = variable->elements;
+                auto colon = subscript.find(':');
+                if (subscript == "@")
+                {
+                    for (std::size_t i = 0; i < elements.size(); i++)
+                    {
+                        add(keys ? std::to_string(i) : elements[i]);
+                    }
+                }
+                else if (colon != std::string_view::npos)
+                {
+                    auto begin = _parse_bound(subscript.substr(0, colon), elements.size(), 0),
+                         end = _parse_bound(subscript.substr(colon + 1), elements.size(), elements.size());
+                    if (begin.has_value() && end.has_value())
+                    {
+                        for (auto i = *begin; i < *end; i++)
+                        {
+                            add(elements[i]);
+                        }
+                    }
+                }
+                else
+                {
+                    auto index = _parse_index(subscript, elements.size());
+                    if (index.has_value())
+                    {
+                        result = elements[*index];
+                    }
+                }
+            }
+
+            return result;
+        }
+
     public:
+        /** @brief An immutable snapshot of the variables of an environment, see `snapshot` */
+        typedef std::shared_ptr<const _Layer> Snapshot;
+
+        /**
+         * @brief A read-only view of the defined environment variables, in order of first assignment.
+         *
+         * The view does not copy the variables, it merges the layers of the environment and is invalidated when a
+         * new variable is interned or `snapshot` is called.
+         */
+        class Variables
+        {
+        private:
+            const Environment *_environment;
+
+        public:
+            class iterator
+            {
+            private:
+                const Environment *_environment;
+                std::size_t _current, _end;
+
+                void _skip_undefined()
+                {
+                    while (_current != _end && !_environment->_get(_current).defined)
+                    {
+                        _current++;
+                    }
+                }
+
+            public:
+                iterator(const Environment *environment, const std::size_t current, const std::size_t end)
+                    : _environment(environment), _current(current), _end(end)
+                {
+                    _skip_undefined();
+                }
+
+                std::pair<std::string_view, std::string_view> operator*() const
+                {
+                    auto &variable = _environment->_get(_current);
+                    return std::make_pair(std::string_view(variable.name), std::string_view(variable.value));
+                }
+
+                iterator &operator++()
+                {
+                    _current++;
+                    _skip_undefined();
+                    return *this;
+                }
+
+                bool operator!=(const iterator &other) const
+                {
+                    return _current != other._current;
+                }
+            };
+
+            explicit Variables(const Environment *environment) : _environment(environment) {}
+
+            iterator begin() const
+            {
+                return iterator(_environment, 0, _environment->_top->size());
+            }
+
+            iterator end() const
+            {
+                auto size = _environment->_top->size();
+                return iterator(_environment, size, size);
+            }
+        };
+
+        /**
+         * @brief A set of temporary assignments, e.g. the arguments of a subroutine.
+         *
+         * The first time a variable is assigned or unset through a scope, its previous state is saved. Exiting the
+         * scope restores all saved states, in reverse order.
+         */
+        class Scope
+        {
+        private:
+            /** @brief The previous state of a variable, whose content is moved here until the scope is exited */
+            struct _Saved
+            {
+                std::size_t index;
+                std::string value;
+                bool defined;
+                Type type;
+                std::vector<std::string> elements;
+                std::map<std::string, std::string, std::less<>> entries;
+            };
+
+            Environment *const _environment;
+            std::vector<_Saved> _saved;
+
+            Scope(const Scope &) = delete;
+            Scope &operator=(const Scope &) = delete;
+
+            _Variable &_save(const VariableHandle &handle)
+            {
+                auto &variable = _environment->_mutable(handle._index);
+                auto saved = std::find_if(
+                    _saved.begin(), _saved.end(),
+                    [&handle](const _Saved &saved)
+                    {
+                        return saved.index == handle._index;
+                    });
+                if (saved == _saved.end())
+                {
+                    // Arrays and maps are moved rather than copied, the variable is overwritten anyway
+                    _saved.push_back(
+                        {handle._index,
+                         std::move(variable.value),
+                         variable.defined,
+                         variable.type,
+                         std::move(variable.elements),
+                         std::move(variable.entries)});
+                }
+
+                variable.value.clear();
+                variable.elements.clear();
+                variable.entries.clear();
+                variable.type = SCALAR;
+                return variable;
+            }
+
+        public:
+            /** @brief Construct a new `Scope` of an environment, which must outlive it */
+            explicit Scope(Environment *environment) : _environment(environment) {}
+
+            /** @brief Destructor for this object, which exits the scope */
+            ~Scope()
+            {
+                exit();
+            }
+
+            /** @brief Assign a scalar value to a variable until the scope is exited, whatever its type was */
+            void set_value(const VariableHandle &handle, const std::string &value)
+            {
+                auto &variable = _save(handle);
+                variable.value = value;
+                variable.defined = true;
+            }
+
+            /** @brief Undefine a variable until the scope is exited */
+            void unset(const VariableHandle &handle)
+            {
+                auto &variable = _save(handle);
+                variable.defined = false;
+            }
+
+            /** @brief Restore the variables assigned through this scope, with their type and content, later calls do nothing */
+            void exit()
+            {
+                for (auto saved = _saved.rbegin(); saved != _saved.rend(); saved++)
+                {
+                    auto &variable = _environment->_mutable(saved->index);
+                    variable.value = std::move(saved->value);
+                    variable.defined = saved->defined;
+                    variable.type = saved->type;
+                    variable.elements = std::move(saved->elements);
+                    variable.entries = std::move(saved->entries);
+                }
+
+                _saved.clear();
+            }
+        };
+
+        /** @brief The maximum number of compiled expressions to cache */
+        static const std::size_t MAX_CACHED_EXPRESSIONS = 1024;
+
         /**
          * @brief Construct a new `Environment` object
          */
         Environment() {}
 
+        /**
+         * @brief Construct a new `Environment` object on top of a snapshot, in O(1)
+         *
+         * The variables of the snapshot are visible in the new environment, and copied only when they are mutated. A
+         * handle to a variable of the snapshot stays valid in the new environment.
+         *
+         * @param snapshot The snapshot to start from
+         */
+        explicit Environment(const Snapshot &snapshot)
+        {
+            _stack(snapshot);
+        }
+
+        /**
+         * @brief Freeze the current variables into an immutable snapshot, in O(1)
+         *
+         * Later mutations of this environment do not affect the snapshot, which may be shared with environments
+         * running on other threads.
+         *
+         * @return The snapshot of the current variables
+         */
+        Snapshot snapshot()
+        {
+            if (_top->parent == nullptr || !_top->interned.empty() || !_top->shadowed.empty())
+            {
+                std::shared_ptr<const _Layer> frozen;
+                if (_top->depth < MAX_DEPTH)
+                {
+                    frozen = std::move(_top);
+                }
+                else
+                {
+                    // Merge the whole chain into one layer, which happens once every `MAX_DEPTH` snapshots at most
+                    auto merged = std::make_shared<_Layer>();
+                    for (std::size_t index = 0; index < _top->size(); index++)
+                    {
+                        merged->add(_get(index));
+                    }
+
+                    frozen = std::move(merged);
+                }
+
+                _stack(frozen);
+            }
+
+            return _top->parent;
+        }
+
+        /**
+         * @brief Discard all variables assigned or interned since a snapshot was taken, in O(1)
+         *
+         * Handles to the variables interned after the snapshot become invalid.
+         *
+         * @param snapshot The snapshot to restore
+         * @return A pointer to the current environment
+         */
+        Environment *restore(const Snapshot &snapshot)
+        {
+            _stack(snapshot);
+            return this;
+        }
+
+        /**
+         * @brief Get a handle to an environment variable, without defining it.
+         *
+         * @param name The name of the variable
+         * @return A handle to the variable, which stays valid for the lifetime of this environment
+         */
+        VariableHandle intern(const std::string_view &name)
+        {
+            auto index = _lookup(name);
+            return VariableHandle(index.has_value() ? *index : _top->add({std::string(name), "", false}));
+        }
+
         /**
          * @brief Set a value for an environment variable
          *
@@ -35,248 +650,343 @@ namespace liteshell
          */
         Environment *set_value(const std::string &name, const std::string &value)
         {
-            _variables[name] = value;
+            return set_value(intern(name), value);
+        }
+
+        /**
+         * @brief Set a value for an environment variable
+         *
+         * @param handle The handle to the variable
+         * @param value The value of the variable
+         *
+         * @return A pointer to the current environment
+         */
+        Environment *set_value(const VariableHandle &handle, const std::string &value)
+        {
+            auto &variable = _mutable(handle._index);
+            if (variable.type != SCALAR)
+            {
+                variable.reset(SCALAR);
+            }
+
+            variable.value = value;
+            variable.defined = true;
             return this;
         }
 
         /**
-         * @brief Get the value of an environment variable
+         * @brief Assign an array to an environment variable, replacing its previous value
+         *
+         * @param handle The handle to the variable
+         * @param elements The elements of the array
+         * @return A pointer to the current environment
+         */
+        Environment *set_array(const VariableHandle &handle, std::vector<std::string> &&elements)
+        {
+            auto &variable = _mutable(handle._index);
+            variable.reset(ARRAY);
+            variable.elements = std::move(elements);
+            return this;
+        }
+
+        /**
+         * @brief Assign an empty map to an environment variable, replacing its previous value
+         *
+         * @param handle The handle to the variable
+         * @return A pointer to the current environment
+         */
+        Environment *set_map(const VariableHandle &handle)
+        {
+            _mutable(handle._index).reset(MAP);
+            return this;
+        }
+
+        /** @brief The type of a variable, or `std::nullopt` if it is not defined */
+        std::optional<Type> get_type(const std::string_view &name) const
+        {
+            auto variable = _find(name);
+            if (variable == nullptr || !variable->defined)
+            {
+                return std::nullopt;
+            }
+
+            return variable->type;
+        }
+
+        /**
+         * @brief The number of elements of an array or entries of a map, or the length of a string
          *
          * @param name The name of the variable
-         * @return The value of the variable, or an empty string if not found
+         * @return The length of the variable, 0 if it is not defined
          */
-        std::string get_value(const std::string &name) const
+        std::size_t length(const std::string_view &name) const
         {
-            auto iter = _variables.find(name);
-            if (iter == _variables.end())
+            auto variable = _find(name);
+            if (variable == nullptr)
             {
-                return "";
+                return 0;
+            }
+
+            switch (variable->type)
+            {
+            case ARRAY:
+                return variable->elements.size();
+            case MAP:
+                return variable->entries.size();
+            default:
+                return variable->value.size();
             }
-            return iter->second;
         }
 
         /**
-         * @brief Get a mapping from environment _variables to their values
+         * @brief Append elements to an array, an undefined variable becomes an empty array first
          *
-         * @return A mapping from environment _variables to their values
+         * @param handle The handle to the variable
+         * @param elements The elements to append
+         * @return A pointer to the current environment
          */
-        std::map<std::string, std::string> get_values() const
+        Environment *append(const VariableHandle &handle, const std::vector<std::string> &elements)
         {
-            return _variables;
+            auto &variable = _mutable(handle._index);
+            if (!variable.defined)
+            {
+                variable.reset(ARRAY);
+            }
+            else if (variable.type != ARRAY)
+            {
+                throw std::invalid_argument(utils::format("\"%s\" is not an array", variable.name.c_str()));
+            }
+
+            variable.elements.insert(variable.elements.end(), elements.begin(), elements.end());
+            return this;
         }
 
         /**
-         * @brief Resolve all environment _variables in a message
+         * @brief Assign an element of an array or an entry of a map
          *
-         * @param message The message to resolve
-         * @return The resolved message
+         * An array index may be negative to count from the end, or equal to the length of the array to append.
+         *
+         * @param handle The handle to the variable
+         * @param subscript The index of the element or the key of the entry
+         * @param value The value to assign
+         * @return A pointer to the current environment
          */
-        std::string resolve(const std::string &message) const
+        Environment *set_element(const VariableHandle &handle, const std::string_view &subscript, const std::string &value)
         {
-            auto result = message;
-            while (true)
+            auto &variable = _mutable(handle._index);
+            if (variable.defined && variable.type == MAP)
             {
-                std::set<std::string> _variables;
-                for (auto begin = result.begin(); begin != result.end(); begin++)
+                auto iter = variable.entries.find(subscript);
+                if (iter == variable.entries.end())
                 {
-                    boost::smatch match;
-                    bool resolved = boost::regex_search(result, match, _var_resolver);
-                    if (resolved)
-                    {
-                        auto group_1 = utils::strip(match.str(1)), group_2 = utils::strip(match.str(2));
-                        _variables.insert(group_1.empty() ? group_2 : group_1);
-                    }
+                    variable.entries.emplace(std::string(subscript), value);
                 }
-
-                if (_variables.empty())
+                else
                 {
-                    break;
+                    iter->second = value;
+                }
+            }
+            else if (variable.defined && variable.type == ARRAY)
+            {
+                auto &elements = variable.elements;
+                auto index = _parse_index(subscript, elements.size());
+                if (index.has_value())
+                {
+                    elements[*index] = value;
+                }
+                else if (subscript == std::to_string(elements.size()))
+                {
+                    elements.push_back(value);
                 }
                 else
                 {
-                    for (auto &variable : _variables)
-                    {
-                        auto pattern = boost::regex(utils::format("(?<!\\$)\\$(?:\\{%s\\}|%s)", variable.c_str(), variable.c_str()));
-                        result = boost::regex_replace(result, pattern, utils::regex_escape(get_value(variable)));
-                    }
+                    throw std::invalid_argument(utils::format("Invalid index \"%s\" of array \"%s\"", std::string(subscript).c_str(), variable.name.c_str()));
                 }
             }
+            else
+            {
+                throw std::invalid_argument(utils::format("\"%s\" is neither an array nor a map", variable.name.c_str()));
+            }
 
-            result = boost::regex_replace(result, _escape_resolver, "$");
-            return result;
+            return this;
         }
 
         /**
-         * @brief Evaluate a mathematical expression
+         * @brief Get an element of an array without copying it
          *
-         * @param expression The expression to evaluate
-         * @return The result of the evaluation
+         * @param handle The handle to the variable
+         * @param index The index of the element
+         * @return A view of the element, or `std::nullopt` if the variable is not an array or the index is out of range
          */
-        long long eval_ll(const std::string &expression) const
+        std::optional<std::string_view> get_element(const VariableHandle &handle, const std::size_t index) const
         {
-            for (auto &c : expression)
+            auto &variable = _get(handle._index);
+            if (!variable.defined || variable.type != ARRAY || index >= variable.elements.size())
             {
-                if (!utils::is_math_symbol(c))
-                {
-                    throw std::runtime_error(utils::format("Unrecognized symbol: %c", c));
-                }
+                return std::nullopt;
             }
 
-            // https://cp-algorithms.com/string/expression_parsing.html
+            return variable.elements[index];
+        }
 
-            std::stack<long long> st;
-            std::stack<char> op;
+        /**
+         * @brief Get the value of an environment variable
+         *
+         * @param name The name of the variable
+         * @return The value of the variable, or an empty string if not found
+         */
+        std::string get_value(const std::string &name) const
+        {
+            return std::string(get_view(name));
+        }
 
-            auto priority = [](char op)
-            {
-                if (op < 0) // unary operator
-                    return 3;
-                if (op == '+' || op == '-')
-                    return 1;
-                if (op == '*' || op == '/' || op == '%')
-                    return 2;
+        /**
+         * @brief Get the value of an environment variable without copying it
+         *
+         * @param name The name of the variable
+         * @return A view of the value of the variable (or an empty view if not found), which is invalidated when the
+         * variable is assigned again
+         */
+        std::string_view get_view(const std::string_view &name) const
+        {
+            auto variable = _find(name);
+            return variable == nullptr ? std::string_view() : std::string_view(variable->value);
+        }
 
-                return -1;
-            };
+        /**
+         * @brief Get the value of an environment variable without copying it
+         *
+         * @param handle The handle to the variable
+         * @return A view of the value of the variable (empty if it is not defined), which is invalidated when the
+         * variable is assigned again
+         */
+        std::string_view get_view(const VariableHandle &handle) const
+        {
+            return _get(handle._index).value;
+        }
 
-            auto process_op = [&st](char op)
-            {
-                if (op < 0)
-                {
-                    if (st.empty())
-                    {
-                        throw std::runtime_error("Invalid expression at unary operator");
-                    }
+        /**
+         * @brief Get a view of the environment _variables and their values
+         *
+         * @return A view of the environment _variables and their values
+         */
+        Variables get_values() const
+        {
+            return Variables(this);
+        }
 
-                    long long l = st.top();
-                    st.pop();
-                    switch (-op)
-                    {
-                    case '+':
-                        st.push(l);
-                        break;
-                    case '-':
-                        st.push(-l);
-                        break;
-                    default:
-                        throw std::runtime_error(utils::format("Invalid expression - unknown unary operator %c", op));
-                    }
-                }
-                else
+        /**
+         * @brief Resolve all environment _variables in a message
+         *
+         * The message is scanned once from left to right. `$name` is replaced as soon as it is read, while `${...}`
+         * is replaced when its closing brace is reached, so names built from other variables e.g. `${arr_${i}}` are
+         * resolved inside-out. `$$` is an escape sequence for a literal `$`. Substituted values are not resolved
+         * again.
+         *
+         * Inside braces, the elements of arrays and maps are accessed with subscripts e.g. `${arr[$i]}`, see
+         * `_expand` for the supported forms.
+         *
+         * @param message The message to resolve
+         * @return The resolved message
+         */
+        std::string resolve(const std::string &message) const
+        {
+            auto &counters = Counters::global();
+            counters.add(Counters::LINES_RESOLVED);
+            Counters::Span span(counters, Counters::RESOLVE_TIME);
+
+            std::string result;
+            result.reserve(message.size());
+
+            // The positions in `result` of the unclosed "${" sequences
+            utils::Arena::Scope arena;
+            std::pmr::vector<std::size_t> braces(utils::Arena::resource());
+            for (std::size_t i = 0; i < message.size(); i++)
+            {
+                auto c = message[i];
+                if (c == '$' && i + 1 < message.size())
                 {
-                    if (st.empty())
+                    auto next = message[i + 1];
+                    if (next == '$')
                     {
-                        throw std::runtime_error("Invalid expression at binary operator");
+                        result += '$';
+                        i++;
+                        continue;
                     }
-                    long long r = st.top();
-                    st.pop();
-
-                    if (st.empty())
+                    else if (next == '{')
                     {
-                        throw std::runtime_error("Invalid expression at binary operator");
+                        braces.push_back(result.size());
+                        result += "${";
+                        i++;
+                        continue;
                     }
-                    long long l = st.top();
-                    st.pop();
-
-                    switch (op)
+                    else if (_is_name_character(next))
                     {
-                    case '+':
-                        st.push(l + r);
-                        break;
-                    case '-':
-                        st.push(l - r);
-                        break;
-                    case '*':
-                        st.push(l * r);
-                        break;
-                    case '/':
-                        if (r == 0)
+                        auto end = i + 1;
+                        while (end < message.size() && _is_name_character(message[end]))
                         {
-                            throw std::runtime_error("Invalid expression - division by zero");
+                            end++;
                         }
 
-                        st.push(l / r);
-                        break;
-                    case '%':
-                        if (r == 0)
-                        {
-                            throw std::runtime_error("Invalid expression - division by zero");
-                        }
+                        result += get_view(std::string_view(message).substr(i + 1, end - i - 1));
 
-                        st.push(l % r);
-                        break;
-                    default:
-                        throw std::runtime_error(utils::format("Invalid expression - unknown binary operator %c", op));
+                        i = end - 1;
+                        continue;
                     }
                 }
-            };
-
-            bool may_be_unary = true;
-            for (std::size_t i = 0; i < expression.size(); i++)
-            {
-                if (expression[i] == ' ')
+                else if (c == '}' && !braces.empty())
                 {
-                    continue;
-                }
+                    auto start = braces.back();
+                    braces.pop_back();
 
-                if (expression[i] == '(')
-                {
-                    op.push('(');
-                    may_be_unary = true;
-                }
-                else if (expression[i] == ')')
-                {
-                    while (op.top() != '(')
+                    auto content = std::string_view(result).substr(start + 2);
+                    if (_is_name(content))
                     {
-                        process_op(op.top());
-                        op.pop();
+                        auto value = get_view(content);
+                        result.replace(start, std::string::npos, value.data(), value.size());
 
-                        if (op.empty())
-                        {
-                            throw std::runtime_error("Invalid expression - missing bracket");
-                        }
+                        continue;
                     }
 
-                    op.pop();
-                    may_be_unary = false;
-                }
-                else if (expression[i] == '+' || expression[i] == '-' || expression[i] == '*' || expression[i] == '/' || expression[i] == '%')
-                {
-                    char cur_op = expression[i];
-                    if (may_be_unary && (cur_op == '+' || cur_op == '-'))
-                    {
-                        cur_op = -cur_op;
-                    }
-                    while (!op.empty() && ((cur_op >= 0 && priority(op.top()) >= priority(cur_op)) ||
-                                           (cur_op < 0 && priority(op.top()) > priority(cur_op))))
+                    auto expanded = _expand(content);
+                    if (expanded.has_value())
                     {
-                        process_op(op.top());
-                        op.pop();
+                        result.replace(start, std::string::npos, *expanded);
+                        continue;
                     }
-                    op.push(cur_op);
-                    may_be_unary = true;
                 }
-                else
-                {
-                    long long number = 0;
-                    while (i < expression.size() && expression[i] >= '0' && expression[i] <= '9')
-                    {
-                        number = number * 10 + expression[i++] - '0';
-                    }
-                    i--;
 
-                    st.push(number);
-                    may_be_unary = false;
-                }
+                result += c;
             }
 
-            while (!op.empty())
+            return result;
+        }
+
+        /**
+         * @brief Evaluate a mathematical expression
+         *
+         * Compiled expressions are cached by shape, so repeatedly evaluating similar expressions only tokenizes them
+         * and runs their compiled program.
+         *
+         * @param expression The expression to evaluate
+         * @return The result of the evaluation
+         */
+        long long eval_ll(const std::string &expression) const
+        {
+            Expression::tokenize(expression, _shape_buffer, _literals_buffer);
+
+            auto iter = _expressions.find(_shape_buffer);
+            if (iter == _expressions.end())
             {
-                process_op(op.top());
-                op.pop();
+                if (_expressions.size() >= MAX_CACHED_EXPRESSIONS)
+                {
+                    _expressions.clear();
+                }
+
+                iter = _expressions.emplace(_shape_buffer, Expression(_shape_buffer)).first;
             }
 
-            return st.empty() ? 0 : st.top();
+            return iter->second.evaluate(_literals_buffer, _stack_buffer);
         }
     };
 }
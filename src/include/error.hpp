@@ -15,6 +15,12 @@ namespace liteshell
         {
             return message.c_str();
         }
+
+        /** @brief The errorlevel set when this exception reaches the shell */
+        virtual DWORD errorlevel() const noexcept
+        {
+            return 1000;
+        }
     };
 
     /** @brief Exceptions regarding subprocesses */
@@ -29,6 +35,11 @@ namespace liteshell
     {
     public:
         SubprocessCreationError(const std::string &message) : SubprocessException(message) {}
+
+        DWORD errorlevel() const noexcept
+        {
+            return 903;
+        }
     };
 
     /** @brief Exceptions regarding shell environment */
@@ -43,14 +54,75 @@ namespace liteshell
     {
     public:
         EnvironmentResolveError(const std::string &message) : EnvironmentException(message) {}
+
+        DWORD errorlevel() const noexcept
+        {
+            return 904;
+        }
     };
 
-    /** @brief Exception thrown when a command couldn't be found */
+    /**
+     * @brief Exception thrown when a command couldn't be found
+     *
+     * The suggestion may be computed lazily, only when the error message is actually requested.
+     */
     class CommandNotFound : public LiteShellException
     {
+    private:
+        /** @brief The message with the suggestion, shared by the copies of a thrown exception */
+        struct _LazyMessage
+        {
+            std::once_flag once;
+            std::string message;
+        };
+
+        const std::string _name;
+        const std::function<std::string()> _suggest;
+        const std::shared_ptr<_LazyMessage> _lazy;
+
     public:
         CommandNotFound(const std::string &name, const std::string &suggestion)
-            : LiteShellException(utils::format("Command \"%s\" not found. Did you mean \"%s\"?", name.c_str(), suggestion.c_str())) {}
+            : CommandNotFound(name, [suggestion]()
+                              { return suggestion; }) {}
+
+        /**
+         * @param name The name of the command
+         * @param suggest A function returning the name of the closest command, invoked at most once by `what`
+         */
+        CommandNotFound(const std::string &name, const std::function<std::string()> &suggest)
+            : LiteShellException(utils::format("Command \"%s\" not found.", name.c_str())),
+              _name(name),
+              _suggest(suggest),
+              _lazy(std::make_shared<_LazyMessage>()) {}
+
+        /**
+         * @brief The error message, with the suggestion of `suggest`
+         *
+         * Safe to call from several threads. If the suggestion cannot be computed, the message without it is
+         * returned instead.
+         */
+        const char *what() const noexcept
+        {
+            try
+            {
+                std::call_once(
+                    _lazy->once,
+                    [this]()
+                    { _lazy->message = utils::format("%s Did you mean \"%s\"?", message.c_str(), _suggest().c_str()); });
+
+                return _lazy->message.c_str();
+            }
+            catch (...)
+            {
+                // Another thread may be retrying the call, the message of the base class is never modified
+                return message.c_str();
+            }
+        }
+
+        DWORD errorlevel() const noexcept
+        {
+            return 905;
+        }
     };
 
     /** @brief Exceptions regarding context parsing */
@@ -65,6 +137,11 @@ namespace liteshell
     {
     public:
         ArgumentMissingError(const std::string &name) : ContextException(utils::format("Argument \"%s\" is missing", name.c_str())) {}
+
+        DWORD errorlevel() const noexcept
+        {
+            return 906;
+        }
     };
 
     /** @brief Exception thrown when an unrecognized option is provided */
@@ -72,6 +149,11 @@ namespace liteshell
     {
     public:
         UnrecognizedOption(const std::string &name) : ContextException(utils::format("Unrecognized option \"%s\"", name.c_str())) {}
+
+        DWORD errorlevel() const noexcept
+        {
+            return 907;
+        }
     };
 
     /** @brief Exception thrown when the number of provided positional arguments exceeds the constraint */
@@ -79,5 +161,10 @@ namespace liteshell
     {
     public:
         TooManyPositionalArguments() : ContextException("Too many positional arguments were passed") {}
+
+        DWORD errorlevel() const noexcept
+        {
+            return 908;
+        }
     };
 }
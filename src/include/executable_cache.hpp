@@ -0,0 +1,188 @@
+#pragma once
+
+#include "converter.hpp"
+#include "maps.hpp"
+#include "split.hpp"
+
+namespace liteshell
+{
+    /**
+     * @brief A cache of the executables found in the directories of `PATH`.
+     *
+     * Each token is searched in the directories once, later lookups of the same token (found or not) are answered
+     * from the cache. The whole cache is invalidated when `PATH` changes or when an entry is created, renamed or
+     * removed in one of its directories, which is detected with change notifications. Directories which cannot be
+     * watched (e.g. they do not exist) are still searched but not watched, use `hash -r` after creating them.
+     */
+    class ExecutableCache
+    {
+    private:
+        /** @brief The value of `PATH` that `_directories` were split from */
+        std::string _path;
+        std::vector<std::string> _directories;
+
+        /** @brief The change notifications of the directories that could be watched */
+        std::vector<HANDLE> _notifications;
+
+        utils::CaseInsensitiveMap<std::optional<std::string>> _entries;
+        std::size_t _hits = 0, _misses = 0;
+
+        ExecutableCache(const ExecutableCache &) = delete;
+        ExecutableCache &operator=(const ExecutableCache &) = delete;
+
+        void _close_notifications()
+        {
+            for (auto notification : _notifications)
+            {
+                FindCloseChangeNotification(notification);
+            }
+
+            _notifications.clear();
+        }
+
+        void _watch()
+        {
+            _close_notifications();
+            for (auto &directory : _directories)
+            {
+                auto notification = FindFirstChangeNotificationW(
+                    utils::utf_convert(directory).c_str(),
+                    FALSE,
+                    FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_DIR_NAME);
+                if (notification != INVALID_HANDLE_VALUE)
+                {
+                    _notifications.push_back(notification);
+                }
+            }
+        }
+
+        /**
+         * @brief Poll the change notifications without blocking, and re-arm the signaled ones
+         *
+         * @return Whether any directory has changed since the last call
+         */
+        bool _changed()
+        {
+            bool changed = false;
+            for (std::size_t offset = 0; offset < _notifications.size(); offset += MAXIMUM_WAIT_OBJECTS)
+            {
+                auto count = std::min<std::size_t>(_notifications.size() - offset, MAXIMUM_WAIT_OBJECTS);
+                while (true)
+                {
+                    auto result = WaitForMultipleObjects(count, _notifications.data() + offset, FALSE, 0);
+                    if (result >= WAIT_OBJECT_0 + count)
+                    {
+                        break; // WAIT_TIMEOUT: no other directory has changed
+                    }
+
+                    changed = true;
+                    if (!FindNextChangeNotification(_notifications[offset + result - WAIT_OBJECT_0]))
+                    {
+                        // The directory is gone, watch the directories again
+                        _watch();
+                        return true;
+                    }
+                }
+            }
+
+            return changed;
+        }
+
+    public:
+        /** @brief Construct an empty `ExecutableCache` */
+        ExecutableCache() {}
+
+        /** @brief Destructor for this object, which closes the change notifications */
+        ~ExecutableCache()
+        {
+            _close_notifications();
+        }
+
+        /**
+         * @brief Get the directories of `PATH`, which are only split again when `PATH` has changed
+         *
+         * @param path The current value of `PATH`
+         * @return The directories of `path`, in search order
+         */
+        const std::vector<std::string> &directories(const std::string_view &path)
+        {
+            if (path != _path)
+            {
+                _path = path;
+                _directories = utils::split(_path, LITE_SHELL_PATH_SEPARATOR);
+                _entries.clear();
+                _watch();
+            }
+
+            return _directories;
+        }
+
+        /**
+         * @brief Find an executable in the directories of `PATH`
+         *
+         * @param path The current value of `PATH`
+         * @param token The token to look up, which must not contain path separators
+         * @param search A function searching `token` in a single directory, invoked for each directory in order
+         * on a cache miss
+         * @return The path to the executable if found, `std::nullopt` otherwise
+         */
+        std::optional<std::string> find(
+            const std::string_view &path,
+            const std::string &token,
+            const std::function<std::optional<std::string>(const std::string &directory)> &search)
+        {
+            directories(path);
+            if (_changed())
+            {
+                _entries.clear();
+            }
+
+            auto iter = _entries.find(token);
+            if (iter != _entries.end())
+            {
+                _hits++;
+                return iter->second;
+            }
+
+            _misses++;
+
+            std::optional<std::string> result;
+            for (auto &directory : _directories)
+            {
+                result = search(directory);
+                if (result.has_value())
+                {
+                    break;
+                }
+            }
+
+            _entries[token] = result;
+            return result;
+        }
+
+        /** @brief Remove all cached entries and reset the statistics */
+        void clear()
+        {
+            _entries.clear();
+            _hits = _misses = 0;
+        }
+
+        /** @brief The cached entries, mapping lowercase tokens to their executables (or `std::nullopt`) */
+        const utils::CaseInsensitiveMap<std::optional<std::string>> &entries() const
+        {
+            return _entries;
+        }
+
+        /** @brief The number of lookups answered from the cache */
+        std::size_t hits() const
+        {
+            return _hits;
+        }
+
+        /** @brief The number of lookups which searched the directories */
+        std::size_t misses() const
+        {
+            return _misses;
+        }
+    };
+}
@@ -0,0 +1,251 @@
+#pragma once
+
+#include "utils.hpp"
+
+namespace liteshell
+{
+    /**
+     * @brief A compiled mathematical expression.
+     *
+     * Expressions are compiled from their shape, i.e. the expression with each integer literal replaced by a
+     * placeholder, into a postfix program. Expressions that only differ by their literals (e.g. `3 * 3` and `7 * 7`,
+     * which typically come from resolving `$div * $div`) share the same program.
+     */
+    class Expression
+    {
+    private:
+        /** @brief The placeholder of an integer literal in a shape */
+        static const char LITERAL = '#';
+
+        /** @brief The unary `+` and `-` operators in a program */
+        static const char POSITIVE = 'p', NEGATIVE = 'n';
+
+        /** @brief The postfix program, each character is an operator or `LITERAL` */
+        std::string _program;
+
+        /** @brief The maximum number of operands on the stack when executing `_program` */
+        std::size_t _depth = 0;
+
+        static int _priority(const char op)
+        {
+            if (op < 0) // unary operator
+                return 3;
+            if (op == '+' || op == '-')
+                return 1;
+            if (op == '*' || op == '/' || op == '%')
+                return 2;
+
+            return -1;
+        }
+
+        /** @brief Append an operator to the program, `depth` is the number of operands on the stack */
+        void _emit(const char op, std::size_t &depth)
+        {
+            if (op < 0)
+            {
+                if (depth == 0)
+                {
+                    throw std::runtime_error("Invalid expression at unary operator");
+                }
+
+                switch (-op)
+                {
+                case '+':
+                    _program += POSITIVE;
+                    break;
+                case '-':
+                    _program += NEGATIVE;
+                    break;
+                default:
+                    throw std::runtime_error(utils::format("Invalid expression - unknown unary operator %c", op));
+                }
+            }
+            else
+            {
+                if (depth < 2)
+                {
+                    throw std::runtime_error("Invalid expression at binary operator");
+                }
+
+                switch (op)
+                {
+                case '+':
+                case '-':
+                case '*':
+                case '/':
+                case '%':
+                    _program += op;
+                    depth--;
+                    break;
+                default:
+                    throw std::runtime_error(utils::format("Invalid expression - unknown binary operator %c", op));
+                }
+            }
+        }
+
+    public:
+        /**
+         * @brief Split an expression into its shape and its integer literals
+         *
+         * Both output parameters are overwritten, so callers can reuse their buffers across calls.
+         *
+         * @param expression The expression to split
+         * @param shape The expression without spaces and with each literal replaced by a placeholder
+         * @param literals The literals of the expression, from left to right
+         */
+        static void tokenize(const std::string &expression, std::string &shape, std::vector<long long> &literals)
+        {
+            shape.clear();
+            literals.clear();
+            for (std::size_t i = 0; i < expression.size(); i++)
+            {
+                auto c = expression[i];
+                if (!utils::is_math_symbol(c))
+                {
+                    throw std::runtime_error(utils::format("Unrecognized symbol: %c", c));
+                }
+
+                if ('0' <= c && c <= '9')
+                {
+                    long long number = 0;
+                    while (i < expression.size() && expression[i] >= '0' && expression[i] <= '9')
+                    {
+                        number = number * 10 + expression[i++] - '0';
+                    }
+                    i--;
+
+                    shape += LITERAL;
+                    literals.push_back(number);
+                }
+                else if (c != ' ')
+                {
+                    shape += c;
+                }
+            }
+        }
+
+        /**
+         * @brief Compile an expression shape, as returned by `Expression::tokenize`
+         *
+         * @param shape The shape to compile
+         */
+        explicit Expression(const std::string &shape)
+        {
+            // https://cp-algorithms.com/string/expression_parsing.html
+            std::vector<char> op;
+            std::size_t depth = 0;
+
+            bool may_be_unary = true;
+            for (auto c : shape)
+            {
+                if (c == '(')
+                {
+                    op.push_back('(');
+                    may_be_unary = true;
+                }
+                else if (c == ')')
+                {
+                    while (!op.empty() && op.back() != '(')
+                    {
+                        _emit(op.back(), depth);
+                        op.pop_back();
+                    }
+
+                    if (op.empty())
+                    {
+                        throw std::runtime_error("Invalid expression - missing bracket");
+                    }
+
+                    op.pop_back();
+                    may_be_unary = false;
+                }
+                else if (c == LITERAL)
+                {
+                    _program += LITERAL;
+                    _depth = std::max(_depth, ++depth);
+                    may_be_unary = false;
+                }
+                else
+                {
+                    char cur_op = c;
+                    if (may_be_unary && (cur_op == '+' || cur_op == '-'))
+                    {
+                        cur_op = -cur_op;
+                    }
+                    while (!op.empty() && ((cur_op >= 0 && _priority(op.back()) >= _priority(cur_op)) ||
+                                           (cur_op < 0 && _priority(op.back()) > _priority(cur_op))))
+                    {
+                        _emit(op.back(), depth);
+                        op.pop_back();
+                    }
+                    op.push_back(cur_op);
+                    may_be_unary = true;
+                }
+            }
+
+            while (!op.empty())
+            {
+                _emit(op.back(), depth);
+                op.pop_back();
+            }
+        }
+
+        /**
+         * @brief Evaluate this expression
+         *
+         * @param literals The literals to substitute into the placeholders, as returned by `Expression::tokenize`
+         * @param stack A buffer for the operand stack, reused across calls to avoid allocations
+         * @return The result of the evaluation
+         */
+        long long evaluate(const std::vector<long long> &literals, std::vector<long long> &stack) const
+        {
+            if (stack.size() < _depth)
+            {
+                stack.resize(_depth);
+            }
+
+            std::size_t top = 0, literal = 0;
+            for (auto op : _program)
+            {
+                switch (op)
+                {
+                case LITERAL:
+                    stack[top++] = literals[literal++];
+                    break;
+                case POSITIVE:
+                    break;
+                case NEGATIVE:
+                    stack[top - 1] = -stack[top - 1];
+                    break;
+                default:
+                {
+                    auto r = stack[--top], &l = stack[top - 1];
+                    switch (op)
+                    {
+                    case '+':
+                        l += r;
+                        break;
+                    case '-':
+                        l -= r;
+                        break;
+                    case '*':
+                        l *= r;
+                        break;
+                    case '/':
+                    case '%':
+                        if (r == 0)
+                        {
+                            throw std::runtime_error("Invalid expression - division by zero");
+                        }
+
+                        l = op == '/' ? l / r : l % r;
+                        break;
+                    }
+                }
+                }
+            }
+
+            return top == 0 ? 0 : stack[top - 1];
+        }
+    };
+}
@@ -0,0 +1,247 @@
+#pragma once
+
+#include "converter.hpp"
+
+namespace utils
+{
+    /**
+     * @brief A lazy enumeration of the files matching a pattern (typically `<directory>\*` to list a directory).
+     *
+     * Entries are fetched in large batches by
+     * [`FindFirstFileExW`](https://learn.microsoft.com/en-us/windows/win32/api/fileapi/nf-fileapi-findfirstfileexw)
+     * with `FIND_FIRST_EX_LARGE_FETCH` and handed out one at a time, so iterating a directory uses a constant amount
+     * of memory regardless of its size. Short (8.3) names are not queried, `cAlternateFileName` is always empty.
+     *
+     * This is a single-pass range: it can be iterated once with a range-based for loop.
+     */
+    class FindFiles
+    {
+    private:
+        HANDLE _handle = INVALID_HANDLE_VALUE;
+        WIN32_FIND_DATAW _data;
+
+        FindFiles(const FindFiles &) = delete;
+        FindFiles &operator=(const FindFiles &) = delete;
+
+        void _close()
+        {
+            if (_handle != INVALID_HANDLE_VALUE)
+            {
+                FindClose(_handle);
+                _handle = INVALID_HANDLE_VALUE;
+            }
+        }
+
+    public:
+        /** @brief An input iterator over the entries of a `FindFiles` range */
+        class iterator
+        {
+        private:
+            FindFiles *_owner;
+
+        public:
+            typedef std::input_iterator_tag iterator_category;
+            typedef WIN32_FIND_DATAW value_type;
+            typedef std::ptrdiff_t difference_type;
+            typedef const WIN32_FIND_DATAW *pointer;
+            typedef const WIN32_FIND_DATAW &reference;
+
+            explicit iterator(FindFiles *owner) : _owner(owner) {}
+
+            reference operator*() const
+            {
+                return _owner->_data;
+            }
+
+            pointer operator->() const
+            {
+                return &_owner->_data;
+            }
+
+            iterator &operator++()
+            {
+                if (!FindNextFileW(_owner->_handle, &_owner->_data))
+                {
+                    _owner->_close();
+                    _owner = nullptr;
+                }
+
+                return *this;
+            }
+
+            bool operator==(const iterator &other) const
+            {
+                return _owner == other._owner;
+            }
+
+            bool operator!=(const iterator &other) const
+            {
+                return _owner != other._owner;
+            }
+        };
+
+        /**
+         * @brief Start enumerating the files matching a pattern
+         *
+         * @param pattern A path which may contain wildcards, e.g. `C:\dir\*.txt`
+         */
+        explicit FindFiles(const std::wstring &pattern)
+        {
+            _handle = FindFirstFileExW(pattern.c_str(), FindExInfoBasic, &_data, FindExSearchNameMatch, NULL, FIND_FIRST_EX_LARGE_FETCH);
+        }
+
+        /** @see `FindFiles::FindFiles(const std::wstring &)` */
+        explicit FindFiles(const std::string &pattern) : FindFiles(utf_convert(pattern)) {}
+
+        /** @brief Destructor for this object, which closes the search handle */
+        ~FindFiles()
+        {
+            _close();
+        }
+
+        /** @brief Whether there is no entry left, e.g. no file matches the pattern or the pattern is invalid */
+        bool empty() const
+        {
+            return _handle == INVALID_HANDLE_VALUE;
+        }
+
+        /** @brief An iterator to the current entry */
+        iterator begin()
+        {
+            return iterator(empty() ? nullptr : this);
+        }
+
+        /** @brief An iterator past the last entry */
+        iterator end()
+        {
+            return iterator(nullptr);
+        }
+    };
+
+    /**
+     * @brief Invoke a callback with each entry of a directory except "." and "..", an unreadable directory is empty
+     *
+     * @param directory The directory to enumerate
+     * @param callback The function invoked with each entry, in enumeration order
+     */
+    void enumerate_directory(const std::wstring &directory, const std::function<void(const WIN32_FIND_DATAW &)> &callback)
+    {
+        auto separated = !directory.empty() && (directory.back() == L'\\' || directory.back() == L'/');
+        for (const auto &data : FindFiles(directory + (separated ? L"*" : L"\\*")))
+        {
+            if (wcscmp(data.cFileName, L".") != 0 && wcscmp(data.cFileName, L"..") != 0)
+            {
+                callback(data);
+            }
+        }
+    }
+
+    /**
+     * @brief Invoke a callback with the metadata of each entry of a directory except "." and "..", fetched in bulk
+     *
+     * The entries are read by
+     * [`GetFileInformationByHandleEx`](https://learn.microsoft.com/en-us/windows/win32/api/winbase/nf-winbase-getfileinformationbyhandleex)
+     * with `FileFullDirectoryInfo`, which fills a 64KB buffer with as many entries as fit in each system call and
+     * includes the sizes, times and attributes of the entries without opening them.
+     *
+     * @param directory The directory to enumerate
+     * @param callback The function invoked with each entry and its name (`FileName` is not null-terminated)
+     * @return Whether the directory could be opened
+     */
+    bool query_directory(
+        const std::wstring &directory,
+        const std::function<void(const FILE_FULL_DIR_INFO &, const std::wstring_view &)> &callback)
+    {
+        auto handle = CreateFileW(
+            directory.c_str(),
+            FILE_LIST_DIRECTORY,
+            FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+            NULL,
+            OPEN_EXISTING,
+            FILE_FLAG_BACKUP_SEMANTICS,
+            NULL);
+
+        if (handle == INVALID_HANDLE_VALUE)
+        {
+            return false;
+        }
+
+        // The entries are aligned on 8 bytes within the buffer
+        std::vector<std::uint64_t> buffer((1 << 16) / sizeof(std::uint64_t));
+        try
+        {
+            while (GetFileInformationByHandleEx(handle, FileFullDirectoryInfo, buffer.data(), buffer.size() * sizeof(std::uint64_t)))
+            {
+                auto offset = reinterpret_cast<const char *>(buffer.data());
+                while (true)
+                {
+                    auto &info = *reinterpret_cast<const FILE_FULL_DIR_INFO *>(offset);
+                    std::wstring_view name(info.FileName, info.FileNameLength / sizeof(wchar_t));
+                    if (name != L"." && name != L"..")
+                    {
+                        callback(info, name);
+                    }
+
+                    if (info.NextEntryOffset == 0)
+                    {
+                        break;
+                    }
+
+                    offset += info.NextEntryOffset;
+                }
+            }
+        }
+        catch (...)
+        {
+            CloseHandle(handle);
+            throw;
+        }
+
+        CloseHandle(handle);
+        return true;
+    }
+
+    /**
+     * @brief Whether a file name matches a wildcard pattern, ignoring case like the file system does.
+     *
+     * `*` matches any sequence of characters and `?` matches a single character. The matching backtracks to the
+     * last `*` only, so it runs in `O(|pattern| * |name|)` time at worst and without any allocation.
+     *
+     * @param pattern The pattern, e.g. `*.txt`
+     * @param name The file name to test
+     * @return Whether the whole name matches the pattern
+     */
+    bool wildcard_match(const wchar_t *pattern, const wchar_t *name)
+    {
+        const wchar_t *star = nullptr, *resume = nullptr;
+        while (*name != L'\0')
+        {
+            if (*pattern == L'?' || (*pattern != L'*' && *pattern != L'\0' && std::towlower(*pattern) == std::towlower(*name)))
+            {
+                pattern++;
+                name++;
+            }
+            else if (*pattern == L'*')
+            {
+                star = pattern++;
+                resume = name;
+            }
+            else if (star != nullptr)
+            {
+                pattern = star + 1;
+                name = ++resume;
+            }
+            else
+            {
+                return false;
+            }
+        }
+
+        while (*pattern == L'*')
+        {
+            pattern++;
+        }
+
+        return *pattern == L'\0';
+    }
+}
@@ -5,71 +5,89 @@
 namespace utils
 {
     /**
-     * @brief Search for the closest matching string in a given range
-     *
-     * Search for a string in range [`first`, `last`) that is closest to `value`
+     * @brief Compute the edit (Levenshtein) distance between 2 strings, giving up once it reaches a bound
      *
-     * @param first An iterator pointing to the first string
-     * @param last An iterator pointing after last string
-     * @param value The value to search for
+     * The distance is computed row by row, keeping only the previous row. Since the minimum of a row never
+     * decreases in the following rows, the computation stops as soon as it reaches `bound`.
      *
-     * @return An iterator pointing to the string that is closest to `value`
+     * @param first The first string
+     * @param second The second string
+     * @param bound The distance at which the computation is abandoned
+     * @param row A buffer reused between calls to store a row of the distance table
+     * @return The distance between the strings, or `bound` if it is at least `bound`
      */
-    template <typename _ForwardIterator>
-    _ForwardIterator fuzzy_search(const _ForwardIterator &first, const _ForwardIterator &last, const std::string &value)
+    std::size_t edit_distance(
+        const std::string_view &first,
+        const std::string_view &second,
+        const std::size_t bound,
+        std::vector<std::size_t> &row)
     {
-        if (first == last)
+        auto n = first.size(), m = second.size();
+        if ((n > m ? n - m : m - n) >= bound)
         {
-            throw std::invalid_argument("fuzzy_search got an empty range");
+            return bound;
         }
 
-        int n, m;
-        std::string compare;
-        std::vector<std::vector<int>> dp;
+        row.resize(m + 1);
+        for (std::size_t j = 0; j <= m; j++)
+        {
+            row[j] = j;
+        }
 
-        std::function<int(int, int)> distance;
-        distance = [&value, &n, &m, &compare, &dp, &distance](int value_index, int compare_index)
+        for (std::size_t i = 1; i <= n; i++)
         {
-            if (dp[value_index][compare_index] > -1)
-            {
-                return dp[value_index][compare_index];
-            }
+            // `diagonal` holds the value of the previous row at column j - 1
+            auto diagonal = row[0];
+            row[0] = i;
 
-            int result = -1;
-            if (value_index == n)
-            {
-                result = m - compare_index;
-            }
-            else if (compare_index == m)
-            {
-                result = n - value_index;
-            }
-            else if (value[value_index] == compare[compare_index])
+            auto minimum = row[0];
+            for (std::size_t j = 1; j <= m; j++)
             {
-                result = distance(value_index + 1, compare_index + 1);
+                auto above = row[j];
+                row[j] = first[i - 1] == second[j - 1]
+                             ? diagonal
+                             : 1 + std::min({diagonal, above, row[j - 1]});
+
+                diagonal = above;
+                minimum = std::min(minimum, row[j]);
             }
-            else
+
+            if (minimum >= bound)
             {
-                result = 1 + std::min(
-                                 distance(value_index, compare_index + 1),
-                                 distance(value_index + 1, compare_index),
-                                 distance(value_index + 1, compare_index + 1));
+                return bound;
             }
+        }
 
-            return dp[value_index][compare_index] = result;
-        };
+        return std::min(row[m], bound);
+    }
 
-        int min_diff = INT_MAX;
-        _ForwardIterator result;
-        for (auto iter = first; iter != last; iter++)
+    /**
+     * @brief Search for the closest matching string in a given range
+     *
+     * Search for a string in range [`first`, `last`) that is closest to `value`, in terms of edit distance. Ties are
+     * resolved in favor of the first string.
+     *
+     * @param first An iterator pointing to the first string
+     * @param last An iterator pointing after last string
+     * @param value The value to search for
+     *
+     * @return An iterator pointing to the string that is closest to `value`
+     */
+    template <typename _ForwardIterator>
+    _ForwardIterator fuzzy_search(const _ForwardIterator &first, const _ForwardIterator &last, const std::string &value)
+    {
+        if (first == last)
         {
-            compare = *iter;
-            n = value.size();
-            m = compare.size();
-            dp.clear();
-            dp.resize(n + 1, std::vector<int>(m + 1, -1));
+            throw std::invalid_argument("fuzzy_search got an empty range");
+        }
 
-            int diff = distance(0, 0);
+        std::vector<std::size_t> row;
+        auto min_diff = std::numeric_limits<std::size_t>::max();
+        auto result = first;
+        for (auto iter = first; iter != last && min_diff > 0; iter++)
+        {
+            // Only a strictly closer string can replace the current result
+            auto diff = edit_distance(value, *iter, min_diff, row);
             if (diff < min_diff)
             {
                 min_diff = diff;
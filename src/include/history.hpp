@@ -0,0 +1,424 @@
+#pragma once
+
+#include "finalize.hpp"
+#include "join.hpp"
+#include "mapped_file.hpp"
+#include "strip.hpp"
+#include "utils.hpp"
+
+namespace liteshell
+{
+    /**
+     * @brief The command history of the interactive shell, persisted in an append-only log.
+     *
+     * The log has one entry per line. It is mapped into memory when the history is constructed: the entries loaded
+     * from it are views into the mapping, only the entries added during the session are copied. Each added entry is
+     * appended to the log immediately, so that concurrent shells do not overwrite each other's history.
+     *
+     * At most `CAPACITY` entries are kept in a ring buffer, and the log is compacted on load once it has twice as
+     * many lines. Entries are numbered in the order they were added, starting from 0.
+     *
+     * Searches are case-insensitive. Queries of at least 3 characters are answered from a trigram index, which is
+     * built on the first search and extended incrementally afterwards. Shorter queries scan the entries. Evicted
+     * entries are removed from the index and from memory along with their slot of the ring buffer.
+     */
+    class History
+    {
+    public:
+        /** @brief The maximum number of entries kept in memory */
+        static const std::size_t CAPACITY = 100000;
+
+    private:
+        const std::string _path;
+        HANDLE _log = INVALID_HANDLE_VALUE;
+        std::unique_ptr<utils::MappedFile> _mapped;
+
+        /** @brief The storage of the entries added during the session, a deque never moves its elements */
+        std::deque<std::string> _added;
+
+        /** @brief The entries in memory, entry `n` is at index `n % CAPACITY` */
+        std::vector<std::string_view> _ring;
+        std::size_t _total = 0;
+
+        /** @brief The entries containing a trigram, in increasing order from `begin` */
+        struct _Postings
+        {
+            std::vector<std::size_t> entries;
+
+            /** @brief The number of evicted entries at the front of `entries`, which are erased in batches */
+            std::size_t begin = 0;
+        };
+
+        /** @brief The entries in memory containing each trigram */
+        std::unordered_map<std::uint32_t, _Postings> _index;
+        std::size_t _indexed = 0;
+
+        History(const History &) = delete;
+        History &operator=(const History &) = delete;
+
+        static char _lower(const char c)
+        {
+            return static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+        }
+
+        static std::uint32_t _trigram(const char *data)
+        {
+            return static_cast<std::uint32_t>(static_cast<unsigned char>(_lower(data[0]))) << 16 |
+                   static_cast<std::uint32_t>(static_cast<unsigned char>(_lower(data[1]))) << 8 |
+                   static_cast<std::uint32_t>(static_cast<unsigned char>(_lower(data[2])));
+        }
+
+        static bool _matches(const std::string_view &entry, const std::string_view &query, const bool prefix)
+        {
+            auto equal = [](const char first, const char second)
+            {
+                return _lower(first) == _lower(second);
+            };
+
+            if (prefix)
+            {
+                return entry.size() >= query.size() && std::equal(query.begin(), query.end(), entry.begin(), equal);
+            }
+
+            return std::search(entry.begin(), entry.end(), query.begin(), query.end(), equal) != entry.end();
+        }
+
+        static HANDLE _open(const std::string &path, const DWORD access, const DWORD disposition)
+        {
+            auto handle = CreateFileW(
+                utils::utf_convert(path).c_str(),
+                access,
+                FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                NULL,
+                disposition,
+                FILE_ATTRIBUTE_NORMAL,
+                NULL);
+            if (handle == INVALID_HANDLE_VALUE)
+            {
+                throw std::runtime_error(utils::last_error(utils::format("Unable to open history file \"%s\"", path.c_str())));
+            }
+
+            return handle;
+        }
+
+        static void _write(const HANDLE handle, const std::string_view &data)
+        {
+            DWORD written = 0;
+            if (!WriteFile(handle, data.data(), static_cast<DWORD>(data.size()), &written, NULL) || written != data.size())
+            {
+                throw std::runtime_error(utils::last_error("Unable to write history file"));
+            }
+        }
+
+        /** @brief Remove the oldest entry from the trigram index and from `_added`, before its slot is reused */
+        void _evict()
+        {
+            auto n = first();
+            auto entry = get(n);
+            if (n < _indexed)
+            {
+                // The oldest entry is at the front of the postings of each of its trigrams
+                for (std::size_t i = 0; i + 3 <= entry.size(); i++)
+                {
+                    auto iter = _index.find(_trigram(entry.data() + i));
+                    if (iter == _index.end() || iter->second.entries[iter->second.begin] != n)
+                    {
+                        // A trigram repeated in the entry
+                        continue;
+                    }
+
+                    auto &postings = iter->second;
+                    if (++postings.begin == postings.entries.size())
+                    {
+                        _index.erase(iter);
+                    }
+                    else if (2 * postings.begin >= postings.entries.size())
+                    {
+                        postings.entries.erase(postings.entries.begin(), postings.entries.begin() + postings.begin);
+                        postings.begin = 0;
+                    }
+                }
+            }
+
+            // The entries added during the session are evicted in the order they were added, after the loaded ones
+            if (!_added.empty() && _added.front().data() == entry.data())
+            {
+                _added.pop_front();
+            }
+        }
+
+        void _push(const std::string_view &entry)
+        {
+            if (_ring.size() < CAPACITY)
+            {
+                _ring.push_back(entry);
+            }
+            else
+            {
+                _evict();
+                _ring[_total % CAPACITY] = entry;
+            }
+
+            _total++;
+        }
+
+        /** @brief Map the log and load its last `CAPACITY` lines, compacting it if needed */
+        void _load()
+        {
+            _mapped = std::make_unique<utils::MappedFile>(_open(_path, GENERIC_READ, OPEN_ALWAYS));
+
+            std::vector<std::string_view> lines;
+            auto view = _mapped->view();
+            while (!view.empty())
+            {
+                auto end = std::min(view.find('\n'), view.size());
+                auto line = view.substr(0, end);
+                if (!line.empty() && line.back() == '\r')
+                {
+                    line.remove_suffix(1);
+                }
+
+                if (!line.empty())
+                {
+                    lines.push_back(line);
+                }
+
+                view.remove_prefix(std::min(end + 1, view.size()));
+            }
+
+            auto first = lines.size() > CAPACITY ? lines.size() - CAPACITY : 0;
+            if (lines.size() > 2 * CAPACITY)
+            {
+                std::string content;
+                for (auto i = first; i < lines.size(); i++)
+                {
+                    content += lines[i];
+                    content += '\n';
+                }
+
+                // The views into the old mapping are invalidated, the log is loaded again after being rewritten
+                _mapped.reset();
+                {
+                    auto handle = _open(_path, GENERIC_WRITE, CREATE_ALWAYS);
+                    auto _finalize = utils::Finalize(
+                        [&handle]()
+                        {
+                            CloseHandle(handle);
+                        });
+
+                    _write(handle, content);
+                }
+
+                _load();
+                return;
+            }
+
+            for (auto i = first; i < lines.size(); i++)
+            {
+                _push(lines[i]);
+            }
+        }
+
+        /** @brief Add the entries which were added since the last search to the trigram index */
+        void _update_index()
+        {
+            for (auto n = std::max(_indexed, first()); n < _total; n++)
+            {
+                auto entry = get(n);
+                for (std::size_t i = 0; i + 3 <= entry.size(); i++)
+                {
+                    auto &entries = _index[_trigram(entry.data() + i)].entries;
+                    if (entries.empty() || entries.back() != n)
+                    {
+                        entries.push_back(n);
+                    }
+                }
+            }
+
+            _indexed = _total;
+        }
+
+    public:
+        /**
+         * @brief Load the history from a log file, which is created if it does not exist
+         *
+         * @param path The path to the log file
+         */
+        explicit History(const std::string &path) : _path(path)
+        {
+            _load();
+            _log = _open(_path, FILE_APPEND_DATA, OPEN_ALWAYS);
+        }
+
+        /** @brief Destructor for this object */
+        ~History()
+        {
+            CloseHandle(_log);
+        }
+
+        /**
+         * @brief The default path of the log file: `LITESHELL_HISTORY` if it is set, otherwise `.liteshell_history` in
+         * the profile directory of the user
+         */
+        static std::string default_path()
+        {
+            auto path = utils::get_environment_variable("LITESHELL_HISTORY");
+            if (path.has_value() && !path->empty())
+            {
+                return *path;
+            }
+
+            auto profile = utils::get_environment_variable("USERPROFILE");
+            if (profile.has_value() && !profile->empty())
+            {
+                return utils::join(*profile, ".liteshell_history");
+            }
+
+            return utils::join(utils::get_executable_directory(), ".liteshell_history");
+        }
+
+        /** @brief The path to the log file */
+        const std::string &path() const
+        {
+            return _path;
+        }
+
+        /** @brief The number of the oldest entry in memory */
+        std::size_t first() const
+        {
+            return _total - _ring.size();
+        }
+
+        /** @brief The number of the next entry to be added, i.e. one past the most recent entry */
+        std::size_t end() const
+        {
+            return _total;
+        }
+
+        /**
+         * @brief Get an entry
+         *
+         * @param n The number of the entry, which must be in `[first(), end())`
+         * @return A view of the entry, valid until the history is cleared
+         */
+        std::string_view get(const std::size_t n) const
+        {
+            return _ring[n % CAPACITY];
+        }
+
+        /**
+         * @brief Add an entry and append it to the log, unless it is blank or repeats the most recent entry
+         *
+         * @param line The command line to add
+         * @return Whether the entry was added
+         */
+        bool add(const std::string &line)
+        {
+            auto entry = utils::strip(line);
+            if (entry.empty() || (_total > first() && get(_total - 1) == entry))
+            {
+                return false;
+            }
+
+            _write(_log, entry + "\n");
+
+            _added.push_back(std::move(entry));
+            _push(_added.back());
+            return true;
+        }
+
+        /** @brief Remove all entries, in memory and in the log */
+        void clear()
+        {
+            _ring.clear();
+            _index.clear();
+            _added.clear();
+            _total = _indexed = 0;
+
+            _mapped.reset();
+            CloseHandle(_open(_path, GENERIC_WRITE, CREATE_ALWAYS));
+        }
+
+        /**
+         * @brief Search for an entry containing a query, ignoring case
+         *
+         * @param query The text to search for
+         * @param from The number of the entry to start from
+         * @param backward Whether to find the most recent match before `from`, instead of the oldest match at or after `from`
+         * @param prefix Whether the entry must start with `query` instead of only containing it
+         * @return The number of the matching entry, or `std::nullopt` if there is none
+         */
+        std::optional<std::size_t> search(const std::string_view &query, const std::size_t from, const bool backward, const bool prefix)
+        {
+            auto lower = first();
+            auto begin = std::max(from, lower), end = std::min(from, _total);
+            if (query.size() < 3)
+            {
+                if (backward)
+                {
+                    for (auto n = end; n > lower; n--)
+                    {
+                        if (_matches(get(n - 1), query, prefix))
+                        {
+                            return n - 1;
+                        }
+                    }
+                }
+                else
+                {
+                    for (auto n = begin; n < _total; n++)
+                    {
+                        if (_matches(get(n), query, prefix))
+                        {
+                            return n;
+                        }
+                    }
+                }
+
+                return std::nullopt;
+            }
+
+            // Only the entries containing the rarest trigram of the query are checked
+            _update_index();
+            const _Postings *candidates = nullptr;
+            for (std::size_t i = 0; i + 3 <= query.size(); i++)
+            {
+                auto iter = _index.find(_trigram(query.data() + i));
+                if (iter == _index.end())
+                {
+                    return std::nullopt;
+                }
+
+                auto size = iter->second.entries.size() - iter->second.begin;
+                if (candidates == nullptr || size < candidates->entries.size() - candidates->begin)
+                {
+                    candidates = &iter->second;
+                }
+            }
+
+            auto candidates_begin = candidates->entries.begin() + candidates->begin, candidates_end = candidates->entries.end();
+            if (backward)
+            {
+                for (auto iter = std::lower_bound(candidates_begin, candidates_end, end); iter != candidates_begin; iter--)
+                {
+                    if (_matches(get(*(iter - 1)), query, prefix))
+                    {
+                        return *(iter - 1);
+                    }
+                }
+            }
+            else
+            {
+                for (auto iter = std::lower_bound(candidates_begin, candidates_end, begin); iter != candidates_end; iter++)
+                {
+                    if (_matches(get(*iter), query, prefix))
+                    {
+                        return *iter;
+                    }
+                }
+            }
+
+            return std::nullopt;
+        }
+    };
+}
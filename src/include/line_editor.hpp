@@ -0,0 +1,508 @@
+#pragma once
+
+#include "converter.hpp"
+#include "finalize.hpp"
+#include "history.hpp"
+
+namespace liteshell
+{
+    /** @brief The completions of the word before the cursor in a command line */
+    struct Completion
+    {
+        /** @brief The offset in bytes of the word in the line, including its opening quote if any */
+        std::size_t start = 0;
+
+        /** @brief The words which may replace it, directories end with a backslash */
+        std::vector<std::string> candidates;
+    };
+
+    /** @brief A function completing the text before the cursor */
+    typedef std::function<Completion(const std::string &before)> Completer;
+
+    /**
+     * @brief An editor of command lines typed in the console, with history recall and incremental search.
+     *
+     * The console input is read key by key with
+     * [`ReadConsoleInputW`](https://learn.microsoft.com/en-us/windows/console/readconsoleinput):
+     * - Left, Right, Home and End move the cursor, Backspace and Delete remove a character, Escape clears the line.
+     * - Up and Down recall the previous and next entries of the history starting with the text typed so far.
+     * - Ctrl-R starts a reverse incremental search, pressing it again finds an older match. Enter runs the match,
+     *   the arrow keys edit it and Escape or Ctrl-G cancels the search.
+     * - Tab completes the word before the cursor using the completer, if any. A unique candidate replaces the word,
+     *   otherwise their longest common prefix does, and the candidates are listed when it is no longer than the word.
+     * - Ctrl-C discards the line and Ctrl-Z on an empty line signals the end of input.
+     *
+     * The line is redrawn in place, each character is assumed to occupy one cell of the console.
+     */
+    class LineEditor
+    {
+    private:
+        const HANDLE _input, _output;
+        const std::shared_ptr<History> _history;
+        Completer _completer;
+
+        std::wstring _line;
+        std::size_t _cursor = 0;
+
+        /** @brief The number of cells drawn by the last render, and the offset of the cursor within them */
+        std::size_t _rendered = 0, _offset = 0;
+
+        /** @brief The history entry being shown, or `_history->end()` for the line being typed */
+        std::size_t _position = 0;
+
+        /** @brief The line typed before recalling history entries, which recalled entries must start with */
+        std::string _typed;
+
+        /** @brief The state of the incremental search */
+        bool _searching = false;
+        std::wstring _query;
+        std::optional<std::size_t> _match;
+        bool _failed = false;
+
+        LineEditor(const LineEditor &) = delete;
+        LineEditor &operator=(const LineEditor &) = delete;
+
+        static long long _linear(const CONSOLE_SCREEN_BUFFER_INFO &info)
+        {
+            return static_cast<long long>(info.dwCursorPosition.Y) * info.dwSize.X + info.dwCursorPosition.X;
+        }
+
+        void _write(const std::wstring_view &text) const
+        {
+            for (std::size_t offset = 0; offset < text.size();)
+            {
+                DWORD written = 0;
+                if (!WriteConsoleW(_output, text.data() + offset, static_cast<DWORD>(text.size() - offset), &written, NULL) || written == 0)
+                {
+                    return;
+                }
+
+                offset += written;
+            }
+        }
+
+        void _move(const long long position, const SHORT width) const
+        {
+            COORD coord;
+            coord.X = static_cast<SHORT>(position % width);
+            coord.Y = static_cast<SHORT>(position / width);
+            SetConsoleCursorPosition(_output, coord);
+        }
+
+        /** @brief Replace the text drawn by the last render, then place the cursor at `cursor` within the new text */
+        void _render(const std::wstring &text, const std::size_t cursor)
+        {
+            CONSOLE_SCREEN_BUFFER_INFO info;
+            if (!GetConsoleScreenBufferInfo(_output, &info))
+            {
+                return;
+            }
+
+            auto width = std::max<SHORT>(1, info.dwSize.X);
+            _move(_linear(info) - static_cast<long long>(_offset), width);
+            _write(text);
+            if (_rendered > text.size())
+            {
+                _write(std::wstring(_rendered - text.size(), L' '));
+            }
+
+            // The start is computed again from the end, in case the console scrolled while writing
+            GetConsoleScreenBufferInfo(_output, &info);
+            auto start = _linear(info) - static_cast<long long>(std::max(_rendered, text.size()));
+            _move(start + static_cast<long long>(cursor), width);
+
+            _rendered = text.size();
+            _offset = cursor;
+        }
+
+        void _render()
+        {
+            if (_searching)
+            {
+                std::wstring text = _failed ? L"(failed reverse-i-search)`" : L"(reverse-i-search)`";
+                text += _query;
+                text += L"': ";
+                if (_match.has_value())
+                {
+                    text += utils::utf_convert(_history->get(*_match));
+                }
+
+                _render(text, text.size());
+            }
+            else
+            {
+                _render(_line, _cursor);
+            }
+        }
+
+        void _set_line(const std::wstring &line)
+        {
+            _line = line;
+            _cursor = _line.size();
+        }
+
+        /** @brief Show the next entry of the history in a direction, starting with the text typed before */
+        void _recall(const bool backward)
+        {
+            if (_position == _history->end())
+            {
+                _typed = utils::utf_convert(_line);
+            }
+
+            auto found = backward
+                             ? _history->search(_typed, _position, true, true)
+                             : (_position < _history->end() ? _history->search(_typed, _position + 1, false, true) : std::nullopt);
+            if (found.has_value())
+            {
+                _position = *found;
+                _set_line(utils::utf_convert(_history->get(*found)));
+            }
+            else if (!backward && _position < _history->end())
+            {
+                _position = _history->end();
+                _set_line(utils::utf_convert(_typed));
+            }
+        }
+
+        /** @brief Search for the query from the current match, which is skipped if `older` is true, or from the most recent entry */
+        void _search(const bool older)
+        {
+            if (_query.empty())
+            {
+                return;
+            }
+
+            auto from = _match.has_value() ? *_match + (older ? 0 : 1) : _history->end();
+            auto found = _history->search(utils::utf_convert(_query), from, true, false);
+            _failed = !found.has_value();
+            if (found.has_value())
+            {
+                _match = found;
+            }
+        }
+
+        /** @brief Leave the incremental search, editing the match unless `cancel` is true */
+        void _leave_search(const bool cancel)
+        {
+            _searching = false;
+            if (!cancel && _match.has_value())
+            {
+                _position = *_match;
+                _set_line(utils::utf_convert(_history->get(*_match)));
+            }
+        }
+
+        static bool _equal(const char first, const char second)
+        {
+            return std::tolower(static_cast<unsigned char>(first)) == std::tolower(static_cast<unsigned char>(second));
+        }
+
+        /** @brief Display the candidates of a completion in columns below the line, then the prompt and the line again */
+        void _list(const std::vector<std::string> &candidates, const std::function<void()> &prompt)
+        {
+            const std::size_t limit = 200;
+
+            auto cursor = _cursor;
+            _cursor = _line.size();
+            _render();
+
+            std::size_t width = 0;
+            for (auto &candidate : candidates)
+            {
+                width = std::max(width, candidate.size() + 2);
+            }
+
+            std::size_t columns = 1;
+            CONSOLE_SCREEN_BUFFER_INFO info;
+            if (GetConsoleScreenBufferInfo(_output, &info))
+            {
+                columns = std::max<std::size_t>(1, (info.dwSize.X - 1) / width);
+            }
+
+            std::string text = "\n";
+            auto count = std::min(candidates.size(), limit);
+            for (std::size_t i = 0; i < count; i++)
+            {
+                text += candidates[i];
+                if ((i + 1) % columns == 0 || i + 1 == count)
+                {
+                    text += '\n';
+                }
+                else
+                {
+                    text += std::string(width - candidates[i].size(), ' ');
+                }
+            }
+
+            if (candidates.size() > limit)
+            {
+                text += utils::format("... and %zu more\n", candidates.size() - limit);
+            }
+
+            std::cout << text;
+            prompt();
+            std::cout << std::flush;
+
+            _rendered = _offset = 0;
+            _cursor = cursor;
+        }
+
+        /** @brief Complete the word before the cursor */
+        void _complete(const std::function<void()> &prompt)
+        {
+            if (!_completer)
+            {
+                return;
+            }
+
+            auto before = utils::utf_convert(std::wstring_view(_line.data(), _cursor));
+            auto completion = _completer(before);
+            auto &candidates = completion.candidates;
+            if (candidates.empty() || completion.start > before.size())
+            {
+                return;
+            }
+
+            auto word = std::string_view(before).substr(completion.start);
+            bool quoted = !word.empty() && word.front() == '"';
+            auto typed = word.size() - std::count(word.begin(), word.end(), '"');
+
+            // The common prefix must not end in the middle of a UTF-8 sequence
+            auto common = candidates.front().size();
+            for (auto &candidate : candidates)
+            {
+                common = std::min<std::size_t>(
+                    common,
+                    std::mismatch(candidate.begin(), candidate.begin() + std::min(common, candidate.size()), candidates.front().begin(), _equal).first - candidate.begin());
+            }
+
+            while (common > 0 && common < candidates.front().size() && (candidates.front()[common] & 0xC0) == 0x80)
+            {
+                common--;
+            }
+
+            if (candidates.size() > 1 && common <= typed)
+            {
+                _list(candidates, prompt);
+                return;
+            }
+
+            auto text = candidates.size() > 1 ? candidates.front().substr(0, common) : candidates.front();
+            bool quote = quoted || text.find(' ') != std::string::npos;
+
+            std::string replacement = quote ? "\"" + text : text;
+            if (candidates.size() == 1 && !utils::endswith(text, "\\"))
+            {
+                // A directory is left open so that its entries can be completed next
+                replacement += quote ? "\" " : " ";
+            }
+
+            auto start = utils::utf_convert(std::string_view(before).substr(0, completion.start)).size();
+            auto wide = utils::utf_convert(replacement);
+            _line.replace(start, _cursor - start, wide);
+            _cursor = start + wide.size();
+            _position = _history->end();
+        }
+
+        /** @brief Move the cursor after the line and start a new console line */
+        void _finish()
+        {
+            _cursor = _line.size();
+            _render();
+            _write(L"\r\n");
+        }
+
+    public:
+        /**
+         * @brief Construct a new `LineEditor` object
+         *
+         * @param history The history to recall entries from
+         */
+        explicit LineEditor(const std::shared_ptr<History> &history)
+            : _input(GetStdHandle(STD_INPUT_HANDLE)), _output(GetStdHandle(STD_OUTPUT_HANDLE)), _history(history) {}
+
+        /** @brief Whether both the standard input and output of the shell are a console, which the editor requires */
+        bool interactive() const
+        {
+            DWORD mode;
+            CONSOLE_SCREEN_BUFFER_INFO info;
+            return GetConsoleMode(_input, &mode) && GetConsoleScreenBufferInfo(_output, &info);
+        }
+
+        /**
+         * @brief Set the function completing the word before the cursor when Tab is pressed
+         *
+         * @param completer The completer, or an empty function to disable completion
+         */
+        void set_completer(const Completer &completer)
+        {
+            _completer = completer;
+        }
+
+        /**
+         * @brief Read a command line from the console, the prompt must already be displayed
+         *
+         * @param prompt The function to display the prompt again after listing completions
+         * @return The line, or `std::nullopt` if the user signaled the end of input
+         */
+        std::optional<std::string> read_line(const std::function<void()> &prompt)
+        {
+            // The prompt must be visible before the cursor position is used
+            std::cout << std::flush;
+
+            DWORD mode = 0;
+            GetConsoleMode(_input, &mode);
+            SetConsoleMode(_input, 0);
+            auto _finalize = utils::Finalize(
+                [this, mode]()
+                {
+                    SetConsoleMode(_input, mode);
+                });
+
+            _line.clear();
+            _cursor = _rendered = _offset = 0;
+            _position = _history->end();
+            _searching = false;
+
+            while (true)
+            {
+                INPUT_RECORD record;
+                DWORD read = 0;
+                if (!ReadConsoleInputW(_input, &record, 1, &read))
+                {
+                    throw std::runtime_error(utils::last_error("ReadConsoleInputW ERROR"));
+                }
+
+                if (read == 0 || record.EventType != KEY_EVENT || !record.Event.KeyEvent.bKeyDown)
+                {
+                    continue;
+                }
+
+                const auto &key = record.Event.KeyEvent;
+                const bool control = key.dwControlKeyState & (LEFT_CTRL_PRESSED | RIGHT_CTRL_PRESSED);
+                const auto c = key.uChar.UnicodeChar;
+                for (WORD repeat = std::max<WORD>(1, key.wRepeatCount); repeat > 0; repeat--)
+                {
+                    if (_searching)
+                    {
+                        // Enter runs the match and the navigation keys edit it, other keys only apply to the search
+                        auto vk = key.wVirtualKeyCode;
+                        bool navigation = c == 0 && (vk == VK_LEFT || vk == VK_RIGHT || vk == VK_HOME || vk == VK_END || vk == VK_UP || vk == VK_DOWN || vk == VK_DELETE);
+                        if (c == L'\r' || navigation)
+                        {
+                            _leave_search(false);
+                        }
+                        else
+                        {
+                            if (c == L'\x12')
+                            {
+                                _search(true);
+                            }
+                            else if (c == L'\b')
+                            {
+                                if (!_query.empty())
+                                {
+                                    _query.pop_back();
+                                    _match = std::nullopt;
+                                    _failed = false;
+                                    _search(false);
+                                }
+                            }
+                            else if (vk == VK_ESCAPE || c == L'\x07')
+                            {
+                                _leave_search(true);
+                            }
+                            else if (c >= L' ' && !control)
+                            {
+                                _query += c;
+                                _search(false);
+                            }
+
+                            continue;
+                        }
+                    }
+
+                    if (c == L'\r')
+                    {
+                        _finish();
+                        return utils::utf_convert(_line);
+                    }
+                    else if (c == L'\x03')
+                    {
+                        _cursor = _line.size();
+                        _render();
+                        _write(L"^C\r\n");
+                        return std::string();
+                    }
+                    else if (c == L'\x1a' && _line.empty())
+                    {
+                        _finish();
+                        return std::nullopt;
+                    }
+                    else if (c == L'\x12')
+                    {
+                        _searching = true;
+                        _failed = false;
+                        _query.clear();
+                        _match = std::nullopt;
+                    }
+                    else if (c == L'\t')
+                    {
+                        _complete(prompt);
+                    }
+                    else if (c == L'\b')
+                    {
+                        if (_cursor > 0)
+                        {
+                            _line.erase(--_cursor, 1);
+                            _position = _history->end();
+                        }
+                    }
+                    else if (key.wVirtualKeyCode == VK_ESCAPE)
+                    {
+                        _set_line(L"");
+                        _position = _history->end();
+                    }
+                    else if (c >= L' ' && !control)
+                    {
+                        _line.insert(_cursor++, 1, c);
+                        _position = _history->end();
+                    }
+                    else if (c == 0)
+                    {
+                        switch (key.wVirtualKeyCode)
+                        {
+                        case VK_LEFT:
+                            _cursor -= _cursor > 0;
+                            break;
+                        case VK_RIGHT:
+                            _cursor += _cursor < _line.size();
+                            break;
+                        case VK_HOME:
+                            _cursor = 0;
+                            break;
+                        case VK_END:
+                            _cursor = _line.size();
+                            break;
+                        case VK_DELETE:
+                            if (_cursor < _line.size())
+                            {
+                                _line.erase(_cursor, 1);
+                                _position = _history->end();
+                            }
+                            break;
+                        case VK_UP:
+                            _recall(true);
+                            break;
+                        case VK_DOWN:
+                            _recall(false);
+                            break;
+                        }
+                    }
+                }
+
+                _render();
+            }
+        }
+    };
+}
@@ -0,0 +1,111 @@
+#pragma once
+
+#include "converter.hpp"
+#include "utils.hpp"
+
+namespace utils
+{
+    /**
+     * @brief A read-only view of a whole file, mapped into the address space of the process.
+     *
+     * The content is paged in by the operating system on access instead of being copied into a buffer.
+     * The view is unmapped when this object is destroyed.
+     */
+    class MappedFile
+    {
+    private:
+        HANDLE _file = INVALID_HANDLE_VALUE, _mapping = NULL;
+        const char *_data = NULL;
+        std::size_t _size = 0;
+
+        MappedFile(const MappedFile &) = delete;
+        MappedFile &operator=(const MappedFile &) = delete;
+
+        void _close()
+        {
+            if (_data != NULL)
+            {
+                UnmapViewOfFile(_data);
+            }
+
+            if (_mapping != NULL)
+            {
+                CloseHandle(_mapping);
+            }
+
+            if (_file != INVALID_HANDLE_VALUE)
+            {
+                CloseHandle(_file);
+            }
+        }
+
+    public:
+        /**
+         * @brief Map a file into memory
+         *
+         * @param path The path to the file
+         */
+        MappedFile(const std::string &path)
+            : MappedFile(CreateFileW(
+                  utf_convert(path).c_str(),
+                  GENERIC_READ,
+                  FILE_SHARE_READ,
+                  NULL,
+                  OPEN_EXISTING,
+                  FILE_ATTRIBUTE_NORMAL,
+                  NULL)) {}
+
+        /**
+         * @brief Map an opened file into memory
+         *
+         * @param file A handle to the file opened with `GENERIC_READ` access, this object takes ownership of it
+         */
+        MappedFile(const HANDLE file) : _file(file)
+        {
+            if (_file == INVALID_HANDLE_VALUE)
+            {
+                throw std::runtime_error(last_error("Error when opening file"));
+            }
+
+            LARGE_INTEGER size;
+            if (!GetFileSizeEx(_file, &size))
+            {
+                auto message = last_error("Error when reading file");
+                _close();
+                throw std::runtime_error(message);
+            }
+
+            // Empty files cannot be mapped
+            _size = size.QuadPart;
+            if (_size == 0)
+            {
+                return;
+            }
+
+            _mapping = CreateFileMappingW(_file, NULL, PAGE_READONLY, 0, 0, NULL);
+            if (_mapping != NULL)
+            {
+                _data = static_cast<const char *>(MapViewOfFile(_mapping, FILE_MAP_READ, 0, 0, 0));
+            }
+
+            if (_data == NULL)
+            {
+                auto message = last_error("Error when mapping file");
+                _close();
+                throw std::runtime_error(message);
+            }
+        }
+
+        /** @brief Destructor for this object, which unmaps the file */
+        ~MappedFile()
+        {
+            _close();
+        }
+
+        /** @brief The content of the file, only valid during the lifetime of this object */
+        std::string_view view() const
+        {
+            return _size == 0 ? std::string_view() : std::string_view(_data, _size);
+        }
+    };
+}
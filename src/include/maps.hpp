@@ -76,5 +76,339 @@ namespace utils
         {
             return _map.find(to_lowercase(key));
         }
+
+        /** @brief Return the number of elements */
+        std::size_t size() const
+        {
+            return _map.size();
+        }
+
+        /** @brief Remove the element at `position` */
+        iterator erase(const_iterator position)
+        {
+            return _map.erase(position);
+        }
+
+        /** @brief Remove all elements */
+        void clear()
+        {
+            _map.clear();
+        }
+    };
+
+    /**
+     * @brief An immutable mapping of case-insensitive strings to values, using a perfect hash function.
+     *
+     * The table is built once from the keys of a `CaseInsensitiveMap`, with a seed chosen so that no 2 keys share
+     * a slot. A lookup hashes the key while lowercasing it on the fly and compares it with at most 1 entry, hence
+     * it never allocates.
+     *
+     * @tparam V The value type
+     */
+    template <typename V>
+    class FrozenCaseInsensitiveMap
+    {
+    private:
+        struct _Entry
+        {
+            /** @brief The lowercase key, empty if the slot is unused */
+            std::string key;
+
+            /** @brief The value mapped to the key */
+            V value;
+        };
+
+        std::vector<_Entry> _slots;
+        std::size_t _seed = 0;
+
+        static char _lower(const char c)
+        {
+            return 'A' <= c && c <= 'Z' ? c - 'A' + 'a' : c;
+        }
+
+        /** @brief FNV-1a hash of the lowercase form of a key */
+        static std::size_t _hash(const std::string_view &key, const std::size_t seed)
+        {
+            std::uint64_t hash = 14695981039346656037ull ^ seed;
+            for (auto c : key)
+            {
+                hash ^= static_cast<unsigned char>(_lower(c));
+                hash *= 1099511628211ull;
+            }
+
+            return hash ^ (hash >> 32);
+        }
+
+        std::size_t _slot(const std::string_view &key) const
+        {
+            return _hash(key, _seed) & (_slots.size() - 1);
+        }
+
+    public:
+        /** @brief Construct an empty `FrozenCaseInsensitiveMap` */
+        FrozenCaseInsensitiveMap() : _slots(1) {}
+
+        /**
+         * @brief Construct a `FrozenCaseInsensitiveMap` containing the elements of a `CaseInsensitiveMap`
+         *
+         * @param map The mapping to copy
+         */
+        explicit FrozenCaseInsensitiveMap(const CaseInsensitiveMap<V> &map)
+        {
+            std::size_t count = 0;
+            for (auto iter = map.begin(); iter != map.end(); iter++)
+            {
+                count++;
+            }
+
+            // Start with a load factor of at most 1/2, and grow the table if no seed works
+            std::size_t size = 1;
+            while (size < 2 * count)
+            {
+                size *= 2;
+            }
+
+            while (true)
+            {
+                _slots.assign(size, _Entry());
+                for (_seed = 0; _seed < 64; _seed++)
+                {
+                    std::vector<bool> used(size);
+                    bool perfect = true;
+                    for (auto &[key, value] : map)
+                    {
+                        auto slot = _slot(key);
+                        if (used[slot])
+                        {
+                            perfect = false;
+                            break;
+                        }
+
+                        used[slot] = true;
+                    }
+
+                    if (perfect)
+                    {
+                        for (auto &[key, value] : map)
+                        {
+                            _slots[_slot(key)] = {key, value};
+                        }
+
+                        return;
+                    }
+                }
+
+                size *= 2;
+            }
+        }
+
+        /**
+         * @brief Find the value mapped to a key
+         *
+         * @param key The key to find, compared case-insensitively
+         * @return A pointer to the value, or `nullptr` if the key does not exist
+         */
+        const V *find(const std::string_view &key) const
+        {
+            const auto &entry = _slots[_slot(key)];
+            if (entry.key.empty() || entry.key.size() != key.size())
+            {
+                return nullptr;
+            }
+
+            for (std::size_t i = 0; i < key.size(); i++)
+            {
+                if (entry.key[i] != _lower(key[i]))
+                {
+                    return nullptr;
+                }
+            }
+
+            return &entry.value;
+        }
+    };
+
+    /**
+     * @brief A mapping stored in a contiguous array with linear lookups.
+     *
+     * This is faster than `std::map` for the handful of elements of a command invocation, while providing the
+     * subset of its interface used by `liteshell::Context`.
+     *
+     * @tparam K The key type
+     * @tparam V The value type
+     */
+    template <typename K, typename V>
+    class FlatMap
+    {
+    private:
+        typedef typename std::vector<std::pair<K, V>> _vector_type;
+
+        _vector_type _elements;
+
+    public:
+        /** @brief A random access iterator to `std::pair<K, V>` */
+        typedef typename _vector_type::iterator iterator;
+        /** @brief A random access iterator to `const std::pair<K, V>` */
+        typedef typename _vector_type::const_iterator const_iterator;
+
+        /** @brief Access element, inserting a default-constructed value if it does not exist */
+        V &operator[](const K &key)
+        {
+            auto iter = find(key);
+            if (iter == end())
+            {
+                _elements.emplace_back(key, V());
+                return _elements.back().second;
+            }
+
+            return iter->second;
+        }
+
+        /** @brief Access element, throwing `std::out_of_range` if it does not exist */
+        const V &at(const K &key) const
+        {
+            auto iter = find(key);
+            if (iter == end())
+            {
+                throw std::out_of_range("FlatMap::at");
+            }
+
+            return iter->second;
+        }
+
+        /** @brief Return iterator to beginning */
+        iterator begin()
+        {
+            return _elements.begin();
+        }
+
+        /** @brief Return const_iterator to beginning */
+        const_iterator begin() const
+        {
+            return _elements.begin();
+        }
+
+        /** @brief Return iterator to end */
+        iterator end()
+        {
+            return _elements.end();
+        }
+
+        /** @brief Return const_iterator to end */
+        const_iterator end() const
+        {
+            return _elements.end();
+        }
+
+        /** @brief Get iterator to element */
+        iterator find(const K &key)
+        {
+            return std::find_if(_elements.begin(), _elements.end(), [&key](const std::pair<K, V> &element)
+                                { return element.first == key; });
+        }
+
+        /** @brief Get const_iterator to element */
+        const_iterator find(const K &key) const
+        {
+            return std::find_if(_elements.begin(), _elements.end(), [&key](const std::pair<K, V> &element)
+                                { return element.first == key; });
+        }
+
+        /** @brief Count elements with a specific key */
+        std::size_t count(const K &key) const
+        {
+            return find(key) == end() ? 0 : 1;
+        }
+
+        /** @brief The number of elements */
+        std::size_t size() const
+        {
+            return _elements.size();
+        }
     };
+
+    /**
+     * @brief A set stored in a contiguous array with linear lookups.
+     * @see `FlatMap`
+     *
+     * @tparam K The key type
+     */
+    template <typename K>
+    class FlatSet
+    {
+    private:
+        typedef typename std::vector<K> _vector_type;
+
+        _vector_type _elements;
+
+    public:
+        /** @brief A random access iterator to `const K` */
+        typedef typename _vector_type::const_iterator const_iterator;
+
+        /** @brief Insert an element, return whether it was not present */
+        bool insert(const K &key)
+        {
+            if (count(key) == 0)
+            {
+                _elements.push_back(key);
+                return true;
+            }
+
+            return false;
+        }
+
+        /** @brief Return const_iterator to beginning */
+        const_iterator begin() const
+        {
+            return _elements.begin();
+        }
+
+        /** @brief Return const_iterator to end */
+        const_iterator end() const
+        {
+            return _elements.end();
+        }
+
+        /** @brief Count elements with a specific key */
+        std::size_t count(const K &key) const
+        {
+            return std::find(_elements.begin(), _elements.end(), key) == _elements.end() ? 0 : 1;
+        }
+
+        /** @brief The number of elements */
+        std::size_t size() const
+        {
+            return _elements.size();
+        }
+    };
+}
+
+namespace std
+{
+    template <typename K, typename V>
+    ostream &operator<<(ostream &stream, const utils::FlatMap<K, V> &_m)
+    {
+        stream << "{";
+        for (auto iter = _m.begin(); iter != _m.end(); iter++)
+        {
+            stream << iter->first << ": " << iter->second;
+            if (next(iter) != _m.end())
+            {
+                stream << ", ";
+            }
+        }
+        stream << "}";
+
+        return stream;
+    }
+
+    template <typename K>
+    ostream &operator<<(ostream &stream, const utils::FlatSet<K> &_s)
+    {
+        stream << "{";
+        __list_elements(stream, _s.begin(), _s.end());
+        stream << "}";
+
+        return stream;
+    }
 }
@@ -0,0 +1,494 @@
+#pragma once
+
+#include "utils.hpp"
+
+namespace utils
+{
+    /**
+     * @brief A bounded, thread-safe byte queue connecting a writer thread to a reader thread.
+     *
+     * Writing blocks while the buffer is full and reading blocks while it is empty, so a fast producer is throttled
+     * to the speed of its consumer with a constant memory usage.
+     */
+    class RingBuffer
+    {
+    private:
+        std::vector<char> _data;
+        std::size_t _head = 0, _size = 0;
+        bool _write_closed = false, _read_closed = false;
+
+        std::mutex _mutex;
+        std::condition_variable _readable, _writable;
+
+        RingBuffer(const RingBuffer &) = delete;
+        RingBuffer &operator=(const RingBuffer &) = delete;
+
+    public:
+        /** @brief The default capacity of a `RingBuffer` */
+        static const std::size_t DEFAULT_CAPACITY = 1 << 16;
+
+        /**
+         * @brief Construct a new `RingBuffer` object
+         *
+         * @param capacity The maximum number of bytes waiting to be read
+         */
+        explicit RingBuffer(const std::size_t capacity = DEFAULT_CAPACITY) : _data(capacity) {}
+
+        /**
+         * @brief Append data to the buffer, blocking until there is enough space
+         *
+         * Data written after the reader side was closed is discarded.
+         *
+         * @param data A pointer to the data to write
+         * @param size The number of bytes to write
+         */
+        void write(const char *data, std::size_t size)
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            while (size > 0 && !_read_closed)
+            {
+                _writable.wait(lock, [this]()
+                               { return _size < _data.size() || _read_closed; });
+                if (_read_closed)
+                {
+                    break;
+                }
+
+                auto tail = (_head + _size) % _data.size();
+                auto count = std::min({size, _data.size() - _size, _data.size() - tail});
+                std::copy(data, data + count, _data.begin() + tail);
+
+                _size += count;
+                data += count;
+                size -= count;
+                _readable.notify_one();
+            }
+        }
+
+        /**
+         * @brief Take data from the buffer, blocking until some data is available
+         *
+         * @param data A pointer to the destination
+         * @param size The maximum number of bytes to read
+         * @return The number of bytes read, 0 if the writer side was closed and the buffer is empty
+         */
+        std::size_t read(char *data, const std::size_t size)
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _readable.wait(lock, [this]()
+                           { return _size > 0 || _write_closed; });
+
+            auto count = std::min({size, _size, _data.size() - _head});
+            std::copy(_data.begin() + _head, _data.begin() + _head + count, data);
+
+            _head = (_head + count) % _data.size();
+            _size -= count;
+            _writable.notify_one();
+
+            return count;
+        }
+
+        /** @brief Close the writer side, the reader receives EOF once the remaining data is consumed */
+        void close_write()
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _write_closed = true;
+            _readable.notify_all();
+        }
+
+        /** @brief Close the reader side, unblocking the writer and discarding further writes */
+        void close_read()
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _read_closed = true;
+            _writable.notify_all();
+        }
+    };
+
+    /** @brief An input stream buffer pulling its data from a callback, e.g. a `RingBuffer` or a pipe */
+    class ReaderBuffer : public std::streambuf
+    {
+    private:
+        const std::function<std::size_t(char *, std::size_t)> _read;
+        char _buffer[4096];
+
+    protected:
+        int_type underflow() override
+        {
+            if (gptr() == egptr())
+            {
+                auto count = _read(_buffer, sizeof(_buffer));
+                if (count == 0)
+                {
+                    return traits_type::eof();
+                }
+
+                setg(_buffer, _buffer, _buffer + count);
+            }
+
+            return traits_type::to_int_type(*gptr());
+        }
+
+    public:
+        /**
+         * @brief Construct a new `ReaderBuffer` object
+         *
+         * @param read A function reading at most the specified number of bytes into the given buffer and returning
+         * the number of bytes read, 0 means EOF
+         */
+        explicit ReaderBuffer(const std::function<std::size_t(char *, std::size_t)> &read) : _read(read)
+        {
+            setg(_buffer, _buffer, _buffer);
+        }
+    };
+
+    /** @brief An output stream buffer pushing its data to a callback, e.g. a `RingBuffer` or a pipe */
+    class WriterBuffer : public std::streambuf
+    {
+    private:
+        const std::function<void(const char *, std::size_t)> _write;
+        const bool _flush_on_sync;
+        std::vector<char> _buffer;
+
+        void _flush()
+        {
+            if (pptr() > pbase())
+            {
+                _write(pbase(), pptr() - pbase());
+                setp(_buffer.data(), _buffer.data() + _buffer.size());
+            }
+        }
+
+    protected:
+        int_type overflow(int_type c) override
+        {
+            _flush();
+            if (!traits_type::eq_int_type(c, traits_type::eof()))
+            {
+                *pptr() = traits_type::to_char_type(c);
+                pbump(1);
+            }
+
+            return traits_type::not_eof(c);
+        }
+
+        std::streamsize xsputn(const char *data, std::streamsize size) override
+        {
+            // Large writes skip the buffer instead of being copied through it
+            if (size >= static_cast<std::streamsize>(_buffer.size()))
+            {
+                _flush();
+                _write(data, size);
+                return size;
+            }
+
+            return std::streambuf::xsputn(data, size);
+        }
+
+        int sync() override
+        {
+            if (_flush_on_sync)
+            {
+                _flush();
+            }
+
+            return 0;
+        }
+
+    public:
+        /**
+         * @brief Construct a new `WriterBuffer` object
+         *
+         * @param write A function writing the specified bytes
+         * @param capacity The size of the buffer
+         * @param flush_on_sync Whether to flush the buffer on each `std::flush` (and `std::endl`), otherwise
+         * the buffer is only flushed when it is full or destroyed
+         */
+        explicit WriterBuffer(
+            const std::function<void(const char *, std::size_t)> &write,
+            const std::size_t capacity = 4096,
+            const bool flush_on_sync = true)
+            : _write(write), _flush_on_sync(flush_on_sync), _buffer(capacity)
+        {
+            setp(_buffer.data(), _buffer.data() + _buffer.size());
+        }
+
+        /** @brief Destructor for this object, which flushes the remaining data */
+        ~WriterBuffer()
+        {
+            _flush();
+        }
+    };
+
+    /** @brief Create a `ReaderBuffer` reading from a Win32 handle, e.g. the read end of a pipe */
+    std::unique_ptr<ReaderBuffer> handle_reader(const HANDLE handle)
+    {
+        return std::make_unique<ReaderBuffer>(
+            [handle](char *data, std::size_t size) -> std::size_t
+            {
+                DWORD read = 0;
+                if (!ReadFile(handle, data, size, &read, NULL))
+                {
+                    return 0; // ERROR_BROKEN_PIPE: the writer has exited
+                }
+
+                return read;
+            });
+    }
+
+    /**
+     * @brief Create a `WriterBuffer` writing to a Win32 handle, e.g. the write end of a pipe or a file
+     * @see `WriterBuffer::WriterBuffer`
+     */
+    std::unique_ptr<WriterBuffer> handle_writer(const HANDLE handle, const std::size_t capacity = 4096, const bool flush_on_sync = true)
+    {
+        return std::make_unique<WriterBuffer>(
+            [handle](const char *data, std::size_t size)
+            {
+                while (size > 0)
+                {
+                    DWORD written = 0;
+                    if (!WriteFile(handle, data, size, &written, NULL))
+                    {
+                        return; // The reader has exited, discard the remaining data
+                    }
+
+                    data += written;
+                    size -= written;
+                }
+            },
+            capacity,
+            flush_on_sync);
+    }
+
+    /**
+     * @brief Read a stream buffer in chunks which end at a line boundary
+     *
+     * The data available without blocking is read in chunks of up to `capacity` bytes, and the complete lines read
+     * so far are handed over before waiting for more: the lines of a slow producer are consumed as they arrive. A
+     * buffer without a get area (`std::cin` synchronized with stdio) is read one character at a time, and handed over
+     * line by line.
+     *
+     * @param input The buffer to read until EOF
+     * @param consume A function receiving each chunk, only the last one may lack a line terminator
+     * @param capacity The maximum size of a chunk, unless a line is longer
+     */
+    void read_lines(std::streambuf &input, const std::function<void(const std::string_view &)> &consume, const std::size_t capacity = 1 << 20)
+    {
+        typedef std::streambuf::traits_type traits;
+
+        std::string buffer(capacity, '\0');
+
+        // The first `checked` bytes of the buffer contain no line terminator
+        std::size_t filled = 0, checked = 0;
+        while (true)
+        {
+            auto available = input.in_avail();
+            if (available > 0 && filled < buffer.size())
+            {
+                filled += input.sgetn(buffer.data() + filled, std::min<std::streamsize>(available, buffer.size() - filled));
+                continue;
+            }
+
+            // The incomplete last line is kept for the next chunk
+            auto newline = std::string_view(buffer.data() + checked, filled - checked).rfind('\n');
+            if (newline != std::string_view::npos)
+            {
+                auto end = checked + newline + 1;
+                consume(std::string_view(buffer.data(), end));
+                std::memmove(buffer.data(), buffer.data() + end, filled - end);
+                filled -= end;
+                checked = 0;
+                continue;
+            }
+
+            checked = filled;
+            if (filled == buffer.size())
+            {
+                buffer.resize(buffer.size() * 2);
+                continue;
+            }
+
+            auto c = input.sbumpc();
+            if (traits::eq_int_type(c, traits::eof()))
+            {
+                break;
+            }
+
+            buffer[filled++] = traits::to_char_type(c);
+        }
+
+        if (filled > 0)
+        {
+            consume(std::string_view(buffer.data(), filled));
+        }
+    }
+
+    /**
+     * @brief Per-thread redirection of the standard streams.
+     *
+     * Built-in commands write to `std::cout` and `std::cerr` directly. To run them concurrently with different
+     * outputs, both streams forward to buffers chosen by the calling thread, which default to the original console
+     * buffers. Commands reading the standard input use `StandardStreams::input()`, which is `std::cin` unless the
+     * input of the calling thread is redirected.
+     */
+    class StandardStreams
+    {
+    private:
+        /** @brief An output stream buffer forwarding every operation to the target of the calling thread */
+        class _ForwardingBuffer : public std::streambuf
+        {
+        private:
+            std::streambuf *const _default;
+            std::streambuf *&(*const _target)();
+
+        protected:
+            // Errors of redirected outputs are not reported, so that they cannot fail the shared standard streams
+            std::streamsize xsputn(const char *data, std::streamsize size) override
+            {
+                auto target = _target();
+                return target == nullptr ? _default->sputn(data, size) : (target->sputn(data, size), size);
+            }
+
+            int_type overflow(int_type c) override
+            {
+                if (traits_type::eq_int_type(c, traits_type::eof()))
+                {
+                    return traits_type::not_eof(c);
+                }
+
+                auto target = _target();
+                return target == nullptr ? _default->sputc(traits_type::to_char_type(c)) : (target->sputc(traits_type::to_char_type(c)), c);
+            }
+
+            int sync() override
+            {
+                auto target = _target();
+                return target == nullptr ? _default->pubsync() : (target->pubsync(), 0);
+            }
+
+        public:
+            _ForwardingBuffer(std::streambuf *default_buffer, std::streambuf *&(*target)())
+                : _default(default_buffer), _target(target) {}
+
+            std::streambuf *get_default() const
+            {
+                return _default;
+            }
+        };
+
+        static std::streambuf *&_output_target()
+        {
+            static thread_local std::streambuf *target = nullptr;
+            return target;
+        }
+
+        static std::streambuf *&_error_target()
+        {
+            static thread_local std::streambuf *target = nullptr;
+            return target;
+        }
+
+        static std::istream *&_input_target()
+        {
+            static thread_local std::istream *target = nullptr;
+            return target;
+        }
+
+        // The buffers are never destroyed, since the standard streams may still be flushed at exit
+        static _ForwardingBuffer &_install()
+        {
+            static auto output = new _ForwardingBuffer(std::cout.rdbuf(), _output_target);
+            static auto error = new _ForwardingBuffer(std::cerr.rdbuf(), _error_target);
+            if (std::cout.rdbuf() != output)
+            {
+                std::cout.rdbuf(output);
+            }
+
+            if (std::cerr.rdbuf() != error)
+            {
+                std::cerr.rdbuf(error);
+            }
+
+            return *output;
+        }
+
+        std::optional<std::istream> _input;
+        std::istream *const _previous_input;
+        std::streambuf *const _previous_output, *const _previous_error;
+
+        StandardStreams(const StandardStreams &) = delete;
+        StandardStreams &operator=(const StandardStreams &) = delete;
+
+    public:
+        /**
+         * @brief Redirect the standard streams of the calling thread for the lifetime of this object
+         *
+         * @param input The buffer to read from, or `nullptr` to keep the current input
+         * @param output The buffer to write to, or `nullptr` to keep the current output
+         * @param error The buffer to write errors to, or `nullptr` to keep the current error output
+         */
+        StandardStreams(std::streambuf *input, std::streambuf *output, std::streambuf *error = nullptr)
+            : _previous_input(_input_target()), _previous_output(_output_target()), _previous_error(_error_target())
+        {
+            _install();
+            if (input != nullptr)
+            {
+                _input.emplace(input);
+                _input_target() = &*_input;
+            }
+
+            if (output != nullptr)
+            {
+                _output_target() = output;
+            }
+
+            if (error != nullptr)
+            {
+                _error_target() = error;
+            }
+        }
+
+        /** @brief Destructor for this object, which flushes the outputs and restores the previous streams */
+        ~StandardStreams()
+        {
+            for (auto target : {_output_target(), _error_target()})
+            {
+                if (target != nullptr)
+                {
+                    target->pubsync();
+                }
+            }
+
+            _input_target() = _previous_input;
+            _output_target() = _previous_output;
+            _error_target() = _previous_error;
+        }
+
+        /** @brief The standard input of the calling thread */
+        static std::istream &input()
+        {
+            auto target = _input_target();
+            return target == nullptr ? std::cin : *target;
+        }
+
+        /** @brief The buffer that the standard output of the calling thread currently writes to */
+        static std::streambuf *output()
+        {
+            auto target = _output_target();
+            return target == nullptr ? _install().get_default() : target;
+        }
+
+        /** @brief Whether the output of the calling thread is redirected */
+        static bool is_output_redirected()
+        {
+            return _output_target() != nullptr;
+        }
+
+        /** @brief Whether the input of the calling thread is redirected */
+        static bool is_input_redirected()
+        {
+            return _input_target() != nullptr;
+        }
+    };
+}
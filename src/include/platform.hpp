@@ -0,0 +1,44 @@
+#pragma once
+
+/**
+ * The platform layer of the shell.
+ *
+ * The shell is written against the Win32 API. On Windows, this header includes the Windows SDK. On Linux, it
+ * includes the POSIX platform layer under `posix/`, which implements the subset of the Win32 API used by the shell
+ * on top of POSIX and Linux system calls: processes are spawned with `posix_spawn`, directories are enumerated with
+ * `getdents64`, files are mapped with `mmap` and changes are watched with inotify. The interpreter core, the
+ * built-in commands and the benchmark suite then build unchanged, and run under the Linux profiling tools.
+ */
+
+#ifdef _WIN32
+
+#include <pathcch.h>
+#include <windows.h>
+#include <wininet.h>
+#include <psapi.h>
+#include <sddl.h>
+
+/** @brief The extension of executables, appended when resolving a command */
+#define LITE_SHELL_EXECUTABLE_EXTENSION ".exe"
+
+/** @brief The separator of the entries of `PATH` */
+#define LITE_SHELL_PATH_SEPARATOR ';'
+
+#elif defined(__linux__)
+
+#include "posix/types.hpp"
+#include "posix/handles.hpp"
+#include "posix/strings.hpp"
+#include "posix/files.hpp"
+#include "posix/pipes.hpp"
+#include "posix/processes.hpp"
+#include "posix/console.hpp"
+#include "posix/system.hpp"
+#include "posix/network.hpp"
+
+#define LITE_SHELL_EXECUTABLE_EXTENSION ""
+#define LITE_SHELL_PATH_SEPARATOR ':'
+
+#else
+#error "The shell only supports Windows and Linux"
+#endif
@@ -0,0 +1,357 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <sys/ioctl.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include "files.hpp"
+
+/**
+ * The console of the POSIX platform layer is a terminal driven with ANSI escape sequences. There is no console input
+ * buffer: `GetConsoleMode` always fails, so the shell reads plain lines (and leaves the editing to the terminal).
+ */
+
+namespace utils::posix
+{
+    /** @brief The colors of the Windows console, which `SetConsoleScreenBufferInfoEx` may replace */
+    const COLORREF DEFAULT_COLOR_TABLE[16] = {
+        RGB(12, 12, 12), RGB(0, 55, 218), RGB(19, 161, 14), RGB(58, 150, 221),
+        RGB(197, 15, 31), RGB(136, 23, 152), RGB(193, 156, 0), RGB(204, 204, 204),
+        RGB(118, 118, 118), RGB(59, 120, 255), RGB(22, 198, 12), RGB(97, 214, 214),
+        RGB(231, 72, 86), RGB(180, 0, 158), RGB(249, 241, 165), RGB(242, 242, 242)};
+
+    /** @brief The state of the terminal, protected by its own mutex */
+    struct Terminal
+    {
+        std::mutex mutex;
+        WORD attributes = FOREGROUND_RED | FOREGROUND_GREEN | FOREGROUND_BLUE;
+        COLORREF colors[16];
+
+        Terminal()
+        {
+            std::copy(std::begin(DEFAULT_COLOR_TABLE), std::end(DEFAULT_COLOR_TABLE), colors);
+        }
+
+        static Terminal &instance()
+        {
+            static Terminal terminal;
+            return terminal;
+        }
+    };
+
+    /** @brief The descriptor of a handle if it refers to a terminal, or -1 */
+    int terminal_descriptor(const HANDLE handle)
+    {
+        auto file = cast<File>(handle);
+        return file != nullptr && isatty(file->descriptor) ? file->descriptor : -1;
+    }
+
+    /** @brief Write an escape sequence to a terminal */
+    BOOL write_sequence(const int descriptor, const std::string &sequence)
+    {
+        for (std::size_t offset = 0; offset < sequence.size();)
+        {
+            auto written = write(descriptor, sequence.data() + offset, sequence.size() - offset);
+            if (written < 0)
+            {
+                if (errno == EINTR)
+                {
+                    continue;
+                }
+
+                return fail_errno();
+            }
+
+            offset += written;
+        }
+
+        return TRUE;
+    }
+
+    /** @brief The SGR sequence of a color of the console, a color changed by the color table is written as RGB */
+    std::string color_sequence(const WORD index, const bool background, const COLORREF *colors)
+    {
+        if (colors[index] != DEFAULT_COLOR_TABLE[index])
+        {
+            auto color = colors[index];
+            return (background ? ";48;2;" : ";38;2;") + std::to_string(color & 0xFF) + ";" +
+                   std::to_string((color >> 8) & 0xFF) + ";" + std::to_string((color >> 16) & 0xFF);
+        }
+
+        // The console has the blue bit first, ANSI has the red bit first
+        auto ansi = ((index & 4) ? 1 : 0) | (index & 2) | ((index & 1) ? 4 : 0);
+        auto base = background ? ((index & 8) ? 100 : 40) : ((index & 8) ? 90 : 30);
+        return ";" + std::to_string(base + ansi);
+    }
+
+    /** @brief The Ctrl-C handlers of `SetConsoleCtrlHandler`, protected by their own mutex */
+    struct ControlHandlers
+    {
+        std::mutex mutex;
+        std::vector<PHANDLER_ROUTINE> handlers;
+        bool ignore = false;
+
+        /** @brief The pipe written by the signal handler, read by the thread running the handlers */
+        int pipe[2] = {-1, -1};
+
+        static ControlHandlers &instance()
+        {
+            static ControlHandlers handlers;
+            return handlers;
+        }
+
+        static void on_signal(int)
+        {
+            auto error = errno;
+            char byte = 0;
+            if (write(instance().pipe[1], &byte, 1) < 0)
+            {
+                // A pending Ctrl-C is already queued
+            }
+
+            errno = error;
+        }
+
+        /**
+         * @brief Install the signal handler on first use. Like on Windows, the handlers run on a thread of their own,
+         * the last one registered first, and the process is interrupted if none of them handles the signal.
+         */
+        void install()
+        {
+            if (pipe[0] >= 0)
+            {
+                return;
+            }
+
+            if (pipe2(pipe, O_CLOEXEC) != 0)
+            {
+                return;
+            }
+
+            std::thread(
+                [this]()
+                {
+                    char byte;
+                    while (true)
+                    {
+                        auto count = read(pipe[0], &byte, 1);
+                        if (count < 0 && errno == EINTR)
+                        {
+                            continue;
+                        }
+
+                        if (count <= 0)
+                        {
+                            return;
+                        }
+
+                        std::vector<PHANDLER_ROUTINE> copy;
+                        {
+                            std::lock_guard<std::mutex> lock(mutex);
+                            if (ignore)
+                            {
+                                continue;
+                            }
+
+                            copy = handlers;
+                        }
+
+                        auto handled = false;
+                        for (auto iter = copy.rbegin(); iter != copy.rend() && !handled; iter++)
+                        {
+                            handled = (*iter)(CTRL_C_EVENT);
+                        }
+
+                        if (!handled)
+                        {
+                            std::fflush(NULL);
+                            signal(SIGINT, SIG_DFL);
+                            kill(getpid(), SIGINT);
+                        }
+                    }
+                })
+                .detach();
+
+            struct sigaction action = {};
+            action.sa_handler = on_signal;
+            action.sa_flags = SA_RESTART;
+            sigemptyset(&action.sa_mask);
+            sigaction(SIGINT, &action, NULL);
+        }
+    };
+}
+
+BOOL GetConsoleMode(HANDLE, LPDWORD)
+{
+    return utils::posix::fail(ERROR_INVALID_HANDLE);
+}
+
+BOOL SetConsoleMode(HANDLE, DWORD)
+{
+    return utils::posix::fail(ERROR_INVALID_HANDLE);
+}
+
+BOOL ReadConsoleInputW(HANDLE, INPUT_RECORD *, DWORD, LPDWORD)
+{
+    return utils::posix::fail(ERROR_INVALID_HANDLE);
+}
+
+BOOL WriteConsoleW(HANDLE handle, const void *buffer, DWORD size, LPDWORD written, LPVOID)
+{
+    auto file = utils::posix::cast<utils::posix::File>(handle);
+    if (file == nullptr)
+    {
+        return utils::posix::fail(ERROR_INVALID_HANDLE);
+    }
+
+    if (!utils::posix::write_sequence(file->descriptor, utils::posix::narrow(std::wstring_view(static_cast<const wchar_t *>(buffer), size))))
+    {
+        return FALSE;
+    }
+
+    if (written != NULL)
+    {
+        *written = size;
+    }
+
+    return TRUE;
+}
+
+BOOL GetConsoleScreenBufferInfo(HANDLE handle, CONSOLE_SCREEN_BUFFER_INFO *info)
+{
+    auto descriptor = utils::posix::terminal_descriptor(handle);
+    winsize size;
+    if (descriptor < 0 || ioctl(descriptor, TIOCGWINSZ, &size) != 0 || size.ws_col == 0)
+    {
+        return utils::posix::fail(ERROR_INVALID_HANDLE);
+    }
+
+    // The cursor position is unknown, the buffer is the visible window
+    auto columns = static_cast<SHORT>(size.ws_col), rows = static_cast<SHORT>(size.ws_row);
+    info->dwSize = {columns, rows};
+    info->dwCursorPosition = {0, 0};
+    info->srWindow = {0, 0, static_cast<SHORT>(columns - 1), static_cast<SHORT>(rows - 1)};
+    info->dwMaximumWindowSize = {columns, rows};
+
+    auto &terminal = utils::posix::Terminal::instance();
+    std::lock_guard<std::mutex> lock(terminal.mutex);
+    info->wAttributes = terminal.attributes;
+    return TRUE;
+}
+
+BOOL GetConsoleScreenBufferInfoEx(HANDLE handle, CONSOLE_SCREEN_BUFFER_INFOEX *info)
+{
+    CONSOLE_SCREEN_BUFFER_INFO basic;
+    if (!GetConsoleScreenBufferInfo(handle, &basic))
+    {
+        return FALSE;
+    }
+
+    info->dwSize = basic.dwSize;
+    info->dwCursorPosition = basic.dwCursorPosition;
+    info->wAttributes = basic.wAttributes;
+    info->srWindow = basic.srWindow;
+    info->dwMaximumWindowSize = basic.dwMaximumWindowSize;
+    info->wPopupAttributes = basic.wAttributes;
+    info->bFullscreenSupported = FALSE;
+
+    auto &terminal = utils::posix::Terminal::instance();
+    std::lock_guard<std::mutex> lock(terminal.mutex);
+    std::copy(std::begin(terminal.colors), std::end(terminal.colors), info->ColorTable);
+    return TRUE;
+}
+
+BOOL SetConsoleScreenBufferInfoEx(HANDLE handle, CONSOLE_SCREEN_BUFFER_INFOEX *info)
+{
+    if (utils::posix::terminal_descriptor(handle) < 0)
+    {
+        return utils::posix::fail(ERROR_INVALID_HANDLE);
+    }
+
+    // Only the color table is kept, it applies to the text written after the next change of attributes
+    auto &terminal = utils::posix::Terminal::instance();
+    std::lock_guard<std::mutex> lock(terminal.mutex);
+    std::copy(std::begin(info->ColorTable), std::end(info->ColorTable), terminal.colors);
+    return TRUE;
+}
+
+BOOL SetConsoleTextAttribute(HANDLE handle, WORD attributes)
+{
+    auto descriptor = utils::posix::terminal_descriptor(handle);
+    if (descriptor < 0)
+    {
+        return utils::posix::fail(ERROR_INVALID_HANDLE);
+    }
+
+    auto &terminal = utils::posix::Terminal::instance();
+    std::lock_guard<std::mutex> lock(terminal.mutex);
+    terminal.attributes = attributes;
+
+    // The default attributes (light gray on black) restore the colors of the terminal
+    auto foreground = attributes & 0xF, background = (attributes >> 4) & 0xF;
+    std::string sequence = "\x1b[0";
+    if (foreground != 7 || background != 0)
+    {
+        sequence += utils::posix::color_sequence(foreground, false, terminal.colors);
+        if (background != 0)
+        {
+            sequence += utils::posix::color_sequence(background, true, terminal.colors);
+        }
+    }
+
+    return utils::posix::write_sequence(descriptor, sequence + "m");
+}
+
+BOOL SetConsoleCursorPosition(HANDLE handle, COORD position)
+{
+    auto descriptor = utils::posix::terminal_descriptor(handle);
+    if (descriptor < 0)
+    {
+        return utils::posix::fail(ERROR_INVALID_HANDLE);
+    }
+
+    return utils::posix::write_sequence(descriptor, "\x1b[" + std::to_string(position.Y + 1) + ";" + std::to_string(position.X + 1) + "H");
+}
+
+/** Only scrolling the whole buffer out of the window is supported, which clears the screen and the scrollback */
+BOOL ScrollConsoleScreenBuffer(HANDLE handle, const SMALL_RECT *, const SMALL_RECT *, COORD, const CHAR_INFO *)
+{
+    auto descriptor = utils::posix::terminal_descriptor(handle);
+    if (descriptor < 0)
+    {
+        return utils::posix::fail(ERROR_INVALID_HANDLE);
+    }
+
+    return utils::posix::write_sequence(descriptor, "\x1b[2J\x1b[3J");
+}
+
+BOOL SetConsoleCtrlHandler(PHANDLER_ROUTINE handler, BOOL add)
+{
+    auto &handlers = utils::posix::ControlHandlers::instance();
+    std::lock_guard<std::mutex> lock(handlers.mutex);
+    handlers.install();
+
+    if (handler == NULL)
+    {
+        handlers.ignore = add;
+        return TRUE;
+    }
+
+    if (add)
+    {
+        handlers.handlers.push_back(handler);
+        return TRUE;
+    }
+
+    auto iter = std::find(handlers.handlers.rbegin(), handlers.handlers.rend(), handler);
+    if (iter == handlers.handlers.rend())
+    {
+        return utils::posix::fail(ERROR_INVALID_PARAMETER);
+    }
+
+    handlers.handlers.erase(std::next(iter).base());
+    return TRUE;
+}
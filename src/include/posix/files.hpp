@@ -0,0 +1,2006 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <linux/fs.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/statfs.h>
+#include <sys/statvfs.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "strings.hpp"
+
+namespace utils::posix
+{
+    /**
+     * @brief Convert a path given to a Win32 function to a native path.
+     *
+     * Backslashes are separators, like on Windows, so that the paths built by the shell (e.g. `<directory>\*`) keep
+     * working. File names containing a backslash are therefore not supported. `NUL` is the null device.
+     */
+    std::string native_path(const LPCWSTR path)
+    {
+        auto result = narrow(path);
+        std::replace(result.begin(), result.end(), '\\', '/');
+        if (result.size() == 3 && std::toupper(result[0]) == 'N' && std::toupper(result[1]) == 'U' && std::toupper(result[2]) == 'L')
+        {
+            return "/dev/null";
+        }
+
+        return result;
+    }
+
+    /** @brief Remove the `.` components, the `..` components and the repeated separators of a path, without any I/O */
+    std::string normalize(const std::string &path)
+    {
+        auto absolute = !path.empty() && path[0] == '/';
+        auto trailing = path.size() > 1 && path.back() == '/';
+
+        std::vector<std::string> components;
+        std::size_t start = 0;
+        while (start <= path.size())
+        {
+            auto end = std::min(path.find('/', start), path.size());
+            auto component = path.substr(start, end - start);
+            if (component == "..")
+            {
+                if (!components.empty() && components.back() != "..")
+                {
+                    components.pop_back();
+                }
+                else if (!absolute)
+                {
+                    components.push_back(component);
+                }
+            }
+            else if (!component.empty() && component != ".")
+            {
+                components.push_back(component);
+            }
+
+            start = end + 1;
+        }
+
+        std::string result = absolute ? "/" : "";
+        for (std::size_t i = 0; i < components.size(); i++)
+        {
+            result += components[i];
+            if (i + 1 < components.size() || trailing)
+            {
+                result += '/';
+            }
+        }
+
+        return result.empty() && !path.empty() ? "." : result;
+    }
+
+    /** @brief The absolute form of a native path, relative to the working directory */
+    std::string absolute_path(const std::string &path)
+    {
+        if (!path.empty() && path[0] == '/')
+        {
+            return normalize(path);
+        }
+
+        char buffer[PATH_MAX];
+        if (getcwd(buffer, sizeof(buffer)) == NULL)
+        {
+            return normalize(path);
+        }
+
+        return normalize(std::string(buffer) + "/" + path);
+    }
+
+    /** @brief The number of 100-nanosecond intervals since 1601-01-01 of a time of the file system */
+    LONGLONG to_ticks(const timespec &time)
+    {
+        return (static_cast<LONGLONG>(time.tv_sec) + 11644473600LL) * 10000000LL + time.tv_nsec / 100;
+    }
+
+    /** @brief The inverse of `to_ticks` */
+    timespec from_filetime_ticks(const LONGLONG ticks)
+    {
+        auto since_epoch = ticks - 116444736000000000LL;
+        return {static_cast<time_t>(since_epoch / 10000000LL), static_cast<long>(since_epoch % 10000000LL * 100)};
+    }
+
+    /**
+     * @brief The Win32 attributes of a file.
+     *
+     * Symbolic links are reparse points, which are also directories when they point to one. Files whose name starts
+     * with a dot are hidden and files without any write permission are read-only.
+     *
+     * @param name The name of the file, to tell whether it is hidden
+     * @param status The status of the file itself, not of the target of a link
+     * @param target_is_directory Whether a link points to a directory
+     */
+    DWORD attributes(const std::string_view &name, const struct stat &status, const bool target_is_directory)
+    {
+        DWORD result = 0;
+        if (S_ISDIR(status.st_mode) || (S_ISLNK(status.st_mode) && target_is_directory))
+        {
+            result |= FILE_ATTRIBUTE_DIRECTORY;
+        }
+
+        if (S_ISLNK(status.st_mode))
+        {
+            result |= FILE_ATTRIBUTE_REPARSE_POINT;
+        }
+
+        if (name.size() > 1 && name[0] == '.' && name != "..")
+        {
+            result |= FILE_ATTRIBUTE_HIDDEN;
+        }
+
+        if (!(status.st_mode & (S_IWUSR | S_IWGRP | S_IWOTH)))
+        {
+            result |= FILE_ATTRIBUTE_READONLY;
+        }
+
+        if (S_ISREG(status.st_mode) && status.st_blocks * 512 < status.st_size)
+        {
+            result |= FILE_ATTRIBUTE_SPARSE_FILE;
+        }
+
+        return result == 0 ? FILE_ATTRIBUTE_NORMAL : result;
+    }
+
+    /**
+     * @brief The metadata of an entry of a directory, as reported by the enumeration functions
+     *
+     * The creation time is not returned by `stat`, the last write time is reported instead.
+     */
+    struct Metadata
+    {
+        DWORD attributes;
+        LONGLONG creation_time, last_access_time, last_write_time, change_time;
+        LONGLONG size, allocation_size;
+    };
+
+    /**
+     * @brief Query the metadata of a file without following a link
+     *
+     * @param directory A descriptor of the directory containing the file, or `AT_FDCWD`
+     * @param path The path of the file, relative to `directory`
+     * @param name The name of the file
+     * @return The metadata, or `std::nullopt` on failure with `errno` set
+     */
+    std::optional<Metadata> query(const int directory, const char *path, const std::string_view &name)
+    {
+        struct stat status;
+        if (fstatat(directory, path, &status, AT_SYMLINK_NOFOLLOW) != 0)
+        {
+            return std::nullopt;
+        }
+
+        struct stat target;
+        auto target_is_directory = S_ISLNK(status.st_mode) && fstatat(directory, path, &target, 0) == 0 && S_ISDIR(target.st_mode);
+
+        // Like on Windows, the size of directories and links is 0
+        auto regular = S_ISREG(status.st_mode);
+        return Metadata{
+            attributes(name, status, target_is_directory),
+            to_ticks(status.st_mtim),
+            to_ticks(status.st_atim),
+            to_ticks(status.st_mtim),
+            to_ticks(status.st_ctim),
+            regular ? static_cast<LONGLONG>(status.st_size) : 0,
+            regular ? static_cast<LONGLONG>(status.st_blocks) * 512 : 0};
+    }
+
+    /** @brief The last component of a native path */
+    std::string_view basename(const std::string_view &path)
+    {
+        auto end = path.size();
+        while (end > 1 && path[end - 1] == '/')
+        {
+            end--;
+        }
+
+        auto separator = path.substr(0, end).find_last_of('/');
+        return separator == std::string_view::npos ? path.substr(0, end) : path.substr(separator + 1, end - separator - 1);
+    }
+
+    /** @brief An entry returned by `getdents64` */
+    struct DirectoryEntry
+    {
+        ino64_t d_ino;
+        off64_t d_off;
+        unsigned short d_reclen;
+        unsigned char d_type;
+        char d_name[1];
+    };
+
+    /**
+     * @brief Read the entries of a directory with `getdents64`, which fills a 64KB buffer with as many entries as
+     * fit in each system call
+     */
+    class DirectoryReader
+    {
+    private:
+        const int _descriptor;
+        std::vector<char> _buffer = std::vector<char>(1 << 16);
+        std::size_t _position = 0, _filled = 0;
+
+    public:
+        explicit DirectoryReader(const int descriptor) : _descriptor(descriptor) {}
+
+        /** @brief The next entry, or `nullptr` at the end or on failure with `errno` set (0 at the end) */
+        const DirectoryEntry *next()
+        {
+            if (_position == _filled)
+            {
+                auto count = syscall(SYS_getdents64, _descriptor, _buffer.data(), _buffer.size());
+                if (count <= 0)
+                {
+                    if (count == 0)
+                    {
+                        errno = 0;
+                    }
+
+                    _position = _filled = 0;
+                    return nullptr;
+                }
+
+                _position = 0;
+                _filled = count;
+            }
+
+            return reinterpret_cast<const DirectoryEntry *>(_buffer.data() + _position);
+        }
+
+        /** @brief Move past the entry returned by `next` */
+        void advance()
+        {
+            _position += reinterpret_cast<const DirectoryEntry *>(_buffer.data() + _position)->d_reclen;
+        }
+
+        /** @brief Start again from the first entry */
+        void rewind()
+        {
+            lseek(_descriptor, 0, SEEK_SET);
+            _position = _filled = 0;
+        }
+    };
+
+    /**
+     * @brief Add inotify watches on a directory, and on its subdirectories if requested
+     *
+     * @param descriptor The inotify descriptor
+     * @param root The watched directory
+     * @param relative The path of the directory to add, relative to `root`
+     * @param mask The inotify events to watch
+     * @param subtree Whether to also watch the subdirectories, recursively
+     * @param directories Receives the relative path of each watch descriptor
+     * @return Whether the directory itself could be watched
+     */
+    bool add_watches(
+        const int descriptor,
+        const std::string &root,
+        const std::string &relative,
+        const std::uint32_t mask,
+        const bool subtree,
+        std::unordered_map<int, std::string> &directories)
+    {
+        auto path = relative.empty() ? root : root + "/" + relative;
+        auto watch = inotify_add_watch(descriptor, path.c_str(), mask | (subtree ? IN_CREATE : 0) | IN_ONLYDIR);
+        if (watch < 0)
+        {
+            return false;
+        }
+
+        directories[watch] = relative;
+        if (subtree)
+        {
+            auto directory = open(path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+            if (directory >= 0)
+            {
+                DirectoryReader reader(directory);
+                for (auto entry = reader.next(); entry != nullptr; reader.advance(), entry = reader.next())
+                {
+                    std::string_view name(entry->d_name);
+                    if (entry->d_type == DT_DIR && name != "." && name != "..")
+                    {
+                        add_watches(descriptor, root, relative.empty() ? std::string(name) : relative + "/" + std::string(name), mask, true, directories);
+                    }
+                }
+
+                close(directory);
+            }
+        }
+
+        return true;
+    }
+
+    /** @brief The inotify events matching a filter of `FILE_NOTIFY_CHANGE_*` flags */
+    std::uint32_t inotify_mask(const DWORD filter)
+    {
+        std::uint32_t mask = 0;
+        if (filter & (FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_DIR_NAME))
+        {
+            mask |= IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO;
+        }
+
+        if (filter & (FILE_NOTIFY_CHANGE_SIZE | FILE_NOTIFY_CHANGE_LAST_WRITE))
+        {
+            mask |= IN_MODIFY | IN_CLOSE_WRITE;
+        }
+
+        if (filter & FILE_NOTIFY_CHANGE_ATTRIBUTES)
+        {
+            mask |= IN_ATTRIB;
+        }
+
+        return mask;
+    }
+
+    /**
+     * @brief The change notifications of a directory opened with `CreateFileW`, see `ReadDirectoryChangesW`
+     *
+     * A pending request is completed by a thread blocking on the inotify descriptor, the changes made between two
+     * requests are queued by the kernel.
+     */
+    class DirectoryWatch
+    {
+    private:
+        const std::string _root;
+        const bool _subtree;
+        const std::uint32_t _mask;
+        std::unordered_map<int, std::string> _directories;
+
+    public:
+        const int descriptor, cancel;
+        std::thread thread;
+
+        DirectoryWatch(const std::string &root, const bool subtree, const DWORD filter)
+            : _root(root), _subtree(subtree), _mask(inotify_mask(filter)),
+              descriptor(inotify_init1(IN_NONBLOCK | IN_CLOEXEC)), cancel(eventfd(0, EFD_CLOEXEC))
+        {
+            if (descriptor >= 0)
+            {
+                add_watches(descriptor, _root, "", _mask, _subtree, _directories);
+            }
+        }
+
+        ~DirectoryWatch()
+        {
+            if (thread.joinable())
+            {
+                std::uint64_t value = 1;
+                if (write(cancel, &value, sizeof(value)) < 0)
+                {
+                    // The thread still completes once a change happens
+                }
+
+                thread.join();
+            }
+
+            close(descriptor);
+            close(cancel);
+        }
+
+        /**
+         * @brief Block until changes are available, then convert them to `FILE_NOTIFY_INFORMATION` entries
+         *
+         * @return The number of bytes written (0 if the buffer overflowed), or `std::nullopt` if cancelled
+         */
+        std::optional<DWORD> collect(char *buffer, const DWORD size)
+        {
+            pollfd entries[2] = {{descriptor, POLLIN, 0}, {cancel, POLLIN, 0}};
+            while (poll(entries, 2, -1) < 0 && errno == EINTR)
+            {
+            }
+
+            if (entries[1].revents & POLLIN)
+            {
+                std::uint64_t value;
+                if (read(cancel, &value, sizeof(value)) < 0)
+                {
+                    // The counter is reset by the read, a failure leaves nothing to reset
+                }
+
+                return std::nullopt;
+            }
+
+            alignas(inotify_event) char events[1 << 16];
+            DWORD written = 0, previous = 0;
+            bool overflow = false, first = true;
+            ssize_t count;
+            while ((count = read(descriptor, events, sizeof(events))) > 0)
+            {
+                for (ssize_t offset = 0; offset < count;)
+                {
+                    auto &event = *reinterpret_cast<const inotify_event *>(events + offset);
+                    offset += sizeof(inotify_event) + event.len;
+
+                    auto iter = _directories.find(event.wd);
+                    if ((event.mask & IN_Q_OVERFLOW) || iter == _directories.end() || event.len == 0)
+                    {
+                        overflow = overflow || (event.mask & IN_Q_OVERFLOW);
+                        continue;
+                    }
+
+                    auto name = iter->second.empty() ? std::string(event.name) : iter->second + "/" + event.name;
+                    if (_subtree && (event.mask & IN_CREATE) && (event.mask & IN_ISDIR))
+                    {
+                        add_watches(descriptor, _root, name, _mask, true, _directories);
+                    }
+
+                    if (!(event.mask & _mask))
+                    {
+                        continue;
+                    }
+
+                    auto wide = widen(name);
+                    auto length = (offsetof(FILE_NOTIFY_INFORMATION, FileName) + wide.size() * sizeof(WCHAR) + 3) / 4 * 4;
+                    if (written + length > size)
+                    {
+                        overflow = true;
+                        continue;
+                    }
+
+                    auto &info = *reinterpret_cast<FILE_NOTIFY_INFORMATION *>(buffer + written);
+                    info.NextEntryOffset = 0;
+                    info.Action = (event.mask & IN_CREATE)       ? FILE_ACTION_ADDED
+                                  : (event.mask & IN_DELETE)     ? FILE_ACTION_REMOVED
+                                  : (event.mask & IN_MOVED_FROM) ? FILE_ACTION_RENAMED_OLD_NAME
+                                  : (event.mask & IN_MOVED_TO)   ? FILE_ACTION_RENAMED_NEW_NAME
+                                                                 : FILE_ACTION_MODIFIED;
+                    info.FileNameLength = wide.size() * sizeof(WCHAR);
+                    std::copy(wide.begin(), wide.end(), info.FileName);
+
+                    if (!first)
+                    {
+                        reinterpret_cast<FILE_NOTIFY_INFORMATION *>(buffer + previous)->NextEntryOffset = written - previous;
+                    }
+
+                    first = false;
+                    previous = written;
+                    written += length;
+                }
+            }
+
+            // Like on Windows, an empty notification tells that some changes were lost
+            return overflow ? 0 : written;
+        }
+    };
+
+    /** @brief A file, a directory or a pipe opened by the shell */
+    class File : public Object
+    {
+    private:
+        const bool _standard;
+
+    public:
+        const int descriptor;
+
+        /** @brief The native path the file was opened with, empty for pipes and standard handles */
+        const std::string path;
+
+        /** @brief The type of the file, from `st_mode` */
+        const mode_t type;
+
+        bool delete_on_close = false;
+        std::unique_ptr<DirectoryReader> reader;
+        std::unique_ptr<DirectoryWatch> watch;
+
+        File(const int descriptor, const std::string &path, const bool standard = false)
+            : _standard(standard), descriptor(descriptor), path(path),
+              type(
+                  [descriptor]()
+                  {
+                      struct stat status;
+                      return fstat(descriptor, &status) == 0 ? status.st_mode & S_IFMT : 0;
+                  }()) {}
+
+        ~File()
+        {
+            watch.reset();
+            close(descriptor);
+            if (delete_on_close)
+            {
+                std::remove(path.c_str());
+            }
+        }
+
+        bool permanent() const override
+        {
+            return _standard;
+        }
+
+        /** @brief Whether reads reach the end once the writer closes it, like a pipe on Windows */
+        bool is_stream() const
+        {
+            return type == S_IFIFO || type == S_IFSOCK;
+        }
+    };
+
+    /** @brief The standard handles of the process, which can be replaced by `SetStdHandle` */
+    HANDLE &standard_handle(const DWORD which)
+    {
+        static HANDLE handles[3] = {new File(0, "", true), new File(1, "", true), new File(2, "", true)};
+
+        static HANDLE invalid = INVALID_HANDLE_VALUE;
+        auto index = STD_INPUT_HANDLE - which;
+        return index < 3 ? handles[index] : invalid;
+    }
+
+    /** @brief A mapping of a file into memory, see `CreateFileMappingW` */
+    class Mapping : public Object
+    {
+    public:
+        const int descriptor;
+        const std::uint64_t size;
+        const bool writable;
+
+        Mapping(const int descriptor, const std::uint64_t size, const bool writable)
+            : descriptor(descriptor), size(size), writable(writable) {}
+
+        ~Mapping()
+        {
+            close(descriptor);
+        }
+    };
+
+    /** @brief The sizes of the views returned by `MapViewOfFile`, which `munmap` requires */
+    std::unordered_map<const void *, std::size_t> &views(std::unique_lock<std::mutex> &lock)
+    {
+        static std::mutex mutex;
+        static std::unordered_map<const void *, std::size_t> sizes;
+        lock = std::unique_lock<std::mutex>(mutex);
+        return sizes;
+    }
+
+    /** @brief Whether a file name matches a wildcard pattern of `FindFirstFileExW`, case-sensitively */
+    bool matches(const wchar_t *pattern, const wchar_t *name)
+    {
+        const wchar_t *star = nullptr, *resume = nullptr;
+        while (*name != L'\0')
+        {
+            if (*pattern == L'?' || (*pattern != L'*' && *pattern != L'\0' && *pattern == *name))
+            {
+                pattern++;
+                name++;
+            }
+            else if (*pattern == L'*')
+            {
+                star = pattern++;
+                resume = name;
+            }
+            else if (star != nullptr)
+            {
+                pattern = star + 1;
+                name = ++resume;
+            }
+            else
+            {
+                return false;
+            }
+        }
+
+        while (*pattern == L'*')
+        {
+            pattern++;
+        }
+
+        return *pattern == L'\0';
+    }
+
+    /** @brief A search started by `FindFirstFileExW` */
+    class Search : public Object
+    {
+    public:
+        /** @brief The searched directory, or -1 if the pattern has no wildcard */
+        const int descriptor;
+        const std::wstring pattern;
+        DirectoryReader reader;
+
+        Search(const int descriptor, const std::wstring &pattern) : descriptor(descriptor), pattern(pattern), reader(descriptor) {}
+
+        ~Search()
+        {
+            if (descriptor >= 0)
+            {
+                close(descriptor);
+            }
+        }
+
+        /** @brief Fill the next matching entry, return `false` at the end */
+        bool next(WIN32_FIND_DATAW &data)
+        {
+            for (auto entry = reader.next(); entry != nullptr; entry = reader.next())
+            {
+                reader.advance();
+
+                auto name = widen(entry->d_name);
+                if (name.size() < MAX_PATH && matches(pattern.c_str(), name.c_str()) && fill(descriptor, entry->d_name, name, data))
+                {
+                    return true;
+                }
+            }
+
+            return false;
+        }
+
+        /** @brief Fill the entry of a file, return `false` if it cannot be queried */
+        static bool fill(const int directory, const char *path, const std::wstring &name, WIN32_FIND_DATAW &data)
+        {
+            auto metadata = query(directory, path, narrow(name));
+            if (!metadata.has_value())
+            {
+                return false;
+            }
+
+            auto filetime = [](const LONGLONG ticks)
+            {
+                return FILETIME{static_cast<DWORD>(ticks & 0xFFFFFFFF), static_cast<DWORD>(static_cast<ULONGLONG>(ticks) >> 32)};
+            };
+
+            ZeroMemory(&data, sizeof(data));
+            data.dwFileAttributes = metadata->attributes;
+            data.ftCreationTime = filetime(metadata->creation_time);
+            data.ftLastAccessTime = filetime(metadata->last_access_time);
+            data.ftLastWriteTime = filetime(metadata->last_write_time);
+            data.nFileSizeHigh = static_cast<ULONGLONG>(metadata->size) >> 32;
+            data.nFileSizeLow = metadata->size & 0xFFFFFFFF;
+            std::copy(name.begin(), name.end(), data.cFileName);
+            return true;
+        }
+    };
+
+    /** @brief A change notification started by `FindFirstChangeNotificationW`, signaled while changes are queued */
+    class ChangeNotification : public Object
+    {
+    public:
+        const int descriptor;
+        std::unordered_map<int, std::string> directories;
+
+        explicit ChangeNotification(const int descriptor) : descriptor(descriptor) {}
+
+        ~ChangeNotification()
+        {
+            close(descriptor);
+        }
+
+        bool signaled() override
+        {
+            return readable(descriptor);
+        }
+
+        bool polled() const override
+        {
+            return true;
+        }
+    };
+
+    /** @brief Copy the data of a regular file, reporting the progress of `CopyFileExW` */
+    BOOL copy_data(const int source, const int destination, const LONGLONG size, const LPPROGRESS_ROUTINE progress, const LPVOID data, const LPBOOL cancel)
+    {
+        const std::size_t CHUNK_SIZE = 1 << 22;
+        std::vector<char> buffer;
+        LONGLONG copied = 0;
+        auto quiet = progress == NULL;
+        while (true)
+        {
+            // The data stays in the kernel, and may be reflinked by the file system
+            auto count = copy_file_range(source, NULL, destination, NULL, CHUNK_SIZE, 0);
+            if (count < 0 && (errno == EXDEV || errno == ENOSYS || errno == EINVAL || errno == EOPNOTSUPP))
+            {
+                buffer.resize(CHUNK_SIZE);
+                count = read(source, buffer.data(), buffer.size());
+                for (ssize_t offset = 0; count > 0 && offset < count;)
+                {
+                    auto written = write(destination, buffer.data() + offset, count - offset);
+                    if (written < 0)
+                    {
+                        return fail_errno();
+                    }
+
+                    offset += written;
+                }
+            }
+
+            if (count < 0)
+            {
+                if (errno == EINTR)
+                {
+                    continue;
+                }
+
+                return fail_errno();
+            }
+
+            if (count == 0)
+            {
+                return TRUE;
+            }
+
+            copied += count;
+            if (cancel != NULL && *cancel)
+            {
+                return fail(ERROR_REQUEST_ABORTED);
+            }
+
+            if (!quiet)
+            {
+                LARGE_INTEGER total, transferred;
+                total.QuadPart = std::max(size, copied);
+                transferred.QuadPart = copied;
+                switch (progress(total, transferred, total, transferred, 1, 0, NULL, NULL, data))
+                {
+                case PROGRESS_CONTINUE:
+                    break;
+                case 3: // PROGRESS_QUIET
+                    quiet = true;
+                    break;
+                default:
+                    return fail(ERROR_REQUEST_ABORTED);
+                }
+            }
+        }
+    }
+}
+
+HANDLE GetStdHandle(DWORD which)
+{
+    return utils::posix::standard_handle(which);
+}
+
+BOOL SetStdHandle(DWORD which, HANDLE handle)
+{
+    auto &slot = utils::posix::standard_handle(which);
+    if (slot == INVALID_HANDLE_VALUE)
+    {
+        return utils::posix::fail(ERROR_INVALID_PARAMETER);
+    }
+
+    slot = handle;
+    return TRUE;
+}
+
+HANDLE CreateFileW(LPCWSTR name, DWORD access, DWORD, LPSECURITY_ATTRIBUTES, DWORD disposition, DWORD flags, HANDLE)
+{
+    auto path = utils::posix::native_path(name);
+
+    int mode = O_CLOEXEC;
+    auto read_access = access & (GENERIC_READ | FILE_LIST_DIRECTORY);
+    auto write_access = access & (GENERIC_WRITE | FILE_WRITE_DATA | FILE_APPEND_DATA);
+    if (read_access && write_access)
+    {
+        mode |= O_RDWR;
+    }
+    else if (write_access)
+    {
+        mode |= O_WRONLY;
+    }
+    else if (!read_access)
+    {
+        mode |= O_PATH; // e.g. DELETE only, which does not require any permission on the file itself
+    }
+
+    if ((access & FILE_APPEND_DATA) && !(access & (GENERIC_WRITE | FILE_WRITE_DATA)))
+    {
+        mode |= O_APPEND;
+    }
+
+    switch (disposition)
+    {
+    case CREATE_NEW:
+        mode |= O_CREAT | O_EXCL;
+        break;
+    case CREATE_ALWAYS:
+        mode |= O_CREAT | O_TRUNC;
+        break;
+    case OPEN_ALWAYS:
+        mode |= O_CREAT;
+        break;
+    case TRUNCATE_EXISTING:
+        mode |= O_TRUNC;
+        break;
+    }
+
+    if (flags & FILE_FLAG_OPEN_REPARSE_POINT)
+    {
+        mode |= O_NOFOLLOW;
+    }
+
+    int descriptor;
+    while ((descriptor = open(path.c_str(), mode, 0666)) < 0 && errno == EINTR)
+    {
+    }
+
+    if (descriptor < 0)
+    {
+        // O_NOFOLLOW fails on the link itself, which O_PATH opens
+        if (errno == ELOOP && (flags & FILE_FLAG_OPEN_REPARSE_POINT) && !read_access && !write_access)
+        {
+            descriptor = open(path.c_str(), O_PATH | O_NOFOLLOW | O_CLOEXEC);
+        }
+
+        if (descriptor < 0)
+        {
+            utils::posix::fail_errno();
+            return INVALID_HANDLE_VALUE;
+        }
+    }
+
+    auto file = new utils::posix::File(descriptor, path);
+    if (file->type == S_IFDIR && !(flags & FILE_FLAG_BACKUP_SEMANTICS))
+    {
+        // Like on Windows, directories are only opened on request
+        delete file;
+        utils::posix::fail(ERROR_ACCESS_DENIED);
+        return INVALID_HANDLE_VALUE;
+    }
+
+    if (flags & FILE_FLAG_SEQUENTIAL_SCAN)
+    {
+        posix_fadvise(descriptor, 0, 0, POSIX_FADV_SEQUENTIAL);
+    }
+
+    file->delete_on_close = flags & FILE_FLAG_DELETE_ON_CLOSE;
+    SetLastError(ERROR_SUCCESS);
+    return file;
+}
+
+/**
+ * Overlapped requests on files complete synchronously: the data is transferred at the offset of the request before
+ * `ReadFile` returns, and the event of the request is signaled.
+ */
+BOOL ReadFile(HANDLE handle, LPVOID buffer, DWORD size, LPDWORD read_size, LPOVERLAPPED overlapped)
+{
+    auto file = utils::posix::cast<utils::posix::File>(handle);
+    if (file == nullptr)
+    {
+        return utils::posix::fail(ERROR_INVALID_HANDLE);
+    }
+
+    ssize_t count;
+    while (true)
+    {
+        if (overlapped != NULL && !file->is_stream())
+        {
+            auto offset = static_cast<off_t>(static_cast<ULONGLONG>(overlapped->OffsetHigh) << 32 | overlapped->Offset);
+            count = pread(file->descriptor, buffer, size, offset);
+        }
+        else
+        {
+            count = read(file->descriptor, buffer, size);
+        }
+
+        if (count >= 0 || errno != EINTR)
+        {
+            break;
+        }
+    }
+
+    if (count < 0)
+    {
+        return utils::posix::fail_errno();
+    }
+
+    if (read_size != NULL)
+    {
+        *read_size = count;
+    }
+
+    if (count == 0 && size > 0)
+    {
+        // The end of a pipe is reported as an error, and so is the end of a file for an overlapped read
+        if (file->is_stream())
+        {
+            return utils::posix::fail(ERROR_BROKEN_PIPE);
+        }
+
+        if (overlapped != NULL)
+        {
+            overlapped->Internal = ERROR_HANDLE_EOF;
+            overlapped->InternalHigh = 0;
+            return utils::posix::fail(ERROR_HANDLE_EOF);
+        }
+    }
+
+    if (overlapped != NULL)
+    {
+        overlapped->Internal = ERROR_SUCCESS;
+        overlapped->InternalHigh = count;
+        if (overlapped->hEvent != NULL)
+        {
+            SetEvent(overlapped->hEvent);
+        }
+    }
+
+    return TRUE;
+}
+
+BOOL WriteFile(HANDLE handle, LPCVOID buffer, DWORD size, LPDWORD written_size, LPOVERLAPPED overlapped)
+{
+    auto file = utils::posix::cast<utils::posix::File>(handle);
+    if (file == nullptr)
+    {
+        return utils::posix::fail(ERROR_INVALID_HANDLE);
+    }
+
+    ssize_t count;
+    while (true)
+    {
+        if (overlapped != NULL && file->type == S_IFREG)
+        {
+            auto offset = static_cast<off_t>(static_cast<ULONGLONG>(overlapped->OffsetHigh) << 32 | overlapped->Offset);
+            count = pwrite(file->descriptor, buffer, size, offset);
+        }
+        else
+        {
+            count = write(file->descriptor, buffer, size);
+        }
+
+        if (count >= 0 || errno != EINTR)
+        {
+            break;
+        }
+    }
+
+    if (count < 0)
+    {
+        return utils::posix::fail_errno();
+    }
+
+    if (written_size != NULL)
+    {
+        *written_size = count;
+    }
+
+    if (overlapped != NULL)
+    {
+        overlapped->Internal = ERROR_SUCCESS;
+        overlapped->InternalHigh = count;
+        if (overlapped->hEvent != NULL)
+        {
+            SetEvent(overlapped->hEvent);
+        }
+    }
+
+    return TRUE;
+}
+
+BOOL GetOverlappedResult(HANDLE handle, LPOVERLAPPED overlapped, LPDWORD transferred, BOOL wait)
+{
+    std::unique_lock<std::mutex> lock(utils::posix::wait_mutex());
+    while (overlapped->Internal == ERROR_IO_PENDING)
+    {
+        if (!wait)
+        {
+            return utils::posix::fail(ERROR_IO_PENDING);
+        }
+
+        utils::posix::wait_condition().wait(lock);
+    }
+
+    *transferred = overlapped->InternalHigh;
+    if (overlapped->Internal != ERROR_SUCCESS)
+    {
+        return utils::posix::fail(overlapped->Internal);
+    }
+
+    return TRUE;
+}
+
+BOOL CancelIoEx(HANDLE handle, LPOVERLAPPED)
+{
+    auto file = utils::posix::cast<utils::posix::File>(handle);
+    if (file == nullptr)
+    {
+        return utils::posix::fail(ERROR_INVALID_HANDLE);
+    }
+
+    // Only change notifications may be pending, other requests complete before returning
+    if (file->watch != nullptr && file->watch->thread.joinable())
+    {
+        std::uint64_t value = 1;
+        if (write(file->watch->cancel, &value, sizeof(value)) < 0)
+        {
+            return utils::posix::fail_errno();
+        }
+    }
+
+    return TRUE;
+}
+
+BOOL CancelIo(HANDLE handle)
+{
+    return CancelIoEx(handle, NULL);
+}
+
+BOOL ReadDirectoryChangesW(
+    HANDLE handle, LPVOID buffer, DWORD size, BOOL subtree, DWORD filter, LPDWORD returned, LPOVERLAPPED overlapped, LPOVERLAPPED_COMPLETION_ROUTINE)
+{
+    auto file = utils::posix::cast<utils::posix::File>(handle);
+    if (file == nullptr || file->type != S_IFDIR)
+    {
+        return utils::posix::fail(ERROR_INVALID_HANDLE);
+    }
+
+    if (file->watch == nullptr)
+    {
+        file->watch = std::make_unique<utils::posix::DirectoryWatch>(file->path, subtree, filter);
+        if (file->watch->descriptor < 0 || file->watch->cancel < 0)
+        {
+            auto error = errno;
+            file->watch.reset();
+            return utils::posix::fail(utils::posix::error_from_errno(error));
+        }
+    }
+
+    auto watch = file->watch.get();
+    if (watch->thread.joinable())
+    {
+        watch->thread.join(); // The previous request is complete, its result was collected
+    }
+
+    if (overlapped == NULL)
+    {
+        auto result = watch->collect(static_cast<char *>(buffer), size);
+        *returned = result.value_or(0);
+        return result.has_value() ? TRUE : utils::posix::fail(ERROR_OPERATION_ABORTED);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(utils::posix::wait_mutex());
+        overlapped->Internal = ERROR_IO_PENDING;
+        overlapped->InternalHigh = 0;
+    }
+
+    if (overlapped->hEvent != NULL)
+    {
+        ResetEvent(overlapped->hEvent);
+    }
+
+    watch->thread = std::thread(
+        [watch, buffer, size, overlapped]()
+        {
+            auto result = watch->collect(static_cast<char *>(buffer), size);
+            {
+                std::lock_guard<std::mutex> lock(utils::posix::wait_mutex());
+                overlapped->Internal = result.has_value() ? ERROR_SUCCESS : ERROR_OPERATION_ABORTED;
+                overlapped->InternalHigh = result.value_or(0);
+                utils::posix::notify_waiters();
+            }
+
+            if (overlapped->hEvent != NULL)
+            {
+                SetEvent(overlapped->hEvent);
+            }
+        });
+
+    return TRUE;
+}
+
+BOOL GetFileSizeEx(HANDLE handle, PLARGE_INTEGER size)
+{
+    auto file = utils::posix::cast<utils::posix::File>(handle);
+    struct stat status;
+    if (file == nullptr || fstat(file->descriptor, &status) != 0)
+    {
+        return file == nullptr ? utils::posix::fail(ERROR_INVALID_HANDLE) : utils::posix::fail_errno();
+    }
+
+    size->QuadPart = status.st_size;
+    return TRUE;
+}
+
+BOOL GetFileInformationByHandleEx(HANDLE handle, FILE_INFO_BY_HANDLE_CLASS type, LPVOID buffer, DWORD size)
+{
+    auto file = utils::posix::cast<utils::posix::File>(handle);
+    if (file == nullptr)
+    {
+        return utils::posix::fail(ERROR_INVALID_HANDLE);
+    }
+
+    if (type == FileBasicInfo || type == FileStandardInfo)
+    {
+        auto metadata = utils::posix::query(file->descriptor, "", utils::posix::basename(file->path));
+        if (!metadata.has_value())
+        {
+            // fstatat needs AT_EMPTY_PATH to query the descriptor itself
+            struct stat status;
+            if (fstatat(file->descriptor, "", &status, AT_EMPTY_PATH | AT_SYMLINK_NOFOLLOW) != 0)
+            {
+                return utils::posix::fail_errno();
+            }
+
+            metadata = utils::posix::Metadata{
+                utils::posix::attributes(utils::posix::basename(file->path), status, false),
+                utils::posix::to_ticks(status.st_mtim),
+                utils::posix::to_ticks(status.st_atim),
+                utils::posix::to_ticks(status.st_mtim),
+                utils::posix::to_ticks(status.st_ctim),
+                S_ISREG(status.st_mode) ? static_cast<LONGLONG>(status.st_size) : 0,
+                S_ISREG(status.st_mode) ? static_cast<LONGLONG>(status.st_blocks) * 512 : 0};
+        }
+
+        if (type == FileBasicInfo)
+        {
+            auto &info = *static_cast<FILE_BASIC_INFO *>(buffer);
+            info.CreationTime.QuadPart = metadata->creation_time;
+            info.LastAccessTime.QuadPart = metadata->last_access_time;
+            info.LastWriteTime.QuadPart = metadata->last_write_time;
+            info.ChangeTime.QuadPart = metadata->change_time;
+            info.FileAttributes = metadata->attributes;
+        }
+        else
+        {
+            auto &info = *static_cast<FILE_STANDARD_INFO *>(buffer);
+            info.AllocationSize.QuadPart = metadata->allocation_size;
+            info.EndOfFile.QuadPart = metadata->size;
+            info.NumberOfLinks = 1;
+            info.DeletePending = file->delete_on_close;
+            info.Directory = file->type == S_IFDIR;
+        }
+
+        return TRUE;
+    }
+
+    if (type != FileFullDirectoryInfo && type != FileFullDirectoryRestartInfo)
+    {
+        return utils::posix::fail(ERROR_INVALID_PARAMETER);
+    }
+
+    if (file->type != S_IFDIR)
+    {
+        return utils::posix::fail(ERROR_INVALID_PARAMETER);
+    }
+
+    if (file->reader == nullptr)
+    {
+        file->reader = std::make_unique<utils::posix::DirectoryReader>(file->descriptor);
+    }
+    else if (type == FileFullDirectoryRestartInfo)
+    {
+        file->reader->rewind();
+    }
+
+    // As many entries as fit, each aligned on 8 bytes, like the buffer filled by NtQueryDirectoryFile
+    auto output = static_cast<char *>(buffer);
+    DWORD used = 0, previous = 0;
+    for (auto entry = file->reader->next(); entry != nullptr; entry = file->reader->next())
+    {
+        auto name = utils::posix::widen(entry->d_name);
+        auto length = (offsetof(FILE_FULL_DIR_INFO, FileName) + name.size() * sizeof(WCHAR) + 7) / 8 * 8;
+        if (used + length > size)
+        {
+            if (used == 0)
+            {
+                return utils::posix::fail(ERROR_MORE_DATA);
+            }
+
+            break;
+        }
+
+        auto metadata = utils::posix::query(file->descriptor, entry->d_name, entry->d_name);
+        file->reader->advance();
+        if (!metadata.has_value())
+        {
+            continue; // Deleted since the directory was read
+        }
+
+        auto &info = *reinterpret_cast<FILE_FULL_DIR_INFO *>(output + used);
+        info.NextEntryOffset = 0;
+        info.FileIndex = 0;
+        info.CreationTime.QuadPart = metadata->creation_time;
+        info.LastAccessTime.QuadPart = metadata->last_access_time;
+        info.LastWriteTime.QuadPart = metadata->last_write_time;
+        info.ChangeTime.QuadPart = metadata->change_time;
+        info.EndOfFile.QuadPart = metadata->size;
+        info.AllocationSize.QuadPart = metadata->allocation_size;
+        info.FileAttributes = metadata->attributes;
+        info.FileNameLength = name.size() * sizeof(WCHAR);
+        info.EaSize = 0;
+        std::copy(name.begin(), name.end(), info.FileName);
+
+        if (used > 0)
+        {
+            reinterpret_cast<FILE_FULL_DIR_INFO *>(output + previous)->NextEntryOffset = used - previous;
+        }
+
+        previous = used;
+        used += length;
+    }
+
+    if (used == 0)
+    {
+        return errno == 0 ? utils::posix::fail(ERROR_NO_MORE_FILES) : utils::posix::fail_errno();
+    }
+
+    return TRUE;
+}
+
+BOOL SetFileInformationByHandle(HANDLE handle, FILE_INFO_BY_HANDLE_CLASS type, LPVOID buffer, DWORD)
+{
+    auto file = utils::posix::cast<utils::posix::File>(handle);
+    if (file == nullptr)
+    {
+        return utils::posix::fail(ERROR_INVALID_HANDLE);
+    }
+
+    switch (type)
+    {
+    case FileEndOfFileInfo:
+        if (ftruncate(file->descriptor, static_cast<FILE_END_OF_FILE_INFO *>(buffer)->EndOfFile.QuadPart) != 0)
+        {
+            return utils::posix::fail_errno();
+        }
+
+        return TRUE;
+
+    case FileBasicInfo:
+    {
+        // A time of 0 (or -1) keeps the current value, the creation and change times cannot be set
+        auto &info = *static_cast<FILE_BASIC_INFO *>(buffer);
+        timespec times[2] = {{0, UTIME_OMIT}, {0, UTIME_OMIT}};
+        if (info.LastAccessTime.QuadPart > 0)
+        {
+            times[0] = utils::posix::from_filetime_ticks(info.LastAccessTime.QuadPart);
+        }
+
+        if (info.LastWriteTime.QuadPart > 0)
+        {
+            times[1] = utils::posix::from_filetime_ticks(info.LastWriteTime.QuadPart);
+        }
+
+        if (futimens(file->descriptor, times) != 0)
+        {
+            return utils::posix::fail_errno();
+        }
+
+        struct stat status;
+        if (info.FileAttributes != 0 && fstat(file->descriptor, &status) == 0)
+        {
+            auto mode = status.st_mode & 07777;
+            mode = (info.FileAttributes & FILE_ATTRIBUTE_READONLY) ? mode & ~(S_IWUSR | S_IWGRP | S_IWOTH) : mode | S_IWUSR;
+            if (mode != (status.st_mode & 07777) && fchmod(file->descriptor, mode) != 0)
+            {
+                return utils::posix::fail_errno();
+            }
+        }
+
+        return TRUE;
+    }
+
+    case FileDispositionInfo:
+        file->delete_on_close = static_cast<FILE_DISPOSITION_INFO *>(buffer)->DeleteFile;
+        return TRUE;
+
+    case FileDispositionInfoEx:
+    {
+        auto flags = static_cast<FILE_DISPOSITION_INFO_EX *>(buffer)->Flags;
+        if (!(flags & FILE_DISPOSITION_FLAG_POSIX_SEMANTICS))
+        {
+            file->delete_on_close = flags & FILE_DISPOSITION_FLAG_DELETE;
+            return TRUE;
+        }
+
+        // The name is removed right away, even if the file stays open
+        if ((flags & FILE_DISPOSITION_FLAG_DELETE) && std::remove(file->path.c_str()) != 0)
+        {
+            return utils::posix::fail_errno();
+        }
+
+        return TRUE;
+    }
+
+    default:
+        return utils::posix::fail(ERROR_INVALID_PARAMETER);
+    }
+}
+
+BOOL DeviceIoControl(HANDLE handle, DWORD code, LPVOID input, DWORD, LPVOID, DWORD, LPDWORD returned, LPOVERLAPPED)
+{
+    auto file = utils::posix::cast<utils::posix::File>(handle);
+    if (file == nullptr)
+    {
+        return utils::posix::fail(ERROR_INVALID_HANDLE);
+    }
+
+    if (returned != NULL)
+    {
+        *returned = 0;
+    }
+
+    switch (code)
+    {
+    case FSCTL_SET_SPARSE:
+        return TRUE; // Files are always sparse-capable
+
+    case FSCTL_DUPLICATE_EXTENTS_TO_FILE:
+    {
+        auto &extents = *static_cast<DUPLICATE_EXTENTS_DATA *>(input);
+        auto source = utils::posix::cast<utils::posix::File>(extents.FileHandle);
+        struct stat status;
+        if (source == nullptr || fstat(source->descriptor, &status) != 0)
+        {
+            return utils::posix::fail(ERROR_INVALID_HANDLE);
+        }
+
+        // The last region may extend past the end of the file on Windows, FICLONERANGE stops at the end
+        auto offset = extents.SourceFileOffset.QuadPart;
+        auto length = std::min<LONGLONG>(extents.ByteCount.QuadPart, std::max<LONGLONG>(0, status.st_size - offset));
+        if (length == 0)
+        {
+            return TRUE;
+        }
+
+        file_clone_range range;
+        range.src_fd = source->descriptor;
+        range.src_offset = offset;
+        range.src_length = offset + length == status.st_size ? 0 : length;
+        range.dest_offset = extents.TargetFileOffset.QuadPart;
+        if (ioctl(file->descriptor, FICLONERANGE, &range) != 0)
+        {
+            return utils::posix::fail_errno();
+        }
+
+        return TRUE;
+    }
+
+    default:
+        return utils::posix::fail(ERROR_INVALID_FUNCTION);
+    }
+}
+
+HANDLE CreateFileMappingW(HANDLE handle, LPSECURITY_ATTRIBUTES, DWORD protection, DWORD size_high, DWORD size_low, LPCWSTR)
+{
+    auto file = utils::posix::cast<utils::posix::File>(handle);
+    if (file == nullptr)
+    {
+        utils::posix::fail(ERROR_INVALID_HANDLE);
+        return NULL;
+    }
+
+    std::uint64_t size = static_cast<std::uint64_t>(size_high) << 32 | size_low;
+    if (size == 0)
+    {
+        struct stat status;
+        if (fstat(file->descriptor, &status) != 0)
+        {
+            utils::posix::fail_errno();
+            return NULL;
+        }
+
+        size = status.st_size;
+    }
+
+    // Like on Windows, an empty file cannot be mapped
+    if (size == 0)
+    {
+        utils::posix::fail(ERROR_FILE_INVALID);
+        return NULL;
+    }
+
+    auto descriptor = fcntl(file->descriptor, F_DUPFD_CLOEXEC, 0);
+    if (descriptor < 0)
+    {
+        utils::posix::fail_errno();
+        return NULL;
+    }
+
+    return new utils::posix::Mapping(descriptor, size, protection != PAGE_READONLY);
+}
+
+LPVOID MapViewOfFile(HANDLE handle, DWORD access, DWORD offset_high, DWORD offset_low, SIZE_T size)
+{
+    auto mapping = utils::posix::cast<utils::posix::Mapping>(handle);
+    if (mapping == nullptr)
+    {
+        utils::posix::fail(ERROR_INVALID_HANDLE);
+        return NULL;
+    }
+
+    std::uint64_t offset = static_cast<std::uint64_t>(offset_high) << 32 | offset_low;
+    if (offset >= mapping->size)
+    {
+        utils::posix::fail(ERROR_INVALID_PARAMETER);
+        return NULL;
+    }
+
+    std::size_t length = size == 0 ? mapping->size - offset : size;
+    auto protection = PROT_READ | (mapping->writable && (access & FILE_MAP_WRITE) ? PROT_WRITE : 0);
+    auto address = mmap(NULL, length, protection, MAP_SHARED, mapping->descriptor, offset);
+    if (address == MAP_FAILED)
+    {
+        utils::posix::fail_errno();
+        return NULL;
+    }
+
+    std::unique_lock<std::mutex> lock;
+    utils::posix::views(lock)[address] = length;
+    return address;
+}
+
+BOOL UnmapViewOfFile(LPCVOID address)
+{
+    std::unique_lock<std::mutex> lock;
+    auto &views = utils::posix::views(lock);
+    auto iter = views.find(address);
+    if (iter == views.end())
+    {
+        return utils::posix::fail(ERROR_INVALID_PARAMETER);
+    }
+
+    munmap(const_cast<void *>(address), iter->second);
+    views.erase(iter);
+    return TRUE;
+}
+
+HANDLE FindFirstFileExW(LPCWSTR pattern, FINDEX_INFO_LEVELS, LPVOID data, FINDEX_SEARCH_OPS, LPVOID, DWORD)
+{
+    auto path = utils::posix::native_path(pattern);
+    auto separator = path.find_last_of('/');
+    auto directory = separator == std::string::npos ? std::string(".") : (separator == 0 ? std::string("/") : path.substr(0, separator));
+    auto name = utils::posix::widen(separator == std::string::npos ? path : path.substr(separator + 1));
+
+    auto &result = *static_cast<WIN32_FIND_DATAW *>(data);
+    if (name.empty() || name.size() >= MAX_PATH)
+    {
+        utils::posix::fail(ERROR_FILE_NOT_FOUND);
+        return INVALID_HANDLE_VALUE;
+    }
+
+    // A name without wildcards is looked up directly, e.g. to test whether a file exists
+    if (name.find_first_of(L"*?") == std::wstring::npos)
+    {
+        if (!utils::posix::Search::fill(AT_FDCWD, path.c_str(), name, result))
+        {
+            utils::posix::fail_errno();
+            return INVALID_HANDLE_VALUE;
+        }
+
+        return new utils::posix::Search(-1, name);
+    }
+
+    auto descriptor = open(directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (descriptor < 0)
+    {
+        utils::posix::fail_errno();
+        return INVALID_HANDLE_VALUE;
+    }
+
+    // "*.*" matches the names without any dot too
+    auto search = new utils::posix::Search(descriptor, name == L"*.*" ? L"*" : name);
+    if (!search->next(result))
+    {
+        delete search;
+        utils::posix::fail(ERROR_FILE_NOT_FOUND);
+        return INVALID_HANDLE_VALUE;
+    }
+
+    return search;
+}
+
+BOOL FindNextFileW(HANDLE handle, LPWIN32_FIND_DATAW data)
+{
+    auto search = utils::posix::cast<utils::posix::Search>(handle);
+    if (search == nullptr)
+    {
+        return utils::posix::fail(ERROR_INVALID_HANDLE);
+    }
+
+    if (search->descriptor < 0 || !search->next(*data))
+    {
+        return utils::posix::fail(ERROR_NO_MORE_FILES);
+    }
+
+    return TRUE;
+}
+
+BOOL FindClose(HANDLE handle)
+{
+    return CloseHandle(handle);
+}
+
+HANDLE FindFirstChangeNotificationW(LPCWSTR path, BOOL subtree, DWORD filter)
+{
+    auto descriptor = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (descriptor < 0)
+    {
+        utils::posix::fail_errno();
+        return INVALID_HANDLE_VALUE;
+    }
+
+    auto notification = new utils::posix::ChangeNotification(descriptor);
+    if (!utils::posix::add_watches(descriptor, utils::posix::native_path(path), "", utils::posix::inotify_mask(filter), subtree, notification->directories))
+    {
+        auto error = errno;
+        delete notification;
+        utils::posix::fail(utils::posix::error_from_errno(error));
+        return INVALID_HANDLE_VALUE;
+    }
+
+    return notification;
+}
+
+BOOL FindNextChangeNotification(HANDLE handle)
+{
+    auto notification = utils::posix::cast<utils::posix::ChangeNotification>(handle);
+    if (notification == nullptr)
+    {
+        return utils::posix::fail(ERROR_INVALID_HANDLE);
+    }
+
+    // The queued events are discarded, the next one signals the notification again
+    alignas(inotify_event) char events[1 << 12];
+    while (read(notification->descriptor, events, sizeof(events)) > 0)
+    {
+    }
+
+    return TRUE;
+}
+
+BOOL FindCloseChangeNotification(HANDLE handle)
+{
+    return CloseHandle(handle);
+}
+
+DWORD GetFileAttributesW(LPCWSTR name)
+{
+    auto path = utils::posix::native_path(name);
+    auto metadata = utils::posix::query(AT_FDCWD, path.c_str(), utils::posix::basename(path));
+    if (!metadata.has_value())
+    {
+        utils::posix::fail_errno();
+        return INVALID_FILE_ATTRIBUTES;
+    }
+
+    return metadata->attributes;
+}
+
+BOOL GetFileAttributesExW(LPCWSTR name, GET_FILEEX_INFO_LEVELS, LPVOID buffer)
+{
+    auto path = utils::posix::native_path(name);
+    auto metadata = utils::posix::query(AT_FDCWD, path.c_str(), utils::posix::basename(path));
+    if (!metadata.has_value())
+    {
+        return utils::posix::fail_errno();
+    }
+
+    auto filetime = [](const LONGLONG ticks)
+    {
+        return FILETIME{static_cast<DWORD>(ticks & 0xFFFFFFFF), static_cast<DWORD>(static_cast<ULONGLONG>(ticks) >> 32)};
+    };
+
+    auto &data = *static_cast<WIN32_FILE_ATTRIBUTE_DATA *>(buffer);
+    data.dwFileAttributes = metadata->attributes;
+    data.ftCreationTime = filetime(metadata->creation_time);
+    data.ftLastAccessTime = filetime(metadata->last_access_time);
+    data.ftLastWriteTime = filetime(metadata->last_write_time);
+    data.nFileSizeHigh = static_cast<ULONGLONG>(metadata->size) >> 32;
+    data.nFileSizeLow = metadata->size & 0xFFFFFFFF;
+    return TRUE;
+}
+
+BOOL CreateDirectoryW(LPCWSTR name, LPSECURITY_ATTRIBUTES)
+{
+    if (mkdir(utils::posix::native_path(name).c_str(), 0777) != 0)
+    {
+        return errno == EEXIST ? utils::posix::fail(ERROR_ALREADY_EXISTS) : utils::posix::fail_errno();
+    }
+
+    return TRUE;
+}
+
+BOOL RemoveDirectoryW(LPCWSTR name)
+{
+    auto path = utils::posix::native_path(name);
+    if (rmdir(path.c_str()) != 0)
+    {
+        // A link to a directory is removed like a directory on Windows
+        struct stat status;
+        if (errno == ENOTDIR && lstat(path.c_str(), &status) == 0 && S_ISLNK(status.st_mode) && unlink(path.c_str()) == 0)
+        {
+            return TRUE;
+        }
+
+        return utils::posix::fail_errno();
+    }
+
+    return TRUE;
+}
+
+BOOL DeleteFileW(LPCWSTR name)
+{
+    if (unlink(utils::posix::native_path(name).c_str()) != 0)
+    {
+        return utils::posix::fail_errno();
+    }
+
+    return TRUE;
+}
+
+BOOL CopyFileExW(LPCWSTR from, LPCWSTR to, LPPROGRESS_ROUTINE progress, LPVOID data, LPBOOL cancel, DWORD flags)
+{
+    auto source_path = utils::posix::native_path(from), destination_path = utils::posix::native_path(to);
+
+    struct stat status;
+    if (lstat(source_path.c_str(), &status) != 0)
+    {
+        return utils::posix::fail_errno();
+    }
+
+    if (S_ISLNK(status.st_mode) && (flags & COPY_FILE_COPY_SYMLINK))
+    {
+        std::vector<char> target(PATH_MAX);
+        auto length = readlink(source_path.c_str(), target.data(), target.size());
+        if (length < 0)
+        {
+            return utils::posix::fail_errno();
+        }
+
+        if (!(flags & COPY_FILE_FAIL_IF_EXISTS))
+        {
+            unlink(destination_path.c_str());
+        }
+
+        if (symlink(std::string(target.data(), length).c_str(), destination_path.c_str()) != 0)
+        {
+            return utils::posix::fail_errno();
+        }
+
+        return TRUE;
+    }
+
+    auto source = open(source_path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (source < 0 || fstat(source, &status) != 0 || !S_ISREG(status.st_mode))
+    {
+        auto error = source < 0 || !S_ISREG(status.st_mode) ? errno : 0;
+        if (source >= 0)
+        {
+            close(source);
+        }
+
+        return S_ISDIR(status.st_mode) ? utils::posix::fail(ERROR_ACCESS_DENIED) : utils::posix::fail(utils::posix::error_from_errno(error));
+    }
+
+    auto destination = open(
+        destination_path.c_str(),
+        O_WRONLY | O_CREAT | O_CLOEXEC | ((flags & COPY_FILE_FAIL_IF_EXISTS) ? O_EXCL : O_TRUNC),
+        status.st_mode & 0777);
+    if (destination < 0)
+    {
+        auto error = errno;
+        close(source);
+        return utils::posix::fail(utils::posix::error_from_errno(error));
+    }
+
+    posix_fadvise(source, 0, 0, POSIX_FADV_SEQUENTIAL);
+    auto success = utils::posix::copy_data(source, destination, status.st_size, progress, data, cancel);
+    auto error = GetLastError();
+
+    // Like CopyFileExW, the copy keeps the permissions and the last write time of the source
+    if (success)
+    {
+        timespec times[2] = {status.st_atim, status.st_mtim};
+        fchmod(destination, status.st_mode & 07777);
+        futimens(destination, times);
+    }
+
+    close(destination);
+    close(source);
+    if (!success)
+    {
+        unlink(destination_path.c_str());
+        return utils::posix::fail(error);
+    }
+
+    return TRUE;
+}
+
+BOOL MoveFileExW(LPCWSTR from, LPCWSTR to, DWORD flags)
+{
+    auto source = utils::posix::native_path(from), destination = utils::posix::native_path(to);
+    if (flags & MOVEFILE_REPLACE_EXISTING)
+    {
+        if (rename(source.c_str(), destination.c_str()) != 0)
+        {
+            return utils::posix::fail_errno();
+        }
+
+        return TRUE;
+    }
+
+    if (renameat2(AT_FDCWD, source.c_str(), AT_FDCWD, destination.c_str(), RENAME_NOREPLACE) != 0)
+    {
+        if (errno != EINVAL)
+        {
+            return errno == EEXIST ? utils::posix::fail(ERROR_ALREADY_EXISTS) : utils::posix::fail_errno();
+        }
+
+        // The file system does not support RENAME_NOREPLACE
+        struct stat status;
+        if (lstat(destination.c_str(), &status) == 0)
+        {
+            return utils::posix::fail(ERROR_ALREADY_EXISTS);
+        }
+
+        if (rename(source.c_str(), destination.c_str()) != 0)
+        {
+            return utils::posix::fail_errno();
+        }
+    }
+
+    return TRUE;
+}
+
+BOOL MoveFileW(LPCWSTR from, LPCWSTR to)
+{
+    if (MoveFileExW(from, to, 0))
+    {
+        return TRUE;
+    }
+
+    // Like MoveFileW, a file (but not a directory) is moved to another volume by copying it
+    struct stat status;
+    if (GetLastError() == ERROR_NOT_SAME_DEVICE && lstat(utils::posix::native_path(from).c_str(), &status) == 0 && !S_ISDIR(status.st_mode))
+    {
+        if (CopyFileExW(from, to, NULL, NULL, NULL, COPY_FILE_FAIL_IF_EXISTS | COPY_FILE_COPY_SYMLINK))
+        {
+            return DeleteFileW(from);
+        }
+    }
+
+    return FALSE;
+}
+
+DWORD GetFullPathNameW(LPCWSTR name, DWORD size, LPWSTR buffer, LPWSTR *file_part)
+{
+    auto path = utils::posix::widen(utils::posix::absolute_path(utils::posix::native_path(name)));
+    auto result = utils::posix::copy_out(path, buffer, size);
+    if (file_part != NULL && result < size)
+    {
+        auto separator = path.find_last_of(L'/');
+        *file_part = separator + 1 < path.size() ? buffer + separator + 1 : NULL;
+    }
+
+    return result;
+}
+
+DWORD GetCurrentDirectoryW(DWORD size, LPWSTR buffer)
+{
+    char path[PATH_MAX];
+    if (getcwd(path, sizeof(path)) == NULL)
+    {
+        utils::posix::fail_errno();
+        return 0;
+    }
+
+    return utils::posix::copy_out(utils::posix::widen(path), buffer, size);
+}
+
+BOOL SetCurrentDirectoryW(LPCWSTR name)
+{
+    if (chdir(utils::posix::native_path(name).c_str()) != 0)
+    {
+        return errno == ENOENT ? utils::posix::fail(ERROR_PATH_NOT_FOUND) : utils::posix::fail_errno();
+    }
+
+    return TRUE;
+}
+
+DWORD GetTempPathW(DWORD size, LPWSTR buffer)
+{
+    auto directory = std::getenv("TMPDIR");
+    std::string path = directory != NULL && directory[0] != '\0' ? directory : "/tmp";
+    if (path.back() != '/')
+    {
+        path += '/';
+    }
+
+    return utils::posix::copy_out(utils::posix::widen(path), buffer, size);
+}
+
+UINT GetTempFileNameW(LPCWSTR directory, LPCWSTR prefix, UINT unique, LPWSTR buffer)
+{
+    auto base = utils::posix::native_path(directory);
+    if (!base.empty() && base.back() != '/')
+    {
+        base += '/';
+    }
+
+    base += utils::posix::narrow(std::wstring_view(prefix).substr(0, 3));
+
+    // Like on Windows, a unique number of 0 creates an empty file with a name which was not used yet
+    static std::atomic<UINT> counter{static_cast<UINT>(getpid() ^ time(NULL))};
+    for (int attempt = 0; attempt < 0x10000; attempt++)
+    {
+        auto number = unique != 0 ? unique : (counter++ & 0xFFFF);
+        char suffix[16];
+        std::snprintf(suffix, sizeof(suffix), "%X.tmp", number);
+        auto path = base + suffix;
+        if (unique == 0)
+        {
+            auto descriptor = open(path.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+            if (descriptor < 0)
+            {
+                if (errno == EEXIST)
+                {
+                    continue;
+                }
+
+                utils::posix::fail_errno();
+                return 0;
+            }
+
+            close(descriptor);
+        }
+
+        if (utils::posix::copy_out(utils::posix::widen(path), buffer, MAX_PATH) >= MAX_PATH)
+        {
+            utils::posix::fail(ERROR_FILENAME_EXCED_RANGE);
+            return 0;
+        }
+
+        number = number == 0 ? 1 : number;
+        return number;
+    }
+
+    utils::posix::fail(ERROR_FILE_EXISTS);
+    return 0;
+}
+
+HRESULT PathCchCombine(PWSTR buffer, size_t size, PCWSTR first, PCWSTR second)
+{
+    auto head = first == NULL ? std::string() : utils::posix::native_path(first),
+         tail = second == NULL ? std::string() : utils::posix::native_path(second);
+
+    // Like on Windows, the second path replaces the first one if it is absolute
+    auto combined = head.empty() || (!tail.empty() && tail[0] == '/') ? tail : (tail.empty() ? head : head + "/" + tail);
+    auto result = utils::posix::widen(combined.empty() ? combined : utils::posix::normalize(combined));
+    if (result.size() >= size)
+    {
+        return E_NOT_SUFFICIENT_BUFFER;
+    }
+
+    utils::posix::copy_out(result, buffer, size);
+    return S_OK;
+}
+
+BOOL GetVolumePathNameW(LPCWSTR name, LPWSTR buffer, DWORD size)
+{
+    // The mount point is the last ancestor on the same device
+    auto path = utils::posix::absolute_path(utils::posix::native_path(name));
+    struct stat status;
+    while (stat(path.c_str(), &status) != 0 && path != "/")
+    {
+        path = utils::posix::normalize(path + "/..");
+    }
+
+    while (path != "/")
+    {
+        auto parent = utils::posix::normalize(path + "/..");
+        struct stat parent_status;
+        if (stat(parent.c_str(), &parent_status) != 0 || parent_status.st_dev != status.st_dev)
+        {
+            break;
+        }
+
+        path = parent;
+    }
+
+    if (path.back() != '/')
+    {
+        path += '/';
+    }
+
+    if (utils::posix::copy_out(utils::posix::widen(path), buffer, size) >= size)
+    {
+        return utils::posix::fail(ERROR_FILENAME_EXCED_RANGE);
+    }
+
+    return TRUE;
+}
+
+BOOL GetVolumeInformationW(
+    LPCWSTR root,
+    LPWSTR volume_name, DWORD volume_name_size,
+    LPDWORD serial_number, LPDWORD maximum_component_length, LPDWORD file_system_flags,
+    LPWSTR file_system_name, DWORD file_system_name_size)
+{
+    struct statfs status;
+    if (statfs(utils::posix::native_path(root).c_str(), &status) != 0)
+    {
+        return utils::posix::fail_errno();
+    }
+
+    // The magic numbers of <linux/magic.h>, block cloning is supported by Btrfs and XFS
+    const char *name = "unknown";
+    DWORD flags = FILE_CASE_SENSITIVE_SEARCH | FILE_CASE_PRESERVED_NAMES | FILE_SUPPORTS_SPARSE_FILES |
+                  FILE_SUPPORTS_REPARSE_POINTS | FILE_SUPPORTS_POSIX_UNLINK_RENAME;
+    switch (static_cast<std::uint32_t>(status.f_type))
+    {
+    case 0xEF53:
+        name = "ext4";
+        break;
+    case 0x9123683E:
+        name = "btrfs";
+        flags |= FILE_SUPPORTS_BLOCK_REFCOUNTING | FILE_FILE_COMPRESSION;
+        break;
+    case 0x58465342:
+        name = "xfs";
+        flags |= FILE_SUPPORTS_BLOCK_REFCOUNTING;
+        break;
+    case 0x01021994:
+        name = "tmpfs";
+        break;
+    case 0x794C7630:
+        name = "overlay";
+        break;
+    case 0x6969:
+        name = "nfs";
+        flags |= FILE_SUPPORTS_REMOTE_STORAGE;
+        break;
+    case 0x4D44:
+        name = "vfat";
+        flags &= ~(FILE_CASE_SENSITIVE_SEARCH | FILE_SUPPORTS_REPARSE_POINTS | FILE_SUPPORTS_SPARSE_FILES);
+        break;
+    }
+
+    if (status.f_flags & ST_RDONLY)
+    {
+        flags |= FILE_READ_ONLY_VOLUME;
+    }
+
+    if (volume_name != NULL && volume_name_size > 0)
+    {
+        volume_name[0] = L'\0';
+    }
+
+    if (serial_number != NULL)
+    {
+        int fsid[2];
+        std::memcpy(fsid, &status.f_fsid, sizeof(fsid));
+        *serial_number = static_cast<DWORD>(fsid[0] ^ fsid[1]) & 0xFFFFFFFF;
+    }
+
+    if (maximum_component_length != NULL)
+    {
+        *maximum_component_length = status.f_namelen;
+    }
+
+    if (file_system_flags != NULL)
+    {
+        *file_system_flags = flags;
+    }
+
+    if (file_system_name != NULL && utils::posix::copy_out(utils::posix::widen(name), file_system_name, file_system_name_size) >= file_system_name_size)
+    {
+        return utils::posix::fail(ERROR_MORE_DATA);
+    }
+
+    return TRUE;
+}
+
+BOOL GetDiskFreeSpaceW(LPCWSTR root, LPDWORD sectors_per_cluster, LPDWORD bytes_per_sector, LPDWORD free_clusters, LPDWORD total_clusters)
+{
+    struct statvfs status;
+    if (statvfs(utils::posix::native_path(root).c_str(), &status) != 0)
+    {
+        return utils::posix::fail_errno();
+    }
+
+    // A cluster is a fragment of the file system, made of 512-byte sectors when possible
+    auto sector = status.f_frsize % 512 == 0 ? 512 : status.f_frsize;
+    *sectors_per_cluster = status.f_frsize / sector;
+    *bytes_per_sector = sector;
+    *free_clusters = status.f_bavail;
+    *total_clusters = status.f_blocks;
+    return TRUE;
+}
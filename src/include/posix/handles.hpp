@@ -0,0 +1,512 @@
+#pragma once
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+#include <poll.h>
+#include <signal.h>
+
+#include "types.hpp"
+
+namespace utils::posix
+{
+    typedef std::chrono::steady_clock clock;
+
+    /**
+     * @brief The base class of the kernel objects of the POSIX platform layer, a `HANDLE` points to one of them.
+     *
+     * Waits are emulated with a single mutex and condition variable shared by all objects: an object changing to
+     * the signaled state notifies every waiter, which then checks its own objects again. Objects whose state is
+     * owned by the kernel (e.g. an inotify descriptor) cannot notify anyone, they are polled while waited on.
+     */
+    class Object
+    {
+    public:
+        virtual ~Object() = default;
+
+        /** @brief Whether the object is signaled, called with `wait_mutex()` held */
+        virtual bool signaled()
+        {
+            return false;
+        }
+
+        /** @brief Consume the signaled state after a successful wait, e.g. reset an auto-reset event */
+        virtual void acquire() {}
+
+        /** @brief The time the object becomes signaled by itself, e.g. the due time of a timer */
+        virtual std::optional<clock::time_point> due() const
+        {
+            return std::nullopt;
+        }
+
+        /** @brief Whether the state of the object changes without any notification, so waits must poll it */
+        virtual bool polled() const
+        {
+            return false;
+        }
+
+        /** @brief Whether `CloseHandle` must keep the object alive, e.g. pseudo handles and standard handles */
+        virtual bool permanent() const
+        {
+            return false;
+        }
+    };
+
+    /** @brief The mutex protecting the state of all waitable objects */
+    std::mutex &wait_mutex()
+    {
+        static std::mutex mutex;
+        return mutex;
+    }
+
+    /** @brief The condition variable notified whenever a waitable object may have become signaled */
+    std::condition_variable &wait_condition()
+    {
+        static std::condition_variable condition;
+        return condition;
+    }
+
+    /** @brief Wake up all waits after the state of an object changed, which must be done with `wait_mutex()` held */
+    void notify_waiters()
+    {
+        wait_condition().notify_all();
+    }
+
+    /** @brief The error code of the last failed call on the calling thread, see `GetLastError` */
+    DWORD &last_error()
+    {
+        static thread_local DWORD error = ERROR_SUCCESS;
+        return error;
+    }
+
+    /** @brief The closest Win32 error code of an `errno` value */
+    DWORD error_from_errno(const int error)
+    {
+        switch (error)
+        {
+        case 0:
+            return ERROR_SUCCESS;
+        case ENOENT:
+            return ERROR_FILE_NOT_FOUND;
+        case ENOTDIR:
+            return ERROR_PATH_NOT_FOUND;
+        case EACCES:
+        case EPERM:
+        case EROFS:
+        case EISDIR:
+            return ERROR_ACCESS_DENIED;
+        case EBADF:
+            return ERROR_INVALID_HANDLE;
+        case ENOMEM:
+            return ERROR_NOT_ENOUGH_MEMORY;
+        case EXDEV:
+            return ERROR_NOT_SAME_DEVICE;
+        case EEXIST:
+            return ERROR_FILE_EXISTS;
+        case EINVAL:
+        case ESRCH:
+            return ERROR_INVALID_PARAMETER;
+        case EPIPE:
+            return ERROR_BROKEN_PIPE;
+        case ENOSPC:
+        case EDQUOT:
+            return ERROR_DISK_FULL;
+        case ENOTEMPTY:
+            return ERROR_DIR_NOT_EMPTY;
+        case EBUSY:
+        case ETXTBSY:
+            return ERROR_BUSY;
+        case ENOEXEC:
+            return ERROR_BAD_EXE_FORMAT;
+        case ENAMETOOLONG:
+            return ERROR_FILENAME_EXCED_RANGE;
+        case ELOOP:
+            return ERROR_CANT_RESOLVE_FILENAME;
+        case ECANCELED:
+            return ERROR_OPERATION_ABORTED;
+        case ENOSYS:
+        case ENOTTY:
+        case EOPNOTSUPP:
+            return ERROR_NOT_SUPPORTED;
+        default:
+            return ERROR_GEN_FAILURE;
+        }
+    }
+
+    /** @brief Record an error and return `FALSE`, the usual failure of a Win32 function */
+    BOOL fail(const DWORD error)
+    {
+        last_error() = error;
+        return FALSE;
+    }
+
+    /** @brief Record the error of the last failed system call and return `FALSE` */
+    BOOL fail_errno()
+    {
+        return fail(error_from_errno(errno));
+    }
+
+    /** @brief The object a handle points to if it has the expected type, or `nullptr` */
+    template <typename T>
+    T *cast(const HANDLE handle)
+    {
+        if (handle == NULL || handle == INVALID_HANDLE_VALUE)
+        {
+            return nullptr;
+        }
+
+        return dynamic_cast<T *>(static_cast<Object *>(handle));
+    }
+
+    /** @brief An event object, see `CreateEventW` */
+    class Event : public Object
+    {
+    public:
+        const bool manual_reset;
+        bool state;
+
+        Event(const bool manual_reset, const bool state) : manual_reset(manual_reset), state(state) {}
+
+        bool signaled() override
+        {
+            return state;
+        }
+
+        void acquire() override
+        {
+            if (!manual_reset)
+            {
+                state = false;
+            }
+        }
+
+        /** @brief Change the state of the event, waking up its waiters when it becomes signaled */
+        void set(const bool value)
+        {
+            std::lock_guard<std::mutex> lock(wait_mutex());
+            state = value;
+            if (value)
+            {
+                notify_waiters();
+            }
+        }
+    };
+
+    /** @brief A waitable timer, see `CreateWaitableTimerW` */
+    class Timer : public Object
+    {
+    public:
+        const bool manual_reset;
+        bool state = false;
+        std::optional<clock::time_point> due_time;
+
+        explicit Timer(const bool manual_reset) : manual_reset(manual_reset) {}
+
+        bool signaled() override
+        {
+            if (due_time.has_value() && clock::now() >= *due_time)
+            {
+                state = true;
+                due_time.reset();
+            }
+
+            return state;
+        }
+
+        void acquire() override
+        {
+            if (!manual_reset)
+            {
+                state = false;
+            }
+        }
+
+        std::optional<clock::time_point> due() const override
+        {
+            return due_time;
+        }
+    };
+
+    /** @brief A wait registered by `RegisterWaitForSingleObject`, whose callback runs on a thread of its own */
+    class RegisteredWait : public Object
+    {
+    public:
+        /** @brief Signaled to stop waiting, shared with the thread since the thread may outlive this object */
+        const std::shared_ptr<Event> cancel = std::make_shared<Event>(true, false);
+        std::thread thread;
+    };
+
+    /**
+     * @brief Wait until one or all of the objects are signaled, see `WaitForMultipleObjects`
+     *
+     * @param objects The objects to wait for
+     * @param all Whether to wait until all objects are signaled at the same time
+     * @param timeout The timeout in milliseconds, or `INFINITE`
+     * @return The index of the signaled object (0 if `all` is set), `WAIT_TIMEOUT` or `WAIT_FAILED`
+     */
+    DWORD wait(const std::vector<Object *> &objects, const bool all, const DWORD timeout)
+    {
+        // Polled objects are checked at this interval while waited on
+        const auto interval = std::chrono::milliseconds(10);
+
+        std::optional<clock::time_point> deadline;
+        if (timeout != INFINITE)
+        {
+            deadline = clock::now() + std::chrono::milliseconds(timeout);
+        }
+
+        std::unique_lock<std::mutex> lock(wait_mutex());
+        while (true)
+        {
+            if (all)
+            {
+                if (std::all_of(objects.begin(), objects.end(), [](Object *object)
+                                { return object->signaled(); }))
+                {
+                    for (auto object : objects)
+                    {
+                        object->acquire();
+                    }
+
+                    return WAIT_OBJECT_0;
+                }
+            }
+            else
+            {
+                for (std::size_t i = 0; i < objects.size(); i++)
+                {
+                    if (objects[i]->signaled())
+                    {
+                        objects[i]->acquire();
+                        return WAIT_OBJECT_0 + i;
+                    }
+                }
+            }
+
+            auto now = clock::now();
+            if (deadline.has_value() && now >= *deadline)
+            {
+                return WAIT_TIMEOUT;
+            }
+
+            auto wake = deadline;
+            for (auto object : objects)
+            {
+                auto due = object->polled() ? std::make_optional(now + interval) : object->due();
+                if (due.has_value() && (!wake.has_value() || *due < *wake))
+                {
+                    wake = due;
+                }
+            }
+
+            if (wake.has_value())
+            {
+                wait_condition().wait_until(lock, *wake);
+            }
+            else
+            {
+                wait_condition().wait(lock);
+            }
+        }
+    }
+
+    /** @brief Whether a file descriptor is readable without blocking, e.g. the pending events of an inotify descriptor */
+    bool readable(const int descriptor)
+    {
+        pollfd entry = {descriptor, POLLIN, 0};
+        return poll(&entry, 1, 0) > 0;
+    }
+
+    /** @brief Convert a FILETIME count of 100-nanosecond intervals since 1601 to a point of the system clock */
+    std::chrono::system_clock::time_point from_ticks(const LONGLONG ticks)
+    {
+        // The number of 100-nanosecond intervals between 1601-01-01 and 1970-01-01
+        const LONGLONG epoch = 116444736000000000LL;
+        return std::chrono::system_clock::time_point(
+            std::chrono::duration_cast<std::chrono::system_clock::duration>(std::chrono::nanoseconds((ticks - epoch) * 100)));
+    }
+}
+
+DWORD GetLastError()
+{
+    return utils::posix::last_error();
+}
+
+void SetLastError(const DWORD error)
+{
+    utils::posix::last_error() = error;
+}
+
+BOOL CloseHandle(HANDLE handle)
+{
+    auto object = utils::posix::cast<utils::posix::Object>(handle);
+    if (object == nullptr)
+    {
+        return utils::posix::fail(ERROR_INVALID_HANDLE);
+    }
+
+    if (!object->permanent())
+    {
+        delete object;
+    }
+
+    return TRUE;
+}
+
+DWORD WaitForMultipleObjects(DWORD count, const HANDLE *handles, BOOL wait_all, DWORD milliseconds)
+{
+    if (count == 0 || count > MAXIMUM_WAIT_OBJECTS)
+    {
+        utils::posix::fail(ERROR_INVALID_PARAMETER);
+        return WAIT_FAILED;
+    }
+
+    std::vector<utils::posix::Object *> objects(count);
+    for (DWORD i = 0; i < count; i++)
+    {
+        objects[i] = utils::posix::cast<utils::posix::Object>(handles[i]);
+        if (objects[i] == nullptr)
+        {
+            utils::posix::fail(ERROR_INVALID_HANDLE);
+            return WAIT_FAILED;
+        }
+    }
+
+    return utils::posix::wait(objects, wait_all, milliseconds);
+}
+
+DWORD WaitForSingleObject(HANDLE handle, DWORD milliseconds)
+{
+    return WaitForMultipleObjects(1, &handle, FALSE, milliseconds);
+}
+
+void Sleep(DWORD milliseconds)
+{
+    std::this_thread::sleep_for(std::chrono::milliseconds(milliseconds));
+}
+
+HANDLE CreateEventW(LPSECURITY_ATTRIBUTES, BOOL manual_reset, BOOL initial_state, LPCWSTR)
+{
+    return new utils::posix::Event(manual_reset, initial_state);
+}
+
+BOOL SetEvent(HANDLE handle)
+{
+    auto event = utils::posix::cast<utils::posix::Event>(handle);
+    if (event == nullptr)
+    {
+        return utils::posix::fail(ERROR_INVALID_HANDLE);
+    }
+
+    event->set(true);
+    return TRUE;
+}
+
+BOOL ResetEvent(HANDLE handle)
+{
+    auto event = utils::posix::cast<utils::posix::Event>(handle);
+    if (event == nullptr)
+    {
+        return utils::posix::fail(ERROR_INVALID_HANDLE);
+    }
+
+    event->set(false);
+    return TRUE;
+}
+
+HANDLE CreateWaitableTimerExW(LPSECURITY_ATTRIBUTES, LPCWSTR, DWORD flags, DWORD)
+{
+    // Timers are always high-resolution, they only depend on the steady clock
+    return new utils::posix::Timer(flags & CREATE_WAITABLE_TIMER_MANUAL_RESET);
+}
+
+HANDLE CreateWaitableTimerW(LPSECURITY_ATTRIBUTES, BOOL manual_reset, LPCWSTR)
+{
+    return new utils::posix::Timer(manual_reset);
+}
+
+BOOL SetWaitableTimer(HANDLE handle, const LARGE_INTEGER *due, LONG period, void *, LPVOID, BOOL)
+{
+    auto timer = utils::posix::cast<utils::posix::Timer>(handle);
+    if (timer == nullptr)
+    {
+        return utils::posix::fail(ERROR_INVALID_HANDLE);
+    }
+
+    if (period != 0)
+    {
+        return utils::posix::fail(ERROR_NOT_SUPPORTED);
+    }
+
+    // A negative due time is relative in 100-nanosecond intervals, a positive one is an absolute FILETIME
+    auto now = utils::posix::clock::now();
+    auto when = due->QuadPart < 0
+                    ? now + std::chrono::duration_cast<utils::posix::clock::duration>(std::chrono::nanoseconds(-due->QuadPart * 100))
+                    : now + std::chrono::duration_cast<utils::posix::clock::duration>(utils::posix::from_ticks(due->QuadPart) - std::chrono::system_clock::now());
+
+    std::lock_guard<std::mutex> lock(utils::posix::wait_mutex());
+    timer->state = false;
+    timer->due_time = when;
+    utils::posix::notify_waiters(); // The waiters must sleep until the new due time
+    return TRUE;
+}
+
+BOOL RegisterWaitForSingleObject(PHANDLE result, HANDLE handle, WAITORTIMERCALLBACK callback, PVOID context, ULONG milliseconds, ULONG flags)
+{
+    auto object = utils::posix::cast<utils::posix::Object>(handle);
+    if (object == nullptr)
+    {
+        return utils::posix::fail(ERROR_INVALID_HANDLE);
+    }
+
+    auto wait = new utils::posix::RegisteredWait();
+    wait->thread = std::thread(
+        [object, callback, context, milliseconds, flags, cancel = wait->cancel]()
+        {
+            std::vector<utils::posix::Object *> objects = {object, cancel.get()};
+            do
+            {
+                auto result = utils::posix::wait(objects, false, milliseconds);
+                if (result != WAIT_OBJECT_0 && result != WAIT_TIMEOUT)
+                {
+                    break;
+                }
+
+                callback(context, result == WAIT_TIMEOUT);
+            } while (!(flags & WT_EXECUTEONLYONCE));
+        });
+
+    *result = wait;
+    return TRUE;
+}
+
+BOOL UnregisterWaitEx(HANDLE handle, HANDLE completion)
+{
+    auto wait = utils::posix::cast<utils::posix::RegisteredWait>(handle);
+    if (wait == nullptr)
+    {
+        return utils::posix::fail(ERROR_INVALID_HANDLE);
+    }
+
+    wait->cancel->set(true);
+
+    // INVALID_HANDLE_VALUE waits for a running callback, unless it is the caller
+    if (completion == INVALID_HANDLE_VALUE && wait->thread.get_id() != std::this_thread::get_id())
+    {
+        wait->thread.join();
+    }
+    else
+    {
+        wait->thread.detach();
+    }
+
+    delete wait;
+    return TRUE;
+}
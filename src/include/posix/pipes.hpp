@@ -0,0 +1,97 @@
+#pragma once
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "files.hpp"
+
+/**
+ * Anonymous pipes are POSIX pipes. Named pipes have no POSIX equivalent which can carry the handles of a requester,
+ * so the functions serving and connecting to a shell server always fail with `ERROR_NOT_SUPPORTED`, and so do the
+ * functions building the security descriptor of the pipe of a server.
+ */
+
+BOOL CreatePipe(PHANDLE read_handle, PHANDLE write_handle, LPSECURITY_ATTRIBUTES, DWORD size)
+{
+    int descriptors[2];
+    if (pipe2(descriptors, O_CLOEXEC) != 0)
+    {
+        return utils::posix::fail_errno();
+    }
+
+    if (size > 0)
+    {
+        fcntl(descriptors[1], F_SETPIPE_SZ, static_cast<int>(size)); // A hint, like on Windows
+    }
+
+    *read_handle = new utils::posix::File(descriptors[0], "");
+    *write_handle = new utils::posix::File(descriptors[1], "");
+    return TRUE;
+}
+
+/** Descriptors are duplicated onto the standard descriptors of a subprocess, only those are inherited */
+BOOL SetHandleInformation(HANDLE handle, DWORD, DWORD)
+{
+    if (utils::posix::cast<utils::posix::File>(handle) == nullptr)
+    {
+        return utils::posix::fail(ERROR_INVALID_HANDLE);
+    }
+
+    return TRUE;
+}
+
+HANDLE CreateNamedPipeW(LPCWSTR, DWORD, DWORD, DWORD, DWORD, DWORD, DWORD, LPSECURITY_ATTRIBUTES)
+{
+    utils::posix::fail(ERROR_NOT_SUPPORTED);
+    return INVALID_HANDLE_VALUE;
+}
+
+BOOL ConnectNamedPipe(HANDLE, LPOVERLAPPED)
+{
+    return utils::posix::fail(ERROR_NOT_SUPPORTED);
+}
+
+BOOL DisconnectNamedPipe(HANDLE)
+{
+    return utils::posix::fail(ERROR_NOT_SUPPORTED);
+}
+
+BOOL WaitNamedPipeW(LPCWSTR, DWORD)
+{
+    return utils::posix::fail(ERROR_NOT_SUPPORTED);
+}
+
+BOOL SetNamedPipeHandleState(HANDLE, LPDWORD, LPDWORD, LPDWORD)
+{
+    return utils::posix::fail(ERROR_NOT_SUPPORTED);
+}
+
+BOOL GetNamedPipeClientProcessId(HANDLE, PULONG)
+{
+    return utils::posix::fail(ERROR_NOT_SUPPORTED);
+}
+
+BOOL OpenProcessToken(HANDLE, DWORD, PHANDLE)
+{
+    return utils::posix::fail(ERROR_NOT_SUPPORTED);
+}
+
+BOOL GetTokenInformation(HANDLE, TOKEN_INFORMATION_CLASS, LPVOID, DWORD, LPDWORD)
+{
+    return utils::posix::fail(ERROR_NOT_SUPPORTED);
+}
+
+BOOL ConvertSidToStringSidW(PSID, LPWSTR *)
+{
+    return utils::posix::fail(ERROR_NOT_SUPPORTED);
+}
+
+BOOL ConvertStringSecurityDescriptorToSecurityDescriptorW(LPCWSTR, DWORD, PSECURITY_DESCRIPTOR *, PULONG)
+{
+    return utils::posix::fail(ERROR_NOT_SUPPORTED);
+}
+
+HLOCAL LocalFree(HLOCAL)
+{
+    return NULL;
+}
@@ -0,0 +1,1331 @@
+#pragma once
+
+#include <atomic>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <spawn.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "files.hpp"
+
+extern char **environ;
+
+namespace utils::posix
+{
+    /** @brief The state of a subprocess shared by its handles, its job objects and its reaper thread */
+    struct ProcessState
+    {
+        pid_t pid = 0;
+
+        /** @brief Protected by `wait_mutex()`, like every field below */
+        bool exited = false;
+        DWORD exit_code = STILL_ACTIVE;
+
+        /** @brief The exit code given to `TerminateProcess`, which takes precedence over the signal */
+        std::optional<DWORD> terminated;
+
+        /** @brief The suspend count, and whether the process was actually stopped with `SIGSTOP` */
+        DWORD suspended = 0;
+        bool stopped = false;
+
+        /**
+         * @brief The socket on which a process created suspended waits before calling `execve`, or -1 once it was
+         * released by `ResumeThread`
+         */
+        int gate = -1;
+
+        /** @brief The address space limit the process applies to itself before `execve`, 0 for none */
+        SIZE_T memory_limit = 0;
+
+        LONGLONG creation_time = 0, exit_time = 0;
+
+        /** @brief The resources used by the process and its waited-for descendants, only valid once it exited */
+        rusage usage = {};
+        IO_COUNTERS io = {};
+    };
+
+    /** @brief The current time as a FILETIME count */
+    LONGLONG now_ticks()
+    {
+        timespec now;
+        clock_gettime(CLOCK_REALTIME, &now);
+        return to_ticks(now);
+    }
+
+    /** @brief A `timeval` of `rusage` as a FILETIME duration */
+    LONGLONG duration_ticks(const timeval &value)
+    {
+        return static_cast<LONGLONG>(value.tv_sec) * 10000000LL + value.tv_usec * 10;
+    }
+
+    /** @brief The I/O counters of a process, from `/proc/<pid>/io` */
+    std::optional<IO_COUNTERS> read_io(const std::string &pid)
+    {
+        std::ifstream stream("/proc/" + pid + "/io");
+        if (!stream)
+        {
+            return std::nullopt;
+        }
+
+        IO_COUNTERS counters = {};
+        std::string key;
+        ULONGLONG value;
+        while (stream >> key >> value)
+        {
+            if (key == "rchar:")
+            {
+                counters.ReadTransferCount = value;
+            }
+            else if (key == "wchar:")
+            {
+                counters.WriteTransferCount = value;
+            }
+            else if (key == "syscr:")
+            {
+                counters.ReadOperationCount = value;
+            }
+            else if (key == "syscw:")
+            {
+                counters.WriteOperationCount = value;
+            }
+        }
+
+        return counters;
+    }
+
+    /**
+     * @brief The fields of `/proc/<pid>/stat` after the command name, so that field `n` of proc(5) is at index
+     * `n - 3`
+     */
+    std::vector<std::string> read_stat(const std::string &pid)
+    {
+        std::ifstream stream("/proc/" + pid + "/stat");
+        std::string content((std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>());
+
+        // The command name is parenthesized and may contain spaces
+        std::vector<std::string> fields;
+        auto end = content.rfind(')');
+        if (end != std::string::npos)
+        {
+            std::istringstream rest(content.substr(end + 1));
+            std::string field;
+            while (rest >> field)
+            {
+                fields.push_back(field);
+            }
+        }
+
+        return fields;
+    }
+
+    /** @brief A value in kB of `/proc/<pid>/status`, e.g. `VmHWM`, in bytes */
+    SIZE_T read_status(const std::string &pid, const std::string &name)
+    {
+        std::ifstream stream("/proc/" + pid + "/status");
+        std::string line;
+        while (std::getline(stream, line))
+        {
+            if (line.compare(0, name.size() + 1, name + ":") == 0)
+            {
+                return std::strtoull(line.c_str() + name.size() + 1, nullptr, 10) * 1024;
+            }
+        }
+
+        return 0;
+    }
+
+    /** @brief The user and kernel times of a running process, from `/proc/<pid>/stat` */
+    std::pair<LONGLONG, LONGLONG> read_times(const std::string &pid)
+    {
+        auto fields = read_stat(pid);
+        if (fields.size() < 13)
+        {
+            return {0, 0};
+        }
+
+        static const auto ticks_per_second = sysconf(_SC_CLK_TCK);
+        return {std::stoll(fields[11]) * 10000000LL / ticks_per_second, std::stoll(fields[12]) * 10000000LL / ticks_per_second};
+    }
+
+    /** @brief A process started by `CreateProcessW`, or opened by `OpenProcess` */
+    class Process : public Object
+    {
+    public:
+        const std::shared_ptr<ProcessState> state;
+
+        explicit Process(const std::shared_ptr<ProcessState> &state) : state(state) {}
+
+        bool signaled() override
+        {
+            return state->exited;
+        }
+    };
+
+    /** @brief The primary thread of a process, whose handle is only used to suspend and resume the process */
+    class Thread : public Process
+    {
+    public:
+        using Process::Process;
+    };
+
+    /** @brief A process which is not a child of the shell, whose exit is polled through a pidfd */
+    class ForeignProcess : public Object
+    {
+    public:
+        const pid_t pid;
+        const int descriptor;
+
+        ForeignProcess(const pid_t pid, const int descriptor) : pid(pid), descriptor(descriptor) {}
+
+        ~ForeignProcess()
+        {
+            close(descriptor);
+        }
+
+        bool signaled() override
+        {
+            return readable(descriptor);
+        }
+
+        bool polled() const override
+        {
+            return true;
+        }
+    };
+
+    /** @brief The pseudo handle of the current process, see `GetCurrentProcess` */
+    class CurrentProcess : public Object
+    {
+    public:
+        bool permanent() const override
+        {
+            return true;
+        }
+    };
+
+    /** @brief The states of the subprocesses still referenced by a handle, so that `OpenProcess` can find them */
+    std::unordered_map<pid_t, std::weak_ptr<ProcessState>> &processes(std::unique_lock<std::mutex> &lock)
+    {
+        static std::mutex mutex;
+        static std::unordered_map<pid_t, std::weak_ptr<ProcessState>> states;
+        lock = std::unique_lock<std::mutex>(mutex);
+        return states;
+    }
+
+    /**
+     * @brief Wait for the exit of a subprocess on a thread of its own, like the wait thread of Windows
+     *
+     * The I/O counters are read while the process is a zombie, then it is reaped with `wait4`, which reports the
+     * resources used by the process and by the descendants it waited for.
+     */
+    void reap(const std::shared_ptr<ProcessState> &state)
+    {
+        siginfo_t info;
+        while (waitid(P_PID, state->pid, &info, WEXITED | WNOWAIT) != 0 && errno == EINTR)
+        {
+        }
+
+        auto io = read_io(std::to_string(state->pid));
+
+        int status = 0;
+        rusage usage = {};
+        while (wait4(state->pid, &status, 0, &usage) < 0 && errno == EINTR)
+        {
+        }
+
+        std::lock_guard<std::mutex> lock(wait_mutex());
+        state->usage = usage;
+        state->io = io.value_or(IO_COUNTERS{});
+        state->exit_time = now_ticks();
+        state->exit_code = state->terminated.has_value() ? *state->terminated
+                           : WIFEXITED(status)           ? WEXITSTATUS(status)
+                                                         : 128 + WTERMSIG(status);
+        state->exited = true;
+        if (state->gate >= 0)
+        {
+            // Terminated before being resumed
+            close(state->gate);
+            state->gate = -1;
+        }
+
+        notify_waiters();
+    }
+
+    /**
+     * @brief Split a command line following the rules of the Microsoft C runtime, since the shell builds the
+     * command lines of its subprocesses for `CreateProcessW`
+     */
+    std::vector<std::string> split_command_line(const std::wstring_view &command_line)
+    {
+        std::vector<std::string> arguments;
+        std::size_t i = 0;
+        auto blank = [](const wchar_t c)
+        {
+            return c == L' ' || c == L'\t';
+        };
+
+        // The program name ends at the next quote or blank, backslashes have no special meaning
+        std::wstring program;
+        if (i < command_line.size() && command_line[i] == L'"')
+        {
+            auto end = command_line.find(L'"', 1);
+            program = command_line.substr(1, end == std::wstring_view::npos ? std::wstring_view::npos : end - 1);
+            i = end == std::wstring_view::npos ? command_line.size() : end + 1;
+        }
+        else
+        {
+            while (i < command_line.size() && !blank(command_line[i]))
+            {
+                program += command_line[i++];
+            }
+        }
+
+        arguments.push_back(narrow(program));
+        while (true)
+        {
+            while (i < command_line.size() && blank(command_line[i]))
+            {
+                i++;
+            }
+
+            if (i >= command_line.size())
+            {
+                return arguments;
+            }
+
+            std::wstring argument;
+            bool quoted = false;
+            while (i < command_line.size() && (quoted || !blank(command_line[i])))
+            {
+                std::size_t backslashes = 0;
+                while (i < command_line.size() && command_line[i] == L'\\')
+                {
+                    backslashes++;
+                    i++;
+                }
+
+                if (i < command_line.size() && command_line[i] == L'"')
+                {
+                    // 2n backslashes are n backslashes and a quote mark, 2n + 1 are n backslashes and a literal quote
+                    argument.append(backslashes / 2, L'\\');
+                    if (backslashes % 2 == 1)
+                    {
+                        argument += L'"';
+                    }
+                    else if (quoted && i + 1 < command_line.size() && command_line[i + 1] == L'"')
+                    {
+                        argument += L'"';
+                        i++;
+                    }
+                    else
+                    {
+                        quoted = !quoted;
+                    }
+
+                    i++;
+                }
+                else
+                {
+                    argument.append(backslashes, L'\\');
+                    if (i < command_line.size() && (quoted || !blank(command_line[i])))
+                    {
+                        argument += command_line[i++];
+                    }
+                }
+            }
+
+            arguments.push_back(narrow(argument));
+        }
+    }
+
+    /** @brief Quote an argument so that `split_command_line` returns it unchanged */
+    std::wstring quote_argument(const std::wstring &argument)
+    {
+        if (!argument.empty() && argument.find_first_of(L" \t\"") == std::wstring::npos)
+        {
+            return argument;
+        }
+
+        std::wstring result = L"\"";
+        std::size_t backslashes = 0;
+        for (auto c : argument)
+        {
+            if (c == L'\\')
+            {
+                backslashes++;
+                continue;
+            }
+
+            result.append(c == L'"' ? 2 * backslashes + 1 : backslashes, L'\\');
+            result += c;
+            backslashes = 0;
+        }
+
+        result.append(2 * backslashes, L'\\');
+        return result + L"\"";
+    }
+
+    /** @brief A job object, which accounts for the resources used by the processes assigned to it */
+    class Job : public Object
+    {
+    public:
+        /** @brief Protected by `wait_mutex()` */
+        std::vector<std::shared_ptr<ProcessState>> processes;
+        DWORD limit_flags = 0;
+        SIZE_T memory_limit = 0;
+
+        ~Job()
+        {
+            if (limit_flags & JOB_OBJECT_LIMIT_KILL_ON_JOB_CLOSE)
+            {
+                std::lock_guard<std::mutex> lock(wait_mutex());
+                for (auto &state : processes)
+                {
+                    if (!state->exited)
+                    {
+                        kill(state->pid, SIGKILL);
+                    }
+                }
+            }
+        }
+
+        /**
+         * @brief Limit the address space of a process, the closest equivalent of the committed memory limit of a job
+         *
+         * A process which has not called `execve` yet applies the limit to itself when it is resumed, so that it
+         * never runs without it. The limit is inherited by its descendants, which therefore cannot escape it.
+         */
+        bool apply(ProcessState &state) const
+        {
+            if (!(limit_flags & (JOB_OBJECT_LIMIT_JOB_MEMORY | JOB_OBJECT_LIMIT_PROCESS_MEMORY)) || memory_limit == 0)
+            {
+                return true;
+            }
+
+            if (state.gate >= 0)
+            {
+                state.memory_limit = memory_limit;
+                return true;
+            }
+
+            rlimit limit = {memory_limit, memory_limit};
+            return prlimit(state.pid, RLIMIT_AS, &limit, NULL) == 0;
+        }
+    };
+
+    /**
+     * @brief Search a program like `execvp`, since a process created suspended calls `execve` after `fork`
+     *
+     * @param program The program name, searched in `PATH` unless it contains a slash
+     * @param environment The environment block of the subprocess, whose `PATH` is used
+     * @return The path to the program, or `std::nullopt` with `errno` set
+     */
+    std::optional<std::string> find_program(const std::string &program, char **environment)
+    {
+        if (program.find('/') != std::string::npos)
+        {
+            return access(program.c_str(), X_OK) == 0 ? std::optional<std::string>(program) : std::nullopt;
+        }
+
+        const char *path = NULL;
+        for (auto variable = environment; *variable != NULL; variable++)
+        {
+            if (std::strncmp(*variable, "PATH=", 5) == 0)
+            {
+                path = *variable + 5;
+                break;
+            }
+        }
+
+        std::string_view directories(path != NULL ? path : "/usr/local/bin:/usr/bin:/bin");
+        while (true)
+        {
+            auto end = std::min(directories.find(':'), directories.size());
+            auto directory = directories.substr(0, end);
+            auto candidate = (directory.empty() ? std::string(".") : std::string(directory)) + "/" + program;
+
+            struct stat status;
+            if (stat(candidate.c_str(), &status) == 0 && S_ISREG(status.st_mode) && access(candidate.c_str(), X_OK) == 0)
+            {
+                return candidate;
+            }
+
+            if (end == directories.size())
+            {
+                errno = ENOENT;
+                return std::nullopt;
+            }
+
+            directories.remove_prefix(end + 1);
+        }
+    }
+
+    /**
+     * @brief Fork a subprocess which waits on a socket before calling `execve`, the equivalent of `CREATE_SUSPENDED`
+     *
+     * The subprocess reads a `rlimit` from the socket, applies it to its address space when it is finite, then runs
+     * the program. It exits with 127 if the shell closes the socket first or if `execve` fails. Only async-signal-safe
+     * functions are called between `fork` and `execve`, all arguments are prepared by the caller.
+     *
+     * @param path The path to the program
+     * @param argv The null-terminated arguments
+     * @param environment The null-terminated environment block
+     * @param sources The descriptors to duplicate onto 0, 1 and 2 (-1 for the null device), or `nullptr` to inherit
+     * them. None of them may be below 3 unless it is already in place.
+     * @param directory The working directory of the subprocess, or `nullptr`
+     * @param group Whether the subprocess starts a new process group
+     * @param gate The socket releasing the subprocess, set on success
+     * @return The pid of the subprocess, or -1 with `errno` set
+     */
+    pid_t spawn_suspended(
+        const std::string &path, char **argv, char **environment, const int *sources, const char *directory, const bool group, int &gate)
+    {
+        int sockets[2];
+        if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, sockets) != 0)
+        {
+            return -1;
+        }
+
+        // The signals are blocked until the subprocess restored their default dispositions, so that it never runs the
+        // handlers of the shell
+        sigset_t all, previous;
+        sigfillset(&all);
+        pthread_sigmask(SIG_SETMASK, &all, &previous);
+
+        auto pid = fork();
+        if (pid == 0)
+        {
+            close(sockets[0]);
+            if (sources != nullptr)
+            {
+                for (int i = 0; i < 3; i++)
+                {
+                    auto descriptor = sources[i] < 0 ? open("/dev/null", i == 0 ? O_RDONLY : O_WRONLY) : sources[i];
+                    if (descriptor == i ? fcntl(i, F_SETFD, 0) != 0 : dup2(descriptor, i) < 0)
+                    {
+                        _exit(127);
+                    }
+
+                    if (sources[i] < 0 && descriptor != i)
+                    {
+                        close(descriptor);
+                    }
+                }
+            }
+
+            if ((directory != nullptr && chdir(directory) != 0) || (group && setpgid(0, 0) != 0))
+            {
+                _exit(127);
+            }
+
+            for (auto signal : {SIGINT, SIGPIPE, SIGQUIT})
+            {
+                struct sigaction action = {};
+                action.sa_handler = SIG_DFL;
+                sigaction(signal, &action, NULL);
+            }
+
+            sigset_t none;
+            sigemptyset(&none);
+            sigprocmask(SIG_SETMASK, &none, NULL);
+
+            rlimit limit;
+            std::size_t received = 0;
+            while (received < sizeof(limit))
+            {
+                auto count = read(sockets[1], reinterpret_cast<char *>(&limit) + received, sizeof(limit) - received);
+                if (count <= 0 && !(count < 0 && errno == EINTR))
+                {
+                    _exit(127);
+                }
+
+                received += count > 0 ? count : 0;
+            }
+
+            if (limit.rlim_cur != RLIM_INFINITY && setrlimit(RLIMIT_AS, &limit) != 0)
+            {
+                _exit(127);
+            }
+
+            execve(path.c_str(), argv, environment);
+            _exit(127);
+        }
+
+        auto error = errno;
+        pthread_sigmask(SIG_SETMASK, &previous, NULL);
+        close(sockets[1]);
+        if (pid < 0)
+        {
+            close(sockets[0]);
+            errno = error;
+            return -1;
+        }
+
+        gate = sockets[0];
+        return pid;
+    }
+
+    /** @brief Release a process created suspended, with the limit it must apply to itself, which closes `gate` */
+    void release(ProcessState &state)
+    {
+        rlimit limit = {RLIM_INFINITY, RLIM_INFINITY};
+        if (state.memory_limit > 0)
+        {
+            limit.rlim_cur = limit.rlim_max = state.memory_limit;
+        }
+
+        // The process may have been killed already, which must not raise SIGPIPE in the shell
+        send(state.gate, &limit, sizeof(limit), MSG_NOSIGNAL);
+        close(state.gate);
+        state.gate = -1;
+    }
+}
+
+HANDLE GetCurrentProcess()
+{
+    static utils::posix::CurrentProcess process;
+    return &process;
+}
+
+DWORD GetCurrentProcessId()
+{
+    return getpid();
+}
+
+/**
+ * The subprocess is spawned with `posix_spawn`, which runs the program right away. A subprocess created with
+ * `CREATE_SUSPENDED` is forked instead and waits for `ResumeThread` before calling `execve`, so that the limits of the
+ * job objects it is assigned to apply before it runs, to the program and to all of its descendants.
+ */
+BOOL CreateProcessW(
+    LPCWSTR application_name,
+    LPWSTR command_line,
+    LPSECURITY_ATTRIBUTES,
+    LPSECURITY_ATTRIBUTES,
+    BOOL,
+    DWORD flags,
+    LPVOID environment,
+    LPCWSTR current_directory,
+    LPSTARTUPINFOW startup_info,
+    LPPROCESS_INFORMATION process_info)
+{
+    process_info->hProcess = process_info->hThread = NULL;
+
+    auto arguments = utils::posix::split_command_line(command_line);
+    auto program = application_name != NULL ? utils::posix::native_path(application_name) : arguments[0];
+    std::replace(program.begin(), program.end(), '\\', '/');
+
+    std::vector<char *> argv;
+    for (auto &argument : arguments)
+    {
+        argv.push_back(argument.data());
+    }
+
+    argv.push_back(nullptr);
+
+    // The standard handles are duplicated onto descriptors 0, 1 and 2. A source among them is first moved out of
+    // the way, so that it is not overwritten before being duplicated.
+    std::vector<int> temporaries;
+    int sources[3] = {-1, -1, -1};
+    auto redirected = (startup_info->dwFlags & STARTF_USESTDHANDLES) != 0;
+    if (redirected)
+    {
+        HANDLE handles[3] = {startup_info->hStdInput, startup_info->hStdOutput, startup_info->hStdError};
+        for (int i = 0; i < 3; i++)
+        {
+            auto file = utils::posix::cast<utils::posix::File>(handles[i]);
+            sources[i] = file == nullptr ? -1 : file->descriptor;
+            if (sources[i] >= 0 && sources[i] < 3 && sources[i] != i)
+            {
+                sources[i] = fcntl(sources[i], F_DUPFD_CLOEXEC, 3);
+                temporaries.push_back(sources[i]);
+            }
+        }
+    }
+
+    auto directory = current_directory != NULL ? std::optional<std::string>(utils::posix::native_path(current_directory)) : std::nullopt;
+    auto envp = environment != NULL ? static_cast<char **>(environment) : environ;
+    auto group = (flags & CREATE_NEW_PROCESS_GROUP) != 0;
+
+    pid_t pid = -1;
+    int gate = -1, error = 0;
+    if (flags & CREATE_SUSPENDED)
+    {
+        // The program is searched first, so that a missing program fails here like with posix_spawn
+        auto path = utils::posix::find_program(program, envp);
+        error = !path.has_value() ? errno : 0;
+        if (path.has_value())
+        {
+            pid = utils::posix::spawn_suspended(
+                *path, argv.data(), envp, redirected ? sources : nullptr, directory.has_value() ? directory->c_str() : nullptr, group, gate);
+            error = pid < 0 ? errno : 0;
+        }
+    }
+    else
+    {
+        posix_spawn_file_actions_t actions;
+        posix_spawn_file_actions_init(&actions);
+        if (redirected)
+        {
+            for (int i = 0; i < 3; i++)
+            {
+                if (sources[i] < 0)
+                {
+                    posix_spawn_file_actions_addopen(&actions, i, "/dev/null", i == 0 ? O_RDONLY : O_WRONLY, 0);
+                }
+                else
+                {
+                    posix_spawn_file_actions_adddup2(&actions, sources[i], i);
+                }
+            }
+        }
+
+        if (directory.has_value())
+        {
+            posix_spawn_file_actions_addchdir_np(&actions, directory->c_str());
+        }
+
+        // The shell ignores or handles some signals, the subprocess starts with the default dispositions
+        posix_spawnattr_t attributes;
+        posix_spawnattr_init(&attributes);
+
+        sigset_t defaults, mask;
+        sigemptyset(&defaults);
+        sigaddset(&defaults, SIGINT);
+        sigaddset(&defaults, SIGPIPE);
+        sigaddset(&defaults, SIGQUIT);
+        sigemptyset(&mask);
+        posix_spawnattr_setsigdefault(&attributes, &defaults);
+        posix_spawnattr_setsigmask(&attributes, &mask);
+
+        short spawn_flags = POSIX_SPAWN_SETSIGDEF | POSIX_SPAWN_SETSIGMASK;
+        if (group)
+        {
+            // Like a new process group on Windows, the subprocess does not receive the Ctrl-C of the console
+            spawn_flags |= POSIX_SPAWN_SETPGROUP;
+            posix_spawnattr_setpgroup(&attributes, 0);
+        }
+
+        posix_spawnattr_setflags(&attributes, spawn_flags);
+
+        error = program.find('/') == std::string::npos
+                    ? posix_spawnp(&pid, program.c_str(), &actions, &attributes, argv.data(), envp)
+                    : posix_spawn(&pid, program.c_str(), &actions, &attributes, argv.data(), envp);
+
+        posix_spawnattr_destroy(&attributes);
+        posix_spawn_file_actions_destroy(&actions);
+    }
+
+    for (auto descriptor : temporaries)
+    {
+        close(descriptor);
+    }
+
+    if (error != 0)
+    {
+        return utils::posix::fail(utils::posix::error_from_errno(error));
+    }
+
+    auto state = std::make_shared<utils::posix::ProcessState>();
+    state->pid = pid;
+    state->creation_time = utils::posix::now_ticks();
+    state->suspended = (flags & CREATE_SUSPENDED) ? 1 : 0;
+    state->gate = gate;
+    {
+        std::unique_lock<std::mutex> lock;
+        auto &processes = utils::posix::processes(lock);
+        for (auto iter = processes.begin(); iter != processes.end();)
+        {
+            iter = iter->second.expired() ? processes.erase(iter) : std::next(iter);
+        }
+
+        processes[pid] = state;
+    }
+
+    std::thread(utils::posix::reap, state).detach();
+
+    process_info->hProcess = new utils::posix::Process(state);
+    process_info->hThread = new utils::posix::Thread(state);
+    process_info->dwProcessId = process_info->dwThreadId = pid;
+    return TRUE;
+}
+
+DWORD ResumeThread(HANDLE handle)
+{
+    auto thread = utils::posix::cast<utils::posix::Thread>(handle);
+    if (thread == nullptr)
+    {
+        utils::posix::fail(ERROR_INVALID_HANDLE);
+        return (DWORD)-1;
+    }
+
+    std::lock_guard<std::mutex> lock(utils::posix::wait_mutex());
+    auto &state = *thread->state;
+    auto previous = state.suspended;
+    if (state.suspended > 0 && --state.suspended == 0)
+    {
+        if (state.gate >= 0)
+        {
+            utils::posix::release(state);
+        }
+        else if (state.stopped)
+        {
+            state.stopped = false;
+            if (!state.exited)
+            {
+                kill(state.pid, SIGCONT);
+            }
+        }
+    }
+
+    return previous;
+}
+
+DWORD SuspendThread(HANDLE handle)
+{
+    auto thread = utils::posix::cast<utils::posix::Thread>(handle);
+    if (thread == nullptr)
+    {
+        utils::posix::fail(ERROR_INVALID_HANDLE);
+        return (DWORD)-1;
+    }
+
+    std::lock_guard<std::mutex> lock(utils::posix::wait_mutex());
+    auto &state = *thread->state;
+    if (!state.exited && !state.stopped && state.gate < 0)
+    {
+        if (kill(state.pid, SIGSTOP) != 0)
+        {
+            utils::posix::fail_errno();
+            return (DWORD)-1;
+        }
+
+        state.stopped = true;
+    }
+
+    return state.suspended++;
+}
+
+BOOL TerminateProcess(HANDLE handle, UINT exit_code)
+{
+    if (handle == GetCurrentProcess())
+    {
+        std::fflush(NULL);
+        _exit(exit_code);
+    }
+
+    if (auto foreign = utils::posix::cast<utils::posix::ForeignProcess>(handle))
+    {
+        return kill(foreign->pid, SIGKILL) == 0 ? TRUE : utils::posix::fail_errno();
+    }
+
+    auto process = utils::posix::cast<utils::posix::Process>(handle);
+    if (process == nullptr)
+    {
+        return utils::posix::fail(ERROR_INVALID_HANDLE);
+    }
+
+    std::lock_guard<std::mutex> lock(utils::posix::wait_mutex());
+    if (process->state->exited)
+    {
+        return utils::posix::fail(ERROR_ACCESS_DENIED);
+    }
+
+    process->state->terminated = exit_code;
+    return kill(process->state->pid, SIGKILL) == 0 ? TRUE : utils::posix::fail_errno();
+}
+
+BOOL GetExitCodeProcess(HANDLE handle, LPDWORD exit_code)
+{
+    if (auto foreign = utils::posix::cast<utils::posix::ForeignProcess>(handle))
+    {
+        // The exit status of a process belongs to its parent
+        *exit_code = utils::posix::readable(foreign->descriptor) ? 0 : STILL_ACTIVE;
+        return TRUE;
+    }
+
+    auto process = utils::posix::cast<utils::posix::Process>(handle);
+    if (process == nullptr)
+    {
+        return utils::posix::fail(ERROR_INVALID_HANDLE);
+    }
+
+    std::lock_guard<std::mutex> lock(utils::posix::wait_mutex());
+    *exit_code = process->state->exited ? process->state->exit_code : STILL_ACTIVE;
+    return TRUE;
+}
+
+HANDLE OpenProcess(DWORD, BOOL, DWORD pid)
+{
+    if (pid == static_cast<DWORD>(getpid()))
+    {
+        return GetCurrentProcess();
+    }
+
+    {
+        std::unique_lock<std::mutex> lock;
+        auto &processes = utils::posix::processes(lock);
+        auto iter = processes.find(pid);
+        if (iter != processes.end())
+        {
+            if (auto state = iter->second.lock())
+            {
+                return new utils::posix::Process(state);
+            }
+        }
+    }
+
+    auto descriptor = static_cast<int>(syscall(SYS_pidfd_open, static_cast<pid_t>(pid), 0));
+    if (descriptor < 0)
+    {
+        utils::posix::fail(errno == ESRCH ? ERROR_INVALID_PARAMETER : utils::posix::error_from_errno(errno));
+        return NULL;
+    }
+
+    fcntl(descriptor, F_SETFD, FD_CLOEXEC);
+    return new utils::posix::ForeignProcess(pid, descriptor);
+}
+
+BOOL GetProcessTimes(HANDLE handle, LPFILETIME creation_time, LPFILETIME exit_time, LPFILETIME kernel_time, LPFILETIME user_time)
+{
+    auto filetime = [](const LONGLONG ticks)
+    {
+        return FILETIME{static_cast<DWORD>(ticks & 0xFFFFFFFF), static_cast<DWORD>(static_cast<ULONGLONG>(ticks) >> 32)};
+    };
+
+    if (handle == GetCurrentProcess())
+    {
+        // The start time is in clock ticks since the boot, whose time is in /proc/stat
+        static const LONGLONG creation = []()
+        {
+            auto fields = utils::posix::read_stat("self");
+            std::ifstream stream("/proc/stat");
+            std::string key;
+            long long boot = 0;
+            while (stream >> key)
+            {
+                if (key == "btime")
+                {
+                    stream >> boot;
+                    break;
+                }
+            }
+
+            if (fields.size() < 20 || boot == 0)
+            {
+                return utils::posix::now_ticks();
+            }
+
+            auto ticks_per_second = sysconf(_SC_CLK_TCK);
+            auto start = std::stoll(fields[19]);
+            return (boot + 11644473600LL) * 10000000LL + start * 10000000LL / ticks_per_second;
+        }();
+
+        rusage usage;
+        getrusage(RUSAGE_SELF, &usage);
+        *creation_time = filetime(creation);
+        *exit_time = filetime(0);
+        *kernel_time = filetime(utils::posix::duration_ticks(usage.ru_stime));
+        *user_time = filetime(utils::posix::duration_ticks(usage.ru_utime));
+        return TRUE;
+    }
+
+    auto process = utils::posix::cast<utils::posix::Process>(handle);
+    if (process == nullptr)
+    {
+        return utils::posix::fail(ERROR_INVALID_HANDLE);
+    }
+
+    std::unique_lock<std::mutex> lock(utils::posix::wait_mutex());
+    auto &state = *process->state;
+    *creation_time = filetime(state.creation_time);
+    *exit_time = filetime(state.exit_time);
+    if (state.exited)
+    {
+        *kernel_time = filetime(utils::posix::duration_ticks(state.usage.ru_stime));
+        *user_time = filetime(utils::posix::duration_ticks(state.usage.ru_utime));
+    }
+    else
+    {
+        auto pid = std::to_string(state.pid);
+        lock.unlock();
+
+        auto times = utils::posix::read_times(pid);
+        *user_time = filetime(times.first);
+        *kernel_time = filetime(times.second);
+    }
+
+    return TRUE;
+}
+
+BOOL GetProcessIoCounters(HANDLE handle, IO_COUNTERS *counters)
+{
+    if (handle == GetCurrentProcess())
+    {
+        *counters = utils::posix::read_io("self").value_or(IO_COUNTERS{});
+        return TRUE;
+    }
+
+    auto process = utils::posix::cast<utils::posix::Process>(handle);
+    if (process == nullptr)
+    {
+        return utils::posix::fail(ERROR_INVALID_HANDLE);
+    }
+
+    std::unique_lock<std::mutex> lock(utils::posix::wait_mutex());
+    if (process->state->exited)
+    {
+        *counters = process->state->io;
+        return TRUE;
+    }
+
+    auto pid = std::to_string(process->state->pid);
+    lock.unlock();
+
+    *counters = utils::posix::read_io(pid).value_or(IO_COUNTERS{});
+    return TRUE;
+}
+
+BOOL K32GetProcessMemoryInfo(HANDLE handle, PROCESS_MEMORY_COUNTERS *counters, DWORD size)
+{
+    ZeroMemory(counters, size);
+    counters->cb = size;
+    if (handle == GetCurrentProcess())
+    {
+        counters->PeakWorkingSetSize = utils::posix::read_status("self", "VmHWM");
+        counters->WorkingSetSize = utils::posix::read_status("self", "VmRSS");
+        return TRUE;
+    }
+
+    auto process = utils::posix::cast<utils::posix::Process>(handle);
+    if (process == nullptr)
+    {
+        return utils::posix::fail(ERROR_INVALID_HANDLE);
+    }
+
+    std::unique_lock<std::mutex> lock(utils::posix::wait_mutex());
+    if (process->state->exited)
+    {
+        counters->PeakWorkingSetSize = static_cast<SIZE_T>(process->state->usage.ru_maxrss) * 1024;
+        return TRUE;
+    }
+
+    auto pid = std::to_string(process->state->pid);
+    lock.unlock();
+
+    counters->PeakWorkingSetSize = utils::posix::read_status(pid, "VmHWM");
+    counters->WorkingSetSize = utils::posix::read_status(pid, "VmRSS");
+    return TRUE;
+}
+
+HANDLE CreateJobObjectW(LPSECURITY_ATTRIBUTES, LPCWSTR)
+{
+    return new utils::posix::Job();
+}
+
+BOOL SetInformationJobObject(HANDLE handle, JOBOBJECTINFOCLASS type, LPVOID information, DWORD)
+{
+    auto job = utils::posix::cast<utils::posix::Job>(handle);
+    if (job == nullptr)
+    {
+        return utils::posix::fail(ERROR_INVALID_HANDLE);
+    }
+
+    std::lock_guard<std::mutex> lock(utils::posix::wait_mutex());
+    switch (type)
+    {
+    case JobObjectBasicLimitInformation:
+        job->limit_flags = static_cast<JOBOBJECT_BASIC_LIMIT_INFORMATION *>(information)->LimitFlags;
+        return TRUE;
+
+    case JobObjectExtendedLimitInformation:
+    {
+        auto &limits = *static_cast<JOBOBJECT_EXTENDED_LIMIT_INFORMATION *>(information);
+        job->limit_flags = limits.BasicLimitInformation.LimitFlags;
+        job->memory_limit = (job->limit_flags & JOB_OBJECT_LIMIT_JOB_MEMORY) ? limits.JobMemoryLimit : limits.ProcessMemoryLimit;
+        for (auto &state : job->processes)
+        {
+            if (!state->exited && !job->apply(*state))
+            {
+                return utils::posix::fail_errno();
+            }
+        }
+
+        return TRUE;
+    }
+
+    case JobObjectCpuRateControlInformation:
+        // A CPU rate requires a cgroup, which the shell cannot create without privileges
+        if (static_cast<JOBOBJECT_CPU_RATE_CONTROL_INFORMATION *>(information)->ControlFlags & JOB_OBJECT_CPU_RATE_CONTROL_ENABLE)
+        {
+            return utils::posix::fail(ERROR_NOT_SUPPORTED);
+        }
+
+        return TRUE;
+
+    default:
+        return utils::posix::fail(ERROR_INVALID_PARAMETER);
+    }
+}
+
+BOOL AssignProcessToJobObject(HANDLE handle, HANDLE process_handle)
+{
+    auto job = utils::posix::cast<utils::posix::Job>(handle);
+    auto process = utils::posix::cast<utils::posix::Process>(process_handle);
+    if (job == nullptr || process == nullptr)
+    {
+        return utils::posix::fail(ERROR_INVALID_HANDLE);
+    }
+
+    std::lock_guard<std::mutex> lock(utils::posix::wait_mutex());
+    if (!job->apply(*process->state))
+    {
+        return utils::posix::fail_errno();
+    }
+
+    job->processes.push_back(process->state);
+    return TRUE;
+}
+
+BOOL QueryInformationJobObject(HANDLE handle, JOBOBJECTINFOCLASS type, LPVOID information, DWORD, LPDWORD returned)
+{
+    auto job = utils::posix::cast<utils::posix::Job>(handle);
+    if (job == nullptr)
+    {
+        return utils::posix::fail(ERROR_INVALID_HANDLE);
+    }
+
+    // The usage of the running processes is read from /proc without holding the lock
+    std::vector<std::shared_ptr<utils::posix::ProcessState>> processes;
+    {
+        std::lock_guard<std::mutex> lock(utils::posix::wait_mutex());
+        processes = job->processes;
+    }
+
+    LONGLONG user = 0, kernel = 0;
+    SIZE_T peak_memory = 0;
+    DWORD active = 0;
+    IO_COUNTERS io = {};
+    for (auto &state : processes)
+    {
+        std::unique_lock<std::mutex> lock(utils::posix::wait_mutex());
+        IO_COUNTERS counters;
+        if (state->exited)
+        {
+            user += utils::posix::duration_ticks(state->usage.ru_utime);
+            kernel += utils::posix::duration_ticks(state->usage.ru_stime);
+            peak_memory = std::max<SIZE_T>(peak_memory, static_cast<SIZE_T>(state->usage.ru_maxrss) * 1024);
+            counters = state->io;
+        }
+        else
+        {
+            auto pid = std::to_string(state->pid);
+            lock.unlock();
+
+            active++;
+            auto times = utils::posix::read_times(pid);
+            user += times.first;
+            kernel += times.second;
+            peak_memory = std::max(peak_memory, utils::posix::read_status(pid, "VmHWM"));
+            counters = utils::posix::read_io(pid).value_or(IO_COUNTERS{});
+        }
+
+        io.ReadOperationCount += counters.ReadOperationCount;
+        io.WriteOperationCount += counters.WriteOperationCount;
+        io.ReadTransferCount += counters.ReadTransferCount;
+        io.WriteTransferCount += counters.WriteTransferCount;
+    }
+
+    auto fill_basic = [&](JOBOBJECT_BASIC_ACCOUNTING_INFORMATION &basic)
+    {
+        ZeroMemory(&basic, sizeof(basic));
+        basic.TotalUserTime.QuadPart = basic.ThisPeriodTotalUserTime.QuadPart = user;
+        basic.TotalKernelTime.QuadPart = basic.ThisPeriodTotalKernelTime.QuadPart = kernel;
+        basic.TotalProcesses = processes.size();
+        basic.ActiveProcesses = active;
+    };
+
+    switch (type)
+    {
+    case JobObjectBasicAccountingInformation:
+        fill_basic(*static_cast<JOBOBJECT_BASIC_ACCOUNTING_INFORMATION *>(information));
+        break;
+
+    case JobObjectBasicAndIoAccountingInformation:
+    {
+        auto &accounting = *static_cast<JOBOBJECT_BASIC_AND_IO_ACCOUNTING_INFORMATION *>(information);
+        fill_basic(accounting.BasicInfo);
+        accounting.IoInfo = io;
+        break;
+    }
+
+    case JobObjectExtendedLimitInformation:
+    {
+        // The peak of the job is the largest peak of its processes, their peaks may not overlap
+        auto &limits = *static_cast<JOBOBJECT_EXTENDED_LIMIT_INFORMATION *>(information);
+        ZeroMemory(&limits, sizeof(limits));
+        std::lock_guard<std::mutex> lock(utils::posix::wait_mutex());
+        limits.BasicLimitInformation.LimitFlags = job->limit_flags;
+        limits.JobMemoryLimit = limits.ProcessMemoryLimit = job->memory_limit;
+        limits.IoInfo = io;
+        limits.PeakJobMemoryUsed = limits.PeakProcessMemoryUsed = peak_memory;
+        break;
+    }
+
+    default:
+        return utils::posix::fail(ERROR_INVALID_PARAMETER);
+    }
+
+    if (returned != NULL)
+    {
+        *returned = 0;
+    }
+
+    return TRUE;
+}
+
+BOOL DuplicateHandle(HANDLE source_process, HANDLE source, HANDLE target_process, LPHANDLE target, DWORD, BOOL, DWORD)
+{
+    // Handles cannot be passed between processes, only files of the shell itself can be duplicated
+    auto file = utils::posix::cast<utils::posix::File>(source);
+    if (source_process != GetCurrentProcess() || target_process != GetCurrentProcess() || file == nullptr)
+    {
+        return utils::posix::fail(ERROR_NOT_SUPPORTED);
+    }
+
+    auto descriptor = fcntl(file->descriptor, F_DUPFD_CLOEXEC, 3);
+    if (descriptor < 0)
+    {
+        return utils::posix::fail_errno();
+    }
+
+    *target = new utils::posix::File(descriptor, file->path);
+    return TRUE;
+}
+
+DWORD GetModuleFileNameW(HMODULE, LPWSTR buffer, DWORD size)
+{
+    char path[PATH_MAX];
+    auto length = readlink("/proc/self/exe", path, sizeof(path));
+    if (length < 0)
+    {
+        utils::posix::fail_errno();
+        return 0;
+    }
+
+    // Like on Windows, a truncated path is returned with the size of the buffer
+    auto wide = utils::posix::widen(std::string_view(path, length));
+    if (wide.size() >= size)
+    {
+        std::copy(wide.begin(), wide.begin() + size - 1, buffer);
+        buffer[size - 1] = L'\0';
+        utils::posix::fail(ERROR_INSUFFICIENT_BUFFER);
+        return size;
+    }
+
+    return utils::posix::copy_out(wide, buffer, size);
+}
+
+/** An executable is an ELF image or a script starting with `#!`, with the execute permission */
+BOOL GetBinaryTypeW(LPCWSTR name, LPDWORD type)
+{
+    auto path = utils::posix::native_path(name);
+    struct stat status;
+    if (stat(path.c_str(), &status) != 0 || !S_ISREG(status.st_mode) || access(path.c_str(), X_OK) != 0)
+    {
+        return utils::posix::fail(ERROR_BAD_EXE_FORMAT);
+    }
+
+    char magic[4] = {};
+    std::ifstream stream(path, std::ios::binary);
+    stream.read(magic, sizeof(magic));
+    if (std::memcmp(magic, "\x7F"
+                           "ELF",
+                    4) != 0 &&
+        std::memcmp(magic, "#!", 2) != 0)
+    {
+        return utils::posix::fail(ERROR_BAD_EXE_FORMAT);
+    }
+
+    *type = SCS_64BIT_BINARY;
+    return TRUE;
+}
+
+DWORD GetEnvironmentVariableW(LPCWSTR name, LPWSTR buffer, DWORD size)
+{
+    auto value = std::getenv(utils::posix::narrow(name).c_str());
+    if (value == NULL)
+    {
+        utils::posix::fail(ERROR_ENVVAR_NOT_FOUND);
+        return 0;
+    }
+
+    return utils::posix::copy_out(utils::posix::widen(value), buffer, size);
+}
+
+BOOL SetEnvironmentVariableW(LPCWSTR name, LPCWSTR value)
+{
+    auto narrow_name = utils::posix::narrow(name);
+    auto result = value == NULL ? unsetenv(narrow_name.c_str()) : setenv(narrow_name.c_str(), utils::posix::narrow(value).c_str(), 1);
+    return result == 0 ? TRUE : utils::posix::fail_errno();
+}
+
+/** The block is a sequence of null-terminated `NAME=value` strings, ending with an empty string */
+LPWSTR GetEnvironmentStringsW()
+{
+    std::wstring block;
+    for (auto variable = environ; *variable != NULL; variable++)
+    {
+        block += utils::posix::widen(*variable);
+        block += L'\0';
+    }
+
+    block += L'\0';
+
+    auto result = new wchar_t[block.size()];
+    std::copy(block.begin(), block.end(), result);
+    return result;
+}
+
+BOOL FreeEnvironmentStringsW(LPWSTR block)
+{
+    delete[] block;
+    return TRUE;
+}
+
+/** The arguments of the process are quoted again, so that the shell parses them like on Windows */
+LPWSTR GetCommandLineW()
+{
+    static std::wstring command_line = []()
+    {
+        std::ifstream stream("/proc/self/cmdline", std::ios::binary);
+        std::string content((std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>());
+
+        std::wstring result;
+        std::size_t start = 0;
+        while (start < content.size())
+        {
+            auto end = content.find('\0', start);
+            end = end == std::string::npos ? content.size() : end;
+            if (!result.empty())
+            {
+                result += L' ';
+            }
+
+            result += utils::posix::quote_argument(utils::posix::widen(std::string_view(content).substr(start, end - start)));
+            start = end + 1;
+        }
+
+        return result;
+    }();
+
+    return command_line.data();
+}
@@ -0,0 +1,245 @@
+#pragma once
+
+#include <cwctype>
+#include <string>
+#include <string_view>
+
+#include "handles.hpp"
+
+namespace utils::posix
+{
+    /** @brief The replacement character of invalid sequences */
+    const char32_t REPLACEMENT_CHARACTER = 0xFFFD;
+
+    /**
+     * @brief Decode UTF-8 into code points, `wchar_t` being UTF-32 on POSIX
+     *
+     * @param data The UTF-8 bytes
+     * @param size The number of bytes
+     * @param output The buffer receiving the code points, or `nullptr` to only count them
+     * @param strict Whether to stop at the first invalid sequence instead of replacing it by U+FFFD
+     * @return The number of code points, or `std::nullopt` if `strict` is set and a sequence is invalid
+     */
+    std::optional<std::size_t> decode_utf8(const char *data, const std::size_t size, wchar_t *output, const bool strict)
+    {
+        std::size_t count = 0;
+        for (std::size_t i = 0; i < size;)
+        {
+            auto byte = static_cast<unsigned char>(data[i]);
+            char32_t code_point = REPLACEMENT_CHARACTER;
+            std::size_t length = 1;
+            if (byte < 0x80)
+            {
+                code_point = byte;
+            }
+            else
+            {
+                std::size_t expected = byte >= 0xF0 && byte <= 0xF4 ? 4 : (byte >= 0xE0 && byte < 0xF0 ? 3 : (byte >= 0xC2 && byte < 0xE0 ? 2 : 0));
+                char32_t value = expected == 4 ? byte & 0x07 : (expected == 3 ? byte & 0x0F : byte & 0x1F);
+                std::size_t j = 1;
+                for (; expected > 0 && j < expected && i + j < size; j++)
+                {
+                    auto next = static_cast<unsigned char>(data[i + j]);
+                    if ((next & 0xC0) != 0x80)
+                    {
+                        break;
+                    }
+
+                    value = (value << 6) | (next & 0x3F);
+                }
+
+                // Overlong forms, surrogates and values past U+10FFFF are invalid
+                auto valid = expected > 0 && j == expected &&
+                             !(expected == 3 && value < 0x800) && !(expected == 4 && value < 0x10000) &&
+                             !(value >= 0xD800 && value <= 0xDFFF) && value <= 0x10FFFF;
+                if (valid)
+                {
+                    code_point = value;
+                    length = expected;
+                }
+                else if (strict)
+                {
+                    return std::nullopt;
+                }
+                else
+                {
+                    length = std::max<std::size_t>(1, j);
+                }
+            }
+
+            if (output != nullptr)
+            {
+                output[count] = static_cast<wchar_t>(code_point);
+            }
+
+            count++;
+            i += length;
+        }
+
+        return count;
+    }
+
+    /**
+     * @brief Encode code points into UTF-8
+     *
+     * @param data The code points
+     * @param size The number of code points
+     * @param output The buffer receiving the bytes, or `nullptr` to only count them
+     * @param strict Whether to stop at the first invalid code point instead of replacing it by U+FFFD
+     * @return The number of bytes, or `std::nullopt` if `strict` is set and a code point is invalid
+     */
+    std::optional<std::size_t> encode_utf8(const wchar_t *data, const std::size_t size, char *output, const bool strict)
+    {
+        std::size_t count = 0;
+        auto put = [&output, &count](const unsigned value)
+        {
+            if (output != nullptr)
+            {
+                output[count] = static_cast<char>(value);
+            }
+
+            count++;
+        };
+
+        for (std::size_t i = 0; i < size; i++)
+        {
+            auto code_point = static_cast<char32_t>(data[i]);
+            if ((code_point >= 0xD800 && code_point <= 0xDFFF) || code_point > 0x10FFFF)
+            {
+                if (strict)
+                {
+                    return std::nullopt;
+                }
+
+                code_point = REPLACEMENT_CHARACTER;
+            }
+
+            if (code_point < 0x80)
+            {
+                put(code_point);
+            }
+            else if (code_point < 0x800)
+            {
+                put(0xC0 | (code_point >> 6));
+                put(0x80 | (code_point & 0x3F));
+            }
+            else if (code_point < 0x10000)
+            {
+                put(0xE0 | (code_point >> 12));
+                put(0x80 | ((code_point >> 6) & 0x3F));
+                put(0x80 | (code_point & 0x3F));
+            }
+            else
+            {
+                put(0xF0 | (code_point >> 18));
+                put(0x80 | ((code_point >> 12) & 0x3F));
+                put(0x80 | ((code_point >> 6) & 0x3F));
+                put(0x80 | (code_point & 0x3F));
+            }
+        }
+
+        return count;
+    }
+
+    /** @brief Convert a wide string to UTF-8, e.g. a path argument */
+    std::string narrow(const std::wstring_view &wide)
+    {
+        std::string result(*encode_utf8(wide.data(), wide.size(), nullptr, false), '\0');
+        encode_utf8(wide.data(), wide.size(), result.data(), false);
+        return result;
+    }
+
+    /** @brief Convert an UTF-8 string to a wide string, e.g. a file name */
+    std::wstring widen(const std::string_view &string)
+    {
+        std::wstring result(*decode_utf8(string.data(), string.size(), nullptr, false), L'\0');
+        decode_utf8(string.data(), string.size(), result.data(), false);
+        return result;
+    }
+
+    /**
+     * @brief Copy a string into a caller-provided buffer, following the convention of `GetCurrentDirectoryW`
+     *
+     * @return The number of characters copied without the null terminator, or the size of the buffer required
+     * including the null terminator if `buffer` is too small
+     */
+    DWORD copy_out(const std::wstring_view &value, LPWSTR buffer, const DWORD size)
+    {
+        if (buffer == NULL || size <= value.size())
+        {
+            return value.size() + 1;
+        }
+
+        std::copy(value.begin(), value.end(), buffer);
+        buffer[value.size()] = L'\0';
+        return value.size();
+    }
+}
+
+int MultiByteToWideChar(UINT, DWORD flags, LPCSTR source, int source_size, LPWSTR destination, int destination_size)
+{
+    // Only UTF-8 is used by the shell, a size of -1 includes the null terminator
+    std::size_t size = source_size < 0 ? std::strlen(source) + 1 : source_size;
+    auto count = utils::posix::decode_utf8(source, size, nullptr, flags & MB_ERR_INVALID_CHARS);
+    if (!count.has_value())
+    {
+        utils::posix::fail(ERROR_NO_UNICODE_TRANSLATION);
+        return 0;
+    }
+
+    if (destination_size == 0)
+    {
+        return *count;
+    }
+
+    if (*count > static_cast<std::size_t>(destination_size))
+    {
+        utils::posix::fail(ERROR_INSUFFICIENT_BUFFER);
+        return 0;
+    }
+
+    utils::posix::decode_utf8(source, size, destination, false);
+    return *count;
+}
+
+int WideCharToMultiByte(UINT, DWORD flags, LPCWSTR source, int source_size, LPSTR destination, int destination_size, LPCSTR, LPBOOL)
+{
+    std::size_t size = source_size < 0 ? std::wcslen(source) + 1 : source_size;
+    auto count = utils::posix::encode_utf8(source, size, nullptr, flags & WC_ERR_INVALID_CHARS);
+    if (!count.has_value())
+    {
+        utils::posix::fail(ERROR_NO_UNICODE_TRANSLATION);
+        return 0;
+    }
+
+    if (destination_size == 0)
+    {
+        return *count;
+    }
+
+    if (*count > static_cast<std::size_t>(destination_size))
+    {
+        utils::posix::fail(ERROR_INSUFFICIENT_BUFFER);
+        return 0;
+    }
+
+    utils::posix::encode_utf8(source, size, destination, false);
+    return *count;
+}
+
+int CompareStringOrdinal(LPCWSTR first, int first_size, LPCWSTR second, int second_size, BOOL ignore_case)
+{
+    std::size_t first_length = first_size < 0 ? std::wcslen(first) : first_size,
+                second_length = second_size < 0 ? std::wcslen(second) : second_size;
+
+    for (std::size_t i = 0; i < first_length && i < second_length; i++)
+    {
+        auto x = ignore_case ? std::towupper(first[i]) : first[i], y = ignore_case ? std::towupper(second[i]) : second[i];
+        if (x != y)
+        {
+            return x < y ? CSTR_LESS_THAN : CSTR_GREATER_THAN;
+        }
+    }
+
+    return first_length == second_length ? CSTR_EQUAL : (first_length < second_length ? CSTR_LESS_THAN : CSTR_GREATER_THAN);
+}
@@ -0,0 +1,159 @@
+#pragma once
+
+#include <ctime>
+#include <fstream>
+#include <limits>
+#include <string>
+
+#include <sys/sysinfo.h>
+
+#include "handles.hpp"
+
+namespace utils::posix
+{
+    /** @brief A count of 100-nanosecond intervals since 1601-01-01 as a `FILETIME` */
+    FILETIME ticks_to_filetime(const ULONGLONG ticks)
+    {
+        return {static_cast<DWORD>(ticks & 0xFFFFFFFF), static_cast<DWORD>(ticks >> 32)};
+    }
+
+    /** @brief A `struct tm` and its milliseconds as a `SYSTEMTIME` */
+    SYSTEMTIME to_systemtime(const std::tm &time, const long milliseconds)
+    {
+        SYSTEMTIME result;
+        result.wYear = time.tm_year + 1900;
+        result.wMonth = time.tm_mon + 1;
+        result.wDayOfWeek = time.tm_wday;
+        result.wDay = time.tm_mday;
+        result.wHour = time.tm_hour;
+        result.wMinute = time.tm_min;
+        result.wSecond = time.tm_sec;
+        result.wMilliseconds = milliseconds;
+        return result;
+    }
+
+    /** @brief The current time of a clock as a count of 100-nanosecond intervals since 1601-01-01 */
+    ULONGLONG realtime_ticks(const clockid_t clock)
+    {
+        timespec now;
+        clock_gettime(clock, &now);
+        return (static_cast<ULONGLONG>(now.tv_sec) + 11644473600ULL) * 10000000ULL + now.tv_nsec / 100;
+    }
+}
+
+void GetSystemTimePreciseAsFileTime(LPFILETIME time)
+{
+    *time = utils::posix::ticks_to_filetime(utils::posix::realtime_ticks(CLOCK_REALTIME));
+}
+
+/** Like on Windows, the coarse clock is cheaper to read, with a resolution of a few milliseconds */
+void GetSystemTimeAsFileTime(LPFILETIME time)
+{
+    *time = utils::posix::ticks_to_filetime(utils::posix::realtime_ticks(CLOCK_REALTIME_COARSE));
+}
+
+void GetSystemTime(LPSYSTEMTIME time)
+{
+    timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+
+    std::tm utc;
+    gmtime_r(&now.tv_sec, &utc);
+    *time = utils::posix::to_systemtime(utc, now.tv_nsec / 1000000);
+}
+
+void GetLocalTime(LPSYSTEMTIME time)
+{
+    timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+
+    std::tm local;
+    localtime_r(&now.tv_sec, &local);
+    *time = utils::posix::to_systemtime(local, now.tv_nsec / 1000000);
+}
+
+BOOL FileTimeToSystemTime(const FILETIME *file_time, LPSYSTEMTIME system_time)
+{
+    auto ticks = static_cast<ULONGLONG>(file_time->dwHighDateTime) << 32 | file_time->dwLowDateTime;
+    auto seconds = static_cast<time_t>(ticks / 10000000ULL - 11644473600ULL);
+
+    std::tm utc;
+    if (gmtime_r(&seconds, &utc) == NULL)
+    {
+        return utils::posix::fail(ERROR_INVALID_PARAMETER);
+    }
+
+    *system_time = utils::posix::to_systemtime(utc, ticks % 10000000ULL / 10000);
+    return TRUE;
+}
+
+/** Only the current time zone of the process is supported, from `TZ` or the system configuration */
+BOOL SystemTimeToTzSpecificLocalTime(const void *, const SYSTEMTIME *utc, LPSYSTEMTIME local)
+{
+    std::tm time = {};
+    time.tm_year = utc->wYear - 1900;
+    time.tm_mon = utc->wMonth - 1;
+    time.tm_mday = utc->wDay;
+    time.tm_hour = utc->wHour;
+    time.tm_min = utc->wMinute;
+    time.tm_sec = utc->wSecond;
+
+    auto seconds = timegm(&time);
+    std::tm result;
+    if (seconds == -1 || localtime_r(&seconds, &result) == NULL)
+    {
+        return utils::posix::fail(ERROR_INVALID_PARAMETER);
+    }
+
+    *local = utils::posix::to_systemtime(result, utc->wMilliseconds);
+    return TRUE;
+}
+
+LONG CompareFileTime(const FILETIME *first, const FILETIME *second)
+{
+    auto x = static_cast<ULONGLONG>(first->dwHighDateTime) << 32 | first->dwLowDateTime,
+         y = static_cast<ULONGLONG>(second->dwHighDateTime) << 32 | second->dwLowDateTime;
+    return x < y ? -1 : (x > y ? 1 : 0);
+}
+
+ULONGLONG GetTickCount64()
+{
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return static_cast<ULONGLONG>(now.tv_sec) * 1000 + now.tv_nsec / 1000000;
+}
+
+BOOL GlobalMemoryStatusEx(LPMEMORYSTATUSEX status)
+{
+    struct sysinfo info;
+    if (sysinfo(&info) != 0)
+    {
+        return utils::posix::fail_errno();
+    }
+
+    // The available memory includes the page cache which can be reclaimed, like on Windows
+    ULONGLONG available = static_cast<ULONGLONG>(info.freeram) * info.mem_unit;
+    std::ifstream stream("/proc/meminfo");
+    std::string key;
+    ULONGLONG value;
+    while (stream >> key >> value)
+    {
+        if (key == "MemAvailable:")
+        {
+            available = value * 1024;
+            break;
+        }
+
+        stream.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+    }
+
+    auto total = static_cast<ULONGLONG>(info.totalram) * info.mem_unit;
+    status->ullTotalPhys = total;
+    status->ullAvailPhys = available;
+    status->ullTotalPageFile = total + static_cast<ULONGLONG>(info.totalswap) * info.mem_unit;
+    status->ullAvailPageFile = available + static_cast<ULONGLONG>(info.freeswap) * info.mem_unit;
+    status->ullTotalVirtual = status->ullAvailVirtual = 1ULL << 47;
+    status->ullAvailExtendedVirtual = 0;
+    status->dwMemoryLoad = total == 0 ? 0 : static_cast<DWORD>(100 - available * 100 / total);
+    return TRUE;
+}
@@ -0,0 +1,651 @@
+#pragma once
+
+/**
+ * The Win32 types, constants and structures used by the shell, for the POSIX platform layer (see `platform.hpp`).
+ *
+ * The integer types keep the names of the Windows SDK with the widths of the LP64 data model, e.g. `DWORD` is an
+ * `unsigned long`, so the formats used with them (`%lu`) are valid on both platforms. Only the fields and the values
+ * read or written by the shell are meaningful.
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <cwchar>
+
+#define WINAPI
+#define CALLBACK
+#define TRUE 1
+#define FALSE 0
+
+typedef unsigned long DWORD;
+typedef unsigned short WORD;
+typedef unsigned char BYTE;
+typedef unsigned char BOOLEAN;
+typedef int BOOL;
+typedef unsigned int UINT;
+typedef short SHORT;
+typedef long LONG;
+typedef long long LONGLONG;
+typedef unsigned long long ULONGLONG;
+typedef unsigned long long ULONG_PTR;
+typedef unsigned long long SIZE_T;
+typedef unsigned long ULONG;
+typedef ULONG *PULONG;
+typedef char CHAR;
+typedef wchar_t WCHAR;
+typedef void *HANDLE;
+typedef void *LPVOID;
+typedef const void *LPCVOID;
+typedef void *PVOID;
+typedef HANDLE HMODULE;
+typedef HANDLE *PHANDLE;
+typedef HANDLE *LPHANDLE;
+typedef long HRESULT;
+typedef wchar_t *LPWSTR;
+typedef const wchar_t *LPCWSTR;
+typedef const wchar_t *PCWSTR;
+typedef wchar_t *PWSTR;
+typedef char *LPSTR;
+typedef const char *LPCSTR;
+typedef DWORD *LPDWORD;
+typedef BOOL *LPBOOL;
+typedef DWORD COLORREF;
+
+#define TEXT(x) L##x
+#define MAX_PATH 260
+#define INFINITE 0xFFFFFFFF
+#define STILL_ACTIVE 259
+#define STATUS_CONTROL_C_EXIT 0xC000013AL
+#define STATUS_STACK_BUFFER_OVERRUN 0xC0000409L
+#define S_OK 0
+#define E_NOT_SUFFICIENT_BUFFER ((HRESULT)0x8007007AL)
+
+#define WAIT_OBJECT_0 0
+#define WAIT_TIMEOUT 258
+#define WAIT_FAILED ((DWORD)0xFFFFFFFF)
+#define MAXIMUM_WAIT_OBJECTS 64
+
+#define ERROR_SUCCESS 0
+#define ERROR_INVALID_FUNCTION 1
+#define ERROR_FILE_NOT_FOUND 2
+#define ERROR_PATH_NOT_FOUND 3
+#define ERROR_ACCESS_DENIED 5
+#define ERROR_INVALID_HANDLE 6
+#define ERROR_NOT_ENOUGH_MEMORY 8
+#define ERROR_NOT_SAME_DEVICE 17
+#define ERROR_NO_MORE_FILES 18
+#define ERROR_GEN_FAILURE 31
+#define ERROR_HANDLE_EOF 38
+#define ERROR_NOT_SUPPORTED 50
+#define ERROR_FILE_EXISTS 80
+#define ERROR_INVALID_PARAMETER 87
+#define ERROR_BROKEN_PIPE 109
+#define ERROR_DISK_FULL 112
+#define ERROR_INSUFFICIENT_BUFFER 122
+#define ERROR_DIR_NOT_EMPTY 145
+#define ERROR_BUSY 170
+#define ERROR_ALREADY_EXISTS 183
+#define ERROR_BAD_EXE_FORMAT 193
+#define ERROR_ENVVAR_NOT_FOUND 203
+#define ERROR_FILENAME_EXCED_RANGE 206
+#define ERROR_PIPE_BUSY 231
+#define ERROR_MORE_DATA 234
+#define ERROR_PIPE_CONNECTED 535
+#define ERROR_OPERATION_ABORTED 995
+#define ERROR_IO_PENDING 997
+#define ERROR_FILE_INVALID 1006
+#define ERROR_NO_UNICODE_TRANSLATION 1113
+#define ERROR_REQUEST_ABORTED 1235
+#define ERROR_CANT_RESOLVE_FILENAME 1921
+#define ERROR_INTERNET_INVALID_URL 12005
+
+#define FOREGROUND_BLUE 0x1
+#define FOREGROUND_GREEN 0x2
+#define FOREGROUND_RED 0x4
+#define FOREGROUND_INTENSITY 0x8
+
+#define STD_INPUT_HANDLE ((DWORD)-10)
+#define STD_OUTPUT_HANDLE ((DWORD)-11)
+#define STD_ERROR_HANDLE ((DWORD)-12)
+#define INVALID_HANDLE_VALUE ((HANDLE)(long long)-1)
+
+#define DELETE 0x00010000L
+#define SYNCHRONIZE 0x00100000L
+#define GENERIC_READ 0x80000000L
+#define GENERIC_WRITE 0x40000000L
+#define FILE_LIST_DIRECTORY 0x1
+#define FILE_WRITE_DATA 0x2
+#define FILE_APPEND_DATA 0x4
+#define FILE_SHARE_READ 0x1
+#define FILE_SHARE_WRITE 0x2
+#define FILE_SHARE_DELETE 0x4
+
+#define CREATE_NEW 1
+#define CREATE_ALWAYS 2
+#define OPEN_EXISTING 3
+#define OPEN_ALWAYS 4
+#define TRUNCATE_EXISTING 5
+
+#define FILE_BEGIN 0
+
+#define FILE_ATTRIBUTE_READONLY 0x1
+#define FILE_ATTRIBUTE_HIDDEN 0x2
+#define FILE_ATTRIBUTE_DIRECTORY 0x10
+#define FILE_ATTRIBUTE_NORMAL 0x80
+#define FILE_ATTRIBUTE_TEMPORARY 0x100
+#define FILE_ATTRIBUTE_SPARSE_FILE 0x200
+#define FILE_ATTRIBUTE_REPARSE_POINT 0x400
+#define INVALID_FILE_ATTRIBUTES ((DWORD)-1)
+
+#define FILE_FLAG_OVERLAPPED 0x40000000
+#define FILE_FLAG_SEQUENTIAL_SCAN 0x08000000
+#define FILE_FLAG_DELETE_ON_CLOSE 0x04000000
+#define FILE_FLAG_BACKUP_SEMANTICS 0x02000000
+#define FILE_FLAG_OPEN_REPARSE_POINT 0x00200000
+
+#define FILE_NOTIFY_CHANGE_FILE_NAME 0x1
+#define FILE_NOTIFY_CHANGE_DIR_NAME 0x2
+#define FILE_NOTIFY_CHANGE_ATTRIBUTES 0x4
+#define FILE_NOTIFY_CHANGE_SIZE 0x8
+#define FILE_NOTIFY_CHANGE_LAST_WRITE 0x10
+#define FILE_ACTION_ADDED 1
+#define FILE_ACTION_REMOVED 2
+#define FILE_ACTION_MODIFIED 3
+#define FILE_ACTION_RENAMED_OLD_NAME 4
+#define FILE_ACTION_RENAMED_NEW_NAME 5
+
+#define FILE_CASE_SENSITIVE_SEARCH 0x1
+#define FILE_CASE_PRESERVED_NAMES 0x2
+#define FILE_UNICODE_ON_DISK 0x4
+#define FILE_FILE_COMPRESSION 0x10
+#define FILE_VOLUME_QUOTAS 0x20
+#define FILE_SUPPORTS_SPARSE_FILES 0x40
+#define FILE_SUPPORTS_REPARSE_POINTS 0x80
+#define FILE_SUPPORTS_REMOTE_STORAGE 0x100
+#define FILE_SUPPORTS_POSIX_UNLINK_RENAME 0x400
+#define FILE_VOLUME_IS_COMPRESSED 0x8000
+#define FILE_SUPPORTS_OBJECT_IDS 0x10000
+#define FILE_SUPPORTS_ENCRYPTION 0x20000
+#define FILE_NAMED_STREAMS 0x40000
+#define FILE_READ_ONLY_VOLUME 0x80000
+#define FILE_SUPPORTS_BLOCK_REFCOUNTING 0x08000000
+
+#define FILE_DISPOSITION_FLAG_DELETE 0x1
+#define FILE_DISPOSITION_FLAG_POSIX_SEMANTICS 0x2
+#define FILE_DISPOSITION_FLAG_IGNORE_READONLY_ATTRIBUTE 0x10
+
+#define FSCTL_SET_SPARSE 0x900c4
+#define FSCTL_DUPLICATE_EXTENTS_TO_FILE 0x98344
+
+#define COPY_FILE_FAIL_IF_EXISTS 0x1
+#define COPY_FILE_COPY_SYMLINK 0x800
+#define COPY_FILE_NO_BUFFERING 0x1000
+#define PROGRESS_CONTINUE 0
+#define MOVEFILE_REPLACE_EXISTING 0x1
+
+#define FIND_FIRST_EX_LARGE_FETCH 0x2
+
+#define PAGE_READONLY 0x2
+#define FILE_MAP_WRITE 0x2
+#define FILE_MAP_READ 0x4
+
+#define CTRL_C_EVENT 0
+#define CTRL_BREAK_EVENT 1
+
+#define CREATE_SUSPENDED 0x4
+#define CREATE_NEW_PROCESS_GROUP 0x200
+#define STARTF_USESTDHANDLES 0x100
+#define HANDLE_FLAG_INHERIT 0x1
+#define DUPLICATE_SAME_ACCESS 0x2
+#define PROCESS_DUP_HANDLE 0x40
+#define PROCESS_QUERY_LIMITED_INFORMATION 0x1000
+#define SCS_64BIT_BINARY 6
+
+#define WT_EXECUTEONLYONCE 0x8
+#define CREATE_WAITABLE_TIMER_MANUAL_RESET 0x1
+#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x2
+#define TIMER_ALL_ACCESS 0x1F0003
+
+#define JOB_OBJECT_LIMIT_PROCESS_MEMORY 0x100
+#define JOB_OBJECT_LIMIT_JOB_MEMORY 0x200
+#define JOB_OBJECT_LIMIT_KILL_ON_JOB_CLOSE 0x2000
+#define JOB_OBJECT_CPU_RATE_CONTROL_ENABLE 0x1
+#define JOB_OBJECT_CPU_RATE_CONTROL_HARD_CAP 0x4
+
+#define PIPE_ACCESS_DUPLEX 0x3
+#define PIPE_TYPE_MESSAGE 0x4
+#define PIPE_READMODE_MESSAGE 0x2
+#define PIPE_WAIT 0x0
+#define PIPE_REJECT_REMOTE_CLIENTS 0x8
+#define PIPE_UNLIMITED_INSTANCES 255
+#define FILE_FLAG_FIRST_PIPE_INSTANCE 0x00080000
+#define NMPWAIT_WAIT_FOREVER 0xFFFFFFFF
+
+#define TOKEN_QUERY 0x8
+#define SDDL_REVISION_1 1
+
+#define CP_UTF8 65001
+#define MB_ERR_INVALID_CHARS 0x8
+#define WC_ERR_INVALID_CHARS 0x80
+#define CSTR_LESS_THAN 1
+#define CSTR_EQUAL 2
+#define CSTR_GREATER_THAN 3
+
+#define KEY_EVENT 0x1
+#define LEFT_CTRL_PRESSED 0x8
+#define RIGHT_CTRL_PRESSED 0x4
+#define VK_ESCAPE 0x1B
+#define VK_END 0x23
+#define VK_HOME 0x24
+#define VK_LEFT 0x25
+#define VK_UP 0x26
+#define VK_RIGHT 0x27
+#define VK_DOWN 0x28
+#define VK_DELETE 0x2E
+
+#define RGB(r, g, b) ((COLORREF)(((BYTE)(r) | ((WORD)((BYTE)(g)) << 8)) | (((DWORD)(BYTE)(b)) << 16)))
+#define ZeroMemory(destination, length) std::memset((destination), 0, (length))
+#define GetProcessMemoryInfo K32GetProcessMemoryInfo
+
+typedef struct _FILETIME
+{
+    DWORD dwLowDateTime;
+    DWORD dwHighDateTime;
+} FILETIME, *LPFILETIME;
+
+typedef union _LARGE_INTEGER
+{
+    LONGLONG QuadPart;
+} LARGE_INTEGER, *PLARGE_INTEGER;
+
+typedef union _ULARGE_INTEGER
+{
+    ULONGLONG QuadPart;
+} ULARGE_INTEGER;
+
+typedef struct _SYSTEMTIME
+{
+    WORD wYear, wMonth, wDayOfWeek, wDay, wHour, wMinute, wSecond, wMilliseconds;
+} SYSTEMTIME, *LPSYSTEMTIME;
+
+typedef struct _SECURITY_ATTRIBUTES
+{
+    DWORD nLength;
+    LPVOID lpSecurityDescriptor;
+    BOOL bInheritHandle;
+} SECURITY_ATTRIBUTES, *LPSECURITY_ATTRIBUTES;
+
+typedef void *PSID;
+typedef void *PSECURITY_DESCRIPTOR;
+typedef void *HLOCAL;
+
+typedef struct _SID_AND_ATTRIBUTES
+{
+    PSID Sid;
+    DWORD Attributes;
+} SID_AND_ATTRIBUTES;
+
+typedef struct _TOKEN_USER
+{
+    SID_AND_ATTRIBUTES User;
+} TOKEN_USER;
+
+typedef enum _TOKEN_INFORMATION_CLASS
+{
+    TokenUser = 1
+} TOKEN_INFORMATION_CLASS;
+
+typedef struct _OVERLAPPED
+{
+    ULONG_PTR Internal;
+    ULONG_PTR InternalHigh;
+    union
+    {
+        struct
+        {
+            DWORD Offset;
+            DWORD OffsetHigh;
+        };
+        PVOID Pointer;
+    };
+    HANDLE hEvent;
+} OVERLAPPED, *LPOVERLAPPED;
+
+typedef void(CALLBACK *LPOVERLAPPED_COMPLETION_ROUTINE)(DWORD, DWORD, LPOVERLAPPED);
+typedef void(CALLBACK *WAITORTIMERCALLBACK)(PVOID, BOOLEAN);
+typedef BOOL(WINAPI *PHANDLER_ROUTINE)(DWORD);
+typedef DWORD(CALLBACK *LPPROGRESS_ROUTINE)(LARGE_INTEGER, LARGE_INTEGER, LARGE_INTEGER, LARGE_INTEGER, DWORD, DWORD, HANDLE, HANDLE, LPVOID);
+
+/* Console */
+
+typedef struct _COORD
+{
+    SHORT X;
+    SHORT Y;
+} COORD;
+
+typedef struct _SMALL_RECT
+{
+    SHORT Left, Top, Right, Bottom;
+} SMALL_RECT;
+
+typedef struct _CHAR_INFO
+{
+    union
+    {
+        WCHAR UnicodeChar;
+        CHAR AsciiChar;
+    } Char;
+    WORD Attributes;
+} CHAR_INFO;
+
+typedef struct _CONSOLE_SCREEN_BUFFER_INFO
+{
+    COORD dwSize;
+    COORD dwCursorPosition;
+    WORD wAttributes;
+    SMALL_RECT srWindow;
+    COORD dwMaximumWindowSize;
+} CONSOLE_SCREEN_BUFFER_INFO;
+
+typedef struct _CONSOLE_SCREEN_BUFFER_INFOEX
+{
+    ULONG cbSize;
+    COORD dwSize;
+    COORD dwCursorPosition;
+    WORD wAttributes;
+    SMALL_RECT srWindow;
+    COORD dwMaximumWindowSize;
+    WORD wPopupAttributes;
+    BOOL bFullscreenSupported;
+    COLORREF ColorTable[16];
+} CONSOLE_SCREEN_BUFFER_INFOEX;
+
+typedef struct _KEY_EVENT_RECORD
+{
+    BOOL bKeyDown;
+    WORD wRepeatCount;
+    WORD wVirtualKeyCode;
+    WORD wVirtualScanCode;
+    union
+    {
+        WCHAR UnicodeChar;
+        CHAR AsciiChar;
+    } uChar;
+    DWORD dwControlKeyState;
+} KEY_EVENT_RECORD;
+
+typedef struct _INPUT_RECORD
+{
+    WORD EventType;
+    union
+    {
+        KEY_EVENT_RECORD KeyEvent;
+    } Event;
+} INPUT_RECORD;
+
+/* Files */
+
+typedef struct _WIN32_FIND_DATAW
+{
+    DWORD dwFileAttributes;
+    FILETIME ftCreationTime;
+    FILETIME ftLastAccessTime;
+    FILETIME ftLastWriteTime;
+    DWORD nFileSizeHigh;
+    DWORD nFileSizeLow;
+    DWORD dwReserved0;
+    DWORD dwReserved1;
+    WCHAR cFileName[MAX_PATH];
+    WCHAR cAlternateFileName[14];
+} WIN32_FIND_DATAW, *LPWIN32_FIND_DATAW;
+
+typedef struct _WIN32_FILE_ATTRIBUTE_DATA
+{
+    DWORD dwFileAttributes;
+    FILETIME ftCreationTime;
+    FILETIME ftLastAccessTime;
+    FILETIME ftLastWriteTime;
+    DWORD nFileSizeHigh;
+    DWORD nFileSizeLow;
+} WIN32_FILE_ATTRIBUTE_DATA;
+
+typedef enum _GET_FILEEX_INFO_LEVELS
+{
+    GetFileExInfoStandard
+} GET_FILEEX_INFO_LEVELS;
+
+typedef enum _FINDEX_INFO_LEVELS
+{
+    FindExInfoStandard,
+    FindExInfoBasic
+} FINDEX_INFO_LEVELS;
+
+typedef enum _FINDEX_SEARCH_OPS
+{
+    FindExSearchNameMatch,
+    FindExSearchLimitToDirectories
+} FINDEX_SEARCH_OPS;
+
+typedef enum _FILE_INFO_BY_HANDLE_CLASS
+{
+    FileBasicInfo = 0,
+    FileStandardInfo = 1,
+    FileDispositionInfo = 4,
+    FileEndOfFileInfo = 6,
+    FileFullDirectoryInfo = 14,
+    FileFullDirectoryRestartInfo = 15,
+    FileDispositionInfoEx = 21
+} FILE_INFO_BY_HANDLE_CLASS;
+
+typedef struct _FILE_BASIC_INFO
+{
+    LARGE_INTEGER CreationTime;
+    LARGE_INTEGER LastAccessTime;
+    LARGE_INTEGER LastWriteTime;
+    LARGE_INTEGER ChangeTime;
+    DWORD FileAttributes;
+} FILE_BASIC_INFO;
+
+typedef struct _FILE_STANDARD_INFO
+{
+    LARGE_INTEGER AllocationSize;
+    LARGE_INTEGER EndOfFile;
+    DWORD NumberOfLinks;
+    BOOLEAN DeletePending;
+    BOOLEAN Directory;
+} FILE_STANDARD_INFO;
+
+typedef struct _FILE_FULL_DIR_INFO
+{
+    ULONG NextEntryOffset;
+    ULONG FileIndex;
+    LARGE_INTEGER CreationTime;
+    LARGE_INTEGER LastAccessTime;
+    LARGE_INTEGER LastWriteTime;
+    LARGE_INTEGER ChangeTime;
+    LARGE_INTEGER EndOfFile;
+    LARGE_INTEGER AllocationSize;
+    ULONG FileAttributes;
+    ULONG FileNameLength;
+    ULONG EaSize;
+    WCHAR FileName[1];
+} FILE_FULL_DIR_INFO;
+
+typedef struct _FILE_DISPOSITION_INFO
+{
+    BOOLEAN DeleteFile;
+} FILE_DISPOSITION_INFO;
+
+typedef struct _FILE_DISPOSITION_INFO_EX
+{
+    DWORD Flags;
+} FILE_DISPOSITION_INFO_EX;
+
+typedef struct _FILE_END_OF_FILE_INFO
+{
+    LARGE_INTEGER EndOfFile;
+} FILE_END_OF_FILE_INFO;
+
+typedef struct _FILE_NOTIFY_INFORMATION
+{
+    DWORD NextEntryOffset;
+    DWORD Action;
+    DWORD FileNameLength;
+    WCHAR FileName[1];
+} FILE_NOTIFY_INFORMATION;
+
+typedef struct _DUPLICATE_EXTENTS_DATA
+{
+    HANDLE FileHandle;
+    LARGE_INTEGER SourceFileOffset;
+    LARGE_INTEGER TargetFileOffset;
+    LARGE_INTEGER ByteCount;
+} DUPLICATE_EXTENTS_DATA;
+
+/* Processes */
+
+typedef struct _STARTUPINFOW
+{
+    DWORD cb;
+    LPWSTR lpReserved;
+    LPWSTR lpDesktop;
+    LPWSTR lpTitle;
+    DWORD dwX, dwY, dwXSize, dwYSize, dwXCountChars, dwYCountChars, dwFillAttribute, dwFlags;
+    WORD wShowWindow;
+    WORD cbReserved2;
+    BYTE *lpReserved2;
+    HANDLE hStdInput;
+    HANDLE hStdOutput;
+    HANDLE hStdError;
+} STARTUPINFOW, *LPSTARTUPINFOW;
+
+typedef struct _PROCESS_INFORMATION
+{
+    HANDLE hProcess;
+    HANDLE hThread;
+    DWORD dwProcessId;
+    DWORD dwThreadId;
+} PROCESS_INFORMATION, *LPPROCESS_INFORMATION;
+
+typedef struct _IO_COUNTERS
+{
+    ULONGLONG ReadOperationCount, WriteOperationCount, OtherOperationCount;
+    ULONGLONG ReadTransferCount, WriteTransferCount, OtherTransferCount;
+} IO_COUNTERS;
+
+typedef struct _PROCESS_MEMORY_COUNTERS
+{
+    DWORD cb;
+    DWORD PageFaultCount;
+    SIZE_T PeakWorkingSetSize;
+    SIZE_T WorkingSetSize;
+    SIZE_T QuotaPeakPagedPoolUsage;
+    SIZE_T QuotaPagedPoolUsage;
+    SIZE_T QuotaPeakNonPagedPoolUsage;
+    SIZE_T QuotaNonPagedPoolUsage;
+    SIZE_T PagefileUsage;
+    SIZE_T PeakPagefileUsage;
+} PROCESS_MEMORY_COUNTERS;
+
+typedef struct _MEMORYSTATUSEX
+{
+    DWORD dwLength;
+    DWORD dwMemoryLoad;
+    ULONGLONG ullTotalPhys, ullAvailPhys, ullTotalPageFile, ullAvailPageFile, ullTotalVirtual, ullAvailVirtual, ullAvailExtendedVirtual;
+} MEMORYSTATUSEX, *LPMEMORYSTATUSEX;
+
+typedef struct _JOBOBJECT_BASIC_LIMIT_INFORMATION
+{
+    LARGE_INTEGER PerProcessUserTimeLimit;
+    LARGE_INTEGER PerJobUserTimeLimit;
+    DWORD LimitFlags;
+    SIZE_T MinimumWorkingSetSize;
+    SIZE_T MaximumWorkingSetSize;
+    DWORD ActiveProcessLimit;
+    ULONG_PTR Affinity;
+    DWORD PriorityClass;
+    DWORD SchedulingClass;
+} JOBOBJECT_BASIC_LIMIT_INFORMATION;
+
+typedef struct _JOBOBJECT_EXTENDED_LIMIT_INFORMATION
+{
+    JOBOBJECT_BASIC_LIMIT_INFORMATION BasicLimitInformation;
+    IO_COUNTERS IoInfo;
+    SIZE_T ProcessMemoryLimit;
+    SIZE_T JobMemoryLimit;
+    SIZE_T PeakProcessMemoryUsed;
+    SIZE_T PeakJobMemoryUsed;
+} JOBOBJECT_EXTENDED_LIMIT_INFORMATION;
+
+typedef struct _JOBOBJECT_BASIC_ACCOUNTING_INFORMATION
+{
+    LARGE_INTEGER TotalUserTime;
+    LARGE_INTEGER TotalKernelTime;
+    LARGE_INTEGER ThisPeriodTotalUserTime;
+    LARGE_INTEGER ThisPeriodTotalKernelTime;
+    DWORD TotalPageFaultCount;
+    DWORD TotalProcesses;
+    DWORD ActiveProcesses;
+    DWORD TotalTerminatedProcesses;
+} JOBOBJECT_BASIC_ACCOUNTING_INFORMATION;
+
+typedef struct JOBOBJECT_BASIC_AND_IO_ACCOUNTING_INFORMATION
+{
+    JOBOBJECT_BASIC_ACCOUNTING_INFORMATION BasicInfo;
+    IO_COUNTERS IoInfo;
+} JOBOBJECT_BASIC_AND_IO_ACCOUNTING_INFORMATION;
+
+typedef struct _JOBOBJECT_CPU_RATE_CONTROL_INFORMATION
+{
+    DWORD ControlFlags;
+    union
+    {
+        DWORD CpuRate;
+        DWORD Weight;
+    };
+} JOBOBJECT_CPU_RATE_CONTROL_INFORMATION;
+
+typedef enum _JOBOBJECTINFOCLASS
+{
+    JobObjectBasicAccountingInformation = 1,
+    JobObjectBasicLimitInformation = 2,
+    JobObjectBasicAndIoAccountingInformation = 8,
+    JobObjectExtendedLimitInformation = 9,
+    JobObjectCpuRateControlInformation = 15
+} JOBOBJECTINFOCLASS;
+
+/* Internet */
+
+typedef void *HINTERNET;
+typedef WORD INTERNET_PORT;
+
+typedef enum
+{
+    INTERNET_SCHEME_UNKNOWN = -1,
+    INTERNET_SCHEME_HTTP = 3,
+    INTERNET_SCHEME_HTTPS = 4
+} INTERNET_SCHEME;
+
+typedef struct _URL_COMPONENTSW
+{
+    DWORD dwStructSize;
+    LPWSTR lpszScheme;
+    DWORD dwSchemeLength;
+    INTERNET_SCHEME nScheme;
+    LPWSTR lpszHostName;
+    DWORD dwHostNameLength;
+    INTERNET_PORT nPort;
+    LPWSTR lpszUserName;
+    DWORD dwUserNameLength;
+    LPWSTR lpszPassword;
+    DWORD dwPasswordLength;
+    LPWSTR lpszUrlPath;
+    DWORD dwUrlPathLength;
+    LPWSTR lpszExtraInfo;
+    DWORD dwExtraInfoLength;
+} URL_COMPONENTSW;
+
+#define INTERNET_DEFAULT_HTTP_PORT 80
+#define INTERNET_DEFAULT_HTTPS_PORT 443
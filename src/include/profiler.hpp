@@ -0,0 +1,325 @@
+#pragma once
+
+#include "arena.hpp"
+#include "tables.hpp"
+
+namespace liteshell
+{
+    /**
+     * @brief Timing statistics of the instructions executed by the shell, collected by the `profile` command.
+     *
+     * Time is accounted per source line and per built-in command, split into phases. The phases of an instruction
+     * do not overlap, so their sum is close to the wall time of the instruction. Optionally, every measured interval
+     * is also kept as an event of a [Chrome trace](https://docs.google.com/document/d/1CvAClvFfyA5R-PhYUmn5OOQtYMH4h6I0nSsKchNAySU),
+     * which can be opened in `chrome://tracing` or [Perfetto](https://ui.perfetto.dev).
+     *
+     * A profiler is only updated by the thread running the shell: the stages of a pipeline which run on their own
+     * threads are accounted for as a whole, by the line of the pipeline.
+     */
+    class Profiler
+    {
+    public:
+        typedef std::chrono::steady_clock clock;
+
+        /** @brief The phases the execution time of an instruction is split into */
+        enum Phase
+        {
+            /** @brief Resolving environment variables, tokenizing and looking up the command */
+            RESOLVE,
+
+            /** @brief Parsing the arguments of a built-in command */
+            PARSE,
+
+            /** @brief Running a built-in command or creating a subprocess */
+            EXECUTE,
+
+            /** @brief Waiting for subprocesses to exit */
+            WAIT,
+
+            PHASES
+        };
+
+        /** @brief The accumulated statistics of a line or a built-in command */
+        struct Entry
+        {
+            /** @brief The number of executions */
+            std::size_t count = 0;
+
+            /** @brief The total wall time of all executions */
+            clock::duration total{0};
+
+            /** @brief The total time spent in each phase */
+            clock::duration phases[PHASES] = {};
+
+            /** @brief The total number of heap allocations of the shell thread, see `utils::allocations` */
+            std::size_t allocations = 0;
+
+            /** @brief The average wall time of an execution */
+            clock::duration mean() const
+            {
+                return count == 0 ? clock::duration(0) : total / static_cast<clock::duration::rep>(count);
+            }
+        };
+
+    private:
+        struct _Event
+        {
+            const char *category;
+            std::string name;
+            clock::time_point start;
+            clock::duration duration;
+        };
+
+        const clock::time_point _epoch = clock::now();
+
+        std::unordered_map<std::string, Entry> _lines, _commands;
+
+        /** @brief The entries which the current measurements are accounted to, or `nullptr` */
+        Entry *_line = nullptr, *_command = nullptr;
+
+        /** @brief The path to write the trace to, or an empty string if no trace should be recorded */
+        const std::string _trace;
+        std::vector<_Event> _events;
+
+        Profiler(const Profiler &) = delete;
+        Profiler &operator=(const Profiler &) = delete;
+
+        void _event(const char *category, const std::string &name, const clock::time_point &start, const clock::duration &duration)
+        {
+            if (!_trace.empty())
+            {
+                _events.push_back({category, name, start, duration});
+            }
+        }
+
+        static std::string _escape(const std::string &value)
+        {
+            std::string result;
+            result.reserve(value.size());
+            for (unsigned char c : value)
+            {
+                if (c == '"' || c == '\\')
+                {
+                    result += '\\';
+                    result += c;
+                }
+                else if (c < 0x20)
+                {
+                    result += utils::format("\\u%04x", c);
+                }
+                else
+                {
+                    result += c;
+                }
+            }
+
+            return result;
+        }
+
+        static std::string _milliseconds(const clock::duration &duration)
+        {
+            return utils::format("%.3f", std::chrono::duration<double, std::milli>(duration).count());
+        }
+
+        static void _display(const char *header, const std::unordered_map<std::string, Entry> &entries, const std::size_t top)
+        {
+            std::vector<std::pair<const std::string *, const Entry *>> sorted;
+            for (auto &[name, entry] : entries)
+            {
+                sorted.emplace_back(&name, &entry);
+            }
+
+            auto count = std::min(top, sorted.size());
+            std::partial_sort(
+                sorted.begin(), sorted.begin() + count, sorted.end(),
+                [](const auto &first, const auto &second)
+                {
+                    return first.second->total > second.second->total;
+                });
+
+            utils::Table table(header, "Calls", "Total (ms)", "Mean (ms)", "Resolve (ms)", "Parse (ms)", "Execute (ms)", "Wait (ms)", "Allocations/call");
+            table.limits[0] = 50;
+            for (std::size_t i = 0; i < count; i++)
+            {
+                auto &entry = *sorted[i].second;
+                table.add_row(
+                    *sorted[i].first,
+                    std::to_string(entry.count),
+                    _milliseconds(entry.total),
+                    _milliseconds(entry.mean()),
+                    _milliseconds(entry.phases[RESOLVE]),
+                    _milliseconds(entry.phases[PARSE]),
+                    _milliseconds(entry.phases[EXECUTE]),
+                    _milliseconds(entry.phases[WAIT]),
+                    utils::ALLOCATIONS_COUNTED
+                        ? utils::format("%.1f", static_cast<double>(entry.allocations) / static_cast<double>(std::max<std::size_t>(entry.count, 1)))
+                        : "-");
+            }
+
+            std::cout << table.display();
+        }
+
+    public:
+        /**
+         * @brief A measurement of one phase, accounted to the current line and built-in command when it is stopped or goes
+         * out of scope
+         *
+         * A span of a `nullptr` profiler does nothing, not even reading the clock.
+         */
+        class Span
+        {
+        private:
+            std::shared_ptr<Profiler> _profiler;
+            const Phase _phase;
+            const clock::time_point _start;
+
+            Span(const Span &) = delete;
+            Span &operator=(const Span &) = delete;
+
+        public:
+            Span(const std::shared_ptr<Profiler> &profiler, const Phase phase)
+                : _profiler(profiler), _phase(phase), _start(profiler != nullptr ? clock::now() : clock::time_point()) {}
+
+            ~Span()
+            {
+                stop();
+            }
+
+            /** @brief End the measurement before the span goes out of scope, later calls do nothing */
+            void stop()
+            {
+                if (_profiler != nullptr)
+                {
+                    auto duration = clock::now() - _start;
+                    for (auto entry : {_profiler->_line, _profiler->_command})
+                    {
+                        if (entry != nullptr)
+                        {
+                            entry->phases[_phase] += duration;
+                        }
+                    }
+
+                    static const char *names[PHASES] = {"resolve", "parse", "execute", "wait"};
+                    _profiler->_event("phase", names[_phase], _start, duration);
+                    _profiler = nullptr;
+                }
+            }
+        };
+
+        /** @brief The execution of a line or a built-in command, which the spans in its scope are accounted to */
+        class Scope
+        {
+        private:
+            const std::shared_ptr<Profiler> _profiler;
+            const bool _command;
+            const clock::time_point _start;
+            const std::size_t _allocations;
+            Entry *_entry = nullptr, *_previous = nullptr;
+            const std::string *_name = nullptr;
+
+            Scope(const Scope &) = delete;
+            Scope &operator=(const Scope &) = delete;
+
+        public:
+            /**
+             * @param profiler The profiler to update, may be `nullptr`
+             * @param name The source of the line, or the name of the built-in command
+             * @param command Whether this is the execution of a built-in command rather than a line
+             */
+            Scope(const std::shared_ptr<Profiler> &profiler, const std::string &name, const bool command)
+                : _profiler(profiler),
+                  _command(command),
+                  _start(profiler != nullptr ? clock::now() : clock::time_point()),
+                  _allocations(utils::allocations())
+            {
+                if (_profiler != nullptr)
+                {
+                    auto &entries = command ? _profiler->_commands : _profiler->_lines;
+                    auto iter = entries.try_emplace(name).first;
+                    _name = &iter->first;
+                    _entry = &iter->second;
+                    _entry->count++;
+
+                    auto &current = command ? _profiler->_command : _profiler->_line;
+                    _previous = current;
+                    current = _entry;
+                }
+            }
+
+            ~Scope()
+            {
+                if (_profiler != nullptr)
+                {
+                    auto duration = clock::now() - _start;
+                    _entry->total += duration;
+                    _entry->allocations += utils::allocations() - _allocations;
+                    (_command ? _profiler->_command : _profiler->_line) = _previous;
+
+                    _profiler->_event(_command ? "command" : "line", *_name, _start, duration);
+                }
+            }
+        };
+
+        /**
+         * @brief Construct a new `Profiler` object
+         *
+         * @param trace The path to write a Chrome trace to when `write_trace` is called, or an empty string
+         */
+        explicit Profiler(const std::string &trace) : _trace(trace) {}
+
+        /** @brief The statistics of each line, by source */
+        const std::unordered_map<std::string, Entry> &lines() const
+        {
+            return _lines;
+        }
+
+        /** @brief The statistics of each built-in command, by name */
+        const std::unordered_map<std::string, Entry> &commands() const
+        {
+            return _commands;
+        }
+
+        /**
+         * @brief Print the lines and the built-in commands which took the most time
+         *
+         * @param top The maximum number of rows of each table
+         */
+        void display(const std::size_t top) const
+        {
+            _display("Line", _lines, top);
+            std::cout << '\n';
+            _display("Command", _commands, top);
+        }
+
+        /** @brief Write the recorded events to the trace file, if one was requested */
+        void write_trace() const
+        {
+            if (_trace.empty())
+            {
+                return;
+            }
+
+            std::ofstream output(_trace, std::ios::binary);
+            if (!output)
+            {
+                throw std::runtime_error(utils::format("Cannot open trace file \"%s\"", _trace.c_str()));
+            }
+
+            // Complete events ("ph": "X") with timestamps in microseconds
+            output << "{\"traceEvents\":[";
+            for (std::size_t i = 0; i < _events.size(); i++)
+            {
+                auto &event = _events[i];
+                output << (i == 0 ? "\n" : ",\n")
+                       << utils::format(
+                              "{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":1}",
+                              _escape(event.name).c_str(),
+                              event.category,
+                              std::chrono::duration<double, std::micro>(event.start - _epoch).count(),
+                              std::chrono::duration<double, std::micro>(event.duration).count());
+            }
+
+            output << "\n]}\n";
+        }
+    };
+}
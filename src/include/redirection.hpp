@@ -0,0 +1,319 @@
+#pragma once
+
+#include "converter.hpp"
+#include "pipe.hpp"
+
+namespace liteshell
+{
+    /**
+     * @brief An output redirection of a command, e.g. `> file`, `>> file`, `2> file` or `2>&1`.
+     */
+    class Redirection
+    {
+    private:
+        static bool _is_space(const char c)
+        {
+            return c == ' ' || c == '\t';
+        }
+
+        /**
+         * @brief Scan the redirections of a line
+         *
+         * @param source The line to scan, which must not be a pipeline
+         * @param callback A function invoked with the range [begin, end) of each redirection in `source` and the
+         * redirection itself
+         */
+        static void _scan(
+            const std::string_view &source,
+            const std::function<void(std::size_t, std::size_t, Redirection &&)> &callback)
+        {
+            bool quoted = false;
+            for (std::size_t i = 0; i < source.size(); i++)
+            {
+                if (source[i] == '"')
+                {
+                    quoted = !quoted;
+                    continue;
+                }
+
+                if (quoted || source[i] != '>')
+                {
+                    continue;
+                }
+
+                auto begin = i;
+                int descriptor = STDOUT;
+                if (i > 0 && source[i - 1] == '2' && (i == 1 || _is_space(source[i - 2])))
+                {
+                    descriptor = STDERR;
+                    begin--;
+                }
+
+                bool append = i + 1 < source.size() && source[i + 1] == '>';
+                i += append ? 2 : 1;
+                while (i < source.size() && _is_space(source[i]))
+                {
+                    i++;
+                }
+
+                std::string target;
+                if (i < source.size() && source[i] == '"')
+                {
+                    auto end = source.find('"', i + 1);
+                    if (end == std::string_view::npos)
+                    {
+                        end = source.size();
+                    }
+
+                    target = source.substr(i + 1, end - i - 1);
+                    i = std::min(end + 1, source.size());
+                }
+                else
+                {
+                    auto start = i;
+                    while (i < source.size() && !_is_space(source[i]) && source[i] != '>' && source[i] != '"')
+                    {
+                        i++;
+                    }
+
+                    target = source.substr(start, i - start);
+                }
+
+                callback(begin, i, Redirection(descriptor, append, target));
+                i--;
+            }
+        }
+
+    public:
+        /** @brief The descriptor of the standard output */
+        static const int STDOUT = 1;
+
+        /** @brief The descriptor of the standard error */
+        static const int STDERR = 2;
+
+        /** @brief The target of `2>&1`, which redirects the standard error to the standard output */
+        static const std::string SAME_AS_STDOUT;
+
+        /** @brief The redirected descriptor, either `STDOUT` or `STDERR` */
+        const int descriptor;
+
+        /** @brief Whether the output is appended to the target instead of overwriting it */
+        const bool append;
+
+        /** @brief The path to the target file, which may reference environment variables */
+        const std::string target;
+
+        /** @brief Construct a new `Redirection` object */
+        Redirection(const int descriptor, const bool append, const std::string &target)
+            : descriptor(descriptor), append(append), target(target) {}
+
+        /**
+         * @brief Extract the redirections of a line
+         *
+         * Redirection operators inside double quotes are ignored.
+         *
+         * @param source The line to parse, which must not be a pipeline
+         * @return The redirections of the line, from left to right
+         */
+        static std::vector<Redirection> parse(const std::string_view &source)
+        {
+            std::vector<Redirection> result;
+            _scan(
+                source,
+                [&result](std::size_t, std::size_t, Redirection &&redirection)
+                {
+                    result.push_back(std::move(redirection));
+                });
+
+            return result;
+        }
+
+        /**
+         * @brief Remove the redirections from a line
+         *
+         * @param source The line to process, which must not be a pipeline
+         * @return The line without its redirections, i.e. the command message
+         */
+        static std::string strip(const std::string_view &source)
+        {
+            std::string result;
+            std::size_t last = 0;
+            _scan(
+                source,
+                [&source, &result, &last](std::size_t begin, std::size_t end, Redirection &&)
+                {
+                    result += source.substr(last, begin - last);
+                    last = end;
+                });
+
+            if (last == 0)
+            {
+                return std::string(source);
+            }
+
+            result += source.substr(last);
+            while (!result.empty() && _is_space(result.back()))
+            {
+                result.pop_back();
+            }
+
+            return result;
+        }
+    };
+
+    const std::string Redirection::SAME_AS_STDOUT = "&1";
+
+    /**
+     * @brief The files opened for the redirections of a command.
+     *
+     * Built-in commands write to these files through large buffers, which are flushed once when this object is
+     * destroyed rather than at each `std::endl`. Executables receive the file handles directly.
+     */
+    class RedirectedOutputs
+    {
+    private:
+        /** @brief The size of the buffer of each redirected output */
+        static const std::size_t BUFFER_SIZE = 1 << 16;
+
+        HANDLE _handles[2] = {NULL, NULL};
+        std::unique_ptr<utils::WriterBuffer> _buffers[2];
+
+        /** @brief Whether the standard error shares the file of the standard output */
+        bool _merged = false;
+
+        RedirectedOutputs(const RedirectedOutputs &) = delete;
+        RedirectedOutputs &operator=(const RedirectedOutputs &) = delete;
+
+        void _close(const int index)
+        {
+            _buffers[index].reset();
+            if (_handles[index] != NULL)
+            {
+                CloseHandle(_handles[index]);
+                _handles[index] = NULL;
+            }
+        }
+
+        static HANDLE _open(const std::string &path, const bool append)
+        {
+            if (path.empty())
+            {
+                throw std::invalid_argument("Missing redirection target");
+            }
+
+            auto file = CreateFileW(
+                utils::utf_convert(path).c_str(),
+                append ? FILE_APPEND_DATA : GENERIC_WRITE,
+                FILE_SHARE_READ,
+                NULL,
+                append ? OPEN_ALWAYS : CREATE_ALWAYS,
+                FILE_ATTRIBUTE_NORMAL,
+                NULL);
+
+            if (file == INVALID_HANDLE_VALUE)
+            {
+                throw std::runtime_error(utils::last_error(utils::format("Unable to open \"%s\" for redirection", path.c_str())));
+            }
+
+            return file;
+        }
+
+    public:
+        /**
+         * @brief Open the targets of a list of redirections
+         *
+         * @param redirections The redirections to apply, later ones override earlier ones
+         * @param resolve A function mapping each target to the actual path to open
+         */
+        RedirectedOutputs(
+            const std::vector<Redirection> &redirections,
+            const std::function<std::string(const std::string &)> &resolve)
+        {
+            try
+            {
+                for (auto &redirection : redirections)
+                {
+                    auto index = redirection.descriptor == Redirection::STDERR ? 1 : 0;
+                    if (index == 1 && redirection.target == Redirection::SAME_AS_STDOUT)
+                    {
+                        _close(1);
+                        _merged = true;
+                        continue;
+                    }
+
+                    auto file = _open(resolve(redirection.target), redirection.append);
+                    _close(index);
+                    _handles[index] = file;
+                    _buffers[index] = utils::handle_writer(file, BUFFER_SIZE, false);
+                    if (index == 1)
+                    {
+                        _merged = false;
+                    }
+                }
+            }
+            catch (...)
+            {
+                _close(0);
+                _close(1);
+                throw;
+            }
+        }
+
+        /** @brief Destructor for this object, which flushes the buffers and closes the files */
+        ~RedirectedOutputs()
+        {
+            _close(1);
+            _close(0);
+        }
+
+        /** @brief The buffer of the redirected standard output, or `nullptr` if it is not redirected */
+        std::streambuf *output() const
+        {
+            return _buffers[0].get();
+        }
+
+        /**
+         * @brief The buffer of the redirected standard error
+         *
+         * @param output The buffer of the actual standard output of the command, used by `2>&1`
+         * @return The buffer to write errors to, or `nullptr` if the standard error is not redirected
+         */
+        std::streambuf *error(std::streambuf *output) const
+        {
+            return _merged ? output : _buffers[1].get();
+        }
+
+        /** @brief The handle of the redirected standard output, or `NULL` if it is not redirected */
+        HANDLE output_handle() const
+        {
+            return _handles[0];
+        }
+
+        /**
+         * @brief The handle of the redirected standard error
+         *
+         * @param output The handle of the actual standard output of the process, used by `2>&1`
+         * @return The handle to write errors to, or `NULL` if the standard error is not redirected
+         */
+        HANDLE error_handle(const HANDLE output) const
+        {
+            return _merged ? output : _handles[1];
+        }
+
+        /**
+         * @brief Set whether the files can be inherited by child processes.
+         *
+         * The files should only be inheritable while the process using them is being created.
+         */
+        void inherit(const bool inheritable) const
+        {
+            for (auto handle : _handles)
+            {
+                if (handle != NULL && !SetHandleInformation(handle, HANDLE_FLAG_INHERIT, inheritable ? HANDLE_FLAG_INHERIT : 0))
+                {
+                    throw std::runtime_error(utils::last_error("Error when configuring redirection"));
+                }
+            }
+        }
+    };
+}
@@ -0,0 +1,304 @@
+#pragma once
+
+#include "utils.hpp"
+
+namespace utils
+{
+    /**
+     * @brief Remove files and directory trees with a pool of worker threads.
+     *
+     * Each worker takes a directory, deletes its files and queues its subdirectories. A directory is removed by the
+     * worker completing its last pending child, so trees are removed bottom-up without any thread waiting for
+     * another. Entries are deleted with POSIX semantics (`FileDispositionInfoEx`) where the file system supports it:
+     * the names disappear immediately even if another process still has the files open, so the parent directory can
+     * be removed right away. Junctions and symbolic links to directories are removed without following them.
+     *
+     * Workers never write to the standard streams, errors are collected and returned by `errors`.
+     */
+    class ParallelRemover
+    {
+    public:
+        /** @brief The progress of a `ParallelRemover` */
+        struct Statistics
+        {
+            /** @brief The number of files deleted */
+            std::size_t files;
+
+            /** @brief The number of directories removed */
+            std::size_t directories;
+        };
+
+    private:
+        struct _Directory
+        {
+            const std::wstring path;
+            _Directory *const parent;
+
+            /** @brief The number of subdirectories not removed yet, plus 1 until the directory is enumerated */
+            std::atomic<std::size_t> pending{1};
+
+            _Directory(const std::wstring &path, _Directory *parent) : path(path), parent(parent) {}
+        };
+
+        std::mutex _mutex;
+        std::condition_variable _available, _done;
+
+        /** @brief The directories waiting to be enumerated, guarded by `_mutex` */
+        std::vector<_Directory *> _queue;
+
+        /** @brief The number of directories queued but not removed yet, guarded by `_mutex` */
+        std::size_t _outstanding = 0;
+
+        /** @brief The errors reported so far, guarded by `_mutex` */
+        std::vector<std::string> _errors;
+
+        bool _stopping = false;
+        std::vector<std::thread> _workers;
+
+        std::atomic<std::size_t> _files{0}, _directories{0};
+
+        /** @brief Whether POSIX deletion is still tried, it is disabled once the file system rejects it */
+        std::atomic<bool> _posix{true};
+
+        ParallelRemover(const ParallelRemover &) = delete;
+        ParallelRemover &operator=(const ParallelRemover &) = delete;
+
+        bool _delete(const std::wstring &path, const bool directory)
+        {
+            if (_posix.load(std::memory_order_relaxed))
+            {
+                auto handle = CreateFileW(
+                    path.c_str(),
+                    DELETE,
+                    FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                    NULL,
+                    OPEN_EXISTING,
+                    FILE_FLAG_OPEN_REPARSE_POINT | FILE_FLAG_BACKUP_SEMANTICS,
+                    NULL);
+
+                if (handle != INVALID_HANDLE_VALUE)
+                {
+                    FILE_DISPOSITION_INFO_EX info;
+                    info.Flags = FILE_DISPOSITION_FLAG_DELETE | FILE_DISPOSITION_FLAG_POSIX_SEMANTICS | FILE_DISPOSITION_FLAG_IGNORE_READONLY_ATTRIBUTE;
+
+                    auto success = SetFileInformationByHandle(handle, FileDispositionInfoEx, &info, sizeof(info));
+                    auto error = GetLastError();
+                    CloseHandle(handle);
+
+                    if (success)
+                    {
+                        return true;
+                    }
+
+                    if (error == ERROR_INVALID_PARAMETER || error == ERROR_NOT_SUPPORTED || error == ERROR_INVALID_FUNCTION)
+                    {
+                        _posix = false; // e.g. FAT32 or Windows 10 before 1709
+                    }
+                }
+            }
+
+            return directory ? RemoveDirectoryW(path.c_str()) : DeleteFileW(path.c_str());
+        }
+
+        void _error(const std::wstring &path, const bool directory)
+        {
+            auto message = last_error(format(directory ? "Error deleting directory \"%s\"" : "Error deleting file \"%s\"", utf_convert(path).c_str()));
+            std::lock_guard<std::mutex> lock(_mutex);
+            _errors.push_back(message);
+        }
+
+        void _push(_Directory *directory)
+        {
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                _outstanding++;
+                _queue.push_back(directory);
+            }
+
+            _available.notify_one();
+        }
+
+        /** @brief Complete a pending unit of a directory, removing it and its ancestors once they are empty */
+        void _release(_Directory *directory)
+        {
+            while (directory != nullptr && --directory->pending == 0)
+            {
+                if (_delete(directory->path, true))
+                {
+                    _directories++;
+                }
+                else
+                {
+                    _error(directory->path, true);
+                }
+
+                auto parent = directory->parent;
+                delete directory;
+                directory = parent;
+
+                bool done;
+                {
+                    std::lock_guard<std::mutex> lock(_mutex);
+                    done = --_outstanding == 0;
+                }
+
+                if (done)
+                {
+                    _done.notify_all();
+                }
+            }
+        }
+
+        void _process(_Directory *directory)
+        {
+            for (const auto &data : FindFiles(directory->path + L"\\*"))
+            {
+                if (wcscmp(data.cFileName, L".") == 0 || wcscmp(data.cFileName, L"..") == 0)
+                {
+                    continue;
+                }
+
+                auto path = directory->path + L"\\" + data.cFileName;
+                if ((data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) && !(data.dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT))
+                {
+                    directory->pending++;
+                    _push(new _Directory(path, directory));
+                }
+                else
+                {
+                    _remove_entry(path, data.dwFileAttributes);
+                }
+            }
+
+            _release(directory);
+        }
+
+        /** @brief Delete a file or a link to a directory */
+        void _remove_entry(const std::wstring &path, const DWORD attributes)
+        {
+            bool directory = attributes & FILE_ATTRIBUTE_DIRECTORY;
+            if (_delete(path, directory))
+            {
+                (directory ? _directories : _files)++;
+            }
+            else
+            {
+                _error(path, directory);
+            }
+        }
+
+        void _work()
+        {
+            while (true)
+            {
+                _Directory *directory;
+                {
+                    std::unique_lock<std::mutex> lock(_mutex);
+                    _available.wait(lock, [this]()
+                                    { return !_queue.empty() || _stopping; });
+                    if (_queue.empty())
+                    {
+                        return;
+                    }
+
+                    // The most recent directory first, which keeps the queue short
+                    directory = _queue.back();
+                    _queue.pop_back();
+                }
+
+                _process(directory);
+            }
+        }
+
+    public:
+        /**
+         * @brief Construct a new `ParallelRemover` object and start its workers
+         *
+         * @param workers The number of worker threads
+         */
+        explicit ParallelRemover(const std::size_t workers = std::max(1u, std::thread::hardware_concurrency()))
+        {
+            for (std::size_t i = 0; i < workers; i++)
+            {
+                _workers.emplace_back(&ParallelRemover::_work, this);
+            }
+        }
+
+        /** @brief Destructor for this object, which waits for the queued removals and stops the workers */
+        ~ParallelRemover()
+        {
+            wait([](const Statistics &) {}, std::chrono::milliseconds(INFINITE));
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                _stopping = true;
+            }
+
+            _available.notify_all();
+            for (auto &worker : _workers)
+            {
+                worker.join();
+            }
+        }
+
+        /**
+         * @brief Remove a file, or queue the removal of a directory tree
+         *
+         * @param path The path to remove
+         * @param attributes The attributes of `path`, as returned by `GetFileAttributesW`
+         */
+        void remove(const std::wstring &path, const DWORD attributes)
+        {
+            if ((attributes & FILE_ATTRIBUTE_DIRECTORY) && !(attributes & FILE_ATTRIBUTE_REPARSE_POINT))
+            {
+                _push(new _Directory(path, nullptr));
+            }
+            else
+            {
+                _remove_entry(path, attributes);
+            }
+        }
+
+        /**
+         * @brief Wait until all queued removals are completed
+         *
+         * @param progress A function invoked with the current progress after each `interval` elapses
+         * @param interval The interval between 2 progress reports
+         * @return The final progress
+         */
+        Statistics wait(const std::function<void(const Statistics &)> &progress, const std::chrono::milliseconds &interval)
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            while (!_done.wait_for(lock, interval, [this]()
+                                   { return _outstanding == 0; }))
+            {
+                lock.unlock();
+                progress(statistics());
+                lock.lock();
+            }
+
+            return statistics();
+        }
+
+        /** @brief The current progress */
+        Statistics statistics() const
+        {
+            return {_files.load(), _directories.load()};
+        }
+
+        /**
+         * @brief Take the errors reported since the last call
+         *
+         * @return The error messages, in no particular order
+         */
+        std::vector<std::string> errors()
+        {
+            std::vector<std::string> result;
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                result.swap(_errors);
+            }
+
+            return result;
+        }
+    };
+}
@@ -0,0 +1,486 @@
+#pragma once
+
+#include "redirection.hpp"
+#include "split.hpp"
+
+namespace liteshell
+{
+    /**
+     * @brief A pre-processed line of a batch script.
+     *
+     * Lines that do not reference any environment variable are tokenized and bound to a built-in command
+     * once, at compile time. Lines containing `$` must still be resolved before each execution.
+     */
+    class Instruction
+    {
+    private:
+        /** @brief Equivalent to `utils::strip`, without intermediate copies */
+        static std::string _strip(const std::string_view &source)
+        {
+            auto is_space = [](char c)
+            {
+                return c == ' ' || c == '\n' || c == '\r';
+            };
+
+            std::size_t begin = 0, end = source.size();
+            while (begin < end && is_space(source[begin]))
+            {
+                begin++;
+            }
+
+            while (end > begin && is_space(source[end - 1]))
+            {
+                end--;
+            }
+
+            return std::string(source.substr(begin, end - begin));
+        }
+
+        /** @brief Split a line at each `PIPE` character outside double quotes, labels are never split */
+        static std::vector<Instruction> _split_pipeline(
+            const std::string &source,
+            const std::function<std::optional<std::size_t>(const std::string &)> &lookup)
+        {
+            std::vector<Instruction> stages;
+            if (source.empty() || source[0] == ':')
+            {
+                return stages;
+            }
+
+            bool quoted = false;
+            std::size_t begin = 0;
+            for (std::size_t i = 0; i < source.size(); i++)
+            {
+                if (source[i] == '"')
+                {
+                    quoted = !quoted;
+                }
+                else if (source[i] == PIPE && !quoted)
+                {
+                    stages.emplace_back(std::string_view(source).substr(begin, i - begin), lookup);
+                    begin = i + 1;
+                }
+            }
+
+            if (!stages.empty())
+            {
+                stages.emplace_back(std::string_view(source).substr(begin), lookup);
+            }
+
+            return stages;
+        }
+
+        /** @brief Whether a line invokes `if`, whose `<` and `>` operators are comparisons rather than redirections */
+        static bool _is_comparison(const std::string &source)
+        {
+            return source.size() > 3 &&
+                   std::tolower(source[0]) == 'i' &&
+                   std::tolower(source[1]) == 'f' &&
+                   (source[2] == ' ' || source[2] == '\t');
+        }
+
+        static std::vector<Redirection> _parse_redirections(const std::string &source, const bool pipeline)
+        {
+            if (pipeline || source.empty() || source[0] == ':' || _is_comparison(source))
+            {
+                return {};
+            }
+
+            return Redirection::parse(source);
+        }
+
+        static std::vector<std::string> _tokenize(const std::string &message, const bool dynamic, const bool pipeline)
+        {
+            if (dynamic || pipeline || message.empty() || message[0] == ':')
+            {
+                return {};
+            }
+
+            return utils::split(message);
+        }
+
+        static std::optional<std::size_t> _bind(
+            const std::vector<std::string> &tokens,
+            const std::function<std::optional<std::size_t>(const std::string &)> &lookup)
+        {
+            if (tokens.empty() || !lookup)
+            {
+                return std::nullopt;
+            }
+
+            return lookup(tokens[0]);
+        }
+
+    public:
+        /** @brief The character separating the stages of a pipeline */
+        static const char PIPE = '|';
+
+        /** @brief The stripped source line */
+        const std::string source;
+
+        /** @brief Whether this line references environment variables and must be resolved before each execution */
+        const bool dynamic;
+
+        /**
+         * @brief The compiled stages of this line if it is a pipeline (e.g. `ls | cat`), empty otherwise.
+         *
+         * The `tokens` and `command` of a pipeline are always empty, each stage is executed on its own.
+         */
+        const std::vector<Instruction> pipeline;
+
+        /** @brief The output redirections of this line, e.g. `> file`, empty if this line is a pipeline */
+        const std::vector<Redirection> redirections;
+
+        /** @brief The command message of this line, i.e. `source` without its redirections */
+        const std::string message;
+
+        /** @brief The pre-split tokens of `message`, empty if `dynamic` is `true` or if this line is a pipeline */
+        const std::vector<std::string> tokens;
+
+        /**
+         * @brief The index of the built-in command invoked by this line, if it was found at compile time.
+         *
+         * When this is `std::nullopt`, the command must be looked up at runtime.
+         */
+        const std::optional<std::size_t> command;
+
+        /**
+         * @brief Compile a line
+         *
+         * @param source The source line
+         * @param lookup A function mapping a command name to its index in the command table,
+         * may be empty if no binding should be performed
+         */
+        Instruction(
+            const std::string_view &source,
+            const std::function<std::optional<std::size_t>(const std::string &)> &lookup)
+            : source(_strip(source)),
+              dynamic(this->source.find('$') != std::string::npos),
+              pipeline(_split_pipeline(this->source, lookup)),
+              redirections(_parse_redirections(this->source, !pipeline.empty())),
+              message(redirections.empty() ? this->source : Redirection::strip(this->source)),
+              tokens(_tokenize(message, dynamic, !pipeline.empty())),
+              command(_bind(tokens, lookup)) {}
+
+        /**
+         * @brief Construct an instruction from its compiled parts, e.g. when loading a compiled script from disk
+         *
+         * The parts must be those the compiling constructor would produce from `source`.
+         */
+        Instruction(
+            std::string &&source,
+            const bool dynamic,
+            std::vector<Instruction> &&pipeline,
+            std::vector<Redirection> &&redirections,
+            std::string &&message,
+            std::vector<std::string> &&tokens,
+            const std::optional<std::size_t> &command)
+            : source(std::move(source)),
+              dynamic(dynamic),
+              pipeline(std::move(pipeline)),
+              redirections(std::move(redirections)),
+              message(std::move(message)),
+              tokens(std::move(tokens)),
+              command(command) {}
+
+        /** @brief Whether this line is a label (or a comment), which is a no-op when executed */
+        bool is_label() const
+        {
+            return source.empty() || source[0] == ':';
+        }
+    };
+
+    /**
+     * @brief A compiled batch script, which is an immutable list of instructions.
+     *
+     * Compiled scripts are shared between the input stream frames executing them and the script cache of the
+     * client, hence they are always handled via `std::shared_ptr<const Script>`.
+     */
+    class Script
+    {
+    private:
+        static std::unordered_map<std::string, std::vector<std::size_t>> _index_labels(const std::vector<Instruction> &instructions)
+        {
+            std::unordered_map<std::string, std::vector<std::size_t>> labels;
+            for (std::size_t index = 0; index < instructions.size(); index++)
+            {
+                const auto &source = instructions[index].source;
+                if (!source.empty() && source[0] == ':')
+                {
+                    labels[source].push_back(index);
+                }
+            }
+
+            return labels;
+        }
+
+        /** @brief Match each `if` with its `else` or `endif`, and each `else` with its `endif` */
+        static std::unordered_map<std::size_t, std::size_t> _match_branches(const std::vector<Instruction> &instructions)
+        {
+            struct _Block
+            {
+                std::size_t begin, current;
+                bool has_else, invalid;
+            };
+
+            std::unordered_map<std::size_t, std::size_t> branches;
+            std::vector<_Block> blocks;
+            for (std::size_t index = 0; index < instructions.size(); index++)
+            {
+                const auto &source = instructions[index].source;
+                if (utils::startswith(source, "if "))
+                {
+                    blocks.push_back({index, index, false, false});
+                }
+                else if (!blocks.empty() && source == "else")
+                {
+                    auto &block = blocks.back();
+                    if (block.has_else)
+                    {
+                        // A second "else" is an error raised by `if` itself, which must read the block line by line
+                        block.invalid = true;
+                        branches.erase(block.begin);
+                    }
+                    else if (!block.invalid)
+                    {
+                        branches[block.current] = index;
+                    }
+
+                    block.has_else = true;
+                    block.current = index;
+                }
+                else if (!blocks.empty() && utils::startswith(source, "endif"))
+                {
+                    auto &block = blocks.back();
+                    if (!block.invalid)
+                    {
+                        branches[block.current] = index;
+                    }
+
+                    blocks.pop_back();
+                }
+            }
+
+            // Unterminated blocks are not matched either
+            for (auto &block : blocks)
+            {
+                branches.erase(block.begin);
+            }
+
+            return branches;
+        }
+
+        static std::size_t _memory_usage(const Instruction &instruction)
+        {
+            auto result = instruction.source.capacity() + instruction.message.capacity();
+            for (auto &token : instruction.tokens)
+            {
+                result += sizeof(std::string) + token.capacity();
+            }
+
+            for (auto &stage : instruction.pipeline)
+            {
+                result += sizeof(Instruction) + _memory_usage(stage);
+            }
+
+            return result;
+        }
+
+    public:
+        /** @brief The instructions of this script, empty lines are excluded */
+        const std::vector<Instruction> instructions;
+
+        /** @brief A mapping of each label to the sorted indices of the instructions declaring it */
+        const std::unordered_map<std::string, std::vector<std::size_t>> labels;
+
+        /**
+         * @brief A mapping of the index of each `if` to the index of its `else` (or `endif` if there is none), and of
+         * each `else` to the index of its `endif`.
+         *
+         * Malformed blocks (unterminated or with many `else`) are not included.
+         */
+        const std::unordered_map<std::size_t, std::size_t> branches;
+
+        /** @brief Construct a new `Script` from a list of instructions */
+        Script(std::vector<Instruction> &&instructions)
+            : instructions(std::move(instructions)),
+              labels(_index_labels(this->instructions)),
+              branches(_match_branches(this->instructions)) {}
+
+        /** @brief Construct a new `Script` from a list of instructions and its label and branch tables */
+        Script(
+            std::vector<Instruction> &&instructions,
+            std::unordered_map<std::string, std::vector<std::size_t>> &&labels,
+            std::unordered_map<std::size_t, std::size_t> &&branches)
+            : instructions(std::move(instructions)),
+              labels(std::move(labels)),
+              branches(std::move(branches)) {}
+
+        /**
+         * @brief Find the end of a branch of an `if` block
+         *
+         * @param index The index of an `if` or `else` instruction
+         * @return The index of the matching `else` or `endif`, or `std::nullopt` if the block is malformed
+         */
+        std::optional<std::size_t> find_branch(const std::size_t index) const
+        {
+            auto iter = branches.find(index);
+            if (iter == branches.end())
+            {
+                return std::nullopt;
+            }
+
+            return iter->second;
+        }
+
+        /**
+         * @brief Find a label within a range of instructions
+         *
+         * The search starts at `position` and wraps around to `begin` when reaching `end`, i.e. it returns the
+         * first match that a linear scan from `position` would find.
+         *
+         * @param label The label to find
+         * @param begin The index of the first instruction of the range
+         * @param end The index after the last instruction of the range
+         * @param position The index to start searching from
+         * @return The index of the instruction declaring the label, or `std::nullopt` if it was not found
+         */
+        std::optional<std::size_t> find_label(
+            const std::string &label,
+            const std::size_t begin,
+            const std::size_t end,
+            const std::size_t position) const
+        {
+            auto iter = labels.find(label);
+            if (iter == labels.end())
+            {
+                return std::nullopt;
+            }
+
+            const auto &indices = iter->second;
+            auto after = std::lower_bound(indices.begin(), indices.end(), position);
+            if (after != indices.end() && *after < end)
+            {
+                return *after;
+            }
+
+            auto first = std::lower_bound(indices.begin(), indices.end(), begin);
+            if (first != indices.end() && *first < end)
+            {
+                return *first;
+            }
+
+            return std::nullopt;
+        }
+
+        /**
+         * @brief Compile a range of lines into a script
+         *
+         * @param __begin An iterator pointing to the first line
+         * @param __end An iterator pointing after the last line
+         * @param lookup A function mapping a command name to its index in the command table
+         * @return The compiled script
+         */
+        template <typename _ForwardIterator>
+        static std::shared_ptr<const Script> compile(
+            const _ForwardIterator &__begin,
+            const _ForwardIterator &__end,
+            const std::function<std::optional<std::size_t>(const std::string &)> &lookup)
+        {
+            std::vector<Instruction> instructions;
+            for (auto iter = __begin; iter != __end; iter++)
+            {
+                Instruction instruction(*iter, lookup);
+                if (!instruction.source.empty())
+                {
+                    instructions.push_back(std::move(instruction));
+                }
+            }
+
+            return std::make_shared<const Script>(std::move(instructions));
+        }
+
+        /**
+         * @brief Compile the lines of a text, without copying them beforehand
+         *
+         * @param text The text to compile, e.g. the content of a batch script
+         * @param lookup A function mapping a command name to its index in the command table
+         * @return The compiled instructions, empty lines are excluded
+         */
+        static std::vector<Instruction> parse(
+            const std::string_view &text,
+            const std::function<std::optional<std::size_t>(const std::string &)> &lookup)
+        {
+            std::vector<Instruction> instructions;
+            std::size_t begin = 0;
+            while (begin < text.size())
+            {
+                auto end = text.find('\n', begin);
+                if (end == std::string_view::npos)
+                {
+                    end = text.size();
+                }
+
+                Instruction instruction(text.substr(begin, end - begin), lookup);
+                if (!instruction.source.empty())
+                {
+                    instructions.push_back(std::move(instruction));
+                }
+
+                begin = end + 1;
+            }
+
+            return instructions;
+        }
+
+        /** @brief The number of instructions in this script */
+        std::size_t size() const
+        {
+            return instructions.size();
+        }
+
+        /** @brief An estimation of the memory used by this script, in bytes */
+        std::size_t memory_usage() const
+        {
+            auto result = sizeof(Script) + instructions.size() * sizeof(Instruction);
+            for (auto &instruction : instructions)
+            {
+                result += _memory_usage(instruction);
+            }
+
+            return result;
+        }
+    };
+
+    /**
+     * @brief A reference to an instruction within a script.
+     *
+     * The handle shares ownership of the script, so the instruction stays valid while it is being executed even
+     * if the input stream drops the frame it was read from (e.g. after a `jump`).
+     */
+    class InstructionHandle
+    {
+    public:
+        /** @brief The script containing the instruction */
+        const std::shared_ptr<const Script> script;
+
+        /** @brief The index of the instruction within `script` */
+        const std::size_t index;
+
+        /** @brief Construct a new `InstructionHandle` object */
+        InstructionHandle(const std::shared_ptr<const Script> &script, const std::size_t index)
+            : script(script), index(index) {}
+
+        /** @brief Access the underlying instruction */
+        const Instruction &operator*() const
+        {
+            return script->instructions[index];
+        }
+
+        /** @brief Access the underlying instruction */
+        const Instruction *operator->() const
+        {
+            return &script->instructions[index];
+        }
+    };
+}
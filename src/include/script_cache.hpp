@@ -0,0 +1,520 @@
+#pragma once
+
+#include "join.hpp"
+#include "mapped_file.hpp"
+#include "script.hpp"
+
+namespace liteshell
+{
+    /**
+     * @brief A cache of compiled batch scripts on disk, shared by all shell processes.
+     *
+     * The compiled form of a script (its instructions with their tokens and redirections, the label table and the
+     * branch table) is written as a compact binary file: fixed-size records referring to a single string pool. A
+     * shell loading the script again maps the file and rebuilds the instructions from the records, without
+     * tokenizing any line, only binding the command names to the built-in commands of this shell.
+     *
+     * A compiled file is used when the script has the same size and last write time as when it was compiled, or
+     * the same size and content hash (e.g. after being checked out again), otherwise the script is compiled and
+     * the file is replaced. Any file which is not a valid compiled script is ignored.
+     */
+    class ScriptCache
+    {
+    private:
+        /** @brief The version of the format, files of other versions are ignored */
+        static const std::uint32_t VERSION = 1;
+
+        /** @brief A string of the pool */
+        struct _Text
+        {
+            std::uint32_t offset, size;
+        };
+
+        struct _Header
+        {
+            char magic[8];
+            std::uint32_t version;
+
+            /** @brief The number of instructions of the script, their records come first */
+            std::uint32_t instructions;
+
+            /** @brief The number of records, including the stages of pipelines */
+            std::uint32_t records;
+
+            std::uint32_t tokens, redirections, labels, branches, pool;
+
+            /** @brief The path of the script in the pool, in case two paths have the same hash */
+            _Text path;
+
+            std::uint64_t source_size, source_time, source_hash;
+        };
+
+        struct _Record
+        {
+            _Text source, message;
+            std::uint32_t dynamic;
+            std::uint32_t first_token, tokens;
+            std::uint32_t first_redirection, redirections;
+            std::uint32_t first_stage, stages;
+        };
+
+        struct _Redirection
+        {
+            _Text target;
+            std::uint32_t descriptor, append;
+        };
+
+        struct _Branch
+        {
+            std::uint32_t from, to;
+        };
+
+        static constexpr char MAGIC[8] = {'L', 'S', 'H', 'F', 'F', 'C', '\0', '\0'};
+
+        /** @brief The flattened form of a script, as written to disk */
+        struct _Tables
+        {
+            std::vector<_Record> records;
+            std::vector<_Text> tokens;
+            std::vector<_Redirection> redirections;
+            std::vector<std::uint32_t> labels;
+            std::vector<_Branch> branches;
+            std::string pool;
+
+            _Text text(const std::string &value)
+            {
+                _Text result = {static_cast<std::uint32_t>(pool.size()), static_cast<std::uint32_t>(value.size())};
+                pool += value;
+                return result;
+            }
+
+            /** @brief Fill the record at `index` and append the records of the stages of its pipeline */
+            void fill(const std::size_t index, const Instruction &instruction)
+            {
+                _Record record;
+                record.source = text(instruction.source);
+                record.message = instruction.message == instruction.source ? record.source : text(instruction.message);
+                record.dynamic = instruction.dynamic;
+
+                record.first_token = tokens.size();
+                record.tokens = instruction.tokens.size();
+                for (auto &token : instruction.tokens)
+                {
+                    tokens.push_back(text(token));
+                }
+
+                record.first_redirection = redirections.size();
+                record.redirections = instruction.redirections.size();
+                for (auto &redirection : instruction.redirections)
+                {
+                    redirections.push_back({text(redirection.target), static_cast<std::uint32_t>(redirection.descriptor), redirection.append});
+                }
+
+                record.first_stage = records.size();
+                record.stages = instruction.pipeline.size();
+                records.resize(records.size() + instruction.pipeline.size());
+                for (std::size_t i = 0; i < instruction.pipeline.size(); i++)
+                {
+                    fill(record.first_stage + i, instruction.pipeline[i]);
+                }
+
+                records[index] = record;
+            }
+        };
+
+        /** @brief The sections of a mapped compiled file, validated against its size */
+        struct _View
+        {
+            const _Header *header;
+            const _Record *records;
+            const _Text *tokens;
+            const _Redirection *redirections;
+            const std::uint32_t *labels;
+            const _Branch *branches;
+            std::string_view pool;
+
+            bool valid(const _Text &text) const
+            {
+                return text.offset <= pool.size() && text.size <= pool.size() - text.offset;
+            }
+
+            std::string string(const _Text &text) const
+            {
+                return std::string(pool.substr(text.offset, text.size));
+            }
+
+            /** @brief Whether the records, and the ranges they refer to, lie within the file */
+            bool valid() const
+            {
+                for (std::uint32_t i = 0; i < header->records; i++)
+                {
+                    auto &record = records[i];
+                    if (!valid(record.source) || !valid(record.message) ||
+                        record.first_token > header->tokens || record.tokens > header->tokens - record.first_token ||
+                        record.first_redirection > header->redirections || record.redirections > header->redirections - record.first_redirection ||
+                        (record.stages > 0 && (record.first_stage <= i || record.first_stage > header->records || record.stages > header->records - record.first_stage)))
+                    {
+                        return false;
+                    }
+                }
+
+                for (std::uint32_t i = 0; i < header->tokens; i++)
+                {
+                    if (!valid(tokens[i]))
+                    {
+                        return false;
+                    }
+                }
+
+                for (std::uint32_t i = 0; i < header->redirections; i++)
+                {
+                    if (!valid(redirections[i].target))
+                    {
+                        return false;
+                    }
+                }
+
+                for (std::uint32_t i = 0; i < header->labels; i++)
+                {
+                    if (labels[i] >= header->instructions)
+                    {
+                        return false;
+                    }
+                }
+
+                for (std::uint32_t i = 0; i < header->branches; i++)
+                {
+                    if (branches[i].from >= header->instructions || branches[i].to >= header->instructions)
+                    {
+                        return false;
+                    }
+                }
+
+                return true;
+            }
+
+            Instruction instruction(const std::uint32_t index, const std::function<std::optional<std::size_t>(const std::string &)> &lookup) const
+            {
+                auto &record = records[index];
+
+                std::vector<Instruction> pipeline;
+                pipeline.reserve(record.stages);
+                for (std::uint32_t i = 0; i < record.stages; i++)
+                {
+                    pipeline.push_back(instruction(record.first_stage + i, lookup));
+                }
+
+                std::vector<Redirection> parsed;
+                parsed.reserve(record.redirections);
+                for (std::uint32_t i = 0; i < record.redirections; i++)
+                {
+                    auto &redirection = redirections[record.first_redirection + i];
+                    parsed.emplace_back(redirection.descriptor, redirection.append, string(redirection.target));
+                }
+
+                std::vector<std::string> split;
+                split.reserve(record.tokens);
+                for (std::uint32_t i = 0; i < record.tokens; i++)
+                {
+                    split.push_back(string(tokens[record.first_token + i]));
+                }
+
+                std::optional<std::size_t> command;
+                if (!split.empty() && lookup)
+                {
+                    command = lookup(split[0]);
+                }
+
+                return Instruction(
+                    string(record.source),
+                    record.dynamic,
+                    std::move(pipeline),
+                    std::move(parsed),
+                    string(record.message),
+                    std::move(split),
+                    command);
+            }
+        };
+
+        const std::string _directory;
+
+        static std::uint64_t _combine(const FILETIME &time)
+        {
+            return (static_cast<std::uint64_t>(time.dwHighDateTime) << 32) | time.dwLowDateTime;
+        }
+
+        /** @brief The path of the compiled file of a script, named after the hash of its lowercase path */
+        std::string _cache_path(const std::string &path) const
+        {
+            std::string lower(path);
+            std::transform(
+                lower.begin(), lower.end(), lower.begin(),
+                [](char c)
+                {
+                    return static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+                });
+
+            return utils::join(_directory, utils::format("%016llx.ffc", static_cast<unsigned long long>(hash(lower))));
+        }
+
+        /** @brief Create a directory and its missing parents */
+        static bool _create_directories(const std::wstring &path)
+        {
+            if (CreateDirectoryW(path.c_str(), NULL) || GetLastError() == ERROR_ALREADY_EXISTS)
+            {
+                return true;
+            }
+
+            auto separator = path.find_last_of(L"\\/");
+            if (separator == std::wstring::npos || separator == 0 || path[separator - 1] == L':')
+            {
+                return false;
+            }
+
+            return _create_directories(path.substr(0, separator)) && (CreateDirectoryW(path.c_str(), NULL) || GetLastError() == ERROR_ALREADY_EXISTS);
+        }
+
+        template <typename T>
+        static void _append(std::string &buffer, const std::vector<T> &items)
+        {
+            buffer.append(reinterpret_cast<const char *>(items.data()), items.size() * sizeof(T));
+        }
+
+    public:
+        /**
+         * @brief Construct a new `ScriptCache` object
+         *
+         * @param directory The directory of the compiled files, created when the first file is written
+         */
+        explicit ScriptCache(const std::string &directory) : _directory(directory) {}
+
+        /**
+         * @brief The default directory of compiled scripts: `LITESHELL_SCRIPT_CACHE` if it is set, otherwise
+         * `%LOCALAPPDATA%\liteshell\scripts`
+         */
+        static std::string default_directory()
+        {
+            auto path = utils::get_environment_variable("LITESHELL_SCRIPT_CACHE");
+            if (path.has_value() && !path->empty())
+            {
+                return *path;
+            }
+
+            auto local = utils::get_environment_variable("LOCALAPPDATA");
+            if (local.has_value() && !local->empty())
+            {
+                return utils::join(*local, "liteshell\\scripts");
+            }
+
+            return utils::join(utils::get_executable_directory(), ".liteshell_scripts");
+        }
+
+        /** @brief The FNV-1a hash of a content */
+        static std::uint64_t hash(const std::string_view &content)
+        {
+            std::uint64_t result = 14695981039346656037ull;
+            for (auto c : content)
+            {
+                result ^= static_cast<unsigned char>(c);
+                result *= 1099511628211ull;
+            }
+
+            return result;
+        }
+
+        /** @brief The directory of the compiled files */
+        const std::string &directory() const
+        {
+            return _directory;
+        }
+
+        /**
+         * @brief Load the compiled form of a script
+         *
+         * @param path The absolute path to the script
+         * @param attributes The current attributes of the script
+         * @param lookup A function mapping a command name to its index in the command table
+         * @return The compiled script, or `nullptr` if there is no valid compiled file for the current content
+         */
+        std::shared_ptr<const Script> load(
+            const std::string &path,
+            const WIN32_FILE_ATTRIBUTE_DATA &attributes,
+            const std::function<std::optional<std::size_t>(const std::string &)> &lookup) const
+        {
+            try
+            {
+                utils::MappedFile file(_cache_path(path));
+                auto data = file.view();
+
+                _View view;
+                view.header = reinterpret_cast<const _Header *>(data.data());
+                if (data.size() < sizeof(_Header) ||
+                    std::memcmp(view.header->magic, MAGIC, sizeof(MAGIC)) != 0 ||
+                    view.header->version != VERSION ||
+                    view.header->instructions > view.header->records)
+                {
+                    return nullptr;
+                }
+
+                auto &header = *view.header;
+                std::uint64_t size = (static_cast<std::uint64_t>(attributes.nFileSizeHigh) << 32) | attributes.nFileSizeLow;
+                if (header.source_size != size)
+                {
+                    return nullptr;
+                }
+
+                auto expected = sizeof(_Header) +
+                                static_cast<std::uint64_t>(header.records) * sizeof(_Record) +
+                                static_cast<std::uint64_t>(header.tokens) * sizeof(_Text) +
+                                static_cast<std::uint64_t>(header.redirections) * sizeof(_Redirection) +
+                                static_cast<std::uint64_t>(header.labels) * sizeof(std::uint32_t) +
+                                static_cast<std::uint64_t>(header.branches) * sizeof(_Branch) +
+                                header.pool;
+                if (expected != data.size())
+                {
+                    return nullptr;
+                }
+
+                // A script written again with the same content keeps its compiled form
+                if (header.source_time != _combine(attributes.ftLastWriteTime))
+                {
+                    utils::MappedFile source(path);
+                    if (hash(source.view()) != header.source_hash)
+                    {
+                        return nullptr;
+                    }
+                }
+
+                auto offset = data.data() + sizeof(_Header);
+                view.records = reinterpret_cast<const _Record *>(offset);
+                offset += header.records * sizeof(_Record);
+                view.tokens = reinterpret_cast<const _Text *>(offset);
+                offset += header.tokens * sizeof(_Text);
+                view.redirections = reinterpret_cast<const _Redirection *>(offset);
+                offset += header.redirections * sizeof(_Redirection);
+                view.labels = reinterpret_cast<const std::uint32_t *>(offset);
+                offset += header.labels * sizeof(std::uint32_t);
+                view.branches = reinterpret_cast<const _Branch *>(offset);
+                offset += header.branches * sizeof(_Branch);
+                view.pool = std::string_view(offset, header.pool);
+
+                if (!view.valid() || !view.valid(header.path) || view.pool.substr(header.path.offset, header.path.size) != path)
+                {
+                    return nullptr;
+                }
+
+                std::vector<Instruction> instructions;
+                instructions.reserve(header.instructions);
+                for (std::uint32_t i = 0; i < header.instructions; i++)
+                {
+                    instructions.push_back(view.instruction(i, lookup));
+                }
+
+                std::unordered_map<std::string, std::vector<std::size_t>> labels;
+                for (std::uint32_t i = 0; i < header.labels; i++)
+                {
+                    labels[instructions[view.labels[i]].source].push_back(view.labels[i]);
+                }
+
+                std::unordered_map<std::size_t, std::size_t> branches;
+                for (std::uint32_t i = 0; i < header.branches; i++)
+                {
+                    branches[view.branches[i].from] = view.branches[i].to;
+                }
+
+                return std::make_shared<const Script>(std::move(instructions), std::move(labels), std::move(branches));
+            }
+            catch (std::exception &)
+            {
+                // A missing or unreadable compiled file is a cache miss
+                return nullptr;
+            }
+        }
+
+        /**
+         * @brief Write the compiled form of a script, replacing the previous one. Errors are ignored, since the
+         * script can always be compiled again.
+         *
+         * @param path The absolute path to the script
+         * @param attributes The attributes of the script when it was read
+         * @param content_hash The hash of the content the script was compiled from, see `hash`
+         * @param script The compiled script
+         */
+        void store(
+            const std::string &path,
+            const WIN32_FILE_ATTRIBUTE_DATA &attributes,
+            const std::uint64_t content_hash,
+            const Script &script) const
+        {
+            _Tables tables;
+            auto source_path = tables.text(path);
+            tables.records.resize(script.size());
+            for (std::size_t i = 0; i < script.size(); i++)
+            {
+                tables.fill(i, script.instructions[i]);
+            }
+
+            for (auto &[label, indices] : script.labels)
+            {
+                tables.labels.insert(tables.labels.end(), indices.begin(), indices.end());
+            }
+
+            std::sort(tables.labels.begin(), tables.labels.end());
+            for (auto &[from, to] : script.branches)
+            {
+                tables.branches.push_back({static_cast<std::uint32_t>(from), static_cast<std::uint32_t>(to)});
+            }
+
+            if (tables.pool.size() > std::numeric_limits<std::uint32_t>::max())
+            {
+                return;
+            }
+
+            _Header header;
+            std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+            header.version = VERSION;
+            header.instructions = script.size();
+            header.records = tables.records.size();
+            header.tokens = tables.tokens.size();
+            header.redirections = tables.redirections.size();
+            header.labels = tables.labels.size();
+            header.branches = tables.branches.size();
+            header.pool = tables.pool.size();
+            header.path = source_path;
+            header.source_size = (static_cast<std::uint64_t>(attributes.nFileSizeHigh) << 32) | attributes.nFileSizeLow;
+            header.source_time = _combine(attributes.ftLastWriteTime);
+            header.source_hash = content_hash;
+
+            std::string buffer(reinterpret_cast<const char *>(&header), sizeof(header));
+            _append(buffer, tables.records);
+            _append(buffer, tables.tokens);
+            _append(buffer, tables.redirections);
+            _append(buffer, tables.labels);
+            _append(buffer, tables.branches);
+            buffer += tables.pool;
+
+            if (!_create_directories(utils::utf_convert(_directory)))
+            {
+                return;
+            }
+
+            // The file is replaced at once, so that other shells never map a partially written file
+            auto target = utils::utf_convert(_cache_path(path));
+            auto temporary = target + utils::utf_convert(utils::format(".%lu.tmp", GetCurrentProcessId()));
+            auto file = CreateFileW(temporary.c_str(), GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+            if (file == INVALID_HANDLE_VALUE)
+            {
+                return;
+            }
+
+            DWORD written;
+            auto success = WriteFile(file, buffer.data(), buffer.size(), &written, NULL) && written == buffer.size();
+            CloseHandle(file);
+
+            if (!success || !MoveFileExW(temporary.c_str(), target.c_str(), MOVEFILE_REPLACE_EXISTING))
+            {
+                DeleteFileW(temporary.c_str());
+            }
+        }
+    };
+}
@@ -0,0 +1,342 @@
+#pragma once
+
+#include <boost/regex.hpp>
+
+#include "standard.hpp"
+
+namespace utils
+{
+    /**
+     * @brief A pattern searched line by line in large buffers, e.g. memory-mapped files.
+     *
+     * The buffer is never split into lines up front. Instead, a literal which every matching line must contain is
+     * located with `memchr` (vectorized by the C runtime) followed by a comparison, and only the line around each
+     * occurrence is considered. Patterns without any regular expression syntax (or searched as fixed strings) are
+     * decided by this literal alone, and other patterns are matched by a
+     * [Boost.Regex](https://www.boost.org/doc/libs/release/libs/regex/) expression on the candidate lines only.
+     * Regular expressions without a required literal, e.g. `a|b`, are matched against every line.
+     *
+     * A searcher can be used by many threads at once, each with its own `Scanner`.
+     */
+    class LineSearcher
+    {
+    private:
+        /** @brief The literal contained in every matching line, lowercase when case is ignored */
+        std::string _literal;
+        const bool _ignore_case;
+
+        /** @brief The expression deciding the candidate lines, or none if the literal is the whole pattern */
+        std::optional<boost::regex> _regex;
+
+        /** @brief Compare bytes with a literal, which is lowercase when case is ignored */
+        bool _equals(const char *data, const char *literal, const std::size_t size) const
+        {
+            if (!_ignore_case)
+            {
+                return std::memcmp(data, literal, size) == 0;
+            }
+
+            for (std::size_t i = 0; i < size; i++)
+            {
+                if (std::tolower(static_cast<unsigned char>(data[i])) != literal[i])
+                {
+                    return false;
+                }
+            }
+
+            return true;
+        }
+
+        /** @brief Whether a pattern uses any regular expression syntax */
+        static bool _is_plain(const std::string &pattern)
+        {
+            return pattern.find_first_of(".[]()*+?{}|^$\\") == std::string::npos;
+        }
+
+        /**
+         * @brief Find the longest literal which every match of a (Perl syntax) regular expression contains.
+         *
+         * The analysis is conservative: characters inside groups and classes or followed by an optional
+         * quantifier are skipped, and the result is empty whenever the pattern has an alternation or inline
+         * modifiers.
+         */
+        static std::string _required_literal(const std::string &pattern)
+        {
+            if (pattern.find("(?") != std::string::npos)
+            {
+                return std::string();
+            }
+
+            std::string best, run;
+            auto flush = [&best, &run]()
+            {
+                if (run.size() > best.size())
+                {
+                    best = run;
+                }
+
+                run.clear();
+            };
+
+            std::size_t depth = 0;
+            for (std::size_t i = 0; i < pattern.size(); i++)
+            {
+                auto c = pattern[i];
+                switch (c)
+                {
+                case '|':
+                    return std::string();
+
+                case '(':
+                    depth++;
+                    flush();
+                    break;
+
+                case ')':
+                    depth -= depth > 0;
+                    flush();
+                    break;
+
+                case '[':
+                    // Skip the class, a "]" right after "[" or "[^" belongs to it
+                    i++;
+                    if (i < pattern.size() && pattern[i] == '^')
+                    {
+                        i++;
+                    }
+
+                    if (i < pattern.size() && pattern[i] == ']')
+                    {
+                        i++;
+                    }
+
+                    while (i < pattern.size() && pattern[i] != ']')
+                    {
+                        i += pattern[i] == '\\' ? 2 : 1;
+                    }
+
+                    flush();
+                    break;
+
+                case '*':
+                case '?':
+                case '{':
+                    // The previous character may be absent
+                    if (!run.empty())
+                    {
+                        run.pop_back();
+                    }
+
+                    flush();
+                    if (c == '{')
+                    {
+                        i = std::min(pattern.find('}', i), pattern.size());
+                    }
+
+                    break;
+
+                case '+':
+                case '.':
+                case '^':
+                case '$':
+                    flush();
+                    break;
+
+                case '\\':
+                    // An escaped punctuation character is literal, an escaped letter or digit is a class or an anchor
+                    i++;
+                    if (i < pattern.size() && !std::isalnum(static_cast<unsigned char>(pattern[i])) && depth == 0)
+                    {
+                        run += pattern[i];
+                    }
+                    else
+                    {
+                        flush();
+                    }
+
+                    break;
+
+                default:
+                    if (depth == 0)
+                    {
+                        run += c;
+                    }
+                }
+            }
+
+            flush();
+            return best;
+        }
+
+    public:
+        /** @brief A pass over a buffer, which yields the matching lines in order */
+        class Scanner
+        {
+        private:
+            const LineSearcher &_searcher;
+            const char *_cursor;
+            const char *const _end;
+
+            /** @brief The next occurrences of the first literal byte, and of its uppercase form when case is ignored */
+            const char *_next[2] = {nullptr, nullptr};
+
+            /** @brief The results of the expression, kept so that matching a line does not allocate */
+            boost::cmatch _match;
+
+            const char *_occurrence(const std::size_t index, const char byte, const char *from, const char *limit)
+            {
+                if (_next[index] == nullptr || _next[index] < from)
+                {
+                    auto found = static_cast<const char *>(std::memchr(from, byte, limit - from));
+                    _next[index] = found == nullptr ? _end : found;
+                }
+
+                return _next[index];
+            }
+
+            /** @brief The first occurrence of the literal at or after `from`, or `nullptr` */
+            const char *_find(const char *from)
+            {
+                const auto &literal = _searcher._literal;
+                if (static_cast<std::size_t>(_end - from) < literal.size())
+                {
+                    return nullptr;
+                }
+
+                // The last position at which the literal may start, plus 1
+                auto limit = _end - literal.size() + 1;
+                auto first = literal[0], other = static_cast<char>(std::toupper(static_cast<unsigned char>(first)));
+                auto folded = _searcher._ignore_case && first != other;
+                while (from < limit)
+                {
+                    auto candidate = _occurrence(0, first, from, limit);
+                    if (folded)
+                    {
+                        candidate = std::min(candidate, _occurrence(1, other, from, limit));
+                    }
+
+                    if (candidate >= limit)
+                    {
+                        return nullptr;
+                    }
+
+                    if (_searcher._equals(candidate + 1, literal.data() + 1, literal.size() - 1))
+                    {
+                        return candidate;
+                    }
+
+                    from = candidate + 1;
+                }
+
+                return nullptr;
+            }
+
+        public:
+            /**
+             * @brief Start a pass over a buffer
+             *
+             * @param searcher The pattern to search, which must outlive this object
+             * @param data The buffer to search, which must start at the beginning of a line
+             */
+            Scanner(const LineSearcher &searcher, const std::string_view &data)
+                : _searcher(searcher), _cursor(data.data()), _end(data.data() + data.size()) {}
+
+            /**
+             * @brief Find the next matching line
+             *
+             * @param line The line found, without its line terminator
+             * @return Whether a line was found, otherwise the pass is complete
+             */
+            bool next(std::string_view &line)
+            {
+                while (_cursor < _end)
+                {
+                    auto begin = _cursor;
+                    auto from = begin;
+                    if (!_searcher._literal.empty())
+                    {
+                        from = _find(_cursor);
+                        if (from == nullptr)
+                        {
+                            _cursor = _end;
+                            return false;
+                        }
+
+                        // _cursor is at the beginning of a line, so this backward scan stays within one line
+                        begin = from;
+                        while (begin > _cursor && begin[-1] != '\n')
+                        {
+                            begin--;
+                        }
+                    }
+
+                    auto end = static_cast<const char *>(std::memchr(from, '\n', _end - from));
+                    end = end == nullptr ? _end : end;
+                    _cursor = end == _end ? _end : end + 1;
+
+                    if (_searcher._regex.has_value())
+                    {
+                        // "^" and "$" only match at the ends of the line, and "$" before a CRLF terminator too
+                        auto last = end > begin && end[-1] == '\r' ? end - 1 : end;
+                        if (!boost::regex_search(begin, last, _match, *_searcher._regex, boost::match_default | boost::match_single_line))
+                        {
+                            continue;
+                        }
+                    }
+
+                    line = std::string_view(begin, end - begin);
+                    return true;
+                }
+
+                return false;
+            }
+        };
+
+        /**
+         * @brief Construct a new `LineSearcher` object
+         *
+         * @param pattern The pattern to search, a Perl regular expression unless `fixed` is true
+         * @param fixed Whether the pattern is a fixed string instead of a regular expression
+         * @param ignore_case Whether to ignore case (ASCII letters only for the literal prefilter)
+         */
+        LineSearcher(const std::string &pattern, const bool fixed, const bool ignore_case) : _ignore_case(ignore_case)
+        {
+            auto plain = fixed || _is_plain(pattern);
+            _literal = plain ? pattern : _required_literal(pattern);
+            if (ignore_case)
+            {
+                std::transform(
+                    _literal.begin(), _literal.end(), _literal.begin(),
+                    [](unsigned char c)
+                    {
+                        return static_cast<char>(std::tolower(c));
+                    });
+            }
+
+            if (!plain)
+            {
+                auto flags = boost::regex::perl | (ignore_case ? boost::regex::icase : boost::regex::normal);
+                try
+                {
+                    _regex.emplace(pattern, flags);
+                }
+                catch (boost::regex_error &e)
+                {
+                    throw std::invalid_argument(std::string("Invalid regular expression: ") + e.what());
+                }
+            }
+        }
+
+        /** @brief The literal located by the prefilter, empty if every line is a candidate */
+        const std::string &literal() const
+        {
+            return _literal;
+        }
+
+        /** @brief Whether the candidate lines are decided by a regular expression */
+        bool is_regex() const
+        {
+            return _regex.has_value();
+        }
+    };
+}
@@ -0,0 +1,551 @@
+#pragma once
+
+#include "client.hpp"
+#include "console.hpp"
+#include "finalize.hpp"
+#include "pipe.hpp"
+#include "utils.hpp"
+
+namespace liteshell
+{
+    /**
+     * @brief A resident shell serving requests of other processes through a named pipe.
+     *
+     * A request carries a command line or the path to a batch script, together with the working directory, the
+     * environment variables and the standard handles of the requesting process. The server duplicates these handles,
+     * so that the output of the request (including the output of its subprocesses) goes directly to the requester,
+     * then replies with the final errorlevel.
+     *
+     * Each request runs on a snapshot of the environment of the server (see `Environment::snapshot`): the variables
+     * it assigns, its working directory and its process environment are all restored afterwards. The built-in commands, the executables found in `PATH`
+     * and the compiled scripts stay cached from one request to the next. Requests are served one at a time, in the
+     * order they arrive.
+     */
+    class Server
+    {
+    public:
+        /** @brief A request sent to a `Server` */
+        struct Request
+        {
+            /** @brief A request running a command line */
+            static const std::uint32_t COMMAND = 0;
+
+            /** @brief A request running a batch script */
+            static const std::uint32_t SCRIPT = 1;
+
+            /** @brief Either `COMMAND` or `SCRIPT` */
+            std::uint32_t mode = COMMAND;
+
+            /** @brief The standard input, output and error handles of the requesting process, in its handle table */
+            std::uint64_t input = 0, output = 0, error = 0;
+
+            /** @brief The working directory of the requesting process */
+            std::string directory;
+
+            /** @brief The command line or the path to the batch script */
+            std::string payload;
+
+            /** @brief The environment variables of the requesting process, as `NAME=VALUE` strings */
+            std::vector<std::string> environment;
+
+            /** @brief Encode this request into a message */
+            std::string serialize() const
+            {
+                std::string message(MAGIC);
+                auto number = [&message](const std::uint64_t value, const std::size_t size)
+                {
+                    for (std::size_t i = 0; i < size; i++)
+                    {
+                        message += static_cast<char>((value >> (8 * i)) & 0xFF);
+                    }
+                };
+                auto string = [&message, &number](const std::string &value)
+                {
+                    number(value.size(), 4);
+                    message += value;
+                };
+
+                number(mode, 4);
+                number(input, 8);
+                number(output, 8);
+                number(error, 8);
+                string(directory);
+                string(payload);
+                number(environment.size(), 4);
+                for (auto &variable : environment)
+                {
+                    string(variable);
+                }
+
+                return message;
+            }
+
+            /**
+             * @brief Decode a request from a message
+             *
+             * @param message The message produced by `serialize`
+             * @return The decoded request
+             */
+            static Request parse(std::string_view message)
+            {
+                auto invalid = []()
+                {
+                    return std::runtime_error("Malformed server request");
+                };
+
+                if (message.substr(0, MAGIC.size()) != MAGIC)
+                {
+                    throw invalid();
+                }
+
+                message.remove_prefix(MAGIC.size());
+                auto number = [&message, &invalid](const std::size_t size)
+                {
+                    if (message.size() < size)
+                    {
+                        throw invalid();
+                    }
+
+                    std::uint64_t value = 0;
+                    for (std::size_t i = 0; i < size; i++)
+                    {
+                        value |= static_cast<std::uint64_t>(static_cast<unsigned char>(message[i])) << (8 * i);
+                    }
+
+                    message.remove_prefix(size);
+                    return value;
+                };
+                auto string = [&message, &number, &invalid]()
+                {
+                    auto size = number(4);
+                    if (message.size() < size)
+                    {
+                        throw invalid();
+                    }
+
+                    std::string value(message.substr(0, size));
+                    message.remove_prefix(size);
+                    return value;
+                };
+
+                Request request;
+                request.mode = static_cast<std::uint32_t>(number(4));
+                request.input = number(8);
+                request.output = number(8);
+                request.error = number(8);
+                request.directory = string();
+                request.payload = string();
+                for (auto count = number(4); count > 0; count--)
+                {
+                    request.environment.push_back(string());
+                }
+
+                if (request.mode != COMMAND && request.mode != SCRIPT)
+                {
+                    throw invalid();
+                }
+
+                return request;
+            }
+        };
+
+        /** @brief The prefix of every request, which also versions the protocol */
+        static constexpr std::string_view MAGIC = "LSH1";
+
+        /** @brief The size of the buffers of the pipe */
+        static const DWORD BUFFER_SIZE = 1 << 16;
+
+    private:
+        Client *const _client;
+        const std::wstring _pipe_name;
+
+        Server(const Server &) = delete;
+        Server &operator=(const Server &) = delete;
+
+        /** @brief Read a whole message from a pipe in message mode */
+        static std::string _read_message(const HANDLE pipe)
+        {
+            std::string message;
+            char buffer[4096];
+            while (true)
+            {
+                DWORD read = 0;
+                auto success = ReadFile(pipe, buffer, sizeof(buffer), &read, NULL);
+                message.append(buffer, read);
+                if (success)
+                {
+                    return message;
+                }
+
+                if (GetLastError() != ERROR_MORE_DATA)
+                {
+                    throw std::runtime_error(utils::last_error("Unable to read from pipe"));
+                }
+            }
+        }
+
+        static void _write_message(const HANDLE pipe, const std::string &message)
+        {
+            DWORD written = 0;
+            if (!WriteFile(pipe, message.data(), static_cast<DWORD>(message.size()), &written, NULL) || written != message.size())
+            {
+                throw std::runtime_error(utils::last_error("Unable to write to pipe"));
+            }
+        }
+
+        /** @brief Duplicate a handle of the requesting process as an inheritable handle, or open `NUL` instead */
+        static HANDLE _duplicate(const HANDLE process, const std::uint64_t value, const DWORD access)
+        {
+            HANDLE handle = NULL;
+            if (value != 0 && process != NULL &&
+                DuplicateHandle(process, reinterpret_cast<HANDLE>(static_cast<std::uintptr_t>(value)), GetCurrentProcess(), &handle, 0, TRUE, DUPLICATE_SAME_ACCESS))
+            {
+                return handle;
+            }
+
+            SECURITY_ATTRIBUTES attributes;
+            attributes.nLength = sizeof(attributes);
+            attributes.lpSecurityDescriptor = NULL;
+            attributes.bInheritHandle = TRUE;
+            return CreateFileW(L"NUL", access, FILE_SHARE_READ | FILE_SHARE_WRITE, &attributes, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+        }
+
+        /**
+         * @brief Build the security descriptor of the pipe, whose DACL grants access to the current user only
+         *
+         * @return A descriptor to be freed with `LocalFree`
+         */
+        static PSECURITY_DESCRIPTOR _security_descriptor()
+        {
+            HANDLE token = NULL;
+            if (!OpenProcessToken(GetCurrentProcess(), TOKEN_QUERY, &token))
+            {
+                throw std::runtime_error(utils::last_error("Unable to open the access token of the shell"));
+            }
+
+            auto _finalize = utils::Finalize(
+                [&token]()
+                {
+                    CloseHandle(token);
+                });
+
+            DWORD size = 0;
+            GetTokenInformation(token, TokenUser, NULL, 0, &size);
+
+            std::vector<BYTE> buffer(size);
+            LPWSTR sid = NULL;
+            if (!GetTokenInformation(token, TokenUser, buffer.data(), size, &size) ||
+                !ConvertSidToStringSidW(reinterpret_cast<TOKEN_USER *>(buffer.data())->User.Sid, &sid))
+            {
+                throw std::runtime_error(utils::last_error("Unable to get the user of the shell"));
+            }
+
+            // A protected DACL with a single entry: full access for the user, inherited entries are ignored
+            auto sddl = L"D:P(A;;GA;;;" + std::wstring(sid) + L")";
+            LocalFree(sid);
+
+            PSECURITY_DESCRIPTOR descriptor = NULL;
+            if (!ConvertStringSecurityDescriptorToSecurityDescriptorW(sddl.c_str(), SDDL_REVISION_1, &descriptor, NULL))
+            {
+                throw std::runtime_error(utils::last_error("Unable to build the security descriptor of the named pipe"));
+            }
+
+            return descriptor;
+        }
+
+        /** @brief The variables of the process environment, as `NAME=VALUE` strings */
+        static std::vector<std::wstring> _process_environment()
+        {
+            std::vector<std::wstring> variables;
+            auto block = GetEnvironmentStringsW();
+            if (block != NULL)
+            {
+                for (auto variable = block; *variable != L'\0'; variable += std::wcslen(variable) + 1)
+                {
+                    variables.emplace_back(variable);
+                }
+
+                FreeEnvironmentStringsW(block);
+            }
+
+            return variables;
+        }
+
+        /**
+         * @brief Replace the variables of the process environment, which are inherited by subprocesses
+         *
+         * The hidden variables starting with `=` (the working directories of the drives) are kept.
+         */
+        static void _set_process_environment(const std::vector<std::wstring> &variables)
+        {
+            for (auto &variable : _process_environment())
+            {
+                auto equal = variable.find(L'=', 1);
+                if (variable[0] != L'=' && equal != std::wstring::npos)
+                {
+                    SetEnvironmentVariableW(variable.substr(0, equal).c_str(), NULL);
+                }
+            }
+
+            for (auto &variable : variables)
+            {
+                auto equal = variable.find(L'=', 1);
+                if (!variable.empty() && variable[0] != L'=' && equal != std::wstring::npos)
+                {
+                    SetEnvironmentVariableW(variable.substr(0, equal).c_str(), variable.substr(equal + 1).c_str());
+                }
+            }
+        }
+
+        /** @brief Run a request with the standard streams of the requesting process, return its errorlevel */
+        DWORD _run(const Request &request, const HANDLE process)
+        {
+            HANDLE handles[3] = {
+                _duplicate(process, request.input, GENERIC_READ),
+                _duplicate(process, request.output, GENERIC_WRITE),
+                _duplicate(process, request.error, GENERIC_WRITE)};
+            const DWORD standard[3] = {STD_INPUT_HANDLE, STD_OUTPUT_HANDLE, STD_ERROR_HANDLE};
+
+            // Subprocesses without redirection inherit the standard handles of the shell
+            HANDLE previous[3];
+            for (int i = 0; i < 3; i++)
+            {
+                previous[i] = GetStdHandle(standard[i]);
+                SetStdHandle(standard[i], handles[i]);
+            }
+
+            auto _finalize = utils::Finalize(
+                [&handles, &previous, &standard]()
+                {
+                    for (int i = 0; i < 3; i++)
+                    {
+                        SetStdHandle(standard[i], previous[i]);
+                        if (handles[i] != INVALID_HANDLE_VALUE)
+                        {
+                            CloseHandle(handles[i]);
+                        }
+                    }
+                });
+
+            auto input = utils::handle_reader(handles[0]);
+            utils::ConsoleBuffer output(handles[1]), error(handles[2]);
+            utils::StandardStreams streams(input.get(), &output, &error);
+
+            auto environment = _client->get_environment();
+            auto stream = _client->get_stream();
+
+            auto base = environment->snapshot();
+            auto directory = utils::get_working_directory();
+            auto process_environment = _process_environment();
+            auto _restore = utils::Finalize(
+                [environment, stream, &base, &directory, &process_environment]()
+                {
+                    stream->clear();
+                    _set_process_environment(process_environment);
+                    SetCurrentDirectoryW(utils::utf_convert(directory).c_str());
+                    environment->restore(base);
+                });
+
+            try
+            {
+                std::vector<std::wstring> variables;
+                for (auto &variable : request.environment)
+                {
+                    variables.push_back(utils::utf_convert(variable));
+                }
+
+                _set_process_environment(variables);
+                if (!SetCurrentDirectoryW(utils::utf_convert(request.directory).c_str()))
+                {
+                    throw std::runtime_error(utils::last_error(utils::format("Unable to change directory to \"%s\"", request.directory.c_str())));
+                }
+
+                _client->update_working_directory();
+
+                // Executables are searched in the PATH of the requester, after the directory of the shell
+                auto path = utils::get_environment_variable("PATH");
+                if (path.has_value())
+                {
+                    environment->set_value("PATH", utils::get_executable_directory() + LITE_SHELL_PATH_SEPARATOR + *path);
+                }
+
+                if (request.mode == Request::SCRIPT)
+                {
+                    return _client->run_until_finished(_client->get_batch_file(request.payload));
+                }
+
+                std::vector<std::string> lines = {InputStream::ECHO_OFF, request.payload};
+                return _client->run_until_finished(_client->compile(lines.begin(), lines.end()));
+            }
+            catch (std::exception &e)
+            {
+                std::cerr << e.what() << std::endl;
+                return 1;
+            }
+        }
+
+    public:
+        /**
+         * @brief Construct a new `Server` object
+         *
+         * @param client The shell executing the requests, which must outlive the server
+         * @param name The name of the server, see `pipe_name`
+         */
+        Server(Client *client, const std::string &name) : _client(client), _pipe_name(pipe_name(name)) {}
+
+        /** @brief The path to the named pipe of the server called `name` */
+        static std::wstring pipe_name(const std::string &name)
+        {
+            return utils::utf_convert("\\\\.\\pipe\\liteshell-" + name);
+        }
+
+        /** @brief Serve requests until the process exits */
+        [[noreturn]] void serve_forever()
+        {
+            _client->set_serving(true);
+
+            SECURITY_ATTRIBUTES attributes;
+            attributes.nLength = sizeof(attributes);
+            attributes.lpSecurityDescriptor = _security_descriptor();
+            attributes.bInheritHandle = FALSE;
+            auto _free = utils::Finalize(
+                [&attributes]()
+                {
+                    LocalFree(attributes.lpSecurityDescriptor);
+                });
+
+            while (true)
+            {
+                // The previous instance is closed before the next one is created, so each instance is the first one:
+                // creating it fails instead of joining a pipe of the same name created by another process
+                auto pipe = CreateNamedPipeW(
+                    _pipe_name.c_str(),
+                    PIPE_ACCESS_DUPLEX | FILE_FLAG_FIRST_PIPE_INSTANCE,
+                    PIPE_TYPE_MESSAGE | PIPE_READMODE_MESSAGE | PIPE_WAIT | PIPE_REJECT_REMOTE_CLIENTS,
+                    PIPE_UNLIMITED_INSTANCES,
+                    BUFFER_SIZE,
+                    BUFFER_SIZE,
+                    0,
+                    &attributes);
+                if (pipe == INVALID_HANDLE_VALUE)
+                {
+                    throw std::runtime_error(utils::last_error("Unable to create named pipe"));
+                }
+
+                auto _finalize = utils::Finalize(
+                    [&pipe]()
+                    {
+                        DisconnectNamedPipe(pipe);
+                        CloseHandle(pipe);
+                    });
+
+                if (!ConnectNamedPipe(pipe, NULL) && GetLastError() != ERROR_PIPE_CONNECTED)
+                {
+                    continue;
+                }
+
+                try
+                {
+                    auto request = Request::parse(_read_message(pipe));
+
+                    // The handles of the requester are only reachable through its process
+                    ULONG pid = 0;
+                    HANDLE process = NULL;
+                    if (GetNamedPipeClientProcessId(pipe, &pid))
+                    {
+                        process = OpenProcess(PROCESS_DUP_HANDLE, FALSE, pid);
+                    }
+
+                    auto errorlevel = _run(request, process);
+                    if (process != NULL)
+                    {
+                        CloseHandle(process);
+                    }
+
+                    std::string reply;
+                    for (int i = 0; i < 4; i++)
+                    {
+                        reply += static_cast<char>((errorlevel >> (8 * i)) & 0xFF);
+                    }
+
+                    _write_message(pipe, reply);
+                }
+                catch (std::exception &e)
+                {
+                    // A broken request must not stop the server
+                    std::cerr << e.what() << std::endl;
+                }
+            }
+        }
+
+        /**
+         * @brief Send a request to a running server and wait for its completion
+         *
+         * This does not construct a `Client`, so that the requesting process starts as fast as possible.
+         *
+         * @param name The name of the server
+         * @param mode Either `Request::COMMAND` or `Request::SCRIPT`
+         * @param payload The command line or the path to the batch script
+         * @return The errorlevel of the request
+         */
+        static DWORD send(const std::string &name, const std::uint32_t mode, const std::string &payload)
+        {
+            Request request;
+            request.mode = mode;
+            request.input = reinterpret_cast<std::uintptr_t>(GetStdHandle(STD_INPUT_HANDLE));
+            request.output = reinterpret_cast<std::uintptr_t>(GetStdHandle(STD_OUTPUT_HANDLE));
+            request.error = reinterpret_cast<std::uintptr_t>(GetStdHandle(STD_ERROR_HANDLE));
+            request.directory = utils::get_working_directory();
+            request.payload = payload;
+            for (auto &variable : _process_environment())
+            {
+                request.environment.push_back(utils::utf_convert(std::wstring_view(variable)));
+            }
+
+            auto path = pipe_name(name);
+            HANDLE pipe = INVALID_HANDLE_VALUE;
+            while (true)
+            {
+                pipe = CreateFileW(path.c_str(), GENERIC_READ | GENERIC_WRITE, 0, NULL, OPEN_EXISTING, 0, NULL);
+                if (pipe != INVALID_HANDLE_VALUE)
+                {
+                    break;
+                }
+
+                // All instances are busy while the server runs another request
+                if (GetLastError() != ERROR_PIPE_BUSY || !WaitNamedPipeW(path.c_str(), NMPWAIT_WAIT_FOREVER))
+                {
+                    throw std::runtime_error(utils::last_error(utils::format("Unable to connect to server \"%s\"", name.c_str())));
+                }
+            }
+
+            auto _finalize = utils::Finalize(
+                [&pipe]()
+                {
+                    CloseHandle(pipe);
+                });
+
+            DWORD pipe_mode = PIPE_READMODE_MESSAGE;
+            if (!SetNamedPipeHandleState(pipe, &pipe_mode, NULL, NULL))
+            {
+                throw std::runtime_error(utils::last_error("Unable to set pipe mode"));
+            }
+
+            _write_message(pipe, request.serialize());
+
+            auto reply = _read_message(pipe);
+            if (reply.size() != 4)
+            {
+                throw std::runtime_error("Malformed server reply");
+            }
+
+            DWORD errorlevel = 0;
+            for (int i = 0; i < 4; i++)
+            {
+                errorlevel |= static_cast<DWORD>(static_cast<unsigned char>(reply[i])) << (8 * i);
+            }
+
+            return errorlevel;
+        }
+    };
+}
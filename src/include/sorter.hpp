@@ -0,0 +1,378 @@
+#pragma once
+
+#include "mapped_file.hpp"
+#include "thread_pool.hpp"
+
+namespace utils
+{
+    /**
+     * @brief A stable sort of lines, which spills to disk when its input exceeds a memory budget.
+     *
+     * Lines are appended to a single buffer and indexed by their position, so adding a line does not allocate
+     * (beyond the amortized growth of the buffer and the index). While the lines fit in the budget, they are sorted
+     * in memory by a parallel merge sort. Otherwise, each time the budget is reached the lines are sorted and written
+     * to a temporary file (a run), and `finish` merges the runs and the last lines in memory with a k-way merge. The
+     * runs are deleted when they are closed, and mapped into memory while they are merged.
+     *
+     * Numeric sorting compares the number at the beginning of each line (after blanks, with an optional sign and
+     * decimal part), a line without a number counting as 0. Lines comparing equal keep their input order, even in
+     * reverse order and across runs.
+     */
+    class LineSorter
+    {
+    private:
+        /** @brief A line, as a position in the buffer of the current run */
+        struct _Line
+        {
+            std::size_t offset, size;
+            double key;
+        };
+
+        /** @brief The smallest number of lines sorted by several threads */
+        static const std::size_t PARALLEL_THRESHOLD = 1 << 15;
+
+        /** @brief The size of the writes to runs and to the output */
+        static const std::size_t BUFFER_SIZE = 1 << 20;
+
+        const bool _numeric, _reverse;
+        const std::size_t _budget, _workers;
+
+        std::string _buffer;
+        std::vector<_Line> _lines;
+
+        /** @brief The runs spilled to disk so far, in input order */
+        std::vector<std::unique_ptr<MappedFile>> _runs;
+
+        std::size_t _count = 0;
+
+        LineSorter(const LineSorter &) = delete;
+        LineSorter &operator=(const LineSorter &) = delete;
+
+        static double _parse(const std::string_view &line)
+        {
+            std::size_t i = 0;
+            while (i < line.size() && (line[i] == ' ' || line[i] == '\t'))
+            {
+                i++;
+            }
+
+            auto negative = i < line.size() && line[i] == '-';
+            if (i < line.size() && (line[i] == '-' || line[i] == '+'))
+            {
+                i++;
+            }
+
+            double value = 0;
+            for (; i < line.size() && std::isdigit(static_cast<unsigned char>(line[i])); i++)
+            {
+                value = value * 10 + (line[i] - '0');
+            }
+
+            if (i < line.size() && line[i] == '.')
+            {
+                double scale = 1;
+                for (i++; i < line.size() && std::isdigit(static_cast<unsigned char>(line[i])); i++)
+                {
+                    scale /= 10;
+                    value += (line[i] - '0') * scale;
+                }
+            }
+
+            return negative ? -value : value;
+        }
+
+        /** @brief Whether a line goes strictly before another one */
+        bool _before(const double first_key, const std::string_view &first, const double second_key, const std::string_view &second) const
+        {
+            if (_reverse)
+            {
+                return _numeric ? second_key < first_key : second < first;
+            }
+
+            return _numeric ? first_key < second_key : first < second;
+        }
+
+        std::string_view _view(const _Line &line) const
+        {
+            return std::string_view(_buffer.data() + line.offset, line.size);
+        }
+
+        template <typename Iterator, typename Compare>
+        static void _parallel_sort(const Iterator begin, const Iterator end, const Compare &compare, const std::size_t workers)
+        {
+            if (workers <= 1 || static_cast<std::size_t>(end - begin) < PARALLEL_THRESHOLD)
+            {
+                std::stable_sort(begin, end, compare);
+                return;
+            }
+
+            // Each half is sorted on its own, the merge keeps the lines of the first half first among equal ones
+            auto middle = begin + (end - begin) / 2;
+            auto job = ThreadPool::shared().submit(
+                [&]()
+                {
+                    _parallel_sort(begin, middle, compare, workers / 2);
+                });
+
+            _parallel_sort(middle, end, compare, workers - workers / 2);
+            job.get();
+            std::inplace_merge(begin, middle, end, compare);
+        }
+
+        void _sort()
+        {
+            _parallel_sort(
+                _lines.begin(), _lines.end(),
+                [this](const _Line &first, const _Line &second)
+                {
+                    return _before(first.key, _view(first), second.key, _view(second));
+                },
+                _workers);
+        }
+
+        /** @brief Sort the lines in memory and move them to a new run */
+        void _spill()
+        {
+            _sort();
+
+            wchar_t directory[MAX_PATH], path[MAX_PATH];
+            if (GetTempPathW(MAX_PATH, directory) == 0 || GetTempFileNameW(directory, L"lsh", 0, path) == 0)
+            {
+                throw std::runtime_error(last_error("Error when creating a temporary file"));
+            }
+
+            auto file = CreateFileW(
+                path,
+                GENERIC_READ | GENERIC_WRITE,
+                0,
+                NULL,
+                CREATE_ALWAYS,
+                FILE_ATTRIBUTE_TEMPORARY | FILE_FLAG_DELETE_ON_CLOSE,
+                NULL);
+
+            if (file == INVALID_HANDLE_VALUE)
+            {
+                throw std::runtime_error(last_error("Error when creating a temporary file"));
+            }
+
+            std::string chunk;
+            chunk.reserve(BUFFER_SIZE + 1);
+            auto write = [&file, &chunk]()
+            {
+                DWORD written;
+                if (!WriteFile(file, chunk.data(), chunk.size(), &written, NULL) || written != chunk.size())
+                {
+                    auto message = last_error("Error when writing a temporary file");
+                    CloseHandle(file);
+                    throw std::runtime_error(message);
+                }
+
+                chunk.clear();
+            };
+
+            for (auto &line : _lines)
+            {
+                chunk += _view(line);
+                chunk += '\n';
+                if (chunk.size() >= BUFFER_SIZE)
+                {
+                    write();
+                }
+            }
+
+            write();
+
+            // The mapping owns the handle from now on, the file is deleted when it is unmapped
+            _runs.push_back(std::make_unique<MappedFile>(file));
+
+            _buffer.clear();
+            _lines.clear();
+        }
+
+    public:
+        /**
+         * @brief Construct a new `LineSorter` object
+         *
+         * @param numeric Whether to compare the numbers at the beginning of the lines instead of the lines
+         * @param reverse Whether to sort in descending order
+         * @param budget The number of bytes of lines (and of their index) kept in memory before spilling them
+         * @param workers The number of threads sorting in memory
+         */
+        LineSorter(
+            const bool numeric,
+            const bool reverse,
+            const std::size_t budget,
+            const std::size_t workers = std::max(1u, std::thread::hardware_concurrency()))
+            : _numeric(numeric), _reverse(reverse), _budget(budget), _workers(workers) {}
+
+        /** @brief Add a line, without its line terminator */
+        void add(const std::string_view &line)
+        {
+            if (!_lines.empty() && _buffer.size() + line.size() + (_lines.size() + 1) * sizeof(_Line) > _budget)
+            {
+                _spill();
+            }
+
+            _lines.push_back({_buffer.size(), line.size(), _numeric ? _parse(line) : 0});
+            _buffer += line;
+            _count++;
+        }
+
+        /**
+         * @brief Add the lines of a chunk, separated by LF or CRLF
+         *
+         * @param data The lines, the last one may lack a line terminator
+         */
+        void add_lines(const std::string_view &data)
+        {
+            std::size_t offset = 0;
+            while (offset < data.size())
+            {
+                auto end = data.find('\n', offset);
+                end = end == std::string_view::npos ? data.size() : end;
+
+                auto size = end - offset;
+                if (size > 0 && data[end - 1] == '\r')
+                {
+                    size--;
+                }
+
+                add(data.substr(offset, size));
+                offset = end + 1;
+            }
+        }
+
+        /** @brief The number of lines added so far */
+        std::size_t size() const
+        {
+            return _count;
+        }
+
+        /** @brief The number of runs spilled to disk so far */
+        std::size_t runs() const
+        {
+            return _runs.size();
+        }
+
+        /**
+         * @brief Write the sorted lines, each followed by LF
+         *
+         * @param output The stream to write to
+         */
+        void finish(std::ostream &output)
+        {
+            _sort();
+
+            std::string chunk;
+            chunk.reserve(BUFFER_SIZE + 1);
+            auto emit = [&output, &chunk](const std::string_view &line)
+            {
+                chunk += line;
+                chunk += '\n';
+                if (chunk.size() >= BUFFER_SIZE)
+                {
+                    output.write(chunk.data(), chunk.size());
+                    chunk.clear();
+                }
+            };
+
+            if (_runs.empty())
+            {
+                for (auto &line : _lines)
+                {
+                    emit(_view(line));
+                }
+            }
+            else
+            {
+                // The sources of the merge are the runs, then the lines still in memory which came last
+                struct _Source
+                {
+                    std::string_view data, line;
+                    double key;
+                };
+
+                std::vector<_Source> sources;
+                for (auto &run : _runs)
+                {
+                    sources.push_back({run->view(), std::string_view(), 0});
+                }
+
+                std::size_t memory = 0;
+                auto advance = [&](const std::size_t index)
+                {
+                    auto &source = sources[index];
+                    if (index == _runs.size())
+                    {
+                        if (memory == _lines.size())
+                        {
+                            return false;
+                        }
+
+                        source.line = _view(_lines[memory]);
+                        source.key = _lines[memory++].key;
+                        return true;
+                    }
+
+                    if (source.data.empty())
+                    {
+                        return false;
+                    }
+
+                    auto end = source.data.find('\n');
+                    source.line = source.data.substr(0, end);
+                    source.data.remove_prefix(end + 1);
+                    source.key = _numeric ? _parse(source.line) : 0;
+                    return true;
+                };
+
+                sources.push_back({std::string_view(), std::string_view(), 0});
+
+                // The top of the heap is the source with the first line, the earliest source among equal lines
+                auto after = [this, &sources](const std::size_t first, const std::size_t second)
+                {
+                    auto &a = sources[first], &b = sources[second];
+                    if (_before(b.key, b.line, a.key, a.line))
+                    {
+                        return true;
+                    }
+
+                    return !_before(a.key, a.line, b.key, b.line) && first > second;
+                };
+
+                std::vector<std::size_t> heap;
+                for (std::size_t i = 0; i < sources.size(); i++)
+                {
+                    if (advance(i))
+                    {
+                        heap.push_back(i);
+                    }
+                }
+
+                std::make_heap(heap.begin(), heap.end(), after);
+                while (!heap.empty())
+                {
+                    std::pop_heap(heap.begin(), heap.end(), after);
+                    auto index = heap.back();
+                    emit(sources[index].line);
+
+                    if (advance(index))
+                    {
+                        std::push_heap(heap.begin(), heap.end(), after);
+                    }
+                    else
+                    {
+                        heap.pop_back();
+                    }
+                }
+            }
+
+            output.write(chunk.data(), chunk.size());
+            output.flush();
+
+            _runs.clear();
+            _buffer.clear();
+            _lines.clear();
+        }
+    };
+}
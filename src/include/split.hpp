@@ -5,31 +5,190 @@
 namespace utils
 {
     /**
-     * @brief Split a string into tokens using the native method [`CommandLineToArgvW`](https://learn.microsoft.com/en-us/windows/win32/api/shellapi/nf-shellapi-commandlinetoargvw)
+     * @brief Split a string into tokens with the quoting rules of
+     * [`CommandLineToArgvW`](https://learn.microsoft.com/en-us/windows/win32/api/shellapi/nf-shellapi-commandlinetoargvw)
+     *
+     * The UTF-8 string is tokenized directly, without a round trip through UTF-16:
+     * - The first token ends at the next space or tab, or at the closing quote if it starts with a quote. Backslashes
+     *   are not special in it.
+     * - Other tokens are separated by spaces and tabs outside of quotes. 2n backslashes followed by a quote produce n
+     *   backslashes and the quote toggles the quoted mode, 2n+1 backslashes followed by a quote produce n backslashes
+     *   and a literal quote, other backslashes are kept as is. Within quotes, `""` produces a literal quote and ends
+     *   the quoted mode, `"""` produces a literal quote and stays in it.
+     *
+     * Unlike `CommandLineToArgvW`, an empty string has no tokens instead of the path of the executable.
      *
      * @param original The string to split
      * @return A vector of strings containing the tokens
      */
-    std::vector<std::string> split(const std::string &original)
+    std::vector<std::string> split(const std::string_view &original)
     {
-        auto wstr = utf_convert(original);
+        auto is_blank = [](const char c)
+        {
+            return c == ' ' || c == '\t';
+        };
 
-        int size = 0;
-        auto results = CommandLineToArgvW(wstr.c_str(), &size);
-        if (results == NULL)
+        std::vector<std::string> args;
+        if (original.empty())
         {
-            throw std::runtime_error(last_error("CommandLineToArgvW ERROR"));
+            return args;
         }
 
-        std::vector<std::string> args(size);
-        for (int i = 0; i < size; i++)
+        const auto size = original.size();
+        std::size_t i = 0;
+        if (original[0] == '"')
+        {
+            auto end = std::min(original.find('"', 1), size);
+            args.emplace_back(original.substr(1, end - 1));
+            i = std::min(end + 1, size);
+        }
+        else
         {
-            args[i] = utf_convert(std::wstring(results[i]));
+            while (i < size && !is_blank(original[i]))
+            {
+                i++;
+            }
+
+            args.emplace_back(original.substr(0, i));
+        }
+
+        // `quotes` is 1 within quotes and 0 otherwise, `backslashes` counts the backslashes just before position `i`
+        std::size_t quotes = 0, backslashes = 0;
+        std::string token;
+        while (true)
+        {
+            while (i < size && is_blank(original[i]))
+            {
+                i++;
+            }
+
+            if (i == size)
+            {
+                break;
+            }
+
+            token.clear();
+            backslashes = 0;
+            while (i < size && (quotes != 0 || !is_blank(original[i])))
+            {
+                auto c = original[i++];
+                if (c == '\\')
+                {
+                    token += c;
+                    backslashes++;
+                }
+                else if (c == '"')
+                {
+                    if (backslashes % 2 == 0)
+                    {
+                        token.resize(token.size() - backslashes / 2);
+                        quotes++;
+                    }
+                    else
+                    {
+                        token.resize(token.size() - backslashes / 2 - 1);
+                        token += '"';
+                    }
+
+                    backslashes = 0;
+                    for (; i < size && original[i] == '"'; i++)
+                    {
+                        if (++quotes == 3)
+                        {
+                            token += '"';
+                            quotes = 0;
+                        }
+                    }
+
+                    if (quotes == 2)
+                    {
+                        quotes = 0;
+                    }
+                }
+                else
+                {
+                    token += c;
+                    backslashes = 0;
+                }
+            }
+
+            args.push_back(token);
         }
 
         return args;
     }
 
+    /**
+     * @brief Quote a token so that `split` produces it back, when it is not the first token of a command line
+     *
+     * @param token The token to quote
+     * @return The token itself if it contains no space, tab or quote, otherwise the token within quotes
+     */
+    std::string quote(const std::string_view &token)
+    {
+        if (!token.empty() && token.find_first_of(" \t\"") == std::string_view::npos)
+        {
+            return std::string(token);
+        }
+
+        // Backslashes are only special before a quote, including the closing one
+        std::string result = "\"";
+        std::size_t backslashes = 0;
+        for (auto c : token)
+        {
+            if (c == '\\')
+            {
+                backslashes++;
+                continue;
+            }
+
+            result.append(c == '"' ? 2 * backslashes + 1 : backslashes, '\\');
+            result += c;
+            backslashes = 0;
+        }
+
+        result.append(2 * backslashes, '\\');
+        result += '"';
+        return result;
+    }
+
+    /**
+     * @brief Join the tokens of a command whose arguments were already resolved back into a command line
+     *
+     * The first token is only quoted if it contains a space or a tab, and `$` are escaped as `$$` so that the
+     * arguments are not resolved again when the line is executed.
+     *
+     * @param begin An iterator to the first token, the command to run
+     * @param end An iterator past the last token
+     * @return The command line
+     */
+    std::string join_command(std::vector<std::string>::const_iterator begin, const std::vector<std::string>::const_iterator end)
+    {
+        if (begin == end)
+        {
+            return "";
+        }
+
+        std::string line = begin->find_first_of(" \t") == std::string::npos ? *begin : "\"" + *begin + "\"";
+        for (begin++; begin != end; begin++)
+        {
+            line += ' ';
+            line += quote(*begin);
+        }
+
+        std::string escaped;
+        for (auto c : line)
+        {
+            escaped += c;
+            if (c == '$')
+            {
+                escaped += '$';
+            }
+        }
+
+        return escaped;
+    }
+
     /** @brief Split a string into tokens using a delimiter */
     std::vector<std::string> split(const std::string &original, const char delimiter)
     {
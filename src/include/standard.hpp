@@ -1,20 +1,43 @@
 #pragma once
 
+#include <algorithm>
+#include <array>
+#include <atomic>
 #include <cctype>
+#include <charconv>
 #include <chrono>
 #include <codecvt>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cwctype>
+#include <deque>
 #include <fstream>
+#include <functional>
+#include <future>
 #include <iostream>
+#include <limits>
+#include <list>
+#include <locale>
+#include <map>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <new>
 #include <optional>
+#include <random>
+#include <set>
 #include <sstream>
 #include <stack>
+#include <string>
+#include <string_view>
+#include <thread>
 #include <unordered_map>
+#include <vector>
 
-#include <pathcch.h>
-#include <windows.h>
-#include <wininet.h>
-
-#include <boost/regex.hpp>
+#include "platform.hpp"
 
 namespace std
 {
@@ -60,8 +83,8 @@ namespace std
         }
     }
 
-    template <typename T>
-    ostream &operator<<(ostream &stream, const vector<T> &_v)
+    template <typename T, typename Alloc>
+    ostream &operator<<(ostream &stream, const vector<T, Alloc> &_v)
     {
         stream << "[";
         __list_elements(stream, _v.begin(), _v.end());
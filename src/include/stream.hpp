@@ -1,5 +1,10 @@
 #pragma once
 
+#include "counters.hpp"
+#include "line_editor.hpp"
+#include "pipe.hpp"
+#include "script.hpp"
+
 namespace liteshell
 {
     /**
@@ -7,10 +12,14 @@ namespace liteshell
      *
      * This class manages the input stream for the shell. Typically, the input comes from stdin, but when reading from
      * a batch script, the input stream comes from the script file instead.
+     *
+     * The stream is a stack of frames, each frame executes a compiled `Script` from a position. Reading takes
+     * instructions from the topmost frame, a frame is dropped once it is exhausted and stdin is used when no
+     * frame is left.
      */
     class InputStream
     {
-    private:
+    public:
         /**
          * @brief A special command to turn off echo.
          *
@@ -25,18 +34,41 @@ namespace liteshell
          */
         static const std::string ECHO_ON;
 
-        struct _list_iterator_compare
+    private:
+        struct _Frame
         {
-            template <typename _Iter>
-            bool operator()(const _Iter &lhs, const _Iter &rhs) const
-            {
-                return &(*lhs) < &(*rhs);
-            }
+            /** @brief The script being executed */
+            std::shared_ptr<const Script> script;
+
+            /** @brief The index of the first instruction of the frame */
+            std::size_t begin;
+
+            /** @brief The index after the last instruction of the frame */
+            std::size_t end;
+
+            /** @brief The index of the next instruction to read */
+            std::size_t position;
+
+            /** @brief The echo state to restore when this frame is dropped, if any */
+            std::optional<bool> echo;
+
+            /**
+             * @brief For loop frames, a callback invoked when the frame is exhausted. It prepares the next
+             * iteration and returns `true` if the frame should be executed again.
+             */
+            std::function<bool()> repeat;
+
+            /** @brief Whether this frame executes a subroutine, see `call` */
+            bool subroutine;
+
+            /** @brief A callback invoked when the frame is dropped, e.g. to restore the arguments of a subroutine */
+            std::function<void()> finalize;
         };
 
-        std::list<std::string> _list;
-        std::list<std::string>::iterator _iterator = _list.begin();
-        std::set<std::list<std::string>::iterator, _list_iterator_compare> _run_once;
+        std::vector<_Frame> _frames;
+
+        /** @brief The number of subroutine frames on the stack */
+        std::size_t _calls = 0;
 
         InputStream(const InputStream &) = delete;
         InputStream &operator=(const InputStream &) = delete;
@@ -44,26 +76,59 @@ namespace liteshell
         /** @brief The current echo state */
         bool _echo = true;
 
-        void _shift_iterator()
+        /** @brief The history of the command lines read from stdin, and the editor reading them from the console */
+        std::shared_ptr<History> _history;
+        std::unique_ptr<LineEditor> _editor;
+        Completer _completer;
+
+        static bool _exhausted(const _Frame &frame)
         {
-            auto _run_once_iter = _run_once.find(_iterator);
-            if (_run_once_iter != _run_once.end())
+            return frame.position >= frame.end;
+        }
+
+        void _pop_frame()
+        {
+            auto echo = _frames.back().echo;
+            auto finalize = std::move(_frames.back().finalize);
+            _calls -= _frames.back().subroutine;
+            _frames.pop_back();
+
+            if (echo.has_value())
             {
-                _run_once.erase(_run_once_iter);
-                _iterator = _list.erase(_iterator);
+                _echo = *echo;
             }
-            else
+
+            if (finalize)
+            {
+                finalize();
+            }
+        }
+
+        void _pop_exhausted()
+        {
+            while (!_frames.empty() && _exhausted(_frames.back()))
             {
-                _iterator++;
+                auto &frame = _frames.back();
+                if (frame.repeat && frame.repeat())
+                {
+                    frame.position = frame.begin;
+                }
+                else
+                {
+                    _pop_frame();
+                }
             }
         }
 
     public:
         /**
-         * @brief A special label appended at the end of each batch script and clear the input stream when executed.
+         * @brief A special label appended at the end of each batch script and drop the script when executed.
          */
         static const std::string STREAM_EOF;
 
+        /** @brief The maximum number of nested subroutine calls */
+        static constexpr std::size_t MAX_CALL_DEPTH = 4096;
+
         /** @brief A flag indicating that `getline` must echo the input to stdout */
         static const int FORCE_STDOUT = 1 << 0;
 
@@ -78,15 +143,28 @@ namespace liteshell
          */
         InputStream() {}
 
+        /** @brief Whether the instructions read from the frames are echoed */
+        bool echo() const
+        {
+            return _echo;
+        }
+
+        /** @brief Set whether the instructions read from the frames are echoed, like `@ON` and `@OFF` */
+        void set_echo(const bool echo)
+        {
+            _echo = echo;
+        }
+
         /** @brief The echo state after the next command */
         bool peek_echo()
         {
-            if (peek() == ECHO_ON)
+            auto next = peek();
+            if (next == ECHO_ON)
             {
                 return true;
             }
 
-            if (peek() == ECHO_OFF)
+            if (next == ECHO_OFF)
             {
                 return false;
             }
@@ -101,12 +179,11 @@ namespace liteshell
          */
         std::optional<std::string> peek()
         {
-            for (auto iter = _iterator; iter != _list.end(); iter++)
+            for (auto frame = _frames.rbegin(); frame != _frames.rend(); frame++)
             {
-                auto text = utils::strip(*iter);
-                if (!text.empty())
+                if (!_exhausted(*frame))
                 {
-                    return text;
+                    return frame->script->instructions[frame->position].source;
                 }
             }
 
@@ -114,33 +191,42 @@ namespace liteshell
         }
 
         /**
-         * @brief Read the next command
+         * @brief Read the next instruction
+         *
+         * Lines read from stdin are compiled on the fly without binding to a built-in command.
          *
          * @param prompt The function to display the prompt string before reading
          * @param flags The flags to use when reading the command
-         * @return The next command in the input stream
+         * @return A handle to the next instruction in the input stream
          */
-        std::string getline(const std::function<void()> &prompt, const int flags)
+        InstructionHandle next(const std::function<void()> &prompt, const int flags)
         {
 #ifdef DEBUG
             std::cout << "Received getline request, flags = " << flags << std::endl;
-            std::cout << "Current input stream: " << _list << std::endl;
-            std::cout << "Iterator position: " << std::distance(_list.begin(), _iterator);
-            if (_iterator != _list.end())
+            std::cout << "Current input stream: " << _frames.size() << " frame(s)";
+            if (!_frames.empty())
             {
-                std::cout << " (\"" << *_iterator << "\")";
+                std::cout << ", position " << _frames.back().position << " in [" << _frames.back().begin << ", " << _frames.back().end << ")";
             }
             std::cout << std::endl;
 #endif
 
-            if ((flags & FORCE_STDIN) & (flags & FORCE_STREAM))
+            if ((flags & FORCE_STDIN) && (flags & FORCE_STREAM))
             {
                 throw std::invalid_argument("Arguments conflict: FORCE_STDIN && FORCE_STREAM");
             }
 
-            if ((flags & FORCE_STREAM) && exhaust())
+            if (flags & FORCE_STREAM)
+            {
+                // Never leave the current frame when its content is explicitly requested
+                if (_frames.empty() || _exhausted(_frames.back()))
+                {
+                    throw std::runtime_error("Unexpected EOF while reading");
+                }
+            }
+            else if (!(flags & FORCE_STDIN))
             {
-                throw std::runtime_error("Unexpected EOF while reading");
+                _pop_exhausted();
             }
 
             if ((flags & FORCE_STDOUT) || (_echo && peek_echo()))
@@ -150,139 +236,453 @@ namespace liteshell
 
             bool from_stdin = (flags & FORCE_STDIN) || exhaust();
 
-            std::string line;
+            std::optional<InstructionHandle> handle;
             if (from_stdin)
             {
-                std::getline(std::cin, line);
-                if (std::cin.fail() || std::cin.eof())
+                // Inside a pipeline, the input of a stage may come from the previous one instead of the console
+                auto &input = utils::StandardStreams::input();
+
+                // Command lines typed in the console are edited with history recall, other input is read as is
+                bool command = !(flags & FORCE_STDIN);
+                std::string line;
+                if (command && _editor != nullptr && !utils::StandardStreams::is_input_redirected() && _editor->interactive())
+                {
+                    auto edited = _editor->read_line(prompt);
+                    if (!edited.has_value())
+                    {
+                        return next(prompt, flags);
+                    }
+
+                    line = std::move(*edited);
+                }
+                else
                 {
-                    std::cin.clear();
-                    std::cout << std::endl;
-                    return getline(prompt, flags);
+                    std::getline(input, line);
+                    // A console can be read again after an EOF (Ctrl-Z), a file or a pipe is exhausted for good
+                    DWORD mode;
+                    if (utils::StandardStreams::is_input_redirected() || !GetConsoleMode(GetStdHandle(STD_INPUT_HANDLE), &mode))
+                    {
+                        // There is no console to retry on, a last line without a newline is still accepted
+                        if (input.fail())
+                        {
+                            throw std::runtime_error("Unexpected EOF while reading");
+                        }
+                    }
+                    else if (input.fail() || input.eof())
+                    {
+                        std::cin.clear();
+                        std::cout << '\n';
+                        return next(prompt, flags);
+                    }
                 }
+
+                if (command && _history != nullptr)
+                {
+                    try
+                    {
+                        _history->add(line);
+                    }
+                    catch (std::exception &e)
+                    {
+                        std::cerr << e.what() << '\n';
+                    }
+                }
+
+                std::vector<Instruction> instructions;
+                instructions.emplace_back(line, nullptr);
+                handle.emplace(std::make_shared<const Script>(std::move(instructions)), 0);
             }
             else
             {
-                line = *_iterator;
-                _shift_iterator();
+                auto &frame = _frames.back();
+                handle.emplace(frame.script, frame.position++);
             }
-            line = utils::strip(line);
 
+            const auto &line = (*handle)->source;
             if (line == ECHO_OFF)
             {
                 _echo = false;
-                return getline(prompt, flags);
+                return next(prompt, flags);
             }
             else if (line == ECHO_ON)
             {
                 _echo = true;
-                return getline(prompt, flags);
+                return next(prompt, flags);
             }
 
-            if (line == STREAM_EOF)
+            if (!from_stdin && line == STREAM_EOF)
             {
-                clear();
+                _pop_frame();
                 if (flags & FORCE_STREAM)
                 {
                     throw std::runtime_error("Unexpected EOF while reading");
                 }
+
+                return next(prompt, flags);
             }
 
             if (!from_stdin && _echo)
             {
-                std::cout << line << std::endl;
+                std::cout << line << '\n';
             }
 
+            Counters::global().add(Counters::STREAM_BYTES, line.size());
+
 #ifdef DEBUG
             std::cout << "Response for getline request: " << line << std::endl;
 #endif
-            return line;
+            return *handle;
         }
 
-        template <typename _ForwardIterator>
-        void write(const _ForwardIterator &__begin, const _ForwardIterator &__end, const bool run_once)
+        /**
+         * @brief Read the next command
+         *
+         * @param prompt The function to display the prompt string before reading
+         * @param flags The flags to use when reading the command
+         * @return The next command in the input stream
+         */
+        std::string getline(const std::function<void()> &prompt, const int flags)
         {
-            _iterator = _list.insert(_iterator, __begin, __end);
+            return next(prompt, flags)->source;
+        }
 
-            if (run_once)
+        /**
+         * @brief Push a script onto the stream, its instructions will be read before the remaining ones.
+         *
+         * @param script The compiled script to push
+         * @param restore_echo Whether to restore the current echo state once the script is exhausted
+         */
+        void write(const std::shared_ptr<const Script> &script, const bool restore_echo)
+        {
+            if (script->size() > 0)
             {
-                std::size_t distance = std::distance(__begin, __end);
-                auto iter = _iterator;
-                for (std::size_t i = 0; i < distance; i++)
-                {
-                    _run_once.insert(iter);
-                    iter++;
-                }
+                _frames.push_back({script, 0, script->size(), 0, restore_echo ? std::optional<bool>(_echo) : std::nullopt, nullptr, false, nullptr});
+            }
+        }
+
+        /**
+         * @brief Push a range of a script onto the stream, without copying its instructions.
+         *
+         * @param script The script containing the instructions to execute
+         * @param begin The index of the first instruction to execute
+         * @param end The index after the last instruction to execute
+         */
+        void write(const std::shared_ptr<const Script> &script, const std::size_t begin, const std::size_t end)
+        {
+            if (begin > end || end > script->size())
+            {
+                throw std::out_of_range(utils::format("Invalid range [%zu, %zu)", begin, end));
+            }
+
+            if (begin < end)
+            {
+                _frames.push_back({script, begin, end, begin, std::nullopt, nullptr, false, nullptr});
+            }
+        }
+
+        /**
+         * @brief Push a script whose instructions are never read, so that `call` and `jump` find its labels.
+         *
+         * The frame is exhausted from the start: it is dropped once the frames pushed above it are.
+         *
+         * @param script The script declaring the labels
+         */
+        void write_labels(const std::shared_ptr<const Script> &script)
+        {
+            _frames.push_back({script, 0, script->size(), script->size(), std::nullopt, nullptr, false, nullptr});
+        }
+
+        /**
+         * @brief Push a loop onto the stream.
+         *
+         * The instructions in range [`begin`, `end`) of `script` are executed once, then again each time `repeat`
+         * returns `true`. No instruction is copied, so the memory usage does not depend on the number of iterations.
+         *
+         * @param script The script containing the loop body
+         * @param begin The index of the first instruction of the loop body
+         * @param end The index after the last instruction of the loop body
+         * @param repeat A callback invoked after each iteration, which prepares and returns whether there is a next one
+         */
+        void loop(
+            const std::shared_ptr<const Script> &script,
+            const std::size_t begin,
+            const std::size_t end,
+            const std::function<bool()> &repeat)
+        {
+            if (begin > end || end > script->size())
+            {
+                throw std::out_of_range(utils::format("Invalid loop range [%zu, %zu)", begin, end));
+            }
+
+            _frames.push_back({script, begin, end, begin, std::nullopt, repeat, false, nullptr});
+        }
+
+        /**
+         * @brief Get the position of the next instruction in the topmost frame.
+         *
+         * @return The script executed by the topmost frame and the index of its next instruction,
+         * or `std::nullopt` if the stream is empty
+         */
+        std::optional<std::pair<std::shared_ptr<const Script>, std::size_t>> tell() const
+        {
+            if (_frames.empty())
+            {
+                return std::nullopt;
             }
+
+            return std::make_pair(_frames.back().script, _frames.back().position);
         }
 
-        void write(const std::string &data, const bool run_once)
+        /**
+         * @brief Move the topmost frame to another instruction within its range
+         *
+         * @param position The index of the next instruction to read
+         * @return Whether the position is within the range of the topmost frame, the stream is unchanged otherwise
+         */
+        bool seek(const std::size_t position)
         {
-            std::vector<std::string> lines;
-            for (auto &line : utils::split(data, '\n'))
+            if (_frames.empty())
+            {
+                return false;
+            }
+
+            auto &frame = _frames.back();
+            if (position < frame.begin || position > frame.end)
+            {
+                return false;
+            }
+
+            frame.position = position;
+            return true;
+        }
+
+        /**
+         * @brief Call the subroutine starting at the specified label.
+         *
+         * The label is searched like `jump` does, but no frame is dropped: a new frame executes the script containing
+         * the label from the instruction after it, until `leave_call` is called or the end of the script is reached.
+         * The instructions are not copied, so calling a subroutine does not depend on its length.
+         *
+         * @param label The label declaring the subroutine
+         * @param finalize A callback invoked when the subroutine returns, e.g. to restore its arguments
+         */
+        void call(const std::string &label, const std::function<void()> &finalize)
+        {
+            if (_frames.empty())
+            {
+                throw std::runtime_error("Cannot call a subroutine since the input stream is empty");
+            }
+
+            if (_calls >= MAX_CALL_DEPTH)
+            {
+                throw std::runtime_error(utils::format("Maximum call depth of %zu exceeded", MAX_CALL_DEPTH));
+            }
+
+            for (auto frame = _frames.rbegin(); frame != _frames.rend(); frame++)
             {
-                line = utils::strip(line);
-                if (!line.empty())
+                auto index = frame->script->find_label(label, frame->begin, frame->end, frame->position);
+                if (index.has_value())
                 {
-                    lines.push_back(line);
+                    // Copy the script first, the frame may be moved by `push_back`
+                    auto script = frame->script;
+                    _frames.push_back({script, 0, script->size(), *index + 1, std::nullopt, nullptr, true, finalize});
+                    _calls++;
+                    return;
                 }
             }
 
-            write(lines.begin(), lines.end(), run_once);
+            throw std::runtime_error(utils::format("Label \"%s\" not found", label.c_str()));
         }
 
-        void clear()
+        /** @brief Return from the innermost subroutine, dropping the frames it pushed */
+        void leave_call()
         {
-#ifdef DEBUG
-            std::cout << "Clearing input stream" << std::endl;
-#endif
+            if (_calls == 0)
+            {
+                throw std::runtime_error("Not inside a subroutine");
+            }
 
-            _list.erase(_list.begin(), _iterator);
+            while (!_frames.back().subroutine)
+            {
+                _pop_frame();
+            }
 
-#ifdef DEBUG
-            std::cout << "Cleared input stream, current size = " << _list.size() << std::endl;
-#endif
+            _pop_frame();
         }
 
-        /** @brief Whether the underlying iterator reaches the end of the linked-list */
-        bool exhaust() const
+        /** @brief A snapshot of the content of an input stream */
+        struct Statistics
         {
-            return _iterator == _list.end();
+            /** @brief The number of frames on the stack */
+            std::size_t frames;
+
+            /** @brief The number of loop frames on the stack */
+            std::size_t loops;
+
+            /** @brief The number of subroutine frames on the stack */
+            std::size_t calls;
+
+            /** @brief The number of distinct scripts referenced by the frames */
+            std::size_t scripts;
+
+            /** @brief The number of instructions left to read in all frames, without counting loop repetitions */
+            std::size_t instructions;
+
+            /** @brief An estimation of the memory used by the referenced scripts, in bytes */
+            std::size_t bytes;
+        };
+
+        /** @brief Collect statistics about the current content of the stream */
+        Statistics statistics() const
+        {
+            Statistics result = {_frames.size(), 0, _calls, 0, 0, 0};
+
+            std::set<const Script *> scripts;
+            for (auto &frame : _frames)
+            {
+                if (frame.repeat)
+                {
+                    result.loops++;
+                }
+
+                if (!_exhausted(frame))
+                {
+                    result.instructions += frame.end - frame.position;
+                }
+
+                if (scripts.insert(frame.script.get()).second)
+                {
+                    result.bytes += frame.script->memory_usage();
+                }
+            }
+
+            result.scripts = scripts.size();
+            return result;
         }
 
-        void append_footer(std::stringstream &stream)
+        /**
+         * @brief Record the command lines read from stdin into a history, and edit them with history recall when they
+         * are typed in the console
+         *
+         * @param history The history to use
+         */
+        void set_history(const std::shared_ptr<History> &history)
         {
-            stream << "\n";
-            stream << STREAM_EOF << "\n";
-            stream << (_echo ? ECHO_ON : ECHO_OFF) << "\n";
+            _history = history;
+            _editor = std::make_unique<LineEditor>(history);
+            _editor->set_completer(_completer);
         }
 
-        /** @brief Jump to the specified label */
-        void jump(const std::string &label)
+        /**
+         * @brief Set the function completing the command lines typed in the console when Tab is pressed
+         *
+         * @param completer The completer to use
+         */
+        void set_completer(const Completer &completer)
         {
-            if (_list.empty())
+            _completer = completer;
+            if (_editor != nullptr)
             {
-                throw std::runtime_error("Cannot jump to the specified label since the input stream is empty");
+                _editor->set_completer(completer);
             }
+        }
 
-            if (_iterator == _list.end())
+        /** @brief The history of the command lines read from stdin, or `nullptr` if there is none */
+        const std::shared_ptr<History> &get_history() const
+        {
+            return _history;
+        }
+
+        /** @brief Drop all frames, the following instructions are read from stdin */
+        void clear()
+        {
+            while (!_frames.empty())
             {
-                _iterator = _list.begin();
+                _pop_frame();
             }
+        }
 
-            auto _iterator_old = _iterator;
-            while (utils::strip(*_iterator) != label)
+        /** @brief Whether all frames of the stream are exhausted */
+        bool exhaust() const
+        {
+            for (auto &frame : _frames)
             {
-                _shift_iterator();
-                if (_iterator == _list.end())
+                if (!_exhausted(frame))
                 {
-                    _iterator = _list.begin();
+                    return false;
                 }
-                if (_iterator == _iterator_old)
+            }
+
+            return true;
+        }
+
+        /**
+         * @brief Whether every instruction of the stream has been read. Exhausted frames are dropped first, so a loop
+         * with a next iteration is repeated instead of being reported as finished.
+         *
+         * A frame positioned at the `STREAM_EOF` label of a batch script is dropped as well, and the `@ON` and `@OFF`
+         * lines are applied, as `next` would do, instead of reading stdin once the last frame is gone.
+         */
+        bool finished()
+        {
+            while (true)
+            {
+                _pop_exhausted();
+                if (_frames.empty())
+                {
+                    return true;
+                }
+
+                auto &frame = _frames.back();
+                const auto &line = frame.script->instructions[frame.position].source;
+                if (line == STREAM_EOF)
+                {
+                    _pop_frame();
+                }
+                else if (line == ECHO_ON || line == ECHO_OFF)
+                {
+                    _echo = line == ECHO_ON;
+                    frame.position++;
+                }
+                else
+                {
+                    return false;
+                }
+            }
+        }
+
+        /**
+         * @brief Jump to the specified label
+         *
+         * The label is searched in the topmost frame first (from the current position, wrapping around), then in the
+         * outer frames. Each lookup uses the label index of the frame's script, so it does not depend on the script
+         * length. Frames above the one containing the label are dropped, e.g. jumping to a label after a loop
+         * body exits the loop.
+         */
+        void jump(const std::string &label)
+        {
+            if (_frames.empty())
+            {
+                throw std::runtime_error("Cannot jump to the specified label since the input stream is empty");
+            }
+
+            for (auto depth = _frames.size(); depth > 0; depth--)
+            {
+                const auto &frame = _frames[depth - 1];
+                auto index = frame.script->find_label(label, frame.begin, frame.end, frame.position);
+                if (index.has_value())
                 {
-                    throw std::runtime_error(utils::format("Label \"%s\" not found", label.c_str()));
+                    while (_frames.size() > depth)
+                    {
+                        _pop_frame();
+                    }
+
+                    _frames.back().position = *index;
+                    return;
                 }
             }
+
+            throw std::runtime_error(utils::format("Label \"%s\" not found", label.c_str()));
         }
     };
 
@@ -12,28 +12,17 @@ namespace utils
     template <typename... Args>
     std::string strip(const std::string &original, const Args &...remove)
     {
-        std::vector<char> result;
-        std::set<char> to_remove = {remove...};
-        bool ok = false;
-        for (auto c : original)
-        {
-            if (ok)
-            {
-                result.push_back(c);
-            }
-            else if (to_remove.count(c) == 0)
-            {
-                result.push_back(c);
-                ok = true;
-            }
-        }
+        const char characters[] = {remove..., '\0'};
+        const std::string_view to_remove(characters, sizeof...(remove));
 
-        while (!result.empty() && to_remove.count(result.back()) == 1)
+        auto begin = original.find_first_not_of(to_remove);
+        if (begin == std::string::npos)
         {
-            result.pop_back();
+            return std::string();
         }
 
-        return std::string(result.begin(), result.end());
+        auto end = original.find_last_not_of(to_remove);
+        return original.substr(begin, end - begin + 1);
     }
 
     /** @brief Remove spaces, newlines, and carriage returns from the beginning and ending of a string */
@@ -12,8 +12,10 @@ namespace utils
         CONSOLE_SCREEN_BUFFER_INFO current;
         const auto has_old_attr = GetConsoleScreenBufferInfo(console, &current);
 
+        // The output is buffered, it must reach the console while the attributes are applied
+        std::cout << std::flush;
         SetConsoleTextAttribute(console, attributes); // Ignore failure
-        std::cout << message;
+        std::cout << message << std::flush;
 
         if (has_old_attr)
         {
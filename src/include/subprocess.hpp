@@ -2,6 +2,68 @@
 
 namespace liteshell
 {
+    /** @brief Latency statistics of subprocess creations */
+    struct SpawnStatistics
+    {
+        /** @brief The number of subprocess creations, including failed ones */
+        std::size_t count = 0;
+
+        /** @brief The total time spent creating subprocesses */
+        std::chrono::nanoseconds total{0};
+
+        /** @brief The longest time spent creating a subprocess */
+        std::chrono::nanoseconds max{0};
+
+        /** @brief Record the latency of a subprocess creation */
+        void record(const std::chrono::nanoseconds &latency)
+        {
+            count++;
+            total += latency;
+            max = std::max(max, latency);
+        }
+
+        /** @brief The average time spent creating a subprocess */
+        std::chrono::nanoseconds mean() const
+        {
+            return count == 0 ? std::chrono::nanoseconds(0) : total / static_cast<std::chrono::nanoseconds::rep>(count);
+        }
+    };
+
+    /** @brief The caps enforced on the job object of each subprocess, 0 means no cap */
+    struct JobLimits
+    {
+        /** @brief The maximum memory committed by a subprocess and its descendants, in bytes */
+        std::size_t memory = 0;
+
+        /** @brief The maximum CPU usage of a subprocess and its descendants, in percent of all processors */
+        unsigned cpu = 0;
+
+        /** @brief Whether no cap is set */
+        bool empty() const
+        {
+            return memory == 0 && cpu == 0;
+        }
+    };
+
+    /** @brief The resources used by a subprocess, including its descendants when it runs in a job object */
+    struct ResourceUsage
+    {
+        /** @brief The time spent by all threads in user mode and in kernel mode */
+        std::chrono::nanoseconds user_time{0}, kernel_time{0};
+
+        /** @brief The peak committed memory, unknown without a job object */
+        std::optional<std::uint64_t> peak_memory;
+
+        /** @brief The number of bytes read and written by I/O operations */
+        std::uint64_t read_bytes = 0, write_bytes = 0;
+
+        /** @brief The total CPU time */
+        std::chrono::nanoseconds cpu_time() const
+        {
+            return user_time + kernel_time;
+        }
+    };
+
     /**
      * @brief A wrapper of [`PROCESS_INFORMATION`](https://learn.microsoft.com/en-us/windows/win32/api/processthreadsapi/ns-processthreadsapi-process_information)
      * containing information of a subprocess.
@@ -11,31 +73,199 @@ namespace liteshell
     private:
         bool _suspended = false;
 
-        /** @brief The underlying PROCESS_INFORMATION struct. The inner handles should never be closed implicitly. */
-        const PROCESS_INFORMATION _info;
+        /**
+         * @brief The underlying PROCESS_INFORMATION struct.
+         *
+         * The inner handles are closed by `release` once the subprocess has exited, the IDs stay valid.
+         */
+        PROCESS_INFORMATION _info;
+
+        /** @brief The job object containing the subprocess, or `NULL` if it could not be put into one */
+        HANDLE _job;
+
+        /** @brief The wait registered on the process handle, which records its exit */
+        HANDLE _wait = NULL;
+
+        /** @brief The time the subprocess was created at */
+        FILETIME _start_time = {0, 0};
+
+        /** @brief The resources used by the subprocess, sampled when its exit is recorded */
+        ResourceUsage _usage;
+
+        /** @brief The exit code of the subprocess, `STILL_ACTIVE` until its exit is recorded */
+        std::atomic<DWORD> _exit_code{STILL_ACTIVE};
+
+        /** @brief The time the subprocess exited at, only valid once its exit is recorded */
+        FILETIME _end_time = {0, 0};
+
+        std::once_flag _recorded;
+        const std::function<void(ProcessInfoWrapper *)> _on_exit;
 
         ProcessInfoWrapper(const ProcessInfoWrapper &) = delete;
         ProcessInfoWrapper &operator=(const ProcessInfoWrapper &) = delete;
 
+        /** @brief Record the exit of the subprocess, only the first call has an effect */
+        void _record()
+        {
+            std::call_once(
+                _recorded,
+                [this]()
+                {
+                    DWORD exit_code;
+                    GetExitCodeProcess(_info.hProcess, &exit_code);
+                    GetSystemTimeAsFileTime(&_end_time);
+                    _usage = _query();
+                    _exit_code.store(exit_code, std::memory_order_release);
+
+                    if (_on_exit)
+                    {
+                        _on_exit(this);
+                    }
+                });
+        }
+
+        /** @brief Query the resources used so far, from the job object if any or from the process otherwise */
+        ResourceUsage _query() const
+        {
+            ResourceUsage usage;
+            auto nanoseconds = [](const ULONGLONG ticks)
+            {
+                // FILETIME and the job accounting count 100-nanosecond intervals
+                return std::chrono::nanoseconds(static_cast<std::chrono::nanoseconds::rep>(ticks) * 100);
+            };
+
+            if (_job != NULL)
+            {
+                JOBOBJECT_BASIC_AND_IO_ACCOUNTING_INFORMATION accounting;
+                if (QueryInformationJobObject(_job, JobObjectBasicAndIoAccountingInformation, &accounting, sizeof(accounting), NULL))
+                {
+                    usage.user_time = nanoseconds(accounting.BasicInfo.TotalUserTime.QuadPart);
+                    usage.kernel_time = nanoseconds(accounting.BasicInfo.TotalKernelTime.QuadPart);
+                    usage.read_bytes = accounting.IoInfo.ReadTransferCount;
+                    usage.write_bytes = accounting.IoInfo.WriteTransferCount;
+                }
+
+                JOBOBJECT_EXTENDED_LIMIT_INFORMATION limits;
+                if (QueryInformationJobObject(_job, JobObjectExtendedLimitInformation, &limits, sizeof(limits), NULL))
+                {
+                    usage.peak_memory = limits.PeakJobMemoryUsed;
+                }
+            }
+            else if (_info.hProcess != NULL)
+            {
+                FILETIME creation, exit, kernel, user;
+                if (GetProcessTimes(_info.hProcess, &creation, &exit, &kernel, &user))
+                {
+                    auto ticks = [](const FILETIME &time)
+                    {
+                        return static_cast<ULONGLONG>(time.dwHighDateTime) << 32 | time.dwLowDateTime;
+                    };
+
+                    usage.user_time = nanoseconds(ticks(user));
+                    usage.kernel_time = nanoseconds(ticks(kernel));
+                }
+
+                IO_COUNTERS counters;
+                if (GetProcessIoCounters(_info.hProcess, &counters))
+                {
+                    usage.read_bytes = counters.ReadTransferCount;
+                    usage.write_bytes = counters.WriteTransferCount;
+                }
+            }
+
+            return usage;
+        }
+
+        static void CALLBACK _exit_callback(PVOID parameter, BOOLEAN)
+        {
+            static_cast<ProcessInfoWrapper *>(parameter)->_record();
+        }
+
     public:
         /** @brief The subprocess command line */
         const std::string command;
 
-        /** @brief Construct a new `ProcessInfoWrapper` object */
-        ProcessInfoWrapper(const PROCESS_INFORMATION &info, const std::string &command)
-            : _info(info), command(command) {}
+        /**
+         * @brief Construct a new `ProcessInfoWrapper` object, which takes ownership of the handles in `info`
+         *
+         * @param info The information of the subprocess
+         * @param command The command line of the subprocess
+         * @param on_exit A function invoked with this object once the exit of the subprocess is recorded, possibly
+         * from a thread pool thread. It must not call `release`.
+         * @param job The job object containing the subprocess, whose handle is also owned by this object, or `NULL`
+         */
+        ProcessInfoWrapper(
+            const PROCESS_INFORMATION &info,
+            const std::string &command,
+            const std::function<void(ProcessInfoWrapper *)> &on_exit = nullptr,
+            const HANDLE job = NULL)
+            : _info(info), _job(job), _on_exit(on_exit), command(command)
+        {
+            FILETIME exit, kernel, user;
+            if (!GetProcessTimes(_info.hProcess, &_start_time, &exit, &kernel, &user))
+            {
+                GetSystemTimeAsFileTime(&_start_time);
+            }
+
+            if (!RegisterWaitForSingleObject(&_wait, _info.hProcess, _exit_callback, this, INFINITE, WT_EXECUTEONLYONCE))
+            {
+                _wait = NULL; // Exits are only recorded on `wait` then
+            }
+        }
 
         /**
          * @brief Destructor for this object.
          *
          * Since `ProcessInfoWrapper` is non-copyable and non-movable, this destructor calls
          * [`CloseHandle`](https://learn.microsoft.com/en-us/windows/win32/api/handleapi/nf-handleapi-closehandle)
-         * to close the underlying handles of the subprocess.
+         * to close the underlying handles of the subprocess, if `release` was not called yet.
          */
         ~ProcessInfoWrapper()
         {
-            CloseHandle(_info.hProcess);
-            CloseHandle(_info.hThread);
+            if (_wait != NULL)
+            {
+                UnregisterWaitEx(_wait, INVALID_HANDLE_VALUE);
+            }
+
+            if (_info.hProcess != NULL)
+            {
+                CloseHandle(_info.hProcess);
+                CloseHandle(_info.hThread);
+            }
+
+            if (_job != NULL)
+            {
+                CloseHandle(_job);
+            }
+        }
+
+        /**
+         * @brief Release the handles of an exited subprocess.
+         *
+         * The exit code, the end time and the resource usage at exit stay available. This must be called from the
+         * thread owning this object, after the exit was recorded.
+         */
+        void release()
+        {
+            if (_wait != NULL)
+            {
+                UnregisterWaitEx(_wait, INVALID_HANDLE_VALUE); // wait for a running callback
+                _wait = NULL;
+            }
+
+            if (_info.hProcess != NULL)
+            {
+                CloseHandle(_info.hProcess);
+                CloseHandle(_info.hThread);
+                _info.hProcess = _info.hThread = NULL;
+            }
+
+            if (_job != NULL)
+            {
+                // The descendants of the subprocess keep running, they are only no longer accounted for
+                CloseHandle(_job);
+                _job = NULL;
+            }
         }
 
         /** @brief Whether the subprocess is suspended */
@@ -46,7 +276,7 @@ namespace liteshell
 
         void assert_active()
         {
-            if (this->exit_code() != STILL_ACTIVE)
+            if (has_exited())
             {
                 throw std::runtime_error("This process has already terminated");
             }
@@ -94,10 +324,23 @@ namespace liteshell
          * @brief Wait for the subprocess with timeout
          *
          * @param milliseconds The timeout in milliseconds, may equal to `INFINITE`
+         * @return `true` if the subprocess has exited, `false` if the timeout elapsed
          */
-        void wait(DWORD milliseconds)
+        bool wait(DWORD milliseconds)
         {
-            WaitForSingleObject(_info.hProcess, milliseconds);
+            if (has_exited())
+            {
+                return true;
+            }
+
+            if (WaitForSingleObject(_info.hProcess, milliseconds) == WAIT_OBJECT_0)
+            {
+                // Do not wait for the registered callback to record the exit
+                _record();
+                return true;
+            }
+
+            return false;
         }
 
         /**
@@ -117,13 +360,63 @@ namespace liteshell
         /**
          * @brief Get the exit code of the subprocess
          *
-         * @return The exit code of the subprocess
+         * This reads the state recorded when the subprocess exited and does not perform any system call.
+         *
+         * @return The exit code of the subprocess, or `STILL_ACTIVE` if it is still running
          */
         DWORD exit_code() const
         {
-            DWORD exit_code;
-            GetExitCodeProcess(_info.hProcess, &exit_code);
-            return exit_code;
+            return _exit_code.load(std::memory_order_acquire);
+        }
+
+        /** @brief Whether the exit of the subprocess was recorded */
+        bool has_exited() const
+        {
+            return exit_code() != STILL_ACTIVE;
+        }
+
+        /**
+         * @brief Get the time the subprocess exited at
+         *
+         * @return The UTC time the exit was recorded at, or `std::nullopt` if the subprocess is still running
+         */
+        std::optional<FILETIME> end_time() const
+        {
+            if (!has_exited())
+            {
+                return std::nullopt;
+            }
+
+            return _end_time;
+        }
+
+        /** @brief Get the UTC time the subprocess was created at */
+        FILETIME start_time() const
+        {
+            return _start_time;
+        }
+
+        /**
+         * @brief Get the resources used by the subprocess
+         *
+         * This queries the job object (or the process) while the subprocess is running, and returns the sample taken
+         * at its exit afterwards.
+         *
+         * @return The resources used so far
+         */
+        ResourceUsage usage() const
+        {
+            return has_exited() ? _usage : _query();
+        }
+
+        /**
+         * @brief Get the handle of the subprocess, e.g. to wait on several subprocesses at once
+         *
+         * @return The process handle, or `NULL` once it was released
+         */
+        HANDLE handle() const
+        {
+            return _info.hProcess;
         }
 
         /**
@@ -4,12 +4,33 @@
 
 namespace utils
 {
-    /** @brief Helper class to display ASCII table on the console */
+    /**
+     * @brief Helper class to display ASCII table on the console
+     *
+     * By default, all rows are kept until `display` computes the column widths from them. For large tables, `stream`
+     * computes the widths from the first rows only and writes every row to the output as soon as it is added, values
+     * wider than their column are wrapped.
+     */
     class Table
     {
     private:
+        /** @brief The rows not written yet, starting with the headers if they were not written either */
         std::vector<std::vector<std::string>> rows;
 
+        /** @brief The output of a streaming table, or `nullptr` */
+        std::ostream *_output = nullptr;
+
+        /** @brief The number of rows the widths of a streaming table are computed from */
+        std::size_t _sample = 0;
+
+        /** @brief Whether the headers were written */
+        bool _started = false;
+
+        std::vector<std::size_t> _widths;
+
+        /** @brief A buffer reused to render each row */
+        std::string _buffer;
+
         Table(const std::initializer_list<std::string> &headers) : columns(headers.size())
         {
             rows.push_back(headers);
@@ -20,10 +41,108 @@ namespace utils
         {
             if (row.size() != columns)
             {
-                throw std::invalid_argument(format("Attempted to add a row of %d item(s) to a table with %d column(s)", row.size(), columns));
+                throw std::invalid_argument(format("Attempted to add a row of %zu item(s) to a table with %zu column(s)", row.size(), columns));
             }
 
             rows.push_back(row);
+            if (_output != nullptr && (_started || rows.size() > _sample))
+            {
+                _write_pending();
+            }
+        }
+
+        void _compute_widths()
+        {
+            _widths.assign(columns, 0);
+            for (auto &row : rows)
+            {
+                for (std::size_t column = 0; column < columns; column++)
+                {
+                    _widths[column] = std::max(_widths[column], 2u + std::min(limits[column], row[column].size()));
+                }
+            }
+        }
+
+        /** @brief Append the lines of a row to `result`, wrapping the values wider than their column */
+        void _render(const std::vector<std::string> &row, std::string &result) const
+        {
+            for (std::size_t line = 0;; line++)
+            {
+                auto start = result.size();
+                bool has_content = false;
+                for (std::size_t column = 0; column < columns; column++)
+                {
+                    const auto &value = row[column];
+                    auto chunk = std::max<std::size_t>(1, std::min(limits[column], _widths[column] - 2));
+                    auto offset = line * chunk;
+
+                    std::string_view part;
+                    if (offset < value.size() || line == 0)
+                    {
+                        part = std::string_view(value).substr(std::min(offset, value.size()), chunk);
+                        has_content = true;
+                    }
+
+                    if (align_left)
+                    {
+                        result += ' ';
+                        result += part;
+                    }
+
+                    result.append(_widths[column] - part.size() - 1, ' ');
+
+                    if (!align_left)
+                    {
+                        result += part;
+                        result += ' ';
+                    }
+
+                    result += '|';
+                }
+
+                if (!has_content)
+                {
+                    result.resize(start);
+                    break;
+                }
+
+                result += '\n';
+            }
+        }
+
+        void _render_separator(std::string &result) const
+        {
+            for (std::size_t column = 0; column < columns; column++)
+            {
+                result.append(_widths[column], '-');
+                result += '+';
+            }
+
+            result += '\n';
+        }
+
+        /** @brief Write the pending rows of a streaming table */
+        void _write_pending()
+        {
+            if (!_started)
+            {
+                _compute_widths();
+            }
+
+            for (auto &row : rows)
+            {
+                _buffer.clear();
+                _render(row, _buffer);
+                if (!_started)
+                {
+                    _render_separator(_buffer);
+                    _started = true;
+                }
+
+                _output->write(_buffer.data(), _buffer.size());
+            }
+
+            rows.clear();
         }
 
     public:
@@ -60,106 +179,46 @@ namespace utils
             add_row({values...});
         }
 
-        /** @brief An ASCII string displaying the table */
-        std::string display()
+        /**
+         * @brief Write the rows to an output as they are added, instead of keeping them for `display`
+         *
+         * The column widths are computed from the headers and the first `sample` rows (within `limits`), which are
+         * written together once the next row is added or `finish` is called. Later rows are written immediately.
+         *
+         * @param output The output to write the table to
+         * @param sample The number of rows to compute the column widths from
+         */
+        void stream(std::ostream &output, const std::size_t sample = 100)
         {
-#ifdef DEBUG
-            std::cout << "Constructing table" << std::endl;
-#endif
-            std::vector<std::size_t> column_widths(columns);
-            for (auto &row : rows)
+            _output = &output;
+            _sample = sample;
+        }
+
+        /** @brief Write the rows of a streaming table which were not written yet */
+        void finish()
+        {
+            if (_output != nullptr && (!_started || !rows.empty()))
             {
-                for (std::size_t column = 0; column < columns; column++)
-                {
-                    column_widths[column] = std::max(column_widths[column], 2u + std::min(limits[column], row[column].size()));
-                }
+                _write_pending();
             }
+        }
 
-            std::vector<std::string> lines;
+        /** @brief An ASCII string displaying the table */
+        std::string display()
+        {
+            _compute_widths();
+
+            std::string result;
             for (std::size_t row = 0; row < rows.size(); row++)
             {
-                for (std::size_t lines_in_row = 0;; lines_in_row++)
-                {
-                    std::stringstream line;
-                    bool has_content = false;
-                    for (std::size_t column = 0; column < columns; column++)
-                    {
-                        std::string substring;
-                        try
-                        {
-                            substring = rows[row][column].substr(lines_in_row * limits[column], limits[column]);
-#ifdef DEBUG
-                            std::cout << "Got substring \"" << substring << "\"" << std::endl;
-#endif
-
-                            has_content = true;
-                        }
-                        catch (std::out_of_range &)
-                        {
-                            // pass
-                        }
-
-                        if (align_left)
-                        {
-                            line << ' ';
-                            line << substring;
-                        }
-
-                        for (std::size_t i = 0; i < column_widths[column] - substring.size() - 1; i++)
-                        {
-                            line << ' ';
-                        }
-
-                        if (!align_left)
-                        {
-                            line << substring;
-                            line << ' ';
-                        }
-
-                        line << '|';
-                    }
-
-                    if (has_content)
-                    {
-#ifdef DEBUG
-                        std::cout << "Got line \"" << line.str() << "\"" << std::endl;
-#endif
-
-                        lines.push_back(line.str());
-                    }
-                    else
-                    {
-                        break;
-                    }
-                }
-
+                _render(rows[row], result);
                 if (row == 0)
                 {
-                    std::string line;
-                    for (std::size_t column = 0; column < columns; column++)
-                    {
-                        for (std::size_t i = 0; i < column_widths[column]; i++)
-                        {
-                            line += '-';
-                        }
-                        line += '+';
-                    }
-                    lines.push_back(line);
+                    _render_separator(result);
                 }
             }
 
-            std::string result;
-            for (auto &line : lines)
-            {
-                result += line;
-                result += '\n';
-            }
-
-#ifdef DEBUG
-            std::cout << "Constructed table" << std::endl;
-#endif
-
             return result;
         }
     };
-}
\ No newline at end of file
+}
@@ -0,0 +1,252 @@
+#pragma once
+
+#include "environment.hpp"
+#include "stream.hpp"
+
+namespace liteshell
+{
+    /**
+     * @brief The execution context of a task running concurrently with the shell, e.g. a built-in command in a
+     * pipeline.
+     *
+     * A task has its own environment, layered on a snapshot of the environment of the shell, and its own input
+     * stream. While a `TaskContext` is alive, `Client::get_environment` and `Client::get_stream` return them on the
+     * thread which created it, so that built-in commands run the same way inside and outside a task. The standard
+     * streams of a task are redirected separately, see `utils::StandardStreams`.
+     */
+    class TaskContext
+    {
+    private:
+        Environment _environment;
+        InputStream _stream;
+        TaskContext *const _previous;
+
+        TaskContext(const TaskContext &) = delete;
+        TaskContext &operator=(const TaskContext &) = delete;
+
+        static TaskContext *&_current()
+        {
+            static thread_local TaskContext *current = nullptr;
+            return current;
+        }
+
+    public:
+        /**
+         * @brief Enter a new task on the calling thread, until this object is destroyed
+         *
+         * @param snapshot The variables visible to the task, its own assignments are discarded with it
+         */
+        explicit TaskContext(const Environment::Snapshot &snapshot) : _environment(snapshot), _previous(_current())
+        {
+            _current() = this;
+        }
+
+        /** @brief Destructor for this object, which leaves the task */
+        ~TaskContext()
+        {
+            _current() = _previous;
+        }
+
+        /** @brief The task of the calling thread, or `nullptr` if it runs on behalf of the shell itself */
+        static TaskContext *current()
+        {
+            return _current();
+        }
+
+        /** @brief The environment of this task */
+        Environment *get_environment()
+        {
+            return &_environment;
+        }
+
+        /** @brief The input stream of this task */
+        InputStream *get_stream()
+        {
+            return &_stream;
+        }
+    };
+
+    /**
+     * @brief A built-in command or a batch script started in the background with `%`, e.g. `build.ff %`.
+     *
+     * The task runs on a thread of `utils::ThreadPool` inside its own `TaskContext`, and is named `%<id>` in `ps`,
+     * `kill`, `suspend`, `resume` and `wait`. Threads cannot be stopped safely at any point, so suspending and
+     * killing are cooperative: they take effect before the next instruction of the task, once its running
+     * command returns.
+     */
+    class BackgroundTask
+    {
+    private:
+        mutable std::mutex _mutex;
+        std::condition_variable _resumed;
+        bool _suspended = false;
+        std::optional<DWORD> _killed;
+
+        /** @brief A manual-reset event signaled once the task has finished */
+        const HANDLE _finished;
+
+        /** @brief The exit code of the task, `STILL_ACTIVE` until it has finished */
+        std::atomic<DWORD> _exit_code{STILL_ACTIVE};
+
+        FILETIME _start_time = {0, 0}, _end_time = {0, 0};
+
+        BackgroundTask(const BackgroundTask &) = delete;
+        BackgroundTask &operator=(const BackgroundTask &) = delete;
+
+    public:
+        /** @brief The prefix of the names of background tasks */
+        static const char PREFIX = '%';
+
+        /** @brief The number of this task, starting from 1 */
+        const std::size_t id;
+
+        /** @brief The command line of this task, without the background suffix */
+        const std::string command;
+
+        /**
+         * @brief Construct a new `BackgroundTask` object, which is not running yet
+         *
+         * @param id The number of this task
+         * @param command The command line of this task
+         */
+        BackgroundTask(const std::size_t id, const std::string &command)
+            : _finished(CreateEventW(NULL, TRUE, FALSE, NULL)), id(id), command(command)
+        {
+            if (_finished == NULL)
+            {
+                throw std::runtime_error(utils::last_error("Unable to create an event"));
+            }
+
+            GetSystemTimeAsFileTime(&_start_time);
+        }
+
+        /** @brief Destructor for this object */
+        ~BackgroundTask()
+        {
+            CloseHandle(_finished);
+        }
+
+        /** @brief Whether a token names a background task, e.g. `%1` */
+        static bool is_name(const std::string &token)
+        {
+            return token.size() > 1 && token[0] == PREFIX && std::all_of(token.begin() + 1, token.end(), ::isdigit);
+        }
+
+        /** @brief The name of this task, e.g. `%1` */
+        std::string name() const
+        {
+            return PREFIX + std::to_string(id);
+        }
+
+        /**
+         * @brief Called by the task before each instruction, block while it is suspended
+         *
+         * @return Whether the task may continue, `false` once it was killed
+         */
+        bool checkpoint()
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _resumed.wait(
+                lock,
+                [this]()
+                {
+                    return !_suspended || _killed.has_value();
+                });
+
+            return !_killed.has_value();
+        }
+
+        /** @brief Record the end of the task, whose exit code is overridden by `kill` */
+        void finish(const DWORD exit_code)
+        {
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                GetSystemTimeAsFileTime(&_end_time);
+                _exit_code.store(_killed.value_or(exit_code), std::memory_order_release);
+            }
+
+            SetEvent(_finished);
+        }
+
+        /** @brief Stop the task before its next instruction */
+        void kill(const DWORD exit_code)
+        {
+            assert_active();
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                _killed = exit_code;
+            }
+
+            _resumed.notify_all();
+        }
+
+        /** @brief Pause the task before its next instruction */
+        void suspend()
+        {
+            assert_active();
+            std::lock_guard<std::mutex> lock(_mutex);
+            _suspended = true;
+        }
+
+        /** @brief Let a suspended task continue */
+        void resume()
+        {
+            assert_active();
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                _suspended = false;
+            }
+
+            _resumed.notify_all();
+        }
+
+        void assert_active() const
+        {
+            if (has_exited())
+            {
+                throw std::runtime_error("This task has already finished");
+            }
+        }
+
+        bool is_suspended() const
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            return _suspended && !has_exited();
+        }
+
+        /** @brief A handle signaled once the task has finished, owned by this object */
+        HANDLE handle() const
+        {
+            return _finished;
+        }
+
+        /** @brief The exit code of the task, or `STILL_ACTIVE` if it is still running */
+        DWORD exit_code() const
+        {
+            return _exit_code.load(std::memory_order_acquire);
+        }
+
+        bool has_exited() const
+        {
+            return exit_code() != STILL_ACTIVE;
+        }
+
+        /** @brief Get the UTC time the task was started at */
+        FILETIME start_time() const
+        {
+            return _start_time;
+        }
+
+        /** @brief Get the UTC time the task finished at, or `std::nullopt` if it is still running */
+        std::optional<FILETIME> end_time() const
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            if (!has_exited())
+            {
+                return std::nullopt;
+            }
+
+            return _end_time;
+        }
+    };
+}
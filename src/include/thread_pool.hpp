@@ -0,0 +1,129 @@
+#pragma once
+
+#include "standard.hpp"
+
+namespace utils
+{
+    /**
+     * @brief A pool of worker threads running submitted jobs.
+     *
+     * A job never waits for a worker: if no idle worker can take it, a new worker is started. Jobs may therefore
+     * wait for each other (e.g. the stages of a pipeline) without deadlocking the pool, while the threads are still
+     * reused from one job to the next. A worker which stays idle for `IDLE_TIMEOUT` exits.
+     */
+    class ThreadPool
+    {
+    public:
+        /** @brief The time after which an idle worker exits */
+        static constexpr std::chrono::seconds IDLE_TIMEOUT = std::chrono::seconds(30);
+
+    private:
+        /** @brief The state shared with the workers, which are detached so that exiting never waits for a job */
+        struct _State
+        {
+            std::mutex mutex;
+            std::condition_variable available;
+            std::deque<std::function<void()>> queue;
+            std::size_t idle = 0, workers = 0;
+            bool stopped = false;
+        };
+
+        const std::shared_ptr<_State> _state;
+
+        ThreadPool(const ThreadPool &) = delete;
+        ThreadPool &operator=(const ThreadPool &) = delete;
+
+        static void _work(const std::shared_ptr<_State> state)
+        {
+            std::unique_lock<std::mutex> lock(state->mutex);
+            while (true)
+            {
+                state->idle++;
+                auto woken = state->available.wait_for(
+                    lock,
+                    IDLE_TIMEOUT,
+                    [&state]()
+                    {
+                        return state->stopped || !state->queue.empty();
+                    });
+                state->idle--;
+
+                if (state->stopped || !woken)
+                {
+                    state->workers--;
+                    return;
+                }
+
+                auto job = std::move(state->queue.front());
+                state->queue.pop_front();
+
+                lock.unlock();
+                job();
+                lock.lock();
+            }
+        }
+
+    public:
+        /** @brief Construct a new `ThreadPool` object, workers are started on demand */
+        ThreadPool() : _state(std::make_shared<_State>()) {}
+
+        /** @brief Destructor for this object, the idle workers exit while the busy ones finish their job first */
+        ~ThreadPool()
+        {
+            {
+                std::lock_guard<std::mutex> lock(_state->mutex);
+                _state->stopped = true;
+            }
+
+            _state->available.notify_all();
+        }
+
+        /**
+         * @brief The pool shared by the whole process.
+         *
+         * It is never destroyed, so that jobs still running at exit do not use a destroyed pool.
+         */
+        static ThreadPool &shared()
+        {
+            static auto pool = new ThreadPool();
+            return *pool;
+        }
+
+        /**
+         * @brief Run a job on a worker thread
+         *
+         * @param job The job to run
+         * @return A future which becomes ready when the job completes, holding the exception thrown by the job if any
+         */
+        std::future<void> submit(const std::function<void()> &job)
+        {
+            auto task = std::make_shared<std::packaged_task<void()>>(job);
+            auto future = task->get_future();
+            {
+                std::lock_guard<std::mutex> lock(_state->mutex);
+                _state->queue.emplace_back(
+                    [task]()
+                    {
+                        (*task)();
+                    });
+
+                // Each queued job must have its own idle worker, otherwise it could wait for a running job
+                if (_state->idle < _state->queue.size())
+                {
+                    _state->workers++;
+                    std::thread(_work, _state).detach();
+                }
+            }
+
+            _state->available.notify_one();
+            return future;
+        }
+
+        /** @brief The number of worker threads, busy or idle */
+        std::size_t size() const
+        {
+            std::lock_guard<std::mutex> lock(_state->mutex);
+            return _state->workers;
+        }
+    };
+}
@@ -75,13 +75,13 @@ namespace utils
             throw std::runtime_error(last_error("wininet.h InternetCrackUrlW ERROR"));
         }
 
-        const auto scheme = utf_convert(std::wstring(components.lpszScheme, components.dwSchemeLength));
-        const auto hostname = utils::utf_convert(std::wstring(components.lpszHostName, components.dwHostNameLength));
-        const auto username = utils::utf_convert(std::wstring(components.lpszUserName, components.dwUserNameLength));
-        const auto password = utils::utf_convert(std::wstring(components.lpszPassword, components.dwPasswordLength));
+        const auto scheme = utf_convert(std::wstring_view(components.lpszScheme, components.dwSchemeLength));
+        const auto hostname = utils::utf_convert(std::wstring_view(components.lpszHostName, components.dwHostNameLength));
+        const auto username = utils::utf_convert(std::wstring_view(components.lpszUserName, components.dwUserNameLength));
+        const auto password = utils::utf_convert(std::wstring_view(components.lpszPassword, components.dwPasswordLength));
         const auto port = components.nPort;
-        const auto path = utils::utf_convert(std::wstring(components.lpszUrlPath, components.dwUrlPathLength));
-        const auto extra_info = utils::utf_convert(std::wstring(components.lpszExtraInfo, components.dwExtraInfoLength));
+        const auto path = utils::utf_convert(std::wstring_view(components.lpszUrlPath, components.dwUrlPathLength));
+        const auto extra_info = utils::utf_convert(std::wstring_view(components.lpszExtraInfo, components.dwExtraInfoLength));
 
         return URL(scheme, hostname, username, password, port, path, extra_info);
     }
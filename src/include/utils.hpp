@@ -1,6 +1,7 @@
 #pragma once
 
 #include "converter.hpp"
+#include "find_files.hpp"
 #include "join.hpp"
 
 namespace utils
@@ -33,7 +34,7 @@ namespace utils
             throw std::runtime_error(last_error("GetFullPathNameW ERROR"));
         }
 
-        return utf_convert(std::wstring(buffer, buffer + size));
+        return utf_convert(std::wstring_view(buffer, size));
     }
 
     /**
@@ -56,6 +57,32 @@ namespace utils
         return std::make_pair(columns, rows);
     }
 
+    /**
+     * @brief Get a variable of the environment of the process using
+     * [`GetEnvironmentVariableW`](https://learn.microsoft.com/en-us/windows/win32/api/processenv/nf-processenv-getenvironmentvariablew)
+     *
+     * @param name The name of the variable
+     * @return The value of the variable, or `std::nullopt` if it is not set
+     */
+    std::optional<std::string> get_environment_variable(const std::string &name)
+    {
+        auto wide_name = utf_convert(name);
+        std::wstring buffer(GetEnvironmentVariableW(wide_name.c_str(), NULL, 0), L'\0');
+        if (buffer.empty())
+        {
+            return std::nullopt;
+        }
+
+        auto length = GetEnvironmentVariableW(wide_name.c_str(), buffer.data(), static_cast<DWORD>(buffer.size()));
+        if (length >= buffer.size())
+        {
+            return std::nullopt;
+        }
+
+        buffer.resize(length);
+        return utf_convert(buffer);
+    }
+
     /** @brief Get the current working directory */
     std::string get_working_directory()
     {
@@ -66,7 +93,7 @@ namespace utils
             throw std::runtime_error(last_error("GetCurrentDirectoryW ERROR"));
         }
 
-        return utf_convert(std::wstring(buffer, buffer + size));
+        return utf_convert(std::wstring_view(buffer, size));
     }
 
     /**
@@ -82,115 +109,71 @@ namespace utils
             throw std::runtime_error(last_error("Error calling GetModuleFileNameW"));
         }
 
-        return utf_convert(std::wstring(buffer, buffer + size));
+        return utf_convert(std::wstring_view(buffer, size));
     }
 
-    /** @brief The CTRL handler used by the command shell */
-    BOOL WINAPI ctrl_handler(DWORD ctrl_type)
+    /** @brief Whether a character separates the components of a path, i.e. `\` or `/` */
+    bool is_path_separator(const char c)
     {
-        return ctrl_type == CTRL_C_EVENT;
-    }
-
-    /** @brief Set whether to ignore Ctrl C signal */
-    void set_ignore_ctrl_c(bool ignore)
-    {
-        if (!SetConsoleCtrlHandler(ctrl_handler, ignore))
-        {
-            std::cerr << last_error("Warning: SetConsoleCtrlHandler ERROR") << std::endl;
-        }
+        return c == '\\' || c == '/';
     }
 
     /**
-     * @brief List all files matching a specific pattern (typically used to list a directory)
-     * @see https://stackoverflow.com/a/24193730
+     * @brief Get the directory containing a path, i.e. the path up to its last separator
+     *
+     * The root directory keeps its separator e.g. `C:\` or `/`. A path without any separator gives an empty string.
      */
-    std::vector<WIN32_FIND_DATAW> list_files(const std::string &__pattern)
+    std::string parent_directory(const std::string &path)
     {
-        std::vector<WIN32_FIND_DATAW> results(1);
-
-        HANDLE file = FindFirstFileW(utf_convert(__pattern).c_str(), &results[0]);
-        if (file == INVALID_HANDLE_VALUE)
+        auto separator = path.find_last_of("\\/");
+        if (separator == std::string::npos)
         {
-            return {};
+            return "";
         }
 
-        do
+        if (separator == 0 || path[separator - 1] == ':')
         {
-            results.emplace_back();
-        } while (FindNextFileW(file, &results.back()));
+            return path.substr(0, separator + 1);
+        }
 
-        results.pop_back();
+        return path.substr(0, separator);
+    }
 
-        if (!FindClose(file))
-        {
-            throw std::runtime_error(last_error("Error when closing file search handle"));
-        }
+    /** @brief Get the directory containing the executable of the current process, see `get_executable_path` */
+    std::string get_executable_directory()
+    {
+        return parent_directory(get_executable_path());
+    }
 
-        CloseHandle(file);
+    /** @brief The CTRL handler used by the command shell */
+    BOOL WINAPI ctrl_handler(DWORD ctrl_type)
+    {
+        return ctrl_type == CTRL_C_EVENT;
+    }
 
-#ifdef DEBUG
-        std::vector<std::string> names;
-        for (const auto &data : results)
+    /** @brief Set whether to ignore Ctrl C signal */
+    void set_ignore_ctrl_c(bool ignore)
+    {
+        if (!SetConsoleCtrlHandler(ctrl_handler, ignore))
         {
-            names.push_back(utf_convert(std::wstring(data.cFileName)));
+            std::cerr << last_error("Warning: SetConsoleCtrlHandler ERROR") << std::endl;
         }
-
-        std::cout << "Items matching \"" << __pattern << "\":" << names << std::endl;
-#endif
-
-        return results;
     }
 
     /**
-     * @brief Remove a directory recursively. It is the caller's responsibility to ensure that the directory exists.
+     * @brief List all files matching a specific pattern (typically used to list a directory)
      *
-     * @param directory The directory to remove
-     * @param verbose Whether to display the deletion progress
-     * @return Whether the directory was removed successfully
+     * Prefer iterating over a `FindFiles` range, which does not keep all entries in memory.
      */
-    bool remove_directory(const std::string &directory, bool verbose)
+    std::vector<WIN32_FIND_DATAW> list_files(const std::string &__pattern)
     {
-        bool success = true;
-        for (const auto &file : list_files(join(directory, "*")))
-        {
-            auto filename = utf_convert(file.cFileName);
-
-            // Skip current and parent directory
-            if (filename == "." || filename == "..")
-            {
-                continue;
-            }
-
-            auto path = join(directory, filename);
-            if (file.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
-            {
-                if (!remove_directory(path, verbose))
-                {
-                    success = false;
-                }
-            }
-            else if (DeleteFileW(utf_convert(path).c_str()))
-            {
-                std::cout << "Deleted " << path << std::endl;
-            }
-            else
-            {
-                std::cerr << last_error(format("Error deleting file \"%s\"", path.c_str())) << std::endl;
-                success = false;
-            }
-        }
-
-        if (RemoveDirectoryW(utf_convert(directory).c_str()))
-        {
-            std::cout << "Deleted " << directory << std::endl;
-        }
-        else
+        std::vector<WIN32_FIND_DATAW> results;
+        for (const auto &data : FindFiles(__pattern))
         {
-            std::cerr << last_error(format("Error deleting directory \"%s\"", directory.c_str())) << std::endl;
-            success = false;
+            results.push_back(data);
         }
 
-        return success;
+        return results;
     }
 
     /**
@@ -295,7 +278,11 @@ namespace utils
         return c == '+' || c == '-' || c == '*' || c == '/' || c == ' ' || c == '%' || ('0' <= c && c <= '9') || c == '(' || c == ')';
     }
 
-    const boost::regex _command_name = boost::regex(R"(^\w+$)");
+    /** @brief Whether a character is an ASCII letter, digit or underscore */
+    bool is_word_character(const char c)
+    {
+        return ('a' <= c && c <= 'z') || ('A' <= c && c <= 'Z') || ('0' <= c && c <= '9') || c == '_';
+    }
 
     /**
      * @brief Whether a string is a valid command name
@@ -305,11 +292,9 @@ namespace utils
      */
     bool is_valid_command(const std::string &name)
     {
-        return boost::regex_match(name, _command_name);
+        return !name.empty() && std::all_of(name.begin(), name.end(), is_word_character);
     }
 
-    const boost::regex _variable_name = boost::regex(R"(^\w+$)");
-
     /**
      * @brief Whether a string is a valid variable name
      *
@@ -318,33 +303,35 @@ namespace utils
      */
     bool is_valid_variable(const std::string &name)
     {
-        return boost::regex_match(name, _variable_name);
+        return !name.empty() && std::all_of(name.begin(), name.end(), is_word_character);
     }
 
-    const boost::regex _short_option_name = boost::regex(R"(^-[a-zA-Z]$)");
-
     /**
      * @brief Whether a string is a valid short option name
      *
      * @param name The name to check
      * @return Whether the name is a valid short option name
      */
-    bool is_valid_short_option(const std::string &name)
+    bool is_valid_short_option(const std::string_view &name)
     {
-        return boost::regex_match(name, _short_option_name);
+        return name.size() == 2 && name[0] == '-' && std::isalpha(static_cast<unsigned char>(name[1]));
     }
 
-    const boost::regex _long_option_name = boost::regex(R"(^--[a-zA-Z\-_]+$)");
-
     /**
      * @brief Whether a string is a valid long option name
      *
      * @param name The name to check
      * @return Whether the name is a valid long option name
      */
-    bool is_valid_long_option(const std::string &name)
+    bool is_valid_long_option(const std::string_view &name)
     {
-        return boost::regex_match(name, _long_option_name);
+        return name.size() > 2 && name[0] == '-' && name[1] == '-' &&
+               std::all_of(
+                   name.begin() + 2, name.end(),
+                   [](const char c)
+                   {
+                       return std::isalpha(static_cast<unsigned char>(c)) || c == '-' || c == '_';
+                   });
     }
 
     /**
@@ -429,19 +416,23 @@ namespace utils
         return result;
     }
 
-    const boost::regex _hex_pattern("#[0-9a-fA-F]{6}");
-
     /** @brief Check if a string is a valid hex representation */
     bool isValidHexColor(const std::string &hexColor)
     {
-        return boost::regex_match(hexColor, _hex_pattern);
+        return hexColor.size() == 7 && hexColor[0] == '#' &&
+               std::all_of(
+                   hexColor.begin() + 1, hexColor.end(),
+                   [](const char c)
+                   {
+                       return std::isxdigit(static_cast<unsigned char>(c));
+                   });
     }
     
     void hexToRgb(const std::string &hex, int &r, int &g, int &b)
     {
         if (!isValidHexColor(hex))
         {
-            throw std::invalid_argument("Error: Invalid hex color format " + hexColor);
+            throw std::invalid_argument("Error: Invalid hex color format " + hex);
         }
 
         std::stringstream ss;
@@ -459,6 +450,8 @@ namespace utils
         int r, g, b;
         hexToRgb(hexColor, r, g, b);
 
+        std::cout << std::flush;
+
         HANDLE hConsole = GetStdHandle(STD_OUTPUT_HANDLE);
         CONSOLE_SCREEN_BUFFER_INFOEX info;
         info.cbSize = sizeof(CONSOLE_SCREEN_BUFFER_INFOEX);
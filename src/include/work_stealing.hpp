@@ -0,0 +1,139 @@
+#pragma once
+
+#include "standard.hpp"
+
+namespace utils
+{
+    /**
+     * @brief A pool of threads in which each worker owns a deque of tasks.
+     *
+     * Workers take their own most recent task first, so each one walks its part of a tree depth-first, and steal the
+     * oldest task of another worker (usually a large subtree close to the root) when their deque is empty. This suits
+     * directory traversals, where each task enumerates a directory and pushes its subdirectories.
+     *
+     * @tparam T The type of the tasks
+     */
+    template <typename T>
+    class WorkStealingPool
+    {
+    private:
+        struct _Queue
+        {
+            std::mutex mutex;
+            std::deque<T> tasks;
+        };
+
+        const std::function<void(std::size_t, T &)> _run;
+        std::vector<_Queue> _queues;
+
+        /** @brief The number of tasks that were pushed but not completed yet */
+        std::atomic<std::size_t> _pending{0};
+
+        std::mutex _idle_mutex;
+        std::condition_variable _idle;
+
+        WorkStealingPool(const WorkStealingPool &) = delete;
+        WorkStealingPool &operator=(const WorkStealingPool &) = delete;
+
+        bool _pop(const std::size_t worker, T &task)
+        {
+            for (std::size_t i = 0; i < _queues.size(); i++)
+            {
+                auto &queue = _queues[(worker + i) % _queues.size()];
+                std::lock_guard<std::mutex> lock(queue.mutex);
+                if (!queue.tasks.empty())
+                {
+                    if (i == 0)
+                    {
+                        task = std::move(queue.tasks.back());
+                        queue.tasks.pop_back();
+                    }
+                    else
+                    {
+                        task = std::move(queue.tasks.front());
+                        queue.tasks.pop_front();
+                    }
+
+                    return true;
+                }
+            }
+
+            return false;
+        }
+
+        void _work(const std::size_t worker)
+        {
+            T task;
+            while (true)
+            {
+                if (_pop(worker, task))
+                {
+                    _run(worker, task);
+                    if (--_pending == 0)
+                    {
+                        _idle.notify_all();
+                    }
+
+                    continue;
+                }
+
+                std::unique_lock<std::mutex> lock(_idle_mutex);
+                if (_pending == 0)
+                {
+                    return;
+                }
+
+                // A push may be missed between `_pop` and this wait, hence the timeout
+                _idle.wait_for(lock, std::chrono::milliseconds(1));
+            }
+        }
+
+    public:
+        /**
+         * @brief Construct a new `WorkStealingPool` object
+         *
+         * @param workers The number of worker threads
+         * @param run The function executing a task, invoked with the index of the calling worker
+         */
+        WorkStealingPool(const std::size_t workers, const std::function<void(std::size_t, T &)> &run)
+            : _run(run), _queues(std::max<std::size_t>(workers, 1)) {}
+
+        /** @brief The number of worker threads */
+        std::size_t size() const
+        {
+            return _queues.size();
+        }
+
+        /**
+         * @brief Add a task to the deque of a worker
+         *
+         * @param worker The index of the worker, usually the one calling this method from `run`
+         * @param task The task to add
+         */
+        void push(const std::size_t worker, T &&task)
+        {
+            _pending++;
+            {
+                std::lock_guard<std::mutex> lock(_queues[worker].mutex);
+                _queues[worker].tasks.push_back(std::move(task));
+            }
+
+            _idle.notify_one();
+        }
+
+        /** @brief Start the workers and return once all tasks, including the ones they push, are completed */
+        void run()
+        {
+            std::vector<std::thread> threads;
+            for (std::size_t i = 0; i < _queues.size(); i++)
+            {
+                threads.emplace_back(&WorkStealingPool::_work, this, i);
+            }
+
+            for (auto &thread : threads)
+            {
+                thread.join();
+            }
+        }
+    };
+}
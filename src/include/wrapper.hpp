@@ -6,26 +6,67 @@ namespace liteshell
      * @brief Wrapper for a command inheriting from `BaseCommand`.
      * @see https://stackoverflow.com/a/66010713
      *
+     * The command object may be constructed lazily, the first time `command` is called. Copies of a wrapper share
+     * the same command object.
+     *
      * @tparam T The command class, must be a subclass of BaseCommand
      */
     template <typename T>
     class CommandWrapper
     {
     private:
+        struct _State
+        {
+            std::function<std::shared_ptr<T>()> factory;
+            std::shared_ptr<T> command;
+            std::once_flag constructed;
+        };
+
+        std::shared_ptr<_State> _state;
+
     public:
-        /** @brief A pointer to the underlying command object */
-        const std::shared_ptr<T> command;
+        /** @brief The name of the underlying command */
+        const std::string name;
 
-        /** @brief Construct a new `CommandWrapper` object */
-        CommandWrapper(const std::shared_ptr<T> &command) : command(command)
+        /** @brief Construct a new `CommandWrapper` object from a command object */
+        CommandWrapper(const std::shared_ptr<T> &command) : _state(std::make_shared<_State>()), name(command->name)
         {
             static_assert(std::is_base_of_v<BaseCommand, T>, "CommandWrapper can only be used for BaseCommand subclasses");
+            _state->command = command;
+            std::call_once(_state->constructed, []() {});
+        }
+
+        /**
+         * @brief Construct a new `CommandWrapper` object whose command is constructed on first use
+         *
+         * @param name The name of the command
+         * @param factory A function constructing the command, invoked at most once
+         */
+        CommandWrapper(const std::string &name, const std::function<std::shared_ptr<T>()> &factory)
+            : _state(std::make_shared<_State>()), name(name)
+        {
+            static_assert(std::is_base_of_v<BaseCommand, T>, "CommandWrapper can only be used for BaseCommand subclasses");
+            _state->factory = factory;
+        }
+
+        /** @brief A pointer to the underlying command object, which is constructed if needed */
+        const std::shared_ptr<T> &command() const
+        {
+            std::call_once(
+                _state->constructed,
+                [this]()
+                {
+                    _state->command = _state->factory();
+                    _state->factory = nullptr;
+                });
+
+            return _state->command;
         }
 
         /**
          * @brief Invoke the underlying command and return a new errorlevel for the current shell.
          *
-         * This method simply invokes `command->run(context)`.
+         * This method simply invokes `command()->run(context)`.
          *
          * @see `BaseCommand::run`
          *
@@ -34,7 +75,7 @@ namespace liteshell
          */
         DWORD run(const Context &context)
         {
-            return command->run(context);
+            return command()->run(context);
         }
     };
 
@@ -42,13 +83,13 @@ namespace liteshell
     template <typename T>
     bool operator<(const CommandWrapper<T> &lhs, const CommandWrapper<T> &rhs)
     {
-        return lhs.command->name < rhs.command->name;
+        return lhs.name < rhs.name;
     }
 
     /** @brief Comparator to use within std::set and std::map */
     template <typename T>
     bool operator==(const CommandWrapper<T> &lhs, const CommandWrapper<T> &rhs)
     {
-        return lhs.command->name == rhs.command->name;
+        return lhs.name == rhs.name;
     }
-}
\ No newline at end of file
+}
@@ -2,55 +2,91 @@
 
 #include <all.hpp>
 
+#include "commands/array.hpp"
+#include "commands/call.hpp"
 #include "commands/cat.hpp"
 #include "commands/cd.hpp"
 #include "commands/clear.hpp"
 #include "commands/color.hpp"
+#include "commands/complete.hpp"
+#include "commands/cp.hpp"
 #include "commands/date.hpp"
 #include "commands/echo.hpp"
 #include "commands/echoln.hpp"
 #include "commands/env.hpp"
 #include "commands/eval.hpp"
 #include "commands/exit.hpp"
+#include "commands/find.hpp"
 #include "commands/for.hpp"
+#include "commands/grep.hpp"
+#include "commands/hash.hpp"
 #include "commands/help.hpp"
+#include "commands/history.hpp"
 #include "commands/if.hpp"
 #include "commands/jump.hpp"
 #include "commands/kill.hpp"
+#include "commands/limit.hpp"
 #include "commands/ls.hpp"
+#include "commands/map.hpp"
 #include "commands/memory.hpp"
 #include "commands/mkdir.hpp"
 #include "commands/mv.hpp"
+#include "commands/parallel.hpp"
+#include "commands/profile.hpp"
 #include "commands/ps.hpp"
 #include "commands/resume.hpp"
+#include "commands/return.hpp"
 #include "commands/rm.hpp"
+#include "commands/sort.hpp"
+#include "commands/stats.hpp"
 #include "commands/suspend.hpp"
+#include "commands/time.hpp"
 #include "commands/volume.hpp"
+#include "commands/wait.hpp"
+#include "commands/watch.hpp"
 
 void initialize(liteshell::Client *client)
 {
-    client->add_command<CatCommand>()
-        ->add_command<CdCommand>()
-        ->add_command<ClearCommand>()
-        ->add_command<ColorCommand>()
-        ->add_command<DateCommand>()
-        ->add_command<EchoCommand>()
-        ->add_command<EcholnCommand>()
-        ->add_command<EnvCommand>()
-        ->add_command<EvalCommand>()
-        ->add_command<ExitCommand>()
-        ->add_command<ForCommand>()
-        ->add_command<HelpCommand>()
-        ->add_command<IfCommand>()
-        ->add_command<JumpCommand>()
-        ->add_command<KillCommand>()
-        ->add_command<LsCommand>()
-        ->add_command<MemoryCommand>()
-        ->add_command<MkdirCommand>()
-        ->add_command<MvCommand>()
-        ->add_command<PsCommand>()
-        ->add_command<ResumeCommand>()
-        ->add_command<RmCommand>()
-        ->add_command<SuspendCommand>()
-        ->add_command<VolumeCommand>();
+    client->add_lazy_command<ArrayCommand>()
+        ->add_lazy_command<CallCommand>()
+        ->add_lazy_command<CatCommand>()
+        ->add_lazy_command<CdCommand>()
+        ->add_lazy_command<ClearCommand>()
+        ->add_lazy_command<ColorCommand>()
+        ->add_lazy_command<CompleteCommand>()
+        ->add_lazy_command<CpCommand>()
+        ->add_lazy_command<DateCommand>()
+        ->add_lazy_command<EchoCommand>()
+        ->add_lazy_command<EcholnCommand>()
+        ->add_lazy_command<EnvCommand>()
+        ->add_lazy_command<EvalCommand>()
+        ->add_lazy_command<ExitCommand>()
+        ->add_lazy_command<FindCommand>()
+        ->add_lazy_command<ForCommand>()
+        ->add_lazy_command<GrepCommand>()
+        ->add_lazy_command<HashCommand>()
+        ->add_lazy_command<HelpCommand>()
+        ->add_lazy_command<HistoryCommand>()
+        ->add_lazy_command<IfCommand>()
+        ->add_lazy_command<JumpCommand>()
+        ->add_lazy_command<KillCommand>()
+        ->add_lazy_command<LimitCommand>()
+        ->add_lazy_command<LsCommand>()
+        ->add_lazy_command<MapCommand>()
+        ->add_lazy_command<MemoryCommand>()
+        ->add_lazy_command<MkdirCommand>()
+        ->add_lazy_command<MvCommand>()
+        ->add_lazy_command<ParallelCommand>()
+        ->add_lazy_command<ProfileCommand>()
+        ->add_lazy_command<PsCommand>()
+        ->add_lazy_command<ResumeCommand>()
+        ->add_lazy_command<ReturnCommand>()
+        ->add_lazy_command<RmCommand>()
+        ->add_lazy_command<SortCommand>()
+        ->add_lazy_command<StatsCommand>()
+        ->add_lazy_command<SuspendCommand>()
+        ->add_lazy_command<TimeCommand>()
+        ->add_lazy_command<VolumeCommand>()
+        ->add_lazy_command<WaitCommand>()
+        ->add_lazy_command<WatchCommand>();
 }
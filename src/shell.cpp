@@ -11,13 +11,160 @@ Type "help" to get started.
 Type "help <command>" to get help about a command.
 Type "<executable> <arguments> %" to run an executable in a subprocess.)";
 
-int main(int argc, const char *argv[])
+/** @brief The time elapsed since the creation of the current process, in milliseconds */
+double elapsed_since_creation()
 {
+    FILETIME creation, exit, kernel, user, now;
+    GetProcessTimes(GetCurrentProcess(), &creation, &exit, &kernel, &user);
+    GetSystemTimePreciseAsFileTime(&now);
+
+    auto ticks = [](const FILETIME &time)
+    {
+        return (static_cast<ULONGLONG>(time.dwHighDateTime) << 32) | time.dwLowDateTime;
+    };
+
+    // FILETIME counts intervals of 100 nanoseconds
+    return static_cast<double>(ticks(now) - ticks(creation)) / 1e4;
+}
+
+const char usage[] = R"(Usage: shell [--startup-trace] [--server <name> | --connect <name>] [-c <command> | <script>]
+Without arguments, start an interactive shell. Otherwise, run a command or a batch script without any prompt, then
+exit with the final errorlevel.
+--server <name> keeps the shell resident and serves the requests of other shells, until it is terminated.
+--connect <name> sends the command or the batch script to a running server instead, in the current directory and
+environment, then exits with the errorlevel of the request.)";
+
+int main()
+{
+    // argv would use the ANSI code page, the UTF-16 command line is split instead
+    auto arguments = utils::split(utils::utf_convert(GetCommandLineW()));
+
+    // --startup-trace reports the time spent in each startup step, since the process was created
+    bool startup_trace = false;
+    std::optional<std::string> command, script, server, connect;
+    for (std::size_t i = 1; i < arguments.size(); i++)
+    {
+        if (arguments[i] == "--startup-trace")
+        {
+            startup_trace = true;
+        }
+        else if (arguments[i] == "--server" && i + 1 < arguments.size() && !server.has_value() && !connect.has_value())
+        {
+            server = arguments[++i];
+        }
+        else if (arguments[i] == "--connect" && i + 1 < arguments.size() && !server.has_value() && !connect.has_value())
+        {
+            connect = arguments[++i];
+        }
+        else if (arguments[i] == "-c" && i + 1 < arguments.size() && !command.has_value() && !script.has_value())
+        {
+            command = arguments[++i];
+        }
+        else if (!utils::startswith(arguments[i], "-") && !command.has_value() && !script.has_value())
+        {
+            script = arguments[i];
+        }
+        else
+        {
+            std::cerr << usage << std::endl;
+            return 1;
+        }
+    }
+
+    auto batch = command.has_value() || script.has_value();
+    if (server.has_value() == batch && (server.has_value() || connect.has_value()))
+    {
+        // A server runs requests only, a request needs something to run
+        std::cerr << usage << std::endl;
+        return 1;
+    }
+
+    if (connect.has_value())
+    {
+        // The requesting shell does not initialize anything, the server already did
+        try
+        {
+            return static_cast<int>(
+                command.has_value()
+                    ? liteshell::Server::send(*connect, liteshell::Server::Request::COMMAND, *command)
+                    : liteshell::Server::send(*connect, liteshell::Server::Request::SCRIPT, *script));
+        }
+        catch (std::exception &e)
+        {
+            std::cerr << e.what() << std::endl;
+            return 1;
+        }
+    }
+
+    std::vector<std::pair<const char *, double>> trace;
+    auto mark = [&startup_trace, &trace](const char *step)
+    {
+        if (startup_trace)
+        {
+            trace.emplace_back(step, elapsed_since_creation());
+        }
+    };
+
+    mark("main");
     auto client_ptr = liteshell::Client::get_instance();
+    mark("client");
     initialize(client_ptr.get());
+    mark("commands");
+
+    if (!batch && !server.has_value())
+    {
+        std::cout << title << '\n';
+    }
+
+    // The last step is the first thing the user sees, the whole trace is reported then
+    auto report = [&mark, &trace](const char *step)
+    {
+        mark(step);
+        for (auto &[step, milliseconds] : trace)
+        {
+            std::cerr << utils::format("Startup trace: %s at %.3fms", step, milliseconds) << '\n';
+        }
+    };
+
+    if (batch)
+    {
+        report("first instruction");
+        try
+        {
+            if (command.has_value())
+            {
+                std::vector<std::string> lines = {liteshell::InputStream::ECHO_OFF, *command};
+                client_ptr->run_script(client_ptr->compile(lines.begin(), lines.end()));
+            }
+
+            client_ptr->run_script(client_ptr->get_batch_file(*script));
+        }
+        catch (std::exception &e)
+        {
+            std::cerr << e.what() << std::endl;
+            return 1;
+        }
+    }
+
+    if (server.has_value())
+    {
+        report("first request");
+        try
+        {
+            liteshell::Server(client_ptr.get(), *server).serve_forever();
+        }
+        catch (std::exception &e)
+        {
+            std::cerr << e.what() << std::endl;
+            return 1;
+        }
+    }
 
-    std::cout << title << std::endl;
-    client_ptr->run_forever();
+    client_ptr->run_forever(
+        [&report]()
+        {
+            report("first prompt");
+        });
 
     return 0;
 }
@@ -30,6 +30,9 @@ root_dir = Path(__file__).parent.parent
 build_dir = root_dir / "build"
 current_dir = Path(os.getcwd())
 
+# Keep the command lines of the tests out of the history of the user
+os.environ.setdefault("LITESHELL_HISTORY", str(build_dir / "test-history"))
+
 
 @overload
 def execute_command(
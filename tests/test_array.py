@@ -0,0 +1,51 @@
+from __future__ import annotations
+
+from .globals import (
+    assert_match,
+    execute_command,
+    invalid_argument_test,
+)
+
+
+def test_array() -> None:
+    stdout, _ = execute_command(
+        "array arr 3 1 2\n"
+        "echoln \"length ${#arr}, first ${arr[0]}, last ${arr[-1]}, missing [${arr[5]}]\"\n"
+        "eval -s i 1\n"
+        "echoln \"element ${arr[$i]}, all ${arr[@]}, slice ${arr[1:]}, indices ${!arr[@]}\"\n"
+        "eval -s arr[0] zero\n"
+        "eval -s arr[${#arr}] appended\n"
+        "array arr -a 4 5\n"
+        "echoln \"updated ${arr[@]}\"\n"
+        "for e arr -t each\n"
+        "echo \"<$e>\"\n"
+        "endfor\n"
+        "echoln \"\"\n"
+        "env"
+    )
+
+    assert_match("length 3, first 3, last 2, missing []", stdout)
+    assert_match("element 1, all 3 1 2, slice 1 2, indices 0 1 2", stdout)
+    assert_match("updated zero 1 2 appended 4 5", stdout)
+    assert_match("<zero><1><2><appended><4><5>", stdout)
+    assert_match("[array of 6 element(s)]", stdout)
+
+
+def test_map() -> None:
+    stdout, _ = execute_command(
+        "map ages bob 25 alice 30\n"
+        "eval -s name alice\n"
+        "echoln \"${#ages} entries, ${ages[$name]} and ${ages[bob]}, missing [${ages[carol]}]\"\n"
+        "eval -s ages[carol] 41\n"
+        "map ages -u dave 19\n"
+        "echoln \"keys ${!ages[@]}, values ${ages[@]}\""
+    )
+
+    assert_match("2 entries, 30 and 25, missing []", stdout)
+    assert_match("keys alice bob carol dave, values 30 25 41 19", stdout)
+
+
+def test_array_errors() -> None:
+    invalid_argument_test("array arr 1 2\neval -s arr[5] x")
+    invalid_argument_test("eval -s scalar 1\neval -s scalar[0] x")
+    invalid_argument_test("map ages alice")
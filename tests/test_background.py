@@ -0,0 +1,53 @@
+from __future__ import annotations
+
+from pathlib import Path
+
+from .globals import assert_match, assert_not_match, execute_command
+
+
+def test_background_builtin(tmp_path: Path) -> None:
+    log = tmp_path / "log.txt"
+    stdout, _ = execute_command(f"echoln background > \"{log}\" %\necholn \"started $task\"\nwait $task\necholn \"errorlevel=$errorlevel\"")
+    assert_match("started %1", stdout)
+    assert_match("errorlevel=0", stdout)
+    assert log.read_text(encoding="utf-8").strip() == "background"
+
+
+def test_background_subroutine(tmp_path: Path) -> None:
+    script = tmp_path / "script.ff"
+    script.write_text(
+        "@OFF\ncall :worker 42 %\nwait --any $task\necholn \"errorlevel=$errorlevel\"\njump :EOF\n\n:worker\necholn \"worker $1\"\nreturn 3\n",
+        encoding="utf-8",
+    )
+
+    # The subroutine runs in the task, which returns with its errorlevel
+    stdout, _ = execute_command(str(script))
+    assert_match("worker 42", stdout)
+    assert_match("errorlevel=3", stdout)
+    assert_not_match("return 3", stdout)
+
+
+def test_background_script(tmp_path: Path) -> None:
+    log = tmp_path / "log.txt"
+    script = tmp_path / "script.ff"
+    script.write_text(f"sleep 300\neval -s value 42\necholn \"value=$value\" > \"{log}\"\n", encoding="utf-8")
+
+    stdout, _ = execute_command(f"{script} %\necholn \"started $task\"\nps\nwait\necholn \"value=[$value]\"")
+    assert_match("started %1", stdout)
+    assert_match("STILL_ACTIVE", stdout)
+
+    # The assignments of the task are discarded with its environment
+    assert_match("value=[]", stdout)
+    assert log.read_text(encoding="utf-8").strip() == "value=42"
+
+
+def test_background_suspend_kill(tmp_path: Path) -> None:
+    log = tmp_path / "log.txt"
+    script = tmp_path / "script.ff"
+    script.write_text(f"sleep 300\necholn after > \"{log}\"\n", encoding="utf-8")
+
+    stdout, _ = execute_command(f"{script} %\nsuspend %1\nsleep 600\nps\nkill %1 7\nwait --any %1\necholn \"errorlevel=$errorlevel\"")
+    assert_match("Suspended task %1", stdout)
+    assert_match("Yes", stdout)
+    assert_match("errorlevel=7", stdout)
+    assert not log.exists()
@@ -33,3 +33,27 @@ def test_cat_4() -> None:
 
 def test_cat_5() -> None:
     too_many_positional_arguments_test("cat foo bar")
+
+
+def test_cat_6() -> None:
+    path = root_dir / "src" / "shell.cpp"
+    with open(path, "r", encoding="utf-8") as file:
+        data = file.read()
+
+    stdout, _ = execute_command(f"cat {path} --mmap")
+    assert_match(data, stdout)
+
+
+def test_cat_7() -> None:
+    path = root_dir / "tests" / "large.txt"
+    data = "".join(f"{index}\n" for index in range(500000))
+    with open(path, "w", encoding="utf-8", newline="\n") as file:
+        file.write(data)
+
+    try:
+        for flags in ("", "--mmap"):
+            stdout, _ = execute_command(f"cat {path} {flags}")
+            assert stdout.count("\n") >= 500000
+            assert_match("499999\n", stdout)
+    finally:
+        path.unlink()
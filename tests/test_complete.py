@@ -0,0 +1,49 @@
+from __future__ import annotations
+
+from pathlib import Path
+
+from .globals import assert_match, assert_not_match, execute_command, root_dir
+
+
+def test_complete_commands() -> None:
+    stdout, _ = execute_command("complete EC")
+    assert_match("echo", stdout)
+    assert_match("echoln", stdout)
+    assert_not_match("eval", stdout)
+
+    # Executables in PATH are completed without their extension, after a pipe as well
+    stdout, _ = execute_command("complete \"echo foo | notep\"")
+    assert_match("notepad", stdout)
+    assert_not_match("notepad.exe", stdout)
+
+
+def test_complete_variables() -> None:
+    stdout, _ = execute_command("complete \"echoln $$PAT\"")
+    assert_match("$PATH", stdout)
+    assert_not_match("$errorlevel", stdout)
+
+
+def test_complete_paths(tmp_path: Path) -> None:
+    stdout, _ = execute_command("complete \"cat src\\inc\"")
+    assert_match("src\\include\\", stdout)
+
+    (tmp_path / "folder").mkdir()
+    (tmp_path / "file one.txt").write_text("")
+    (tmp_path / "file two.txt").write_text("")
+
+    stdout, _ = execute_command(f"complete \"cat {tmp_path}\\F\"")
+    assert_match(f"{tmp_path}\\file one.txt", stdout)
+    assert_match(f"{tmp_path}\\file two.txt", stdout)
+    assert_match(f"{tmp_path}\\folder\\", stdout)
+
+    # A directory created after the directory was listed is found through its change notification, the second
+    # completion waits for the listing which the notification triggers instead of relying on the default timeout
+    stdout, _ = execute_command(f"complete \"cat {tmp_path}\\fo\"\nmkdir {tmp_path}\\fox\ncomplete -t 10000 \"cat {tmp_path}\\fo\"")
+    assert_match(f"{tmp_path}\\fox\\", stdout)
+
+
+def test_complete_rooted_paths() -> None:
+    # A path starting with a backslash is rooted at the drive of the working directory
+    rooted = "\\" + str(root_dir.relative_to(root_dir.anchor))
+    stdout, _ = execute_command(f"complete \"cat {rooted}\\src\\inc\"")
+    assert_match(f"{rooted}\\src\\include\\", stdout)
@@ -0,0 +1,57 @@
+from __future__ import annotations
+
+import os
+from pathlib import Path
+
+from .globals import (
+    assert_match,
+    execute_command,
+    invalid_argument_test,
+)
+
+
+def test_cp(tmp_path: Path) -> None:
+    source = tmp_path / "source"
+    for i in range(5):
+        directory = source / f"dir-{i}" / "nested"
+        os.makedirs(directory, exist_ok=True)
+        for j in range(10):
+            (directory / f"file-{j}.txt").write_text(f"liteshell {i} {j}")
+
+    destination = tmp_path / "destination"
+    stdout, _ = execute_command(f"cp \"{source}\" \"{destination}\" -q")
+    assert_match("Copied 50 file(s) and 11 folder(s)", stdout)
+    for i in range(5):
+        for j in range(10):
+            assert (destination / f"dir-{i}" / "nested" / f"file-{j}.txt").read_text() == f"liteshell {i} {j}"
+
+    # Existing files are only replaced with -f
+    (source / "dir-0" / "nested" / "file-0.txt").write_text("updated")
+    _, stderr, returncode = execute_command(f"cp \"{source}\\*\" \"{destination}\" -q", expected_exit_code=None, get_returncode=True, no_stderr=False)
+    assert returncode == 50
+    assert_match("file-0.txt", stderr)
+
+    execute_command(f"cp \"{source}\\*\" \"{destination}\" -q -f -j 2")
+    assert (destination / "dir-0" / "nested" / "file-0.txt").read_text() == "updated"
+
+
+def test_cp_into_directory(tmp_path: Path) -> None:
+    (tmp_path / "a.txt").write_text("a")
+    (tmp_path / "b.txt").write_text("b")
+    (tmp_path / "c.log").write_text("c")
+    (tmp_path / "out").mkdir()
+
+    execute_command(f"cp \"{tmp_path}\\*.txt\" \"{tmp_path}\\out\"")
+    assert sorted(os.listdir(tmp_path / "out")) == ["a.txt", "b.txt"]
+
+    execute_command(f"cp \"{tmp_path}\\c.log\" \"{tmp_path}\\renamed.log\"")
+    assert (tmp_path / "renamed.log").read_text() == "c"
+
+
+def test_cp_errors(tmp_path: Path) -> None:
+    invalid_argument_test("cp abcxyz def")
+    invalid_argument_test(f"cp \"{tmp_path}\\*\" \"{tmp_path}\\missing\"")
+
+    (tmp_path / "loop").mkdir()
+    _, stderr = execute_command(f"cp \"{tmp_path}\\loop\" \"{tmp_path}\\loop\\inner\"", no_stderr=False)
+    assert_match("into itself", stderr)
@@ -1,8 +1,15 @@
 from __future__ import annotations
 
+import ctypes
+import random
+import subprocess
+from pathlib import Path
+
 from .globals import (
     assert_match,
+    build_dir,
     execute_command,
+    root_dir,
 )
 
 
@@ -12,3 +19,34 @@ def test_echoln() -> None:
 
     test_string = test_string.replace(r"\"", "\"")
     assert_match(test_string, stdout)
+
+
+def command_line_to_argv(command_line: str) -> list[str]:
+    shell32 = ctypes.windll.shell32
+    shell32.CommandLineToArgvW.argtypes = [ctypes.c_wchar_p, ctypes.POINTER(ctypes.c_int)]
+    shell32.CommandLineToArgvW.restype = ctypes.POINTER(ctypes.c_wchar_p)
+
+    size = ctypes.c_int()
+    results = shell32.CommandLineToArgvW(command_line, ctypes.byref(size))
+    try:
+        return [results[i] for i in range(size.value)]
+    finally:
+        ctypes.windll.kernel32.LocalFree(results)
+
+
+def test_tokenizer_matches_command_line_to_argv(tmp_path: Path) -> None:
+    lines = []
+    for _ in range(500):
+        # Hyphens and dollar signs are left out, they would be parsed as options and variables
+        text = "".join(random.choices("ab \"\\é", k=random.randint(0, 16))) + "x"
+        lines.append(f"echoln {text}")
+
+    script = tmp_path / "tokens.ff"
+    script.write_text("\n".join(lines) + "\n", encoding="utf-8")
+
+    process = subprocess.run([build_dir / "shell.exe", str(script)], capture_output=True, cwd=root_dir, input="", text=True, encoding="utf-8")
+    assert process.returncode == 0
+
+    output = process.stdout.replace("\r", "").split("\n")
+    for index, line in enumerate(lines):
+        assert output[index] == " ".join(command_line_to_argv(line)[1:]), line
@@ -89,3 +89,18 @@ def test_eval_18() -> None:
 
 def test_eval_19() -> None:
     argument_missing_test("eval 2 -s")
+
+
+def test_eval_20() -> None:
+    expressions = [f"{a} * ({b} - {a}) % 7" for a, b in [(3, 10), (12, 5), (100, 1)]]
+    stdout, _ = execute_command("\n".join(f"eval \"{expression}\" -m" for expression in expressions))
+    for expression in expressions:
+        a, _, rest = expression.partition(" * ")
+        b = rest.split(" - ")[0].strip("(")
+        # C++ truncates towards zero
+        product = int(a) * (int(b) - int(a))
+        assert_match(str(int(product - 7 * int(product / 7))), stdout)
+
+
+def test_eval_21() -> None:
+    runtime_error_test("eval \"6 / 3\" -m\neval \"6 / 0\" -m")
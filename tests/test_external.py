@@ -1,5 +1,6 @@
 from __future__ import annotations
 
+import contextlib
 import os
 import time
 from urllib import request
@@ -8,6 +9,7 @@ from .globals import (
     assert_match,
     current_dir,
     execute_command,
+    root_dir,
 )
 
 
@@ -30,6 +32,21 @@ def test_tree() -> None:
             assert_match(filename, stdout)
 
 
+def test_tree_summary() -> None:
+    files = directories = size = 0
+    for dirpath, dirnames, filenames in os.walk(current_dir / "src"):
+        directories += len(dirnames)
+        files += len(filenames)
+        size += sum(os.path.getsize(os.path.join(dirpath, filename)) for filename in filenames)
+
+    stdout, _ = execute_command("tree src/ --count")
+    assert_match(f"{files} file(s), {directories} folder(s)", stdout)
+
+    stdout, _ = execute_command("tree src/ --count --size")
+    assert_match(f"{files} file(s), {directories} folder(s)", stdout)
+    assert_match(f"{size} byte(s)", stdout)
+
+
 def test_download() -> None:
     execute_command("download https://example.com example.html")
     assert os.path.exists("example.html")
@@ -40,3 +57,61 @@ def test_download() -> None:
         assert data == file.read()
 
     os.remove("example.html")
+
+
+def test_download_segments() -> None:
+    execute_command("download https://example.com example.html --segments 8")
+    assert not os.path.exists("example.html.part")
+    assert not os.path.exists("example.html.part.state")
+
+    response = request.urlopen("https://example.com")
+    data = response.read()
+    with open("example.html", "rb") as file:
+        assert data == file.read()
+
+    os.remove("example.html")
+
+
+def test_download_manifest() -> None:
+    manifest = root_dir / "manifest.txt"
+    manifest.write_text("# Comments and empty lines are ignored\n\nhttps://example.com first.html\nhttps://example.com \"second file.html\"\nftp://example.com third.html\n")
+
+    try:
+        stdout, _ = execute_command("download -m manifest.txt -j 2\necholn \"errorlevel $errorlevel\"")
+        assert_match("2 file(s) downloaded, 1 failure(s)", stdout)
+        assert_match("Only HTTP and HTTPS are supported", stdout)
+        assert_match("errorlevel 1", stdout)
+
+        data = request.urlopen("https://example.com").read()
+        for filename in ("first.html", "second file.html"):
+            with open(root_dir / filename, "rb") as file:
+                assert data == file.read()
+
+        assert not os.path.exists(root_dir / "third.html")
+
+    finally:
+        for filename in ("manifest.txt", "first.html", "second file.html"):
+            with contextlib.suppress(FileNotFoundError):
+                os.remove(root_dir / filename)
+
+
+def test_parallel() -> None:
+    start = time.perf_counter()
+    stdout, _ = execute_command("parallel -j 2\nsleep 1000\nsleep 1000\nhello\nendparallel\necholn \"$parallel_0 $parallel_1 $parallel_2\"")
+    end = time.perf_counter()
+
+    assert_match("Hello world!", stdout)
+    assert_match("0 0 0", stdout)
+    assert end - start < 2.0
+
+    stdout, _ = execute_command("parallel -s job\nhello\nendparallel\necholn \"$job_0\"")
+    assert_match("0", stdout)
+
+
+def test_hash() -> None:
+    stdout, _ = execute_command("hello\nhello\nhash")
+    assert_match("hello.exe", stdout)
+    assert_match("1 hit(s), 1 miss(es)", stdout)
+
+    stdout, _ = execute_command("hello\nhash -r\nhash")
+    assert_match("0 hit(s), 0 miss(es)", stdout)
@@ -0,0 +1,48 @@
+from __future__ import annotations
+
+from pathlib import Path
+
+from .globals import execute_command, invalid_argument_test
+
+
+def find(arguments: str) -> set[str]:
+    stdout, _ = execute_command(f"find {arguments}")
+
+    # The first match follows the prompt on the same line, and paths cannot contain ">"
+    lines = (line.rpartition(">")[2] for line in stdout.splitlines())
+    return set(line for line in lines if line.startswith(".\\"))
+
+
+def test_find(tmp_path: Path) -> None:
+    (tmp_path / "a" / "b").mkdir(parents=True)
+    (tmp_path / "a" / "b" / "notes.TXT").write_text("liteshell")
+    (tmp_path / "a" / "log.txt").write_text("liteshell")
+    (tmp_path / "a" / "debug.log").write_text("liteshell")
+    (tmp_path / "large.bin").write_bytes(b"\0" * 5000)
+
+    command = f"cd \"{tmp_path}\"\nfind"
+    assert find(command) == {
+        ".\\a",
+        ".\\a\\b",
+        ".\\a\\b\\notes.TXT",
+        ".\\a\\log.txt",
+        ".\\a\\debug.log",
+        ".\\large.bin",
+    }
+
+    assert find(f"{command} -n *.txt") == {".\\a\\b\\notes.TXT", ".\\a\\log.txt"}
+    assert find(f"{command} -r \"^[nd]\"") == {".\\a\\b\\notes.TXT", ".\\a\\debug.log"}
+    assert find(f"{command} -t d") == {".\\a", ".\\a\\b"}
+    assert find(f"{command} -t f -d 0") == {".\\large.bin"}
+    assert find(f"{command} --min-size 4K") == {".\\large.bin"}
+    assert find(f"{command} --max-size 100 -n *.log") == {".\\a\\debug.log"}
+    assert find(f"{command} --newer 1 -t d") == {".\\a", ".\\a\\b"}
+    assert find(f"{command} --older 1") == set()
+    assert len(find(f"{command} -j 1")) == 6
+
+
+def test_find_errors() -> None:
+    invalid_argument_test("find abcxyz")
+    invalid_argument_test("find -t x")
+    invalid_argument_test("find --min-size 4Q")
+    invalid_argument_test("find -r \"(\"")
@@ -0,0 +1,85 @@
+from __future__ import annotations
+
+from pathlib import Path
+from typing import List
+
+from .globals import (
+    assert_match,
+    assert_not_match,
+    execute_command,
+    invalid_argument_test,
+)
+
+
+def output_lines(stdout: str) -> List[str]:
+    # The first line of an output follows the prompt on the same line
+    return [line.rpartition(">")[2] for line in stdout.splitlines()]
+
+
+def write_logs(directory: Path) -> None:
+    (directory / "first.log").write_text("INFO started\nERROR disk full\ninfo idle\nERROR timeout 42\n", encoding="utf-8")
+    (directory / "second.log").write_text("INFO started\r\nWARNING slow\r\n", encoding="utf-8")
+
+
+def test_grep(tmp_path: Path) -> None:
+    write_logs(tmp_path)
+    first = tmp_path / "first.log"
+
+    stdout, _ = execute_command(f"grep ERROR \"{first}\"")
+    assert_match("ERROR disk full", stdout)
+    assert_match("ERROR timeout 42", stdout)
+    assert_not_match("started", stdout)
+
+    stdout, _ = execute_command(f"grep -n \"time.*\\d+$$\" \"{first}\"")
+    assert_match("4:ERROR timeout 42", stdout)
+    assert_not_match("disk", stdout)
+
+    stdout, _ = execute_command(f"grep -i -F INFO \"{first}\"")
+    assert_match("INFO started", stdout)
+    assert_match("info idle", stdout)
+
+
+def test_grep_files(tmp_path: Path) -> None:
+    write_logs(tmp_path)
+
+    stdout, _ = execute_command(f"grep -c started \"{tmp_path}\\*.log\"")
+    assert_match(f"{tmp_path}\\first.log:1", stdout)
+    assert_match(f"{tmp_path}\\second.log:1", stdout)
+
+    stdout, _ = execute_command(f"grep -l ERROR \"{tmp_path}\\first.log\" \"{tmp_path}\\second.log\"")
+    assert_match(f"{tmp_path}\\first.log", stdout)
+    assert_not_match("second.log", stdout)
+
+    # The lines of the files are displayed in the order of the arguments
+    stdout, _ = execute_command(f"grep -j 2 started \"{tmp_path}\\second.log\" \"{tmp_path}\\first.log\"")
+    assert stdout.index("second.log:") < stdout.index("first.log:")
+
+
+def test_grep_errorlevel(tmp_path: Path) -> None:
+    write_logs(tmp_path)
+
+    _, _, returncode = execute_command(f"grep CRITICAL \"{tmp_path}\\first.log\"", expected_exit_code=None, get_returncode=True)
+    assert returncode == 1
+
+    _, stderr, returncode = execute_command(f"grep ERROR \"{tmp_path}\\missing.log\"", expected_exit_code=None, get_returncode=True, no_stderr=False)
+    assert returncode == 2
+    assert_match("missing.log", stderr)
+
+
+def test_grep_pipeline(tmp_path: Path) -> None:
+    stdout, _ = execute_command("hello | grep -n world")
+    assert "1:Hello world!" in output_lines(stdout)
+
+    stdout, _ = execute_command("hello | grep -c xyz")
+    assert "0" in output_lines(stdout)
+
+    # A line longer than the buffer of a pipe is searched once it is complete
+    lines = tmp_path / "lines.txt"
+    lines.write_text("x" * 100000 + "\nshort x\nnone\n", encoding="utf-8")
+    stdout, _ = execute_command(f"cat \"{lines}\" | grep -c x")
+    assert "2" in output_lines(stdout)
+
+
+def test_grep_errors() -> None:
+    invalid_argument_test("grep \"(\" README.md")
+    invalid_argument_test("grep hello")
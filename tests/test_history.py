@@ -0,0 +1,62 @@
+from __future__ import annotations
+
+import subprocess
+from pathlib import Path
+
+import pytest
+
+from .globals import (
+    assert_match,
+    assert_not_match,
+    build_dir,
+    execute_command,
+    root_dir,
+)
+
+
+def test_history(tmp_path: Path, monkeypatch: pytest.MonkeyPatch) -> None:
+    log = tmp_path / "history"
+    monkeypatch.setenv("LITESHELL_HISTORY", str(log))
+
+    stdout, _ = execute_command("echoln first\necholn second\necholn second\nhistory")
+    assert_match("1  echoln first", stdout)
+    assert_match("2  echoln second", stdout)
+    assert_match("3  history", stdout)
+
+    # The history of the previous session is loaded from the log
+    stdout, _ = execute_command("history -p ECHOLN")
+    assert_match("1  echoln first", stdout)
+    assert_match("2  echoln second", stdout)
+    assert_not_match("history -p ECHOLN", stdout)
+
+    stdout, _ = execute_command("history -n 1 first")
+    assert_match("history -n 1 first", stdout)
+    assert_not_match("echoln first", stdout)
+
+    # Only the "exit" of the session is left after clearing the history
+    execute_command("history -c")
+    assert log.read_text(encoding="utf-8") == "exit\n"
+
+    stdout, _ = execute_command("history")
+    assert_not_match("echoln", stdout)
+    assert_match("1  exit", stdout)
+    assert_match("2  history", stdout)
+
+
+def test_history_batch() -> None:
+    process = subprocess.run([build_dir / "shell.exe", "-c", "history"], capture_output=True, cwd=root_dir, input="", text=True)
+    assert process.returncode == 900
+    assert_match("The history is only available in an interactive shell", process.stderr)
+
+
+def test_history_eviction(tmp_path: Path, monkeypatch: pytest.MonkeyPatch) -> None:
+    log = tmp_path / "history"
+    log.write_text("".join(f"entry-{i:06d}\n" for i in range(100000)), encoding="utf-8")
+    monkeypatch.setenv("LITESHELL_HISTORY", str(log))
+
+    # The first search indexes the entries, the next command lines evict the oldest ones from the index
+    stdout, _ = execute_command("history entry-000003\necholn a\necholn b\necholn marker\nhistory entry-000003")
+    before, after = stdout.split("marker")
+    assert_match("4  entry-000003", before)
+    assert_not_match("entry-000003\n", after.replace("history entry-000003\n", ""))
+    assert_match("100005  history entry-000003", after)
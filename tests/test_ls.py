@@ -0,0 +1,45 @@
+from __future__ import annotations
+
+import os
+from pathlib import Path
+
+from .globals import (
+    assert_match,
+    current_dir,
+    execute_command,
+    invalid_argument_test,
+)
+
+
+def test_ls() -> None:
+    stdout, _ = execute_command("ls src")
+    for name in os.listdir(current_dir / "src"):
+        assert_match(name, stdout)
+
+
+def test_ls_options(tmp_path: Path) -> None:
+    (tmp_path / "small.txt").write_bytes(b"x" * 10)
+    (tmp_path / "large.txt").write_bytes(b"x" * 5000)
+    nested = tmp_path / "nested" / "deeper"
+    nested.mkdir(parents=True)
+    (nested / "inner.txt").write_bytes(b"x" * 3000)
+
+    stdout, _ = execute_command(f"ls \"{tmp_path}\" -R")
+    assert_match("nested\\deeper\\inner.txt", stdout)
+
+    stdout, _ = execute_command(f"ls \"{tmp_path}\" --sort=size")
+    assert stdout.index("large.txt") < stdout.index("small.txt")
+
+    stdout, _ = execute_command(f"ls \"{tmp_path}\" --sort name")
+    assert stdout.index("large.txt") < stdout.index("nested") < stdout.index("small.txt")
+
+    # The size of a directory is the total size of its files
+    stdout, _ = execute_command(f"ls \"{tmp_path}\" --summary --sort size -j 2")
+    assert stdout.index("large.txt") < stdout.index("nested") < stdout.index("small.txt")
+    assert_match("2 file(s) and 1 folder(s)", stdout)
+
+
+def test_ls_errors(tmp_path: Path) -> None:
+    invalid_argument_test(f"ls \"{tmp_path}\\missing\"")
+    invalid_argument_test(f"ls \"{tmp_path}\" --sort=color")
+    invalid_argument_test(f"ls \"{tmp_path}\" --recursive=yes")
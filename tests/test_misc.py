@@ -3,10 +3,14 @@ from __future__ import annotations
 import os
 import random
 import shutil
+import subprocess
 from .globals import (
     assert_match,
+    assert_not_match,
+    build_dir,
     command_not_found_test,
     execute_command,
+    invalid_argument_test,
     root_dir,
 )
 
@@ -40,3 +44,92 @@ def test_mutable_path() -> None:
     finally:
         shutil.move(root_dir / dirname / "hello123.exe", root_dir / "build" / "hello.exe")
         os.rmdir(root_dir / dirname)
+
+
+def test_resolve() -> None:
+    stdout, _ = execute_command("eval -s i 3\neval -s arr_3 value\neval -s ref \"$$i\"\necholn \"${arr_${i}} ${arr_$i} [$i${i}] [$undefined] $ref ${not a name}\"")
+    assert_match("value value [33] [] $i ${not a name}", stdout)
+
+
+def test_env() -> None:
+    stdout, _ = execute_command("eval -s zz_variable 1\neval -s aa_variable 2\neval -s zz_variable 3\nenv")
+    assert_match("aa_variable", stdout)
+    assert stdout.index("aa_variable") < stdout.index("zz_variable")
+    assert stdout.count("zz_variable") == 1
+
+
+def test_memory() -> None:
+    stdout, _ = execute_command("memory")
+    assert_match("Input stream frames", stdout)
+    assert_match("Buffered instructions", stdout)
+
+
+def test_pipeline() -> None:
+    stdout, _ = execute_command("echoln 6*7 | eval -m -p \">\"")
+    assert_match("42", stdout)
+
+    stdout, _ = execute_command("hello | eval -p \">\"")
+    assert_match("Hello world!", stdout)
+
+    stdout, _ = execute_command("echoln \"a|b\"")
+    assert_match("a|b", stdout)
+
+    # Only the last stage of a pipeline runs on behalf of the shell and keeps its assignments
+    stdout, _ = execute_command("hello | eval -p \"\" -s greeting\neval 5 -s discarded | hello\necholn \"[$greeting][$discarded]\"")
+    assert_match("[Hello world!][]", stdout)
+
+    invalid_argument_test("echoln a |")
+
+
+def test_redirection() -> None:
+    path = root_dir / "redirection.txt"
+    try:
+        stdout, _ = execute_command(f"echoln hello > \"{path}\"\necholn world >> \"{path}\"\nhello >> \"{path}\"")
+        assert_not_match("hello", stdout)
+        with open(path, "r", encoding="utf-8") as file:
+            data = file.read().replace("\r", "")
+        assert data.startswith("hello\nworld\n")
+        assert_match("Hello world!", data)
+
+        execute_command(f"cat abcxyz 2> \"{path}\"", expected_exit_code=901)
+        with open(path, "r", encoding="utf-8") as file:
+            assert_match("The specified file does not exist", file.read())
+
+        stdout, _ = execute_command("echoln \"a > b\"")
+        assert_match("a > b", stdout)
+    finally:
+        os.remove(path)
+
+
+def test_output_order() -> None:
+    stdout, _ = execute_command("echoln before\nhello\necho \"no newline \"\necholn after")
+    assert stdout.index("before") < stdout.index("Hello world!") < stdout.index("no newline after")
+
+    stdout, _ = execute_command("for -t range i 0 5000\n    echoln \"line $i\"\nendfor")
+    assert stdout.count("line ") == 5000
+    assert_match("line 4999", stdout)
+
+
+def test_comparison_is_not_redirection() -> None:
+    stdout, _ = execute_command("if -m 3 > 2\n    echoln greater\nendif")
+    assert_match("greater", stdout)
+    assert not (root_dir / "2").exists()
+
+
+def test_command_suggestion() -> None:
+    _, stderr = execute_command("ecoh hi", expected_exit_code=905, no_stderr=False)
+    assert_match("Command \"ecoh\" not found. Did you mean \"echo\"?", stderr)
+
+
+def test_startup_trace() -> None:
+    process = subprocess.run(
+        [build_dir / "shell.exe", "--startup-trace"],
+        input=b"exit\n",
+        capture_output=True,
+        cwd=root_dir,
+        check=True,
+    )
+
+    stderr = process.stderr.decode("utf-8")
+    for step in ("main", "client", "commands", "first prompt"):
+        assert_match(f"Startup trace: {step} at", stderr)
@@ -1,8 +1,12 @@
 from __future__ import annotations
 
+import time
+
 from .globals import (
     assert_match,
+    assert_not_match,
     execute_command,
+    invalid_argument_test,
 )
 
 
@@ -13,3 +17,54 @@ def test_ps() -> None:
     assert isinstance(pid, int)
     assert_match(str(pid), stdout)
     assert_match("STILL_ACTIVE", stdout)
+
+
+def test_ps_exited() -> None:
+    stdout, _ = execute_command("hello\nsleep 100 %\nsleep 500\nps")
+    assert_match("hello.exe", stdout)
+    assert_not_match("STILL_ACTIVE", stdout)
+
+
+def test_wait() -> None:
+    start = time.perf_counter()
+    stdout, _ = execute_command("sleep 500 %\nsleep 500 %\nwait\necholn \"errorlevel=$errorlevel\"\nps")
+    end = time.perf_counter()
+
+    assert_match("errorlevel=0", stdout)
+    assert_not_match("STILL_ACTIVE", stdout)
+    assert 0.5 < end - start < 1.5
+
+    stdout, _ = execute_command("sleep 2000 %\nwait -t 100\necholn \"errorlevel=$errorlevel\"")
+    assert_match("errorlevel=258", stdout)
+
+    stdout, _ = execute_command("sleep 100 %\nsleep 1000 %\nwait --any -t 800\necholn \"errorlevel=$errorlevel\"")
+    assert_match("errorlevel=0", stdout)
+
+
+def test_ps_spawn_statistics() -> None:
+    stdout, _ = execute_command("hello\nsleep 100 %\nps -s")
+    assert_match("Spawned 2 subprocess(es)", stdout)
+
+
+def test_ps_resource_usage() -> None:
+    stdout, _ = execute_command("hello\nps")
+    for header in ("CPU time", "Peak memory", "Read", "Written", "Started", "Ended"):
+        assert_match(header, stdout)
+
+
+def test_limit() -> None:
+    stdout, _ = execute_command("limit")
+    assert_match("Memory: unlimited", stdout)
+    assert_match("CPU: unlimited", stdout)
+
+    # A subprocess still runs within generous caps
+    stdout, _ = execute_command("limit -m 256 -c 50\nlimit\nhello")
+    assert_match("Memory: 256.00MB", stdout)
+    assert_match("CPU: 50%", stdout)
+    assert_match("Hello world!", stdout)
+
+    stdout, _ = execute_command("limit -m 256\nlimit -r\nlimit")
+    assert_match("Memory: unlimited", stdout)
+
+    invalid_argument_test("limit -c 0")
+    invalid_argument_test("limit -m 0")
@@ -0,0 +1,30 @@
+from __future__ import annotations
+
+import os
+
+from .globals import (
+    assert_match,
+    assert_not_match,
+    execute_command,
+    root_dir,
+)
+
+
+def test_rm() -> None:
+    target = root_dir / "rm-test"
+    for i in range(5):
+        directory = target / f"dir-{i}" / "nested"
+        os.makedirs(directory, exist_ok=True)
+        for j in range(10):
+            with open(directory / f"file-{j}.txt", "w") as file:
+                file.write("liteshell")
+
+    stdout, _ = execute_command(f"rm \"{target}\" -q")
+    assert not os.path.exists(target)
+    assert_match("Deleted 50 file(s) and 11 folder(s)", stdout)
+    assert_not_match("...", stdout)
+
+
+def test_rm_missing() -> None:
+    _, stderr = execute_command("rm abcxyz", no_stderr=False)
+    assert_match("does not exist", stderr)
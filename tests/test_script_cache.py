@@ -0,0 +1,39 @@
+from __future__ import annotations
+
+import os
+from pathlib import Path
+
+import pytest
+
+from .globals import assert_match, execute_command
+
+
+def test_script_cache(tmp_path: Path, monkeypatch: pytest.MonkeyPatch) -> None:
+    cache = tmp_path / "cache"
+    monkeypatch.setenv("LITESHELL_SCRIPT_CACHE", str(cache))
+
+    script = tmp_path / "script.ff"
+    script.write_text("echoln first | eval -p \">\"\n:loop\necholn \"a b\" > NUL\n", encoding="utf-8")
+
+    stdout, _ = execute_command(str(script))
+    assert_match("first", stdout)
+    assert len(os.listdir(cache)) == 1
+
+    # Another shell loads the compiled file
+    stdout, _ = execute_command(str(script))
+    assert_match("first", stdout)
+
+    # A change with the same size is detected by the last write time
+    stat = script.stat()
+    script.write_text("echoln other | eval -p \">\"\n:loop\necholn \"a b\" > NUL\n", encoding="utf-8")
+    os.utime(script, ns=(stat.st_atime_ns, stat.st_mtime_ns + 10 ** 7))
+
+    stdout, _ = execute_command(str(script))
+    assert_match("other", stdout)
+
+    # A corrupted compiled file is ignored
+    for name in os.listdir(cache):
+        (cache / name).write_bytes(b"garbage")
+
+    stdout, _ = execute_command(str(script))
+    assert_match("other", stdout)
@@ -1,11 +1,16 @@
 from __future__ import annotations
 
+import json
 import random
+import subprocess
 
 from .globals import (
     assert_match,
     assert_not_match,
+    build_dir,
+    current_dir,
     execute_command,
+    root_dir,
     runtime_error_test,
 )
 
@@ -129,3 +134,94 @@ def test_script_7() -> None:
     assert_match("lmao this dumb string", stdout)
     assert_not_match("@OFF", stdout)
     assert_not_match("@ON", stdout)
+
+
+def test_script_cached() -> None:
+    stdout, _ = execute_command("tests/shell-script-1\ntests/shell-script-1\ntests/shell-script-1")
+
+    assert stdout.count("6969") == 3
+    assert_not_match("@OFF", stdout)
+    assert_not_match("@ON", stdout)
+
+
+def test_script_8() -> None:
+    stdout, _ = execute_command("tests/shell-script-8")
+
+    assert_match("count = 20000", stdout)
+    assert_match("stopped at 42", stdout)
+    assert_not_match("@OFF", stdout)
+    assert_not_match("@ON", stdout)
+
+
+def test_script_9() -> None:
+    stdout, _ = execute_command("tests/shell-script-9")
+
+    assert_match("even = 500, odd = 500, big = 250", stdout)
+    assert_match("else taken", stdout)
+    assert_match("after if", stdout)
+    assert_not_match("not printed", stdout)
+    assert_not_match("skipped by jump", stdout)
+
+
+def test_script_10() -> None:
+    stdout, _ = execute_command("tests/shell-script-10")
+
+    assert_match("10! = 3628800", stdout)
+    assert_match("Hello, Alice and Bob (2 argument(s), from :greet)", stdout)
+    assert_match("count has 1 argument(s), second is []", stdout)
+    assert_match("Back in greet with 2 argument(s), second is Bob", stdout)
+    assert_match("errorlevel = 3", stdout)
+    assert_match("argc after return = []", stdout)
+
+
+def test_script_11() -> None:
+    stdout, _ = execute_command("tests/shell-script-11")
+
+    assert_match("inside: x, 1 argument(s)", stdout)
+    assert_match("array 3: a b c, map 1: value", stdout)
+
+
+def test_return_outside_subroutine() -> None:
+    runtime_error_test("return")
+
+
+def test_script_profile() -> None:
+    trace = current_dir / "profile-trace.json"
+    try:
+        stdout, _ = execute_command(f"profile run tests/sum -n 5 -t {trace}\n1 2 3 4")
+
+        assert_match("Sum = 10", stdout)
+        assert_match("Calls", stdout)
+        assert_match("Allocations/call", stdout)
+        assert_match("for e", stdout)
+        assert_not_match("@OFF", stdout)
+        assert_not_match("profile stop", stdout)
+
+        with open(trace, "r", encoding="utf-8") as file:
+            events = json.load(file)["traceEvents"]
+
+        assert any(event["cat"] == "command" and event["name"] == "eval" for event in events)
+    finally:
+        trace.unlink(missing_ok=True)
+
+
+def run_batch(*arguments: str) -> subprocess.CompletedProcess[str]:
+    return subprocess.run([build_dir / "shell.exe", *arguments], capture_output=True, cwd=root_dir, input="", text=True)
+
+
+def test_batch_script() -> None:
+    process = run_batch("tests/shell-script-1")
+
+    assert process.returncode == 0
+    assert_match("6969", process.stdout)
+    assert_not_match("Windows lightweight command shell", process.stdout)
+    assert_not_match("liteshell~", process.stdout)
+
+
+def test_batch_command() -> None:
+    process = run_batch("-c", "echoln \"hello world\"")
+    assert process.returncode == 0
+    assert process.stdout.strip() == "hello world"
+
+    assert run_batch("-c", "exit 7").returncode == 7
+    assert run_batch("-c", "ecoh hi").returncode == 905
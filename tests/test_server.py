@@ -0,0 +1,88 @@
+from __future__ import annotations
+
+import os
+import subprocess
+import time
+from pathlib import Path
+from typing import Iterator
+
+import pytest
+
+from .globals import assert_match, assert_not_match, build_dir, root_dir
+
+
+@pytest.fixture()
+def server() -> Iterator[str]:
+    name = f"test-{os.getpid()}"
+    process = subprocess.Popen([build_dir / "shell.exe", "--server", name], cwd=root_dir, stdin=subprocess.DEVNULL)
+    try:
+        # Wait until the pipe of the server exists
+        for _ in range(100):
+            if connect(name, "-c", "echoln ready").returncode == 0:
+                break
+
+            time.sleep(0.1)
+
+        yield name
+    finally:
+        process.kill()
+        process.wait()
+
+
+def connect(name: str, *arguments: str, cwd: Path = root_dir, env: dict[str, str] | None = None) -> subprocess.CompletedProcess[str]:
+    return subprocess.run(
+        [build_dir / "shell.exe", "--connect", name, *arguments],
+        capture_output=True,
+        cwd=cwd,
+        env=env,
+        input="",
+        text=True,
+    )
+
+
+def test_server_command(server: str) -> None:
+    process = connect(server, "-c", "echoln \"hello world\"")
+    assert process.returncode == 0
+    assert process.stdout.strip() == "hello world"
+
+    process = connect(server, "-c", "hello")
+    assert_match("Hello world!", process.stdout)
+
+    # Exiting ends the request only
+    assert connect(server, "-c", "exit 7").returncode == 7
+    assert connect(server, "-c", "ecoh hi").returncode == 905
+    assert connect(server, "-c", "echoln alive").stdout.strip() == "alive"
+
+
+def test_server_script(server: str, tmp_path: Path) -> None:
+    script = tmp_path / "script.ff"
+    script.write_text("echoln \"in script\"\necholn $cd\n", encoding="utf-8")
+
+    process = connect(server, "script.ff", cwd=tmp_path)
+    assert process.returncode == 0
+    assert_match("in script", process.stdout)
+    assert_match(str(tmp_path), process.stdout)
+
+
+def test_server_isolation(server: str) -> None:
+    assert connect(server, "-c", "eval 42 -s leaked").returncode == 0
+    assert_not_match("42", connect(server, "-c", "echoln \"[$leaked]\"").stdout)
+
+    # Subprocesses see the environment of the requester
+    env = dict(os.environ, LITESHELL_SERVER_TEST="from the client")
+    process = connect(server, "-c", "cmd /c set LITESHELL_SERVER_TEST", env=env)
+    assert_match("from the client", process.stdout)
+
+    process = connect(server, "-c", "cmd /c set LITESHELL_SERVER_TEST")
+    assert_not_match("from the client", process.stdout)
+
+
+def test_server_arguments() -> None:
+    assert subprocess.run([build_dir / "shell.exe", "--server"], capture_output=True, input="").returncode == 1
+    assert subprocess.run([build_dir / "shell.exe", "--connect", "x"], capture_output=True, input="").returncode == 1
+    assert subprocess.run([build_dir / "shell.exe", "--server", "x", "-c", "hello"], capture_output=True, input="").returncode == 1
+
+    # No server with this name
+    process = connect(f"missing-{os.getpid()}", "-c", "hello")
+    assert process.returncode == 1
+    assert process.stderr != ""
@@ -0,0 +1,50 @@
+from __future__ import annotations
+
+import random
+from pathlib import Path
+
+from .globals import (
+    execute_command,
+    invalid_argument_test,
+)
+
+
+def sort_lines(command: str, output: Path) -> list[str]:
+    execute_command(f"{command} > \"{output}\"")
+    return output.read_text(encoding="utf-8").splitlines()
+
+
+def test_sort(tmp_path: Path) -> None:
+    source = tmp_path / "input.txt"
+    source.write_text("pear\r\napple\r\n10 kiwi\r\n9 fig\r\nbanana", encoding="utf-8")
+
+    output = tmp_path / "output.txt"
+    assert sort_lines(f"sort \"{source}\"", output) == ["10 kiwi", "9 fig", "apple", "banana", "pear"]
+    assert sort_lines(f"sort -r \"{source}\"", output) == ["pear", "banana", "apple", "9 fig", "10 kiwi"]
+
+    # Lines without a number count as 0 and keep their order
+    assert sort_lines(f"sort -n \"{source}\"", output) == ["pear", "apple", "banana", "9 fig", "10 kiwi"]
+    assert sort_lines(f"sort -n -r \"{source}\"", output) == ["10 kiwi", "9 fig", "pear", "apple", "banana"]
+
+
+def test_sort_external(tmp_path: Path) -> None:
+    generator = random.Random(0)
+    lines = [f"{generator.randrange(10 ** 6)} {generator.randrange(10 ** 9):x}" for _ in range(100000)]
+
+    source = tmp_path / "input.txt"
+    source.write_text("\n".join(lines), encoding="utf-8")
+
+    # A 1MB budget spills the 2MB input to several runs before merging them
+    output = tmp_path / "output.txt"
+    assert sort_lines(f"sort -m 1 \"{source}\"", output) == sorted(lines)
+    assert sort_lines(f"sort -n -m 1 -j 2 \"{source}\"", output) == sorted(lines, key=lambda line: int(line.split()[0]))
+
+
+def test_sort_pipeline(tmp_path: Path) -> None:
+    output = tmp_path / "output.txt"
+    assert sort_lines("hello | sort", output) == ["Hello world!"]
+
+
+def test_sort_errors() -> None:
+    invalid_argument_test("sort")
+    invalid_argument_test("sort -m 0 README.md")
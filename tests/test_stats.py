@@ -0,0 +1,23 @@
+from __future__ import annotations
+
+from .globals import execute_command
+
+
+def test_stats_table() -> None:
+    stdout, _ = execute_command("stats")
+    for label in ("Commands dispatched", "Lines resolved", "Subprocesses spawned", "Peak memory"):
+        assert label in stdout
+
+
+def test_stats_variable() -> None:
+    stdout, _ = execute_command(
+        "stats -q -r\n"
+        "echoln first\n"
+        "echoln second\n"
+        "stats -q\n"
+        "echoln \"${stats[commands]} ${stats[lines_resolved]} ${stats[subprocesses]}\"\n"
+        "echoln \"${#stats}\""
+    )
+    lines = stdout.split()
+    assert "3 0 0" in stdout
+    assert "7" in lines
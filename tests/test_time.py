@@ -0,0 +1,35 @@
+from __future__ import annotations
+
+from pathlib import Path
+
+from .globals import assert_match, execute_command, invalid_argument_test
+
+
+def test_time() -> None:
+    stdout, _ = execute_command("time hello")
+    assert_match("Hello world!", stdout)
+    for name in ("Wall", "User", "Kernel"):
+        assert_match(name, stdout)
+
+
+def test_time_repeat(tmp_path: Path) -> None:
+    stdout, _ = execute_command("time -r 5 hello")
+    assert stdout.count("Hello world!") == 5
+    assert_match("5 runs", stdout)
+    for name in ("Min", "Median", "P95", "Max"):
+        assert_match(name, stdout)
+
+    # Each run of a batch script lasts until the script ends
+    script = tmp_path / "script.ff"
+    script.write_text("echoln \"in script\"\n", encoding="utf-8")
+    stdout, _ = execute_command(f"time --repeat 3 {script}\necholn after")
+    assert stdout.count("in script") == 3
+    assert stdout.index("3 runs") < stdout.index("after")
+
+
+def test_time_arguments() -> None:
+    # Tokens after the first -- belong to the command, including another --, and variables are resolved once
+    stdout, _ = execute_command("time -r 2 -- echoln -- -x \"a  b\" $$PATH")
+    assert stdout.count("-x a  b $PATH") == 2
+
+    invalid_argument_test("time -r 0 hello")
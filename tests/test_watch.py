@@ -0,0 +1,34 @@
+from __future__ import annotations
+
+import time
+from pathlib import Path
+
+from .globals import execute_command, invalid_argument_test
+
+
+def test_watch_interval() -> None:
+    start = time.perf_counter()
+    stdout, _ = execute_command("watch -n 3 0.2 hello\necholn after")
+    elapsed = time.perf_counter() - start
+
+    assert stdout.count("Hello world!") == 3
+    assert stdout.index("Hello world!") < stdout.index("after")
+    assert elapsed >= 0.4
+
+
+def test_watch_on_change(tmp_path: Path) -> None:
+    watched = tmp_path / "watched"
+    watched.mkdir()
+
+    # Each run changes the watched directory, which triggers the next run
+    script = tmp_path / "script.ff"
+    script.write_text(f"echoln run >> \"{watched}\\log.txt\"\n", encoding="utf-8")
+    execute_command(f"watch -n 3 --on-change \"{watched}\" --debounce 50 {script}")
+    assert (watched / "log.txt").read_text(encoding="utf-8").split() == ["run"] * 3
+
+
+def test_watch_errors(tmp_path: Path) -> None:
+    invalid_argument_test("watch 0 hello")
+    invalid_argument_test("watch 1")
+    invalid_argument_test("watch -n 0 1 hello")
+    invalid_argument_test(f"watch --on-change \"{tmp_path}\\missing\" hello")